@@ -4,6 +4,7 @@
 
 import json
 import ctypes
+from random import SystemRandom
 from functools import reduce
 from binascii import unhexlify
 from collections import namedtuple
@@ -138,6 +139,22 @@ class Proof(_ProofStruct, BaseProof):
     G2_POINTS = ['B']
     FP_POINTS = ['input']
 
+    def rerandomize(self, vk):
+        """
+        A proof of the same statement which can't be linked to this one,
+        for random r1 and r2, with the delta of the verifying key:
+
+            A' = A / r1,  B' = r1 * B + r1 * r2 * delta,  C' = C + r2 * A
+        """
+        rng = SystemRandom()
+        r1 = rng.randrange(1, bn128.curve_order)
+        r2 = rng.randrange(1, bn128.curve_order)
+        r1_inv = pow(r1, bn128.curve_order - 2, bn128.curve_order)
+        return self._replace(
+            A=multiply(self.A, r1_inv),
+            B=add(multiply(self.B, r1), multiply(vk.delta, (r1 * r2) % bn128.curve_order)),
+            C=add(self.C, multiply(self.A, r2)))
+
 
 class BaseVerifier(object):
     def to_json(self):
@@ -210,3 +227,59 @@ class NativeVerifier(VerifyingKey):
         lib_verify.restype = ctypes.c_bool
 
         return lib_verify(vk_cstr, proof_cstr)
+
+
+class NativeVerifierHandle(object):
+    """
+    Loads the verifying key into the native library once, then verifies any
+    number of proofs against it, from any thread
+    """
+    def __init__(self, vk, native_library_path):
+        if not isinstance(vk, VerifyingKey):
+            raise TypeError("Invalid verifying key type")
+
+        lib = ctypes.cdll.LoadLibrary(native_library_path)
+        lib.ethsnarks_vk_load.argtypes = [ctypes.c_char_p]
+        lib.ethsnarks_vk_load.restype = ctypes.c_void_p
+        lib.ethsnarks_verify_with_handle.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        lib.ethsnarks_verify_with_handle.restype = ctypes.c_bool
+        lib.ethsnarks_vk_free.argtypes = [ctypes.c_void_p]
+        lib.ethsnarks_vk_free.restype = None
+        lib.ethsnarks_vk_enable_batching.argtypes = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_uint]
+        lib.ethsnarks_vk_enable_batching.restype = None
+        lib.ethsnarks_vk_batch_stats.argtypes = [ctypes.c_void_p] + [ctypes.POINTER(ctypes.c_size_t)] * 3
+        lib.ethsnarks_vk_batch_stats.restype = ctypes.c_bool
+        self._lib = lib
+
+        self._handle = lib.ethsnarks_vk_load(ctypes.c_char_p(vk.to_json().encode('ascii')))
+        if not self._handle:
+            raise ValueError("Native library rejected the verifying key")
+
+    def verify(self, proof):
+        if not isinstance(proof, Proof):
+            raise TypeError("Invalid proof type")
+        proof_cstr = ctypes.c_char_p(proof.to_json().encode('ascii'))
+        return self._lib.ethsnarks_verify_with_handle(self._handle, proof_cstr)
+
+    def enable_batching(self, max_size=64, max_wait_us=2000):
+        """
+        Proofs verified concurrently from many threads are then checked
+        together, each call waits at most `max_wait_us` longer for others.
+        Call before sharing the handle, a `max_size` of 0 turns it off.
+        """
+        self._lib.ethsnarks_vk_enable_batching(self._handle, max_size, max_wait_us)
+
+    def batch_stats(self):
+        """
+        Returns (batches, proofs, largest batch), or None if not batching
+        """
+        stats = [ctypes.c_size_t() for _ in range(3)]
+        if not self._lib.ethsnarks_vk_batch_stats(self._handle, *[ctypes.byref(_) for _ in stats]):
+            return None
+        return tuple(_.value for _ in stats)
+
+    def __del__(self):
+        handle = getattr(self, '_handle', None)
+        if handle:
+            self._lib.ethsnarks_vk_free(handle)
+            self._handle = None
@@ -32,6 +32,15 @@ int SHA256_Init (SHA256_CTX *c)
 	return 1;
 	}
 
+int SHA256_Init_midstate (SHA256_CTX *c, const uint32_t h[8], size_t n_blocks)
+	{
+	const uint64_t bits = (uint64_t)n_blocks * SHA256_CBLOCK * 8;
+	SHA256_Init(c);
+	memcpy(c->h, h, sizeof(c->h));
+	c->Nl=(uint32_t)bits;	c->Nh=(uint32_t)(bits >> 32);
+	return 1;
+	}
+
 unsigned char *SHA224(const unsigned char *d, size_t n, unsigned char *md)
 	{
 	SHA256_CTX c;
@@ -104,6 +113,8 @@ int SHA224_Final (unsigned char *md, SHA256_CTX *c)
 #define	HASH_BLOCK_DATA_ORDER	sha256_block_data_order
 void sha256_block_host_order (SHA256_CTX *ctx, const void *in, size_t num);
 void sha256_block_data_order (SHA256_CTX *ctx, const void *in, size_t num);
+void sha256_block_native (SHA256_CTX *ctx, const void *in, size_t num);
+void sha256_block_generic (SHA256_CTX *ctx, const void *in, size_t num);
 
 #include "md32_common.h"
 
@@ -232,5 +243,18 @@ static void sha256_block (SHA256_CTX *ctx, const void *in, size_t num, int host)
 void HASH_BLOCK_HOST_ORDER (SHA256_CTX *ctx, const void *in, size_t num)
 {   sha256_block (ctx,in,num,1);   }
 
+/* Dispatched by sha256_native.c to what the CPU has */
 void HASH_BLOCK_DATA_ORDER (SHA256_CTX *ctx, const void *in, size_t num)
+{   sha256_block_native (ctx,in,num);   }
+
+void sha256_block_generic (SHA256_CTX *ctx, const void *in, size_t num)
 {   sha256_block (ctx,in,num,0);   }
+
+void SHA256_Midstate (const unsigned char *prefix, size_t n_blocks, uint32_t h[8])
+	{
+	SHA256_CTX c;
+	SHA256_Init(&c);
+	if (n_blocks)
+		sha256_block_data_order(&c, prefix, n_blocks);
+	memcpy(h, c.h, sizeof(c.h));
+	}
@@ -2,6 +2,7 @@
 #define _SHA256_H 1
 
 #include <inttypes.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +38,35 @@ int SHA256_Final(unsigned char *md, SHA256_CTX *c);
 unsigned char *SHA256(const unsigned char *d, size_t n,unsigned char *md);
 void SHA256_Transform(SHA256_CTX *c, const unsigned char *data);
 
+/*
+ * Messages with a common prefix of whole blocks can start from the state
+ * after it, the midstate, instead of hashing the prefix every time.
+ * SHA256_Init_midstate resumes after the n_blocks of the prefix, so the
+ * length in the padding is of the whole message.
+ */
+void SHA256_Midstate(const unsigned char *prefix, size_t n_blocks, uint32_t h[8]);
+int SHA256_Init_midstate(SHA256_CTX *c, const uint32_t h[8], size_t n_blocks);
+
+/*
+ * The compression function is picked at runtime: the SHA extensions when
+ * the CPU has them, otherwise generic C. With AVX2 sha256_many_native
+ * hashes 8 messages at a time, unless the generic code was selected.
+ * ETHSNARKS_SHA256=generic|avx2|shani in the environment picks one.
+ */
+#define SHA256_IMPL_GENERIC	0
+#define SHA256_IMPL_AVX2	1
+#define SHA256_IMPL_SHANI	2
+
+int sha256_native_impl(void);
+int sha256_native_select(int impl);	/* 0 if the CPU doesn't have it */
+const char *sha256_native_name(int impl);
+
+/* digests[32*i ...] = SHA256(inputs[i], lens[i]) for each of the n messages */
+void sha256_many_native(const unsigned char *const inputs[], const size_t lens[], size_t n, unsigned char *digests);
+
+/* The same for messages after a prefix of n_blocks, whose midstate is h */
+void sha256_many_native_midstate(const uint32_t h[8], size_t n_blocks, const unsigned char *const inputs[], const size_t lens[], size_t n, unsigned char *digests);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,426 @@
+/* crypto/sha256_native.c */
+/*
+ * SHA-256 compression with the x86 SHA extensions, and AVX2 compression of
+ * 8 independent messages at a time, picked at runtime by what the CPU has.
+ * Other compilers and architectures only have the generic code of sha256.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sha256.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SHA256_NATIVE_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+/* Generic compression, from sha256.c */
+void sha256_block_generic (SHA256_CTX *ctx, const void *in, size_t num);
+
+static int sha256_impl_available = -1;
+static int sha256_impl_selected = -1;
+
+static const uint32_t SHA256_H0[8] = {
+	0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL,
+	0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL };
+
+/* One message after a prefix of n_prefix_blocks, whose midstate is h0 */
+static void sha256_one (const uint32_t h0[8], size_t n_prefix_blocks, const unsigned char *in, size_t len, unsigned char *digest)
+	{
+	SHA256_CTX c;
+	SHA256_Init_midstate(&c, h0, n_prefix_blocks);
+	SHA256_Update(&c, in, len);
+	SHA256_Final(digest, &c);
+	}
+
+
+#ifdef SHA256_NATIVE_X86
+
+static const uint32_t K256_native[64] = {
+	0x428a2f98UL,0x71374491UL,0xb5c0fbcfUL,0xe9b5dba5UL,
+	0x3956c25bUL,0x59f111f1UL,0x923f82a4UL,0xab1c5ed5UL,
+	0xd807aa98UL,0x12835b01UL,0x243185beUL,0x550c7dc3UL,
+	0x72be5d74UL,0x80deb1feUL,0x9bdc06a7UL,0xc19bf174UL,
+	0xe49b69c1UL,0xefbe4786UL,0x0fc19dc6UL,0x240ca1ccUL,
+	0x2de92c6fUL,0x4a7484aaUL,0x5cb0a9dcUL,0x76f988daUL,
+	0x983e5152UL,0xa831c66dUL,0xb00327c8UL,0xbf597fc7UL,
+	0xc6e00bf3UL,0xd5a79147UL,0x06ca6351UL,0x14292967UL,
+	0x27b70a85UL,0x2e1b2138UL,0x4d2c6dfcUL,0x53380d13UL,
+	0x650a7354UL,0x766a0abbUL,0x81c2c92eUL,0x92722c85UL,
+	0xa2bfe8a1UL,0xa81a664bUL,0xc24b8b70UL,0xc76c51a3UL,
+	0xd192e819UL,0xd6990624UL,0xf40e3585UL,0x106aa070UL,
+	0x19a4c116UL,0x1e376c08UL,0x2748774cUL,0x34b0bcb5UL,
+	0x391c0cb3UL,0x4ed8aa4aUL,0x5b9cca4fUL,0x682e6ff3UL,
+	0x748f82eeUL,0x78a5636fUL,0x84c87814UL,0x8cc70208UL,
+	0x90befffaUL,0xa4506cebUL,0xbef9a3f7UL,0xc67178f2UL };
+
+static int sha256_detect (void)
+	{
+	unsigned int a, b, c, d, xcr0_lo, xcr0_hi;
+	int ssse3, sse41, osxsave, avx;
+	int result = 1 << SHA256_IMPL_GENERIC;
+
+	if (!__get_cpuid(1, &a, &b, &c, &d))
+		return result;
+	ssse3 = (c >> 9) & 1;
+	sse41 = (c >> 19) & 1;
+	osxsave = (c >> 27) & 1;
+	avx = (c >> 28) & 1;
+
+	if (__get_cpuid_max(0, 0) < 7)
+		return result;
+	__cpuid_count(7, 0, a, b, c, d);
+
+	if (((b >> 29) & 1) && ssse3 && sse41)
+		result |= 1 << SHA256_IMPL_SHANI;
+
+	if (((b >> 5) & 1) && avx && osxsave)
+		{
+		/* The OS must save the YMM registers */
+		__asm__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+		if ((xcr0_lo & 6) == 6)
+			result |= 1 << SHA256_IMPL_AVX2;
+		}
+
+	return result;
+	}
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_block_shani (uint32_t state[8], const unsigned char *data, size_t num)
+	{
+	const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i STATE0, STATE1, MSG, TMP, ABEF_SAVE, CDGH_SAVE;
+	__m128i W[4];
+	int i;
+
+	TMP = _mm_loadu_si128((const __m128i *)&state[0]);
+	STATE1 = _mm_loadu_si128((const __m128i *)&state[4]);
+	TMP = _mm_shuffle_epi32(TMP, 0xB1);			/* CDAB */
+	STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);		/* EFGH */
+	STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);		/* ABEF */
+	STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0);		/* CDGH */
+
+	while (num--)
+		{
+		ABEF_SAVE = STATE0;
+		CDGH_SAVE = STATE1;
+
+		for (i = 0; i < 4; i++)
+			W[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), MASK);
+
+		/* 4 rounds per step, W holds the last 16 words of the schedule */
+		for (i = 0; i < 16; i++)
+			{
+			if (i >= 4)
+				{
+				TMP = _mm_add_epi32(_mm_sha256msg1_epu32(W[i & 3], W[(i + 1) & 3]),
+						    _mm_alignr_epi8(W[(i + 3) & 3], W[(i + 2) & 3], 4));
+				W[i & 3] = _mm_sha256msg2_epu32(TMP, W[(i + 3) & 3]);
+				}
+			MSG = _mm_add_epi32(W[i & 3], _mm_loadu_si128((const __m128i *)&K256_native[4 * i]));
+			STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+			STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, _mm_shuffle_epi32(MSG, 0x0E));
+			}
+
+		STATE0 = _mm_add_epi32(STATE0, ABEF_SAVE);
+		STATE1 = _mm_add_epi32(STATE1, CDGH_SAVE);
+		data += SHA256_CBLOCK;
+		}
+
+	TMP = _mm_shuffle_epi32(STATE0, 0x1B);			/* FEBA */
+	STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);		/* DCHG */
+	STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0);		/* DCBA */
+	STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);		/* ABEF */
+	_mm_storeu_si128((__m128i *)&state[0], STATE0);
+	_mm_storeu_si128((__m128i *)&state[4], STATE1);
+	}
+
+#define X8_ROTR(x,n)	_mm256_or_si256(_mm256_srli_epi32((x),(n)), _mm256_slli_epi32((x),32-(n)))
+#define X8_XOR3(x,y,z)	_mm256_xor_si256(_mm256_xor_si256((x),(y)),(z))
+#define X8_Sigma0(x)	X8_XOR3(X8_ROTR((x),2), X8_ROTR((x),13), X8_ROTR((x),22))
+#define X8_Sigma1(x)	X8_XOR3(X8_ROTR((x),6), X8_ROTR((x),11), X8_ROTR((x),25))
+#define X8_sigma0(x)	X8_XOR3(X8_ROTR((x),7), X8_ROTR((x),18), _mm256_srli_epi32((x),3))
+#define X8_sigma1(x)	X8_XOR3(X8_ROTR((x),17), X8_ROTR((x),19), _mm256_srli_epi32((x),10))
+#define X8_Ch(x,y,z)	_mm256_xor_si256(_mm256_and_si256((x),(y)), _mm256_andnot_si256((x),(z)))
+#define X8_Maj(x,y,z)	_mm256_or_si256(_mm256_and_si256((x),(y)), _mm256_and_si256(_mm256_or_si256((x),(y)),(z)))
+
+static int sha256_load32 (const unsigned char *p)
+	{
+	int x;
+	memcpy(&x, p, sizeof(x));
+	return x;
+	}
+
+/*
+ * One block of each of 8 messages, lane j of the state vectors is message j
+ */
+__attribute__((target("avx2")))
+static void sha256_block_x8 (__m256i state[8], const unsigned char *const blocks[8])
+	{
+	const __m256i BSWAP = _mm256_set_epi64x(
+		0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+		0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m256i W[64];
+	__m256i a, b, c, d, e, f, g, h, T1, T2;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		{
+		W[i] = _mm256_shuffle_epi8(_mm256_set_epi32(
+			sha256_load32(blocks[7] + 4 * i), sha256_load32(blocks[6] + 4 * i),
+			sha256_load32(blocks[5] + 4 * i), sha256_load32(blocks[4] + 4 * i),
+			sha256_load32(blocks[3] + 4 * i), sha256_load32(blocks[2] + 4 * i),
+			sha256_load32(blocks[1] + 4 * i), sha256_load32(blocks[0] + 4 * i)), BSWAP);
+		}
+	for (i = 16; i < 64; i++)
+		{
+		W[i] = _mm256_add_epi32(_mm256_add_epi32(X8_sigma1(W[i - 2]), W[i - 7]),
+					_mm256_add_epi32(X8_sigma0(W[i - 15]), W[i - 16]));
+		}
+
+	a = state[0];	b = state[1];	c = state[2];	d = state[3];
+	e = state[4];	f = state[5];	g = state[6];	h = state[7];
+
+	for (i = 0; i < 64; i++)
+		{
+		T1 = _mm256_add_epi32(_mm256_add_epi32(h, X8_Sigma1(e)),
+				      _mm256_add_epi32(X8_Ch(e, f, g),
+						       _mm256_add_epi32(_mm256_set1_epi32((int)K256_native[i]), W[i])));
+		T2 = _mm256_add_epi32(X8_Sigma0(a), X8_Maj(a, b, c));
+		h = g;	g = f;	f = e;	e = _mm256_add_epi32(d, T1);
+		d = c;	c = b;	b = a;	a = _mm256_add_epi32(T1, T2);
+		}
+
+	state[0] = _mm256_add_epi32(state[0], a);	state[1] = _mm256_add_epi32(state[1], b);
+	state[2] = _mm256_add_epi32(state[2], c);	state[3] = _mm256_add_epi32(state[3], d);
+	state[4] = _mm256_add_epi32(state[4], e);	state[5] = _mm256_add_epi32(state[5], f);
+	state[6] = _mm256_add_epi32(state[6], g);	state[7] = _mm256_add_epi32(state[7], h);
+	}
+
+/* Number of blocks of a message once padded */
+static size_t sha256_padded_blocks (size_t len)
+	{
+	return (len + 8) / SHA256_CBLOCK + 1;
+	}
+
+/* The padded last one or two blocks of a message, after prefix_len bytes */
+static void sha256_pad_tail (unsigned char tail[2 * SHA256_CBLOCK], const unsigned char *in, size_t len, uint64_t prefix_len)
+	{
+	const size_t rem = len % SHA256_CBLOCK;
+	const size_t tail_len = (sha256_padded_blocks(len) - len / SHA256_CBLOCK) * SHA256_CBLOCK;
+	const uint64_t bits = (prefix_len + len) * 8;
+	int i;
+
+	memset(tail, 0, 2 * SHA256_CBLOCK);
+	memcpy(tail, in + len - rem, rem);
+	tail[rem] = 0x80;
+	for (i = 0; i < 8; i++)
+		tail[tail_len - 1 - i] = (unsigned char)(bits >> (8 * i));
+	}
+
+/*
+ * Hashes 8 messages with the same number of padded blocks, starting from
+ * the midstate h0 after prefix_len bytes
+ */
+__attribute__((target("avx2")))
+static void sha256_many_x8 (const uint32_t h0[8], uint64_t prefix_len, const unsigned char *const inputs[8], const size_t lens[8], unsigned char *const digests[8])
+	{
+	unsigned char tails[8][2 * SHA256_CBLOCK];
+	const unsigned char *blocks[8];
+	__m256i state[8];
+	uint32_t words[8];
+	const size_t n_blocks = sha256_padded_blocks(lens[0]);
+	size_t i, j, k;
+
+	for (j = 0; j < 8; j++)
+		{
+		state[j] = _mm256_set1_epi32((int)h0[j]);
+		sha256_pad_tail(tails[j], inputs[j], lens[j], prefix_len);
+		}
+
+	for (i = 0; i < n_blocks; i++)
+		{
+		for (j = 0; j < 8; j++)
+			{
+			const size_t n_full = lens[j] / SHA256_CBLOCK;
+			blocks[j] = i < n_full ? inputs[j] + i * SHA256_CBLOCK
+					       : tails[j] + (i - n_full) * SHA256_CBLOCK;
+			}
+		sha256_block_x8(state, blocks);
+		}
+
+	for (k = 0; k < 8; k++)
+		{
+		_mm256_storeu_si256((__m256i *)words, state[k]);
+		for (j = 0; j < 8; j++)
+			{
+			digests[j][4 * k + 0] = (unsigned char)(words[j] >> 24);
+			digests[j][4 * k + 1] = (unsigned char)(words[j] >> 16);
+			digests[j][4 * k + 2] = (unsigned char)(words[j] >> 8);
+			digests[j][4 * k + 3] = (unsigned char)(words[j]);
+			}
+		}
+	}
+
+struct sha256_order {
+	size_t blocks;
+	size_t index;
+	};
+
+static int sha256_cmp_order (const void *x, const void *y)
+	{
+	const struct sha256_order *ox = x, *oy = y;
+	if (ox->blocks != oy->blocks)
+		return (ox->blocks > oy->blocks) - (ox->blocks < oy->blocks);
+	return (ox->index > oy->index) - (ox->index < oy->index);
+	}
+
+/*
+ * Messages are grouped 8 at a time by their number of blocks, those which
+ * don't fill a group are hashed one by one. Returns how many were hashed.
+ */
+static size_t sha256_many_avx2 (const uint32_t h0[8], size_t n_prefix_blocks, const unsigned char *const inputs[], const size_t lens[], size_t n, unsigned char *digests)
+	{
+	const uint64_t prefix_len = (uint64_t)n_prefix_blocks * SHA256_CBLOCK;
+	const unsigned char *group_inputs[8];
+	unsigned char *group_digests[8];
+	size_t group_lens[8];
+	struct sha256_order *order;
+	size_t i, j, start;
+
+	if (n < 8)
+		return 0;
+
+	order = malloc(n * sizeof(*order));
+	if (order == NULL)
+		return 0;
+	for (i = 0; i < n; i++)
+		{
+		order[i].blocks = sha256_padded_blocks(lens[i]);
+		order[i].index = i;
+		}
+	qsort(order, n, sizeof(*order), sha256_cmp_order);
+
+	start = 0;
+	while (start < n)
+		{
+		size_t end = start + 1;
+		while (end < n && order[end].blocks == order[start].blocks)
+			end++;
+
+		for (i = start; i + 8 <= end; i += 8)
+			{
+			for (j = 0; j < 8; j++)
+				{
+				group_inputs[j] = inputs[order[i + j].index];
+				group_lens[j] = lens[order[i + j].index];
+				group_digests[j] = digests + order[i + j].index * SHA256_DIGEST_LENGTH;
+				}
+			sha256_many_x8(h0, prefix_len, group_inputs, group_lens, group_digests);
+			}
+		for (; i < end; i++)
+			sha256_one(h0, n_prefix_blocks, inputs[order[i].index], lens[order[i].index], digests + order[i].index * SHA256_DIGEST_LENGTH);
+
+		start = end;
+		}
+
+	free(order);
+	return n;
+	}
+
+#else
+
+static int sha256_detect (void)
+	{
+	return 1 << SHA256_IMPL_GENERIC;
+	}
+
+#endif
+
+
+static int sha256_impl_current (void)
+	{
+	if (sha256_impl_selected < 0)
+		{
+		const char *name = getenv("ETHSNARKS_SHA256");
+		int impl = SHA256_IMPL_SHANI;
+
+		/* ETHSNARKS_SHA256=generic|avx2|shani overrides the best one */
+		if (name != NULL)
+			{
+			for (impl = SHA256_IMPL_SHANI; impl >= SHA256_IMPL_GENERIC; impl--)
+				if (strcmp(name, sha256_native_name(impl)) == 0)
+					break;
+			}
+		if (impl < SHA256_IMPL_GENERIC || !sha256_native_select(impl))
+			{
+			for (impl = SHA256_IMPL_SHANI; impl > SHA256_IMPL_GENERIC; impl--)
+				if (sha256_native_select(impl))
+					break;
+			sha256_native_select(impl);
+			}
+		}
+	return sha256_impl_selected;
+	}
+
+int sha256_native_impl (void)
+	{
+	return sha256_impl_current();
+	}
+
+int sha256_native_select (int impl)
+	{
+	if (sha256_impl_available < 0)
+		sha256_impl_available = sha256_detect();
+
+	if (impl < SHA256_IMPL_GENERIC || impl > SHA256_IMPL_SHANI || !(sha256_impl_available & (1 << impl)))
+		return 0;
+
+	sha256_impl_selected = impl;
+	return 1;
+	}
+
+const char *sha256_native_name (int impl)
+	{
+	switch (impl)
+		{
+	case SHA256_IMPL_GENERIC:	return "generic";
+	case SHA256_IMPL_AVX2:		return "avx2";
+	case SHA256_IMPL_SHANI:		return "shani";
+		}
+	return "unknown";
+	}
+
+void sha256_block_native (SHA256_CTX *ctx, const void *in, size_t num)
+	{
+#ifdef SHA256_NATIVE_X86
+	if (sha256_impl_current() == SHA256_IMPL_SHANI)
+		{
+		sha256_block_shani(ctx->h, (const unsigned char *)in, num);
+		return;
+		}
+#endif
+	sha256_block_generic(ctx, in, num);
+	}
+
+void sha256_many_native_midstate (const uint32_t h[8], size_t n_blocks, const unsigned char *const inputs[], const size_t lens[], size_t n, unsigned char *digests)
+	{
+	size_t i;
+
+#ifdef SHA256_NATIVE_X86
+	/* 8 lanes of AVX2 outrun one stream of the SHA extensions */
+	if (sha256_impl_current() != SHA256_IMPL_GENERIC && (sha256_impl_available & (1 << SHA256_IMPL_AVX2))
+	 && sha256_many_avx2(h, n_blocks, inputs, lens, n, digests) == n)
+		return;
+#endif
+
+	for (i = 0; i < n; i++)
+		sha256_one(h, n_blocks, inputs[i], lens[i], digests + i * SHA256_DIGEST_LENGTH);
+	}
+
+void sha256_many_native (const unsigned char *const inputs[], const size_t lens[], size_t n, unsigned char *digests)
+	{
+	sha256_many_native_midstate(SHA256_H0, 0, inputs, lens, n, digests);
+	}
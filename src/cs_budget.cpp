@@ -0,0 +1,170 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <cstdlib>  // getenv
+#include <fstream>
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+
+#include "cs_budget.hpp"
+
+using json = nlohmann::json;
+
+
+namespace ethsnarks {
+
+
+/**
+* Read the budget for `name`, false when the budget file can't be read.
+* `found` is false when the file has no entry for `name`.
+*/
+static bool load_budget( const char *path, const std::string& name, CSBudgetEntry& budget, double& threshold, double& witness_threshold, bool& found )
+{
+    found = false;
+
+    std::ifstream in(path);
+    if( ! in.is_open() ) {
+        std::cerr << "Warning: no cost budget " << path << std::endl;
+        return false;
+    }
+
+    json root;
+    try {
+        in >> root;
+    }
+    catch( const json::exception& ex ) {
+        std::cerr << "Error: cannot parse cost budget " << path << ": " << ex.what() << std::endl;
+        return false;
+    }
+
+    threshold = root.value("threshold", 0.0);
+    witness_threshold = root.value("witness_threshold", 1.0);
+
+    const auto gadgets = root.find("gadgets");
+    if( gadgets == root.end() || ! gadgets->contains(name) ) {
+        return true;
+    }
+
+    const auto& entry = (*gadgets)[name];
+    budget.constraints = entry.value("constraints", size_t(0));
+    budget.variables = entry.value("variables", size_t(0));
+    budget.terms = entry.value("terms", size_t(0));
+    budget.witness_seconds = entry.value("witness_seconds", 0.0);
+    found = true;
+    return true;
+}
+
+
+static void append_report( const std::string& name, const CSProfileEntry& cost )
+{
+    const char *path = ::getenv("ETHSNARKS_COST_REPORT");
+    if( ! path ) {
+        return;
+    }
+
+    std::ofstream out(path, std::ios::app);
+    out << json({{"name", name},
+                 {"constraints", cost.constraints},
+                 {"variables", cost.variables},
+                 {"terms", cost.terms},
+                 {"witness_seconds", cost.witness_seconds}}).dump() << std::endl;
+}
+
+
+template<typename T>
+static bool within( const char *what, const std::string& name, T cost, T limit, double threshold )
+{
+    if( limit == 0 || cost <= limit * (1 + threshold) ) {
+        return true;
+    }
+    std::cerr << "FAIL " << name << " has " << cost << " " << what << ", over its budget of " << limit << std::endl;
+    return false;
+}
+
+
+bool cs_budget_check( const std::string& name, const CSProfileEntry& cost, const char *budget_path )
+{
+    std::cout << "COST " << name << ": "
+              << cost.constraints << " constraints, "
+              << cost.variables << " variables, "
+              << cost.terms << " terms, "
+              << (cost.witness_seconds * 1000) << " ms witness" << std::endl;
+
+    append_report(name, cost);
+
+    const char *path = ::getenv("ETHSNARKS_COST_BUDGET");
+    if( ! path ) {
+        path = budget_path;
+    }
+
+    CSBudgetEntry budget;
+    double threshold, witness_threshold;
+    bool found;
+    if( ! path || ! load_budget(path, name, budget, threshold, witness_threshold, found) ) {
+        return true;
+    }
+
+    // A new gadget needs its budget, otherwise its cost is never checked
+    if( ! found ) {
+        std::cerr << "FAIL " << name << " has no budget in " << path << std::endl;
+        return false;
+    }
+
+    // Every limit is checked, so all the regressions are reported at once
+    bool ok = within("constraints", name, cost.constraints, budget.constraints, threshold);
+    ok = within("variables", name, cost.variables, budget.variables, threshold) && ok;
+    ok = within("terms", name, cost.terms, budget.terms, threshold) && ok;
+    ok = within("seconds of witness", name, cost.witness_seconds, budget.witness_seconds, witness_threshold) && ok;
+
+    if( ok && cost.constraints < budget.constraints ) {
+        std::cout << "COST " << name << " is under its budget of " << budget.constraints << " constraints" << std::endl;
+    }
+
+    return ok;
+}
+
+
+CSBudgetScope::CSBudgetScope( ProtoboardT& in_pb, const std::string& in_name, const char *in_budget_path ) :
+    m_pb(in_pb),
+    m_name(in_name),
+    m_budget_path(in_budget_path),
+    m_constraints(in_pb.num_constraints()),
+    m_variables(in_pb.num_variables()),
+    m_witness_seconds(0)
+{ }
+
+
+void CSBudgetScope::witness( const std::function<void()>& fn )
+{
+    CSProfileEntry timed;
+    {
+        CSProfileTimer timer(timed);
+        fn();
+    }
+    m_witness_seconds += timed.witness_seconds;
+}
+
+
+CSProfileEntry CSBudgetScope::cost() const
+{
+    CSProfileEntry result;
+    result.count = 1;
+    result.constraints = m_pb.num_constraints() - m_constraints;
+    result.variables = m_pb.num_variables() - m_variables;
+    for( size_t i = m_constraints; i < m_pb.num_constraints(); i++ ) {
+        result.terms += cs_constraint_terms(m_pb.constraint_system, i);
+    }
+    result.witness_seconds = m_witness_seconds;
+    return result;
+}
+
+
+bool CSBudgetScope::check() const
+{
+    return cs_budget_check(m_name, cost(), m_budget_path);
+}
+
+
+// namespace ethsnarks
+}
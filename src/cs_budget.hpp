@@ -0,0 +1,89 @@
+#ifndef ETHSNARKS_CS_BUDGET_HPP_
+#define ETHSNARKS_CS_BUDGET_HPP_
+
+#include <functional>
+#include <string>
+
+#include "cs_profile.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* The cost a gadget is allowed, from the budget file checked in with the
+* tests. Only the limits given are checked, zero means none.
+*/
+struct CSBudgetEntry {
+    size_t constraints = 0;
+    size_t variables = 0;
+    size_t terms = 0;
+    double witness_seconds = 0;
+};
+
+
+/**
+* Compare a measured cost to the budget for `name`, a limit is exceeded when
+* the cost is more than `1 + threshold` times it, with the thresholds of the
+* budget file. Costs under budget for their constraints are reported too, so
+* the budget can be tightened.
+*
+* The budget file is JSON:
+*
+*   {"threshold": 0, "witness_threshold": 1,
+*    "gadgets": {"<name>": {"constraints": N, "variables": N, "terms": N, "witness_seconds": S}}}
+*
+* It's `ETHSNARKS_COST_BUDGET` or otherwise `budget_path`. A gadget without
+* an entry in the budget fails, a missing budget file only warns. When
+* `ETHSNARKS_COST_REPORT` is set every measurement is appended to that file
+* as a line of JSON, to seed or update the budget.
+*/
+bool cs_budget_check( const std::string& name, const CSProfileEntry& cost, const char *budget_path );
+
+
+/**
+* Measures one gadget instance in a test, from construction to check():
+*
+*   CSBudgetScope cost(pb, "MiMC_e7_hash_gadget[2]");
+*   MiMC_e7_hash_gadget the_gadget(pb, iv, {m_0, m_1}, "gadget");
+*   the_gadget.generate_r1cs_constraints();
+*   cost.witness([&](){ the_gadget.generate_r1cs_witness(); });
+*   if( ! cost.check() ) ...
+*
+* Everything added to the protoboard in between is counted.
+*/
+class CSBudgetScope {
+public:
+    CSBudgetScope( ProtoboardT& in_pb, const std::string& in_name, const char *in_budget_path = default_budget_path() );
+
+    /** Run and time the witness generation */
+    void witness( const std::function<void()>& fn );
+
+    /** The cost so far */
+    CSProfileEntry cost() const;
+
+    /** Print the cost, and compare it to the budget */
+    bool check() const;
+
+    static const char *default_budget_path()
+    {
+#ifdef ETHSNARKS_COST_BUDGET
+        return ETHSNARKS_COST_BUDGET;
+#else
+        return nullptr;
+#endif
+    }
+
+protected:
+    ProtoboardT& m_pb;
+    const std::string m_name;
+    const char *m_budget_path;
+    const size_t m_constraints;
+    const size_t m_variables;
+    double m_witness_seconds;
+};
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_CS_BUDGET_HPP_
+#endif
@@ -0,0 +1,255 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <cstdio>   // rename
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "cs_cache.hpp"
+#include "crypto/blake2b.h"
+
+
+namespace ethsnarks {
+
+static const char CS_CACHE_MAGIC[8] = {'E', 'S', 'R', '1', 'C', 'S', '\0', '\0'};
+static const uint32_t CS_CACHE_VERSION = 2;
+static const uint32_t CS_CACHE_ANNOTATIONS = 1;
+
+
+bool cs_cache_hash_file( const char *path, uint8_t hash[CS_CACHE_HASH_SIZE], uint32_t layout_version )
+{
+    std::ifstream fh(path, std::ios::binary);
+    if( ! fh.is_open() ) {
+        return false;
+    }
+
+    blake2b_ctx ctx;
+    blake2b_init(&ctx, CS_CACHE_HASH_SIZE, nullptr, 0);
+
+    const uint32_t versions[2] = {CS_CACHE_VERSION, layout_version};
+    blake2b_update(&ctx, versions, sizeof(versions));
+
+    char buffer[1 << 16];
+    while( fh.read(buffer, sizeof(buffer)) || fh.gcount() > 0 ) {
+        blake2b_update(&ctx, buffer, fh.gcount());
+    }
+
+    blake2b_final(&ctx, hash);
+    return true;
+}
+
+
+std::string cs_cache_path( const char *circuit_file )
+{
+    return std::string(circuit_file) + ".cs";
+}
+
+
+static void put_u64( std::vector<uint8_t>& out, uint64_t value )
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+
+static void put_lc( std::vector<uint8_t>& out, const libsnark::linear_combination_light<FieldT>& lc )
+{
+    const auto& terms = lc.getTerms();
+    put_u64(out, terms.size());
+    for( const libsnark::linear_term_light<FieldT>& lt : terms )
+    {
+        put_u64(out, lt.index);
+        const LimbT coeff = lt.getCoeff().as_bigint();
+        const uint8_t *bytes = reinterpret_cast<const uint8_t*>(coeff.data);
+        out.insert(out.end(), bytes, bytes + sizeof(coeff.data));
+    }
+}
+
+
+bool cs_cache_save( const char *cache_file, const uint8_t hash[CS_CACHE_HASH_SIZE], const ConstraintSystemT& cs, bool annotations )
+{
+    // Write to a temporary file first, so concurrent provers never see half a cache
+    const std::string tmp_file = std::string(cache_file) + ".tmp";
+    std::ofstream fh(tmp_file, std::ios::binary | std::ios::trunc);
+    if( ! fh.is_open() ) {
+        return false;
+    }
+
+#ifndef DEBUG
+    // Annotations are only recorded by DEBUG builds of libsnark
+    annotations = false;
+#endif
+
+    std::vector<uint8_t> buffer(CS_CACHE_MAGIC, CS_CACHE_MAGIC + sizeof(CS_CACHE_MAGIC));
+    const uint32_t flags[2] = {CS_CACHE_VERSION, annotations ? CS_CACHE_ANNOTATIONS : 0};
+    const uint8_t *flag_bytes = reinterpret_cast<const uint8_t*>(flags);
+    buffer.insert(buffer.end(), flag_bytes, flag_bytes + sizeof(flags));
+    buffer.insert(buffer.end(), hash, hash + CS_CACHE_HASH_SIZE);
+    put_u64(buffer, sizeof(LimbT::data));
+    put_u64(buffer, cs.primary_input_size);
+    put_u64(buffer, cs.auxiliary_input_size);
+    put_u64(buffer, cs.num_constraints());
+    fh.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+
+    // Constraints are written in blocks to keep the buffer small
+    buffer.clear();
+    for( size_t c = 0; c < cs.num_constraints(); c++ )
+    {
+        put_lc(buffer, cs.constraints[c]->getA());
+        put_lc(buffer, cs.constraints[c]->getB());
+        put_lc(buffer, cs.constraints[c]->getC());
+
+        if( buffer.size() >= (1 << 20) || c + 1 == cs.num_constraints() ) {
+            fh.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+            buffer.clear();
+        }
+    }
+
+#ifdef DEBUG
+    if( annotations )
+    {
+        put_u64(buffer, cs.constraint_annotations.size());
+        for( const auto& it : cs.constraint_annotations )
+        {
+            put_u64(buffer, it.first);
+            put_u64(buffer, it.second.size());
+            buffer.insert(buffer.end(), it.second.begin(), it.second.end());
+        }
+        fh.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    }
+#endif
+
+    fh.close();
+    if( fh.fail() ) {
+        ::remove(tmp_file.c_str());
+        return false;
+    }
+    return 0 == ::rename(tmp_file.c_str(), cache_file);
+}
+
+
+class CacheReader
+{
+public:
+    CacheReader( const std::vector<char>& data ) :
+        m_cursor(data.data()), m_end(data.data() + data.size())
+    {}
+
+    bool read( void *out, size_t size )
+    {
+        if( size_t(m_end - m_cursor) < size ) {
+            return false;
+        }
+        ::memcpy(out, m_cursor, size);
+        m_cursor += size;
+        return true;
+    }
+
+    bool read_u64( uint64_t& out )
+    {
+        return read(&out, sizeof(out));
+    }
+
+    bool read_lc( libsnark::linear_combination<FieldT>& out, uint64_t num_variables )
+    {
+        uint64_t n_terms;
+        if( ! read_u64(n_terms) ) {
+            return false;
+        }
+        for( uint64_t i = 0; i < n_terms; i++ )
+        {
+            uint64_t index;
+            LimbT coeff;
+            if( ! read_u64(index) || index > num_variables || ! read(coeff.data, sizeof(coeff.data)) ) {
+                return false;
+            }
+            out.add_term(libsnark::variable<FieldT>(index), FieldT(coeff));
+        }
+        return true;
+    }
+
+    bool at_end() const
+    {
+        return m_cursor == m_end;
+    }
+
+private:
+    const char *m_cursor;
+    const char *m_end;
+};
+
+
+bool cs_cache_load( const char *cache_file, const uint8_t hash[CS_CACHE_HASH_SIZE], ConstraintSystemT& cs )
+{
+    std::ifstream fh(cache_file, std::ios::binary);
+    if( ! fh.is_open() ) {
+        return false;
+    }
+    const std::vector<char> data((std::istreambuf_iterator<char>(fh)), std::istreambuf_iterator<char>());
+    CacheReader reader(data);
+
+    char magic[sizeof(CS_CACHE_MAGIC)];
+    uint32_t flags[2];
+    uint8_t file_hash[CS_CACHE_HASH_SIZE];
+    uint64_t limb_bytes, primary_size, auxiliary_size, n_constraints;
+    if( ! reader.read(magic, sizeof(magic))
+     || ! reader.read(flags, sizeof(flags))
+     || ! reader.read(file_hash, sizeof(file_hash))
+     || ! reader.read_u64(limb_bytes)
+     || ! reader.read_u64(primary_size)
+     || ! reader.read_u64(auxiliary_size)
+     || ! reader.read_u64(n_constraints)
+     || 0 != ::memcmp(magic, CS_CACHE_MAGIC, sizeof(magic))
+     || flags[0] != CS_CACHE_VERSION
+     || (hash && 0 != ::memcmp(file_hash, hash, CS_CACHE_HASH_SIZE))
+     || limb_bytes != sizeof(LimbT::data) ) {
+        return false;
+    }
+
+    ConstraintSystemT result;
+    result.primary_input_size = primary_size;
+    result.auxiliary_input_size = auxiliary_size;
+
+    const uint64_t num_variables = primary_size + auxiliary_size;
+    for( uint64_t c = 0; c < n_constraints; c++ )
+    {
+        libsnark::linear_combination<FieldT> a, b, c_lc;
+        if( ! reader.read_lc(a, num_variables) || ! reader.read_lc(b, num_variables) || ! reader.read_lc(c_lc, num_variables) ) {
+            return false;
+        }
+        result.add_constraint(ConstraintT(a, b, c_lc));
+    }
+
+    if( flags[1] & CS_CACHE_ANNOTATIONS )
+    {
+        uint64_t n_annotations;
+        if( ! reader.read_u64(n_annotations) ) {
+            return false;
+        }
+        for( uint64_t i = 0; i < n_annotations; i++ )
+        {
+            uint64_t index, length;
+            if( ! reader.read_u64(index) || ! reader.read_u64(length) ) {
+                return false;
+            }
+            std::string annotation(length, '\0');
+            if( ! reader.read(&annotation[0], length) ) {
+                return false;
+            }
+#ifdef DEBUG
+            result.constraint_annotations[index] = annotation;
+#endif
+        }
+    }
+
+    if( ! reader.at_end() ) {
+        return false;
+    }
+
+    cs = std::move(result);
+    return true;
+}
+
+// namespace ethsnarks
+}
@@ -0,0 +1,44 @@
+#ifndef ETHSNARKS_CS_CACHE_HPP_
+#define ETHSNARKS_CS_CACHE_HPP_
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Binary cache of a compiled constraint system
+*
+* Building the gadget tree only to emit the same constraints on every proof
+* is slow for large circuits. The cache stores the input sizes and every
+* constraint (as variable index, coefficient terms), and optionally the
+* constraint annotations of DEBUG builds. It's keyed by a hash of the
+* circuit, the cache format and the version of the code which emits the
+* constraints, a cache for any other circuit or build is ignored.
+*/
+static const size_t CS_CACHE_HASH_SIZE = 32;
+
+typedef libsnark::r1cs_constraint_system<FieldT> ConstraintSystemT;
+
+/**
+* BLAKE2b of a file, e.g. the circuit definition, with the cache version and
+* the `layout_version` of the constraints made from it
+*/
+bool cs_cache_hash_file( const char *path, uint8_t hash[CS_CACHE_HASH_SIZE], uint32_t layout_version );
+
+/** The cache lives next to the circuit file */
+std::string cs_cache_path( const char *circuit_file );
+
+bool cs_cache_save( const char *cache_file, const uint8_t hash[CS_CACHE_HASH_SIZE], const ConstraintSystemT& cs, bool annotations = false );
+
+/**
+* Returns false if the file is missing, corrupt or for a different hash,
+* the hash isn't checked if it's null
+*/
+bool cs_cache_load( const char *cache_file, const uint8_t hash[CS_CACHE_HASH_SIZE], ConstraintSystemT& cs );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_CS_CACHE_HPP_
+#endif
@@ -0,0 +1,103 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+#include "cs_check.hpp"
+
+
+namespace ethsnarks {
+
+// Constraints per block, small enough to stop soon after a failure
+static const size_t CS_CHECK_BLOCK = 1 << 12;
+
+
+FieldT cs_evaluate_lc( const libsnark::linear_combination_light<FieldT>& lc, const std::vector<FieldT>& values )
+{
+    FieldT acc = FieldT::zero();
+    for( const libsnark::linear_term_light<FieldT>& lt : lc.getTerms() ) {
+        acc += lt.getCoeff() * values[lt.index];
+    }
+    return acc;
+}
+
+
+size_t cs_first_unsatisfied( const ConstraintSystemT& cs, const std::vector<FieldT>& values, unsigned int num_threads )
+{
+    const size_t n = cs.num_constraints();
+    const size_t num_blocks = (n + CS_CHECK_BLOCK - 1) / CS_CHECK_BLOCK;
+    std::atomic<size_t> first(n);
+
+#ifdef MULTICORE
+    if( num_threads == 0 ) {
+        num_threads = omp_get_max_threads();
+    }
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+#else
+    (void)num_threads;
+#endif
+    for( size_t block = 0; block < num_blocks; block++ )
+    {
+        const size_t begin = block * CS_CHECK_BLOCK;
+        const size_t end = std::min(begin + CS_CHECK_BLOCK, n);
+        for( size_t i = begin; i < end && i < first.load(std::memory_order_relaxed); i++ )
+        {
+            const auto& constraint = *cs.constraints[i];
+            const FieldT a = cs_evaluate_lc(constraint.getA(), values);
+            const FieldT b = cs_evaluate_lc(constraint.getB(), values);
+            if( a * b == cs_evaluate_lc(constraint.getC(), values) ) {
+                continue;
+            }
+
+            size_t current = first.load();
+            while( i < current && ! first.compare_exchange_weak(current, i) ) {}
+            break;
+        }
+    }
+
+    return first;
+}
+
+
+std::string cs_constraint_annotation( const ConstraintSystemT& cs, size_t index )
+{
+#ifdef DEBUG
+    const auto it = cs.constraint_annotations.find(index);
+    if( it != cs.constraint_annotations.end() ) {
+        return it->second;
+    }
+#else
+    (void)cs;
+    (void)index;
+#endif
+    return std::string();
+}
+
+
+bool cs_check_protoboard( const ProtoboardT& pb, unsigned int num_threads )
+{
+    const auto& cs = pb.constraint_system;
+    if( pb.values.size() != cs.num_variables() + 1 ) {
+        std::cerr << "Error: " << pb.values.size() << " values for " << cs.num_variables() << " variables" << std::endl;
+        return false;
+    }
+
+    const size_t failed = cs_first_unsatisfied(cs, pb.values, num_threads);
+    if( failed == cs.num_constraints() ) {
+        return true;
+    }
+
+    const auto annotation = cs_constraint_annotation(cs, failed);
+    std::cerr << "Constraint " << failed << " not satisfied" << (annotation.empty() ? "" : ": ") << annotation << std::endl;
+    return false;
+}
+
+
+// namespace ethsnarks
+}
@@ -0,0 +1,42 @@
+#ifndef ETHSNARKS_CS_CHECK_HPP_
+#define ETHSNARKS_CS_CHECK_HPP_
+
+#include "cs_cache.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Parallel check that an assignment satisfies a constraint system
+*
+* pb.is_satisfied() evaluates every constraint on one thread, which takes
+* seconds for millions of constraints. This splits the constraints into
+* blocks shared by the threads, and stops at the first constraint which
+* isn't satisfied: blocks after it aren't started. The prover does the same
+* check as it evaluates the constraints, see ProverContext::check_satisfied.
+*/
+
+/** A linear combination at the full variable assignment, whose index 0 is ONE */
+FieldT cs_evaluate_lc( const libsnark::linear_combination_light<FieldT>& lc, const std::vector<FieldT>& values );
+
+/**
+* Returns the index of the first constraint which isn't satisfied by the
+* full variable assignment, or cs.num_constraints() if they all are.
+* Threads default to omp_get_max_threads().
+*/
+size_t cs_first_unsatisfied( const ConstraintSystemT& cs, const std::vector<FieldT>& values, unsigned int num_threads = 0 );
+
+/** The annotation of a constraint, empty unless it's a DEBUG build */
+std::string cs_constraint_annotation( const ConstraintSystemT& cs, size_t index );
+
+/**
+* Like pb.is_satisfied(), in parallel, printing the first constraint which
+* isn't satisfied and its annotation to stderr
+*/
+bool cs_check_protoboard( const ProtoboardT& pb, unsigned int num_threads = 0 );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_CS_CHECK_HPP_
+#endif
@@ -0,0 +1,161 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <map>
+
+#include <nlohmann/json.hpp>
+
+#include "cs_memory.hpp"
+
+using json = nlohmann::json;
+
+
+namespace ethsnarks {
+
+// Colour, parent, left and right of a red-black tree node
+static const size_t CS_MEMORY_MAP_NODE_BYTES = 4 * sizeof(void*);
+
+
+size_t CSMemoryReport::context_bytes() const
+{
+    return context_witness_map_bytes + context_scratch_bytes + context_msm_bytes + context_fixed_base_bytes;
+}
+
+
+size_t CSMemoryReport::total_bytes() const
+{
+    return constraint_bytes + annotation_bytes + value_bytes + pk_bytes + context_bytes();
+}
+
+
+static size_t annotations_bytes( const std::map<size_t, std::string>& annotations )
+{
+    size_t n = 0;
+    for( const auto& it : annotations ) {
+        n += CS_MEMORY_MAP_NODE_BYTES + sizeof(it) + it.second.capacity();
+    }
+    return n;
+}
+
+
+void cs_memory_constraints( const ConstraintSystemT& cs, CSMemoryReport& report )
+{
+    report.constraints = cs.num_constraints();
+    report.variables = cs.num_variables();
+    report.inputs = cs.num_inputs();
+    report.terms = 0;
+
+    for( const auto& constraint : cs.constraints )
+    {
+        for( const auto* lc : {&constraint->getA(), &constraint->getB(), &constraint->getC()} ) {
+            report.terms += lc->getTerms().size();
+        }
+    }
+
+    report.constraint_bytes =
+        (cs.constraints.capacity() * sizeof(cs.constraints[0]))
+      + (cs.constraints.size() * sizeof(libsnark::r1cs_constraint_light<FieldT>))
+      + (report.terms * sizeof(libsnark::linear_term_light<FieldT>));
+
+#ifdef DEBUG
+    report.annotation_bytes = annotations_bytes(cs.constraint_annotations) + annotations_bytes(cs.variable_annotations);
+#else
+    report.annotation_bytes = 0;
+#endif
+}
+
+
+void cs_memory_protoboard( const ProtoboardT& pb, CSMemoryReport& report )
+{
+    cs_memory_constraints(pb.constraint_system, report);
+    report.value_bytes = pb.values.capacity() * sizeof(FieldT);
+}
+
+
+size_t cs_memory_domain_size( const CSMemoryReport& report )
+{
+    const size_t min_size = report.constraints + report.inputs + 1;
+    size_t m = 1;
+    while( m < min_size ) {
+        m <<= 1;
+    }
+    return m;
+}
+
+
+void cs_memory_project( CSMemoryReport& report, size_t domain_size, unsigned int fixed_base_c )
+{
+    const size_t m = domain_size ? domain_size : cs_memory_domain_size(report);
+    report.domain_size = m;
+
+    // The A and B queries have one entry per variable, and the constant
+    const size_t n_query = report.variables + 1;
+    const size_t n_H = m - 1;
+    const size_t n_L = report.variables - report.inputs;
+
+    // alpha, beta and delta, then the queries
+    report.pk_G1 = 3 + n_query + n_H + n_L;
+    report.pk_G2 = 2 + n_query;
+    report.pk_bytes =
+        (report.pk_G1 * sizeof(G1T))
+      + (report.pk_G2 * sizeof(G2T))
+      + (2 * n_query * sizeof(size_t));     // sparse A and B indices
+    report.pk_file_bytes = ((report.pk_G1 * G1T::size_in_bits()) + (report.pk_G2 * G2T::size_in_bits()) + 7) / 8;
+
+    // The buffers sized by ProverContext::preallocate() for the serial prover
+    const size_t n_scratch = std::max(n_query, m);
+    report.context_witness_map_bytes = 3 * (m + 1) * sizeof(FieldT);
+    report.context_scratch_bytes = n_scratch * sizeof(LimbT);
+    report.context_msm_bytes = (n_query + n_L) * (sizeof(G1T) + sizeof(FieldT));
+
+    report.context_fixed_base_bytes = 0;
+    if( fixed_base_c ) {
+        report.context_fixed_base_bytes = libsnark::FixedBaseTable<G1T>::size_in_bytes(n_H + n_L, FieldT::size_in_bits(), fixed_base_c);
+    }
+}
+
+
+void cs_memory_proving_key( const ProvingKeyT& pk, CSMemoryReport& report )
+{
+    report.pk_G1 = 3 + pk.A_query.size() + pk.H_query.size() + pk.L_query.size();
+    report.pk_G2 = 2 + pk.B_query.size();
+    report.pk_bytes =
+        (report.pk_G1 * sizeof(G1T))
+      + (report.pk_G2 * sizeof(G2T))
+      + ((pk.A_query.indices.size() + pk.B_query.indices.size()) * sizeof(size_t));
+    report.pk_file_bytes = (pk.size_in_bits() + 7) / 8;
+}
+
+
+void cs_memory_json( const CSMemoryReport& report, std::ostream& out )
+{
+    const json result = {
+        {"constraints", report.constraints},
+        {"variables", report.variables},
+        {"inputs", report.inputs},
+        {"terms", report.terms},
+        {"domain_size", report.domain_size},
+        {"constraint_bytes", report.constraint_bytes},
+        {"annotation_bytes", report.annotation_bytes},
+        {"value_bytes", report.value_bytes},
+        {"proving_key", {
+            {"G1", report.pk_G1},
+            {"G2", report.pk_G2},
+            {"bytes", report.pk_bytes},
+            {"file_bytes", report.pk_file_bytes}
+        }},
+        {"prover_context", {
+            {"witness_map_bytes", report.context_witness_map_bytes},
+            {"scratch_bytes", report.context_scratch_bytes},
+            {"msm_bytes", report.context_msm_bytes},
+            {"fixed_base_bytes", report.context_fixed_base_bytes},
+            {"bytes", report.context_bytes()}
+        }},
+        {"total_bytes", report.total_bytes()}
+    };
+    out << result.dump(2) << std::endl;
+}
+
+// namespace ethsnarks
+}
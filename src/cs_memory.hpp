@@ -0,0 +1,83 @@
+#ifndef ETHSNARKS_CS_MEMORY_HPP_
+#define ETHSNARKS_CS_MEMORY_HPP_
+
+#include <ostream>
+
+#include "cs_cache.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* What a circuit costs in memory, before it's proven
+*
+* The constraint system, the protoboard's values and, in DEBUG builds, the
+* annotations are measured. The proving key and the buffers of a
+* ProverContext after preallocate() are projected from the number of
+* constraints, variables and inputs, and the domain size.
+*
+* Sizes are in bytes and are estimates, container overhead is approximate
+* and instanced constraints are counted as if they had their own terms.
+*/
+struct CSMemoryReport {
+    size_t constraints = 0;
+    size_t variables = 0;
+    size_t inputs = 0;
+    size_t terms = 0;
+
+    size_t constraint_bytes = 0;        // the constraints and their terms
+    size_t annotation_bytes = 0;        // constraint and variable annotations
+    size_t value_bytes = 0;             // the protoboard's assignment
+
+    size_t domain_size = 0;             // 0 until projected
+
+    // Proving key, with dense A and B queries
+    size_t pk_G1 = 0;
+    size_t pk_G2 = 0;
+    size_t pk_bytes = 0;                // in memory
+    size_t pk_file_bytes = 0;           // serialized
+
+    // ProverContext buffers
+    size_t context_witness_map_bytes = 0;   // aA, aB and aH
+    size_t context_scratch_bytes = 0;       // scratch_exponents
+    size_t context_msm_bytes = 0;           // msm bases and scalars, at most
+    size_t context_fixed_base_bytes = 0;    // H and L tables, when fixed_base_c is set
+
+    size_t context_bytes() const;
+
+    /** Everything needed to prove, at the peak */
+    size_t total_bytes() const;
+};
+
+
+/** The constraints, variables, terms and annotations */
+void cs_memory_constraints( const ConstraintSystemT& cs, CSMemoryReport& report );
+
+/** The constraint system and the values of a protoboard */
+void cs_memory_protoboard( const ProtoboardT& pb, CSMemoryReport& report );
+
+/**
+* The smallest radix-2 domain for the constraints and inputs
+*/
+size_t cs_memory_domain_size( const CSMemoryReport& report );
+
+/**
+* Projects the proving key and prover context, for a domain size, or
+* cs_memory_domain_size() when 0. With `fixed_base_c` the H and L tables of
+* ProverContext::precompute_fixed_base() are included. The context is that
+* of the serial prover: the concurrent multi-exps take three more copies of
+* the scratch space, and the batch prover a second witness map.
+*/
+void cs_memory_project( CSMemoryReport& report, size_t domain_size = 0, unsigned int fixed_base_c = 0 );
+
+/** Replaces the projected proving key with the size of a loaded one */
+void cs_memory_proving_key( const ProvingKeyT& pk, CSMemoryReport& report );
+
+/** As a JSON object */
+void cs_memory_json( const CSMemoryReport& report, std::ostream& out );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_CS_MEMORY_HPP_
+#endif
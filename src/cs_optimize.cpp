@@ -0,0 +1,673 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "cs_optimize.hpp"
+
+
+namespace ethsnarks {
+
+struct Term {
+    size_t index;
+    FieldT coeff;
+};
+
+typedef std::vector<Term> Terms;
+
+struct Row {
+    Terms a;
+    Terms b;
+    Terms c;
+    bool removed = false;
+};
+
+
+/** Sort by variable, merge terms of the same variable and drop zeros */
+static void normalize( Terms& terms )
+{
+    std::sort(terms.begin(), terms.end(), [](const Term& x, const Term& y) {
+        return x.index < y.index;
+    });
+
+    size_t n = 0;
+    for( const auto& term : terms )
+    {
+        if( n && terms[n - 1].index == term.index ) {
+            terms[n - 1].coeff += term.coeff;
+        }
+        else {
+            terms[n++] = term;
+        }
+    }
+    terms.resize(n);
+
+    terms.erase(std::remove_if(terms.begin(), terms.end(), [](const Term& x) {
+        return x.coeff == FieldT::zero();
+    }), terms.end());
+}
+
+
+static Terms read_lc( const libsnark::linear_combination_light<FieldT>& lc )
+{
+    Terms out;
+    out.reserve(lc.getTerms().size());
+    for( const libsnark::linear_term_light<FieldT>& lt : lc.getTerms() ) {
+        out.push_back({lt.index, lt.getCoeff()});
+    }
+    normalize(out);
+    return out;
+}
+
+
+static libsnark::linear_combination<FieldT> write_lc( const Terms& terms, const std::vector<size_t>& index )
+{
+    libsnark::linear_combination<FieldT> out;
+    for( const auto& term : terms ) {
+        out.add_term(libsnark::variable<FieldT>(index[term.index]), term.coeff);
+    }
+    return out;
+}
+
+
+/** True if only the constant term is used, its coefficient is `value` */
+static bool is_constant( const Terms& terms, FieldT& value )
+{
+    if( terms.empty() ) {
+        value = FieldT::zero();
+        return true;
+    }
+
+    if( terms.size() == 1 && terms[0].index == 0 ) {
+        value = terms[0].coeff;
+        return true;
+    }
+
+    return false;
+}
+
+
+/** terms += scale * other */
+static void add_scaled( Terms& terms, const Terms& other, const FieldT& scale )
+{
+    for( const auto& term : other ) {
+        terms.push_back({term.index, term.coeff * scale});
+    }
+    normalize(terms);
+}
+
+
+/** Replace the variable with its definition, false if it isn't used */
+static bool substitute( Terms& terms, size_t index, const Terms& definition )
+{
+    const auto it = std::lower_bound(terms.begin(), terms.end(), index, [](const Term& x, size_t i) {
+        return x.index < i;
+    });
+    if( it == terms.end() || it->index != index ) {
+        return false;
+    }
+
+    const FieldT coeff = it->coeff;
+    terms.erase(it);
+    add_scaled(terms, definition, coeff);
+    return true;
+}
+
+
+static bool has_term( const Terms& terms, size_t index )
+{
+    return std::binary_search(terms.begin(), terms.end(), Term{index, FieldT::zero()}, [](const Term& x, const Term& y) {
+        return x.index < y.index;
+    });
+}
+
+
+static bool uses( const Row& row, size_t index )
+{
+    return has_term(row.a, index) || has_term(row.b, index) || has_term(row.c, index);
+}
+
+
+template<typename F>
+static void for_each_index( const Row& row, F f )
+{
+    for( const auto& term : row.a ) { f(term.index); }
+    for( const auto& term : row.b ) { f(term.index); }
+    for( const auto& term : row.c ) { f(term.index); }
+}
+
+
+static uint64_t hash_terms( const Terms& terms )
+{
+    uint64_t h = 14695981039346656037ULL;
+    const auto mix = [&h]( const uint8_t *bytes, size_t size ) {
+        for( size_t i = 0; i < size; i++ ) {
+            h = (h ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+
+    for( const auto& term : terms ) {
+        mix(reinterpret_cast<const uint8_t*>(&term.index), sizeof(term.index));
+        const auto coeff = term.coeff.as_bigint();
+        mix(reinterpret_cast<const uint8_t*>(coeff.data), sizeof(coeff.data));
+    }
+    return h;
+}
+
+
+static bool equal_terms( const Terms& x, const Terms& y )
+{
+    if( x.size() != y.size() ) {
+        return false;
+    }
+    for( size_t i = 0; i < x.size(); i++ ) {
+        if( x[i].index != y[i].index || x[i].coeff != y[i].coeff ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** Replace the variables with known values by their value times the constant term */
+static bool substitute_constants( Terms& terms, const std::vector<bool>& known, const std::vector<FieldT>& value )
+{
+    bool changed = false;
+    for( auto& term : terms ) {
+        if( term.index && known[term.index] ) {
+            term.coeff *= value[term.index];
+            term.index = 0;
+            changed = true;
+        }
+    }
+    if( changed ) {
+        normalize(terms);
+    }
+    return changed;
+}
+
+
+/**
+* Constant propagation: a constraint which is linear once the known values
+* are substituted, and has a single auxiliary variable left, fixes that
+* variable, e.g. `1 * x = 1` or `2 * a * b = a + b - c` with constant bits
+* a and b. Its value is substituted into every constraint which uses it, and
+* those are revisited, so chains of gadgets over constant inputs such as
+* SHA256's message schedule of a padding block are evaluated away. Rows left
+* with only constants are dropped by remove_redundant, or kept if they
+* can't be satisfied.
+*/
+static void fold_constants( std::vector<Row>& rows, size_t primary_size, size_t num_variables, std::vector<bool>& eliminated )
+{
+    std::vector<std::vector<uint32_t>> occurs(num_variables + 1);
+    for( size_t r = 0; r < rows.size(); r++ ) {
+        for_each_index(rows[r], [&](size_t index) {
+            if( index && (occurs[index].empty() || occurs[index].back() != r) ) {
+                occurs[index].push_back(r);
+            }
+        });
+    }
+
+    std::vector<bool> known(num_variables + 1, false);
+    std::vector<FieldT> value(num_variables + 1, FieldT::zero());
+
+    std::vector<size_t> pending(rows.size());
+    for( size_t r = 0; r < rows.size(); r++ ) {
+        pending[r] = rows.size() - 1 - r;
+    }
+    std::vector<bool> queued(rows.size(), true);
+
+    Terms L;
+    while( ! pending.empty() )
+    {
+        const size_t r = pending.back();
+        pending.pop_back();
+        queued[r] = false;
+
+        Row& row = rows[r];
+        if( row.removed ) {
+            continue;
+        }
+        substitute_constants(row.a, known, value);
+        substitute_constants(row.b, known, value);
+        substitute_constants(row.c, known, value);
+
+        FieldT k;
+        L.clear();
+        if( is_constant(row.a, k) ) {
+            add_scaled(L, row.b, k);
+        }
+        else if( is_constant(row.b, k) ) {
+            add_scaled(L, row.a, k);
+        }
+        else {
+            continue;
+        }
+        add_scaled(L, row.c, -FieldT::one());
+
+        // L = coeff * x + constant, with x an auxiliary variable
+        const bool has_constant = ! L.empty() && L[0].index == 0;
+        if( L.size() != (has_constant ? 2 : 1) || L.back().index <= primary_size ) {
+            continue;
+        }
+
+        const size_t x = L.back().index;
+        const FieldT constant = has_constant ? L[0].coeff : FieldT::zero();
+        value[x] = -constant * L.back().coeff.inverse();
+        known[x] = true;
+        eliminated[x] = true;
+        row.removed = true;
+
+        for( const auto s : occurs[x] ) {
+            if( ! queued[s] && ! rows[s].removed ) {
+                queued[s] = true;
+                pending.push_back(s);
+            }
+        }
+        std::vector<uint32_t>().swap(occurs[x]);
+    }
+}
+
+
+/**
+* A linear constraint `k * B = C` (or `A * k = C`) is `L = 0`, where L is
+* `k*B - C`. When L has an auxiliary variable which is used in at most one
+* other constraint, or its definition has at most two terms (e.g. `x + 1`),
+* the variable is replaced by its definition and the constraint is dropped.
+*/
+static void substitute_linear( std::vector<Row>& rows, size_t primary_size, size_t num_variables, std::vector<bool>& eliminated )
+{
+    std::vector<std::vector<uint32_t>> occurs(num_variables + 1);
+    for( size_t r = 0; r < rows.size(); r++ ) {
+        for_each_index(rows[r], [&](size_t index) {
+            if( index && (occurs[index].empty() || occurs[index].back() != r) ) {
+                occurs[index].push_back(r);
+            }
+        });
+    }
+
+    // Rows are visited at most once per stamp, the lists may hold duplicates
+    std::vector<size_t> stamps(rows.size(), 0);
+    size_t stamp = 0;
+
+    Terms L;
+    Terms definition;
+    for( size_t r = 0; r < rows.size(); r++ )
+    {
+        Row& row = rows[r];
+        if( row.removed ) {
+            continue;
+        }
+
+        FieldT k;
+        L.clear();
+        if( is_constant(row.a, k) ) {
+            add_scaled(L, row.b, k);
+        }
+        else if( is_constant(row.b, k) ) {
+            add_scaled(L, row.a, k);
+        }
+        else {
+            continue;
+        }
+        add_scaled(L, row.c, -FieldT::one());
+
+        // Prefer the variable with the fewest other uses, only 2 need counting
+        size_t chosen = 0;
+        size_t chosen_uses = 2;
+        FieldT chosen_coeff;
+        for( const auto& term : L )
+        {
+            if( term.index <= primary_size ) {
+                continue;
+            }
+
+            stamp++;
+            size_t n_uses = 0;
+            for( const auto s : occurs[term.index] ) {
+                if( s != r && stamps[s] != stamp && ! rows[s].removed && uses(rows[s], term.index) ) {
+                    stamps[s] = stamp;
+                    if( ++n_uses > 1 ) {
+                        break;
+                    }
+                }
+            }
+
+            // Short definitions can be substituted anywhere without growing the constraints much
+            if( (n_uses <= 1 || L.size() <= 3) && (! chosen || n_uses < chosen_uses) ) {
+                chosen = term.index;
+                chosen_uses = n_uses;
+                chosen_coeff = term.coeff;
+                if( n_uses == 0 ) {
+                    break;
+                }
+            }
+        }
+
+        if( ! chosen ) {
+            continue;
+        }
+
+        // chosen = -(L - chosen_coeff * chosen) / chosen_coeff
+        const FieldT scale = -(chosen_coeff.inverse());
+        definition.clear();
+        for( const auto& term : L ) {
+            if( term.index != chosen ) {
+                definition.push_back({term.index, term.coeff * scale});
+            }
+        }
+
+        row.removed = true;
+        stamp++;
+        for( const auto s : occurs[chosen] )
+        {
+            if( stamps[s] == stamp || rows[s].removed ) {
+                continue;
+            }
+            stamps[s] = stamp;
+
+            Row& other = rows[s];
+            const bool in_a = substitute(other.a, chosen, definition);
+            const bool in_b = substitute(other.b, chosen, definition);
+            const bool in_c = substitute(other.c, chosen, definition);
+            if( in_a || in_b || in_c ) {
+                for( const auto& term : definition ) {
+                    if( term.index ) {
+                        occurs[term.index].push_back(s);
+                    }
+                }
+            }
+        }
+
+        eliminated[chosen] = true;
+        std::vector<uint32_t>().swap(occurs[chosen]);
+    }
+}
+
+
+/**
+* Drop constraints which always hold, and all but the first of identical ones
+*/
+static void remove_redundant( std::vector<Row>& rows, bool dedup )
+{
+    std::unordered_multimap<uint64_t, size_t> seen;
+
+    for( size_t r = 0; r < rows.size(); r++ )
+    {
+        Row& row = rows[r];
+        if( row.removed ) {
+            continue;
+        }
+
+        FieldT ka, kb, kc;
+        const bool const_a = is_constant(row.a, ka);
+        const bool const_b = is_constant(row.b, kb);
+        if( ((row.a.empty() || row.b.empty()) && row.c.empty())
+         || (const_a && const_b && is_constant(row.c, kc) && ka * kb == kc) ) {
+            row.removed = true;
+            continue;
+        }
+
+        if( ! dedup ) {
+            continue;
+        }
+
+        // A and B commute, so their hashes are combined in either order
+        const uint64_t h = ((hash_terms(row.a) + hash_terms(row.b)) * 1099511628211ULL) ^ hash_terms(row.c);
+        const auto range = seen.equal_range(h);
+        bool duplicate = false;
+        for( auto it = range.first; it != range.second && ! duplicate; ++it )
+        {
+            const Row& other = rows[it->second];
+            duplicate = equal_terms(row.c, other.c)
+                     && ((equal_terms(row.a, other.a) && equal_terms(row.b, other.b))
+                      || (equal_terms(row.a, other.b) && equal_terms(row.b, other.a)));
+        }
+
+        if( duplicate ) {
+            row.removed = true;
+        }
+        else {
+            seen.emplace(h, r);
+        }
+    }
+}
+
+
+/** The auxiliary variable which only the C side of the row uses, and no other row, or 0 */
+static size_t defined_variable( const Row& row, size_t primary_size, const std::vector<size_t>& n_rows )
+{
+    for( const auto& term : row.c )
+    {
+        if( term.index > primary_size && n_rows[term.index] == 1
+         && ! has_term(row.a, term.index) && ! has_term(row.b, term.index) ) {
+            return term.index;
+        }
+    }
+    return 0;
+}
+
+
+/**
+* Remove dead definitions, constraints `A * B = k*x + C` where the auxiliary
+* variable x is in no other constraint. Whatever the other variables are, x
+* can be chosen to satisfy it, so it constrains nothing. Removing one can
+* leave another definition dead, they're revisited until none are left.
+*
+* Constraints which only assert a relation are never removed, even if no
+* primary input is connected to them, e.g. a range check or `H(s) == k` of
+* private variables: without them the statement isn't enforced.
+*/
+static void remove_dead_definitions( std::vector<Row>& rows, size_t primary_size, size_t num_variables )
+{
+    std::vector<std::vector<uint32_t>> occurs(num_variables + 1);
+    std::vector<size_t> n_rows(num_variables + 1, 0);
+    for( size_t r = 0; r < rows.size(); r++ ) {
+        if( rows[r].removed ) {
+            continue;
+        }
+        for_each_index(rows[r], [&](size_t index) {
+            if( index && (occurs[index].empty() || occurs[index].back() != r) ) {
+                occurs[index].push_back(r);
+                n_rows[index]++;
+            }
+        });
+    }
+
+    std::vector<size_t> pending(rows.size());
+    for( size_t r = 0; r < rows.size(); r++ ) {
+        pending[r] = rows.size() - 1 - r;
+    }
+
+    std::vector<size_t> indices;
+    while( ! pending.empty() )
+    {
+        const size_t r = pending.back();
+        pending.pop_back();
+
+        Row& row = rows[r];
+        if( row.removed || ! defined_variable(row, primary_size, n_rows) ) {
+            continue;
+        }
+        row.removed = true;
+
+        // Variables are counted once per row, however many sides use them
+        indices.clear();
+        for_each_index(row, [&](size_t index) {
+            if( index ) {
+                indices.push_back(index);
+            }
+        });
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+        // A variable left in one row may make that row a dead definition
+        for( const auto index : indices ) {
+            if( --n_rows[index] == 1 ) {
+                for( const auto s : occurs[index] ) {
+                    if( ! rows[s].removed ) {
+                        pending.push_back(s);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void cs_optimize( const ConstraintSystemT& cs, ConstraintSystemT& out, CSRemap& remap, const CSOptimizeOptions& options )
+{
+    const size_t primary_size = cs.primary_input_size;
+    const size_t num_variables = cs.primary_input_size + cs.auxiliary_input_size;
+
+    std::vector<Row> rows(cs.num_constraints());
+    for( size_t r = 0; r < rows.size(); r++ )
+    {
+        rows[r].a = read_lc(cs.constraints[r]->getA());
+        rows[r].b = read_lc(cs.constraints[r]->getB());
+        rows[r].c = read_lc(cs.constraints[r]->getC());
+    }
+
+    std::vector<bool> eliminated(num_variables + 1, false);
+    if( options.fold_constants ) {
+        fold_constants(rows, primary_size, num_variables, eliminated);
+    }
+
+    if( options.substitute ) {
+        substitute_linear(rows, primary_size, num_variables, eliminated);
+    }
+
+    remove_redundant(rows, options.dedup);
+
+    if( options.dead_definitions ) {
+        remove_dead_definitions(rows, primary_size, num_variables);
+    }
+
+    // Primary inputs keep their indices, the remaining variables are renumbered in order
+    std::vector<bool> used(num_variables + 1, false);
+    for( const auto& row : rows ) {
+        if( ! row.removed ) {
+            for_each_index(row, [&](size_t index) {
+                used[index] = true;
+            });
+        }
+    }
+
+    remap.index.assign(num_variables + 1, CS_REMOVED);
+    size_t next_index = 0;
+    for( size_t i = 0; i <= num_variables; i++ ) {
+        if( i <= primary_size || (used[i] && ! eliminated[i]) ) {
+            remap.index[i] = next_index++;
+        }
+    }
+    remap.num_variables = next_index - 1;
+    remap.removed_variables = num_variables - remap.num_variables;
+
+    ConstraintSystemT result;
+    result.primary_input_size = primary_size;
+    result.auxiliary_input_size = remap.num_variables - primary_size;
+
+    remap.removed_constraints = 0;
+    for( size_t r = 0; r < rows.size(); r++ )
+    {
+        const auto& row = rows[r];
+        if( row.removed ) {
+            remap.removed_constraints++;
+            continue;
+        }
+
+        result.add_constraint(ConstraintT(write_lc(row.a, remap.index), write_lc(row.b, remap.index), write_lc(row.c, remap.index)));
+
+#ifdef DEBUG
+        const auto it = cs.constraint_annotations.find(r);
+        if( it != cs.constraint_annotations.end() ) {
+            result.constraint_annotations[result.num_constraints() - 1] = it->second;
+        }
+#endif
+    }
+
+    out = std::move(result);
+}
+
+
+void cs_reorder( const ConstraintSystemT& cs, ConstraintSystemT& out, CSRemap& remap )
+{
+    const size_t primary_size = cs.primary_input_size;
+    const size_t num_variables = cs.primary_input_size + cs.auxiliary_input_size;
+
+    std::vector<bool> in_a(num_variables + 1, false);
+    std::vector<bool> in_b(num_variables + 1, false);
+    std::vector<size_t> first_use(num_variables + 1, cs.num_constraints());
+
+    std::vector<Row> rows(cs.num_constraints());
+    for( size_t r = 0; r < rows.size(); r++ )
+    {
+        Row& row = rows[r];
+        row.a = read_lc(cs.constraints[r]->getA());
+        row.b = read_lc(cs.constraints[r]->getB());
+        row.c = read_lc(cs.constraints[r]->getC());
+
+        for( const auto& term : row.a ) { in_a[term.index] = true; }
+        for( const auto& term : row.b ) { in_b[term.index] = true; }
+        for_each_index(row, [&](size_t index) {
+            first_use[index] = std::min(first_use[index], r);
+        });
+    }
+
+    // A only, A and B, B only, neither
+    const auto group = [&]( size_t i ) {
+        return in_a[i] ? (in_b[i] ? 1 : 0) : (in_b[i] ? 2 : 3);
+    };
+
+    std::vector<size_t> order;
+    order.reserve(num_variables - primary_size);
+    for( size_t i = primary_size + 1; i <= num_variables; i++ ) {
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) {
+        const int gx = group(x);
+        const int gy = group(y);
+        return gx != gy ? gx < gy : first_use[x] < first_use[y];
+    });
+
+    remap.index.resize(num_variables + 1);
+    for( size_t i = 0; i <= primary_size; i++ ) {
+        remap.index[i] = i;
+    }
+    for( size_t k = 0; k < order.size(); k++ ) {
+        remap.index[order[k]] = primary_size + 1 + k;
+    }
+    remap.num_variables = num_variables;
+    remap.removed_constraints = 0;
+    remap.removed_variables = 0;
+
+    ConstraintSystemT result;
+    result.primary_input_size = primary_size;
+    result.auxiliary_input_size = cs.auxiliary_input_size;
+    for( size_t r = 0; r < rows.size(); r++ )
+    {
+        const auto& row = rows[r];
+        result.add_constraint(ConstraintT(write_lc(row.a, remap.index), write_lc(row.b, remap.index), write_lc(row.c, remap.index)));
+    }
+
+#ifdef DEBUG
+    result.constraint_annotations = cs.constraint_annotations;
+#endif
+
+    out = std::move(result);
+}
+
+
+void cs_remap_assignment( const CSRemap& remap, const std::vector<FieldT>& in, std::vector<FieldT>& out )
+{
+    out.resize(remap.num_variables);
+    for( size_t i = 1; i < remap.index.size() && i <= in.size(); i++ ) {
+        if( remap.index[i] != CS_REMOVED ) {
+            out[remap.index[i] - 1] = in[i - 1];
+        }
+    }
+}
+
+// namespace ethsnarks
+}
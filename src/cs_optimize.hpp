@@ -0,0 +1,89 @@
+#ifndef ETHSNARKS_CS_OPTIMIZE_HPP_
+#define ETHSNARKS_CS_OPTIMIZE_HPP_
+
+#include "cs_cache.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Post-processing of a constraint system before key generation
+*
+* Gadget compositions and jsnark circuits often emit duplicate constraints,
+* plain linear aliases (`1 * (x + y) = z`), constraints over constants and
+* definitions of variables which nothing uses. The optimizer removes them and
+* renumbers the remaining variables, primary inputs keep their indices.
+* Witnesses are made for the original system, then mapped to the new
+* layout with cs_remap_assignment.
+*/
+struct CSOptimizeOptions {
+    /**
+    * Evaluate away constraints over variables whose values are fixed by
+    * other constraints, e.g. bits made with VariableArray_from_constant_bits
+    */
+    bool fold_constants = true;
+
+    /** Substitute away linear constraints defining a variable used once more, or by a short definition */
+    bool substitute = true;
+
+    /** Merge identical constraints, `A * B` and `B * A` are identical */
+    bool dedup = true;
+
+    /**
+    * Remove constraints defining an auxiliary variable no other constraint
+    * uses, `A * B = k*x + C` with x only in C, which any values satisfy.
+    * Constraints which assert a relation are kept even when no primary
+    * input is connected to them, removing those would stop the statement
+    * being enforced.
+    */
+    bool dead_definitions = true;
+};
+
+
+static const size_t CS_REMOVED = ~size_t(0);
+
+/**
+* Layout of an optimized constraint system relative to the original
+*/
+struct CSRemap {
+    /** New index of each original variable, or CS_REMOVED. Indexed from the constant term, 0 */
+    std::vector<size_t> index;
+
+    size_t num_variables = 0;
+    size_t removed_constraints = 0;
+    size_t removed_variables = 0;
+};
+
+
+void cs_optimize( const ConstraintSystemT& cs, ConstraintSystemT& out, CSRemap& remap, const CSOptimizeOptions& options = CSOptimizeOptions() );
+
+/**
+* Renumber the auxiliary variables so the non-zero entries of the proving
+* key's queries are contiguous, without changing the constraints
+*
+* Variables are assigned in the order gadgets make them, so those used in
+* the A and B sides of constraints, which have A and B query entries, are
+* scattered amongst those only used in C. The prover then gathers the
+* witness for the sparse multi-exps from all over the assignment. After
+* reordering the variables only in A come first, then those in A and B,
+* then only in B, then the rest, so the A and the B query each cover one
+* range of the witness. Within each group variables are in the order of
+* the constraint which uses them first, keeping the variables the witness
+* map reads together next to each other, and the L query in the same order.
+*
+* Primary inputs keep their indices. Keys must be generated for the
+* reordered system, and witnesses mapped to it with cs_remap_assignment.
+*/
+void cs_reorder( const ConstraintSystemT& cs, ConstraintSystemT& out, CSRemap& remap );
+
+/**
+* Map a full variable assignment of the original system (without the
+* constant term, as in `protoboard::values`) to the optimized layout
+*/
+void cs_remap_assignment( const CSRemap& remap, const std::vector<FieldT>& in, std::vector<FieldT>& out );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_CS_OPTIMIZE_HPP_
+#endif
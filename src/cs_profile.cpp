@@ -0,0 +1,144 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <fstream>
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+
+#include "cs_profile.hpp"
+
+using json = nlohmann::json;
+
+
+namespace ethsnarks {
+
+static const char CS_PROFILE_UNANNOTATED[] = "(unannotated)";
+
+
+size_t cs_constraint_terms( const ConstraintSystemT& cs, size_t index )
+{
+    const auto& constraint = cs.constraints[index];
+    size_t n = 0;
+    for( const auto* lc : {&constraint->getA(), &constraint->getB(), &constraint->getC()} )
+    {
+        for( const libsnark::linear_term_light<FieldT>& lt : lc->getTerms() ) {
+            if( ! lt.getCoeff().is_zero() ) {
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+
+static std::string profile_key( const std::string& annotation, size_t depth )
+{
+    if( annotation.empty() ) {
+        return CS_PROFILE_UNANNOTATED;
+    }
+
+    if( depth == 0 ) {
+        return annotation;
+    }
+
+    size_t n = 0;
+    for( size_t i = 0; i < annotation.size(); i++ )
+    {
+        if( (annotation[i] == '.' || annotation[i] == ' ') && ++n == depth ) {
+            return annotation.substr(0, i);
+        }
+    }
+    return annotation;
+}
+
+
+void cs_profile_annotations( const ConstraintSystemT& cs, size_t depth, CSProfile& profile )
+{
+    for( size_t c = 0; c < cs.num_constraints(); c++ )
+    {
+        std::string annotation;
+#ifdef DEBUG
+        const auto it = cs.constraint_annotations.find(c);
+        if( it != cs.constraint_annotations.end() ) {
+            annotation = it->second;
+        }
+#endif
+        auto& entry = profile[profile_key(annotation, depth)];
+        entry.count++;
+        entry.constraints++;
+        entry.terms += cs_constraint_terms(cs, c);
+    }
+
+#ifdef DEBUG
+    for( size_t i = 1; i <= cs.num_variables(); i++ )
+    {
+        const auto it = cs.variable_annotations.find(i);
+        profile[profile_key(it == cs.variable_annotations.end() ? "" : it->second, depth)].variables++;
+    }
+#else
+    if( cs.num_variables() ) {
+        profile[CS_PROFILE_UNANNOTATED].variables += cs.num_variables();
+    }
+#endif
+}
+
+
+void cs_profile_json( const CSProfile& profile, std::ostream& out )
+{
+    json result = json::object();
+    for( const auto& it : profile )
+    {
+        result[it.first] = {
+            {"count", it.second.count},
+            {"constraints", it.second.constraints},
+            {"variables", it.second.variables},
+            {"terms", it.second.terms},
+            {"witness_seconds", it.second.witness_seconds}
+        };
+    }
+    out << result.dump(2) << std::endl;
+}
+
+
+void cs_profile_folded( const CSProfile& profile, std::ostream& out )
+{
+    for( const auto& it : profile )
+    {
+        if( ! it.second.constraints ) {
+            continue;
+        }
+
+        std::string stack = it.first;
+        for( auto& ch : stack ) {
+            if( ch == '.' || ch == ' ' ) {
+                ch = ';';
+            }
+        }
+        out << stack << " " << it.second.constraints << "\n";
+    }
+    out.flush();
+}
+
+
+bool cs_profile_write( const CSProfile& profile, const char *path )
+{
+    std::ofstream out(path);
+    if( ! out.good() ) {
+        std::cerr << "Unable to open " << path << std::endl;
+        return false;
+    }
+
+    const std::string name(path);
+    if( name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0 ) {
+        cs_profile_json(profile, out);
+    }
+    else {
+        cs_profile_folded(profile, out);
+    }
+
+    return out.good();
+}
+
+// namespace ethsnarks
+}
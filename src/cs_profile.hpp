@@ -0,0 +1,80 @@
+#ifndef ETHSNARKS_CS_PROFILE_HPP_
+#define ETHSNARKS_CS_PROFILE_HPP_
+
+#include <chrono>
+#include <map>
+#include <ostream>
+
+#include "cs_cache.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Where the cost of a circuit comes from
+*
+* Each entry counts the constraints, the variables and the non-zero terms
+* of the A, B and C linear combinations attributed to one part of a circuit,
+* an opcode of a jsnark circuit or an annotation prefix of a native one,
+* and the time spent computing its witness.
+*/
+struct CSProfileEntry {
+    size_t count = 0;
+    size_t constraints = 0;
+    size_t variables = 0;
+    size_t terms = 0;
+    double witness_seconds = 0;
+};
+
+typedef std::map<std::string, CSProfileEntry> CSProfile;
+
+
+/** Non-zero terms of a constraint's A, B and C */
+size_t cs_constraint_terms( const ConstraintSystemT& cs, size_t index );
+
+/**
+* Attribute every constraint and variable by its annotation, truncated to
+* the first `depth` components (separated by `.` or ` `), 0 keeps all of it.
+*
+* Annotations are only kept by DEBUG builds, otherwise everything is
+* attributed to `(unannotated)`.
+*/
+void cs_profile_annotations( const ConstraintSystemT& cs, size_t depth, CSProfile& profile );
+
+/** As a JSON object, keyed by name */
+void cs_profile_json( const CSProfile& profile, std::ostream& out );
+
+/**
+* The folded stacks format of flamegraph.pl and speedscope, one line per
+* entry: the name with its components separated by `;`, then the number of
+* constraints.
+*/
+void cs_profile_folded( const CSProfile& profile, std::ostream& out );
+
+/** JSON if the path ends in `.json`, otherwise folded stacks */
+bool cs_profile_write( const CSProfile& profile, const char *path );
+
+
+/**
+* Adds the time until it goes out of scope to an entry's witness_seconds
+*/
+class CSProfileTimer {
+public:
+    CSProfileTimer( CSProfileEntry& in_entry ) :
+        m_entry(in_entry), m_start(std::chrono::steady_clock::now())
+    {}
+
+    ~CSProfileTimer() {
+        m_entry.witness_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+protected:
+    CSProfileEntry& m_entry;
+    const std::chrono::steady_clock::time_point m_start;
+};
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_CS_PROFILE_HPP_
+#endif
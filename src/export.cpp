@@ -1,15 +1,25 @@
 // This is an open source non-commercial project. Dear PVS-Studio, please check it.
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <cassert>
 #include <iomanip>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
 
 
 #include "ethsnarks.hpp"
+#include "export.hpp"
 #include "libff/algebra/curves/mcl_bn128/mcl_bn128_pp.hpp"
 #include "utils.hpp"
+#include "import.hpp"    // parse_bigint
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -17,34 +27,81 @@ using json = nlohmann::json;
 namespace ethsnarks {
 
 
-std::string HexStringFromBigint(LimbT _x){
-    mpz_t value;
-    ::mpz_init(value);
+/**
+* Digits of a bigint, written straight from its limbs into `out`, which must
+* have room for BIGINT_STR_MAX characters, returns how many were written
+*
+* Powers of two are written nibble by nibble, other bases go through
+* mpn_get_str on a copy of the limbs, which it clobbers. Both match
+* mpz_get_str, lower case without leading zeros, but without its
+* allocations, and can be called from any thread.
+*/
+static const size_t BIGINT_STR_MAX = (LimbT::N * GMP_NUMB_BITS) + 1;
 
-    _x.to_mpz(value);
-    char *value_out_hex = mpz_get_str(nullptr, 16, value);
+static size_t format_bigint( const LimbT& value, unsigned int base, char *out )
+{
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    assert( base >= 2 && base <= 36 );
 
-    std::string str(value_out_hex);
+    mp_size_t n = LimbT::N;
+    while( n > 0 && value.data[n - 1] == 0 ) {
+        n--;
+    }
+    if( n == 0 ) {
+        out[0] = '0';
+        return 1;
+    }
 
-    ::mpz_clear(value);
-    ::free(value_out_hex);
+    if( base == 16 )
+    {
+        size_t length = 0;
+        for( mp_size_t i = n; i-- > 0; )
+        {
+            for( int shift = GMP_NUMB_BITS - 4; shift >= 0; shift -= 4 )
+            {
+                const unsigned int digit = (value.data[i] >> shift) & 0xF;
+                if( length != 0 || digit != 0 ) {
+                    out[length++] = digits[digit];
+                }
+            }
+        }
+        return length;
+    }
 
-    return str;
+    mp_limb_t limbs[LimbT::N];
+    std::copy(value.data, value.data + n, limbs);
+    unsigned char *raw = reinterpret_cast<unsigned char*>(out);
+    const size_t length = ::mpn_get_str(raw, base, limbs, n);
+
+    size_t skip = 0;
+    while( skip + 1 < length && raw[skip] == 0 ) {
+        skip++;
+    }
+    for( size_t i = skip; i < length; i++ ) {
+        out[i - skip] = digits[raw[i]];
+    }
+    return length - skip;
 }
 
-std::string bigintToString(LimbT _x, unsigned int base = 10)
-{
-    mpz_t value;
-    ::mpz_init(value);
 
-    _x.to_mpz(value);
-    char *value_out_hex = mpz_get_str(nullptr, base, value);
+static void append_bigint( std::string& out, const LimbT& value, unsigned int base )
+{
+    char buf[BIGINT_STR_MAX];
+    out.append(buf, format_bigint(value, base, buf));
+}
 
-    std::string str(value_out_hex);
 
-    ::mpz_clear(value);
-    ::free(value_out_hex);
+std::string HexStringFromBigint(LimbT _x)
+{
+    std::string str;
+    append_bigint(str, _x, 16);
+    return str;
+}
 
+std::string bigintToString(LimbT _x, unsigned int base)
+{
+    std::string str;
+    append_bigint(str, _x, base);
     return str;
 }
 
@@ -97,51 +154,104 @@ std::string outputPointG2AffineAsHex(G2T _p)
 
 
 std::string proof_to_json(ProofT &proof, PrimaryInputT &input) {
-    std::stringstream ss;
+    std::string out;
 
-    ss << "{\n";
-    ss << " \"A\" :[" << outputPointG1AffineAsHex(proof.g_A) << "],\n";
-    ss << " \"B\"  :[" << outputPointG2AffineAsHex(proof.g_B)<< "],\n";
-    ss << " \"C\"  :[" << outputPointG1AffineAsHex(proof.g_C)<< "],\n";
-    ss << " \"input\" :" << "["; //1 should always be the first variavle passed
+    out += "{\n";
+    out += " \"A\" :[" + outputPointG1AffineAsHex(proof.g_A) + "],\n";
+    out += " \"B\"  :[" + outputPointG2AffineAsHex(proof.g_B) + "],\n";
+    out += " \"C\"  :[" + outputPointG1AffineAsHex(proof.g_C) + "],\n";
+    out += " \"input\" :[";    //1 should always be the first variavle passed
 
     for (size_t i = 0; i < input.size(); ++i)
     {
-        ss << "\"0x" << HexStringFromBigint(input[i].as_bigint()) << "\"";
+        out += "\"0x";
+        append_bigint(out, input[i].as_bigint(), 16);
+        out += '"';
         if ( i < input.size() - 1 ) {
-            ss<< ", ";
+            out += ", ";
+        }
+    }
+    out += "]\n";
+    out += "}";
+
+    return out;
+}
+
+
+std::string prover_stats_to_json( const libsnark::ProverStats& stats )
+{
+    json phases = json::array();
+    for( const auto& phase : stats.phases )
+    {
+        json entry = {
+            {"name", phase.name},
+            {"wall_seconds", phase.wall_seconds},
+            {"cpu_seconds", phase.cpu_seconds},
+            {"bytes", phase.bytes}
+        };
+
+        if( phase.has_counters )
+        {
+            entry["counters"] = {
+                {"instructions", phase.counters.instructions},
+                {"cycles", phase.counters.cycles},
+                {"ipc", phase.counters.ipc()},
+                {"llc_misses", phase.counters.llc_misses},
+                {"dtlb_misses", phase.counters.dtlb_misses}
+            };
         }
+
+        phases.push_back(entry);
     }
-    ss << "]\n";
-    ss << "}";
 
-    ss.rdbuf()->pubseekpos(0, std::ios_base::out);
+    auto split_to_json = []( const libsnark::ProverStats::ScalarSplit& split ) {
+        return json({
+            {"zeros", split.zeros},
+            {"ones", split.ones},
+            {"msm", split.msm}
+        });
+    };
+
+    json out = {
+        {"num_threads", stats.num_threads},
+        {"msm_threads", stats.msm_threads},
+        {"domain_size", stats.domain_size},
+        {"num_variables", stats.num_variables},
+        {"num_inputs", stats.num_inputs},
+        {"num_constraints", stats.num_constraints},
+        {"A_nonzero", stats.A_nonzero},
+        {"B_nonzero", stats.B_nonzero},
+        {"H_size", stats.H_size},
+        {"L_size", stats.L_size},
+        {"A_split", split_to_json(stats.A_split)},
+        {"L_split", split_to_json(stats.L_split)},
+        {"phases", phases}
+    };
 
-    return(ss.str());
+    return out.dump();
 }
 
 
 std::string vk2json(VerificationKeyT &vk )
 {
-    std::stringstream ss;
+    std::string out;
     unsigned icLength = vk.gamma_ABC_g1.rest.indices.size() + 1;
 
-    ss << "{\n";
-    ss << " \"alpha\" :[" << outputPointG1AffineAsHex(vk.alpha_g1) << "],\n";
-    ss << " \"beta\"  :[" << outputPointG2AffineAsHex(vk.beta_g2) << "],\n";
-    ss << " \"gamma\" :[" << outputPointG2AffineAsHex(vk.gamma_g2) << "],\n";
-    ss << " \"delta\" :[" << outputPointG2AffineAsHex(vk.delta_g2)<< "],\n";
+    out += "{\n";
+    out += " \"alpha\" :[" + outputPointG1AffineAsHex(vk.alpha_g1) + "],\n";
+    out += " \"beta\"  :[" + outputPointG2AffineAsHex(vk.beta_g2) + "],\n";
+    out += " \"gamma\" :[" + outputPointG2AffineAsHex(vk.gamma_g2) + "],\n";
+    out += " \"delta\" :[" + outputPointG2AffineAsHex(vk.delta_g2) + "],\n";
 
-    ss <<  "\"gammaABC\" :[[" << outputPointG1AffineAsHex(vk.gamma_ABC_g1.first) << "]";
+    out += "\"gammaABC\" :[[" + outputPointG1AffineAsHex(vk.gamma_ABC_g1.first) + "]";
 
     for (size_t i = 1; i < icLength; ++i)
     {
-        auto vkICi = outputPointG1AffineAsHex(vk.gamma_ABC_g1.rest.values[i - 1]);
-        ss << ",[" <<  vkICi << "]";
+        out += ",[" + outputPointG1AffineAsHex(vk.gamma_ABC_g1.rest.values[i - 1]) + "]";
     }
-    ss << "]";
-    ss << "}";
-    return ss.str();
+    out += "]";
+    out += "}";
+    return out;
 }
 
 
@@ -154,175 +264,675 @@ void vk2json_file(VerificationKeyT &vk, const std::string &path )
     fh.close();
 }
 
-void constraint2json(libsnark::linear_combination_light<FieldT> constraints, std::ofstream &fh)
+/**
+* The JSON exports are formatted by all threads in chunks of JSON_CHUNK_SIZE
+* values or constraints, each batch of chunks is written out in order before
+* the next one is formatted, so memory doesn't grow with the circuit.
+*/
+static const size_t JSON_CHUNK_SIZE = 1 << 12;
+static const size_t JSON_BATCH_CHUNKS = 64;
+
+
+template<typename FormatT>
+static void write_json_chunks( std::ofstream& fh, size_t n, FormatT format )
 {
-    fh << "{";
-    uint count = 0;
-    for (const libsnark::linear_term_light<FieldT>& lt : constraints.getTerms())
+    const size_t n_chunks_total = (n + JSON_CHUNK_SIZE - 1) / JSON_CHUNK_SIZE;
+    std::vector<std::string> chunks;
+    for( size_t batch = 0; batch < n_chunks_total; batch += JSON_BATCH_CHUNKS )
     {
-        if (count != 0)
+        const size_t n_chunks = std::min(JSON_BATCH_CHUNKS, n_chunks_total - batch);
+        chunks.resize(n_chunks);
+
+#ifdef MULTICORE
+        #pragma omp parallel for
+#endif
+        for( size_t k = 0; k < n_chunks; k++ )
         {
-            fh << ",";
+            chunks[k].clear();
+            const size_t begin = (batch + k) * JSON_CHUNK_SIZE;
+            const size_t end = std::min(n, begin + JSON_CHUNK_SIZE);
+            for( size_t i = begin; i < end; i++ ) {
+                format(chunks[k], i);
+            }
+        }
+
+        for( const auto& chunk : chunks ) {
+            fh.write(chunk.data(), chunk.size());
+        }
+    }
+}
+
+
+static void constraint2json( const libsnark::linear_combination_light<FieldT>& constraints, std::string& out )
+{
+    out += '{';
+    bool first = true;
+    for (const libsnark::linear_term_light<FieldT>& lt : constraints.getTerms())
+    {
+        if( ! first ) {
+            out += ',';
         }
-        fh << '"' << lt.index << '"' << ": " << '"' << bigintToString(lt.getCoeff().as_bigint(), 10) << '"';
-        count++;
+        first = false;
+        out += '"';
+        out += std::to_string(lt.index);
+        out += "\": \"";
+        append_bigint(out, lt.getCoeff().as_bigint(), 10);
+        out += '"';
     }
-    fh << "}";
+    out += '}';
 }
 
 bool r1cs2json(libsnark::protoboard<FieldT>& pb, const std::string& path)
 {
     const libsnark::r1cs_constraint_system<FieldT>& constraints = pb.constraint_system;
     std::ofstream fh(path);
+    if( ! fh.is_open() ) {
+        std::cerr << "Cannot open output file: " << path << std::endl;
+        return false;
+    }
+
+    const size_t n_constraints = constraints.num_constraints();
     fh << "{\n";
     fh << " \"nPubInputs\": " << constraints.primary_input_size << ",\n";
     fh << " \"nOutputs\": " << 0 << ",\n";
     fh << " \"nVars\": " << pb.num_variables() + 1 << ",\n";
     fh << " \"nConstraints\": " << pb.num_constraints() << ",\n";
     fh << " \"constraints\": [\n";
-    for (size_t c = 0; c < constraints.num_constraints(); ++c)
+    write_json_chunks(fh, n_constraints, [&]( std::string& out, size_t c ) {
+        out += "  [";
+        constraint2json(constraints.constraints[c]->getA(), out);
+        out += ',';
+        constraint2json(constraints.constraints[c]->getB(), out);
+        out += ',';
+        constraint2json(constraints.constraints[c]->getC(), out);
+        out += (c == n_constraints - 1) ? "]\n" : "],\n";
+    });
+    fh << " ]\n}";
+    fh.close();
+    return ! fh.fail();
+}
+
+bool witness2json(libsnark::protoboard<FieldT>& pb, const std::string& path)
+{
+    std::ofstream fh(path);
+    if( ! fh.is_open() ) {
+        std::cerr << "Cannot open output file: " << path << std::endl;
+        return false;
+    }
+
+    const size_t n_values = pb.num_variables() + 1;
+    fh << "[\n";
+    write_json_chunks(fh, n_values, [&]( std::string& out, size_t i ) {
+        out += " \"";
+        append_bigint(out, pb.val(i).as_bigint(), 10);
+        out += (i < n_values - 1) ? "\",\n" : "\"";
+    });
+    fh << "\n]";
+    fh.close();
+    return ! fh.fail();
+}
+
+/**
+* Binary exports in the circom .r1cs and .wtns layouts
+*
+* Files are a magic, a version and a list of (type, u64 size, data) sections.
+* Integers are little-endian and field elements are 32 byte little-endian in
+* standard (non-Montgomery) form. Constraints are formatted by all threads in
+* batches, each batch is written out before the next one is formatted.
+*/
+static const size_t BIN_FIELD_SIZE = 32;
+static const size_t BIN_BATCH_SIZE = 1 << 16;
+
+
+static void put_u32( std::vector<uint8_t>& out, uint32_t value )
+{
+    for( size_t i = 0; i < 4; i++ ) {
+        out.push_back(uint8_t(value >> (i * 8)));
+    }
+}
+
+
+static void put_u64( std::vector<uint8_t>& out, uint64_t value )
+{
+    for( size_t i = 0; i < 8; i++ ) {
+        out.push_back(uint8_t(value >> (i * 8)));
+    }
+}
+
+
+static void put_bigint( std::vector<uint8_t>& out, const LimbT& value )
+{
+    for( size_t i = 0; i < BIN_FIELD_SIZE; i++ ) {
+        const size_t bit = i * 8;
+        out.push_back(uint8_t(value.data[bit / GMP_NUMB_BITS] >> (bit % GMP_NUMB_BITS)));
+    }
+}
+
+
+static void put_lc( std::vector<uint8_t>& out, const libsnark::linear_combination_light<FieldT>& lc )
+{
+    const auto& terms = lc.getTerms();
+    put_u32(out, terms.size());
+    for( const libsnark::linear_term_light<FieldT>& lt : terms )
+    {
+        put_u32(out, lt.index);
+        put_bigint(out, lt.getCoeff().as_bigint());
+    }
+}
+
+
+static void write_bytes( std::ofstream& fh, const std::vector<uint8_t>& data )
+{
+    fh.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+
+/**
+* Write a section header with a placeholder size, returns its offset
+*/
+static std::streampos begin_section( std::ofstream& fh, uint32_t type )
+{
+    std::vector<uint8_t> header;
+    put_u32(header, type);
+    put_u64(header, 0);
+    write_bytes(fh, header);
+    return fh.tellp();
+}
+
+
+static void end_section( std::ofstream& fh, std::streampos start )
+{
+    const std::streampos end = fh.tellp();
+    std::vector<uint8_t> size;
+    put_u64(size, uint64_t(end - start));
+
+    fh.seekp(start - std::streamoff(8));
+    write_bytes(fh, size);
+    fh.seekp(end);
+}
+
+
+static void write_file_header( std::ofstream& fh, const char *magic, uint32_t version, uint32_t n_sections )
+{
+    std::vector<uint8_t> header(magic, magic + 4);
+    put_u32(header, version);
+    put_u32(header, n_sections);
+    write_bytes(fh, header);
+}
+
+
+bool r1cs2bin(libsnark::protoboard<FieldT>& pb, const std::string& path)
+{
+    const libsnark::r1cs_constraint_system<FieldT>& constraints = pb.constraint_system;
+    std::ofstream fh(path, std::ios::binary | std::ios::trunc);
+    if( ! fh.is_open() ) {
+        std::cerr << "Cannot open output file: " << path << std::endl;
+        return false;
+    }
+
+    const size_t n_wires = pb.num_variables() + 1;
+    const size_t n_public = constraints.primary_input_size;
+    const size_t n_constraints = constraints.num_constraints();
+
+    write_file_header(fh, "r1cs", 1, 3);
+
+    /* Header */
+    std::streampos start = begin_section(fh, 1);
+    std::vector<uint8_t> buffer;
+    put_u32(buffer, BIN_FIELD_SIZE);
+    put_bigint(buffer, FieldT::mod);
+    put_u32(buffer, n_wires);
+    put_u32(buffer, 0);                     // public outputs
+    put_u32(buffer, n_public);
+    put_u32(buffer, n_wires - 1 - n_public);
+    put_u64(buffer, n_wires);               // labels
+    put_u32(buffer, n_constraints);
+    write_bytes(fh, buffer);
+    end_section(fh, start);
+
+    /* Constraints */
+    start = begin_section(fh, 2);
+    std::vector<std::vector<uint8_t>> chunks;
+    for( size_t batch = 0; batch < n_constraints; batch += BIN_BATCH_SIZE )
     {
-        fh << "  [";
-        constraint2json(constraints.constraints[c]->getA(), fh);
-        fh << ",";
-        constraint2json(constraints.constraints[c]->getB(), fh);
-        fh << ",";
-        constraint2json(constraints.constraints[c]->getC(), fh);
-        if (c == constraints.num_constraints() - 1)
+        const size_t batch_end = std::min(n_constraints, batch + BIN_BATCH_SIZE);
+        const size_t n_chunks = (batch_end - batch + 1023) / 1024;
+        chunks.resize(n_chunks);
+
+#ifdef MULTICORE
+        #pragma omp parallel for
+#endif
+        for( size_t k = 0; k < n_chunks; k++ )
         {
-            fh << "]\n";
+            chunks[k].clear();
+            const size_t chunk_end = std::min(batch_end, batch + ((k + 1) * 1024));
+            for( size_t c = batch + (k * 1024); c < chunk_end; c++ )
+            {
+                put_lc(chunks[k], constraints.constraints[c]->getA());
+                put_lc(chunks[k], constraints.constraints[c]->getB());
+                put_lc(chunks[k], constraints.constraints[c]->getC());
+            }
         }
-        else
-        {
-            fh << "],\n";
+
+        for( const auto& chunk : chunks ) {
+            write_bytes(fh, chunk);
         }
     }
-    fh << " ]\n}";
+    end_section(fh, start);
+
+    /* Wire to label map, the labels are the variable indices */
+    start = begin_section(fh, 3);
+    buffer.clear();
+    for( size_t i = 0; i < n_wires; i++ ) {
+        put_u64(buffer, i);
+    }
+    write_bytes(fh, buffer);
+    end_section(fh, start);
+
     fh.close();
-    return true;
+    return ! fh.fail();
 }
 
-bool witness2json(libsnark::protoboard<FieldT>& pb, const std::string& path)
+
+bool witness2wtns(libsnark::protoboard<FieldT>& pb, const std::string& path)
 {
-    std::stringstream ss;
-    std::ofstream fh(path);
-    fh << "[\n";
-    for (size_t i = 0; i <= pb.num_variables(); i++)
+    std::ofstream fh(path, std::ios::binary | std::ios::trunc);
+    if( ! fh.is_open() ) {
+        std::cerr << "Cannot open output file: " << path << std::endl;
+        return false;
+    }
+
+    const size_t n_wires = pb.num_variables() + 1;
+
+    write_file_header(fh, "wtns", 2, 2);
+
+    /* Header */
+    std::streampos start = begin_section(fh, 1);
+    std::vector<uint8_t> buffer;
+    put_u32(buffer, BIN_FIELD_SIZE);
+    put_bigint(buffer, FieldT::mod);
+    put_u32(buffer, n_wires);
+    write_bytes(fh, buffer);
+    end_section(fh, start);
+
+    /* Values, in batches which are converted out of Montgomery form in parallel */
+    start = begin_section(fh, 2);
+    for( size_t batch = 0; batch < n_wires; batch += BIN_BATCH_SIZE )
     {
-        fh << " \"" << bigintToString(pb.val(i).as_bigint(), 10) << '"';
-        if (i < pb.num_variables())
+        const size_t batch_end = std::min(n_wires, batch + BIN_BATCH_SIZE);
+        buffer.resize((batch_end - batch) * BIN_FIELD_SIZE);
+
+#ifdef MULTICORE
+        #pragma omp parallel for
+#endif
+        for( size_t i = batch; i < batch_end; i++ )
         {
-            fh << ",\n";
+            const LimbT value = pb.val(i).as_bigint();
+            uint8_t *out = &buffer[(i - batch) * BIN_FIELD_SIZE];
+            for( size_t j = 0; j < BIN_FIELD_SIZE; j++ ) {
+                const size_t bit = j * 8;
+                out[j] = uint8_t(value.data[bit / GMP_NUMB_BITS] >> (bit % GMP_NUMB_BITS));
+            }
         }
+
+        write_bytes(fh, buffer);
     }
-    fh << "\n]";
+    end_section(fh, start);
+
     fh.close();
-    return true;
+    return ! fh.fail();
 }
 
-G1T readG1(const json& input)
+/**
+* Decode a bellman G1 point from its X, Y, Z coordinate strings
+*/
+static G1T readG1(const std::string *coords)
 {
-    assert(input.size() == 3);
 #ifdef CURVE_ALT_BN128
-    auto x = FqT(input[0].get<std::string>().c_str());
-    auto y = FqT(input[1].get<std::string>().c_str());
-    auto z = FqT(input[2].get<std::string>().c_str());
-    auto g1 = G1T(x, y, z);
-    return g1;
+    return G1T(parse_bigint<FqT>(coords[0]),
+               parse_bigint<FqT>(coords[1]),
+               parse_bigint<FqT>(coords[2]));
 #elif CURVE_MCL_BN128
-    return G1T(input[0].get<std::string>(), input[1].get<std::string>(), input[2].get<std::string>());
+    return G1T(coords[0], coords[1], coords[2]);
 #endif
 }
 
-G2T readG2(const json& input)
+/**
+* Decode a bellman G2 point from its X.c0, X.c1, Y.c0, Y.c1, Z.c0, Z.c1 strings
+*/
+static G2T readG2(const std::string *coords)
 {
-    assert(input.size() == 3);
-    assert(input[0].size() == 2);
-    assert(input[1].size() == 2);
-    assert(input[2].size() == 2);
 #ifdef CURVE_ALT_BN128
-    auto x2 = libff::alt_bn128_Fq2(
-        libff::alt_bn128_Fq(input[0][0].get<std::string>().c_str()),
-        libff::alt_bn128_Fq(input[0][1].get<std::string>().c_str())
-    );
-    auto y2 = libff::alt_bn128_Fq2(
-        libff::alt_bn128_Fq(input[1][0].get<std::string>().c_str()),
-        libff::alt_bn128_Fq(input[1][1].get<std::string>().c_str())
-    );
-    auto z2 = libff::alt_bn128_Fq2(
-        libff::alt_bn128_Fq(input[2][0].get<std::string>().c_str()),
-        libff::alt_bn128_Fq(input[2][1].get<std::string>().c_str())
-    );
-    auto g2 = libff::alt_bn128_G2(x2, y2, z2);
-    return g2;
+    typedef libff::alt_bn128_Fq Fq_T;
+    return G2T(libff::alt_bn128_Fq2(parse_bigint<Fq_T>(coords[0]), parse_bigint<Fq_T>(coords[1])),
+               libff::alt_bn128_Fq2(parse_bigint<Fq_T>(coords[2]), parse_bigint<Fq_T>(coords[3])),
+               libff::alt_bn128_Fq2(parse_bigint<Fq_T>(coords[4]), parse_bigint<Fq_T>(coords[5])));
 #elif CURVE_MCL_BN128
-    return G2T(
-        input[0][0].get<std::string>(), input[0][1].get<std::string>(),
-        input[1][0].get<std::string>(), input[1][1].get<std::string>(),
-        input[2][0].get<std::string>(), input[2][1].get<std::string>()
-    );
+    return G2T(coords[0], coords[1], coords[2], coords[3], coords[4], coords[5]);
 #endif
 }
 
-bool pk_bellman2ethsnarks(const std::string& bellman_pk_file, const std::string& pk_file)
+
+/**
+* Decode `count` points from consecutive groups of coordinate strings, in
+* parallel. Returns false if any coordinate is malformed.
+*/
+template<typename T, size_t N>
+static bool read_points( const std::vector<std::string>& coords, size_t count, std::vector<T>& out, T (*read)(const std::string*) )
 {
-    libsnark::r1cs_gg_ppzksnark_zok_proving_key<ethsnarks::ppT> proving_key;
+    out.resize(count);
+    std::atomic<bool> ok(true);
 
-    // Read the bellman pk JSON file
-    std::ifstream file(bellman_pk_file);
-    if (!file.is_open())
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( size_t i = 0; i < count; i++ ) {
+        try {
+            out[i] = read(&coords[i * N]);
+        }
+        catch( const std::invalid_argument& ) {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+
+/**
+* SAX handler which converts a bellman proving key while it's being parsed
+*
+* Coordinate strings are buffered for a chunk of points at a time, each chunk
+* is decoded in parallel then appended directly to the nozk key sections, so
+* the whole JSON document is never held in memory.
+*/
+class BellmanProvingKeyReader : public nlohmann::json_sax<json>
+{
+public:
+    static const size_t CHUNK_POINTS = 1 << 14;
+
+    ProvingKeyT pk;
+    size_t A_count = 0;
+    size_t C_count = 0;
+    std::vector<bool> B1_nonzero;
+    std::vector<G2T> B2;
+    bool failed = false;
+
+    BellmanProvingKeyReader()
     {
-        std::cerr << "Cannot open input file: " << bellman_pk_file << std::endl;
+        m_coords.reserve(CHUNK_POINTS * 6);
     }
-    json input;
-    file >> input;
-    file.close();
 
-    /* A */
-    for (unsigned int i = 0; i < input["A"].size(); i++)
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+    bool number_integer(number_integer_t) override { return true; }
+    bool number_unsigned(number_unsigned_t) override { return true; }
+    bool number_float(number_float_t, const string_t&) override { return true; }
+
+    bool string(string_t& val) override
+    {
+        if( m_section != NONE ) {
+            m_coords.emplace_back(std::move(val));
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) override
+    {
+        m_depth++;
+        return true;
+    }
+
+    bool end_object() override
+    {
+        m_depth--;
+        return true;
+    }
+
+    bool key(string_t& val) override
+    {
+        if( m_depth != 1 ) {
+            return true;
+        }
+
+        m_section = NONE;
+        if( val == "A" )               m_section = A;
+        else if( val == "B1" )         m_section = B1;
+        else if( val == "B2" )         m_section = B2_section;
+        else if( val == "C" )          m_section = C;
+        else if( val == "hExps" )      m_section = H;
+        else if( val == "vk_alfa_1" )  m_section = VK_ALPHA_1;
+        else if( val == "vk_beta_1" )  m_section = VK_BETA_1;
+        else if( val == "vk_beta_2" )  m_section = VK_BETA_2;
+        else if( val == "vk_delta_1" ) m_section = VK_DELTA_1;
+        else if( val == "vk_delta_2" ) m_section = VK_DELTA_2;
+        return true;
+    }
+
+    bool start_array(std::size_t) override
     {
-        proving_key.A_query.push_back(readG1(input["A"][i]));
+        m_depth++;
+        return true;
     }
 
-    /* B */
-    libsnark::knowledge_commitment_vector<libff::G2<ppT>, libff::G1<ppT>> B_query;
-    B_query.domain_size_ = proving_key.A_query.size();
-    B_query.values.reserve(B_query.domain_size_);
-    B_query.indices.reserve(B_query.domain_size_);
-    for (unsigned int i = 0; i < input["B1"].size(); i++)
+    bool end_array() override
     {
-        auto g1 = readG1(input["B1"][i]);
-        auto g2 = readG2(input["B2"][i]);
-        if (!g1.is_zero())
+        m_depth--;
+
+        if( m_section == NONE ) {
+            return true;
+        }
+
+        if( m_depth == 1 )
+        {
+            // End of a section, or of a single vk point
+            const bool ok = flush();
+            m_section = NONE;
+            return ok;
+        }
+
+        if( m_depth == 2 && is_query() )
         {
-            B_query.values.emplace_back(libsnark::knowledge_commitment<libff::G2<ppT>, libff::G1<ppT>>(g2, g1));
-            B_query.indices.emplace_back(i);
+            // End of one point in a query
+            m_points++;
+            if( m_points == CHUNK_POINTS ) {
+                return flush();
+            }
         }
+
+        return true;
     }
-    proving_key.B_query = B_query;
 
-    /* L */
-    for (unsigned int i = 2; i < input["C"].size(); i++)
+    bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex) override
     {
-        proving_key.L_query.push_back(readG1(input["C"][i]));
+        std::cerr << "Error parsing bellman proving key at " << position << " (" << last_token << "): " << ex.what() << std::endl;
+        failed = true;
+        return false;
     }
 
-    /* H */
-    for (unsigned int i = 0; i < input["hExps"].size(); i++)
+    /**
+    * Convert the collected sections into the final key, the B query only
+    * keeps the G2 points whose G1 counterpart is non-zero
+    */
+    bool finish()
     {
-        proving_key.H_query.push_back(readG1(input["hExps"][i]));
+        if( failed || B1_nonzero.size() != B2.size() ) {
+            return false;
+        }
+
+        pk.A_query.domain_size_ = A_count;
+        pk.B_query.domain_size_ = A_count;
+        for( size_t i = 0; i < B2.size(); i++ )
+        {
+            if( B1_nonzero[i] ) {
+                pk.B_query.indices.emplace_back(i);
+                pk.B_query.values.emplace_back(B2[i]);
+            }
+        }
+
+        B2.clear();
+        B2.shrink_to_fit();
+        return true;
+    }
+
+private:
+    enum Section {
+        NONE, A, B1, B2_section, C, H,
+        VK_ALPHA_1, VK_BETA_1, VK_BETA_2, VK_DELTA_1, VK_DELTA_2
+    };
+
+    Section m_section = NONE;
+    size_t m_depth = 0;
+    size_t m_points = 0;
+    std::vector<std::string> m_coords;
+    std::vector<G1T> m_G1;
+    std::vector<G2T> m_G2;
+
+    bool is_query() const
+    {
+        return m_section == A || m_section == B1 || m_section == B2_section
+            || m_section == C || m_section == H;
+    }
+
+    bool fail( const char *what )
+    {
+        std::cerr << "Invalid point in bellman proving key section: " << what << std::endl;
+        failed = true;
+        return false;
+    }
+
+    bool flush_G1( size_t count )
+    {
+        if( m_coords.size() != count * 3 ) {
+            return false;
+        }
+        return read_points<G1T, 3>(m_coords, count, m_G1, readG1);
     }
 
-    /* vk */
-    proving_key.alpha_g1 = readG1(input["vk_alfa_1"]);
-    proving_key.beta_g1 = readG1(input["vk_beta_1"]);
-    proving_key.beta_g2 = readG2(input["vk_beta_2"]);
-    proving_key.delta_g1 = readG1(input["vk_delta_1"]);
-    proving_key.delta_g2 = readG2(input["vk_delta_2"]);
+    bool flush_G2( size_t count )
+    {
+        if( m_coords.size() != count * 6 ) {
+            return false;
+        }
+        return read_points<G2T, 6>(m_coords, count, m_G2, readG2);
+    }
+
+    /**
+    * Decode the buffered points and append them to the current section
+    */
+    bool flush()
+    {
+        const size_t count = is_query() ? m_points : 1;
+        bool ok = true;
+
+        switch( m_section )
+        {
+        case A:
+            if( (ok = flush_G1(count)) ) {
+                for( size_t i = 0; i < count; i++ ) {
+                    if( ! m_G1[i].is_zero() ) {
+                        pk.A_query.indices.emplace_back(A_count + i);
+                        pk.A_query.values.emplace_back(m_G1[i]);
+                    }
+                }
+                A_count += count;
+            }
+            break;
+        case B1:
+            if( (ok = flush_G1(count)) ) {
+                for( size_t i = 0; i < count; i++ ) {
+                    B1_nonzero.push_back(! m_G1[i].is_zero());
+                }
+            }
+            break;
+        case B2_section:
+            if( (ok = flush_G2(count)) ) {
+                B2.insert(B2.end(), m_G2.begin(), m_G2.begin() + count);
+            }
+            break;
+        case C:
+            // The first two entries correspond to the constant and are skipped
+            if( (ok = flush_G1(count)) ) {
+                for( size_t i = 0; i < count; i++ ) {
+                    if( C_count + i >= 2 ) {
+                        pk.L_query.emplace_back(m_G1[i]);
+                    }
+                }
+                C_count += count;
+            }
+            break;
+        case H:
+            if( (ok = flush_G1(count)) ) {
+                pk.H_query.insert(pk.H_query.end(), m_G1.begin(), m_G1.begin() + count);
+            }
+            break;
+        case VK_ALPHA_1:
+            if( (ok = flush_G1(1)) ) pk.alpha_g1 = m_G1[0];
+            break;
+        case VK_BETA_1:
+            if( (ok = flush_G1(1)) ) pk.beta_g1 = m_G1[0];
+            break;
+        case VK_BETA_2:
+            if( (ok = flush_G2(1)) ) pk.beta_g2 = m_G2[0];
+            break;
+        case VK_DELTA_1:
+            if( (ok = flush_G1(1)) ) pk.delta_g1 = m_G1[0];
+            break;
+        case VK_DELTA_2:
+            if( (ok = flush_G2(1)) ) pk.delta_g2 = m_G2[0];
+            break;
+        case NONE:
+            break;
+        }
 
-    // Write to nozk format immediately
-    auto pk_nozk = ProvingKeyT(proving_key);
-    writeToFile<ProvingKeyT>(pk_file, pk_nozk);
+        m_coords.clear();
+        m_points = 0;
+
+        if( ! ok ) {
+            return fail(section_name());
+        }
+        return true;
+    }
+
+    const char *section_name() const
+    {
+        switch( m_section ) {
+        case A:          return "A";
+        case B1:         return "B1";
+        case B2_section: return "B2";
+        case C:          return "C";
+        case H:          return "hExps";
+        case VK_ALPHA_1: return "vk_alfa_1";
+        case VK_BETA_1:  return "vk_beta_1";
+        case VK_BETA_2:  return "vk_beta_2";
+        case VK_DELTA_1: return "vk_delta_1";
+        case VK_DELTA_2: return "vk_delta_2";
+        case NONE:       break;
+        }
+        return "";
+    }
+};
+
+
+bool pk_bellman2ethsnarks(const std::string& bellman_pk_file, const std::string& pk_file)
+{
+    std::ifstream file(bellman_pk_file);
+    if (!file.is_open())
+    {
+        std::cerr << "Cannot open input file: " << bellman_pk_file << std::endl;
+        return false;
+    }
+
+    // Stream the JSON rather than building the whole tree in memory
+    BellmanProvingKeyReader reader;
+    if (!json::sax_parse(file, &reader) || !reader.finish())
+    {
+        std::cerr << "Cannot convert bellman proving key: " << bellman_pk_file << std::endl;
+        return false;
+    }
+    file.close();
+
+    writeToFile<ProvingKeyT>(pk_file, reader.pk);
 
     return true;
 }
@@ -345,68 +955,692 @@ libff::mcl_bn128_G2 G2T_alt2mcl(const libff::alt_bn128_G2& alt)
     );
 }
 
-bool pk_alt2mcl(const std::string& alt_pk_file, const std::string& mcl_pk_file)
+/**
+* Section by section conversion of proving keys written with writeToFile
+*
+* Points are read `chunk` at a time, converted on all cores and written
+* before the next chunk is read, so only two chunks of points are in memory
+* whatever the size of the key. The layout is that of the key's operator<<:
+* a size on a line of its own, then each point followed by OUTPUT_NEWLINE.
+*/
+static bool read_size( std::istream& in, size_t& out )
 {
-    libff::alt_bn128_pp::init_public_params();
-    auto proving_key = ethsnarks::loadFromFile<libsnark::r1cs_gg_ppzksnark_zok_proving_key<libff::alt_bn128_pp>>(alt_pk_file);
-    typedef libsnark::r1cs_gg_ppzksnark_zok_proving_key<libff::mcl_bn128_pp> MCLProvingKey;
-    MCLProvingKey mlc_proving_key;
+    in >> out;
+    libff::consume_newline(in);
+    return bool(in);
+}
+
+
+template<typename InT, typename OutT, typename ConvertT>
+static bool convert_points( std::istream& in, std::ostream& out, size_t count, size_t chunk, ConvertT convert )
+{
+    std::vector<InT> source;
+    std::vector<OutT> result;
 
-    /* A */
-    for (unsigned int i = 0; i < proving_key.A_query.size(); i++)
+    for( size_t begin = 0; begin < count; begin += chunk )
     {
-        mlc_proving_key.A_query.push_back(G1T_alt2mcl(proving_key.A_query[i]));
+        const size_t n = std::min(chunk, count - begin);
+        source.resize(n);
+        result.resize(n);
+
+        for( auto& point : source ) {
+            in >> point;
+            libff::consume_OUTPUT_NEWLINE(in);
+        }
+        if( ! in ) {
+            return false;
+        }
+
+#ifdef MULTICORE
+        #pragma omp parallel for
+#endif
+        for( size_t i = 0; i < n; i++ ) {
+            result[i] = convert(source[i]);
+        }
+
+        for( const auto& point : result ) {
+            out << point << OUTPUT_NEWLINE;
+        }
     }
 
-    /* B */
-    libsnark::knowledge_commitment_vector<libff::G2<libff::mcl_bn128_pp>, libff::G1<libff::mcl_bn128_pp>> B_query;
-    B_query.domain_size_ = proving_key.B_query.domain_size_;
-    for (unsigned int i = 0; i < proving_key.B_query.values.size(); i++)
-    {
-        auto g1 = G1T_alt2mcl(proving_key.B_query.values[i].h);
-        auto g2 = G2T_alt2mcl(proving_key.B_query.values[i].g);
-        B_query.values.emplace_back(libsnark::knowledge_commitment<libff::G2<libff::mcl_bn128_pp>, libff::G1<libff::mcl_bn128_pp>>(g2, g1));
+    return bool(out);
+}
+
+
+/** A vector of `count` points, preceded by its size */
+template<typename InT, typename OutT, typename ConvertT>
+static bool convert_vector( std::istream& in, std::ostream& out, size_t chunk, ConvertT convert )
+{
+    size_t count;
+    if( ! read_size(in, count) ) {
+        return false;
+    }
+    out << count << "\n";
+    return convert_points<InT, OutT>(in, out, count, chunk, convert);
+}
+
+
+/** The domain size and indices of a sparse vector are copied, its values converted */
+template<typename InT, typename OutT, typename ConvertT>
+static bool convert_sparse_vector( std::istream& in, std::ostream& out, size_t chunk, ConvertT convert )
+{
+    size_t domain_size, n_indices;
+    if( ! read_size(in, domain_size) || ! read_size(in, n_indices) ) {
+        return false;
     }
-    for (unsigned int i = 0; i < proving_key.B_query.indices.size(); i++)
+    out << domain_size << "\n" << n_indices << "\n";
+
+    for( size_t i = 0; i < n_indices; i++ )
     {
-        B_query.indices.emplace_back(proving_key.B_query.indices[i]);
+        size_t index;
+        if( ! read_size(in, index) ) {
+            return false;
+        }
+        out << index << "\n";
+    }
+
+    return convert_vector<InT, OutT>(in, out, chunk, convert);
+}
+
+
+static bool open_conversion( const std::string& in_file, const std::string& out_file, std::ifstream& in, std::ofstream& out )
+{
+    in.open(in_file, std::ios::binary);
+    if( ! in.is_open() ) {
+        std::cerr << "Cannot open input file: " << in_file << std::endl;
+        return false;
+    }
+
+    out.open(out_file, std::ios::binary | std::ios::trunc);
+    if( ! out.is_open() ) {
+        std::cerr << "Cannot open output file: " << out_file << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool pk_alt2mcl(const std::string& alt_pk_file, const std::string& mcl_pk_file, size_t chunk)
+{
+    libff::alt_bn128_pp::init_public_params();
+    libff::mcl_bn128_pp::init_public_params();
+
+    typedef libsnark::knowledge_commitment<libff::alt_bn128_G2, libff::alt_bn128_G1> AltKC;
+    typedef libsnark::knowledge_commitment<libff::mcl_bn128_G2, libff::mcl_bn128_G1> MclKC;
+
+    std::ifstream in;
+    std::ofstream out;
+    if( ! open_conversion(alt_pk_file, mcl_pk_file, in, out) ) {
+        return false;
+    }
+
+    const auto G1 = [](const libff::alt_bn128_G1& p) { return G1T_alt2mcl(p); };
+    const auto G2 = [](const libff::alt_bn128_G2& p) { return G2T_alt2mcl(p); };
+    const auto KC = [](const AltKC& p) { return MclKC(G2T_alt2mcl(p.g), G1T_alt2mcl(p.h)); };
+
+    /* alpha_g1, beta_g1, beta_g2, delta_g1, delta_g2, then A, B, H and L */
+    const bool ok = convert_points<libff::alt_bn128_G1, libff::mcl_bn128_G1>(in, out, 2, chunk, G1)
+                 && convert_points<libff::alt_bn128_G2, libff::mcl_bn128_G2>(in, out, 1, chunk, G2)
+                 && convert_points<libff::alt_bn128_G1, libff::mcl_bn128_G1>(in, out, 1, chunk, G1)
+                 && convert_points<libff::alt_bn128_G2, libff::mcl_bn128_G2>(in, out, 1, chunk, G2)
+                 && convert_vector<libff::alt_bn128_G1, libff::mcl_bn128_G1>(in, out, chunk, G1)
+                 && convert_sparse_vector<AltKC, MclKC>(in, out, chunk, KC)
+                 && convert_vector<libff::alt_bn128_G1, libff::mcl_bn128_G1>(in, out, chunk, G1)
+                 && convert_vector<libff::alt_bn128_G1, libff::mcl_bn128_G1>(in, out, chunk, G1);
+
+    out.close();
+    if( ! ok || out.fail() ) {
+        std::cerr << "Cannot convert proving key: " << alt_pk_file << std::endl;
+        return false;
     }
-    mlc_proving_key.B_query = B_query;
+    return true;
+}
+
+bool pk_mcl2nozk(const std::string& mcl_pk_file, const std::string& nozk_pk_file, size_t chunk)
+{
+    libff::mcl_bn128_pp::init_public_params();
 
-    /* L */
-    for (unsigned int i = 0; i < proving_key.L_query.size(); i++)
+    typedef libff::mcl_bn128_G1 G1;
+    typedef libff::mcl_bn128_G2 G2;
+    typedef libsnark::knowledge_commitment<G2, G1> KC;
+    const auto same_G1 = [](const G1& p) { return p; };
+    const auto same_G2 = [](const G2& p) { return p; };
+
+    std::ifstream in;
+    std::ofstream out;
+    if( ! open_conversion(mcl_pk_file, nozk_pk_file, in, out) ) {
+        return false;
+    }
+
+    bool ok = convert_points<G1, G1>(in, out, 2, chunk, same_G1)
+           && convert_points<G2, G2>(in, out, 1, chunk, same_G2)
+           && convert_points<G1, G1>(in, out, 1, chunk, same_G1)
+           && convert_points<G2, G2>(in, out, 1, chunk, same_G2);
+
+    /* The dense A query becomes a sparse one without its zeros, the indices
+       are written first so the points are read twice */
+    size_t n_A = 0;
+    ok = ok && read_size(in, n_A);
+    const auto A_begin = in.tellg();
+    std::vector<size_t> A_indices;
+    std::vector<G1> points;
+    for( size_t begin = 0; ok && begin < n_A; begin += chunk )
     {
-        mlc_proving_key.L_query.push_back(G1T_alt2mcl(proving_key.L_query[i]));
+        points.resize(std::min(chunk, n_A - begin));
+        for( auto& point : points ) {
+            in >> point;
+            libff::consume_OUTPUT_NEWLINE(in);
+        }
+        ok = bool(in);
+        for( size_t i = 0; ok && i < points.size(); i++ ) {
+            if( points[i] != G1::zero() ) {
+                A_indices.push_back(begin + i);
+            }
+        }
     }
+    points.clear();
 
-    /* H */
-    for (unsigned int i = 0; i < proving_key.H_query.size(); i++)
+    if( ok )
     {
-        mlc_proving_key.H_query.push_back(G1T_alt2mcl(proving_key.H_query[i]));
+        out << n_A << "\n" << A_indices.size() << "\n";
+        for( size_t index : A_indices ) {
+            out << index << "\n";
+        }
+        out << A_indices.size() << "\n";
+
+        in.seekg(A_begin);
+        ok = bool(in);
+        size_t next = 0;
+        for( size_t i = 0; ok && i < n_A; i++ )
+        {
+            G1 point;
+            in >> point;
+            libff::consume_OUTPUT_NEWLINE(in);
+            if( next < A_indices.size() && A_indices[next] == i ) {
+                out << point << OUTPUT_NEWLINE;
+                next++;
+            }
+        }
+        ok = ok && bool(in);
     }
 
-    /* vk */
-    mlc_proving_key.alpha_g1 = G1T_alt2mcl(proving_key.alpha_g1);
-    mlc_proving_key.beta_g1 = G1T_alt2mcl(proving_key.beta_g1);
-    mlc_proving_key.beta_g2 = G2T_alt2mcl(proving_key.beta_g2);
-    mlc_proving_key.delta_g1 = G1T_alt2mcl(proving_key.delta_g1);
-    mlc_proving_key.delta_g2 = G2T_alt2mcl(proving_key.delta_g2);
+    /* Only the G2 half of the B query is kept */
+    ok = ok
+      && convert_sparse_vector<KC, G2>(in, out, chunk, [](const KC& p) { return p.g; })
+      && convert_vector<G1, G1>(in, out, chunk, same_G1)
+      && convert_vector<G1, G1>(in, out, chunk, same_G1);
 
-    ethsnarks::writeToFile<MCLProvingKey>(mcl_pk_file, mlc_proving_key);
+    out.close();
+    if( ! ok || out.fail() ) {
+        std::cerr << "Cannot convert proving key: " << mcl_pk_file << std::endl;
+        return false;
+    }
     return true;
 }
 
-bool pk_mcl2nozk(const std::string& mcl_pk_file, const std::string& nozk_pk_file)
-{   
-    libff::mcl_bn128_pp::init_public_params();
-    typedef libsnark::r1cs_gg_ppzksnark_zok_proving_key<libff::mcl_bn128_pp> MCLProvingKey;
-    MCLProvingKey pk_zk = ethsnarks::loadFromFile<MCLProvingKey>(mcl_pk_file.c_str());
-    using ProvingKeyT_mcl = libsnark::r1cs_gg_ppzksnark_zok_proving_key_nozk<libff::mcl_bn128_pp>; 
-    auto pk_nozk = ProvingKeyT_mcl(pk_zk);
-    writeToFile<ProvingKeyT_mcl>(nozk_pk_file.c_str(), pk_nozk);
+
+/**
+* Compressed proving key encoding
+*
+* Each G1 point is 32 bytes: the big-endian affine x coordinate with the
+* infinity flag in the top bit and the parity of y in the next bit, and each
+* G2 point is 64 bytes (x.c1 then x.c0, flags in the top bits of x.c1).
+* Field elements fit in 254 bits, so the top two bits are always free.
+* On load y is recovered with a square root, in parallel over each query.
+*
+* With mcl the points are mcl's own serialisation, of the same sizes, which
+* keeps its flags in the last byte. There the point at infinity is all zeros.
+*/
+static const char PK_COMPRESSED_MAGIC[8] = {'E', 'S', 'P', 'K', 'C', 'M', 'P', '\0'};
+static const uint32_t PK_COMPRESSED_VERSION = 1;
+static const size_t COMPRESSED_G1_SIZE = 32;
+static const size_t COMPRESSED_G2_SIZE = 64;
+static const uint8_t COMPRESSED_FLAG_INFINITY = 0x80;
+static const uint8_t COMPRESSED_FLAG_ODD = 0x40;
+
+#ifdef CURVE_ALT_BN128
+static void Fq_to_bytes( const FqT& in, uint8_t *out )
+{
+    const auto value = in.as_bigint();
+    for( size_t i = 0; i < 32; i++ ) {
+        const size_t bit = (31 - i) * 8;
+        out[i] = (value.data[bit / GMP_NUMB_BITS] >> (bit % GMP_NUMB_BITS)) & 0xFF;
+    }
+}
+
+static FqT Fq_from_bytes( const uint8_t *in )
+{
+    libff::bigint<FqT::num_limbs> value;
+    for( size_t i = 0; i < 32; i++ ) {
+        const size_t bit = (31 - i) * 8;
+        uint8_t byte = in[i];
+        if( i == 0 ) {
+            byte &= ~(COMPRESSED_FLAG_INFINITY | COMPRESSED_FLAG_ODD);
+        }
+        value.data[bit / GMP_NUMB_BITS] |= mp_limb_t(byte) << (bit % GMP_NUMB_BITS);
+    }
+    return FqT(value);
+}
+
+static bool sqrt_with_parity( const FqT& y2, bool odd, FqT& y )
+{
+    if( ! y2.is_zero() && (y2 ^ FqT::euler) != FqT::one() ) {
+        return false;   // not a quadratic residue, x isn't on the curve
+    }
+    y = y2.sqrt();
+    if( y.as_bigint().test_bit(0) != odd ) {
+        y = -y;
+    }
+    return true;
+}
+
+static bool Fq2_is_odd( const libff::alt_bn128_Fq2& y )
+{
+    return y.c0.is_zero() ? y.c1.as_bigint().test_bit(0) : y.c0.as_bigint().test_bit(0);
+}
+#endif
+
+
+#ifdef CURVE_MCL_BN128
+static bool is_all_zero( const uint8_t *in, size_t n )
+{
+    for( size_t i = 0; i < n; i++ ) {
+        if( in[i] ) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+
+bool G2_in_subgroup( const G2T& point )
+{
+#ifdef CURVE_ALT_BN128
+    // psi(P) = [6x^2]P for exactly the points of order r, p = 6x^2 mod r
+    static const auto six_x_squared = (libff::alt_bn128_Fr(6) * libff::alt_bn128_Fr(libff::alt_bn128_final_exponent_z).squared()).as_bigint();
+    return point.mul_by_q() == six_x_squared * point;
+#elif CURVE_MCL_BN128
+    return point.pt.isValidOrder();
+#endif
+}
+
+
+void compress_G1( const G1T& in, uint8_t *out )
+{
+    ::memset(out, 0, COMPRESSED_G1_SIZE);
+    if( in.is_zero() ) {
+#ifdef CURVE_ALT_BN128
+        out[0] = COMPRESSED_FLAG_INFINITY;
+#endif
+        return;
+    }
+#ifdef CURVE_ALT_BN128
+    auto aff = in;
+    aff.to_affine_coordinates();
+    Fq_to_bytes(aff.X, out);
+    if( aff.Y.as_bigint().test_bit(0) ) {
+        out[0] |= COMPRESSED_FLAG_ODD;
+    }
+#elif CURVE_MCL_BN128
+    // mcl's serialisation is already compressed, in the same 32 bytes
+    in.pt.serialize(out, COMPRESSED_G1_SIZE);
+#endif
+}
+
+
+bool decompress_G1( const uint8_t *in, G1T& out )
+{
+#ifdef CURVE_ALT_BN128
+    if( in[0] & COMPRESSED_FLAG_INFINITY ) {
+        out = G1T::zero();
+        return true;
+    }
+    const FqT x = Fq_from_bytes(in);
+    FqT y;
+    if( ! sqrt_with_parity(x.squared() * x + libff::alt_bn128_coeff_b, (in[0] & COMPRESSED_FLAG_ODD) != 0, y) ) {
+        return false;
+    }
+    out = G1T(x, y, FqT::one());
+    return true;
+#elif CURVE_MCL_BN128
+    if( is_all_zero(in, COMPRESSED_G1_SIZE) ) {
+        out = G1T::zero();
+        return true;
+    }
+    return COMPRESSED_G1_SIZE == out.pt.deserialize(in, COMPRESSED_G1_SIZE);
+#endif
+}
+
+
+void compress_G2( const G2T& in, uint8_t *out )
+{
+    ::memset(out, 0, COMPRESSED_G2_SIZE);
+    if( in.is_zero() ) {
+#ifdef CURVE_ALT_BN128
+        out[0] = COMPRESSED_FLAG_INFINITY;
+#endif
+        return;
+    }
+#ifdef CURVE_ALT_BN128
+    auto aff = in;
+    aff.to_affine_coordinates();
+    Fq_to_bytes(aff.X.c1, out);
+    Fq_to_bytes(aff.X.c0, out + 32);
+    if( Fq2_is_odd(aff.Y) ) {
+        out[0] |= COMPRESSED_FLAG_ODD;
+    }
+#elif CURVE_MCL_BN128
+    in.pt.serialize(out, COMPRESSED_G2_SIZE);
+#endif
+}
+
+
+bool decompress_G2( const uint8_t *in, G2T& out )
+{
+#ifdef CURVE_ALT_BN128
+    if( in[0] & COMPRESSED_FLAG_INFINITY ) {
+        out = G2T::zero();
+        return true;
+    }
+    typedef libff::alt_bn128_Fq2 Fq2T;
+    const Fq2T x(Fq_from_bytes(in + 32), Fq_from_bytes(in));
+    const Fq2T y2 = x.squared() * x + libff::alt_bn128_twist_coeff_b;
+    if( ! y2.is_zero() && (y2 ^ Fq2T::euler) != Fq2T::one() ) {
+        return false;
+    }
+    Fq2T y = y2.sqrt();
+    if( Fq2_is_odd(y) != ((in[0] & COMPRESSED_FLAG_ODD) != 0) ) {
+        y = -y;
+    }
+    out = G2T(x, y, Fq2T::one());
+#elif CURVE_MCL_BN128
+    if( is_all_zero(in, COMPRESSED_G2_SIZE) ) {
+        out = G2T::zero();
+        return true;
+    }
+    if( COMPRESSED_G2_SIZE != out.pt.deserialize(in, COMPRESSED_G2_SIZE) ) {
+        return false;
+    }
+#endif
+    // On the twist isn't enough, G2's cofactor isn't one
+    return G2_in_subgroup(out);
+}
+
+
+template<typename T, size_t N>
+static void write_compressed_points( std::ofstream& fh, const std::vector<T>& points, void (*compress)(const T&, uint8_t*) )
+{
+    std::vector<uint8_t> buffer(points.size() * N);
+
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( size_t i = 0; i < points.size(); i++ ) {
+        compress(points[i], &buffer[i * N]);
+    }
+
+    const uint64_t count = points.size();
+    fh.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    fh.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+}
+
+
+/**
+* Whether `count` items of `size` bytes can follow in the file, so a corrupt
+* count fails to load rather than allocating that many
+*/
+static bool fits_in_file( std::ifstream& fh, uint64_t count, size_t size )
+{
+    const auto pos = fh.tellg();
+    fh.seekg(0, std::ios::end);
+    const auto end = fh.tellg();
+    fh.seekg(pos);
+    return pos >= 0 && end >= pos && count <= uint64_t(end - pos) / size;
+}
+
+
+template<typename T, size_t N>
+static bool read_compressed_points( std::ifstream& fh, std::vector<T>& points, bool (*decompress)(const uint8_t*, T&) )
+{
+    uint64_t count = 0;
+    if( ! fh.read(reinterpret_cast<char*>(&count), sizeof(count)) || ! fits_in_file(fh, count, N) ) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(count * N);
+    if( ! fh.read(reinterpret_cast<char*>(buffer.data()), buffer.size()) ) {
+        return false;
+    }
+
+    points.resize(count);
+    std::atomic<bool> ok(true);
+
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( size_t i = 0; i < count; i++ ) {
+        if( ! decompress(&buffer[i * N], points[i]) ) {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+
+static void write_indices( std::ofstream& fh, uint64_t domain_size, const std::vector<size_t>& indices )
+{
+    const uint64_t count = indices.size();
+    fh.write(reinterpret_cast<const char*>(&domain_size), sizeof(domain_size));
+    fh.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for( const auto idx : indices ) {
+        const uint64_t value = idx;
+        fh.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+}
+
+
+static bool read_indices( std::ifstream& fh, size_t& domain_size, std::vector<size_t>& indices )
+{
+    uint64_t header[2];
+    if( ! fh.read(reinterpret_cast<char*>(header), sizeof(header)) ) {
+        return false;
+    }
+    domain_size = header[0];
+    if( ! fits_in_file(fh, header[1], sizeof(uint64_t)) ) {
+        return false;
+    }
+
+    std::vector<uint64_t> values(header[1]);
+    if( ! fh.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(uint64_t)) ) {
+        return false;
+    }
+    indices.assign(values.begin(), values.end());
     return true;
 }
 
 
+bool pk_nozk2compressed(const std::string& nozk_pk_file, const std::string& compressed_pk_file)
+{
+    const auto pk = ethsnarks::loadFromFile<ProvingKeyT>(nozk_pk_file);
+
+    std::ofstream fh(compressed_pk_file, std::ios::binary | std::ios::trunc);
+    if( ! fh.is_open() ) {
+        std::cerr << "Cannot open output file: " << compressed_pk_file << std::endl;
+        return false;
+    }
+
+    fh.write(PK_COMPRESSED_MAGIC, sizeof(PK_COMPRESSED_MAGIC));
+    fh.write(reinterpret_cast<const char*>(&PK_COMPRESSED_VERSION), sizeof(PK_COMPRESSED_VERSION));
+
+    write_compressed_points<G1T, COMPRESSED_G1_SIZE>(fh, {pk.alpha_g1, pk.beta_g1, pk.delta_g1}, compress_G1);
+    write_compressed_points<G2T, COMPRESSED_G2_SIZE>(fh, {pk.beta_g2, pk.delta_g2}, compress_G2);
+
+    write_indices(fh, pk.A_query.domain_size_, pk.A_query.indices);
+    write_compressed_points<G1T, COMPRESSED_G1_SIZE>(fh, pk.A_query.values, compress_G1);
+
+    write_indices(fh, pk.B_query.domain_size_, pk.B_query.indices);
+    write_compressed_points<G2T, COMPRESSED_G2_SIZE>(fh, pk.B_query.values, compress_G2);
+
+    write_compressed_points<G1T, COMPRESSED_G1_SIZE>(fh, pk.H_query, compress_G1);
+    write_compressed_points<G1T, COMPRESSED_G1_SIZE>(fh, pk.L_query, compress_G1);
+
+    fh.close();
+    return ! fh.fail();
+}
+
+
+bool pk_is_compressed(const std::string& pk_file)
+{
+    std::ifstream fh(pk_file, std::ios::binary);
+    char magic[sizeof(PK_COMPRESSED_MAGIC)];
+    if( ! fh.read(magic, sizeof(magic)) ) {
+        return false;
+    }
+    return 0 == ::memcmp(magic, PK_COMPRESSED_MAGIC, sizeof(magic));
+}
+
+
+bool pk_compressed_load(const std::string& compressed_pk_file, ProvingKeyT& pk)
+{
+    std::ifstream fh(compressed_pk_file, std::ios::binary);
+    if( ! fh.is_open() ) {
+        std::cerr << "Cannot open input file: " << compressed_pk_file << std::endl;
+        return false;
+    }
+
+    char magic[sizeof(PK_COMPRESSED_MAGIC)];
+    uint32_t version = 0;
+    fh.read(magic, sizeof(magic));
+    fh.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if( ! fh || 0 != ::memcmp(magic, PK_COMPRESSED_MAGIC, sizeof(magic)) || version != PK_COMPRESSED_VERSION ) {
+        std::cerr << "Not a compressed proving key: " << compressed_pk_file << std::endl;
+        return false;
+    }
+
+    std::vector<G1T> g1_points;
+    std::vector<G2T> g2_points;
+    if( ! read_compressed_points<G1T, COMPRESSED_G1_SIZE>(fh, g1_points, decompress_G1) || g1_points.size() != 3
+     || ! read_compressed_points<G2T, COMPRESSED_G2_SIZE>(fh, g2_points, decompress_G2) || g2_points.size() != 2 ) {
+        return false;
+    }
+    pk.alpha_g1 = g1_points[0];
+    pk.beta_g1 = g1_points[1];
+    pk.delta_g1 = g1_points[2];
+    pk.beta_g2 = g2_points[0];
+    pk.delta_g2 = g2_points[1];
+
+    return read_indices(fh, pk.A_query.domain_size_, pk.A_query.indices)
+        && read_compressed_points<G1T, COMPRESSED_G1_SIZE>(fh, pk.A_query.values, decompress_G1)
+        && read_indices(fh, pk.B_query.domain_size_, pk.B_query.indices)
+        && read_compressed_points<G2T, COMPRESSED_G2_SIZE>(fh, pk.B_query.values, decompress_G2)
+        && read_compressed_points<G1T, COMPRESSED_G1_SIZE>(fh, pk.H_query, decompress_G1)
+        && read_compressed_points<G1T, COMPRESSED_G1_SIZE>(fh, pk.L_query, decompress_G1);
+}
+
+
+
+/**
+* Binary wire encoding, the same layout as EVM calldata
+*
+* Every coordinate and input is a 32 byte big-endian word, G1 points are
+* (x, y) and G2 points are (x.c1, x.c0, y.c1, y.c0), the point at infinity
+* is all zeros. A proof is A, B, C followed by the inputs, a verification
+* key is alpha, beta, gamma, delta followed by the gammaABC points.
+*/
+template<mp_size_t n>
+static void bigint_to_word( const libff::bigint<n>& in, uint8_t *out )
+{
+    for( size_t i = 0; i < WIRE_WORD_SIZE; i++ ) {
+        const size_t bit = (WIRE_WORD_SIZE - 1 - i) * 8;
+        out[i] = (in.data[bit / GMP_NUMB_BITS] >> (bit % GMP_NUMB_BITS)) & 0xFF;
+    }
+}
+
+
+static void G1_to_words( const G1T& in, uint8_t *out )
+{
+    ::memset(out, 0, WIRE_G1_SIZE);
+    if( in.is_zero() ) {
+        return;
+    }
+    auto aff = in;
+    aff.to_affine_coordinates();
+#ifdef CURVE_ALT_BN128
+    bigint_to_word(aff.X.as_bigint(), out);
+    bigint_to_word(aff.Y.as_bigint(), out + 32);
+#elif CURVE_MCL_BN128
+    bigint_to_word(LimbT(aff.pt.x.getStr().c_str()), out);
+    bigint_to_word(LimbT(aff.pt.y.getStr().c_str()), out + 32);
+#endif
+}
+
+
+static void G2_to_words( const G2T& in, uint8_t *out )
+{
+    ::memset(out, 0, WIRE_G2_SIZE);
+    if( in.is_zero() ) {
+        return;
+    }
+    auto aff = in;
+    aff.to_affine_coordinates();
+#ifdef CURVE_ALT_BN128
+    bigint_to_word(aff.X.c1.as_bigint(), out);
+    bigint_to_word(aff.X.c0.as_bigint(), out + 32);
+    bigint_to_word(aff.Y.c1.as_bigint(), out + 64);
+    bigint_to_word(aff.Y.c0.as_bigint(), out + 96);
+#elif CURVE_MCL_BN128
+    bigint_to_word(LimbT(aff.pt.x.b.getStr().c_str()), out);
+    bigint_to_word(LimbT(aff.pt.x.a.getStr().c_str()), out + 32);
+    bigint_to_word(LimbT(aff.pt.y.b.getStr().c_str()), out + 64);
+    bigint_to_word(LimbT(aff.pt.y.a.getStr().c_str()), out + 96);
+#endif
+}
+
+
+std::string proof_to_bytes( const ProofT& proof, const PrimaryInputT& input )
+{
+    std::string out(WIRE_PROOF_SIZE + (input.size() * WIRE_WORD_SIZE), '\0');
+    auto ptr = reinterpret_cast<uint8_t*>(&out[0]);
+
+    G1_to_words(proof.g_A, ptr);
+    G2_to_words(proof.g_B, ptr + WIRE_G1_SIZE);
+    G1_to_words(proof.g_C, ptr + WIRE_G1_SIZE + WIRE_G2_SIZE);
+    ptr += WIRE_PROOF_SIZE;
+
+    for( const auto& x : input ) {
+        bigint_to_word(x.as_bigint(), ptr);
+        ptr += WIRE_WORD_SIZE;
+    }
+
+    return out;
+}
+
+
+std::string vk_to_bytes( const VerificationKeyT& vk )
+{
+    const size_t n_rest = vk.gamma_ABC_g1.rest.values.size();
+    std::string out(WIRE_VK_SIZE + ((n_rest + 1) * WIRE_G1_SIZE), '\0');
+    auto ptr = reinterpret_cast<uint8_t*>(&out[0]);
+
+    G1_to_words(vk.alpha_g1, ptr);
+    G2_to_words(vk.beta_g2, ptr + WIRE_G1_SIZE);
+    G2_to_words(vk.gamma_g2, ptr + WIRE_G1_SIZE + WIRE_G2_SIZE);
+    G2_to_words(vk.delta_g2, ptr + WIRE_G1_SIZE + (2 * WIRE_G2_SIZE));
+    ptr += WIRE_VK_SIZE;
+
+    G1_to_words(vk.gamma_ABC_g1.first, ptr);
+    ptr += WIRE_G1_SIZE;
+    for( const auto& p : vk.gamma_ABC_g1.rest.values ) {
+        G1_to_words(p, ptr);
+        ptr += WIRE_G1_SIZE;
+    }
+
+    return out;
+}
+
+
 }
 // namespace ethsnarks
@@ -5,8 +5,15 @@
 
 namespace ethsnarks {
 
+/**
+* Digits of a bigint, the same as GMP's mpz_get_str but formatted directly
+* from the limbs, so they're cheap enough to call once per value from any
+* thread, as the bulk exports do
+*/
 std::string HexStringFromBigint( LimbT _x);
 
+std::string bigintToString( LimbT _x, unsigned int base = 10 );
+
 std::string outputPointG1AffineAsHex( G1T _p );
 
 std::string outputPointG2AffineAsHex( G2T _p );
@@ -21,10 +28,53 @@ bool r1cs2json(libsnark::protoboard<FieldT>& pb, const std::string& path);
 
 bool witness2json(libsnark::protoboard<FieldT>& pb, const std::string& path);
 
+/**
+* Binary equivalents of r1cs2json and witness2json, in the circom .r1cs and
+* .wtns layouts
+*/
+bool r1cs2bin(libsnark::protoboard<FieldT>& pb, const std::string& path);
+
+bool witness2wtns(libsnark::protoboard<FieldT>& pb, const std::string& path);
+
+std::string prover_stats_to_json( const libsnark::ProverStats& stats );
+
 bool pk_bellman2ethsnarks(const std::string& bellman_pk_file, const std::string& pk_file);
 
-bool pk_alt2mcl(const std::string& alt_pk_file, const std::string& mcl_pk_file);
-bool pk_mcl2nozk(const std::string& mcl_pk_file, const std::string& nozk_pk_file);
+/**
+* Convert proving keys between curve implementations and to the no-ZK key,
+* streaming `chunk` points at a time and converting each chunk on all
+* cores, so the memory needed doesn't grow with the key
+*/
+static const size_t PK_CONVERT_CHUNK = 1 << 16;
+
+bool pk_alt2mcl(const std::string& alt_pk_file, const std::string& mcl_pk_file, size_t chunk = PK_CONVERT_CHUNK);
+bool pk_mcl2nozk(const std::string& mcl_pk_file, const std::string& nozk_pk_file, size_t chunk = PK_CONVERT_CHUNK);
+
+void compress_G1( const G1T& in, uint8_t *out );
+bool decompress_G1( const uint8_t *in, G1T& out );
+void compress_G2( const G2T& in, uint8_t *out );
+bool decompress_G2( const uint8_t *in, G2T& out );
+
+/** Whether a point of the twist is in G2, the subgroup of order r */
+bool G2_in_subgroup( const G2T& point );
+
+/**
+* Fixed-size binary encoding of proofs and verification keys, with the EVM
+* calldata layout of 32 byte big-endian words, see import.hpp for decoding
+*/
+static const size_t WIRE_WORD_SIZE = 32;
+static const size_t WIRE_G1_SIZE = 2 * WIRE_WORD_SIZE;
+static const size_t WIRE_G2_SIZE = 4 * WIRE_WORD_SIZE;
+static const size_t WIRE_PROOF_SIZE = (2 * WIRE_G1_SIZE) + WIRE_G2_SIZE;   // uint256[8]
+static const size_t WIRE_VK_SIZE = WIRE_G1_SIZE + (3 * WIRE_G2_SIZE);      // uint256[14]
+
+std::string proof_to_bytes( const ProofT& proof, const PrimaryInputT& input );
+
+std::string vk_to_bytes( const VerificationKeyT& vk );
+
+bool pk_nozk2compressed(const std::string& nozk_pk_file, const std::string& compressed_pk_file);
+bool pk_is_compressed(const std::string& pk_file);
+bool pk_compressed_load(const std::string& compressed_pk_file, ProvingKeyT& pk);
 
 }
 
@@ -0,0 +1,41 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "gadgets/batch_inverter.hpp"
+#include "utils.hpp"
+
+
+namespace ethsnarks {
+
+
+void batch_inverter::add( const FieldT& denominator, const CallbackT& callback )
+{
+    m_values.push_back(denominator);
+    m_callbacks.push_back(callback);
+}
+
+
+size_t batch_inverter::size() const
+{
+    return m_values.size();
+}
+
+
+void batch_inverter::run()
+{
+    batch_inverse(m_values, m_scratch);
+
+    for( size_t i = 0; i < m_values.size(); i++ ) {
+        m_callbacks[i](m_values[i]);
+    }
+
+    m_values.clear();
+    m_callbacks.clear();
+}
+
+
+// namespace ethsnarks
+}
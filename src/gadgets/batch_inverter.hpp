@@ -0,0 +1,75 @@
+#ifndef ETHSNARKS_BATCH_INVERTER_HPP_
+#define ETHSNARKS_BATCH_INVERTER_HPP_
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+
+#include <functional>
+
+
+namespace ethsnarks {
+
+
+/**
+* Defers the field inversions of many witnesses into one batch inversion
+*
+* An inversion costs about as much as a hundred multiplications, and gadgets
+* such as IsNonZero or the point adders do one per instance. Instead each
+* instance registers its denominator with a callback which writes the values
+* that depend on the inverse, and `run()` resolves them all with a single
+* inversion and three multiplications per denominator:
+*
+*   batch_inverter inverter;
+*   for( auto& gadget : gadgets ) {
+*       gadget.generate_r1cs_witness(inverter);
+*   }
+*   inverter.run();
+*
+* Only gadgets whose inputs are already known can be added to the same
+* batch, the output of one can't be the input of another until after `run()`.
+*
+* The inverse of zero is given as zero, IsNonZero relies on this.
+*/
+class batch_inverter
+{
+public:
+    typedef std::function<void(const FieldT&)> CallbackT;
+
+    void add( const FieldT& denominator, const CallbackT& callback );
+
+    size_t size() const;
+
+    /**
+    * Invert every denominator, call each callback with its inverse, then
+    * start an empty batch
+    */
+    void run();
+
+protected:
+    std::vector<FieldT> m_values;
+    std::vector<CallbackT> m_callbacks;
+    std::vector<FieldT> m_scratch;
+};
+
+
+/**
+* Generate the witness of independent gadgets with one inversion
+*/
+template<typename T>
+void generate_r1cs_witness_batch( std::vector<T>& gadgets )
+{
+    batch_inverter inverter;
+    for( auto& gadget : gadgets ) {
+        gadget.generate_r1cs_witness(inverter);
+    }
+    inverter.run();
+}
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_BATCH_INVERTER_HPP_
+#endif
@@ -4,6 +4,10 @@
 #include "gadgets/field2bits_strict.hpp"
 #include "utils.hpp"
 
+#include <libff/algebra/fields/field_utils.hpp>
+
+#include <algorithm>
+
 namespace ethsnarks {
 
 
@@ -104,5 +108,154 @@ const VariableArrayT& field2bits_strict::result() const
 }
 
 
+field2bits_strict_batch::field2bits_strict_batch(
+    ProtoboardT& in_pb,
+    const VariableArrayT& in_field_elements,
+    const std::string& annotation_prefix
+) :
+    GadgetT(in_pb, annotation_prefix),
+    m_field_elements(in_field_elements)
+{
+    const auto& largest_bits = largest_value_bits();
+    const size_t last_bit = FieldT::size_in_bits() - 1;
+    assert( largest_bits[last_bit] );
+
+    // Runs are needed for the constant 1 bits between the MSB and the lowest 0
+    size_t n_runs = 0;
+    for( size_t i = lowest_zero_bit() + 1; i < last_bit; i++ )
+    {
+        if( largest_bits[i] ) {
+            n_runs++;
+        }
+    }
+
+    m_bits.reserve(in_field_elements.size());
+    m_runs.reserve(in_field_elements.size());
+    for( size_t i = 0; i < in_field_elements.size(); i++ )
+    {
+        m_bits.emplace_back(make_var_array(in_pb, FieldT::size_in_bits(), pb_annotation(in_pb, this->annotation_prefix, ".bits[%zu]", i)));
+        m_runs.emplace_back(make_var_array(in_pb, n_runs, pb_annotation(in_pb, this->annotation_prefix, ".runs[%zu]", i)));
+    }
+}
+
+
+const libff::bit_vector& field2bits_strict_batch::largest_value_bits()
+{
+    static const libff::bit_vector bits = libff::convert_field_element_to_bit_vector(FieldT::zero() - FieldT::one(), FieldT::size_in_bits());
+    return bits;
+}
+
+
+size_t field2bits_strict_batch::lowest_zero_bit()
+{
+    const auto& largest_bits = largest_value_bits();
+    const auto found = std::find(largest_bits.begin(), largest_bits.end(), false);
+    assert( found != largest_bits.end() );
+    return found - largest_bits.begin();
+}
+
+
+size_t field2bits_strict_batch::size() const
+{
+    return m_bits.size();
+}
+
+
+const VariableArrayT& field2bits_strict_batch::result( size_t i ) const
+{
+    return m_bits[i];
+}
+
+
+void field2bits_strict_batch::generate_r1cs_constraints ()
+{
+    const auto& largest_bits = largest_value_bits();
+    const size_t last_bit = FieldT::size_in_bits() - 1;
+    const size_t lowest_zero = lowest_zero_bit();
+
+    for( size_t j = 0; j < size(); j++ )
+    {
+        const auto& bits = m_bits[j];
+        const auto& runs = m_runs[j];
+
+        for( size_t i = 0; i < bits.size(); i++ )
+        {
+            libsnark::generate_boolean_r1cs_constraint<FieldT>(this->pb, bits[i], FMT(this->annotation_prefix, ".bits[%zu][%zu]", j, i));
+        }
+
+        this->pb.add_r1cs_constraint(
+            ConstraintT(1, libsnark::pb_packing_sum<FieldT>(bits), m_field_elements[j]),
+            FMT(this->annotation_prefix, ".packed[%zu]", j));
+
+        // Iterate from MSB to LSB
+        libsnark::linear_combination<FieldT> run(bits[last_bit]);
+        size_t k = 0;
+        for( size_t i = last_bit; i-- > lowest_zero; )
+        {
+            if( largest_bits[i] )
+            {
+                this->pb.add_r1cs_constraint(
+                    ConstraintT(run, bits[i], runs[k]),
+                    FMT(this->annotation_prefix, ".runs[%zu][%zu] = run * bits[%zu]", j, k, i));
+                run = runs[k++];
+            }
+            else {
+                this->pb.add_r1cs_constraint(
+                    ConstraintT(run, bits[i], 0),
+                    FMT(this->annotation_prefix, ".run * bits[%zu][%zu] = 0", j, i));
+            }
+        }
+    }
+}
+
+
+void field2bits_strict_batch::generate_r1cs_witness ()
+{
+    for( size_t j = 0; j < size(); j++ )
+    {
+        const auto value = this->pb.val(m_field_elements[j]).as_bigint();
+        const auto& bits = m_bits[j];
+
+        // Each limb is shifted out a bit at a time, rather than testing the bits one by one
+        size_t i = 0;
+        for( size_t limb = 0; limb < value.N && i < bits.size(); limb++ )
+        {
+            mp_limb_t word = value.data[limb];
+            for( size_t k = 0; k < GMP_NUMB_BITS && i < bits.size(); k++, i++, word >>= 1 )
+            {
+                this->pb.val(bits[i]) = (word & 1) ? FieldT::one() : FieldT::zero();
+            }
+        }
+    }
+
+    generate_r1cs_witness_from_bits();
+}
+
+
+void field2bits_strict_batch::generate_r1cs_witness_from_bits ()
+{
+    const auto& largest_bits = largest_value_bits();
+    const size_t last_bit = FieldT::size_in_bits() - 1;
+    const size_t lowest_zero = lowest_zero_bit();
+
+    for( size_t j = 0; j < size(); j++ )
+    {
+        const auto& bits = m_bits[j];
+        const auto& runs = m_runs[j];
+
+        FieldT run = this->pb.val(bits[last_bit]);
+        size_t k = 0;
+        for( size_t i = last_bit; i-- > lowest_zero; )
+        {
+            if( largest_bits[i] )
+            {
+                run = run * this->pb.val(bits[i]);
+                this->pb.val(runs[k++]) = run;
+            }
+        }
+    }
+}
+
+
 // namespace ethsnarks
 }
@@ -87,6 +87,69 @@ public:
 };
 
 
+/**
+* Converts many field elements to bits, each strictly less than the modulus
+*
+* The bits of the largest value, `q-1`, are the same for every element, so
+* which bits need an AND and which need a check is worked out once. Starting
+* from the MSB, `run` is 1 while the variable bits equal the bits of `q-1`:
+*
+*   constant bit 1:  run' = run * bit
+*   constant bit 0:  run * bit = 0
+*
+* A bit greater than the constant bit while the bits before are equal is
+* rejected, and once a bit is less `run` stays 0. The runs below the last
+* constant 0 bit aren't needed, this takes one constraint per bit instead of
+* the two of field2bits_strict, plus the booleanity and packing constraints.
+*/
+class field2bits_strict_batch : public GadgetT
+{
+public:
+	const VariableArrayT m_field_elements;
+
+	// Output bits, of each field element
+	std::vector<VariableArrayT> m_bits;
+
+	// Whether the bits equal `q-1` so far, for each constant 1 bit
+	std::vector<VariableArrayT> m_runs;
+
+	field2bits_strict_batch(
+		ProtoboardT& in_pb,
+		const VariableArrayT& in_field_elements,
+		const std::string& annotation_prefix
+	);
+
+	void generate_r1cs_constraints ();
+
+	/**
+	* The bits of each field element are read from the limbs of its value
+	*/
+	void generate_r1cs_witness ();
+
+	/**
+	* The runs, from bits which are already set
+	*/
+	void generate_r1cs_witness_from_bits ();
+
+	size_t size() const;
+
+	/**
+	* Bits of the i'th field element
+	*/
+	const VariableArrayT& result( size_t i ) const;
+
+	/**
+	* Bits of `q-1`, LSB first, shared by every instance
+	*/
+	static const libff::bit_vector& largest_value_bits();
+
+	/**
+	* The lowest constant 0 bit, bits below it aren't compared
+	*/
+	static size_t lowest_zero_bit();
+};
+
+
 // namespace ethsnarks
 }
 
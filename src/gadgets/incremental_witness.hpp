@@ -0,0 +1,181 @@
+#ifndef ETHSNARKS_INCREMENTAL_WITNESS_HPP_
+#define ETHSNARKS_INCREMENTAL_WITNESS_HPP_
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+
+#include <algorithm>
+#include <functional>
+
+
+namespace ethsnarks {
+
+
+/**
+* Recomputes only the witness of the gadgets whose inputs changed
+*
+* Consecutive proofs often differ in a few inputs, e.g. one leaf of a merkle
+* tree. Each gadget is added with the variables it reads and the range of
+* variables it writes, which for ethsnarks gadgets are those allocated by
+* its constructor:
+*
+*   const size_t first = witness.next_variable();
+*   merkle_path_authenticator<HashT> path(pb, ...);
+*   witness.add(path, {leaf, root}, first);
+*
+* Gadgets must be added in the order their witness is generated, as for a
+* full run, each only reads the inputs it's added with. After run() a
+* caller sets new values for some of the inputs, then update() re-runs the
+* gadgets which read a changed variable, in order, and returns the indices
+* of every variable whose value changed. Variable indices are those of the
+* full variable assignment, see the L query of the prover.
+*/
+class incremental_witness
+{
+public:
+    typedef std::function<void()> JobT;
+
+    incremental_witness( ProtoboardT& in_pb ) :
+        m_pb(in_pb),
+        m_num_recomputed(0)
+    { }
+
+    /** The index of the next variable the protoboard will allocate */
+    size_t next_variable() const
+    {
+        return m_pb.num_variables() + 1;
+    }
+
+    /**
+    * A gadget which reads `inputs` and writes the variables allocated since
+    * `first_variable`
+    */
+    template<typename T, typename InputsT>
+    void add( T& gadget, const InputsT& inputs, size_t first_variable )
+    {
+        add_job([&gadget](){ gadget.generate_r1cs_witness(); }, inputs, first_variable, next_variable());
+    }
+
+    template<typename InputsT>
+    void add_job( const JobT& job, const InputsT& inputs, size_t begin_variable, size_t end_variable )
+    {
+        Node node;
+        node.job = job;
+        for( const auto& var : inputs ) {
+            node.inputs.push_back(var.index);
+        }
+        node.begin = begin_variable;
+        node.end = end_variable;
+        m_nodes.emplace_back(std::move(node));
+    }
+
+    size_t size() const
+    {
+        return m_nodes.size();
+    }
+
+    /** Gadgets run by the last run() or update() */
+    size_t num_recomputed() const
+    {
+        return m_num_recomputed;
+    }
+
+    /**
+    * Generate the whole witness and remember the values. Variables which no
+    * gadget writes are the inputs that update() looks for changes in.
+    */
+    void run()
+    {
+        for( const auto& node : m_nodes ) {
+            node.job();
+        }
+        m_num_recomputed = m_nodes.size();
+
+        const size_t n = next_variable();
+        m_values.resize(n);
+        for( size_t i = 0; i < n; i++ ) {
+            m_values[i] = m_pb.val(VariableT(i));
+        }
+
+        std::vector<bool> written(n, false);
+        for( const auto& node : m_nodes ) {
+            std::fill(written.begin() + node.begin, written.begin() + node.end, true);
+        }
+
+        m_free.clear();
+        for( size_t i = 0; i < n; i++ ) {
+            if( ! written[i] ) {
+                m_free.push_back(i);
+            }
+        }
+    }
+
+    /**
+    * Re-run the gadgets affected by inputs which changed since the last
+    * run() or update(), and return the sorted indices of the variables whose
+    * values changed, inputs included.
+    */
+    std::vector<size_t> update()
+    {
+        std::vector<bool> changed(m_values.size(), false);
+        std::vector<size_t> result;
+
+        auto compare = [&](size_t i) {
+            const FieldT value = m_pb.val(VariableT(i));
+            if( value != m_values[i] ) {
+                m_values[i] = value;
+                changed[i] = true;
+                result.push_back(i);
+            }
+        };
+
+        for( size_t i : m_free ) {
+            compare(i);
+        }
+
+        m_num_recomputed = 0;
+        for( const auto& node : m_nodes )
+        {
+            const bool affected = std::any_of(node.inputs.begin(), node.inputs.end(), [&changed](size_t i) {
+                return changed[i];
+            });
+            if( ! affected ) {
+                continue;
+            }
+
+            node.job();
+            m_num_recomputed++;
+
+            for( size_t i = node.begin; i < node.end; i++ ) {
+                compare(i);
+            }
+        }
+
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+protected:
+    struct Node
+    {
+        JobT job;
+        std::vector<size_t> inputs;
+        size_t begin;
+        size_t end;
+    };
+
+    ProtoboardT& m_pb;
+    std::vector<Node> m_nodes;
+    std::vector<FieldT> m_values;   // at the last run() or update()
+    std::vector<size_t> m_free;     // written by no gadget
+    size_t m_num_recomputed;
+};
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_INCREMENTAL_WITNESS_HPP_
+#endif
@@ -0,0 +1,207 @@
+#ifndef ETHSNARKS_INSTANCED_GADGET_HPP_
+#define ETHSNARKS_INSTANCED_GADGET_HPP_
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+#include "utils.hpp"
+
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+
+namespace ethsnarks {
+
+
+/**
+* An instance of a gadget which shares the constraints of a master gadget,
+* instead of making its own.
+*
+* The master is made once per key on its own protoboard, by a factory which
+* allocates the master's inputs first, then its outputs, then makes the
+* gadget. Each instance allocates only the master's intermediate variables,
+* and its constraints are the master's, with the variable indices translated
+* through libsnark::ITranslator.
+*
+* The witness is computed by the master from the instance's input values,
+* its protoboard keeps per-thread values so instances can be evaluated
+* concurrently. Masters live for the rest of the process. The key must tell
+* apart every parameter which changes the constraints, e.g. the number of
+* inputs or the constants.
+*/
+template<typename MasterGadgetT>
+class instanced_gadget : public GadgetT, public libsnark::ITranslator
+{
+public:
+	typedef std::function<MasterGadgetT*(ProtoboardT&)> FactoryT;
+
+	struct SharedMaster {
+		ProtoboardT pb;
+		std::unique_ptr<MasterGadgetT> gadget;
+		size_t n_inputs;
+		size_t n_outputs;
+		std::once_flag swapped;
+	};
+
+	SharedMaster& master;
+	const VariableArrayT instance_inputs;
+	const VariableArrayT instance_outputs;
+	unsigned int instance_variables_offset;
+
+	instanced_gadget(
+		ProtoboardT &in_pb,
+		const VariableArrayT& in_inputs,
+		const VariableArrayT& in_outputs,
+		const std::string& in_key,
+		const FactoryT& in_factory,
+		const std::string& annotation_prefix
+	) :
+		GadgetT(in_pb, annotation_prefix),
+		master(get_master(in_key, in_inputs.size(), in_outputs.size(), in_factory)),
+		instance_inputs(in_inputs),
+		instance_outputs(in_outputs)
+	{
+		// Keep track of where the variable for this instance start
+		instance_variables_offset = in_pb.num_variables() + 1;
+		// Allocate the variables on the pb needed for this instance
+		make_var_array(in_pb, master.pb.num_variables() - n_external(), pb_annotation(in_pb, annotation_prefix, ".instance_var"));
+	}
+
+	static SharedMaster& get_master( const std::string& key, size_t n_inputs, size_t n_outputs, const FactoryT& factory )
+	{
+		static std::mutex masters_mutex;
+		static std::map<std::string, std::unique_ptr<SharedMaster>> masters;
+
+		std::lock_guard<std::mutex> guard(masters_mutex);
+		auto& shared = masters[key];
+		if( ! shared )
+		{
+			shared.reset(new SharedMaster);
+			shared->n_inputs = n_inputs;
+			shared->n_outputs = n_outputs;
+			shared->gadget.reset(factory(shared->pb));
+			shared->gadget->generate_r1cs_constraints();
+			shared->pb.set_use_thread_values(true);
+			assert( shared->pb.num_variables() >= n_inputs + n_outputs );
+		}
+		assert( shared->n_inputs == n_inputs && shared->n_outputs == n_outputs );
+		return *shared;
+	}
+
+	size_t n_external() const
+	{
+		return master.n_inputs + master.n_outputs;
+	}
+
+	/**
+	* The instance's variable for one of the master's, e.g. its result
+	*/
+	VariableT variable( const VariableT& master_var ) const
+	{
+		return VariableT(translate(master_var.index));
+	}
+
+	void generate_r1cs_constraints() const
+	{
+		if( is_witness_only(this->pb) ) {
+			return;
+		}
+
+		const auto& constraints = master.pb.constraint_system.constraints;
+		for(unsigned int i = 0; i < constraints.size(); i++)
+		{
+			pb.constraint_system.constraints.emplace_back(
+				libsnark::make_unique<libsnark::r1cs_constraint_light_instance<FieldT>>(
+					(libsnark::r1cs_constraint_light<FieldT>*) constraints[i].get(),
+					(libsnark::ITranslator*) this
+				)
+			);
+		}
+	}
+
+	void generate_r1cs_witness() const
+	{
+		for (unsigned int i = 0; i < instance_inputs.size(); i++)
+		{
+			master.pb.val(1 + i) = pb.val(instance_inputs[i]);
+		}
+
+		master.gadget->generate_r1cs_witness();
+
+		for (unsigned int i = 0; i < instance_outputs.size(); i++)
+		{
+			pb.val(instance_outputs[i]) = master.pb.val(1 + instance_inputs.size() + i);
+		}
+		for (unsigned int i = 0; i < master.pb.num_variables() - n_external(); i++)
+		{
+			pb.val(instance_variables_offset + i) = master.pb.val(1 + n_external() + i);
+		}
+	}
+
+	unsigned int translate(unsigned int index) const override
+	{
+		if (index == 0)
+		{
+			return 0;
+		}
+		else if (index <= instance_inputs.size())
+		{
+			return instance_inputs[index - 1].index;
+		}
+		else if (index <= n_external())
+		{
+			return instance_outputs[index - 1 - instance_inputs.size()].index;
+		}
+		else
+		{
+			return instance_variables_offset + (index - (1 + n_external()));
+		}
+	}
+
+	void swapAB() override
+	{
+		std::call_once(master.swapped, [&](){
+			const auto& constraints = master.pb.constraint_system.constraints;
+			for(unsigned int i = 0; i < constraints.size(); i++)
+			{
+				constraints[i]->swapAB();
+			}
+		});
+	}
+};
+
+
+/**
+* The inputs of an instance, from individual variables
+*/
+inline VariableArrayT instance_variables( std::initializer_list<VariableT> in_vars )
+{
+	const std::vector<VariableT> vars(in_vars);
+	return VariableArrayT(vars.begin(), vars.end());
+}
+
+
+/**
+* Key of a master, from a name and the constants it's made with
+*/
+inline std::string instance_key( const std::string& name, std::initializer_list<FieldT> in_constants )
+{
+	std::string key(name);
+	for( const auto& constant : in_constants )
+	{
+		const auto limbs = constant.as_bigint();
+		key.append(reinterpret_cast<const char*>(limbs.data), sizeof(limbs.data));
+	}
+	return key;
+}
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_INSTANCED_GADGET_HPP_
+#endif
@@ -58,6 +58,16 @@ void IsNonZero::generate_r1cs_witness()
 	}
 }
 
+
+void IsNonZero::generate_r1cs_witness( batch_inverter& inverter )
+{
+	// The inverse of zero is zero, so Y is 1 for exactly the non-zero X
+	inverter.add(this->pb.val(m_X), [this]( const FieldT& X_inv ) {
+		this->pb.val(m_M) = X_inv;
+		this->pb.val(m_Y) = X_inv.is_zero() ? FieldT::zero() : FieldT::one();
+	});
+}
+
 	
 // namespace ethsnarks
 }
@@ -2,6 +2,7 @@
 #define ETHSNARKS_ZEROP_HPP_
 
 #include "ethsnarks.hpp"
+#include "gadgets/batch_inverter.hpp"
 
 
 namespace ethsnarks {
@@ -30,6 +31,11 @@ public:
     void generate_r1cs_constraints();
 
     void generate_r1cs_witness();
+
+    /**
+    * Defer computing 1/X to the batch, the result is set by `inverter.run()`
+    */
+    void generate_r1cs_witness( batch_inverter& inverter );
 };
 
 // namespace ethsnarks
@@ -12,7 +12,7 @@
 namespace ethsnarks {
 
 
-void lookup_2bit_constraints( ProtoboardT& pb, const std::vector<FieldT> c, const VariableArrayT b, const VariableT r, const std::string& annotation_prefix )
+void lookup_2bit_constraints( ProtoboardT& pb, const std::vector<FieldT>& c, const VariableArrayT& b, const VariableT r, const std::string& annotation_prefix )
 {
 	// lhs = c[1] - c[0] + (b[1] * (c[3] - c[2] - c[1] + c[0]))
 	LinearCombinationT lhs;
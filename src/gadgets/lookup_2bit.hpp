@@ -9,7 +9,7 @@
 namespace ethsnarks {
 
 
-void lookup_2bit_constraints( ProtoboardT& pb, const std::vector<FieldT> c, const VariableArrayT b, const VariableT r, const std::string& annotation_prefix );
+void lookup_2bit_constraints( ProtoboardT& pb, const std::vector<FieldT>& c, const VariableArrayT& b, const VariableT r, const std::string& annotation_prefix );
 
 
 /**
@@ -36,6 +36,39 @@ const VariableT& lookup_3bit_gadget::result()
 }
 
 
+const libsnark::linear_combination<FieldT> lookup_3bit_gadget::lookup( const std::vector<FieldT>& c ) const
+{
+    assert( c.size() == 8 );
+
+    return
+        // All bits off
+        c[0] +
+
+        // Bit 0 is on
+        (b[0] * -c[0]) +
+        (b[0] * c[1]) +
+
+        // Bit 1 is on
+        (b[1] * -c[0]) +
+        (b[1] * c[2]) +
+
+        // Bit 0 and 1 are on
+        (precomp01 * (-c[1] + -c[2] + c[0] + c[3])) +
+
+        // Bit 2 is 1
+        (b[2] * (-c[0] + c[4])) +
+
+        // Bit 0 and 2 are on
+        (precomp02 * (c[0] - c[1] -c[4] + c[5])) +
+
+        // Bit 1 and 2 are on
+        (precomp12 * (c[0] - c[2] - c[4] + c[6])) +
+
+        // Bits 0, 1 and 2 are on
+        (precomp012 * (-c[0] + c[1] + c[2] - c[3] + c[4] - c[5] -c[6] + c[7]));
+}
+
+
 void lookup_3bit_gadget::generate_r1cs_constraints()
 {
     this->pb.add_r1cs_constraint(
@@ -60,33 +93,7 @@ void lookup_3bit_gadget::generate_r1cs_constraints()
 
     // Verify 
     this->pb.add_r1cs_constraint(
-        ConstraintT(
-            // All bits off
-            c[0] +
-
-            // Bit 0 is on
-            (b[0] * -c[0]) +
-            (b[0] * c[1]) +
-
-            // Bit 1 is on
-            (b[1] * -c[0]) +
-            (b[1] * c[2]) +
-
-            // Bit 0 and 1 are on
-            (precomp01 * (-c[1] + -c[2] + c[0] + c[3])) +
-
-            // Bit 2 is 1
-            (b[2] * (-c[0] + c[4])) +
-
-            // Bit 0 and 2 are on
-            (precomp02 * (c[0] - c[1] -c[4] + c[5])) +
-
-            // Bit 1 and 2 are on
-            (precomp12 * (c[0] - c[2] - c[4] + c[6])) +
-
-            // Bits 0, 1 and 2 are on
-            (precomp012 * (-c[0] + c[1] + c[2] - c[3] + c[4] - c[5] -c[6] + c[7]))
-        , FieldT::one(), r),
+        ConstraintT(lookup(c), FieldT::one(), r),
         FMT(this->annotation_prefix, ".result"));
 }
 
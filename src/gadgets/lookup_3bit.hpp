@@ -31,6 +31,12 @@ public:
 
     const VariableT& result();
 
+    /**
+    * The lookup of other constants with the same bits, as a linear
+    * combination of the selectors, e.g. for a Y coordinate next to the X
+    */
+    const libsnark::linear_combination<FieldT> lookup( const std::vector<FieldT>& in_constants ) const;
+
     void generate_r1cs_constraints();
 
     void generate_r1cs_witness ();
@@ -0,0 +1,231 @@
+#ifndef ETHSNARKS_LOOKUP_NBIT_HPP_
+#define ETHSNARKS_LOOKUP_NBIT_HPP_
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+#include "utils.hpp"
+
+
+namespace ethsnarks {
+
+
+/**
+* N-bit window lookup table, maps the bits `b` to a list of constants `c`
+*
+* The table is a multilinear polynomial of the bits, its coefficients are
+* found from the constants when the circuit is made. Every product of two
+* or more bits is a selector, made from a smaller selector and one more bit
+* with one constraint each.
+*
+* Unsigned, the last bit isn't part of any selector, it chooses between the
+* polynomials of the lower and upper halves of the table:
+*
+*   (upper - lower) * b[N-1] = r - lower
+*
+* Signed, the last bit is the sign of the value chosen by the other bits,
+* from `2^(N-1)` constants:
+*
+*   (y + y) * b[N-1] = y - r
+*
+* With `M` bits needing selectors, `M = N-1` either way, this takes
+* `2^M - M` constraints: 1 for 1 or 2 bits, 2 for 3 bits, 5 for 4 bits.
+* Like lookup_1bit_gadget, lookup_2bit_gadget or lookup_signed_3bit_gadget
+* for their widths, and cheaper than lookup_3bit_gadget's 5.
+*/
+template<size_t N, bool Signed = false>
+class lookup_Nbit_gadget : public GadgetT
+{
+public:
+    static_assert( N > 0 && N < 16, "Lookup tables are for small windows" );
+    static_assert( N > 1 || ! Signed, "Signed lookups need a bit besides the sign" );
+
+    // Bits in the selectors, and how many selectors there are
+    static constexpr size_t SELECTOR_BITS = N - 1;
+    static constexpr size_t N_SELECTORS = size_t(1) << SELECTOR_BITS;
+
+    // Number of constants in the table
+    static constexpr size_t N_CONSTANTS = size_t(1) << (Signed ? N - 1 : N);
+
+    static constexpr size_t N_CONSTRAINTS = N_SELECTORS - SELECTOR_BITS;
+
+    const std::vector<FieldT> c;
+    const VariableArrayT b;
+
+    // Products of the bits for each combination of two or more, by mask
+    std::vector<VariableT> selectors;
+
+    VariableT r;
+
+    lookup_Nbit_gadget(
+        ProtoboardT &in_pb,
+        const std::vector<FieldT> in_constants,
+        const VariableArrayT in_bits,
+        const std::string& annotation_prefix
+    ) :
+        GadgetT(in_pb, annotation_prefix),
+        c(in_constants),
+        b(in_bits),
+        selectors(N_SELECTORS)
+    {
+        assert( in_constants.size() == N_CONSTANTS );
+        assert( in_bits.size() == N );
+
+        for( size_t mask = 1; mask < N_SELECTORS; mask++ )
+        {
+            if( mask & (mask - 1) ) {
+                selectors[mask].allocate(in_pb, FMT(this->annotation_prefix, ".selectors[%zu]", mask));
+            }
+        }
+
+        r.allocate(in_pb, FMT(this->annotation_prefix, ".r"));
+    }
+
+    /**
+    * Index of the lowest bit set in a mask
+    */
+    static constexpr size_t lowest_bit( size_t mask )
+    {
+        return (mask & 1) ? 0 : 1 + lowest_bit(mask >> 1);
+    }
+
+    const VariableT& result() const
+    {
+        return r;
+    }
+
+    /**
+    * Coefficients of the polynomial through `values`, for each selector
+    */
+    static std::vector<FieldT> coefficients( const FieldT* values )
+    {
+        std::vector<FieldT> result(values, values + N_SELECTORS);
+        for( size_t bit = 0; bit < SELECTOR_BITS; bit++ )
+        {
+            for( size_t mask = 0; mask < N_SELECTORS; mask++ )
+            {
+                if( mask & (size_t(1) << bit) ) {
+                    result[mask] -= result[mask ^ (size_t(1) << bit)];
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+    * Linear combination of the selectors evaluating to `values[i]`, when
+    * the selector bits are `i`
+    */
+    const libsnark::linear_combination<FieldT> polynomial( const FieldT* values ) const
+    {
+        const auto coeffs = coefficients(values);
+
+        libsnark::linear_combination<FieldT> result(coeffs[0]);
+        for( size_t mask = 1; mask < N_SELECTORS; mask++ )
+        {
+            if( mask & (mask - 1) ) {
+                result = result + (selectors[mask] * coeffs[mask]);
+            }
+            else {
+                result = result + (b[lowest_bit(mask)] * coeffs[mask]);
+            }
+        }
+        return result;
+    }
+
+    /**
+    * The lookup of other constants with the same bits, before the sign,
+    * e.g. for an X coordinate next to a signed Y
+    */
+    const libsnark::linear_combination<FieldT> lookup( const std::vector<FieldT>& in_constants ) const
+    {
+        static_assert( Signed, "The last bit of an unsigned lookup isn't in the selectors" );
+        assert( in_constants.size() == N_CONSTANTS );
+        return polynomial(in_constants.data());
+    }
+
+    void generate_r1cs_constraints()
+    {
+        for( size_t mask = 3; mask < N_SELECTORS; mask++ )
+        {
+            if( mask & (mask - 1) )
+            {
+                const size_t low = mask & (mask - 1);
+                const size_t bit = lowest_bit(mask);
+                const VariableT rest = (low & (low - 1)) ? selectors[low] : b[lowest_bit(low)];
+
+                this->pb.add_r1cs_constraint(
+                    ConstraintT(rest, b[bit], selectors[mask]),
+                    FMT(this->annotation_prefix, ".selectors[%zu]", mask));
+            }
+        }
+
+        const auto& last = b[N - 1];
+        if( Signed )
+        {
+            const auto y = polynomial(c.data());
+            this->pb.add_r1cs_constraint(
+                ConstraintT(y + y, last, y - r),
+                FMT(this->annotation_prefix, ".result"));
+        }
+        else {
+            const auto lower = polynomial(c.data());
+            const auto upper = polynomial(c.data() + N_SELECTORS);
+            this->pb.add_r1cs_constraint(
+                ConstraintT(upper - lower, last, r - lower),
+                FMT(this->annotation_prefix, ".result"));
+        }
+    }
+
+    void generate_r1cs_witness()
+    {
+        FieldT bit_values[N];
+        size_t index = 0;
+        for( size_t i = 0; i < N; i++ )
+        {
+            bit_values[i] = this->pb.val(b[i]);
+            if( bit_values[i] == FieldT::one() ) {
+                index |= size_t(1) << i;
+            }
+        }
+
+        for( size_t mask = 3; mask < N_SELECTORS; mask++ )
+        {
+            if( mask & (mask - 1) )
+            {
+                const size_t low = mask & (mask - 1);
+                const FieldT rest = (low & (low - 1)) ? this->pb.val(selectors[low]) : bit_values[lowest_bit(low)];
+                this->pb.val(selectors[mask]) = rest * bit_values[lowest_bit(mask)];
+            }
+        }
+
+        if( Signed ) {
+            const FieldT& value = c[index & (N_CONSTANTS - 1)];
+            this->pb.val(r) = (index >> (N - 1)) ? -value : value;
+        }
+        else {
+            this->pb.val(r) = c[index];
+        }
+    }
+};
+
+
+template<size_t N, bool Signed>
+constexpr size_t lookup_Nbit_gadget<N, Signed>::SELECTOR_BITS;
+
+template<size_t N, bool Signed>
+constexpr size_t lookup_Nbit_gadget<N, Signed>::N_SELECTORS;
+
+template<size_t N, bool Signed>
+constexpr size_t lookup_Nbit_gadget<N, Signed>::N_CONSTANTS;
+
+template<size_t N, bool Signed>
+constexpr size_t lookup_Nbit_gadget<N, Signed>::N_CONSTRAINTS;
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_LOOKUP_NBIT_HPP_
+#endif
@@ -0,0 +1,237 @@
+#ifndef ETHSNARKS_MERKLE_MULTI_UPDATE_HPP_
+#define ETHSNARKS_MERKLE_MULTI_UPDATE_HPP_
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+#include "utils.hpp"
+#include "gadgets/witness_scheduler.hpp"
+
+#include <algorithm>
+#include <functional>
+
+
+namespace ethsnarks {
+
+
+/**
+* Proves the transition from an old root to a new root when the leaves at
+* a known set of indices change, hashing every distinct node on their
+* paths once for each root.
+*
+* The indices are part of the circuit, sorted and without duplicates, so
+* whether a node is on the left or the right is known when the circuit is
+* made: there are no selectors, and a node shared by several paths is
+* hashed once. A batch of K paths of depth D takes
+* `2 * n_hashes(D, indices)` hashes instead of the `2 * K * D` of K
+* merkle_path_authenticator pairs.
+*
+* The siblings are the nodes next to the paths which aren't on another
+* path, they're the same in the old and new tree. Their order is given by
+* `sibling_nodes(D, indices)`, level by level from the leaves, left to
+* right within a level.
+*/
+template<typename HashT>
+class merkle_multi_update : public GadgetT
+{
+public:
+    typedef std::pair<size_t, size_t> NodeT;     // level, index within the level
+
+    const size_t m_depth;
+    const std::vector<size_t> m_indices;
+    const VariableT m_old_root;
+    const VariableT m_new_root;
+
+    std::vector<HashT> m_old_hashers;
+    std::vector<HashT> m_new_hashers;
+    std::vector<size_t> m_level_ends;      // end of each level's hashers
+
+    /** Indices of the nodes on the paths, at the next level */
+    static std::vector<size_t> parent_indices( const std::vector<size_t>& indices )
+    {
+        std::vector<size_t> parents;
+        for( const auto index : indices )
+        {
+            if( parents.empty() || parents.back() != (index >> 1) ) {
+                parents.push_back(index >> 1);
+            }
+        }
+        return parents;
+    }
+
+    static std::vector<NodeT> sibling_nodes( size_t depth, const std::vector<size_t>& indices )
+    {
+        std::vector<NodeT> result;
+        std::vector<size_t> level_indices(indices);
+
+        for( size_t level = 0; level < depth; level++ )
+        {
+            for( size_t i = 0; i < level_indices.size(); i++ )
+            {
+                const size_t index = level_indices[i];
+                if( (index & 1) == 0 && (i + 1 == level_indices.size() || level_indices[i + 1] != index + 1) ) {
+                    result.emplace_back(level, index + 1);
+                }
+                else if( (index & 1) == 1 && (i == 0 || level_indices[i - 1] != index - 1) ) {
+                    result.emplace_back(level, index - 1);
+                }
+            }
+            level_indices = parent_indices(level_indices);
+        }
+
+        return result;
+    }
+
+    /** Hashes needed for each root */
+    static size_t n_hashes( size_t depth, const std::vector<size_t>& indices )
+    {
+        size_t n = 0;
+        std::vector<size_t> level_indices(indices);
+        for( size_t level = 0; level < depth; level++ )
+        {
+            level_indices = parent_indices(level_indices);
+            n += level_indices.size();
+        }
+        return n;
+    }
+
+    merkle_multi_update(
+        ProtoboardT &in_pb,
+        const size_t in_depth,
+        const std::vector<size_t>& in_indices,
+        const VariableArrayT& in_IVs,
+        const VariableArrayT& in_old_leaves,
+        const VariableArrayT& in_new_leaves,
+        const VariableArrayT& in_siblings,
+        const VariableT& in_old_root,
+        const VariableT& in_new_root,
+        const std::string &in_annotation_prefix
+    ) :
+        GadgetT(in_pb, in_annotation_prefix),
+        m_depth(in_depth),
+        m_indices(in_indices),
+        m_old_root(in_old_root),
+        m_new_root(in_new_root)
+    {
+        assert( in_depth > 0 );
+        assert( ! in_indices.empty() );
+        assert( std::adjacent_find(in_indices.begin(), in_indices.end(), std::greater_equal<size_t>()) == in_indices.end() );
+        assert( (in_indices.back() >> in_depth) == 0 );
+        assert( in_IVs.size() >= in_depth );
+        assert( in_old_leaves.size() == in_indices.size() );
+        assert( in_new_leaves.size() == in_indices.size() );
+        assert( in_siblings.size() == sibling_nodes(in_depth, in_indices).size() );
+
+        const size_t n = n_hashes(in_depth, in_indices);
+        m_old_hashers.reserve(n);
+        m_new_hashers.reserve(n);
+
+        std::vector<size_t> level_indices(in_indices);
+        std::vector<VariableT> old_nodes(in_old_leaves.begin(), in_old_leaves.end());
+        std::vector<VariableT> new_nodes(in_new_leaves.begin(), in_new_leaves.end());
+        size_t sibling = 0;
+
+        for( size_t level = 0; level < in_depth; level++ )
+        {
+            const auto parents = parent_indices(level_indices);
+            std::vector<VariableT> old_parents, new_parents;
+
+            // Each parent's children are either on a path, in order, or a sibling
+            size_t i = 0;
+            for( const auto parent : parents )
+            {
+                VariableT old_children[2], new_children[2];
+                for( size_t side = 0; side < 2; side++ )
+                {
+                    if( i < level_indices.size() && level_indices[i] == (parent * 2) + side ) {
+                        old_children[side] = old_nodes[i];
+                        new_children[side] = new_nodes[i];
+                        i++;
+                    }
+                    else {
+                        old_children[side] = new_children[side] = in_siblings[sibling++];
+                    }
+                }
+
+                m_old_hashers.emplace_back(
+                    in_pb, in_IVs[level], std::vector<VariableT>{old_children[0], old_children[1]},
+                    pb_annotation(in_pb, this->annotation_prefix, ".old[%zu][%zu]", level + 1, parent));
+                m_new_hashers.emplace_back(
+                    in_pb, in_IVs[level], std::vector<VariableT>{new_children[0], new_children[1]},
+                    pb_annotation(in_pb, this->annotation_prefix, ".new[%zu][%zu]", level + 1, parent));
+
+                old_parents.push_back(m_old_hashers.back().result());
+                new_parents.push_back(m_new_hashers.back().result());
+            }
+
+            m_level_ends.push_back(m_old_hashers.size());
+            level_indices = parents;
+            old_nodes = old_parents;
+            new_nodes = new_parents;
+        }
+    }
+
+    const VariableT& old_root() const
+    {
+        return m_old_hashers.back().result();
+    }
+
+    const VariableT& new_root() const
+    {
+        return m_new_hashers.back().result();
+    }
+
+    bool is_valid() const
+    {
+        return this->pb.val(old_root()) == this->pb.val(m_old_root)
+            && this->pb.val(new_root()) == this->pb.val(m_new_root);
+    }
+
+    void generate_r1cs_constraints()
+    {
+        if( is_witness_only(this->pb) ) {
+            return;
+        }
+
+        for( size_t i = 0; i < m_old_hashers.size(); i++ )
+        {
+            m_old_hashers[i].generate_r1cs_constraints();
+            m_new_hashers[i].generate_r1cs_constraints();
+        }
+
+        this->pb.add_r1cs_constraint(
+            ConstraintT(old_root(), 1, m_old_root),
+            FMT(this->annotation_prefix, ".old_root"));
+
+        this->pb.add_r1cs_constraint(
+            ConstraintT(new_root(), 1, m_new_root),
+            FMT(this->annotation_prefix, ".new_root"));
+    }
+
+    /**
+    * The hashes of a level are independent, and are computed concurrently
+    */
+    void generate_r1cs_witness() const
+    {
+        witness_scheduler scheduler;
+        size_t i = 0;
+        for( const auto level_end : m_level_ends )
+        {
+            for( ; i < level_end; i++ )
+            {
+                scheduler.add(m_old_hashers[i]);
+                scheduler.add(m_new_hashers[i]);
+            }
+            scheduler.barrier();
+        }
+        scheduler.run();
+    }
+};
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_MERKLE_MULTI_UPDATE_HPP_
+#endif
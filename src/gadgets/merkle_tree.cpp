@@ -20,17 +20,21 @@ merkle_path_selector::merkle_path_selector(
     m_pathvar(in_pathvar),
     m_is_right(in_is_right)
 {
-    m_left_a.allocate(in_pb, FMT(this->annotation_prefix, ".left_a"));
-    m_left_b.allocate(in_pb, FMT(this->annotation_prefix, ".left_b"));
-    m_left.allocate(in_pb, FMT(this->annotation_prefix, ".left"));
+    m_left_a.allocate(in_pb, pb_annotation(in_pb, this->annotation_prefix, ".left_a"));
+    m_left_b.allocate(in_pb, pb_annotation(in_pb, this->annotation_prefix, ".left_b"));
+    m_left.allocate(in_pb, pb_annotation(in_pb, this->annotation_prefix, ".left"));
 
-    m_right_a.allocate(in_pb, FMT(this->annotation_prefix, ".right_a"));
-    m_right_b.allocate(in_pb, FMT(this->annotation_prefix, ".right_b"));
-    m_right.allocate(in_pb, FMT(this->annotation_prefix, ".right"));
+    m_right_a.allocate(in_pb, pb_annotation(in_pb, this->annotation_prefix, ".right_a"));
+    m_right_b.allocate(in_pb, pb_annotation(in_pb, this->annotation_prefix, ".right_b"));
+    m_right.allocate(in_pb, pb_annotation(in_pb, this->annotation_prefix, ".right"));
 }
 
 void merkle_path_selector::generate_r1cs_constraints()
 {
+    if( is_witness_only(this->pb) ) {
+        return;
+    }
+
     this->pb.add_r1cs_constraint(
         ConstraintT(1 - m_is_right, m_input, m_left_a),
         FMT(this->annotation_prefix, "1-is_right * input = left_a"));
@@ -71,12 +75,154 @@ const VariableT& merkle_path_selector::right() const {
 }
 
 
-const VariableArrayT merkle_tree_IVs (ProtoboardT &in_pb)
+merkle_path_selector_kary::merkle_path_selector_kary(
+    ProtoboardT &in_pb,
+    const VariableT& in_input,
+    const VariableArrayT& in_siblings,
+    const VariableArrayT& in_position_bits,
+    const std::string &in_annotation_prefix
+) :
+    GadgetT(in_pb, in_annotation_prefix),
+    m_arity(size_t(1) << in_position_bits.size()),
+    m_input(in_input),
+    m_siblings(in_siblings),
+    m_position_bits(in_position_bits)
+{
+    assert( in_position_bits.size() > 0 );
+    assert( in_siblings.size() == m_arity - 1 );
+
+    // The indicators of the first bit, then each is split in two by the next,
+    // e * (1 - b) and e * b, the products of the last one being implied as
+    // the products sum to b
+    m_indicators = {1 - in_position_bits[0], in_position_bits[0]};
+    for( size_t i = 1; i < in_position_bits.size(); i++ )
+    {
+        const size_t n = m_indicators.size();
+        libsnark::linear_combination<FieldT> last = in_position_bits[i];
+        m_indicators.resize(n * 2);
+        for( size_t p = 0; p < n; p++ )
+        {
+            libsnark::linear_combination<FieldT> product;
+            if( p + 1 < n ) {
+                m_products.emplace_back();
+                m_products.back().allocate(in_pb, pb_annotation(in_pb, this->annotation_prefix, ".products[%zu]", m_products.size() - 1));
+                product = m_products.back();
+                last = last - m_products.back();
+            }
+            else {
+                product = last;
+            }
+            m_indicators[p + n] = product;
+            m_indicators[p] = m_indicators[p] - product;
+        }
+    }
+
+    if( m_arity > 2 ) {
+        m_steps.allocate(in_pb, m_arity - 2, pb_annotation(in_pb, this->annotation_prefix, ".steps"));
+    }
+    m_children.allocate(in_pb, m_arity, pb_annotation(in_pb, this->annotation_prefix, ".children"));
+}
+
+
+void merkle_path_selector_kary::generate_r1cs_constraints()
+{
+    if( is_witness_only(this->pb) ) {
+        return;
+    }
+
+    // Each product is of the indicator of the previous bits, the sum of the
+    // positions with those low bits, and the next bit
+    size_t k = 0;
+    for( size_t i = 1; i < m_position_bits.size(); i++ )
+    {
+        const size_t n = size_t(1) << i;
+        for( size_t p = 0; p + 1 < n; p++, k++ )
+        {
+            libsnark::linear_combination<FieldT> parent;
+            for( size_t q = p; q < m_arity; q += n ) {
+                parent = parent + m_indicators[q];
+            }
+
+            this->pb.add_r1cs_constraint(
+                ConstraintT(parent, m_position_bits[i], m_products[k]),
+                FMT(this->annotation_prefix, ".products[%zu]", k));
+        }
+    }
+
+    const size_t last = m_arity - 1;
+
+    // First and last: c = s + (e * (input - s)), for their only sibling
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_indicators[0], m_input - m_siblings[0], m_children[0] - m_siblings[0]),
+        FMT(this->annotation_prefix, ".children[0]"));
+
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_indicators[last], m_input - m_siblings[last - 1], m_children[last] - m_siblings[last - 1]),
+        FMT(this->annotation_prefix, ".children[%zu]", last));
+
+    // Others: c = s_{j-1} + (e_j * (input - s_{j-1})) + ((pos > j) * (s_j - s_{j-1}))
+    libsnark::linear_combination<FieldT> after = 1 - m_indicators[0];
+    for( size_t j = 1; j < last; j++ )
+    {
+        after = after - m_indicators[j];
+        const VariableT& step = m_steps[j - 1];
+
+        this->pb.add_r1cs_constraint(
+            ConstraintT(m_indicators[j], m_input - m_siblings[j - 1], step),
+            FMT(this->annotation_prefix, ".steps[%zu]", j - 1));
+
+        this->pb.add_r1cs_constraint(
+            ConstraintT(after, m_siblings[j] - m_siblings[j - 1], m_children[j] - m_siblings[j - 1] - step),
+            FMT(this->annotation_prefix, ".children[%zu]", j));
+    }
+}
+
+
+void merkle_path_selector_kary::generate_r1cs_witness() const
+{
+    size_t position = 0;
+    for( size_t i = 0; i < m_position_bits.size(); i++ ) {
+        if( this->pb.val(m_position_bits[i]) == FieldT::one() ) {
+            position |= size_t(1) << i;
+        }
+    }
+
+    size_t k = 0;
+    for( size_t i = 1; i < m_position_bits.size(); i++ )
+    {
+        const size_t n = size_t(1) << i;
+        for( size_t p = 0; p + 1 < n; p++, k++ ) {
+            this->pb.val(m_products[k]) = (p == (position % n)) ? this->pb.val(m_position_bits[i]) : FieldT::zero();
+        }
+    }
+
+    const FieldT& input = this->pb.val(m_input);
+    for( size_t j = 0; j < m_arity; j++ )
+    {
+        if( j == position ) {
+            this->pb.val(m_children[j]) = input;
+        }
+        else {
+            this->pb.val(m_children[j]) = this->pb.val(m_siblings[j < position ? j : j - 1]);
+        }
+
+        if( j > 0 && j + 1 < m_arity ) {
+            this->pb.val(m_steps[j - 1]) = (j == position) ? input - this->pb.val(m_siblings[j - 1]) : FieldT::zero();
+        }
+    }
+}
+
+
+const VariableArrayT& merkle_path_selector_kary::children() const {
+    return m_children;
+}
+
+
+const std::vector<FieldT>& merkle_tree_IV_values ()
 {
     // TODO: replace with auto-generated constants
     // or remove the merkle tree IVs entirely...
-    auto x = make_var_array(in_pb, 29, "IVs");
-    std::vector<FieldT> level_IVs = {
+    static const std::vector<FieldT> level_IVs = {
         FieldT("149674538925118052205057075966660054952481571156186698930522557832224430770"),
         FieldT("9670701465464311903249220692483401938888498641874948577387207195814981706974"),
         FieldT("18318710344500308168304415114839554107298291987930233567781901093928276468271"),
@@ -107,6 +253,15 @@ const VariableArrayT merkle_tree_IVs (ProtoboardT &in_pb)
         FieldT("16562533130736679030886586765487416082772837813468081467237161865787494093536"),
         FieldT("6037428193077828806710267464232314380014232668931818917272972397574634037180")
     };
+
+    return level_IVs;
+}
+
+
+const VariableArrayT merkle_tree_IVs (ProtoboardT &in_pb)
+{
+    const auto& level_IVs = merkle_tree_IV_values();
+    auto x = make_var_array(in_pb, level_IVs.size(), "IVs");
     x.fill_with_field_elements(in_pb, level_IVs);
 
     return x;
@@ -2,6 +2,9 @@
 #define ETHSNARKS_MERKLE_TREE_HPP_
 
 #include "ethsnarks.hpp"
+#include "utils.hpp"
+
+#include <libff/common/utils.hpp>   // log2
 
 namespace ethsnarks {
 
@@ -64,9 +67,69 @@ public:
 };
 
 
+/**
+* The children of one level of a k-ary tree, k being a power of two, with
+* the input at the position given by the address bits and the k-1 siblings
+* of the path in order around it
+*
+* The position is decoded into an indicator e_p of each position, sums of
+* products of the bits and their complements, with (k - 1 - log2 k)
+* constraints. Then each child is:
+*
+*   c_j = (e_j * input) + ((pos > j) * s_j) + ((pos < j) * s_{j-1})
+*
+* which is one constraint for the first and last children and two for the
+* others. When k is 2 this is the same as merkle_path_selector, in 2
+* constraints rather than 6.
+*
+* As with merkle_path_selector the caller must constrain the address bits.
+*/
+class merkle_path_selector_kary : public GadgetT
+{
+public:
+    const size_t m_arity;
+    const VariableT m_input;
+    const VariableArrayT m_siblings;
+    const VariableArrayT m_position_bits;
+
+    VariableArrayT m_products;      // indicator * bit, for each bit after the first
+    VariableArrayT m_steps;         // e_j * (input - s_{j-1}), of the middle children
+    VariableArrayT m_children;
+    std::vector<libsnark::linear_combination<FieldT>> m_indicators;
+
+    merkle_path_selector_kary(
+        ProtoboardT &in_pb,
+        const VariableT& in_input,
+        const VariableArrayT& in_siblings,
+        const VariableArrayT& in_position_bits,
+        const std::string &in_annotation_prefix
+    );
+
+    void generate_r1cs_constraints();
+
+    void generate_r1cs_witness() const;
+
+    const VariableArrayT& children() const;
+};
+
+
+/** The IV of each level, natively, must be used after libff's number system is initialised */
+const std::vector<FieldT>& merkle_tree_IV_values ();
+
+/**
+* Variables of the protoboard with the IV of each level, allocated on every
+* call, so circuits with many paths should make them once and share them
+*/
 const VariableArrayT merkle_tree_IVs (ProtoboardT &in_pb);
 
 
+/**
+* Computes the root from a leaf and its authentication path
+*
+* The witness only writes the gadget's own variables, so the witnesses of
+* many paths on one protoboard can be computed concurrently, e.g. with
+* generate_r1cs_witness_parallel(), see witness_scheduler.
+*/
 template<typename HashT>
 class markle_path_compute : public GadgetT
 {
@@ -98,30 +161,27 @@ public:
         assert( in_address_bits.size() == in_depth );
         assert( in_IVs.size() >= in_depth );
 
+        // Each level is constructed in place, and never moved once it is
+        m_selectors.reserve(m_depth);
+        m_hashers.reserve(m_depth);
+
         for( size_t i = 0; i < m_depth; i++ )
         {
-            if( i == 0 )
-            {
-                m_selectors.push_back(
-                    merkle_path_selector(
-                        in_pb, in_leaf, in_path[i], in_address_bits[i],
-                        FMT(this->annotation_prefix, ".selector[%zu]", i)));
-            }
-            else {
-                m_selectors.push_back(
-                    merkle_path_selector(
-                        in_pb, m_hashers[i-1].result(), in_path[i], in_address_bits[i],
-                        FMT(this->annotation_prefix, ".selector[%zu]", i)));
-            }
-
-            auto t = HashT(
-                    in_pb, in_IVs[i],
-                    {m_selectors[i].left(), m_selectors[i].right()},
-                    FMT(this->annotation_prefix, ".hasher[%zu]", i));
-            m_hashers.push_back(t);
+            m_selectors.emplace_back(
+                in_pb, i == 0 ? in_leaf : m_hashers[i-1].result(), in_path[i], in_address_bits[i],
+                pb_annotation(this->pb, this->annotation_prefix, ".selector[%zu]", i));
+
+            m_hashers.emplace_back(
+                in_pb, in_IVs[i],
+                std::vector<VariableT>{m_selectors[i].left(), m_selectors[i].right()},
+                pb_annotation(this->pb, this->annotation_prefix, ".hasher[%zu]", i));
         }
     }
 
+    // Copying would duplicate every hasher, containers of paths move them
+    markle_path_compute( const markle_path_compute& ) = delete;
+    markle_path_compute( markle_path_compute&& ) = default;
+
     const VariableT result() const
     {
         assert( m_hashers.size() > 0 );
@@ -131,6 +191,10 @@ public:
 
     void generate_r1cs_constraints()
     {
+        if( is_witness_only(this->pb) ) {
+            return;
+        }
+
         size_t i;
         for( i = 0; i < m_hashers.size(); i++ )
         {
@@ -163,11 +227,11 @@ public:
     merkle_path_authenticator(
         ProtoboardT &in_pb,
         const size_t in_depth,
-        const VariableArrayT in_address_bits,
-        const VariableArrayT in_IVs,
+        const VariableArrayT& in_address_bits,
+        const VariableArrayT& in_IVs,
         const VariableT in_leaf,
         const VariableT in_expected_root,
-        const VariableArrayT in_path,
+        const VariableArrayT& in_path,
         const std::string &in_annotation_prefix
     ) :
         markle_path_compute<HashT>::markle_path_compute(in_pb, in_depth, in_address_bits, in_IVs, in_leaf, in_path, in_annotation_prefix),
@@ -181,6 +245,10 @@ public:
 
     void generate_r1cs_constraints()
     {
+        if( is_witness_only(this->pb) ) {
+            return;
+        }
+
         markle_path_compute<HashT>::generate_r1cs_constraints();
 
         // Ensure root matches calculated path hash
@@ -191,6 +259,151 @@ public:
 };
 
 
+/**
+* Computes the root from a leaf and its authentication path in a tree of
+* `Arity` children per node, a power of two
+*
+* Each level has log2(Arity) address bits, least significant first, and
+* Arity-1 siblings in the order of the children without the node itself,
+* e.g. what merkle_tree_native<HashT, Arity>::path() gives. The hash of a
+* level takes all of its children, so with Poseidon a 4-ary tree is half
+* the depth of a binary one for about the same cost per level.
+*/
+template<typename HashT, unsigned Arity>
+class markle_path_compute_kary : public GadgetT
+{
+public:
+    static_assert( Arity >= 2 && (Arity & (Arity - 1)) == 0, "Arity must be a power of two" );
+
+    const size_t m_depth;
+    const size_t m_level_bits;
+    const VariableArrayT m_address_bits;
+    const VariableT m_leaf;
+    const VariableArrayT m_path;
+
+    std::vector<merkle_path_selector_kary> m_selectors;
+    std::vector<HashT> m_hashers;
+
+    markle_path_compute_kary(
+        ProtoboardT &in_pb,
+        const size_t in_depth,
+        const VariableArrayT& in_address_bits,
+        const VariableArrayT& in_IVs,
+        const VariableT in_leaf,
+        const VariableArrayT& in_path,
+        const std::string &in_annotation_prefix
+    ) :
+        GadgetT(in_pb, in_annotation_prefix),
+        m_depth(in_depth),
+        m_level_bits(libff::log2(Arity)),
+        m_address_bits(in_address_bits),
+        m_leaf(in_leaf),
+        m_path(in_path)
+    {
+        assert( in_depth > 0 );
+        assert( in_address_bits.size() == in_depth * m_level_bits );
+        assert( in_path.size() == in_depth * (Arity - 1) );
+        assert( in_IVs.size() >= in_depth );
+
+        m_selectors.reserve(m_depth);
+        m_hashers.reserve(m_depth);
+
+        for( size_t i = 0; i < m_depth; i++ )
+        {
+            const auto siblings_begin = in_path.begin() + (i * (Arity - 1));
+            const auto bits_begin = in_address_bits.begin() + (i * m_level_bits);
+
+            m_selectors.emplace_back(
+                in_pb, i == 0 ? in_leaf : m_hashers[i-1].result(),
+                VariableArrayT(siblings_begin, siblings_begin + (Arity - 1)),
+                VariableArrayT(bits_begin, bits_begin + m_level_bits),
+                pb_annotation(this->pb, this->annotation_prefix, ".selector[%zu]", i));
+
+            const auto& children = m_selectors[i].children();
+            m_hashers.emplace_back(
+                in_pb, in_IVs[i],
+                std::vector<VariableT>(children.begin(), children.end()),
+                pb_annotation(this->pb, this->annotation_prefix, ".hasher[%zu]", i));
+        }
+    }
+
+    markle_path_compute_kary( const markle_path_compute_kary& ) = delete;
+    markle_path_compute_kary( markle_path_compute_kary&& ) = default;
+
+    const VariableT result() const
+    {
+        assert( m_hashers.size() > 0 );
+
+        return m_hashers.back().result();
+    }
+
+    void generate_r1cs_constraints()
+    {
+        if( is_witness_only(this->pb) ) {
+            return;
+        }
+
+        for( size_t i = 0; i < m_hashers.size(); i++ )
+        {
+            m_selectors[i].generate_r1cs_constraints();
+            m_hashers[i].generate_r1cs_constraints();
+        }
+    }
+
+    void generate_r1cs_witness() const
+    {
+        for( size_t i = 0; i < m_hashers.size(); i++ )
+        {
+            m_selectors[i].generate_r1cs_witness();
+            m_hashers[i].generate_r1cs_witness();
+        }
+    }
+};
+
+
+/**
+* k-ary Merkle path authenticator, verifies computed root matches expected result
+*/
+template<typename HashT, unsigned Arity>
+class merkle_path_authenticator_kary : public markle_path_compute_kary<HashT, Arity>
+{
+public:
+    const VariableT m_expected_root;
+
+    merkle_path_authenticator_kary(
+        ProtoboardT &in_pb,
+        const size_t in_depth,
+        const VariableArrayT& in_address_bits,
+        const VariableArrayT& in_IVs,
+        const VariableT in_leaf,
+        const VariableT in_expected_root,
+        const VariableArrayT& in_path,
+        const std::string &in_annotation_prefix
+    ) :
+        markle_path_compute_kary<HashT, Arity>::markle_path_compute_kary(in_pb, in_depth, in_address_bits, in_IVs, in_leaf, in_path, in_annotation_prefix),
+        m_expected_root(in_expected_root)
+    { }
+
+    bool is_valid() const
+    {
+        return this->pb.val(this->result()) == this->pb.val(m_expected_root);
+    }
+
+    void generate_r1cs_constraints()
+    {
+        if( is_witness_only(this->pb) ) {
+            return;
+        }
+
+        markle_path_compute_kary<HashT, Arity>::generate_r1cs_constraints();
+
+        this->pb.add_r1cs_constraint(
+            ConstraintT(this->result(), 1, m_expected_root),
+            FMT(this->annotation_prefix, ".expected_root authenticator"));
+    }
+};
+
+
 // namespace ethsnarks
 }
 
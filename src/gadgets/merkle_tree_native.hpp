@@ -0,0 +1,278 @@
+#ifndef ETHSNARKS_MERKLE_TREE_NATIVE_HPP_
+#define ETHSNARKS_MERKLE_TREE_NATIVE_HPP_
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+#include "utils.hpp"
+#include "gadgets/merkle_tree.hpp"
+#include "gadgets/mimc.hpp"
+#include "gadgets/poseidon.hpp"
+#include "gadgets/poseidon_sponge.hpp"
+
+#include <algorithm>
+
+
+namespace ethsnarks {
+
+
+/**
+* Poseidon128 of the children of a node, with the constructor
+* markle_path_compute expects of its HashT. Poseidon has no IV, so the
+* level's IV is unused. Up to 5 children are one permutation of the same
+* width, so a 4-ary tree costs about as much per level as a binary one.
+*/
+template<unsigned Arity>
+class merkle_hash_Poseidon128_kary : public Poseidon128<Arity, 1>
+{
+public:
+    merkle_hash_Poseidon128_kary(
+        ProtoboardT &in_pb,
+        const VariableT& in_IV,
+        const std::vector<VariableT>& in_messages,
+        const std::string &in_annotation_prefix
+    ) :
+        Poseidon128<Arity, 1>(in_pb, VariableArrayT(in_messages.begin(), in_messages.end()), in_annotation_prefix)
+    { }
+};
+
+
+typedef merkle_hash_Poseidon128_kary<2> merkle_hash_Poseidon128;
+
+
+/**
+* The native equivalent of a HashT used by markle_path_compute, hashes the
+* `arity` children of n nodes of one level:
+*
+*   out[i] = H(children[arity*i], ..., children[arity*i + arity - 1])
+*/
+template<typename HashT>
+struct merkle_tree_hasher;
+
+
+template<>
+struct merkle_tree_hasher<MiMC_e7_hash_gadget>
+{
+    static const unsigned arity = 2;
+
+    static void hash_batch( size_t level, const FieldT* pairs, size_t n, FieldT* out )
+    {
+        assert( level < merkle_tree_IV_values().size() );
+        mimc_hash_native_batch<MiMCe7_round>(MiMC_e7_gadget::static_constants(), pairs, 2, n, merkle_tree_IV_values()[level], out);
+    }
+};
+
+
+template<unsigned Arity>
+struct merkle_tree_hasher<merkle_hash_Poseidon128_kary<Arity>>
+{
+    static const unsigned arity = Arity;
+
+    static void hash_batch( size_t level, const FieldT* children, size_t n, FieldT* out )
+    {
+        Poseidon128_hash_batch(children, Arity, n, out);
+    }
+};
+
+
+template<>
+struct merkle_tree_hasher<Poseidon128_sponge>
+{
+    static const unsigned arity = 2;
+
+    static void hash_batch( size_t level, const FieldT* pairs, size_t n, FieldT* out )
+    {
+        assert( level < merkle_tree_IV_values().size() );
+        const FieldT& IV = merkle_tree_IV_values()[level];
+
+        const long n_pairs = n;
+#ifdef MULTICORE
+        #pragma omp parallel for
+#endif
+        for( long i = 0; i < n_pairs; i++ )
+        {
+            out[i] = Poseidon128_sponge_hash(IV, {pairs[2*i], pairs[2*i + 1]});
+        }
+    }
+};
+
+
+/**
+* An authentication path, ready for the witness of markle_path_compute, or
+* of markle_path_compute_kary for trees of more than two children per node
+*/
+struct merkle_path_native
+{
+    libff::bit_vector address_bits;     // level 0 first, the node's position at each, least significant bit first
+    std::vector<FieldT> path;           // the siblings at each level, in order
+
+    void fill( ProtoboardT& in_pb, const VariableArrayT& in_address_bits, const VariableArrayT& in_path ) const
+    {
+        in_address_bits.fill_with_bits(in_pb, address_bits);
+        in_path.fill_with_field_elements(in_pb, path);
+    }
+};
+
+
+/**
+* Incremental Merkle tree, natively, with the same hash as the circuit
+*
+* Every node of a level is kept in one contiguous vector, up to the highest
+* leaf set so far, the nodes after it are the roots of empty subtrees which
+* are the same for the whole level. Appending leaves in order keeps it
+* compact, leaves far apart make the levels as long as the highest one.
+*
+* Updates are applied in batches, level by level, hashing each dirty parent
+* once however many of its leaves changed, and each level's hashes together.
+*
+* Each node has the hasher's arity of children, a power of two, and the
+* depth is in levels of the tree, e.g. a 4-ary tree of depth 8 has 2^16
+* leaves.
+*/
+template<typename HashT>
+class merkle_tree_native
+{
+public:
+    typedef merkle_tree_hasher<HashT> HasherT;
+
+    merkle_tree_native( size_t in_depth, const FieldT& in_empty_leaf = FieldT::zero() ) :
+        m_depth(in_depth),
+        m_arity(HasherT::arity),
+        m_level_bits(libff::log2(m_arity)),
+        m_levels(in_depth + 1)
+    {
+        assert( m_arity >= 2 && (m_arity & (m_arity - 1)) == 0 );
+        assert( in_depth > 0 && (in_depth * m_level_bits) < 64 );
+
+        m_empty.reserve(in_depth + 1);
+        m_empty.push_back(in_empty_leaf);
+        for( size_t level = 0; level < in_depth; level++ )
+        {
+            const std::vector<FieldT> children(m_arity, m_empty.back());
+            FieldT parent;
+            HasherT::hash_batch(level, children.data(), 1, &parent);
+            m_empty.push_back(parent);
+        }
+    }
+
+    size_t depth() const
+    {
+        return m_depth;
+    }
+
+    size_t arity() const
+    {
+        return m_arity;
+    }
+
+    const FieldT& node( size_t level, size_t index ) const
+    {
+        const auto& nodes = m_levels[level];
+        return index < nodes.size() ? nodes[index] : m_empty[level];
+    }
+
+    const FieldT& leaf( size_t index ) const
+    {
+        return node(0, index);
+    }
+
+    const FieldT& root() const
+    {
+        return node(m_depth, 0);
+    }
+
+    void update( size_t index, const FieldT& leaf )
+    {
+        update_batch({index}, {leaf});
+    }
+
+    /**
+    * Sets leaf `indices[i]` to `leaves[i]`, the later of any duplicates wins
+    */
+    void update_batch( const std::vector<size_t>& indices, const std::vector<FieldT>& leaves )
+    {
+        assert( indices.size() == leaves.size() );
+        if( indices.empty() ) {
+            return;
+        }
+
+        const size_t max_index = *std::max_element(indices.begin(), indices.end());
+        assert( (max_index >> (m_depth * m_level_bits)) == 0 );
+        for( size_t level = 0; level <= m_depth; level++ )
+        {
+            const size_t n_nodes = (max_index >> (level * m_level_bits)) + 1;
+            if( m_levels[level].size() < n_nodes ) {
+                m_levels[level].resize(n_nodes, m_empty[level]);
+            }
+        }
+
+        for( size_t i = 0; i < indices.size(); i++ ) {
+            m_levels[0][indices[i]] = leaves[i];
+        }
+
+        std::vector<size_t> dirty(indices);
+        std::vector<FieldT> children, hashes;
+        for( size_t level = 0; level < m_depth; level++ )
+        {
+            for( auto& index : dirty ) {
+                index >>= m_level_bits;
+            }
+            std::sort(dirty.begin(), dirty.end());
+            dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+            children.resize(dirty.size() * m_arity);
+            hashes.resize(dirty.size());
+            for( size_t i = 0; i < dirty.size(); i++ )
+            {
+                for( size_t c = 0; c < m_arity; c++ ) {
+                    children[(m_arity * i) + c] = node(level, (dirty[i] * m_arity) + c);
+                }
+            }
+
+            HasherT::hash_batch(level, children.data(), dirty.size(), hashes.data());
+
+            for( size_t i = 0; i < dirty.size(); i++ ) {
+                m_levels[level + 1][dirty[i]] = hashes[i];
+            }
+        }
+    }
+
+    merkle_path_native path( size_t index ) const
+    {
+        assert( (index >> (m_depth * m_level_bits)) == 0 );
+
+        merkle_path_native result;
+        result.address_bits.reserve(m_depth * m_level_bits);
+        result.path.reserve(m_depth * (m_arity - 1));
+        for( size_t level = 0; level < m_depth; level++ )
+        {
+            const size_t level_index = index >> (level * m_level_bits);
+            const size_t position = level_index & (m_arity - 1);
+            for( size_t b = 0; b < m_level_bits; b++ ) {
+                result.address_bits.push_back((position >> b) & 1);
+            }
+            for( size_t c = 0; c < m_arity; c++ ) {
+                if( c != position ) {
+                    result.path.push_back(node(level, level_index - position + c));
+                }
+            }
+        }
+
+        return result;
+    }
+
+protected:
+    const size_t m_depth;
+    const size_t m_arity;
+    const size_t m_level_bits;
+    std::vector<FieldT> m_empty;                // root of an empty subtree, per level
+    std::vector<std::vector<FieldT>> m_levels;  // nodes of each level, leaves first
+};
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_MERKLE_TREE_NATIVE_HPP_
+#endif
@@ -7,7 +7,10 @@
 #include "ethsnarks.hpp"
 #include "utils.hpp"
 #include "gadgets/onewayfunction.hpp"
+#include "gadgets/instanced_gadget.hpp"
+#include "gadgets/mimc_constants.hpp"
 #include "sha3.h"
+#include <algorithm>
 #include <mutex>
 
 
@@ -50,6 +53,7 @@ namespace ethsnarks {
 class MiMCe5_round : public GadgetT {
 public:
     static constexpr size_t N_ROUNDS = 110;
+    static constexpr size_t N_VARIABLES = 3;
     const VariableT x;
     const VariableT k;
     const FieldT& C;
@@ -70,9 +74,9 @@ public:
         GadgetT(pb, annotation_prefix),
         x(in_x), k(in_k), C(in_C),
         add_k_to_result(in_add_k_to_result),
-        a(make_variable(pb, FMT(annotation_prefix, ".a"))),
-        b(make_variable(pb, FMT(annotation_prefix, ".b"))),
-        c(make_variable(pb, FMT(annotation_prefix, ".c")))
+        a(make_variable(pb, pb_annotation(pb, annotation_prefix, ".a"))),
+        b(make_variable(pb, pb_annotation(pb, annotation_prefix, ".b"))),
+        c(make_variable(pb, pb_annotation(pb, annotation_prefix, ".c")))
     { }
 
     const VariableT& result() const
@@ -80,8 +84,19 @@ public:
         return c;
     }
 
+    /** t^5, natively */
+    static FieldT sbox( const FieldT& t )
+    {
+        const FieldT t2 = t * t;
+        return (t2 * t2) * t;
+    }
+
     void generate_r1cs_constraints()
     {
+        if( is_witness_only(this->pb) ) {
+            return;
+        }
+
         auto t = x + k + C;
         this->pb.add_r1cs_constraint(ConstraintT(t, t, a), ".a = t*t"); // x^2
         this->pb.add_r1cs_constraint(ConstraintT(a, a, b), ".b = a*a"); // x^4
@@ -95,19 +110,26 @@ public:
         }
     }
 
+    /**
+    * The values of a, b and c for t = x + k + C, natively, the last is
+    * the result
+    */
+    static void witness( const FieldT& t, const FieldT& val_k, const bool add_k, FieldT* out )
+    {
+        out[0] = t * t;
+        out[1] = out[0] * out[0];
+        out[2] = (out[1] * t) + (add_k ? val_k : FieldT::zero());
+    }
+
     void generate_r1cs_witness() const
     {
         const auto val_k = this->pb.val(k);
-        const auto t = this->pb.val(x) + val_k + C;
+        FieldT out[N_VARIABLES];
+        witness(this->pb.val(x) + val_k + C, val_k, add_k_to_result, out);
 
-        const auto val_a = t * t;
-        this->pb.val(a) = val_a;
-
-        const auto val_b = val_a * val_a;
-        this->pb.val(b) = val_b;
-
-        const FieldT result = (val_b * t) + (add_k_to_result ? val_k : FieldT::zero());
-        this->pb.val(c) = result;
+        this->pb.val(a) = out[0];
+        this->pb.val(b) = out[1];
+        this->pb.val(c) = out[2];
     }
 };
 
@@ -115,6 +137,7 @@ public:
 class MiMCe7_round : public GadgetT {
 public:
     static constexpr size_t N_ROUNDS = 91;
+    static constexpr size_t N_VARIABLES = 4;
     const VariableT x;
     const VariableT k;
     const FieldT& C;
@@ -136,10 +159,10 @@ public:
         GadgetT(pb, annotation_prefix),
         x(in_x), k(in_k), C(in_C),
         add_k_to_result(in_add_k_to_result),
-        a(make_variable(pb, FMT(annotation_prefix, ".a"))),
-        b(make_variable(pb, FMT(annotation_prefix, ".b"))),
-        c(make_variable(pb, FMT(annotation_prefix, ".c"))),
-        d(make_variable(pb, FMT(annotation_prefix, ".d")))
+        a(make_variable(pb, pb_annotation(pb, annotation_prefix, ".a"))),
+        b(make_variable(pb, pb_annotation(pb, annotation_prefix, ".b"))),
+        c(make_variable(pb, pb_annotation(pb, annotation_prefix, ".c"))),
+        d(make_variable(pb, pb_annotation(pb, annotation_prefix, ".d")))
     { }
 
     const VariableT& result() const
@@ -147,8 +170,19 @@ public:
         return d;
     }
 
+    /** t^7, natively */
+    static FieldT sbox( const FieldT& t )
+    {
+        const FieldT t2 = t * t;
+        return (t2 * (t2 * t2)) * t;
+    }
+
     void generate_r1cs_constraints()
     {
+        if( is_witness_only(this->pb) ) {
+            return;
+        }
+
         auto t = x + k + C;       
         this->pb.add_r1cs_constraint(ConstraintT(t, t, a), ".a = t*t == t^2"); // x^2
         this->pb.add_r1cs_constraint(ConstraintT(a, a, b), ".b = a*a == t^4"); // x^4
@@ -163,22 +197,28 @@ public:
         }
     }
 
+    /**
+    * The values of a, b, c and d for t = x + k + C, natively, the last is
+    * the result
+    */
+    static void witness( const FieldT& t, const FieldT& val_k, const bool add_k, FieldT* out )
+    {
+        out[0] = t * t;
+        out[1] = out[0] * out[0];
+        out[2] = out[0] * out[1];
+        out[3] = (out[2] * t) + (add_k ? val_k : FieldT::zero());
+    }
+
     void generate_r1cs_witness() const
     {
         const auto val_k = this->pb.val(k);
-        const auto t = this->pb.val(x) + val_k + C;
-
-        const auto val_a = t * t;
-        this->pb.val(a) = val_a;
+        FieldT out[N_VARIABLES];
+        witness(this->pb.val(x) + val_k + C, val_k, add_k_to_result, out);
 
-        const auto val_b = val_a * val_a;
-        this->pb.val(b) = val_b;
-
-        const auto val_c = val_a * val_b;
-        this->pb.val(c) = val_c;
-
-        const FieldT result = (val_c * t) + (add_k_to_result ? val_k : FieldT::zero());
-        this->pb.val(d) = result;
+        this->pb.val(a) = out[0];
+        this->pb.val(b) = out[1];
+        this->pb.val(c) = out[2];
+        this->pb.val(d) = out[3];
     }
 };
 
@@ -190,6 +230,9 @@ public:
     std::vector<RoundT> m_rounds;
     const VariableT k;
 
+    // The rounds' variables are one contiguous run, in order
+    bool m_contiguous;
+
     void _setup_gadgets(
         const VariableT in_x,
         const VariableT in_k,
@@ -203,8 +246,11 @@ public:
 
             bool is_last = (i == (in_round_constants.size() - 1));
 
-            m_rounds.emplace_back(this->pb, round_x, in_k, in_round_constants[i], is_last, FMT(annotation_prefix, ".round[%d]", i));
-        }   
+            m_rounds.emplace_back(this->pb, round_x, in_k, in_round_constants[i], is_last, pb_annotation(this->pb, annotation_prefix, ".round[%d]", i));
+        }
+
+        m_contiguous = ! m_rounds.empty()
+                    && (m_rounds.back().result().index + 1 - m_rounds.front().a.index) == (m_rounds.size() * RoundT::N_VARIABLES);
     }
 
 public:
@@ -233,6 +279,10 @@ public:
         _setup_gadgets(in_x, in_k, static_constants());
     }
 
+    // The rounds are many, hashes holding ciphers move them rather than copy
+    MiMC_gadget( const MiMC_gadget& ) = delete;
+    MiMC_gadget( MiMC_gadget&& ) = default;
+
     const VariableT& result () const
     {
         return m_rounds.back().result();
@@ -240,13 +290,42 @@ public:
 
     void generate_r1cs_constraints()
     {
+        if( is_witness_only(this->pb) ) {
+            return;
+        }
+
         for( auto& gadget : m_rounds )
         {
             gadget.generate_r1cs_constraints();
         }
     }
 
+    /**
+    * All rounds natively, the state stays in a local and each round's
+    * variables are written out in one pass over the protoboard
+    */
     void generate_r1cs_witness() const
+    {
+        if( ! m_contiguous )
+        {
+            generate_r1cs_witness_rounds();
+            return;
+        }
+
+        const FieldT val_k = this->pb.val(k);
+        FieldT state = this->pb.val(m_rounds.front().x);
+        FieldT* out = &this->pb.val(m_rounds.front().a);
+
+        for( const auto& gadget : m_rounds )
+        {
+            RoundT::witness(state + val_k + gadget.C, val_k, gadget.add_k_to_result, out);
+            state = out[RoundT::N_VARIABLES - 1];
+            out += RoundT::N_VARIABLES;
+        }
+    }
+
+    /** Each round's witness in turn, reading its input from the protoboard */
+    void generate_r1cs_witness_rounds() const
     {
         for( auto& gadget : m_rounds )
         {
@@ -257,16 +336,23 @@ public:
     /**
     * Caches the default round constants using a static variable
     *
-    * It is thread safe due to mutex lock, but must be initialised
-    * after libff's number system.
+    * They're parsed from MIMC_DEFAULT_CONSTANTS, rather than derived with
+    * SHA3, once and thread safe, but must be initialised after libff's
+    * number system.
     */
     static const std::vector<FieldT>& static_constants ()
     {
+        static_assert( RoundT::N_ROUNDS <= MIMC_DEFAULT_CONSTANTS_COUNT, "Not enough default round constants" );
+
         static std::vector<FieldT> round_constants;
         static std::once_flag flag;
 
         std::call_once(flag, [](){
-            constants_fill(round_constants);
+            round_constants.reserve(RoundT::N_ROUNDS);
+            for( size_t i = 0; i < RoundT::N_ROUNDS; i++ )
+            {
+                round_constants.emplace_back(MIMC_DEFAULT_CONSTANTS[i]);
+            }
         });
 
         return round_constants;
@@ -275,12 +361,12 @@ public:
     /**
     * Generate a sequence of round constants from an initial seed value.
     */
-    static void constants_fill( std::vector<FieldT>& round_constants, const char* seed = MIMC_SEED )
+    static void constants_fill( std::vector<FieldT>& round_constants, const char* seed = MIMC_SEED, size_t n_rounds = RoundT::N_ROUNDS )
     {
         // XXX: replace '32' with digest size in bytes
         const size_t DIGEST_SIZE_BYTES = 32;
 
-        round_constants.reserve(RoundT::N_ROUNDS);
+        round_constants.reserve(n_rounds);
 
         unsigned char output_digest[DIGEST_SIZE_BYTES];
 
@@ -290,7 +376,7 @@ public:
         sha3_Update(&ctx, seed, strlen(seed));
         memcpy(output_digest, sha3_Finalize(&ctx), DIGEST_SIZE_BYTES);
 
-        for( size_t i = 0; i < RoundT::N_ROUNDS; i++ )
+        for( size_t i = 0; i < n_rounds; i++ )
         {
             // Derive a sequence of hashes to use as round constants
             sha3_Init256(&ctx);
@@ -317,11 +403,11 @@ public:
         }
     }
 
-    static const std::vector<FieldT> constants( const char* seed = MIMC_SEED )
+    static std::vector<FieldT> constants( const char* seed = MIMC_SEED, size_t n_rounds = RoundT::N_ROUNDS )
     {
         std::vector<FieldT> round_constants;
 
-        constants_fill(round_constants, seed);
+        constants_fill(round_constants, seed, n_rounds);
 
         return round_constants;
     }
@@ -332,6 +418,47 @@ using MiMC_e5_gadget = MiMC_gadget<MiMCe5_round>;
 using MiMC_e7_gadget = MiMC_gadget<MiMCe7_round>;
 
 
+/**
+* MiMC_gadget with the default round constants, sharing the constraints of
+* one master, see instanced_gadget
+*/
+template<typename RoundT>
+class MiMC_gadget_instance : public instanced_gadget<MiMC_gadget<RoundT>>
+{
+public:
+    typedef MiMC_gadget<RoundT> Master;
+
+    VariableT m_result;
+
+    static Master* make_master( ProtoboardT& master_pb )
+    {
+        const VariableT x = make_variable(master_pb, ".dummy_inputs");
+        const VariableT k = make_variable(master_pb, ".dummy_inputs");
+        return new Master(master_pb, x, k, ".mimc_master");
+    }
+
+    MiMC_gadget_instance(
+        ProtoboardT& pb,
+        const VariableT in_x,
+        const VariableT in_k,
+        const std::string& annotation_prefix
+    ) :
+        instanced_gadget<Master>(pb, instance_variables({in_x, in_k}), VariableArrayT(), "mimc", make_master, annotation_prefix)
+    {
+        m_result = this->variable(this->master.gadget->result());
+    }
+
+    const VariableT& result () const
+    {
+        return m_result;
+    }
+};
+
+
+using MiMC_e5_instance = MiMC_gadget_instance<MiMCe5_round>;
+using MiMC_e7_instance = MiMC_gadget_instance<MiMCe7_round>;
+
+
 template<typename GadgetT>
 class MiMC_hash_MiyaguchiPreneel_gadget : public MiyaguchiPreneel_OWF<GadgetT>
 {
@@ -354,65 +481,107 @@ using MiMC_e5_hash_gadget = MiMC_hash_MiyaguchiPreneel_gadget<MiMC_e5_gadget>;
 
 
 
-const FieldT mimc( const std::vector<FieldT>& round_constants, const FieldT& x, const FieldT& k )
+/**
+* MiMC natively, for n independent pairs of x and k: out[i] = E_k[i](x[i])
+*
+* Inputs are evaluated LANES at a time, round by round, so the lanes'
+* multiplications don't depend on each other and their latency overlaps.
+*/
+template<typename RoundT, size_t LANES = 4>
+void mimc_native_batch( const std::vector<FieldT>& round_constants, const FieldT* x, const FieldT* k, FieldT* out, size_t n )
 {
-    ProtoboardT pb;
+    for( size_t offset = 0; offset < n; offset += LANES )
+    {
+        const size_t n_lanes = std::min(LANES, n - offset);
+        FieldT state[LANES];
 
-    const VariableT var_x = make_variable(pb, x, "x");
-    const VariableT var_k = make_variable(pb, k, "k");
-    pb.set_input_sizes(2);
+        for( size_t j = 0; j < n_lanes; j++ )
+        {
+            state[j] = x[offset + j];
+        }
 
-    MiMC_e7_gadget the_gadget(pb, var_x, var_k, round_constants, "the_gadget");
-    the_gadget.generate_r1cs_witness();
-    the_gadget.generate_r1cs_constraints();
+        for( const auto& C_i : round_constants )
+        {
+            for( size_t j = 0; j < n_lanes; j++ )
+            {
+                state[j] = RoundT::sbox(state[j] + k[offset + j] + C_i);
+            }
+        }
 
-    return pb.val(the_gadget.result());
+        for( size_t j = 0; j < n_lanes; j++ )
+        {
+            out[offset + j] = state[j] + k[offset + j];
+        }
+    }
 }
 
 
-const FieldT mimc( const FieldT& x, const FieldT& k )
+/**
+* The MiyaguchiPreneel_OWF of MiMC natively, for n messages of n_blocks
+* each, message i is m[i*n_blocks ... (i+1)*n_blocks-1]
+*
+* H_j = E_{H_{j-1}}(m_j) + H_{j-1} + m_j, where H_{-1} is the IV
+*/
+template<typename RoundT, size_t LANES = 4>
+void mimc_hash_native_batch( const std::vector<FieldT>& round_constants, const FieldT* m, size_t n_blocks, size_t n, const FieldT& IV, FieldT* out )
 {
-    return mimc(MiMC_e7_gadget::static_constants(), x, k);
+    const size_t CHUNK_SIZE = 1024;
+    const long n_chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( long chunk = 0; chunk < n_chunks; chunk++ )
+    {
+        const size_t offset = chunk * CHUNK_SIZE;
+        const size_t n_chunk = std::min(CHUNK_SIZE, n - offset);
+        std::vector<FieldT> H(n_chunk, IV), x(n_chunk), E(n_chunk);
+
+        for( size_t j = 0; j < n_blocks; j++ )
+        {
+            for( size_t i = 0; i < n_chunk; i++ )
+            {
+                x[i] = m[(offset + i) * n_blocks + j];
+            }
+
+            mimc_native_batch<RoundT, LANES>(round_constants, x.data(), H.data(), E.data(), n_chunk);
+
+            for( size_t i = 0; i < n_chunk; i++ )
+            {
+                H[i] += E[i] + x[i];
+            }
+        }
+
+        std::copy(H.begin(), H.end(), out + offset);
+    }
 }
 
 
-const FieldT mimc_hash( const std::vector<FieldT>& m, const FieldT& k )
+inline const FieldT mimc( const std::vector<FieldT>& round_constants, const FieldT& x, const FieldT& k )
 {
-    ProtoboardT pb;
+    FieldT result;
+    mimc_native_batch<MiMCe7_round>(round_constants, &x, &k, &result, 1);
+    return result;
+}
 
-    std::vector<VariableT> var_m;
-    var_m.reserve(m.size());
-    for( const auto& m_i : m )
-    {
-        var_m.emplace_back(make_variable(pb, m_i, "k"));
-    }
 
-    const auto var_k = make_variable(pb, k, "k");
-    pb.set_input_sizes(m.size() + 1);
+inline const FieldT mimc( const FieldT& x, const FieldT& k )
+{
+    return mimc(MiMC_e7_gadget::static_constants(), x, k);
+}
 
-    MiMC_e7_hash_gadget the_gadget(pb, var_k, var_m, "the_gadget");
-    the_gadget.generate_r1cs_witness();
-    the_gadget.generate_r1cs_constraints();
 
-    // Debug internal state of one-way-function
-    /*
-    int i = 0;
-    for( const auto& c : the_gadget.m_ciphers )
-    {
-        std::cout << "k "; pb.val(c.k).print();
-        std::cout << "x_i "; pb.val(c.m_rounds[0].x).print();
-        std::cout << "r "; pb.val(c.m_rounds.back().result()).print();
-        std::cout << "= "; pb.val(the_gadget.m_outputs[i]).print();
-        std::cout << std::endl;
-        i += 1;
+inline const FieldT mimc_hash( const std::vector<FieldT>& m, const FieldT& k )
+{
+    FieldT result = k;
+    if( m.size() ) {
+        mimc_hash_native_batch<MiMCe7_round>(MiMC_e7_gadget::static_constants(), m.data(), m.size(), 1, k, &result);
     }
-    */
-
-    return pb.val(the_gadget.result());
+    return result;
 }
 
 
-const FieldT mimc_hash( const std::vector<FieldT>& m )
+inline const FieldT mimc_hash( const std::vector<FieldT>& m )
 {
     return mimc_hash(m, FieldT::zero());
 }
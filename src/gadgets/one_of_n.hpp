@@ -8,6 +8,7 @@
 #include <libsnark/gadgetlib1/gadgets/basic_gadgets.hpp>
 
 #include "ethsnarks.hpp"
+#include "utils.hpp"
 
 using libsnark::generate_boolean_r1cs_constraint;
 
@@ -130,6 +131,152 @@ public:
 };
 
 
+/**
+* Verifies an Input exists within a set of items, selecting it by index
+*
+*   e.g. MyValue == Values[index]
+*
+* The bits of the index choose the item through a tree of multiplexers,
+* the lowest bit picks one item of each pair, the next bit one of each
+* pair of those, and so on. Each multiplexer is one constraint:
+*
+*   (right - left) * bit = out - left
+*
+* The last multiplexer's output is `our_item`, so this takes `N - 1`
+* constraints and the booleanity of `log2(N)` bits, instead of the
+* `3N + 1` of one_of_n, and there are no toggles to fill in.
+*
+* When a level has an odd number of nodes the last one is carried up as
+* it is, whatever its bit, so indices past the end select one of the last
+* items rather than failing.
+*
+* When the set is only known by its Merkle root, prove membership with a
+* merkle_path_authenticator instead, its cost depends on the depth alone.
+*/
+class one_of_n_indexed : public GadgetT
+{
+public:
+    const VariableT our_item;
+    const VariableArrayT items;
+
+    // Index of our item, LSB first
+    VariableArrayT index_bits;
+
+    // Nodes of each level, from the items to our item
+    std::vector<VariableArrayT> levels;
+
+    static size_t depth( size_t n_items )
+    {
+        size_t result = 0;
+        while( (size_t(1) << result) < n_items ) {
+            result++;
+        }
+        return result;
+    }
+
+    one_of_n_indexed(
+        ProtoboardT &in_pb,
+        const VariableT &in_our_item,
+        const VariableArrayT &in_items,
+        const std::string &in_annotation_prefix=""
+    ) :
+        GadgetT(in_pb, in_annotation_prefix),
+        our_item(in_our_item),
+        items(in_items),
+        index_bits(make_var_array(in_pb, depth(in_items.size()), FMT(this->annotation_prefix, ".index_bits")))
+    {
+        assert( in_items.size() > 0 );
+
+        levels.push_back(in_items);
+        for( size_t level = 1; level < index_bits.size(); level++ )
+        {
+            const VariableArrayT& nodes = levels.back();
+            VariableArrayT outputs;
+            for( size_t i = 0; (2*i) + 1 < nodes.size(); i++ )
+            {
+                outputs.emplace_back();
+                outputs.back().allocate(in_pb, FMT(this->annotation_prefix, ".levels[%zu][%zu]", level, i));
+            }
+            if( nodes.size() % 2 ) {
+                outputs.push_back(nodes.back());
+            }
+            levels.push_back(outputs);
+        }
+        levels.push_back(VariableArrayT(1, in_our_item));
+    }
+
+    void generate_r1cs_constraints()
+    {
+        for( size_t i = 0; i < index_bits.size(); i++ )
+        {
+            generate_boolean_r1cs_constraint<FieldT>(pb, index_bits[i], FMT(this->annotation_prefix, ".index_bits[%zu]", i));
+        }
+
+        if( index_bits.empty() )
+        {
+            pb.add_r1cs_constraint(
+                ConstraintT(items[0], FieldT::one(), our_item),
+                FMT(this->annotation_prefix, ".selected"));
+            return;
+        }
+
+        for( size_t level = 0; level < index_bits.size(); level++ )
+        {
+            const auto& nodes = levels[level];
+            const auto& outputs = levels[level + 1];
+
+            for( size_t i = 0; (2*i) + 1 < nodes.size(); i++ )
+            {
+                const auto& left = nodes[2*i];
+                pb.add_r1cs_constraint(
+                    ConstraintT(nodes[(2*i) + 1] - left, index_bits[level], outputs[i] - left),
+                    FMT(this->annotation_prefix, ".levels[%zu][%zu]", level + 1, i));
+            }
+        }
+    }
+
+    /**
+    * Finds our item in the set, then selects it
+    */
+    void generate_r1cs_witness()
+    {
+        const auto value = pb.val(our_item);
+        for( size_t i = 0; i < items.size(); i++ )
+        {
+            if( pb.val(items[i]) == value )
+            {
+                generate_r1cs_witness(i);
+                return;
+            }
+        }
+
+        // Not in the set, it won't be satisfied
+        generate_r1cs_witness(0);
+    }
+
+    /**
+    * Selects the item at a known index
+    */
+    void generate_r1cs_witness( size_t index )
+    {
+        assert( index < items.size() );
+        index_bits.fill_with_bits_of_ulong(pb, index);
+
+        // Our item is the output of the last level, it's already set
+        for( size_t level = 0; level + 2 < levels.size(); level++ )
+        {
+            const auto& nodes = levels[level];
+            const bool bit = (index >> level) & 1;
+
+            for( size_t i = 0; (2*i) + 1 < nodes.size(); i++ )
+            {
+                pb.val(levels[level + 1][i]) = pb.val(nodes[(2*i) + bit]);
+            }
+        }
+    }
+};
+
+
 // ethsnarks
 }
 
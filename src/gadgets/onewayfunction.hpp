@@ -6,6 +6,7 @@
 
 #include "ethsnarks.hpp"
 #include "utils.hpp"
+#include "gadgets/instanced_gadget.hpp"
 
 namespace ethsnarks {
 
@@ -31,22 +32,28 @@ public:
 		GadgetT(in_pb, in_annotation_prefix),
 		m_messages(in_messages)
 	{
+		m_ciphers.reserve(in_messages.size());
+
 		for( size_t i = 0; i < in_messages.size(); i++ )
 		{
 			const auto& m_i = in_messages[i];
 
 			const VariableT& round_key = (i == 0 ? in_IV : m_ciphers[i-1].result());
 
-			m_ciphers.emplace_back( in_pb, m_i, round_key, FMT(in_annotation_prefix, ".cipher[%d]", i) );
+			m_ciphers.emplace_back( in_pb, m_i, round_key, pb_annotation(in_pb, in_annotation_prefix, ".cipher[%d]", i) );
 		}
 	}
 
 	const VariableT& result() const {
-		return m_ciphers.back();
+		return m_ciphers.back().result();
 	}
 
 	void generate_r1cs_constraints ()
 	{
+		if( is_witness_only(this->pb) ) {
+			return;
+		}
+
 		for( auto& gadget : m_ciphers )
 		{
 			gadget.generate_r1cs_constraints();
@@ -63,6 +70,45 @@ public:
 };
 
 
+/**
+* MerkleDamgard_OWF sharing the constraints of one master per number of
+* messages, see instanced_gadget
+*/
+template<class CipherT>
+class MerkleDamgard_OWF_instance : public instanced_gadget<MerkleDamgard_OWF<CipherT>>
+{
+public:
+	typedef MerkleDamgard_OWF<CipherT> Master;
+
+	VariableT m_result;
+
+	MerkleDamgard_OWF_instance(
+		ProtoboardT& in_pb,
+		const VariableT& in_IV,
+		const std::vector<VariableT>& in_messages,
+		const std::string &in_annotation_prefix
+	) :
+		instanced_gadget<Master>(
+			in_pb,
+			flatten({instance_variables({in_IV}), VariableArrayT(in_messages.begin(), in_messages.end())}),
+			VariableArrayT(),
+			std::to_string(in_messages.size()),
+			[&in_messages]( ProtoboardT& master_pb ) {
+				const VariableT IV = make_variable(master_pb, ".dummy_inputs");
+				const auto messages = make_var_array(master_pb, in_messages.size(), ".dummy_inputs");
+				return new Master(master_pb, IV, std::vector<VariableT>(messages.begin(), messages.end()), ".merkledamgard_master");
+			},
+			in_annotation_prefix)
+	{
+		m_result = this->variable(this->master.gadget->result());
+	}
+
+	const VariableT& result() const {
+		return m_result;
+	}
+};
+
+
 template<class CipherT>
 class MiyaguchiPreneel_OWF : public GadgetT
 {
@@ -83,13 +129,15 @@ public:
 		m_outputs(make_var_array(in_pb, in_messages.size(), FMT(in_annotation_prefix, ".outputs"))),
 		m_IV(in_IV)
 	{
+		m_ciphers.reserve(in_messages.size());
+
 		for( size_t i = 0; i < in_messages.size(); i++ )
 		{
 			const auto& m_i = in_messages[i];
 
 			const VariableT& round_key = (i == 0 ? in_IV : m_outputs[i-1]);
 
-			m_ciphers.emplace_back( in_pb, m_i, round_key, FMT(in_annotation_prefix, ".cipher[%d]", i) );
+			m_ciphers.emplace_back( in_pb, m_i, round_key, pb_annotation(in_pb, in_annotation_prefix, ".cipher[%d]", i) );
 		}
 	}
 
@@ -99,6 +147,10 @@ public:
 
 	void generate_r1cs_constraints ()
 	{
+		if( is_witness_only(this->pb) ) {
+			return;
+		}
+
 		for( size_t i = 0; i < m_ciphers.size(); i++ )
 		{
 			m_ciphers[i].generate_r1cs_constraints();
@@ -5,9 +5,13 @@
 // License: LGPL-3.0+
 
 #include "ethsnarks.hpp"
+#include "utils.hpp"
 #include "crypto/blake2b.h"
+#include "gadgets/instanced_gadget.hpp"
 
+#include <algorithm>
 #include <mutex>
+#include <type_traits>
 
 namespace ethsnarks {
 
@@ -33,14 +37,18 @@ public:
 		const std::string& annotation_prefix
 	) :
 		GadgetT(pb, annotation_prefix),
-		x2(make_variable(pb, FMT(annotation_prefix, ".x2"))),
-		x4(make_variable(pb, FMT(annotation_prefix, ".x4"))),
-		x5(make_variable(pb, FMT(annotation_prefix, ".x5")))
+		x2(make_variable(pb, pb_annotation(pb, annotation_prefix, ".x2"))),
+		x4(make_variable(pb, pb_annotation(pb, annotation_prefix, ".x4"))),
+		x5(make_variable(pb, pb_annotation(pb, annotation_prefix, ".x5")))
 	{
 	}
 
 	void generate_r1cs_constraints(const linear_combination<FieldT>& x) const
 	{
+		if( is_witness_only(this->pb) ) {
+			return;
+		}
+
 		pb.add_r1cs_constraint(ConstraintT(x, x, x2), ".x^2 = x * x");
 		pb.add_r1cs_constraint(ConstraintT(x2, x2, x4), ".x^4 = x2 * x2");
 		pb.add_r1cs_constraint(ConstraintT(x, x4, x5), ".x^5 = x * x4");
@@ -84,7 +92,7 @@ static void poseidon_constants_fill(const std::string &seed, unsigned n_constant
 }
 
 
-static const std::vector<FieldT> poseidon_constants(const std::string &seed, unsigned n_constants)
+static std::vector<FieldT> poseidon_constants(const std::string &seed, unsigned n_constants)
 {
 	std::vector<FieldT> result;
 	poseidon_constants_fill(seed, n_constants, result);
@@ -96,7 +104,7 @@ static void poseidon_matrix_fill(const std::string &seed, unsigned t, std::vecto
 {
 	const std::vector<FieldT> c = poseidon_constants(seed, t*2);
 
-	result.reserve(t*2);
+	result.reserve(t*t);
 
 	for( unsigned i = 0; i < t; i++ )
 	{
@@ -108,7 +116,7 @@ static void poseidon_matrix_fill(const std::string &seed, unsigned t, std::vecto
 }
 
 
-static const std::vector<FieldT> poseidon_matrix(const std::string &seed, unsigned t)
+static std::vector<FieldT> poseidon_matrix(const std::string &seed, unsigned t)
 {
 	std::vector<FieldT> result;
 	poseidon_matrix_fill(seed, t, result);
@@ -131,6 +139,287 @@ const PoseidonConstants& poseidon_params()
 }
 
 
+/**
+* Solves `A * x = b` for `x`, where `A` is an invertible `n * n` matrix
+*/
+static std::vector<FieldT> poseidon_solve(std::vector<FieldT> A, std::vector<FieldT> b, unsigned n)
+{
+	for( unsigned col = 0; col < n; col++ )
+	{
+		unsigned pivot = col;
+		while( A[pivot*n + col].is_zero() ) {
+			pivot++;
+			assert( pivot < n );
+		}
+
+		if( pivot != col )
+		{
+			for( unsigned j = 0; j < n; j++ ) {
+				std::swap(A[col*n + j], A[pivot*n + j]);
+			}
+			std::swap(b[col], b[pivot]);
+		}
+
+		const FieldT inv = A[col*n + col].inverse();
+		for( unsigned j = 0; j < n; j++ ) {
+			A[col*n + j] *= inv;
+		}
+		b[col] *= inv;
+
+		for( unsigned row = 0; row < n; row++ )
+		{
+			const FieldT f = A[row*n + col];
+			if( row == col || f.is_zero() ) {
+				continue;
+			}
+			for( unsigned j = 0; j < n; j++ ) {
+				A[row*n + j] -= f * A[col*n + j];
+			}
+			b[row] -= f * b[col];
+		}
+	}
+
+	return b;
+}
+
+
+/**
+* The partial rounds, when only the first element goes through the sbox,
+* rewritten so that each one is cheap (iacr.org/2019/458 Appendix B):
+*
+*  - The round constant added to the other elements passes through the
+*    sbox untouched, so is carried forward through the matrix into the
+*    next round, leaving one `kappa` per round for the first element and
+*    `delta`, added to the state after the partial rounds.
+*
+*  - Each round's matrix is factored into `diag(1, B) * S`, with `S` sparse:
+*    its first row `a00, w`, its first column `a00, v` and the identity
+*    elsewhere. `diag(1, B)` doesn't touch the first element, so it moves
+*    into the next round's matrix, and the last `B` is applied once after
+*    the partial rounds.
+*
+* A round is then `x = sbox(z[0] + kappa)`, `z[0] = a00*x + w.z[1..]` and
+* `z[1..] += v*x`, 2t multiplications instead of t*t.
+*/
+struct PoseidonSparseConstants
+{
+	std::vector<FieldT> kappa;	// `P` constants for the first element
+	std::vector<FieldT> a00;	// `P` corners of the sparse matrices
+	std::vector<FieldT> w;		// `P * (t-1)`, first rows of the sparse matrices
+	std::vector<FieldT> v;		// `P * (t-1)`, first columns of the sparse matrices
+	std::vector<FieldT> B;		// `(t-1) * (t-1)`, applied after the partial rounds
+	std::vector<FieldT> delta;	// `t` constants added after the partial rounds
+};
+
+
+template<unsigned param_t, unsigned param_F, unsigned param_P>
+const PoseidonSparseConstants& poseidon_sparse_params()
+{
+	static PoseidonSparseConstants sparse;
+	static std::once_flag flag;
+
+	std::call_once(flag, [](){
+		const auto& constants = poseidon_params<param_t, param_F, param_P>();
+		const auto& M = constants.M;
+		const unsigned t = param_t;
+		const unsigned n = t - 1;
+
+		// Carry the constants of all but the first element forward
+		std::vector<FieldT> d(t, FieldT::zero());
+		for( unsigned r = 0; r < param_P; r++ )
+		{
+			const FieldT& C_r = constants.C[(param_F/2) + r];
+			sparse.kappa.emplace_back(d[0] + C_r);
+
+			std::vector<FieldT> next(t, FieldT::zero());
+			for( unsigned i = 0; i < t; i++ ) {
+				for( unsigned j = 1; j < t; j++ ) {
+					next[i] += M[i*t + j] * (d[j] + C_r);
+				}
+			}
+			d = next;
+		}
+		sparse.delta = d;
+
+		// Factor `M * diag(1, B)` of each round into `diag(1, A_hat) * S`
+		std::vector<FieldT> B(n*n, FieldT::zero());
+		for( unsigned i = 0; i < n; i++ ) {
+			B[i*n + i] = FieldT::one();
+		}
+
+		for( unsigned r = 0; r < param_P; r++ )
+		{
+			std::vector<FieldT> A(t*t, FieldT::zero());
+			for( unsigned i = 0; i < t; i++ )
+			{
+				A[i*t] = M[i*t];
+				for( unsigned j = 1; j < t; j++ ) {
+					for( unsigned k = 1; k < t; k++ ) {
+						A[i*t + j] += M[i*t + k] * B[(k-1)*n + (j-1)];
+					}
+				}
+			}
+
+			std::vector<FieldT> A_hat, A_col;
+			for( unsigned i = 1; i < t; i++ )
+			{
+				A_col.emplace_back(A[i*t]);
+				for( unsigned j = 1; j < t; j++ ) {
+					A_hat.emplace_back(A[i*t + j]);
+				}
+			}
+
+			sparse.a00.emplace_back(A[0]);
+			sparse.w.insert(sparse.w.end(), A.begin() + 1, A.begin() + t);
+			const auto v = poseidon_solve(A_hat, A_col, n);
+			sparse.v.insert(sparse.v.end(), v.begin(), v.end());
+			B = A_hat;
+		}
+		sparse.B = B;
+	});
+
+	return sparse;
+}
+
+
+/**
+* Evaluates the partial rounds on the state, with the sparse matrices,
+* calling `on_sbox(round, x)` with the input of each round's sbox.
+*/
+template<unsigned param_t, unsigned param_F, unsigned param_P, typename SBoxCallbackT>
+void poseidon_sparse_partial_rounds(std::vector<FieldT>& z, const SBoxCallbackT& on_sbox)
+{
+	const auto& sparse = poseidon_sparse_params<param_t, param_F, param_P>();
+	const unsigned n = param_t - 1;
+
+	for( unsigned r = 0; r < param_P; r++ )
+	{
+		const FieldT in = z[0] + sparse.kappa[r];
+		on_sbox(r, in);
+
+		const FieldT in2 = in * in;
+		const FieldT x = (in2 * in2) * in;
+
+		FieldT z0 = sparse.a00[r] * x;
+		for( unsigned j = 1; j < param_t; j++ )
+		{
+			z0 += sparse.w[r*n + (j-1)] * z[j];
+			z[j] += sparse.v[r*n + (j-1)] * x;
+		}
+		z[0] = z0;
+	}
+
+	std::vector<FieldT> y(param_t, FieldT::zero());
+	y[0] = z[0] + sparse.delta[0];
+	for( unsigned i = 1; i < param_t; i++ )
+	{
+		y[i] = sparse.delta[i];
+		for( unsigned j = 1; j < param_t; j++ ) {
+			y[i] += sparse.B[(i-1)*n + (j-1)] * z[j];
+		}
+	}
+	z = y;
+}
+
+
+/**
+* The Poseidon permutation natively, returns the whole state
+*/
+template<unsigned param_t, unsigned param_c, unsigned param_F, unsigned param_P>
+std::vector<FieldT> poseidon_permute(const std::vector<FieldT>& inputs)
+{
+	const auto& constants = poseidon_params<param_t, param_F, param_P>();
+	const unsigned partial_begin = param_F/2;
+	const unsigned partial_end = partial_begin + param_P;
+
+	assert( inputs.size() <= param_t );
+	std::vector<FieldT> state(param_t, FieldT::zero());
+	std::copy(inputs.begin(), inputs.end(), state.begin());
+
+	std::vector<FieldT> mixed(param_t);
+	for( unsigned i = 0; i < (param_F + param_P); i++ )
+	{
+		if( i == partial_begin && param_c == 1 )
+		{
+			poseidon_sparse_partial_rounds<param_t, param_F, param_P>(state, [](unsigned, const FieldT&){});
+			i = partial_end - 1;
+			continue;
+		}
+
+		const unsigned n_sbox = (i < partial_begin || i >= partial_end) ? param_t : param_c;
+		for( unsigned j = 0; j < param_t; j++ )
+		{
+			state[j] += constants.C[i];
+			if( j < n_sbox ) {
+				const FieldT x2 = state[j] * state[j];
+				state[j] = (x2 * x2) * state[j];
+			}
+		}
+
+		for( unsigned j = 0; j < param_t; j++ )
+		{
+			mixed[j] = FieldT::zero();
+			for( unsigned k = 0; k < param_t; k++ ) {
+				mixed[j] += constants.M[j*param_t + k] * state[k];
+			}
+		}
+		state.swap(mixed);
+	}
+
+	return state;
+}
+
+
+/**
+* Hashes n independent messages natively, across all cores: out[i] is the
+* first element of the permutation of m[i*n_inputs ... (i+1)*n_inputs-1]
+*/
+template<unsigned param_t, unsigned param_c, unsigned param_F, unsigned param_P>
+void poseidon_hash_batch(const FieldT* m, size_t n_inputs, size_t n, FieldT* out)
+{
+	// Derive the constants before the threads need them
+	poseidon_params<param_t, param_F, param_P>();
+	if( param_c == 1 ) {
+		poseidon_sparse_params<param_t, param_F, param_P>();
+	}
+
+	const long n_messages = n;
+#ifdef MULTICORE
+	#pragma omp parallel for
+#endif
+	for( long i = 0; i < n_messages; i++ )
+	{
+		const std::vector<FieldT> inputs(m + i*n_inputs, m + (i+1)*n_inputs);
+		out[i] = poseidon_permute<param_t, param_c, param_F, param_P>(inputs)[0];
+	}
+}
+
+
+/**
+* Permutes n independent states natively, across all cores
+*/
+template<unsigned param_t, unsigned param_c, unsigned param_F, unsigned param_P>
+std::vector<std::vector<FieldT>> poseidon_permute_batch(const std::vector<std::vector<FieldT>>& states)
+{
+	poseidon_params<param_t, param_F, param_P>();
+	if( param_c == 1 ) {
+		poseidon_sparse_params<param_t, param_F, param_P>();
+	}
+
+	std::vector<std::vector<FieldT>> result(states.size());
+	const long n_states = states.size();
+#ifdef MULTICORE
+	#pragma omp parallel for
+#endif
+	for( long i = 0; i < n_states; i++ )
+	{
+		result[i] = poseidon_permute<param_t, param_c, param_F, param_P>(states[i]);
+	}
+
+	return result;
+}
+
+
 /**
 * One round of the Poseidon permutation:
 *
@@ -160,7 +449,7 @@ public:
 		ret.reserve(nSBox);
 		for( unsigned h = 0; h < nSBox; h++ )
 		{
-			ret.emplace_back( in_pb, FMT(annotation_prefix, ".sbox[%u]", h) );
+			ret.emplace_back( in_pb, pb_annotation(in_pb, annotation_prefix, ".sbox[%u]", h) );
 		}
 
 		return ret;
@@ -252,6 +541,10 @@ public:
 
 	void generate_r1cs_constraints() const
 	{
+		if( is_witness_only(this->pb) ) {
+			return;
+		}
+
 		for( unsigned h = 0; h < nSBox; h++ )
 		{
 			if( h < nInputs ) {
@@ -265,12 +558,158 @@ public:
 };
 
 
+/**
+* The partial rounds, each a Poseidon_Round which runs the sbox on `c` elements
+*/
+template<unsigned param_t, unsigned param_c, unsigned param_F, unsigned param_P>
+class Poseidon_DensePartialRounds : public GadgetT {
+public:
+	typedef Poseidon_Round<param_t, param_c, param_t, param_t> PartialRoundT;
+
+	std::vector<PartialRoundT> rounds;
+	const std::vector<libsnark::linear_combination<FieldT> >& outputs;
+
+	static std::vector<PartialRoundT> make_rounds(
+		ProtoboardT& in_pb,
+		const PoseidonConstants& in_constants,
+		const std::vector<libsnark::linear_combination<FieldT> >& in_state,
+		const std::string& annotation_prefix )
+	{
+		std::vector<PartialRoundT> result;
+		result.reserve(param_P);
+
+		for( unsigned i = (param_F/2); i < (param_F/2) + param_P; i++ )
+		{
+			const auto& state = result.empty() ? in_state : result.back().outputs;
+			result.emplace_back(in_pb, in_constants.C[i], in_constants.M, state, pb_annotation(in_pb, annotation_prefix, ".round[%u]", i));
+		}
+
+		return result;
+	}
+
+	Poseidon_DensePartialRounds(
+		ProtoboardT &in_pb,
+		const PoseidonConstants& in_constants,
+		const std::vector<libsnark::linear_combination<FieldT> >& in_state,
+		const std::string& annotation_prefix
+	) :
+		GadgetT(in_pb, annotation_prefix),
+		rounds(make_rounds(in_pb, in_constants, in_state, annotation_prefix)),
+		outputs(rounds.back().outputs)
+	{ }
+
+	// A copy's outputs would refer to the original's rounds, a move keeps them
+	Poseidon_DensePartialRounds( const Poseidon_DensePartialRounds& ) = delete;
+	Poseidon_DensePartialRounds( Poseidon_DensePartialRounds&& ) = default;
+
+	void generate_r1cs_constraints() const
+	{
+		for( auto& round : rounds ) {
+			round.generate_r1cs_constraints();
+		}
+	}
+
+	void generate_r1cs_witness() const
+	{
+		for( auto& round : rounds ) {
+			round.generate_r1cs_witness();
+		}
+	}
+};
+
+
+/**
+* The partial rounds with one sbox each, using PoseidonSparseConstants
+*
+* The sboxes are allocated in the same order, and each output is the same
+* linear combination of them as with Poseidon_DensePartialRounds, but they
+* take 2t operations per round to make rather than t*t. The witness is
+* computed on the values of the state, instead of evaluating the linear
+* combinations, which grow with every round.
+*/
+template<unsigned param_t, unsigned param_c, unsigned param_F, unsigned param_P>
+class Poseidon_SparsePartialRounds : public GadgetT {
+public:
+	const PoseidonSparseConstants& sparse;
+	const std::vector<libsnark::linear_combination<FieldT> > state;
+	std::vector<FifthPower_gadget> sboxes;
+	std::vector<libsnark::linear_combination<FieldT> > sbox_inputs;
+	std::vector<libsnark::linear_combination<FieldT> > outputs;
+
+	Poseidon_SparsePartialRounds(
+		ProtoboardT &in_pb,
+		const PoseidonConstants& in_constants,
+		const std::vector<libsnark::linear_combination<FieldT> >& in_state,
+		const std::string& annotation_prefix
+	) :
+		GadgetT(in_pb, annotation_prefix),
+		sparse(poseidon_sparse_params<param_t, param_F, param_P>()),
+		state(in_state)
+	{
+		static_assert( param_c == 1, "Sparse partial rounds need one sbox per round" );
+		const unsigned n = param_t - 1;
+
+		sboxes.reserve(param_P);
+		sbox_inputs.reserve(param_P);
+
+		auto z = in_state;
+		for( unsigned r = 0; r < param_P; r++ )
+		{
+			sbox_inputs.emplace_back(z[0] + sparse.kappa[r]);
+			sboxes.emplace_back(in_pb, pb_annotation(in_pb, annotation_prefix, ".round[%u].sbox[0]", (param_F/2) + r));
+			const VariableT& x = sboxes.back().result();
+
+			linear_combination<FieldT> z0(x * sparse.a00[r]);
+			for( unsigned j = 1; j < param_t; j++ )
+			{
+				z0 = z0 + (z[j] * sparse.w[r*n + (j-1)]);
+				z[j] = z[j] + (x * sparse.v[r*n + (j-1)]);
+			}
+			z[0] = z0;
+		}
+
+		outputs.reserve(param_t);
+		outputs.emplace_back(z[0] + sparse.delta[0]);
+		for( unsigned i = 1; i < param_t; i++ )
+		{
+			linear_combination<FieldT> lc;
+			lc.add_term(libsnark::ONE, sparse.delta[i]);
+			for( unsigned j = 1; j < param_t; j++ ) {
+				lc = lc + (z[j] * sparse.B[(i-1)*n + (j-1)]);
+			}
+			outputs.emplace_back(lc);
+		}
+	}
+
+	void generate_r1cs_constraints() const
+	{
+		if( is_witness_only(this->pb) ) {
+			return;
+		}
+
+		for( unsigned r = 0; r < param_P; r++ ) {
+			sboxes[r].generate_r1cs_constraints(sbox_inputs[r]);
+		}
+	}
+
+	void generate_r1cs_witness() const
+	{
+		auto z = vals(this->pb, state);
+		poseidon_sparse_partial_rounds<param_t, param_F, param_P>(z, [this](unsigned r, const FieldT& x) {
+			sboxes[r].generate_r1cs_witness(x);
+		});
+	}
+};
+
+
 template<unsigned param_t, unsigned param_c, unsigned param_F, unsigned param_P, unsigned nInputs, unsigned nOutputs, bool constrainOutputs=true>
 class Master_Poseidon_gadget_T : public GadgetT
 {
 protected:
 	typedef Poseidon_Round<param_t, param_t, nInputs, param_t> FirstRoundT;    // ingests `nInput` elements, expands to `t` elements using round constants
-	typedef Poseidon_Round<param_t, param_c, param_t, param_t> PartialRoundT;  // partial round only runs sbox on `c` elements (capacity)
+	typedef typename std::conditional<param_c == 1,                           // partial rounds only run sbox on `c` elements (capacity)
+		Poseidon_SparsePartialRounds<param_t, param_c, param_F, param_P>,
+		Poseidon_DensePartialRounds<param_t, param_c, param_F, param_P>>::type PartialRoundsT;
 	typedef Poseidon_Round<param_t, param_t, param_t, param_t> FullRoundT;     // full bandwidth
 	typedef Poseidon_Round<param_t, param_t, param_t, nOutputs> LastRoundT;   // squeezes state into `nOutputs`
 
@@ -288,7 +727,7 @@ public:
 	const PoseidonConstants& constants;
 	FirstRoundT first_round;
 	std::vector<FullRoundT> prefix_full_rounds;
-	std::vector<PartialRoundT> partial_rounds;
+	PartialRoundsT partial_rounds;
 	std::vector<FullRoundT> suffix_full_rounds;
 	LastRoundT last_round;
 
@@ -296,7 +735,7 @@ public:
 	const VariableArrayT _output_vars;
 
 	template<typename T>
-	static const std::vector<T> make_rounds(
+	static std::vector<T> make_rounds(
 		unsigned n_begin, unsigned n_end,
 		ProtoboardT& pb,
 		const std::vector<libsnark::linear_combination<FieldT> >& inputs,
@@ -309,7 +748,7 @@ public:
 		for( unsigned i = n_begin; i < n_end; i++ )
 		{
 			const auto& state = (i == n_begin) ? inputs : result.back().outputs;
-			result.emplace_back(pb, constants.C[i], constants.M, state, FMT(annotation_prefix, ".round[%u]", i));
+			result.emplace_back(pb, constants.C[i], constants.M, state, pb_annotation(pb, annotation_prefix, ".round[%u]", i));
 		}
 
 		return result;
@@ -322,20 +761,17 @@ public:
 	) :
 		GadgetT(pb, annotation_prefix),
 		constants(poseidon_params<param_t, param_F, param_P>()),
-		first_round(pb, constants.C[0], constants.M, in_inputs, FMT(annotation_prefix, ".round[0]")),
+		first_round(pb, constants.C[0], constants.M, in_inputs, pb_annotation(pb, annotation_prefix, ".round[0]")),
 		prefix_full_rounds(
 			make_rounds<FullRoundT>(
 				1, partial_begin, pb,
 				first_round.outputs, constants, annotation_prefix)),
-		partial_rounds(
-			make_rounds<PartialRoundT>(
-				partial_begin, partial_end, pb,
-				prefix_full_rounds.back().outputs, constants, annotation_prefix)),
+		partial_rounds(pb, constants, prefix_full_rounds.back().outputs, annotation_prefix),
 		suffix_full_rounds(
 			make_rounds<FullRoundT>(
 				partial_end, total_rounds-1, pb,
-				partial_rounds.back().outputs, constants, annotation_prefix)),
-		last_round(pb, constants.C.back(), constants.M, suffix_full_rounds.back().outputs, FMT(annotation_prefix, ".round[%u]", total_rounds-1)),
+				partial_rounds.outputs, constants, annotation_prefix)),
+		last_round(pb, constants.C.back(), constants.M, suffix_full_rounds.back().outputs, pb_annotation(pb, annotation_prefix, ".round[%u]", total_rounds-1)),
 		_output_vars(constrainOutputs ? make_var_array(pb, nOutputs, ".output") : VariableArrayT())
 	{
 
@@ -343,15 +779,17 @@ public:
 
 	void generate_r1cs_constraints() const
 	{
+		if( is_witness_only(this->pb) ) {
+			return;
+		}
+
 		first_round.generate_r1cs_constraints();
 
 		for( auto& prefix_round : prefix_full_rounds ) {
 			prefix_round.generate_r1cs_constraints();
 		}
 
-		for( auto& partial_round : partial_rounds ) {
-			partial_round.generate_r1cs_constraints();
-		}
+		partial_rounds.generate_r1cs_constraints();
 
 		for( auto& suffix_round : suffix_full_rounds ) {
 			suffix_round.generate_r1cs_constraints();
@@ -380,9 +818,7 @@ public:
 			prefix_round.generate_r1cs_witness();
 		}
 
-		for( auto& partial_round : partial_rounds ) {
-			partial_round.generate_r1cs_witness();
-		}
+		partial_rounds.generate_r1cs_witness();
 
 		for( auto& suffix_round : suffix_full_rounds ) {
 			suffix_round.generate_r1cs_witness();
@@ -403,27 +839,16 @@ public:
 
 
 template<unsigned param_t, unsigned param_c, unsigned param_F, unsigned param_P, unsigned nInputs, unsigned nOutputs, bool constrainOutputs=true>
-class Poseidon_gadget_T : public GadgetT, public libsnark::ITranslator
+class Poseidon_gadget_T : public instanced_gadget<Master_Poseidon_gadget_T<param_t, param_c, param_F, param_P, nInputs, nOutputs, constrainOutputs>>
 {
 public:
 	typedef Master_Poseidon_gadget_T<param_t, param_c, param_F, param_P, nInputs, nOutputs, constrainOutputs> Master;
-	const Master& master;
 
-	VariableArrayT instance_inputs;
-	unsigned int instance_variables_offset;
 	VariableT res;
 
-	const Master& get_master()
+	static Master* make_master( ProtoboardT& master_pb )
 	{
-		static ProtoboardT master_pb;
-		static Master* master;
-		static std::once_flag flag;
-		std::call_once(flag, [](){
-			master = new Master(master_pb, make_var_array(master_pb, nInputs, ".dummy_inputs"), ".poseidon_master");
-			master->generate_r1cs_constraints();
-			master_pb.set_use_thread_values(true);
-		});
-		return *master;
+		return new Master(master_pb, make_var_array(master_pb, nInputs, ".dummy_inputs"), ".poseidon_master");
 	}
 
 	Poseidon_gadget_T(
@@ -431,53 +856,11 @@ public:
 		const VariableArrayT& in_inputs,
 		const std::string& annotation_prefix
 	) :
-		GadgetT(pb, annotation_prefix),
-		master(get_master()),
-		instance_inputs(in_inputs)
+		// Every parameter is a template argument, so one master per instantiation
+		instanced_gadget<Master>(pb, in_inputs, VariableArrayT(), "poseidon", make_master, annotation_prefix)
 	{
-		// Keep track of where the variable for this instance start
-		instance_variables_offset = pb.num_variables() + 1;
-		// Allocate the variables on the pb needed for this instance
-		make_var_array(pb, master.pb.num_variables() - in_inputs.size(), FMT(annotation_prefix, ".instance_var"));
 		// We need to return a reference to the output variable so create the variable here
-		res = VariableT(translate(master._output_vars[0].index));
-	}
-
-	~Poseidon_gadget_T()
-	{
-		//std::cout << "destructor" << std::endl;
-	}
-
-	void generate_r1cs_constraints() const
-	{
-		// For now, still copy all constraints to the main pb
-		const auto& constraints = master.pb.constraint_system.constraints;
-		for(unsigned int i = 0; i < constraints.size(); i++)
-		{
-			pb.constraint_system.constraints.emplace_back(
-				libsnark::make_unique<libsnark::r1cs_constraint_light_instance<FieldT>>(
-					(libsnark::r1cs_constraint_light<FieldT>*) constraints[i].get(),
-					(libsnark::ITranslator*) this
-				)
-			);
-		}
-	}
-
-	void generate_r1cs_witness() const
-	{
-		// TODO: this can be done smarter by replacing the variable indices in the background
-		// Set the input values
-		for (unsigned int i = 0; i < instance_inputs.size(); i++)
-		{
-			master.pb.val(1 + i) = pb.val(instance_inputs[i]);
-		}
-		// Calculate the funtion witnesses
-		master.generate_r1cs_witness();
-		// Copy variable values
-		for (unsigned int i = 0; i < master.pb.num_variables() - instance_inputs.size(); i++)
-		{
-			pb.val(instance_variables_offset + i) = master.pb.val(1 + instance_inputs.size() + i);
-		}
+		res = this->variable(this->master.gadget->_output_vars[0]);
 	}
 
 	template<bool x = constrainOutputs, unsigned n = nOutputs>
@@ -487,32 +870,28 @@ public:
 		return res;
 	}
 
-	unsigned int translate(unsigned int index) const override
+	/**
+	* The output variables, when there's more than one
+	*/
+	template<bool x = constrainOutputs>
+	typename std::enable_if<x, VariableArrayT>::type
+	outputs() const
 	{
-		if (index == 0)
-		{
-			return 0;
-		}
-		else if (index <= instance_inputs.size())
-		{
-			return instance_inputs[index - 1].index;
-		}
-		else
-		{
-			return instance_variables_offset + (index - (1 + instance_inputs.size()));
+		VariableArrayT result;
+		for( const auto& var : this->master.gadget->_output_vars ) {
+			result.emplace_back(this->variable(var));
 		}
+		return result;
 	}
 
-	void swapAB() override
+	/**
+	* The outputs, natively
+	*/
+	static std::vector<FieldT> permute( const std::vector<FieldT>& inputs )
 	{
-		static std::once_flag flag;
-		std::call_once(flag, [&](){
-			const auto& constraints = master.pb.constraint_system.constraints;
-			for(unsigned int i = 0; i < constraints.size(); i++)
-			{
-				constraints[i]->swapAB();
-			}
-		});
+		assert( inputs.size() == nInputs );
+		const auto state = poseidon_permute<param_t, param_c, param_F, param_P>(inputs);
+		return std::vector<FieldT>(state.begin(), state.begin() + nOutputs);
 	}
 };
 
@@ -521,6 +900,21 @@ template<unsigned nInputs, unsigned nOutputs, bool constrainOutputs=true>
 using Poseidon128 = Poseidon_gadget_T<6, 1, 8, 57, nInputs, nOutputs, constrainOutputs>;
 
 
+/**
+* Poseidon128 natively, the first element of the permutation of up to 5 inputs
+*/
+inline FieldT Poseidon128_hash(const std::vector<FieldT>& inputs)
+{
+	return poseidon_permute<6, 1, 8, 57>(inputs)[0];
+}
+
+
+inline void Poseidon128_hash_batch(const FieldT* m, size_t n_inputs, size_t n, FieldT* out)
+{
+	poseidon_hash_batch<6, 1, 8, 57>(m, n_inputs, n, out);
+}
+
+
 // namespace ethsnarks
 }
 
@@ -0,0 +1,172 @@
+#ifndef ETHSNARKS_POSEIDON_SPONGE_HPP_
+#define ETHSNARKS_POSEIDON_SPONGE_HPP_
+
+// Copyright (c) 2019 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+#include "utils.hpp"
+#include "gadgets/poseidon.hpp"
+
+#include <algorithm>
+
+namespace ethsnarks {
+
+
+/**
+* A sponge over the Poseidon permutation natively, see PoseidonSponge_OWF
+*/
+template<unsigned param_t, unsigned param_c, unsigned param_F, unsigned param_P>
+FieldT poseidon_sponge(const FieldT& IV, const std::vector<FieldT>& messages)
+{
+	static_assert( param_c < param_t, "The sponge needs a rate of at least one element" );
+	const unsigned rate = param_t - param_c;
+
+	std::vector<FieldT> absorbed;
+	absorbed.reserve(1 + messages.size());
+	absorbed.emplace_back(long(messages.size()));
+	absorbed.insert(absorbed.end(), messages.begin(), messages.end());
+
+	std::vector<FieldT> state(param_t, FieldT::zero());
+	state[0] = IV;
+	for( size_t begin = 0; begin < absorbed.size(); begin += rate )
+	{
+		const size_t end = std::min<size_t>(begin + rate, absorbed.size());
+		std::fill(state.begin() + param_c, state.end(), FieldT::zero());
+		std::copy(absorbed.begin() + begin, absorbed.begin() + end, state.begin() + param_c);
+		state = poseidon_permute<param_t, param_c, param_F, param_P>(state);
+	}
+
+	return state[0];
+}
+
+
+/**
+* Hashes any number of messages with the Poseidon permutation used as a
+* sponge, absorbing `t - c` elements per permutation, where MerkleDamgard_OWF
+* and MiyaguchiPreneel_OWF take a cipher per message.
+*
+* The sponge is in overwrite mode: the rate part of the state is replaced by
+* the next block, rather than added to, so each permutation's inputs are the
+* capacity outputs of the previous one and the block's variables, with no
+* additions to constrain. The capacity starts as the IV then zeros, and the
+* number of messages is absorbed first, so messages zero padded to a whole
+* block don't collide with longer ones.
+*
+* It has the constructor markle_path_compute expects of its HashT, both
+* children and the length fit in one Poseidon128 permutation.
+*/
+template<unsigned param_t, unsigned param_c, unsigned param_F, unsigned param_P>
+class PoseidonSponge_OWF : public GadgetT
+{
+public:
+	typedef Poseidon_gadget_T<param_t, param_c, param_F, param_P, param_t, param_c> PermutationT;
+
+	static constexpr unsigned RATE = param_t - param_c;
+
+	const std::vector<VariableT> m_messages;
+	const VariableT m_length;
+	const VariableT m_zero;
+	std::vector<PermutationT> m_permutations;
+
+	PoseidonSponge_OWF(
+		ProtoboardT& in_pb,
+		const VariableT& in_IV,
+		const std::vector<VariableT>& in_messages,
+		const std::string &in_annotation_prefix
+	) :
+		GadgetT(in_pb, in_annotation_prefix),
+		m_messages(in_messages),
+		m_length(make_variable(in_pb, FMT(in_annotation_prefix, ".length"))),
+		m_zero(make_variable(in_pb, FMT(in_annotation_prefix, ".zero")))
+	{
+		static_assert( param_c < param_t, "The sponge needs a rate of at least one element" );
+
+		std::vector<VariableT> absorbed;
+		absorbed.reserve(1 + in_messages.size());
+		absorbed.emplace_back(m_length);
+		absorbed.insert(absorbed.end(), in_messages.begin(), in_messages.end());
+
+		const size_t n_blocks = (absorbed.size() + RATE - 1) / RATE;
+		m_permutations.reserve(n_blocks);
+		for( size_t i = 0; i < n_blocks; i++ )
+		{
+			VariableArrayT inputs;
+			if( i == 0 ) {
+				inputs.emplace_back(in_IV);
+				for( unsigned j = 1; j < param_c; j++ ) {
+					inputs.emplace_back(m_zero);
+				}
+			}
+			else {
+				const auto capacity = m_permutations.back().outputs();
+				inputs.insert(inputs.end(), capacity.begin(), capacity.end());
+			}
+
+			for( size_t j = i * RATE; j < (i + 1) * RATE; j++ ) {
+				inputs.emplace_back(j < absorbed.size() ? absorbed[j] : m_zero);
+			}
+
+			m_permutations.emplace_back(in_pb, inputs, pb_annotation(in_pb, in_annotation_prefix, ".permutation[%zu]", i));
+		}
+	}
+
+	const VariableT& result() const {
+		return m_permutations.back().res;
+	}
+
+	void generate_r1cs_constraints ()
+	{
+		if( is_witness_only(this->pb) ) {
+			return;
+		}
+
+		this->pb.add_r1cs_constraint(
+			ConstraintT(m_length, 1, FieldT(long(m_messages.size()))),
+			FMT(this->annotation_prefix, ".length"));
+
+		this->pb.add_r1cs_constraint(
+			ConstraintT(m_zero, 1, 0),
+			FMT(this->annotation_prefix, ".zero"));
+
+		for( auto& gadget : m_permutations )
+		{
+			gadget.generate_r1cs_constraints();
+		}
+	}
+
+	void generate_r1cs_witness () const
+	{
+		this->pb.val(m_length) = FieldT(long(m_messages.size()));
+		this->pb.val(m_zero) = FieldT::zero();
+
+		for( auto& gadget : m_permutations )
+		{
+			gadget.generate_r1cs_witness();
+		}
+	}
+
+	/**
+	* The result, natively
+	*/
+	static FieldT hash( const FieldT& IV, const std::vector<FieldT>& messages )
+	{
+		return poseidon_sponge<param_t, param_c, param_F, param_P>(IV, messages);
+	}
+};
+
+
+using Poseidon128_sponge = PoseidonSponge_OWF<6, 1, 8, 57>;
+
+
+inline FieldT Poseidon128_sponge_hash(const FieldT& IV, const std::vector<FieldT>& messages)
+{
+	return Poseidon128_sponge::hash(IV, messages);
+}
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_POSEIDON_SPONGE_HPP_
+#endif
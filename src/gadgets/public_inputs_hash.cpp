@@ -0,0 +1,262 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "gadgets/public_inputs_hash.hpp"
+#include "utils.hpp"
+
+#include "crypto/sha256.h"
+
+#include <algorithm>
+
+
+namespace ethsnarks {
+
+
+static const size_t PADDED_BITS = 256;
+
+
+/**
+* Each value as 256 bits, MSB first, which is the bit order that
+* sha256_many and bytes_to_bv read bytes in
+*/
+static const VariableArrayT values_to_bits( const VariableT& zero, const field2bits_strict_batch& bits )
+{
+    VariableArrayT result;
+    for( size_t i = 0; i < bits.size(); i++ )
+    {
+        const auto& value_bits = bits.result(i);
+        for( size_t j = value_bits.size(); j < PADDED_BITS; j++ ) {
+            result.emplace_back(zero);
+        }
+        result.insert(result.end(), value_bits.rbegin(), value_bits.rend());
+    }
+    return result;
+}
+
+
+public_inputs_hash_sha256::public_inputs_hash_sha256(
+    ProtoboardT& in_pb,
+    const VariableArrayT& in_digest,
+    const VariableArrayT& in_values,
+    const std::string& annotation_prefix
+) :
+    GadgetT(in_pb, annotation_prefix),
+    m_digest(in_digest),
+    m_values(in_values),
+    m_zero(make_variable(in_pb, FMT(annotation_prefix, ".zero"))),
+    m_bits(in_pb, in_values, FMT(annotation_prefix, ".bits")),
+    m_hasher(in_pb, values_to_bits(m_zero, m_bits), FMT(annotation_prefix, ".hasher"))
+{
+    assert( in_digest.size() == DIGEST_SIZE );
+    assert( in_values.size() > 0 );
+}
+
+
+/**
+* The high and low 128 bits of the hash, each MSB first
+*/
+const std::vector<libsnark::linear_combination<FieldT>> public_inputs_hash_sha256::digest_lcs() const
+{
+    const auto& bits = m_hasher.result().bits;
+    const size_t half = bits.size() / DIGEST_SIZE;
+
+    std::vector<libsnark::linear_combination<FieldT>> result;
+    for( size_t i = 0; i < DIGEST_SIZE; i++ )
+    {
+        VariableArrayT part;
+        part.insert(part.end(), bits.rend() - (i + 1) * half, bits.rend() - i * half);
+        result.emplace_back(libsnark::pb_packing_sum<FieldT>(part));
+    }
+    return result;
+}
+
+
+void public_inputs_hash_sha256::generate_r1cs_constraints()
+{
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_zero, 1, 0),
+        FMT(this->annotation_prefix, ".zero"));
+
+    m_bits.generate_r1cs_constraints();
+    m_hasher.generate_r1cs_constraints();
+
+    const auto lcs = digest_lcs();
+    for( size_t i = 0; i < DIGEST_SIZE; i++ )
+    {
+        this->pb.add_r1cs_constraint(
+            ConstraintT(1, lcs[i], m_digest[i]),
+            FMT(this->annotation_prefix, ".digest[%zu]", i));
+    }
+}
+
+
+void public_inputs_hash_sha256::generate_r1cs_witness()
+{
+    this->pb.val(m_zero) = FieldT::zero();
+    m_bits.generate_r1cs_witness();
+    m_hasher.generate_r1cs_witness();
+
+    const auto lcs = digest_lcs();
+    for( size_t i = 0; i < DIGEST_SIZE; i++ ) {
+        this->pb.val(m_digest[i]) = lc_val(this->pb, lcs[i]);
+    }
+}
+
+
+std::vector<FieldT> public_inputs_hash_sha256::digest( const std::vector<FieldT>& values )
+{
+    libff::bit_vector bits;
+    bits.reserve(values.size() * PADDED_BITS);
+    for( const auto& value : values )
+    {
+        const auto value_bits = libff::convert_field_element_to_bit_vector(value, FieldT::size_in_bits());
+        bits.insert(bits.end(), PADDED_BITS - value_bits.size(), false);
+        bits.insert(bits.end(), value_bits.rbegin(), value_bits.rend());
+    }
+
+    std::vector<uint8_t> bytes(bits.size() / 8);
+    bv_to_bytes(bits, bytes.data());
+
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+    SHA256_Update(&ctx, bytes.data(), bytes.size());
+    SHA256_Final(hash, &ctx);
+
+    const size_t half = SHA256_DIGEST_LENGTH / DIGEST_SIZE;
+    std::vector<FieldT> result;
+    for( size_t i = 0; i < DIGEST_SIZE; i++ ) {
+        result.emplace_back(bytes_to_FieldT_bigendian(hash + i * half, half));
+    }
+    return result;
+}
+
+
+public_inputs_hash_mimc::public_inputs_hash_mimc(
+    ProtoboardT& in_pb,
+    const VariableArrayT& in_digest,
+    const VariableArrayT& in_values,
+    const std::string& annotation_prefix
+) :
+    GadgetT(in_pb, annotation_prefix),
+    m_digest(in_digest),
+    m_values(in_values),
+    m_IV(make_variable(in_pb, FMT(annotation_prefix, ".IV"))),
+    m_hasher(in_pb, m_IV, in_values, FMT(annotation_prefix, ".hasher"))
+{
+    assert( in_digest.size() == DIGEST_SIZE );
+    assert( in_values.size() > 0 );
+}
+
+
+void public_inputs_hash_mimc::generate_r1cs_constraints()
+{
+    // The IV is the number of values, so inputs of different lengths differ
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_IV, 1, FieldT(long(m_values.size()))),
+        FMT(this->annotation_prefix, ".IV"));
+
+    m_hasher.generate_r1cs_constraints();
+
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_hasher.result(), 1, m_digest[0]),
+        FMT(this->annotation_prefix, ".digest"));
+}
+
+
+void public_inputs_hash_mimc::generate_r1cs_witness()
+{
+    this->pb.val(m_IV) = FieldT(long(m_values.size()));
+    m_hasher.generate_r1cs_witness();
+    this->pb.val(m_digest[0]) = this->pb.val(m_hasher.result());
+}
+
+
+std::vector<FieldT> public_inputs_hash_mimc::digest( const std::vector<FieldT>& values )
+{
+    return {mimc_hash(values, FieldT(long(values.size())))};
+}
+
+
+public_inputs_hash_poseidon::public_inputs_hash_poseidon(
+    ProtoboardT& in_pb,
+    const VariableArrayT& in_digest,
+    const VariableArrayT& in_values,
+    const std::string& annotation_prefix
+) :
+    GadgetT(in_pb, annotation_prefix),
+    m_digest(in_digest),
+    m_values(in_values),
+    m_count(make_variable(in_pb, FMT(annotation_prefix, ".count"))),
+    m_zero(make_variable(in_pb, FMT(annotation_prefix, ".zero")))
+{
+    assert( in_digest.size() == DIGEST_SIZE );
+    assert( in_values.size() > 0 );
+
+    const size_t n_hashes = (in_values.size() + VALUES_PER_HASH - 1) / VALUES_PER_HASH;
+    m_hashers.reserve(n_hashes);
+    for( size_t i = 0; i < n_hashes; i++ )
+    {
+        VariableArrayT inputs;
+        inputs.emplace_back(i == 0 ? m_count : m_hashers.back().result());
+        for( size_t j = i * VALUES_PER_HASH; j < (i + 1) * VALUES_PER_HASH; j++ ) {
+            inputs.emplace_back(j < in_values.size() ? in_values[j] : m_zero);
+        }
+        m_hashers.emplace_back(in_pb, inputs, FMT(annotation_prefix, ".hashers[%zu]", i));
+    }
+}
+
+
+void public_inputs_hash_poseidon::generate_r1cs_constraints()
+{
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_count, 1, FieldT(long(m_values.size()))),
+        FMT(this->annotation_prefix, ".count"));
+
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_zero, 1, 0),
+        FMT(this->annotation_prefix, ".zero"));
+
+    for( auto& hasher : m_hashers ) {
+        hasher.generate_r1cs_constraints();
+    }
+
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_hashers.back().result(), 1, m_digest[0]),
+        FMT(this->annotation_prefix, ".digest"));
+}
+
+
+void public_inputs_hash_poseidon::generate_r1cs_witness()
+{
+    this->pb.val(m_count) = FieldT(long(m_values.size()));
+    this->pb.val(m_zero) = FieldT::zero();
+
+    for( auto& hasher : m_hashers ) {
+        hasher.generate_r1cs_witness();
+    }
+
+    this->pb.val(m_digest[0]) = this->pb.val(m_hashers.back().result());
+}
+
+
+std::vector<FieldT> public_inputs_hash_poseidon::digest( const std::vector<FieldT>& values )
+{
+    FieldT state(long(values.size()));
+    for( size_t begin = 0; begin < values.size(); begin += VALUES_PER_HASH )
+    {
+        std::vector<FieldT> inputs(1 + VALUES_PER_HASH, FieldT::zero());
+        inputs[0] = state;
+        const size_t end = std::min(begin + VALUES_PER_HASH, values.size());
+        std::copy(values.begin() + begin, values.begin() + end, inputs.begin() + 1);
+        state = HashT::permute(inputs)[0];
+    }
+    return {state};
+}
+
+
+// namespace ethsnarks
+}
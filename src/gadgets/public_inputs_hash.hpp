@@ -0,0 +1,136 @@
+#ifndef ETHSNARKS_PUBLIC_INPUTS_HASH_HPP_
+#define ETHSNARKS_PUBLIC_INPUTS_HASH_HPP_
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+#include "gadgets/field2bits_strict.hpp"
+#include "gadgets/mimc.hpp"
+#include "gadgets/poseidon.hpp"
+#include "gadgets/sha256_many.hpp"
+
+#include <libsnark/gadgetlib1/gadgets/basic_gadgets.hpp>
+
+
+namespace ethsnarks {
+
+
+/**
+* Compress many would-be public inputs into a digest which is the only
+* primary input of the circuit
+*
+* The verifier does a scalar multiplication per primary input, and on-chain
+* each costs gas, so circuits with a lot of public state verify in constant
+* time by committing to it instead. The digest is allocated first, as the
+* primary input, then the values as auxiliary variables:
+*
+*   VariableArrayT digest = make_var_array(pb, public_inputs_hash_sha256::DIGEST_SIZE, "digest");
+*   pb.set_input_sizes(digest.size());
+*   VariableArrayT state = make_var_array(pb, n, "state");
+*   public_inputs_hash_sha256 hasher(pb, digest, state, "hasher");
+*
+* The witness sets the digest, and the verifier computes the same primary
+* input natively with `public_inputs_hash_sha256::digest(values)`.
+*
+* Each hash is a class with the same interface, they differ in cost:
+*
+*  - sha256: each value as 32 bytes big-endian, SHA256 of their
+*    concatenation, as the high then low 128 bits of the digest. This is
+*    what a contract can compute cheaply with the sha256 precompile.
+*  - mimc: MiMC Miyaguchi-Preneel of the values, keyed by their count
+*  - poseidon: a chain of Poseidon128 over 5 elements, starting from the
+*    count and absorbing 4 values each time, zero padded
+*/
+class public_inputs_hash_sha256 : public GadgetT
+{
+public:
+    static const size_t DIGEST_SIZE = 2;
+
+    const VariableArrayT m_digest;
+    const VariableArrayT m_values;
+
+    // Two zero bits pad each value to 256 bits
+    const VariableT m_zero;
+    field2bits_strict_batch m_bits;
+    sha256_many m_hasher;
+
+    public_inputs_hash_sha256(
+        ProtoboardT& in_pb,
+        const VariableArrayT& in_digest,
+        const VariableArrayT& in_values,
+        const std::string& annotation_prefix
+    );
+
+    void generate_r1cs_constraints();
+
+    void generate_r1cs_witness();
+
+    static std::vector<FieldT> digest( const std::vector<FieldT>& values );
+
+protected:
+    const std::vector<libsnark::linear_combination<FieldT>> digest_lcs() const;
+};
+
+
+class public_inputs_hash_mimc : public GadgetT
+{
+public:
+    static const size_t DIGEST_SIZE = 1;
+
+    const VariableArrayT m_digest;
+    const VariableArrayT m_values;
+
+    const VariableT m_IV;
+    MiMC_e7_hash_gadget m_hasher;
+
+    public_inputs_hash_mimc(
+        ProtoboardT& in_pb,
+        const VariableArrayT& in_digest,
+        const VariableArrayT& in_values,
+        const std::string& annotation_prefix
+    );
+
+    void generate_r1cs_constraints();
+
+    void generate_r1cs_witness();
+
+    static std::vector<FieldT> digest( const std::vector<FieldT>& values );
+};
+
+
+class public_inputs_hash_poseidon : public GadgetT
+{
+public:
+    typedef Poseidon128<5, 1> HashT;
+
+    static const size_t DIGEST_SIZE = 1;
+    static const size_t VALUES_PER_HASH = 4;
+
+    const VariableArrayT m_digest;
+    const VariableArrayT m_values;
+
+    const VariableT m_count;
+    const VariableT m_zero;
+    std::vector<HashT> m_hashers;
+
+    public_inputs_hash_poseidon(
+        ProtoboardT& in_pb,
+        const VariableArrayT& in_digest,
+        const VariableArrayT& in_values,
+        const std::string& annotation_prefix
+    );
+
+    void generate_r1cs_constraints();
+
+    void generate_r1cs_witness();
+
+    static std::vector<FieldT> digest( const std::vector<FieldT>& values );
+};
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PUBLIC_INPUTS_HASH_HPP_
+#endif
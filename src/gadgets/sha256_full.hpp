@@ -98,7 +98,7 @@ public:
                      intermediate_hash,         // output
                      FMT(annotation_prefix, " input_hasher")),
 
-        length_padding(VariableArray_from_bits(in_pb, _final_padding_512, FMT(annotation_prefix, " length_padding"))),
+        length_padding(VariableArray_from_constant_bits(in_pb, _final_padding_512, FMT(annotation_prefix, " length_padding"))),
 
         final_hasher(in_pb,
                      intermediate_hash.bits,    // prev_output
@@ -14,13 +14,55 @@ using libsnark::SHA256_digest_size;
 namespace ethsnarks {
 
 
+libsnark::pb_linear_combination_array<FieldT> SHA256_midstate_IV( ProtoboardT& pb, const uint32_t midstate[8] )
+{
+    libsnark::pb_linear_combination_array<FieldT> result;
+    result.reserve(SHA256_digest_size);
+
+    // Each word is big-endian, as are the bits of SHA256_default_IV
+    for( size_t i = 0; i < SHA256_digest_size; i++ )
+    {
+        const int bit = (midstate[i / 32] >> (31 - (i % 32))) & 1;
+        libsnark::pb_linear_combination<FieldT> element;
+        element.assign(pb, bit * libsnark::ONE);
+        element.evaluate(pb);
+        result.emplace_back(element);
+    }
+    return result;
+}
+
+
+sha256_many::sha256_many(
+        ProtoboardT& in_pb,
+        const VariableArrayT& in_bits,
+        const std::string &annotation_prefix
+) :
+    sha256_many(in_pb, SHA256_default_IV(in_pb), 0, in_bits, annotation_prefix)
+{
+}
+
+
 sha256_many::sha256_many(
         ProtoboardT& in_pb,
+        const uint32_t midstate[8],
+        size_t prefix_blocks,
+        const VariableArrayT& in_bits,
+        const std::string &annotation_prefix
+) :
+    sha256_many(in_pb, SHA256_midstate_IV(in_pb, midstate), prefix_blocks, in_bits, annotation_prefix)
+{
+}
+
+
+sha256_many::sha256_many(
+        ProtoboardT& in_pb,
+        const libsnark::pb_linear_combination_array<FieldT>& midstate,
+        size_t prefix_blocks,
         const VariableArrayT& in_bits,
         const std::string &annotation_prefix
 ) :
     GadgetT(in_pb, annotation_prefix),
-    m_blocks(bits2blocks_padded(in_pb, in_bits, SHA256_block_size))
+    m_blocks(bits2blocks_padded(in_pb, in_bits, SHA256_block_size, prefix_blocks * SHA256_block_size))
 {
     // Construct hashers, inputs and outputs
     m_outputs.reserve(m_blocks.size());
@@ -36,11 +78,11 @@ sha256_many::sha256_many(
 
         if (i == 0)
         {
-            // First round includes IV as input
+            // First round includes IV, or the midstate, as input
             // Further rounds include previous digest as input
             first_hasher.emplace_back(
                 in_pb,
-                SHA256_default_IV(in_pb),
+                midstate,
                 m_blocks[i],
                 m_outputs[i],
                 FMT(annotation_prefix, ".hasher[%zu]", i));
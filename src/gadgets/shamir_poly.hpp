@@ -8,6 +8,8 @@
 #include "ethsnarks.hpp"
 #include "utils.hpp"
 
+#include <libfqfft/evaluation_domain/domains/basic_radix2_domain.hpp>
+
 namespace ethsnarks {
 
 
@@ -172,6 +174,163 @@ public:
 };
 
 
+/**
+* Evaluates the polynomial of shamir_poly at many inputs, sharing the
+* coefficients, e.g. for the shares of every member of a committee
+*
+* Each input uses Horner's rule, one constraint per coefficient after the
+* first:
+*
+*   T[k-1] = A[k-1]
+*   T[i]   = (T[i+1] * input) + A[i]
+*
+* Giving `f(input) = T[0]` with `k-1` constraints, instead of the `2*k-1`
+* of shamir_poly.
+*/
+class shamir_poly_many : public GadgetT
+{
+public:
+    const VariableArrayT inputs;
+    const VariableArrayT alpha;
+
+    // Horner's rule totals for each input, T[k-2] ... T[0]
+    std::vector<VariableArrayT> intermediate_totals;
+
+    shamir_poly_many(
+        ProtoboardT &in_pb,
+        const VariableArrayT &in_inputs,
+        const VariableArrayT &in_alpha,
+        const std::string &annotation_prefix
+    ) :
+        GadgetT(in_pb, annotation_prefix),
+        inputs(in_inputs),
+        alpha(in_alpha)
+    {
+        assert( in_alpha.size() >= 2 );
+        assert( in_inputs.size() > 0 );
+
+        for( size_t j = 0; j < in_inputs.size(); j++ )
+        {
+            intermediate_totals.emplace_back(make_var_array(in_pb, in_alpha.size() - 1, FMT(this->annotation_prefix, ".intermediate_totals[%zu]", j)));
+        }
+    }
+
+    size_t size() const
+    {
+        return inputs.size();
+    }
+
+    /**
+    * f(inputs[j])
+    */
+    const VariableT& result( size_t j ) const
+    {
+        return intermediate_totals[j].back();
+    }
+
+    void generate_r1cs_constraints()
+    {
+        const size_t k = alpha.size();
+
+        for( size_t j = 0; j < size(); j++ )
+        {
+            const auto& totals = intermediate_totals[j];
+            for( size_t n = 0; n < totals.size(); n++ )
+            {
+                // Starting from the highest coefficient, i = k-2 ... 0
+                const size_t i = k - 2 - n;
+                const VariableT& previous = n ? totals[n - 1] : alpha[k - 1];
+
+                this->pb.add_r1cs_constraint(
+                    ConstraintT(previous, inputs[j], totals[n] - alpha[i]),
+                    FMT(this->annotation_prefix, ".totals[%zu][%zu] = (totals[%zu] * input) + alpha[%zu]", j, i, i+1, i));
+            }
+        }
+    }
+
+    void generate_r1cs_witness()
+    {
+        const size_t k = alpha.size();
+        const auto coeffs = alpha.get_vals(this->pb);
+
+        for( size_t j = 0; j < size(); j++ )
+        {
+            const auto& totals = intermediate_totals[j];
+            const FieldT x = this->pb.val(inputs[j]);
+
+            FieldT total = coeffs[k - 1];
+            for( size_t n = 0; n < totals.size(); n++ )
+            {
+                total = (total * x) + coeffs[k - 2 - n];
+                this->pb.val(totals[n]) = total;
+            }
+        }
+    }
+};
+
+
+/**
+* f(x) = a_0 + \sum_{i=1}^{k-1} a_i x^i, natively using Horner's rule
+*/
+inline FieldT shamir_poly_native( const std::vector<FieldT>& alpha, const FieldT& x )
+{
+    assert( alpha.size() > 0 );
+
+    FieldT total = alpha.back();
+    for( size_t i = alpha.size() - 1; i-- > 0; )
+    {
+        total = (total * x) + alpha[i];
+    }
+    return total;
+}
+
+
+/**
+* The polynomial at each of the points, e.g. the shares of `x = 1 ... n`
+*/
+inline std::vector<FieldT> shamir_poly_native_batch( const std::vector<FieldT>& alpha, const std::vector<FieldT>& points )
+{
+    std::vector<FieldT> result(points.size());
+    const long n_points = points.size();
+
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( long j = 0; j < n_points; j++ )
+    {
+        result[j] = shamir_poly_native(alpha, points[j]);
+    }
+
+    return result;
+}
+
+
+/**
+* The polynomial at every point of the multiplicative subgroup of size `n`,
+* a power of two, `points[j] = omega^j`, using an FFT rather than `n`
+* evaluations. Coefficients past `n` are folded in, as `omega^n = 1`.
+*/
+inline void shamir_poly_native_subgroup( const std::vector<FieldT>& alpha, size_t n, std::vector<FieldT>& points, std::vector<FieldT>& shares )
+{
+    assert( n > 1 && (n & (n - 1)) == 0 );
+
+    libfqfft::basic_radix2_domain<FieldT> domain(n);
+
+    shares.assign(n, FieldT::zero());
+    for( size_t i = 0; i < alpha.size(); i++ )
+    {
+        shares[i % n] += alpha[i];
+    }
+    domain.FFT(shares);
+
+    points.resize(n);
+    for( size_t j = 0; j < n; j++ )
+    {
+        points[j] = domain.get_domain_element(j);
+    }
+}
+
+
 // namespace ethsnarks
 }
 
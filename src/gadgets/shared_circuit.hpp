@@ -0,0 +1,112 @@
+#ifndef ETHSNARKS_SHARED_CIRCUIT_HPP_
+#define ETHSNARKS_SHARED_CIRCUIT_HPP_
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+#include "utils.hpp"
+
+#include <functional>
+#include <memory>
+
+
+namespace ethsnarks {
+
+
+/**
+* One gadget tree and constraint system, shared by the witnesses of many
+* proofs computed concurrently
+*
+* The gadget is made once by the factory, which allocates its inputs first,
+* and its constraints are generated. From then on the protoboard keeps
+* per-thread values, like the masters of instanced_gadget, and neither the
+* gadgets nor the constraints change. Each thread fills in the inputs of
+* its proof, computes the witness into its own values, and takes them for
+* the prover, e.g. prove_assignment() with a ProverContext per thread.
+*
+* The witness of every variable must be computed each time, as the values
+* of a thread are those of its previous witness until overwritten, and the
+* gadgets' witness must only write to the protoboard.
+*/
+template<typename CircuitT>
+class shared_circuit
+{
+public:
+    typedef std::function<CircuitT*(ProtoboardT&)> FactoryT;
+    typedef std::function<void(ProtoboardT&, const CircuitT&)> InputsT;
+
+    shared_circuit( const FactoryT& in_factory ) :
+        m_circuit(in_factory(m_pb))
+    {
+        m_circuit->generate_r1cs_constraints();
+        m_pb.set_use_thread_values(true);
+    }
+
+    const ProtoboardT& pb() const
+    {
+        return m_pb;
+    }
+
+    const CircuitT& circuit() const
+    {
+        return *m_circuit;
+    }
+
+    const libsnark::r1cs_constraint_system<FieldT>& constraint_system() const
+    {
+        return m_pb.constraint_system;
+    }
+
+    size_t num_variables() const
+    {
+        return m_pb.num_variables();
+    }
+
+    /**
+    * The witness for one proof, `values[i]` is variable `i + 1`, as in
+    * ProtoboardT::values. Can be called from many threads at once.
+    */
+    void witness( const InputsT& in_inputs, std::vector<FieldT>& out_values )
+    {
+        in_inputs(m_pb, *m_circuit);
+        m_circuit->generate_r1cs_witness();
+
+        out_values.resize(m_pb.num_variables());
+        for( size_t i = 0; i < out_values.size(); i++ ) {
+            out_values[i] = m_pb.val(VariableT(i + 1));
+        }
+    }
+
+    std::vector<FieldT> witness( const InputsT& in_inputs )
+    {
+        std::vector<FieldT> values;
+        witness(in_inputs, values);
+        return values;
+    }
+
+    /** The primary inputs of a witness */
+    std::vector<FieldT> primary_input( const std::vector<FieldT>& in_values ) const
+    {
+        return std::vector<FieldT>(in_values.begin(), in_values.begin() + m_pb.num_inputs());
+    }
+
+    bool is_satisfied( const std::vector<FieldT>& in_values ) const
+    {
+        const auto n_inputs = m_pb.num_inputs();
+        const std::vector<FieldT> primary(in_values.begin(), in_values.begin() + n_inputs);
+        const std::vector<FieldT> auxiliary(in_values.begin() + n_inputs, in_values.end());
+        return m_pb.constraint_system.is_satisfied(primary, auxiliary);
+    }
+
+protected:
+    ProtoboardT m_pb;
+    std::unique_ptr<CircuitT> m_circuit;
+};
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_SHARED_CIRCUIT_HPP_
+#endif
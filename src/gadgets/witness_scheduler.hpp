@@ -0,0 +1,110 @@
+#ifndef ETHSNARKS_WITNESS_SCHEDULER_HPP_
+#define ETHSNARKS_WITNESS_SCHEDULER_HPP_
+
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+#include "ethsnarks.hpp"
+
+#include <functional>
+
+
+namespace ethsnarks {
+
+
+/**
+* Computes the witness of independent gadgets concurrently
+*
+* Gadgets are added in stages. The gadgets of a stage run across all cores
+* and must not depend on each other, e.g. separate sha256_many instances
+* or the merkle_path_authenticator of each transaction,
+* while a stage only starts once every earlier stage is done, e.g. for the
+* gadgets hashing their outputs. Within a gadget the witness is sequential.
+*
+* Gadgets only write their own variables, so they can share a protoboard.
+* Instances of an instanced_gadget share a master, whose protoboard keeps
+* per-thread values for this.
+*/
+class witness_scheduler
+{
+public:
+    typedef std::function<void()> JobT;
+
+    witness_scheduler() :
+        m_stages(1)
+    { }
+
+    template<typename T>
+    void add( T& gadget )
+    {
+        add_job([&gadget](){ gadget.generate_r1cs_witness(); });
+    }
+
+    template<typename T>
+    void add_all( std::vector<T>& gadgets )
+    {
+        for( auto& gadget : gadgets ) {
+            add(gadget);
+        }
+    }
+
+    void add_job( const JobT& job )
+    {
+        m_stages.back().push_back(job);
+    }
+
+    /**
+    * Gadgets added after this depend on those added before
+    */
+    void barrier()
+    {
+        if( ! m_stages.back().empty() ) {
+            m_stages.emplace_back();
+        }
+    }
+
+    size_t size() const
+    {
+        size_t n = 0;
+        for( const auto& stage : m_stages ) {
+            n += stage.size();
+        }
+        return n;
+    }
+
+    void run() const
+    {
+        for( const auto& stage : m_stages )
+        {
+            const long n_jobs = stage.size();
+#ifdef MULTICORE
+            #pragma omp parallel for schedule(dynamic, 1)
+#endif
+            for( long i = 0; i < n_jobs; i++ ) {
+                stage[i]();
+            }
+        }
+    }
+
+protected:
+    std::vector<std::vector<JobT>> m_stages;
+};
+
+
+/**
+* The witness of each gadget, concurrently, when they're independent
+*/
+template<typename T>
+void generate_r1cs_witness_parallel( std::vector<T>& gadgets )
+{
+    witness_scheduler scheduler;
+    scheduler.add_all(gadgets);
+    scheduler.run();
+}
+
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_WITNESS_SCHEDULER_HPP_
+#endif
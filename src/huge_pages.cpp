@@ -0,0 +1,151 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <sys/mman.h>
+
+#include "huge_pages.hpp"
+
+
+namespace ethsnarks {
+
+
+static const uintptr_t HUGE_PAGE_BYTES = 2 << 20;
+
+
+bool huge_pages_available()
+{
+    std::ifstream fh("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string text;
+    if( ! std::getline(fh, text) ) {
+        return false;
+    }
+
+    // e.g. `always [madvise] never`
+    return text.find("[always]") != std::string::npos
+        || text.find("[madvise]") != std::string::npos;
+}
+
+
+bool huge_pages_advise( const void *data, size_t bytes )
+{
+#ifdef MADV_HUGEPAGE
+    const uintptr_t begin = (uintptr_t(data) + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+    const uintptr_t end = (uintptr_t(data) + bytes) & ~(HUGE_PAGE_BYTES - 1);
+    if( end <= begin ) {
+        return false;
+    }
+
+    return 0 == ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+#else
+    (void)data;
+    (void)bytes;
+    return false;
+#endif
+}
+
+
+size_t huge_pages_resident( const void *data, size_t bytes )
+{
+    std::ifstream fh("/proc/self/smaps");
+    const uintptr_t begin = uintptr_t(data);
+    const uintptr_t end = begin + bytes;
+
+    size_t result = 0;
+    bool overlaps = false;
+    std::string line;
+    while( std::getline(fh, line) )
+    {
+        // Each mapping starts with `start-end perms offset dev inode path`,
+        // its fields follow as `Name: value`
+        const std::string first = line.substr(0, line.find(' '));
+        const auto dash = first.find('-');
+        if( dash != std::string::npos && first.back() != ':' )
+        {
+            const uintptr_t map_begin = std::strtoull(line.c_str(), nullptr, 16);
+            const uintptr_t map_end = std::strtoull(line.c_str() + dash + 1, nullptr, 16);
+            overlaps = map_begin < end && begin < map_end;
+            continue;
+        }
+
+        if( overlaps && line.compare(0, 14, "AnonHugePages:") == 0 ) {
+            result += std::strtoull(line.c_str() + 14, nullptr, 10) * 1024;
+        }
+    }
+
+    return std::min(result, bytes);
+}
+
+
+void huge_pages_report( const char *what, const void *data, size_t bytes )
+{
+    std::cerr << "Huge pages: " << (huge_pages_resident(data, bytes) >> 20) << " of "
+              << (bytes >> 20) << " MiB of " << what << std::endl;
+}
+
+
+template<typename T>
+static bool advise_vector( const std::vector<T>& v )
+{
+    return huge_pages_advise(v.data(), v.size() * sizeof(T));
+}
+
+
+bool huge_pages_proving_key( const ProvingKeyT& pk )
+{
+    if( ! huge_pages_available() ) {
+        std::cerr << "Warning: transparent huge pages are disabled" << std::endl;
+        return false;
+    }
+
+    // Vectors smaller than a huge page can't be advised, that's not a failure
+    advise_vector(pk.A_query.indices);
+    advise_vector(pk.A_query.values);
+    advise_vector(pk.B_query.indices);
+    advise_vector(pk.B_query.values);
+    const bool ok = advise_vector(pk.H_query) && advise_vector(pk.L_query);
+
+    huge_pages_report("H_query", pk.H_query.data(), pk.H_query.size() * sizeof(pk.H_query[0]));
+    huge_pages_report("L_query", pk.L_query.data(), pk.L_query.size() * sizeof(pk.L_query[0]));
+
+    return ok;
+}
+
+
+bool huge_pages_prover_context( ProverContextT& context )
+{
+    if( ! huge_pages_available() ) {
+        std::cerr << "Warning: transparent huge pages are disabled" << std::endl;
+        return false;
+    }
+
+    // The same sizes as ProverContext::preallocate(), and only the buffers
+    // the config uses. The batch prover's second witness map is left to
+    // ProverContext::preallocate_next().
+    const size_t num_variables = context.constraint_system->num_variables();
+    const size_t m = context.domain->m;
+    const size_t num_scratch = std::max(num_variables + 1, m);
+
+    bool ok = true;
+    for( auto v : {&context.aA, &context.aB, &context.aH} ) {
+        ok = huge_pages_reserve(*v, m + 1) && ok;
+    }
+
+    ok = huge_pages_reserve(context.scratch_exponents, num_scratch) && ok;
+    if( context.concurrent_multi_exp() ) {
+        for( auto v : {&context.scratch_exponents_B, &context.scratch_exponents_H, &context.scratch_exponents_L} ) {
+            ok = huge_pages_reserve(*v, num_scratch) && ok;
+        }
+    }
+
+    return ok;
+}
+
+
+// namespace ethsnarks
+}
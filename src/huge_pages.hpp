@@ -0,0 +1,63 @@
+#ifndef ETHSNARKS_HUGE_PAGES_HPP_
+#define ETHSNARKS_HUGE_PAGES_HPP_
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Transparent huge pages for the proving key and the prover's scratch space
+*
+* The MSMs scatter into buckets from random bases and exponents of multi-GB
+* vectors, with 4 KiB pages nearly every access is a TLB miss. Memory which
+* is advised before it's first written is faulted in as 2 MiB pages when the
+* kernel has them, memory which is advised later is only collapsed into huge
+* pages in the background by khugepaged.
+*/
+
+/** Does the kernel give huge pages to memory advised with MADV_HUGEPAGE? */
+bool huge_pages_available();
+
+/** Advise the huge pages wholly inside the region, false if refused */
+bool huge_pages_advise( const void *data, size_t bytes );
+
+/**
+* Bytes of the mappings which overlap the region that are backed by huge
+* pages, from /proc/self/smaps
+*/
+size_t huge_pages_resident( const void *data, size_t bytes );
+
+/** Print how much of the region is backed by huge pages, to stderr */
+void huge_pages_report( const char *what, const void *data, size_t bytes );
+
+/**
+* Replace the storage of `v` with room for `n` elements which is advised
+* before any of it is written, then resize() or assign() within it
+*/
+template<typename T>
+bool huge_pages_reserve( std::vector<T>& v, size_t n )
+{
+    std::vector<T>().swap(v);
+    v.reserve(n);
+    return huge_pages_advise(v.data(), n * sizeof(T));
+}
+
+/**
+* Advise the queries of a proving key which has already been loaded, and
+* report how much of the H and L queries is backed by huge pages
+*/
+bool huge_pages_proving_key( const ProvingKeyT& pk );
+
+/**
+* Reserve the witness map buffers and scratch exponents of the context with
+* huge pages, before ProverContext::preallocate(). Requires `constraint_system`
+* and `domain`.
+*/
+bool huge_pages_prover_context( ProverContextT& context );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_HUGE_PAGES_HPP_
+#endif
@@ -9,11 +9,23 @@
 * from JSON stuff. It's the opposite of 'export.cpp'...
 */
 
+#include <atomic>
 #include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <libsnark/knowledge_commitment/knowledge_commitment.hpp>
 #include <gmp.h>
 
 #include "import.hpp"
+#include "export.hpp"   // WIRE_ sizes
 
 using libsnark::r1cs_gg_ppzksnark_zok_proof;
 using libsnark::r1cs_gg_ppzksnark_zok_verification_key;
@@ -46,15 +58,22 @@ FieldT parse_FieldT(const string &input) {
 *
 *   [N, N, N, ...]
 */
-vector<FieldT> create_F_list( const json &in_tree )
+void create_F_list( const json &in_tree, vector<FieldT> &out )
 {
-    vector<FieldT> elements;
+    out.resize(in_tree.size());
 
+    size_t i = 0;
     for( auto& item : in_tree )
     {
-        elements.emplace_back( parse_FieldT( item ) );
+        out[i++] = parse_FieldT( item.get_ref<const string&>() );
     }
+}
 
+
+vector<FieldT> create_F_list( const json &in_tree )
+{
+    vector<FieldT> elements;
+    create_F_list(in_tree, elements);
     return elements;
 }
 
@@ -67,7 +86,7 @@ vector<FieldT> create_F_list( const json &in_tree )
 G1T create_G1(const string &in_X, const string &in_Y)
 {
 #ifdef CURVE_ALT_BN128
-    return G1T(parse_Fq(in_X), parse_Fq(in_Y), FqT("1"));
+    return G1T(parse_Fq(in_X), parse_Fq(in_Y), FqT::one());
 #elif CURVE_MCL_BN128
     return G1T(in_X, in_Y, "1");
 #endif
@@ -90,7 +109,7 @@ G2T create_G2(const string &in_X_c1, const string &in_X_c0, const string &in_Y_c
     return G2T(
         Fq2_T(parse_Fq(in_X_c0), parse_Fq(in_X_c1)),
         Fq2_T(parse_Fq(in_Y_c0), parse_Fq(in_Y_c1)),
-        Fq2_T(FqT("1"), FqT("0")));   // Z is hard-coded, coordinates are affine
+        Fq2_T::one());   // Z is hard-coded, coordinates are affine
 #elif CURVE_MCL_BN128
     return G2T(
         in_X_c0, in_X_c1,
@@ -109,7 +128,7 @@ G2T create_G2(const string &in_X_c1, const string &in_X_c0, const string &in_Y_c
 G1T create_G1( const json &in_tree )
 {
     assert(in_tree.size() == 2);
-    return create_G1(in_tree[0].get<string>(), in_tree[1].get<string>());
+    return create_G1(in_tree[0].get_ref<const string&>(), in_tree[1].get_ref<const string&>());
 }
 
 
@@ -118,17 +137,22 @@ G1T create_G1( const json &in_tree )
 *
 *   "in_key": [["X", "Y"], ["X", "Y"], ...]
 */
-vector<G1T> create_G1_list( const json &in_tree )
+void create_G1_list( const json &in_tree, vector<G1T> &out )
 {
-    typedef typename ppT::G1_type G1_T;
-
-    vector<G1_T> points;
+    out.resize(in_tree.size());
 
+    size_t i = 0;
     for( auto& item : in_tree )
     {
-        points.emplace_back( create_G1(item) );
+        out[i++] = create_G1(item);
     }
+}
+
 
+vector<G1T> create_G1_list( const json &in_tree )
+{
+    vector<G1T> points;
+    create_G1_list(in_tree, points);
     return points;
 }
 
@@ -145,8 +169,8 @@ G2T create_G2( const json &in_tree )
     assert( in_tree[0].size() == 2 );
     assert( in_tree[1].size() == 2 );
 
-    return create_G2(in_tree[0][0].get<string>(), in_tree[0][1].get<string>(),
-                     in_tree[1][0].get<string>(), in_tree[1][1].get<string>());
+    return create_G2(in_tree[0][0].get_ref<const string&>(), in_tree[0][1].get_ref<const string&>(),
+                     in_tree[1][0].get_ref<const string&>(), in_tree[1][1].get_ref<const string&>());
 }
 
 
@@ -222,5 +246,408 @@ VerificationKeyT vk_from_json( stringstream &in_json )
     return vk_from_json(json::parse(in_json));
 }
 
+
+/**
+* Decoding of the binary wire format written by proof_to_bytes / vk_to_bytes
+*
+* Words must be canonical, i.e. less than the field modulus, and points must
+* be on the curve. An all-zero point is the point at infinity.
+*/
+static const LimbT WIRE_FQ_MODULUS("21888242871839275222246405745257275088696311157297823662689037894645226208583");
+
+
+static bool word_to_bigint( const uint8_t *in, LimbT& out, const LimbT& modulus )
+{
+    out = LimbT();
+    for( size_t i = 0; i < WIRE_WORD_SIZE; i++ ) {
+        const size_t bit = (WIRE_WORD_SIZE - 1 - i) * 8;
+        out.data[bit / GMP_NUMB_BITS] |= mp_limb_t(in[i]) << (bit % GMP_NUMB_BITS);
+    }
+    return ::mpn_cmp(out.data, modulus.data, LimbT::N) < 0;
+}
+
+
+static bool words_are_zero( const uint8_t *in, size_t n )
+{
+    for( size_t i = 0; i < n; i++ ) {
+        if( in[i] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+#ifdef CURVE_MCL_BN128
+/**
+* mcl's Fp from an integer below the modulus, straight from its limbs rather
+* than through a string. The mask is a no-op as it's already been checked.
+*/
+template<typename T>
+static void Fp_from_bigint( const LimbT& in, T& out )
+{
+    out.setArrayMask(in.data, LimbT::N);
+}
+#endif
+
+
+static bool G1_from_words( const uint8_t *in, G1T& out )
+{
+    if( words_are_zero(in, WIRE_G1_SIZE) ) {
+        out = G1T::zero();
+        return true;
+    }
+
+    LimbT x, y;
+    if( ! word_to_bigint(in, x, WIRE_FQ_MODULUS) || ! word_to_bigint(in + 32, y, WIRE_FQ_MODULUS) ) {
+        return false;
+    }
+#ifdef CURVE_ALT_BN128
+    out = G1T(FqT(x), FqT(y), FqT::one());
+#elif CURVE_MCL_BN128
+    Fp_from_bigint(x, out.pt.x);
+    Fp_from_bigint(y, out.pt.y);
+    out.pt.z = 1;
+#endif
+    return out.is_well_formed();
+}
+
+
+static bool G2_from_words( const uint8_t *in, G2T& out )
+{
+    if( words_are_zero(in, WIRE_G2_SIZE) ) {
+        out = G2T::zero();
+        return true;
+    }
+
+    LimbT x_c1, x_c0, y_c1, y_c0;
+    if( ! word_to_bigint(in, x_c1, WIRE_FQ_MODULUS) || ! word_to_bigint(in + 32, x_c0, WIRE_FQ_MODULUS)
+     || ! word_to_bigint(in + 64, y_c1, WIRE_FQ_MODULUS) || ! word_to_bigint(in + 96, y_c0, WIRE_FQ_MODULUS) ) {
+        return false;
+    }
+#ifdef CURVE_ALT_BN128
+    typedef typename ppT::Fqe_type Fq2_T;
+    out = G2T(Fq2_T(FqT(x_c0), FqT(x_c1)),
+              Fq2_T(FqT(y_c0), FqT(y_c1)),
+              Fq2_T::one());
+#elif CURVE_MCL_BN128
+    Fp_from_bigint(x_c0, out.pt.x.a);
+    Fp_from_bigint(x_c1, out.pt.x.b);
+    Fp_from_bigint(y_c0, out.pt.y.a);
+    Fp_from_bigint(y_c1, out.pt.y.b);
+    out.pt.z.a = 1;
+    out.pt.z.b = 0;
+#endif
+    return out.is_well_formed();
+}
+
+
+bool proof_from_bytes( const uint8_t *in, size_t in_size, InputProofPairType& out )
+{
+    if( in_size < WIRE_PROOF_SIZE || (in_size - WIRE_PROOF_SIZE) % WIRE_WORD_SIZE != 0 ) {
+        return false;
+    }
+
+    G1T A, C;
+    G2T B;
+    if( ! G1_from_words(in, A)
+     || ! G2_from_words(in + WIRE_G1_SIZE, B)
+     || ! G1_from_words(in + WIRE_G1_SIZE + WIRE_G2_SIZE, C) ) {
+        return false;
+    }
+
+    const size_t n_inputs = (in_size - WIRE_PROOF_SIZE) / WIRE_WORD_SIZE;
+    PrimaryInputT input;
+    input.reserve(n_inputs);
+    for( size_t i = 0; i < n_inputs; i++ )
+    {
+        LimbT value;
+        if( ! word_to_bigint(in + WIRE_PROOF_SIZE + (i * WIRE_WORD_SIZE), value, FieldT::mod) ) {
+            return false;
+        }
+        input.emplace_back(value);
+    }
+
+    out = InputProofPairType(std::move(input), ProofT(std::move(A), std::move(B), std::move(C)));
+    return true;
+}
+
+
+bool vk_from_bytes( const uint8_t *in, size_t in_size, VerificationKeyT& out )
+{
+    // At least gammaABC[0] is required
+    if( in_size < WIRE_VK_SIZE + WIRE_G1_SIZE || (in_size - WIRE_VK_SIZE) % WIRE_G1_SIZE != 0 ) {
+        return false;
+    }
+
+    G1T alpha;
+    G2T beta, gamma, delta;
+    if( ! G1_from_words(in, alpha)
+     || ! G2_from_words(in + WIRE_G1_SIZE, beta)
+     || ! G2_from_words(in + WIRE_G1_SIZE + WIRE_G2_SIZE, gamma)
+     || ! G2_from_words(in + WIRE_G1_SIZE + (2 * WIRE_G2_SIZE), delta) ) {
+        return false;
+    }
+
+    const size_t n_points = (in_size - WIRE_VK_SIZE) / WIRE_G1_SIZE;
+    vector<G1T> gamma_ABC(n_points);
+    for( size_t i = 0; i < n_points; i++ )
+    {
+        if( ! G1_from_words(in + WIRE_VK_SIZE + (i * WIRE_G1_SIZE), gamma_ABC[i]) ) {
+            return false;
+        }
+    }
+
+    auto gamma_ABC_rest = vector<G1T>(gamma_ABC.begin() + 1, gamma_ABC.end());
+    out = VerificationKeyT(alpha, beta, gamma, delta,
+                           accumulation_vector<G1T>(std::move(gamma_ABC[0]), std::move(gamma_ABC_rest)));
+    return true;
+}
+
+/**
+* Import of circom binary .r1cs files, the inverse of r1cs2bin
+*
+* The file is mmap'd and the constraints section walked once to find where
+* each linear combination starts. Every term is then decoded by all threads
+* into one arena, converting the coefficients to Montgomery form, and the
+* constraints are made from it with each term list allocated at its size.
+*/
+static const char R1CS_MAGIC[4] = {'r', '1', 'c', 's'};
+static const uint32_t R1CS_VERSION = 1;
+static const size_t R1CS_FIELD_SIZE = 32;
+static const size_t R1CS_TERM_SIZE = 4 + R1CS_FIELD_SIZE;
+static const size_t R1CS_HEADER_SIZE = 4 + R1CS_FIELD_SIZE + 16 + 8 + 4;
+
+enum R1csSection {
+    R1CS_HEADER = 1,
+    R1CS_CONSTRAINTS = 2
+};
+
+
+struct R1csFile
+{
+    const uint8_t *base = nullptr;
+    size_t size = 0;
+    std::map<uint32_t, std::pair<const uint8_t*, uint64_t>> sections;
+
+    ~R1csFile()
+    {
+        if( base ) {
+            ::munmap(const_cast<uint8_t*>(base), size);
+        }
+    }
+};
+
+
+static uint32_t read_u32( const uint8_t *in )
+{
+    uint32_t out;
+    ::memcpy(&out, in, sizeof(out));
+    return out;
+}
+
+
+static uint64_t read_u64( const uint8_t *in )
+{
+    uint64_t out;
+    ::memcpy(&out, in, sizeof(out));
+    return out;
+}
+
+
+static void le_to_limbs( const uint8_t *in, LimbT& out )
+{
+    out = LimbT();
+    for( size_t i = 0; i < R1CS_FIELD_SIZE; i++ ) {
+        const size_t bit = i * 8;
+        out.data[bit / GMP_NUMB_BITS] |= mp_limb_t(in[i]) << (bit % GMP_NUMB_BITS);
+    }
+}
+
+
+/** Little-endian bytes to limbs, false unless less than the modulus */
+static bool le_to_bigint( const uint8_t *in, LimbT& out, const LimbT& modulus )
+{
+    le_to_limbs(in, out);
+    return ::mpn_cmp(out.data, modulus.data, LimbT::N) < 0;
+}
+
+
+static bool r1cs_open( const string& path, R1csFile& out )
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if( fd < 0 ) {
+        std::cerr << "Error: cannot open " << path << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if( 0 != ::fstat(fd, &st) || st.st_size < 12 ) {
+        std::cerr << "Error: cannot stat " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void *mapped = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if( mapped == MAP_FAILED ) {
+        std::cerr << "Error: cannot mmap " << path << std::endl;
+        return false;
+    }
+    ::madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+
+    out.base = static_cast<const uint8_t*>(mapped);
+    out.size = st.st_size;
+
+    if( 0 != ::memcmp(out.base, R1CS_MAGIC, sizeof(R1CS_MAGIC)) || read_u32(out.base + 4) != R1CS_VERSION ) {
+        std::cerr << "Error: not a version " << R1CS_VERSION << " r1cs file" << std::endl;
+        return false;
+    }
+
+    // magic, version, number of sections, then (type, size, data) for each
+    const uint32_t n_sections = read_u32(out.base + 8);
+    size_t offset = 12;
+    for( uint32_t i = 0; i < n_sections; i++ )
+    {
+        if( offset + 12 > out.size ) {
+            std::cerr << "Error: r1cs is truncated" << std::endl;
+            return false;
+        }
+        const uint32_t type = read_u32(out.base + offset);
+        const uint64_t size = read_u64(out.base + offset + 4);
+        offset += 12;
+        if( size > out.size - offset ) {
+            std::cerr << "Error: r1cs is truncated" << std::endl;
+            return false;
+        }
+        out.sections.insert(std::make_pair(type, std::make_pair(out.base + offset, size)));
+        offset += size;
+    }
+
+    return true;
+}
+
+
+bool is_r1cs_bin( const string& path )
+{
+    std::ifstream fh(path, std::ios::binary);
+    char magic[sizeof(R1CS_MAGIC)];
+    return fh.read(magic, sizeof(magic)) && 0 == ::memcmp(magic, R1CS_MAGIC, sizeof(magic));
+}
+
+
+bool r1cs_from_bin( const string& path, libsnark::r1cs_constraint_system<FieldT>& cs )
+{
+    R1csFile file;
+    if( ! r1cs_open(path, file) ) {
+        return false;
+    }
+
+    const auto header = file.sections.find(R1CS_HEADER);
+    const auto body = file.sections.find(R1CS_CONSTRAINTS);
+    if( header == file.sections.end() || header->second.second < R1CS_HEADER_SIZE || body == file.sections.end() ) {
+        std::cerr << "Error: r1cs header or constraints are missing" << std::endl;
+        return false;
+    }
+
+    // field size, prime, wires, public outputs, public inputs, private inputs, labels, constraints
+    const uint8_t *in = header->second.first;
+    LimbT prime;
+    le_to_limbs(in + 4, prime);
+    if( read_u32(in) != R1CS_FIELD_SIZE || prime != FieldT::mod ) {
+        std::cerr << "Error: r1cs is for a different field" << std::endl;
+        return false;
+    }
+    in += 4 + R1CS_FIELD_SIZE;
+    const size_t n_wires = read_u32(in);
+    const size_t n_public = size_t(read_u32(in + 4)) + read_u32(in + 8);
+    const size_t n_constraints = read_u32(in + 24);
+    if( n_wires < n_public + 1 ) {
+        std::cerr << "Error: r1cs header is invalid" << std::endl;
+        return false;
+    }
+
+    // Every linear combination has at least its 4 byte count, so the header
+    // can't make us allocate more than the file can describe
+    const uint8_t *data = body->second.first;
+    const size_t data_size = body->second.second;
+    if( n_constraints > data_size / 12 ) {
+        std::cerr << "Error: r1cs constraints are truncated" << std::endl;
+        return false;
+    }
+
+    // Where the terms of each linear combination are, in the file and the arena
+    const size_t n_lcs = 3 * n_constraints;
+    vector<size_t> lc_offset(n_lcs);
+    vector<size_t> lc_first(n_lcs + 1);
+    size_t offset = 0;
+    size_t n_terms = 0;
+    for( size_t i = 0; i < n_lcs; i++ )
+    {
+        if( data_size - offset < 4 ) {
+            std::cerr << "Error: r1cs constraints are truncated" << std::endl;
+            return false;
+        }
+        const size_t count = read_u32(data + offset);
+        offset += 4;
+        if( count > (data_size - offset) / R1CS_TERM_SIZE ) {
+            std::cerr << "Error: r1cs constraints are truncated" << std::endl;
+            return false;
+        }
+        lc_offset[i] = offset;
+        lc_first[i] = n_terms;
+        offset += count * R1CS_TERM_SIZE;
+        n_terms += count;
+    }
+    lc_first[n_lcs] = n_terms;
+    if( offset != data_size ) {
+        std::cerr << "Error: r1cs constraints section has trailing data" << std::endl;
+        return false;
+    }
+
+    vector<libsnark::linear_term<FieldT>> arena(n_terms);
+    std::atomic<bool> valid(true);
+
+#ifdef MULTICORE
+    #pragma omp parallel for schedule(dynamic, 1024)
+#endif
+    for( size_t i = 0; i < n_lcs; i++ )
+    {
+        const uint8_t *term = data + lc_offset[i];
+        for( size_t t = lc_first[i]; t < lc_first[i + 1]; t++, term += R1CS_TERM_SIZE )
+        {
+            const size_t index = read_u32(term);
+            LimbT coeff;
+            if( index >= n_wires || ! le_to_bigint(term + 4, coeff, FieldT::mod) ) {
+                valid = false;
+                break;
+            }
+            arena[t] = libsnark::linear_term<FieldT>(libsnark::variable<FieldT>(index), FieldT(coeff));
+        }
+    }
+
+    if( ! valid ) {
+        std::cerr << "Error: r1cs has an invalid wire or coefficient" << std::endl;
+        return false;
+    }
+
+    libsnark::r1cs_constraint_system<FieldT> result;
+    result.primary_input_size = n_public;
+    result.auxiliary_input_size = n_wires - 1 - n_public;
+
+    libsnark::linear_combination<FieldT> lcs[3];
+    for( size_t c = 0; c < n_constraints; c++ )
+    {
+        for( size_t j = 0; j < 3; j++ ) {
+            const size_t i = (3 * c) + j;
+            lcs[j].terms.assign(arena.begin() + lc_first[i], arena.begin() + lc_first[i + 1]);
+        }
+        result.add_constraint(ConstraintT(lcs[0], lcs[1], lcs[2]));
+    }
+
+    cs = std::move(result);
+    return true;
+}
+
 // ethsnarks
 }
@@ -8,6 +8,90 @@
 
 namespace ethsnarks {
 
+/**
+* Parse a decimal, 0x prefixed hex or 0b prefixed binary string into limbs,
+* without GMP or any heap allocation. Returns false for an invalid digit or
+* if the value doesn't fit in `n` limbs.
+*/
+template<mp_size_t n>
+bool parse_limbs(const char *in, size_t len, libff::bigint<n> &out)
+{
+    out = libff::bigint<n>();
+
+    unsigned int base = 10;
+    if( len > 2 && in[0] == '0' && (in[1] == 'x' || in[1] == 'X') ) {
+        base = 16;
+    }
+    else if( len > 2 && in[0] == '0' && (in[1] == 'b' || in[1] == 'B') ) {
+        base = 2;
+    }
+    if( base != 10 ) {
+        in += 2;
+        len -= 2;
+    }
+    if( len == 0 ) {
+        return false;
+    }
+
+    if( base == 10 )
+    {
+        for( size_t i = 0; i < len; i++ )
+        {
+            const unsigned int digit = in[i] - '0';
+            if( digit > 9 ) {
+                return false;
+            }
+
+            // out = (out * 10) + digit
+            unsigned __int128 carry = digit;
+            for( mp_size_t j = 0; j < n; j++ ) {
+                const unsigned __int128 t = ((unsigned __int128)out.data[j] * 10) + carry;
+                out.data[j] = mp_limb_t(t);
+                carry = t >> GMP_NUMB_BITS;
+            }
+            if( carry ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Digits are a power of two wide, so none straddle two limbs
+    const size_t digit_bits = (base == 16) ? 4 : 1;
+    for( size_t i = 0; i < len; i++ )
+    {
+        const char c = in[len - 1 - i];
+        unsigned int digit;
+        if( c >= '0' && c <= '9' ) {
+            digit = c - '0';
+        }
+        else if( c >= 'a' && c <= 'f' ) {
+            digit = c - 'a' + 10;
+        }
+        else if( c >= 'A' && c <= 'F' ) {
+            digit = c - 'A' + 10;
+        }
+        else {
+            return false;
+        }
+
+        if( digit >= base ) {
+            return false;
+        }
+        if( digit == 0 ) {
+            continue;
+        }
+
+        const size_t bit = i * digit_bits;
+        if( bit / GMP_NUMB_BITS >= size_t(n) ) {
+            return false;
+        }
+        out.data[bit / GMP_NUMB_BITS] |= mp_limb_t(digit) << (bit % GMP_NUMB_BITS);
+    }
+    return true;
+}
+
+
 /**
 * Loads a ppT::Fq_type from a string, allows for integer, hex or binary encoding
 * Prefix with 0x for hex and 0b for binary
@@ -15,27 +99,23 @@ namespace ethsnarks {
 template<typename T>
 T parse_bigint(const std::string &input)
 {
-    mpz_t value;
-    int value_error;
-
-    ::mpz_init(value);
-
-    // the '0' flag means auto-detect, e.g. '0x' or '0b' prefix for hex/binary
-    value_error = ::mpz_set_str(value, input.c_str(), 0);
-    if( value_error ) {
+    libff::bigint<T::num_limbs> value;
+    if( ! parse_limbs(input.data(), input.size(), value) ) {
         throw std::invalid_argument("Invalid field element");
     }
 
-    T out(value);
-    ::mpz_clear(value);
-
-    return out;
+    return T(value);
 }
 
 FqT parse_Fq(const std::string &input);
 FieldT parse_FieldT(const std::string &input);
 std::vector<FieldT> create_F_list( const nlohmann::json &in_tree );
 
+/**
+* Decode a list into `out`, re-using its capacity
+*/
+void create_F_list( const nlohmann::json &in_tree, std::vector<FieldT> &out );
+
 
 /**
 * Pair which represents a proof and its inputs
@@ -46,13 +126,36 @@ VerificationKeyT vk_from_json( std::stringstream &in_json );
 VerificationKeyT vk_from_json( const nlohmann::json &in_tree );
 
 InputProofPairType proof_from_json( std::stringstream &in_json );
+InputProofPairType proof_from_json( const nlohmann::json &in_tree );
+
+/**
+* Decode the binary encoding of proof_to_bytes / vk_to_bytes, returns false
+* if the size is wrong, a word isn't canonical or a point isn't on the curve
+*/
+bool proof_from_bytes( const uint8_t *in, size_t in_size, InputProofPairType& out );
+bool vk_from_bytes( const uint8_t *in, size_t in_size, VerificationKeyT& out );
+
+/**
+* Load a circom binary .r1cs constraint system, as written by r1cs2bin or
+* compiled elsewhere, without the gadgets which made it. The file is mmap'd
+* and decoded in parallel, with no text step. Wires are variables in the
+* same order, the public outputs and inputs being the primary input.
+*
+* Returns false if the file can't be read, is for a different field, or a
+* wire or coefficient is out of range.
+*/
+bool r1cs_from_bin( const std::string& path, libsnark::r1cs_constraint_system<FieldT>& cs );
+
+/** Does the file start with the .r1cs magic? */
+bool is_r1cs_bin( const std::string& path );
 
-G2T create_G2(std::string &in_X_c1, std::string &in_X_c0, std::string &in_Y_c1, std::string &in_Y_c0);
+G2T create_G2(const std::string &in_X_c1, const std::string &in_X_c0, const std::string &in_Y_c1, const std::string &in_Y_c0);
 G2T create_G2( const nlohmann::json &in_tree );
 
-G1T create_G1(std::string &in_X, std::string &in_Y);
+G1T create_G1(const std::string &in_X, const std::string &in_Y);
 G1T create_G1( const nlohmann::json &in_tree );
 std::vector<G1T> create_G1_list( const nlohmann::json &in_tree );
+void create_G1_list( const nlohmann::json &in_tree, std::vector<G1T> &out );
 
 // ethsnarks
 }
@@ -23,13 +23,13 @@ PointAdder::PointAdder(
     m_params(in_params),
     m_X1(in_X1), m_Y1(in_Y1),
     m_X2(in_X2), m_Y2(in_Y2),
-    m_beta(make_variable(in_pb, FMT(annotation_prefix, ".beta"))),
-    m_gamma(make_variable(in_pb, FMT(annotation_prefix, ".gamma"))),
-    m_delta(make_variable(in_pb, FMT(annotation_prefix, ".delta"))),
-    m_epsilon(make_variable(in_pb, FMT(annotation_prefix, ".epsilon"))),
-    m_tau(make_variable(in_pb, FMT(annotation_prefix, ".tau"))),
-    m_X3(make_variable(in_pb, FMT(annotation_prefix, ".X3"))),
-    m_Y3(make_variable(in_pb, FMT(annotation_prefix, ".Y3")))
+    m_beta(make_variable(in_pb, pb_annotation(in_pb, annotation_prefix, ".beta"))),
+    m_gamma(make_variable(in_pb, pb_annotation(in_pb, annotation_prefix, ".gamma"))),
+    m_delta(make_variable(in_pb, pb_annotation(in_pb, annotation_prefix, ".delta"))),
+    m_epsilon(make_variable(in_pb, pb_annotation(in_pb, annotation_prefix, ".epsilon"))),
+    m_tau(make_variable(in_pb, pb_annotation(in_pb, annotation_prefix, ".tau"))),
+    m_X3(make_variable(in_pb, pb_annotation(in_pb, annotation_prefix, ".X3"))),
+    m_Y3(make_variable(in_pb, pb_annotation(in_pb, annotation_prefix, ".Y3")))
 {
 
 }
@@ -37,6 +37,10 @@ PointAdder::PointAdder(
 
 void PointAdder::generate_r1cs_constraints()
 {
+    if( is_witness_only(this->pb) ) {
+        return;
+    }
+
     this->pb.add_r1cs_constraint(
         ConstraintT(m_X1, m_Y2, m_beta),
             FMT(annotation_prefix, ".beta = X1 * Y2"));
@@ -67,6 +71,44 @@ void PointAdder::generate_r1cs_constraints()
 }
 
 
+PointAdderInstance::PointAdderInstance(
+    ProtoboardT& in_pb,
+    const Params& in_params,
+    const VariableT in_X1,
+    const VariableT in_Y1,
+    const VariableT in_X2,
+    const VariableT in_Y2,
+    const std::string &annotation_prefix
+) :
+    instanced_gadget<PointAdder>(
+        in_pb,
+        instance_variables({in_X1, in_Y1, in_X2, in_Y2}),
+        VariableArrayT(),
+        instance_key("", {in_params.a, in_params.d}),
+        [&in_params]( ProtoboardT& master_pb ) {
+            const auto inputs = make_var_array(master_pb, 4, ".dummy_inputs");
+            // The master lives for the rest of the process, so does its copy of the parameters
+            return new PointAdder(master_pb, *new Params(in_params), inputs[0], inputs[1], inputs[2], inputs[3], ".adder_master");
+        },
+        annotation_prefix)
+{
+    m_X3 = variable(master.gadget->result_x());
+    m_Y3 = variable(master.gadget->result_y());
+}
+
+
+const VariableT& PointAdderInstance::result_x() const
+{
+    return m_X3;
+}
+
+
+const VariableT& PointAdderInstance::result_y() const
+{
+    return m_Y3;
+}
+
+
 const VariableT& PointAdder::result_x() const
 {
     return m_X3;
@@ -99,6 +141,30 @@ void PointAdder::generate_r1cs_witness()
 }
 
 
+void PointAdder::generate_r1cs_witness( batch_inverter& inverter )
+{
+    this->pb.val(m_beta) = this->pb.val(m_X1) * this->pb.val(m_Y2);
+
+    this->pb.val(m_gamma) = this->pb.val(m_Y1) * this->pb.val(m_X2);
+
+    this->pb.val(m_delta) = this->pb.val(m_Y1) * this->pb.val(m_Y2);
+
+    this->pb.val(m_epsilon) = this->pb.val(m_X1) * this->pb.val(m_X2);
+
+    this->pb.val(m_tau) = this->pb.val(m_delta) * this->pb.val(m_epsilon);
+
+    const auto d_tau = m_params.d * this->pb.val(m_tau);
+
+    inverter.add(FieldT::one() + d_tau, [this]( const FieldT& x3_rhs ) {
+        this->pb.val(m_X3) = (this->pb.val(m_beta)+this->pb.val(m_gamma)) * x3_rhs;
+    });
+
+    inverter.add(FieldT::one() - d_tau, [this]( const FieldT& y3_rhs ) {
+        this->pb.val(m_Y3) = (this->pb.val(m_delta)+( -m_params.a * this->pb.val(m_epsilon))) * y3_rhs;
+    });
+}
+
+
 // namespace jubjub
 }
 
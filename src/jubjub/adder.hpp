@@ -5,6 +5,8 @@
 // License: LGPL-3.0+
 
 #include "jubjub/params.hpp"
+#include "gadgets/instanced_gadget.hpp"
+#include "gadgets/batch_inverter.hpp"
 
 
 namespace ethsnarks {
@@ -50,6 +52,37 @@ public:
     void generate_r1cs_constraints();
 
     void generate_r1cs_witness();
+
+    /**
+    * Defer the inversion of the denominators to the batch, the result is
+    * set by `inverter.run()`
+    */
+    void generate_r1cs_witness( batch_inverter& inverter );
+};
+
+
+/**
+* PointAdder sharing the constraints of one master, see instanced_gadget
+*/
+class PointAdderInstance : public instanced_gadget<PointAdder>
+{
+public:
+    VariableT m_X3;
+    VariableT m_Y3;
+
+    PointAdderInstance(
+        ProtoboardT& in_pb,
+        const Params& in_params,
+        const VariableT in_X1,
+        const VariableT in_Y1,
+        const VariableT in_X2,
+        const VariableT in_Y2,
+        const std::string& annotation_prefix
+    );
+
+    const VariableT& result_x() const;
+
+    const VariableT& result_y() const;
 };
 
 
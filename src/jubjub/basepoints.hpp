@@ -0,0 +1,93 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#ifndef JUBJUB_BASEPOINTS_HPP_
+#define JUBJUB_BASEPOINTS_HPP_
+
+#include <cstddef>
+
+
+namespace ethsnarks {
+
+namespace jubjub {
+
+
+struct BasepointTableEntry {
+    const char *name;
+    unsigned int sequence;
+    const char *x;
+    const char *y;
+};
+
+
+/**
+* The first basepoints of the namespaces used by the shipped gadgets, for
+* the default Params
+*
+* Generated ahead of time, the same as EdwardsPoint::make_basepoint: the
+* SHA256 of the name padded to 28 characters and the sequence number as 4
+* hexadecimal digits, recovered as a point by from_y_always then multiplied
+* by the cofactor. See `pedersen_hash_basepoint` in ethsnarks/pedersen.py.
+*/
+const size_t BASEPOINT_TABLE_COUNT = 16;
+
+const BasepointTableEntry BASEPOINT_TABLE[] = {
+    {"EdDSA_Verify.M", 0,
+     "17808570483557114489501396356938072119849137096361887143136482272618515234401",
+     "17337153808050624319843135536866909465945363115819089726728943275668486202454"},
+    {"EdDSA_Verify.M", 1,
+     "7661873644262973996516205872885137924192216722997724525912587418249205764216",
+     "521599936517143450773883437386797268960733771999550537025155877758843725572"},
+    {"EdDSA_Verify.M", 2,
+     "10607495596603581816566327619904135297691362012154040791909761911323866056079",
+     "20165516367595933382373312816013814183899649133975325927746449444206080950702"},
+    {"EdDSA_Verify.M", 3,
+     "14712933491731273025507583306230042331450931597205811403872043491999088661188",
+     "3537944885713983740667662726590943978398381724156873785948849201162763242285"},
+    {"EdDSA_Verify.M", 4,
+     "14912622527479292443329169192794978576985767887902361344942774534426491897143",
+     "20532411604073960077186945743794168319561040108027180823625295056025293259432"},
+    {"EdDSA_Verify.M", 5,
+     "15984448315554891999781039632028770192063960055420013635437032109831629738171",
+     "2902257249375058159843807516482751539808468530894777366735506521091192233997"},
+    {"EdDSA_Verify.M", 6,
+     "7614336538904884159151366499796617985093519277415416113754450377556047807052",
+     "6077469392836672588629152358149489283990145078923184242182284690809183579517"},
+    {"EdDSA_Verify.M", 7,
+     "1927273505537139807133499942839137825589144511229222163797674489659000337236",
+     "19062189257809218242550957794971833632602311378511752979366664434828733039584"},
+    {"EdDSA_Verify.RAM", 0,
+     "17434558536782967610340762605448133754549234172198748128207635616973179917758",
+     "13809929214859773185494095338070573446620668786591540427529120055108311408601"},
+    {"EdDSA_Verify.RAM", 1,
+     "20881191793028387546033104172192345421491262837680372142491907592652070161952",
+     "5075784556128217284685225562241792312450302661801014564715596050958001884858"},
+    {"EdDSA_Verify.RAM", 2,
+     "8520090440088786753637148399502745058630978778520003292078671435389456269403",
+     "19065955179398565181112355398967936758982488978618882004783674372269664446856"},
+    {"EdDSA_Verify.RAM", 3,
+     "8252178246422932554470545827089444002049004598962888144864423033128179910983",
+     "15651909989309155104946748757069215505870124528799433233405947236802744549198"},
+    {"EdDSA_Verify.RAM", 4,
+     "19613701345946521139252906631403624319214524383237318926155152603812484828018",
+     "21617320264895522741112711536582628848652483577841815747293999179732881991324"},
+    {"EdDSA_Verify.RAM", 5,
+     "6155843579522854755336642611280808148477209989679852488581779041749546316723",
+     "15124604226542856727295916283584414325323133979788055132476373290093561626104"},
+    {"EdDSA_Verify.RAM", 6,
+     "2255552864031882424600016198277712968759818455778666488135834801088901251869",
+     "20183282562651407227856572417097745017658254303953678131504564910170801603804"},
+    {"EdDSA_Verify.RAM", 7,
+     "6469785718442780390486680321473277194625672464989021922834954388533973416947",
+     "5600720436353295795527652424649353386087879374665126501551955649891196987168"}
+};
+
+
+// namespace jubjub
+}
+
+// namespace ethsnarks
+}
+
+// JUBJUB_BASEPOINTS_HPP_
+#endif
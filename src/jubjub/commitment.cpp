@@ -2,6 +2,15 @@
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
 #include "jubjub/commitment.hpp"
+#include "jubjub/fixed_base_table.hpp"
+#include "gadgets/lookup_2bit.hpp"
+#include "gadgets/witness_scheduler.hpp"
+
+#include <algorithm>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
 
 namespace ethsnarks {
 
@@ -22,6 +31,10 @@ Commitment::Commitment(
 	assert( in_points.size() > 1 );
 	assert( in_points.size() == in_scalars.size() );
 
+	// The adders refer to the multipliers' results, neither is ever moved
+	m_multipliers.reserve(m_points.size());
+	m_adders.reserve(m_points.size() - 1);
+
 	size_t i = 0;
 	for( const auto& point : m_points )
 	{
@@ -86,11 +99,12 @@ void Commitment::generate_r1cs_constraints()
 }
 
 
+/**
+* The multipliers are independent, and are computed concurrently
+*/
 void Commitment::generate_r1cs_witness()
 {
-	for( auto& gadget : m_multipliers ) {
-		gadget.generate_r1cs_witness();
-	}
+	generate_r1cs_witness_parallel(m_multipliers);
 
 	for( auto& gadget : m_adders ) {
 		gadget.generate_r1cs_witness();
@@ -98,6 +112,169 @@ void Commitment::generate_r1cs_witness()
 }
 
 
+CommitmentBatch::CommitmentBatch(
+	ProtoboardT& in_pb,
+	const Params& in_params,
+	const std::vector<EdwardsPoint>& in_points,
+	const std::vector<std::vector<VariableArrayT>>& in_scalars,
+	const std::string& annotation_prefix
+) :
+	GadgetT(in_pb, annotation_prefix),
+	m_points(in_points)
+{
+	assert( in_points.size() > 0 );
+	assert( in_scalars.size() > 0 );
+
+	// The windows of each base, from the table shared with fixed_base_mul
+	size_t n_windows = 0;
+	m_windows.resize(m_points.size());
+	for( size_t j = 0; j < m_points.size(); j++ )
+	{
+		assert( in_scalars[0][j].size() % WINDOW_BITS == 0 );
+		const size_t n = in_scalars[0][j].size() / WINDOW_BITS;
+		const auto table = FixedBaseTable::get(in_params, m_points[j], WINDOW_BITS, n);
+
+		// The first of the 4 windows is infinity, for both bits zero
+		m_windows[j].resize(n);
+		for( size_t w = 0; w < n; w++ )
+		{
+			auto& window = m_windows[j][w];
+			window.x.reserve(4);
+			window.y.reserve(4);
+			window.x.emplace_back(0);
+			window.y.emplace_back(1);
+			for( size_t k = 1; k < 4; k++ )
+			{
+				const auto& point = table->multiple(w, k);
+				window.x.emplace_back(point.x);
+				window.y.emplace_back(point.y);
+			}
+		}
+		n_windows += n;
+	}
+	assert( n_windows > 1 );
+
+	m_instances.resize(in_scalars.size());
+	for( size_t i = 0; i < in_scalars.size(); i++ )
+	{
+		auto& instance = m_instances[i];
+		assert( in_scalars[i].size() == m_points.size() );
+		instance.scalars = in_scalars[i];
+		instance.windows_x.allocate(in_pb, n_windows, pb_annotation(in_pb, annotation_prefix, ".commitment[%zu].windows_x", i));
+		instance.windows_y.allocate(in_pb, n_windows, pb_annotation(in_pb, annotation_prefix, ".commitment[%zu].windows_y", i));
+
+		instance.adders.reserve(n_windows - 1);
+		for( size_t w = 1; w < n_windows; w++ )
+		{
+			const VariableT& x = (w == 1) ? instance.windows_x[0] : instance.adders.back().result_x();
+			const VariableT& y = (w == 1) ? instance.windows_y[0] : instance.adders.back().result_y();
+			instance.adders.emplace_back(
+				in_pb, in_params,
+				x, y,
+				instance.windows_x[w], instance.windows_y[w],
+				pb_annotation(in_pb, annotation_prefix, ".commitment[%zu].adder[%zu]", i, w - 1));
+		}
+	}
+}
+
+
+size_t CommitmentBatch::size() const
+{
+	return m_instances.size();
+}
+
+
+const VariableT& CommitmentBatch::result_x( size_t i ) const
+{
+	return m_instances[i].adders.back().result_x();
+}
+
+
+const VariableT& CommitmentBatch::result_y( size_t i ) const
+{
+	return m_instances[i].adders.back().result_y();
+}
+
+
+void CommitmentBatch::generate_r1cs_constraints()
+{
+	for( size_t i = 0; i < m_instances.size(); i++ )
+	{
+		auto& instance = m_instances[i];
+
+		size_t k = 0;
+		for( size_t j = 0; j < m_windows.size(); j++ )
+		{
+			for( size_t w = 0; w < m_windows[j].size(); w++, k++ )
+			{
+				const auto bits_begin = instance.scalars[j].begin() + (w * WINDOW_BITS);
+				const VariableArrayT bits(bits_begin, bits_begin + WINDOW_BITS);
+				lookup_2bit_constraints(this->pb, m_windows[j][w].x, bits, instance.windows_x[k], pb_annotation(this->pb, this->annotation_prefix, ".commitment[%zu].windows_x[%zu]", i, k));
+				lookup_2bit_constraints(this->pb, m_windows[j][w].y, bits, instance.windows_y[k], pb_annotation(this->pb, this->annotation_prefix, ".commitment[%zu].windows_y[%zu]", i, k));
+			}
+		}
+
+		for( auto& adder : instance.adders ) {
+			adder.generate_r1cs_constraints();
+		}
+	}
+}
+
+
+void CommitmentBatch::generate_r1cs_witness()
+{
+	const long n = m_instances.size();
+
+	// Each commitment only writes its own windows and adders
+#ifdef MULTICORE
+	#pragma omp parallel for
+#endif
+	for( long i = 0; i < n; i++ )
+	{
+		const auto& instance = m_instances[i];
+
+		size_t k = 0;
+		for( size_t j = 0; j < m_windows.size(); j++ )
+		{
+			const auto& scalar = instance.scalars[j];
+			for( size_t w = 0; w < m_windows[j].size(); w++, k++ )
+			{
+				const size_t index = this->pb.val(scalar[w * WINDOW_BITS]).as_ulong()
+				                   + (2 * this->pb.val(scalar[(w * WINDOW_BITS) + 1]).as_ulong());
+				this->pb.val(instance.windows_x[k]) = m_windows[j][w].x[index];
+				this->pb.val(instance.windows_y[k]) = m_windows[j][w].y[index];
+			}
+		}
+	}
+
+	// The adders of a chain depend on each other, but not on other chains
+#ifdef MULTICORE
+	const long n_threads = std::min<long>(n, omp_get_max_threads());
+#else
+	const long n_threads = 1;
+#endif
+	const size_t n_steps = m_instances[0].adders.size();
+
+#ifdef MULTICORE
+	#pragma omp parallel for
+#endif
+	for( long t = 0; t < n_threads; t++ )
+	{
+		const long begin = (n * t) / n_threads;
+		const long end = (n * (t + 1)) / n_threads;
+
+		batch_inverter inverter;
+		for( size_t step = 0; step < n_steps; step++ )
+		{
+			for( long i = begin; i < end; i++ ) {
+				m_instances[i].adders[step].generate_r1cs_witness(inverter);
+			}
+			inverter.run();
+		}
+	}
+}
+
+
 // namespace jubjub
 }
 
@@ -65,6 +65,65 @@ public:
 };
 
 
+/**
+* Many commitments to the same base points, each with its own scalars
+*
+* Each commitment has the constraints and result of a Commitment, but the
+* window constants of the bases' 2-bit lookups, see fixed_base_mul, are made
+* once and shared by every commitment instead of copied into each lookup.
+* The windows of all the bases are added in one chain per commitment, which
+* costs as many adders as a Commitment.
+*
+* Every commitment has the same number of scalars as there are points, and
+* the scalars of a point have the same even number of bits throughout.
+*
+* The witness looks up the windows of every commitment concurrently, then
+* steps through the chains of the commitments of each thread together, so
+* each step costs one inversion per thread rather than one per commitment.
+*/
+class CommitmentBatch : public GadgetT
+{
+public:
+	static const size_t WINDOW_BITS = 2;
+
+	// The lookup constants of one window of a base, shared by all commitments
+	struct Window
+	{
+		std::vector<FieldT> x;
+		std::vector<FieldT> y;
+	};
+
+	struct Instance
+	{
+		std::vector<VariableArrayT> scalars;
+		VariableArrayT windows_x;		// every window of every base, in order
+		VariableArrayT windows_y;
+		std::vector<PointAdder> adders;
+	};
+
+	const std::vector<EdwardsPoint> m_points;
+	std::vector<std::vector<Window>> m_windows;		// of each point
+	std::vector<Instance> m_instances;
+
+	CommitmentBatch(
+		ProtoboardT& in_pb,
+		const Params& in_params,
+		const std::vector<EdwardsPoint>& in_points,
+		const std::vector<std::vector<VariableArrayT>>& in_scalars,
+		const std::string &annotation_prefix );
+
+	size_t size() const;
+
+	const VariableT& result_x( size_t i ) const;
+
+	const VariableT& result_y( size_t i ) const;
+
+	void generate_r1cs_constraints();
+
+	void generate_r1cs_witness();
+};
+
+
 // namespace jubjub
 }
 
@@ -66,6 +66,111 @@ void ConditionalPoint::generate_r1cs_witness()
 }
 
 
+// --------------------------------------------------------------------
+
+
+ConditionalPointAdder::ConditionalPointAdder(
+	ProtoboardT& in_pb,
+	const Params& in_params,
+	const VariableT in_X1,
+	const VariableT in_Y1,
+	const VariableT in_X2,
+	const VariableT in_Y2,
+	const VariableT in_bit,
+	const std::string& annotation_prefix
+) :
+	GadgetT(in_pb, annotation_prefix),
+	m_params(in_params),
+	m_X1(in_X1), m_Y1(in_Y1),
+	m_X2(in_X2), m_Y2(in_Y2),
+	m_bit(in_bit),
+	m_qx(make_variable(in_pb, FMT(annotation_prefix, ".qx"))),
+	m_qy(make_variable(in_pb, FMT(annotation_prefix, ".qy"))),
+	m_beta(make_variable(in_pb, FMT(annotation_prefix, ".beta"))),
+	m_gamma(make_variable(in_pb, FMT(annotation_prefix, ".gamma"))),
+	m_delta(make_variable(in_pb, FMT(annotation_prefix, ".delta"))),
+	m_tau(make_variable(in_pb, FMT(annotation_prefix, ".tau"))),
+	m_X3(make_variable(in_pb, FMT(annotation_prefix, ".X3"))),
+	m_Y3(make_variable(in_pb, FMT(annotation_prefix, ".Y3")))
+{
+
+}
+
+
+const VariableT& ConditionalPointAdder::result_x() const {
+	return m_X3;
+}
+
+
+const VariableT& ConditionalPointAdder::result_y() const {
+	return m_Y3;
+}
+
+
+void ConditionalPointAdder::generate_r1cs_constraints()
+{
+	if( is_witness_only(this->pb) ) {
+		return;
+	}
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_X2, m_bit, m_qx),
+		FMT(this->annotation_prefix, ".qx = x2 * bit"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_Y2, m_bit, m_qy - 1 + m_bit),
+		FMT(this->annotation_prefix, ".y2 * bit == (qy - 1) + bit"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_X1, m_qy, m_beta),
+		FMT(this->annotation_prefix, ".beta = X1 * qy"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_Y1, m_qx, m_gamma),
+		FMT(this->annotation_prefix, ".gamma = Y1 * qx"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_Y1 + ((-m_params.a) * m_X1), m_qx + m_qy, m_delta),
+		FMT(this->annotation_prefix, ".delta = (Y1 - a*X1) * (qx + qy)"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_beta, m_gamma, m_tau),
+		FMT(this->annotation_prefix, ".tau = beta * gamma"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_X3, 1 + (m_params.d * m_tau), m_beta + m_gamma),
+		FMT(this->annotation_prefix, ".x3 * (1 + (d*tau)) == (beta + gamma)"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_Y3, 1 - (m_params.d * m_tau), m_delta + (m_params.a * m_beta) - m_gamma),
+		FMT(this->annotation_prefix, ".y3 * (1 - (d*tau)) == (delta + a*beta - gamma)"));
+}
+
+
+void ConditionalPointAdder::generate_r1cs_witness()
+{
+	const bool bit = this->pb.val(m_bit) == FieldT::one();
+	const FieldT qx = bit ? this->pb.val(m_X2) : FieldT::zero();
+	const FieldT qy = bit ? this->pb.val(m_Y2) : FieldT::one();
+	const FieldT x1 = this->pb.val(m_X1);
+	const FieldT y1 = this->pb.val(m_Y1);
+
+	const FieldT beta = x1 * qy;
+	const FieldT gamma = y1 * qx;
+	const FieldT delta = (y1 - (m_params.a * x1)) * (qx + qy);
+	const FieldT tau = beta * gamma;
+
+	this->pb.val(m_qx) = qx;
+	this->pb.val(m_qy) = qy;
+	this->pb.val(m_beta) = beta;
+	this->pb.val(m_gamma) = gamma;
+	this->pb.val(m_delta) = delta;
+	this->pb.val(m_tau) = tau;
+	this->pb.val(m_X3) = (beta + gamma) * (FieldT::one() + (m_params.d * tau)).inverse();
+	this->pb.val(m_Y3) = (delta + (m_params.a * beta) - gamma) * (FieldT::one() - (m_params.d * tau)).inverse();
+}
+
+
 // namespace jubjub
 }
 
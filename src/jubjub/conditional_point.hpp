@@ -5,6 +5,7 @@
 // License: LGPL-3.0+
 
 #include "ethsnarks.hpp"
+#include "jubjub/params.hpp"
 
 
 namespace ethsnarks {
@@ -47,6 +48,66 @@ public:
 };
 
 
+/**
+* Adds a point to the accumulator if a bit is set, acc + bit*P, in 8
+* constraints instead of the 2 of a ConditionalPoint and 7 of a PointAdder
+*
+* The selected point (qx, qy) is P when the bit is set and (0, 1) otherwise,
+* and is added with:
+*
+*	beta = x1*qy, gamma = y1*qx, delta = (y1 - a*x1) * (qx + qy)
+*	tau = beta * gamma
+*	x3 * (1 + d*tau) = beta + gamma
+*	y3 * (1 - d*tau) = delta + a*beta - gamma
+*
+* where delta + a*beta - gamma = y1*qy - a*x1*qx, so the products x1*qx and
+* y1*qy aren't needed on their own.
+*/
+class ConditionalPointAdder : public GadgetT
+{
+public:
+	const Params& m_params;
+
+	// The accumulator
+	const VariableT m_X1;
+	const VariableT m_Y1;
+
+	// The point added when the bit is set
+	const VariableT m_X2;
+	const VariableT m_Y2;
+	const VariableT m_bit;
+
+	// Intermediate variables
+	const VariableT m_qx;
+	const VariableT m_qy;
+	const VariableT m_beta;
+	const VariableT m_gamma;
+	const VariableT m_delta;
+	const VariableT m_tau;
+	const VariableT m_X3;
+	const VariableT m_Y3;
+
+	ConditionalPointAdder(
+		ProtoboardT& in_pb,
+		const Params& in_params,
+		const VariableT in_X1,
+		const VariableT in_Y1,
+		const VariableT in_X2,
+		const VariableT in_Y2,
+		const VariableT in_bit,
+		const std::string& annotation_prefix
+	);
+
+	const VariableT& result_x() const;
+
+	const VariableT& result_y() const;
+
+	void generate_r1cs_constraints();
+
+	void generate_r1cs_witness();
+};
+
+
 // namespace jubjub
 }
 
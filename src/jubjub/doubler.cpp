@@ -89,6 +89,27 @@ void PointDoubler::generate_r1cs_witness()
 }
 
 
+void PointDoubler::generate_r1cs_witness( batch_inverter& inverter )
+{
+    this->pb.val(m_alpha) = this->pb.val(m_X1) * this->pb.val(m_X1);
+
+    this->pb.val(m_beta) = this->pb.val(m_Y1) * this->pb.val(m_Y1);
+
+    this->pb.val(m_gamma) = m_params.d*this->pb.val(m_alpha) * this->pb.val(m_beta);
+
+    this->pb.val(m_delta) = this->pb.val(m_X1) * this->pb.val(m_Y1) * 2;
+
+    inverter.add(this->pb.val(m_gamma) + 1, [this]( const FieldT& x3_rhs ) {
+        this->pb.val(m_X3) = this->pb.val(m_delta) * x3_rhs;
+    });
+
+    inverter.add(this->pb.val(m_gamma) - 1, [this]( const FieldT& y3_rhs ) {
+        const auto y3_lhs = ((this->pb.val(m_alpha)*m_params.a) - this->pb.val(m_beta));
+        this->pb.val(m_Y3) = y3_lhs * y3_rhs;
+    });
+}
+
+
 // namespace jubjub
 }
 
@@ -5,6 +5,7 @@
 // License: LGPL-3.0+
 
 #include "jubjub/params.hpp"
+#include "gadgets/batch_inverter.hpp"
 
 
 namespace ethsnarks {
@@ -82,6 +83,12 @@ public:
     void generate_r1cs_constraints();
 
     void generate_r1cs_witness();
+
+    /**
+    * Defer the inversion of the denominators to the batch, the result is
+    * set by `inverter.run()`
+    */
+    void generate_r1cs_witness( batch_inverter& inverter );
 };
 
 
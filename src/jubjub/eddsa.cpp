@@ -2,8 +2,13 @@
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
 #include "jubjub/eddsa.hpp"
+#include "jubjub/fixed_base_mul_zcash.hpp"
+#include "gadgets/witness_scheduler.hpp"
 #include "utils.hpp"
 
+#include <memory>
+#include <random>
+
 namespace ethsnarks {
 
 namespace jubjub {
@@ -152,6 +157,351 @@ void EdDSA::generate_r1cs_witness()
 }
 
 
+// --------------------------------------------------------------------
+
+
+PureEdDSA_batch::PureEdDSA_batch(
+    ProtoboardT& in_pb,
+    const Params& in_params,
+    const EdwardsPoint& in_base,                    // B
+    const std::vector<VariablePointT>& in_A,        // A of each signature
+    const std::vector<VariablePointT>& in_R,        // R
+    const std::vector<VariableArrayT>& in_s,        // s
+    const std::vector<VariableArrayT>& in_msg,      // m
+    const std::string& annotation_prefix
+) :
+    GadgetT(in_pb, annotation_prefix)
+{
+    const size_t n = in_A.size();
+    assert( in_R.size() == n && in_s.size() == n && in_msg.size() == n );
+
+    m_validators_R.reserve(n);
+    m_validators_A.reserve(n);
+    m_lhs.reserve(n);
+    m_hash_RAM.reserve(n);
+    m_At.reserve(n);
+    m_rhs.reserve(n);
+
+    for( size_t i = 0; i < n; i++ )
+    {
+        // IsValid(R), IsValid(A)
+        m_validators_R.emplace_back(in_pb, in_params, in_R[i].x, in_R[i].y, pb_annotation(in_pb, this->annotation_prefix, ".validator_R[%zu]", i));
+        m_validators_A.emplace_back(in_pb, in_params, in_A[i].x, in_A[i].y, pb_annotation(in_pb, this->annotation_prefix, ".validator_A[%zu]", i));
+
+        // lhs = ScalarMult(B, s)
+        m_lhs.emplace_back(in_pb, in_params, in_base.x, in_base.y, in_s[i], pb_annotation(in_pb, this->annotation_prefix, ".lhs[%zu]", i));
+
+        // hash_RAM = H(R, A, M)
+        m_hash_RAM.emplace_back(in_pb, in_params, in_R[i], in_A[i], in_msg[i], pb_annotation(in_pb, this->annotation_prefix, ".hash_RAM[%zu]", i));
+
+        // At = ScalarMult(A,hash_RAM)
+        m_At.emplace_back(in_pb, in_params, in_A[i].x, in_A[i].y, m_hash_RAM.back().result(), pb_annotation(in_pb, this->annotation_prefix, ".At[%zu]", i));
+
+        // rhs = PointAdd(R, At)
+        m_rhs.emplace_back(in_pb, in_params, in_R[i].x, in_R[i].y, m_At.back().result_x(), m_At.back().result_y(), pb_annotation(in_pb, this->annotation_prefix, ".rhs[%zu]", i));
+    }
+}
+
+
+size_t PureEdDSA_batch::size() const
+{
+    return m_lhs.size();
+}
+
+
+void PureEdDSA_batch::generate_r1cs_constraints()
+{
+    for( size_t i = 0; i < size(); i++ )
+    {
+        m_validators_R[i].generate_r1cs_constraints();
+        m_validators_A[i].generate_r1cs_constraints();
+        m_lhs[i].generate_r1cs_constraints();
+        m_hash_RAM[i].generate_r1cs_constraints();
+        m_At[i].generate_r1cs_constraints();
+        m_rhs[i].generate_r1cs_constraints();
+
+        // Verify the two points are equal
+        this->pb.add_r1cs_constraint(
+            ConstraintT(m_lhs[i].result_x(), FieldT::one(), m_rhs[i].result_x()),
+            FMT(this->annotation_prefix, "[%zu] lhs.x == rhs.x", i));
+
+        this->pb.add_r1cs_constraint(
+            ConstraintT(m_lhs[i].result_y(), FieldT::one(), m_rhs[i].result_y()),
+            FMT(this->annotation_prefix, "[%zu] lhs.y == rhs.y", i));
+    }
+}
+
+
+void PureEdDSA_batch::generate_r1cs_witness()
+{
+    witness_scheduler scheduler;
+    for( size_t i = 0; i < size(); i++ )
+    {
+        scheduler.add_job([this, i](){
+            m_validators_R[i].generate_r1cs_witness();
+            m_validators_A[i].generate_r1cs_witness();
+            m_lhs[i].generate_r1cs_witness();
+            m_hash_RAM[i].generate_r1cs_witness();
+            m_At[i].generate_r1cs_witness();
+            m_rhs[i].generate_r1cs_witness();
+        });
+    }
+    scheduler.run();
+}
+
+
+// --------------------------------------------------------------------
+
+
+std::vector<VariableArrayT> EdDSA_batch::hash_messages(
+    ProtoboardT& in_pb,
+    const Params& in_params,
+    const std::vector<VariableArrayT>& in_msg,
+    std::vector<PedersenHashToBits>& out_hashers,
+    const std::string& annotation_prefix
+) {
+    std::vector<VariableArrayT> result;
+    out_hashers.reserve(in_msg.size());
+    for( size_t i = 0; i < in_msg.size(); i++ )
+    {
+        out_hashers.emplace_back(in_pb, in_params, "EdDSA_Verify.M", in_msg[i], pb_annotation(in_pb, annotation_prefix, ".msg_hashed[%zu]", i));
+        result.push_back(out_hashers.back().result());
+    }
+    return result;
+}
+
+
+EdDSA_batch::EdDSA_batch(
+    ProtoboardT& in_pb,
+    const Params& in_params,
+    const EdwardsPoint& in_base,                    // B
+    const std::vector<VariablePointT>& in_A,        // A of each signature
+    const std::vector<VariablePointT>& in_R,        // R
+    const std::vector<VariableArrayT>& in_s,        // s
+    const std::vector<VariableArrayT>& in_msg,      // m
+    const std::string& annotation_prefix
+) :
+    // M = H(m)
+    m_msg_hashed(),
+
+    m_verifier(in_pb, in_params, in_base, in_A, in_R, in_s, hash_messages(in_pb, in_params, in_msg, m_msg_hashed, annotation_prefix), annotation_prefix)
+{ }
+
+
+void EdDSA_batch::generate_r1cs_constraints()
+{
+    for( auto& gadget : m_msg_hashed ) {
+        gadget.generate_r1cs_constraints();
+    }
+    m_verifier.generate_r1cs_constraints();
+}
+
+
+void EdDSA_batch::generate_r1cs_witness()
+{
+    witness_scheduler scheduler;
+    scheduler.add_all(m_msg_hashed);
+    scheduler.run();
+
+    m_verifier.generate_r1cs_witness();
+}
+
+
+// --------------------------------------------------------------------
+
+
+static const libff::bit_vector field_bits( const FieldT& value )
+{
+    const auto bigint = value.as_bigint();
+    libff::bit_vector result(FieldT::size_in_bits());
+    for( size_t i = 0; i < result.size(); i++ ) {
+        result[i] = bigint.test_bit(i);
+    }
+    return result;
+}
+
+
+static const libff::bit_vector mpz_bits( const mpz_t value )
+{
+    libff::bit_vector result(mpz_sizeinbase(value, 2));
+    for( size_t i = 0; i < result.size(); i++ ) {
+        result[i] = mpz_tstbit(value, i);
+    }
+    return result;
+}
+
+
+/**
+* The X coordinate of the Pedersen hash, like PedersenHashToBits
+*/
+static const FieldT pedersen_hash_x( const Params& params, const char *name, const libff::bit_vector& bits )
+{
+    const auto basepoints = EdwardsPoint::make_basepoints(name, fixed_base_mul_zcash::basepoints_required(bits.size()), params);
+    return fixed_base_mul_zcash_native(params, basepoints, bits).x;
+}
+
+
+static bool is_on_curve( const Params& params, const EdwardsPoint& point )
+{
+    const auto xx = point.x.squared();
+    const auto yy = point.y.squared();
+    return (params.a * xx) + yy == FieldT::one() + (params.d * xx * yy);
+}
+
+
+/**
+* The checks of PointValidator, on the curve and not of low order
+*/
+static bool is_valid_point( const Params& params, const EdwardsPoint& point )
+{
+    return is_on_curve(params, point)
+        && ! point.as_extended().dbl(params).dbl(params).dbl(params).X.is_zero();
+}
+
+
+template<>
+const libff::bit_vector eddsa_message_native<PureEdDSA>( const Params& params, const libff::bit_vector& msg )
+{
+    return msg;
+}
+
+
+template<>
+const libff::bit_vector eddsa_message_native<EdDSA>( const Params& params, const libff::bit_vector& msg )
+{
+    return field_bits(pedersen_hash_x(params, "EdDSA_Verify.M", msg));
+}
+
+
+const FieldT eddsa_hash_RAM_native( const Params& params, const EdwardsPoint& R, const EdwardsPoint& A, const libff::bit_vector& M )
+{
+    libff::bit_vector RAM_bits = field_bits(R.x);
+    const auto A_x_bits = field_bits(A.x);
+    RAM_bits.insert(RAM_bits.end(), A_x_bits.begin(), A_x_bits.end());
+    RAM_bits.insert(RAM_bits.end(), M.begin(), M.end());
+
+    return pedersen_hash_x(params, "EdDSA_Verify.RAM", RAM_bits);
+}
+
+
+/**
+* sum(z_i * (B*s_i - R_i - A_i*hash_RAM_i)) == 0 for the given signatures,
+* z_i is random, or 1 when there's only one signature
+*/
+static bool eddsa_equations_hold(
+    const Params& params,
+    const EdwardsPoint& B,
+    const std::vector<SignedMessage>& messages,
+    const std::vector<FieldT>& hashes,
+    const std::vector<size_t>& indices
+) {
+    std::unique_ptr<std::random_device> random(indices.size() > 1 ? new std::random_device : nullptr);
+    std::vector<EdwardsPointExt> points;
+    std::vector<libff::bit_vector> scalars;
+    points.reserve(1 + (indices.size() * 2));
+    scalars.reserve(1 + (indices.size() * 2));
+
+    mpz_t z, s, sum_zs, t;
+    mpz_init(z);
+    mpz_init(s);
+    mpz_init_set_ui(sum_zs, 0);
+    mpz_init(t);
+
+    points.push_back(B.as_extended());
+    for( const auto i : indices )
+    {
+        if( indices.size() == 1 ) {
+            mpz_set_ui(z, 1);
+        }
+        else {
+            uint32_t words[4];
+            for( auto& word : words ) {
+                word = (*random)();
+            }
+            mpz_import(z, 4, -1, sizeof(words[0]), 0, 0, words);
+        }
+
+        // B * sum(z_i * s_i)
+        messages[i].s.as_bigint().to_mpz(s);
+        mpz_addmul(sum_zs, z, s);
+
+        // - R_i * z_i
+        points.push_back(messages[i].R.as_extended().neg());
+        scalars.push_back(mpz_bits(z));
+
+        // - A_i * (z_i * hash_RAM_i)
+        hashes[i].as_bigint().to_mpz(t);
+        mpz_mul(t, t, z);
+        points.push_back(messages[i].A.as_extended().neg());
+        scalars.push_back(mpz_bits(t));
+    }
+    scalars.insert(scalars.begin(), mpz_bits(sum_zs));
+
+    mpz_clear(z);
+    mpz_clear(s);
+    mpz_clear(sum_zs);
+    mpz_clear(t);
+
+    return multi_scalar_mul(params, points, scalars).is_infinity();
+}
+
+
+bool pureeddsa_verify_batch(
+    const Params& params,
+    const EdwardsPoint& B,
+    const std::vector<SignedMessage>& messages,
+    std::vector<bool>* out_valid
+) {
+    const long n_messages = messages.size();
+
+    // The checks of each signature on its own, and its hash_RAM
+    std::vector<char> well_formed(n_messages, 0);
+    std::vector<FieldT> hashes(n_messages, FieldT::zero());
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( long i = 0; i < n_messages; i++ )
+    {
+        const auto& message = messages[i];
+        if( is_valid_point(params, message.R) && is_on_curve(params, message.A) ) {
+            well_formed[i] = 1;
+            hashes[i] = eddsa_hash_RAM_native(params, message.R, message.A, message.msg);
+        }
+    }
+
+    std::vector<size_t> indices;
+    for( long i = 0; i < n_messages; i++ ) {
+        if( well_formed[i] ) {
+            indices.push_back(i);
+        }
+    }
+
+    const bool all_valid = indices.size() == messages.size()
+                        && (indices.empty() || eddsa_equations_hold(params, B, messages, hashes, indices));
+
+    if( out_valid )
+    {
+        out_valid->assign(n_messages, all_valid);
+        if( ! all_valid )
+        {
+#ifdef MULTICORE
+            #pragma omp parallel for
+#endif
+            for( long i = 0; i < n_messages; i++ )
+            {
+                const bool valid = well_formed[i] && eddsa_equations_hold(params, B, messages, hashes, {size_t(i)});
+#ifdef MULTICORE
+                #pragma omp critical
+#endif
+                (*out_valid)[i] = valid;
+            }
+        }
+    }
+
+    return all_valid;
+}
+
+
 // namespace jubjub
 }
 
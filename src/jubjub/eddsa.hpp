@@ -181,6 +181,210 @@ public:
 };
 
 
+/**
+* A signed message, for native verification
+*/
+struct SignedMessage {
+    EdwardsPoint A;
+    EdwardsPoint R;
+    FieldT s;
+    libff::bit_vector msg;
+};
+
+
+/**
+* Verifies many PureEdDSA signatures in one circuit
+*
+* Each signature has its own equation, B*s == R + A*hash_RAM. Adding the
+* equations together, as pureeddsa_verify_batch does, is only sound with a
+* random weight for each which the prover can't choose, and multiplying by
+* those in the circuit costs more than it saves. So the savings come from
+* cheaper gadgets for each signature instead:
+*
+*  - B*s uses fixed_base_mul_signed, whose tables for B are made once and
+*    shared by every signature, see FixedBaseTable and make_basepoint
+*  - A is checked by a PointValidator, which lets A*hash_RAM use
+*    ScalarMultWindowed, about half the constraints of ScalarMult
+*
+* Rejecting a small order A is stricter than PureEdDSA, but no honest key
+* is of small order.
+*/
+class PureEdDSA_batch : public GadgetT
+{
+public:
+    std::vector<PointValidator> m_validators_R;     // IsValid(R)
+    std::vector<PointValidator> m_validators_A;     // IsValid(A)
+    std::vector<fixed_base_mul_signed> m_lhs;       // lhs = B*s
+    std::vector<EdDSA_HashRAM_gadget> m_hash_RAM;   // hash_RAM = H(R,A,M)
+    std::vector<ScalarMultWindowed> m_At;           // A*hash_RAM
+    std::vector<PointAdder> m_rhs;                  // rhs = R + (A*hash_RAM)
+
+    PureEdDSA_batch(
+        ProtoboardT& in_pb,
+        const Params& in_params,
+        const EdwardsPoint& in_base,                    // B
+        const std::vector<VariablePointT>& in_A,        // A of each signature
+        const std::vector<VariablePointT>& in_R,        // R
+        const std::vector<VariableArrayT>& in_s,        // s
+        const std::vector<VariableArrayT>& in_msg,      // m
+        const std::string& annotation_prefix);
+
+    size_t size() const;
+
+    void generate_r1cs_constraints();
+
+    /**
+    * The signatures are independent, and are computed concurrently
+    */
+    void generate_r1cs_witness();
+};
+
+
+/**
+* Verifies many EdDSA signatures in one circuit, with M = H(m), see
+* PureEdDSA_batch
+*/
+class EdDSA_batch
+{
+public:
+    std::vector<PedersenHashToBits> m_msg_hashed;   // M = H(m)
+
+    PureEdDSA_batch m_verifier;
+
+    EdDSA_batch(
+        ProtoboardT& in_pb,
+        const Params& in_params,
+        const EdwardsPoint& in_base,                    // B
+        const std::vector<VariablePointT>& in_A,        // A of each signature
+        const std::vector<VariablePointT>& in_R,        // R
+        const std::vector<VariableArrayT>& in_s,        // s
+        const std::vector<VariableArrayT>& in_msg,      // m
+        const std::string& annotation_prefix);
+
+    void generate_r1cs_constraints();
+
+    void generate_r1cs_witness();
+
+protected:
+    static std::vector<VariableArrayT> hash_messages(
+        ProtoboardT& in_pb,
+        const Params& in_params,
+        const std::vector<VariableArrayT>& in_msg,
+        std::vector<PedersenHashToBits>& out_hashers,
+        const std::string& annotation_prefix);
+};
+
+
+/**
+* The message as signed by PureEdDSA, i.e. H(m) for EdDSA
+*/
+template<class T>
+const libff::bit_vector eddsa_message_native( const Params& params, const libff::bit_vector& msg );
+
+template<>
+const libff::bit_vector eddsa_message_native<PureEdDSA>( const Params& params, const libff::bit_vector& msg );
+
+template<>
+const libff::bit_vector eddsa_message_native<EdDSA>( const Params& params, const libff::bit_vector& msg );
+
+
+/**
+* hash_RAM = H(R, A, M), natively, as the X coordinate of the hash
+*/
+const FieldT eddsa_hash_RAM_native( const Params& params, const EdwardsPoint& R, const EdwardsPoint& A, const libff::bit_vector& M );
+
+
+/**
+* Verify many PureEdDSA signatures natively, with B*s == R + A*hash_RAM
+* checked for all of them with one multi-scalar multiplication
+*
+* Each equation is scaled by a random 128 bit number before they're added,
+* so an invalid signature can't be cancelled out by another. R must pass
+* the same checks as PointValidator, A must be on the curve.
+*
+* If `out_valid` is given and the batch fails, each signature is checked
+* on its own to find which are valid.
+*
+* Like other cofactorless batch verifiers, a signature whose equation is
+* off by a small-order point is accepted with probability at most 1/8, it
+* can only be made with an R or A outside the prime-order subgroup.
+*/
+bool pureeddsa_verify_batch(
+    const Params& params,
+    const EdwardsPoint& B,
+    const std::vector<SignedMessage>& messages,
+    std::vector<bool>* out_valid = nullptr
+);
+
+
+/**
+* Use a compatible batch gadget, PureEdDSA_batch or EdDSA_batch, to verify
+* signatures in one circuit
+*/
+template<class T>
+bool eddsa_open_batch(
+    const Params& params,
+    const EdwardsPoint& B,
+    const std::vector<SignedMessage>& messages
+) {
+    ProtoboardT pb;
+
+    std::vector<VariablePointT> A, R;
+    std::vector<VariableArrayT> s, msg;
+    for( size_t i = 0; i < messages.size(); i++ )
+    {
+        const auto& message = messages[i];
+        A.push_back(message.A.as_VariablePointT(pb, FMT("A", "[%zu]", i)));
+        R.push_back(message.R.as_VariablePointT(pb, FMT("R", "[%zu]", i)));
+
+        s.push_back(make_var_array(pb, FieldT::size_in_bits(), FMT("s", "[%zu]", i)));
+        s.back().fill_with_bits_of_field_element(pb, message.s);
+
+        msg.push_back(make_var_array(pb, message.msg.size(), FMT("msg", "[%zu]", i)));
+        msg.back().fill_with_bits(pb, message.msg);
+    }
+
+    T the_gadget(pb, params, B, A, R, s, msg, "the_gadget");
+
+    the_gadget.generate_r1cs_constraints();
+    the_gadget.generate_r1cs_witness();
+    return pb.is_satisfied();
+}
+
+
+/**
+* Verify signatures natively, with the same result as eddsa_open<T>
+*/
+template<class T>
+bool eddsa_verify_batch(
+    const Params& params,
+    const EdwardsPoint& B,
+    const std::vector<SignedMessage>& in_messages,
+    std::vector<bool>* out_valid = nullptr
+) {
+    std::vector<SignedMessage> messages(in_messages);
+    const long n_messages = messages.size();
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( long i = 0; i < n_messages; i++ ) {
+        messages[i].msg = eddsa_message_native<T>(params, messages[i].msg);
+    }
+
+    return pureeddsa_verify_batch(params, B, messages, out_valid);
+}
+
+
+template<class T>
+bool eddsa_verify_native(
+    const Params& params,
+    const EdwardsPoint& B,
+    const SignedMessage& message
+) {
+    return eddsa_verify_batch<T>(params, B, {message});
+}
+
+
 // namespace jubjub
 }
 
@@ -2,6 +2,10 @@
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
 #include "jubjub/fixed_base_mul.hpp"
+#include "jubjub/fixed_base_table.hpp"
+#include "utils.hpp"
+
+#include <libff/algebra/fields/field_utils.hpp>   // convert_field_element_to_bit_vector
 
 namespace ethsnarks {
 
@@ -23,10 +27,13 @@ fixed_base_mul::fixed_base_mul(
 	int window_size_items = 1 << window_size_bits;
 	int n_windows = in_scalar.size() / window_size_bits;
 
-	FieldT start_x = in_base_x;
-	FieldT start_y = in_base_y;
-	FieldT x = in_base_x;
-	FieldT y = in_base_y;
+	// Multiples of each window's base, (4^i * base) * j, shared by every
+	// gadget with the same base
+	const auto table = FixedBaseTable::get(in_params, EdwardsPoint(in_base_x, in_base_y), window_size_bits, n_windows);
+
+	m_windows_x.reserve(n_windows);
+	m_windows_y.reserve(n_windows);
+	m_adders.reserve(n_windows > 0 ? n_windows - 1 : 0);
 
 	// Precompute values for all lookup window tables
 	for( int i = 0; i < n_windows; i++ )
@@ -39,38 +46,20 @@ fixed_base_mul::fixed_base_mul(
 		// (1,0) = 1 = start 		# add
 		// (0,1) = 2 = start+start	# double
 		// (1,1) = 3 = 2+start 		# double and add
-		for( int j = 0; j < window_size_items; j++ )
+		// When both bits are zero, add infinity (equivalent to zero)
+		lookup_x.emplace_back(0);
+		lookup_y.emplace_back(1);
+		for( int j = 1; j < window_size_items; j++ )
 		{
-			// When both bits are zero, add infinity (equivalent to zero)
-			if( j == 0 ) {
-				lookup_x.emplace_back(0);
-				lookup_y.emplace_back(1);
-				continue;
-			}
-			else {
-				lookup_x.emplace_back(x);
-				lookup_y.emplace_back(y);
-			}
-
-			// Affine addition
-			// TODO: move into library
-			const FieldT x1y2 = start_x * y;
-			const FieldT y1x2 = start_y * x;
-			const FieldT y1y2 = start_y * y;
-			const FieldT x1x2 = start_x * x;
-			const FieldT dx1x2y1y2 = in_params.d * x1x2 * y1y2;
-
-			x = (x1y2 + y1x2) * (FieldT::one() + dx1x2y1y2).inverse();
-			y = (y1y2 - (in_params.a * x1x2)) * (FieldT::one() - dx1x2y1y2).inverse();
+			const auto& point = table->multiple(i, j);
+			lookup_x.emplace_back(point.x);
+			lookup_y.emplace_back(point.y);
 		}
 
 		const auto bits_begin = in_scalar.begin() + (i * window_size_bits);
 		const VariableArrayT window_bits( bits_begin, bits_begin + window_size_bits );
-		m_windows_x.emplace_back(in_pb, lookup_x, window_bits, FMT(annotation_prefix, ".windows_x[%d]", i));
-		m_windows_y.emplace_back(in_pb, lookup_y, window_bits, FMT(annotation_prefix, ".windows_y[%d]", i));
-
-		start_x = x;
-		start_y = y;
+		m_windows_x.emplace_back(in_pb, lookup_x, window_bits, pb_annotation(in_pb, annotation_prefix, ".windows_x[%d]", i));
+		m_windows_y.emplace_back(in_pb, lookup_y, window_bits, pb_annotation(in_pb, annotation_prefix, ".windows_y[%d]", i));
 	}
 
 	// Chain adders together, adding output of previous adder with current window
@@ -84,7 +73,7 @@ fixed_base_mul::fixed_base_mul(
 				m_windows_y[i-1].result(),
 				m_windows_x[i].result(),
 				m_windows_y[i].result(),
-				FMT(this->annotation_prefix, ".adders[%d]", i));
+				pb_annotation(in_pb, this->annotation_prefix, ".adders[%d]", i));
 		}
 		else {
 			m_adders.emplace_back(
@@ -93,13 +82,17 @@ fixed_base_mul::fixed_base_mul(
 				m_adders[i-2].result_y(),
 				m_windows_x[i].result(),
 				m_windows_y[i].result(),
-				FMT(this->annotation_prefix, ".adders[%d]", i));
+				pb_annotation(in_pb, this->annotation_prefix, ".adders[%d]", i));
 		}
 	}
 }
 
 void fixed_base_mul::generate_r1cs_constraints ()
 {
+	if( is_witness_only(this->pb) ) {
+		return;
+	}
+
 	for( auto& lut_x : m_windows_x ) {
 		lut_x.generate_r1cs_constraints();
 	}
@@ -137,6 +130,297 @@ const VariableT& fixed_base_mul::result_y() const {
 }
 
 
+/**
+* Multiples of H = base * (L + 1) / 2, so 2 * H = base, for each window and
+* the top bits after them
+*/
+static std::shared_ptr<const FixedBaseTable> signed_window_table(
+	const Params& in_params,
+	const EdwardsPoint& in_base,
+	size_t n_bits
+) {
+	const FieldT half = (in_params.order + FieldT::one()) * FieldT(2).inverse();
+	const auto H = multi_scalar_mul(in_params, {in_base.as_extended()}, {libff::convert_field_element_to_bit_vector(half)});
+
+	const size_t n_windows = n_bits / fixed_base_mul_signed::WINDOW_BITS;
+	return FixedBaseTable::get(in_params, H.as_affine(), fixed_base_mul_signed::WINDOW_BITS, n_windows + 1, 7);
+}
+
+
+/**
+* (2*w - 7) * H + (8^n - 1) * H, which is (8^n - 8) * H + w * base
+*/
+static std::vector<EdwardsPoint> signed_first_window(
+	const Params& in_params,
+	const FixedBaseTable& in_table,
+	size_t n_windows
+) {
+	const auto base = in_table.multiple(0, 2).as_extended();
+	auto point = in_table.multiple(n_windows, 1).as_extended().add(in_table.multiple(1, 1).as_extended().neg(), in_params);
+
+	std::vector<EdwardsPointExt> points;
+	for( size_t w = 0; w < 8; w++ )
+	{
+		points.push_back(point);
+		point = point.add(base, in_params);
+	}
+
+	return EdwardsPointExt::batch_as_affine(points);
+}
+
+
+static std::vector<FieldT> points_x( const std::vector<EdwardsPoint>& points )
+{
+	std::vector<FieldT> result;
+	for( const auto& point : points ) {
+		result.push_back(point.x);
+	}
+	return result;
+}
+
+
+static std::vector<FieldT> points_y( const std::vector<EdwardsPoint>& points )
+{
+	std::vector<FieldT> result;
+	for( const auto& point : points ) {
+		result.push_back(point.y);
+	}
+	return result;
+}
+
+
+fixed_base_mul_signed::fixed_base_mul_signed(
+	ProtoboardT &in_pb,
+	const Params& in_params,
+	const FieldT& in_base_x,
+	const FieldT& in_base_y,
+	const VariableArrayT& in_scalar,
+	const std::string &annotation_prefix
+) :
+	GadgetT(in_pb, annotation_prefix),
+	m_scalar(in_scalar),
+	m_table(signed_window_table(in_params, EdwardsPoint(in_base_x, in_base_y), in_scalar.size())),
+	m_first_window(signed_first_window(in_params, *m_table, in_scalar.size() / WINDOW_BITS)),
+	m_first_x(in_pb, points_x(m_first_window), VariableArrayT(in_scalar.begin(), in_scalar.begin() + WINDOW_BITS), FMT(this->annotation_prefix, ".first_x")),
+	m_first_y(make_variable(in_pb, FMT(this->annotation_prefix, ".first_y")))
+{
+	assert( in_scalar.size() >= WINDOW_BITS );
+	const size_t n_windows = in_scalar.size() / WINDOW_BITS;
+
+	m_magnitudes.reserve(n_windows - 1);
+	m_windows_x.reserve(n_windows - 1);
+	m_windows_y.reserve(n_windows - 1);
+
+	for( size_t i = 1; i < n_windows; i++ )
+	{
+		const auto bits_begin = in_scalar.begin() + (i * WINDOW_BITS);
+
+		m_magnitudes.emplace_back();
+		m_magnitudes.back().allocate(in_pb, 2, pb_annotation(in_pb, annotation_prefix, ".magnitudes[%zu]", i));
+
+		// The odd multiples 1, 3, 5 and 7, lookup_signed_3bit negates X when the
+		// top bit is set, where the digit is positive
+		std::vector<FieldT> lookup_x;
+		std::vector<FieldT> lookup_y;
+		for( size_t m = 0; m < 4; m++ )
+		{
+			const auto& point = m_table->multiple(i, (2 * m) + 1);
+			lookup_x.emplace_back(-point.x);
+			lookup_y.emplace_back(point.y);
+		}
+
+		VariableArrayT signed_bits(m_magnitudes.back());
+		signed_bits.emplace_back(bits_begin[2]);
+		m_windows_x.emplace_back(in_pb, lookup_x, signed_bits, pb_annotation(in_pb, annotation_prefix, ".windows_x[%zu]", i));
+		m_windows_y.emplace_back(in_pb, lookup_y, m_magnitudes.back(), pb_annotation(in_pb, annotation_prefix, ".windows_y[%zu]", i));
+	}
+
+	// The top bits are times 8^n * base, which is 2 * 8^n * H. A single bit is
+	// looked up as both bits of the window, with 3 times the base for it
+	const size_t n_top = in_scalar.size() % WINDOW_BITS;
+	if( n_top > 0 )
+	{
+		const VariableT top_bits[2] = {in_scalar[n_windows * WINDOW_BITS], in_scalar[(n_windows * WINDOW_BITS) + n_top - 1]};
+		std::vector<FieldT> lookup_x = {FieldT::zero()};
+		std::vector<FieldT> lookup_y = {FieldT::one()};
+		for( size_t k = 1; k < 4; k++ )
+		{
+			const auto& point = m_table->multiple(n_windows, n_top == 1 ? 2 : (2 * k));
+			lookup_x.emplace_back(point.x);
+			lookup_y.emplace_back(point.y);
+		}
+
+		const VariableArrayT window_bits(top_bits, top_bits + 2);
+		m_top_x.emplace_back(in_pb, lookup_x, window_bits, FMT(this->annotation_prefix, ".top_x"));
+		m_top_y.emplace_back(in_pb, lookup_y, window_bits, FMT(this->annotation_prefix, ".top_y"));
+	}
+
+	// Chain adders together, starting with the first window
+	m_adders.reserve(m_windows_x.size() + m_top_x.size());
+	VariableT x = m_first_x.result();
+	VariableT y = m_first_y;
+	for( size_t i = 0; i < m_windows_x.size(); i++ )
+	{
+		m_adders.emplace_back(
+			in_pb, in_params, x, y,
+			m_windows_x[i].result(),
+			m_windows_y[i].result(),
+			pb_annotation(in_pb, this->annotation_prefix, ".adders[%zu]", i + 1));
+		x = m_adders.back().result_x();
+		y = m_adders.back().result_y();
+	}
+
+	if( n_top > 0 )
+	{
+		m_adders.emplace_back(
+			in_pb, in_params, x, y,
+			m_top_x[0].result(),
+			m_top_y[0].result(),
+			FMT(this->annotation_prefix, ".adders.top"));
+	}
+}
+
+void fixed_base_mul_signed::generate_r1cs_constraints ()
+{
+	if( is_witness_only(this->pb) ) {
+		return;
+	}
+
+	m_first_x.generate_r1cs_constraints();
+
+	// Y of the first window from the selectors of its X
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_first_x.lookup(points_y(m_first_window)), FieldT::one(), m_first_y),
+		FMT(this->annotation_prefix, ".first_y"));
+
+	for( size_t i = 0; i < m_magnitudes.size(); i++ )
+	{
+		const auto bits_begin = m_scalar.begin() + ((i + 1) * WINDOW_BITS);
+		const VariableT& top = bits_begin[2];
+
+		// m = b == top, 2*b*top == m - 1 + b + top
+		for( size_t j = 0; j < 2; j++ )
+		{
+			this->pb.add_r1cs_constraint(
+				ConstraintT(bits_begin[j] * FieldT(2), top, m_magnitudes[i][j] - 1 + bits_begin[j] + top),
+				FMT(this->annotation_prefix, ".magnitudes[%zu][%zu]", i + 1, j));
+		}
+
+		m_windows_x[i].generate_r1cs_constraints();
+		m_windows_y[i].generate_r1cs_constraints();
+	}
+
+	for( size_t i = 0; i < m_top_x.size(); i++ )
+	{
+		m_top_x[i].generate_r1cs_constraints();
+		m_top_y[i].generate_r1cs_constraints();
+	}
+
+	for( auto& adder : m_adders ) {
+		adder.generate_r1cs_constraints();
+	}
+}
+
+void fixed_base_mul_signed::generate_r1cs_witness ()
+{
+	m_first_x.generate_r1cs_witness();
+	const auto first = m_first_x.b.get_field_element_from_bits(this->pb).as_ulong();
+	this->pb.val(m_first_y) = m_first_window[first].y;
+
+	for( size_t i = 0; i < m_magnitudes.size(); i++ )
+	{
+		const auto bits_begin = m_scalar.begin() + ((i + 1) * WINDOW_BITS);
+		const bool top = this->pb.val(bits_begin[2]) == FieldT::one();
+
+		for( size_t j = 0; j < 2; j++ )
+		{
+			const auto& bit = this->pb.val(bits_begin[j]);
+			this->pb.val(m_magnitudes[i][j]) = top ? bit : FieldT::one() - bit;
+		}
+
+		m_windows_x[i].generate_r1cs_witness();
+		m_windows_y[i].generate_r1cs_witness();
+	}
+
+	for( size_t i = 0; i < m_top_x.size(); i++ )
+	{
+		m_top_x[i].generate_r1cs_witness();
+		m_top_y[i].generate_r1cs_witness();
+	}
+
+	for( auto& adder : m_adders ) {
+		adder.generate_r1cs_witness();
+	}
+}
+
+const VariableT& fixed_base_mul_signed::result_x() const {
+	return m_adders.empty() ? m_first_x.r : m_adders.back().result_x();
+}
+
+const VariableT& fixed_base_mul_signed::result_y() const {
+	return m_adders.empty() ? m_first_y : m_adders.back().result_y();
+}
+
+
+const EdwardsPoint fixed_base_mul_native(
+	const Params& in_params,
+	const EdwardsPoint& in_base,
+	const libff::bit_vector& in_scalar
+) {
+	const size_t window_size_bits = 2;
+	const size_t n_windows = (in_scalar.size() + window_size_bits - 1) / window_size_bits;
+	const auto table = FixedBaseTable::get(in_params, in_base, window_size_bits, n_windows);
+
+	EdwardsPointExt result = EdwardsPointExt::infinity();
+	for( size_t i = 0; i < n_windows; i++ )
+	{
+		size_t window = 0;
+		for( size_t j = 0; j < window_size_bits && (i * window_size_bits) + j < in_scalar.size(); j++ ) {
+			window |= size_t(in_scalar[(i * window_size_bits) + j]) << j;
+		}
+
+		if( window != 0 ) {
+			result = result.add(table->multiple(i, window).as_extended(), in_params);
+		}
+	}
+
+	return result.as_affine();
+}
+
+
+fixed_base_mul_instance::fixed_base_mul_instance(
+	ProtoboardT &in_pb,
+	const Params& in_params,
+	const FieldT& in_base_x,
+	const FieldT& in_base_y,
+	const VariableArrayT& in_scalar,
+	const std::string &annotation_prefix
+) :
+	instanced_gadget<fixed_base_mul>(
+		in_pb,
+		in_scalar,
+		VariableArrayT(),
+		instance_key(std::to_string(in_scalar.size()), {in_params.a, in_params.d, in_base_x, in_base_y}),
+		[&]( ProtoboardT& master_pb ) {
+			const auto scalar = make_var_array(master_pb, in_scalar.size(), ".dummy_inputs");
+			// The master lives for the rest of the process, so does its copy of the parameters
+			return new fixed_base_mul(master_pb, *new Params(in_params), in_base_x, in_base_y, scalar, ".fixed_base_mul_master");
+		},
+		annotation_prefix)
+{
+	m_result_x = variable(master.gadget->result_x());
+	m_result_y = variable(master.gadget->result_y());
+}
+
+const VariableT& fixed_base_mul_instance::result_x() const {
+	return m_result_x;
+}
+
+const VariableT& fixed_base_mul_instance::result_y() const {
+	return m_result_y;
+}
+
+
 // namespace jubjub
 }
 
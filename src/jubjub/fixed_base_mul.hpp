@@ -5,7 +5,11 @@
 // License: LGPL-3.0+
 
 #include "gadgets/lookup_2bit.hpp"
+#include "gadgets/lookup_3bit.hpp"
+#include "gadgets/lookup_signed_3bit.hpp"
 #include "jubjub/adder.hpp"
+#include "jubjub/fixed_base_table.hpp"
+#include "jubjub/point.hpp"
 
 
 namespace ethsnarks {
@@ -56,6 +60,94 @@ public:
 	const VariableT& result_y() const;
 };
 
+
+/**
+* Fixed base scalar multiplication with signed 3-bit windows
+*
+* Each window of bits w = b0 + 2*b1 + 4*b2 is the odd digit 2*w - 7, one of
+* -7, -5, ..., 5, 7, times 8^i * H where H is half of the base. Summing the
+* digits gives 2*s - (8^n - 1), so the sum of the windows plus (8^n - 1) * H
+* is s * base. The offset is folded into the first window's tables, and the
+* remaining 1 or 2 bits go in a 2-bit window of multiples of the base.
+*
+* The digit's magnitude is the low two bits when b2 is set, or their
+* complement when it isn't, which takes a constraint per bit. Then the X
+* coordinate comes from lookup_signed_3bit, which negates it when b2 is not
+* set, and the Y coordinate from lookup_2bit of the magnitude, 5 constraints
+* and one PointAdder per 3 bits instead of the 2 lookups and one PointAdder
+* per 2 bits of fixed_base_mul.
+*
+* H is only half of the base when the base has odd order, so it must be in
+* the prime order subgroup, as points made with make_basepoint are.
+*/
+class fixed_base_mul_signed : public GadgetT {
+public:
+	static const size_t WINDOW_BITS = 3;
+
+	const VariableArrayT m_scalar;
+	const std::shared_ptr<const FixedBaseTable> m_table;	// Multiples 1 to 7 of 8^i * H
+	const std::vector<EdwardsPoint> m_first_window;		// (2*w - 7) * H + (8^n - 1) * H
+	lookup_3bit_gadget m_first_x;
+	const VariableT m_first_y;
+
+	std::vector<VariableArrayT> m_magnitudes;
+	std::vector<lookup_signed_3bit_gadget> m_windows_x;
+	std::vector<lookup_2bit_gadget> m_windows_y;
+
+	// The 1 or 2 bits after the last window, if any
+	std::vector<lookup_2bit_gadget> m_top_x;
+	std::vector<lookup_2bit_gadget> m_top_y;
+
+	std::vector<PointAdder> m_adders;
+
+	fixed_base_mul_signed(
+		ProtoboardT &in_pb,
+		const Params& in_params,
+		const FieldT& in_base_x,
+		const FieldT& in_base_y,
+		const VariableArrayT& in_scalar,
+		const std::string &annotation_prefix
+	);
+
+	void generate_r1cs_constraints ();
+
+	void generate_r1cs_witness ();
+
+	const VariableT& result_x() const;
+
+	const VariableT& result_y() const;
+};
+
+
+/**
+* The result of fixed_base_mul natively, from the scalar's bits, little endian
+*/
+const EdwardsPoint fixed_base_mul_native(const Params& in_params, const EdwardsPoint& in_base, const libff::bit_vector& in_scalar);
+
+
+/**
+* fixed_base_mul sharing the constraints of one master per base point and
+* scalar size, see instanced_gadget
+*/
+class fixed_base_mul_instance : public instanced_gadget<fixed_base_mul> {
+public:
+	VariableT m_result_x;
+	VariableT m_result_y;
+
+	fixed_base_mul_instance(
+		ProtoboardT &in_pb,
+		const Params& in_params,
+		const FieldT& in_base_x,
+		const FieldT& in_base_y,
+		const VariableArrayT& in_scalar,
+		const std::string &annotation_prefix
+	);
+
+	const VariableT& result_x() const;
+
+	const VariableT& result_y() const;
+};
+
 // namespace jubjub
 }
 
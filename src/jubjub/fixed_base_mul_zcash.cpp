@@ -2,6 +2,10 @@
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
 #include "jubjub/fixed_base_mul_zcash.hpp"
+#include "jubjub/fixed_base_table.hpp"
+#include "gadgets/witness_scheduler.hpp"
+
+#include <algorithm>
 
 
 namespace ethsnarks {
@@ -35,7 +39,15 @@ fixed_base_mul_zcash::fixed_base_mul_zcash(
 	const int window_size_items = 1 << LOOKUP_SIZE_BITS;
 	const int n_windows = in_scalar.size() / CHUNK_SIZE_BITS;
 
-	EdwardsPoint start = base_points[0];
+	// Multiples of each base point's windows, shared by every gadget with
+	// the same base points, see FixedBaseTable
+	std::vector<std::shared_ptr<const FixedBaseTable>> tables;
+	for( int i = 0; i < n_windows; i += CHUNKS_PER_BASE_POINT )
+	{
+		const size_t n = std::min<size_t>(CHUNKS_PER_BASE_POINT, n_windows - i);
+		tables.push_back(FixedBaseTable::get(in_params, base_points[ i / CHUNKS_PER_BASE_POINT ], CHUNK_SIZE_BITS + 1, n));
+	}
+
 	// Precompute values for all lookup window tables
 	for( int i = 0; i < n_windows; i++ )
 	{
@@ -45,27 +57,21 @@ fixed_base_mul_zcash::fixed_base_mul_zcash(
 		lookup_x.reserve(window_size_items);
 		lookup_y.reserve(window_size_items);
 
-		if (i % CHUNKS_PER_BASE_POINT == 0) {
-			start = base_points[ i / CHUNKS_PER_BASE_POINT ];
-		}
-
 		// For each window, generate 4 points, in little endian:
 		// (0,0) = 0 = start = base*2^4i
 		// (1,0) = 1 = 2*start
 		// (0,1) = 2 = 3*start
 		// (1,1) = 3 = 4*start
-		EdwardsPoint current = start;
+		const auto& table = *tables[ i / CHUNKS_PER_BASE_POINT ];
 		for( int j = 0; j < window_size_items; j++ )
 		{
-			if (j != 0) {
-				current = current.add(start, in_params);
-			}
-			const auto montgomery = current.as_montgomery(in_params);
+			const auto& montgomery = table.multiple_montgomery(i % CHUNKS_PER_BASE_POINT, j + 1);
 			lookup_x.emplace_back(montgomery.x);
 			lookup_y.emplace_back(montgomery.y);
 
 #ifdef DEBUG
 			const auto edward = montgomery.as_edwards(in_params);
+			const auto& current = table.multiple(i % CHUNKS_PER_BASE_POINT, j + 1);
 			assert (edward.x == current.x);
 			assert (edward.y == current.y);
 #endif
@@ -88,9 +94,6 @@ fixed_base_mul_zcash::fixed_base_mul_zcash(
 			LinearTermT(m_windows_y.back().b0b1, (lookup_x[3] - lookup_x[2] - lookup_x[1] + lookup_x[0]))
 		);
 		m_windows_x.emplace_back(x_lc);
-
-		// current is at 2^2 * start, for next iteration start needs to be 2^4
-		start = current.dbl(in_params).dbl(in_params);
 	}
 
 	// Chain adders within one segment together via montgomery adders
@@ -197,29 +200,46 @@ void fixed_base_mul_zcash::generate_r1cs_constraints ()
 	}
 }
 
+/**
+* Each window's lookup is independent, and so is the chain of montgomery
+* adders of each segment, they're computed concurrently. Each chain costs
+* two inversions, see MontgomeryAdder::generate_r1cs_witness_chain. Only
+* the edwards adders joining the segments are sequential, one per base point.
+*/
 void fixed_base_mul_zcash::generate_r1cs_witness ()
 {
+	witness_scheduler scheduler;
+
 	// y lookups have to be solved first, because
 	// x depends on the `b0 && b1` constraint.
-	for( auto& lut_y : m_windows_y ) {
-		lut_y.generate_r1cs_witness();
-	}
-
-	for( auto& lut_x : m_windows_x ) {
-		lut_x.evaluate(this->pb);
+	for( size_t i = 0; i < m_windows_y.size(); i++ )
+	{
+		scheduler.add_job([this, i](){
+			m_windows_y[i].generate_r1cs_witness();
+			m_windows_x[i].evaluate(this->pb);
+		});
 	}
+	scheduler.barrier();
 
-	for( auto& adder : montgomery_adders ) {
-		adder.generate_r1cs_witness();
+	const size_t segment_width = CHUNKS_PER_BASE_POINT - 1;
+	for( size_t begin = 0; begin < montgomery_adders.size(); begin += segment_width )
+	{
+		const size_t end = std::min(begin + segment_width, montgomery_adders.size());
+		scheduler.add_job([this, begin, end](){
+			MontgomeryAdder::generate_r1cs_witness_chain(montgomery_adders, begin, end);
+		});
 	}
+	scheduler.barrier();
 
-	for( auto& converter : point_converters ) {
-		converter.generate_r1cs_witness();
-	}
+	scheduler.add_all(point_converters);
+	scheduler.barrier();
 
-	for( auto& adder : edward_adders ) {
-		adder.generate_r1cs_witness();
-	}
+	scheduler.add_job([this](){
+		for( auto& adder : edward_adders ) {
+			adder.generate_r1cs_witness();
+		}
+	});
+	scheduler.run();
 }
 
 const VariableT& fixed_base_mul_zcash::result_x() const {
@@ -231,6 +251,43 @@ const VariableT& fixed_base_mul_zcash::result_y() const {
 }
 
 
+const EdwardsPoint fixed_base_mul_zcash_native(
+	const Params& in_params,
+	const std::vector<EdwardsPoint>& base_points,
+	const libff::bit_vector& in_scalar
+) {
+	assert( in_scalar.size() > 0 );
+	assert( fixed_base_mul_zcash::basepoints_required(in_scalar.size()) <= base_points.size() );
+	const size_t n_windows = (in_scalar.size() + CHUNK_SIZE_BITS - 1) / CHUNK_SIZE_BITS;
+
+	EdwardsPointExt result = EdwardsPointExt::infinity();
+	for( size_t i = 0; i < n_windows; i += CHUNKS_PER_BASE_POINT )
+	{
+		const size_t n = std::min<size_t>(CHUNKS_PER_BASE_POINT, n_windows - i);
+		const auto table = FixedBaseTable::get(in_params, base_points[ i / CHUNKS_PER_BASE_POINT ], CHUNK_SIZE_BITS + 1, n);
+
+		for( size_t j = 0; j < n; j++ )
+		{
+			// Bits past the end of the scalar are zero, like the padding of the Python version
+			size_t window = 0;
+			for( size_t k = 0; k < CHUNK_SIZE_BITS; k++ )
+			{
+				const size_t bit = ((i + j) * CHUNK_SIZE_BITS) + k;
+				if( bit < in_scalar.size() && in_scalar[bit] ) {
+					window |= size_t(1) << k;
+				}
+			}
+
+			// The low bits select the multiple, the high bit negates it
+			const auto segment = table->multiple(j, (window & 0b11) + 1).as_extended();
+			result = result.add(window & 0b100 ? segment.neg() : segment, in_params);
+		}
+	}
+
+	return result.as_affine();
+}
+
+
 // namespace jubjub
 }
 
@@ -42,6 +42,13 @@ public:
 };
 
 
+/**
+* The result of fixed_base_mul_zcash natively, i.e. the Pedersen hash of
+* the bits, little endian
+*/
+const EdwardsPoint fixed_base_mul_zcash_native(const Params& in_params, const std::vector<EdwardsPoint>& base_points, const libff::bit_vector& in_scalar);
+
+
 // namespace jubjub
 }
 
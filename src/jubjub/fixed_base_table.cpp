@@ -0,0 +1,86 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "jubjub/fixed_base_table.hpp"
+
+#include <map>
+#include <mutex>
+
+
+namespace ethsnarks {
+
+namespace jubjub {
+
+
+FixedBaseTable::FixedBaseTable(
+    const Params& in_params,
+    const EdwardsPoint& in_base,
+    size_t in_window_bits,
+    size_t in_n_windows,
+    size_t in_n_multiples
+) :
+    window_bits(in_window_bits),
+    n_multiples(in_n_multiples)
+{
+    assert( in_window_bits > 0 );
+    assert( in_n_multiples > 0 );
+
+    // The multiples are found in extended coordinates, then converted together
+    std::vector<EdwardsPointExt> multiples;
+    multiples.reserve(in_n_windows * in_n_multiples);
+
+    EdwardsPointExt start = in_base.as_extended();
+    for( size_t i = 0; i < in_n_windows; i++ )
+    {
+        EdwardsPointExt current = start;
+        for( size_t k = 1; k <= in_n_multiples; k++ )
+        {
+            if( k != 1 ) {
+                current = current.add(start, in_params);
+            }
+            multiples.push_back(current);
+        }
+
+        // The base of the next window, 2^window_bits times this one's
+        for( size_t j = 0; j < in_window_bits; j++ ) {
+            start = start.dbl(in_params);
+        }
+    }
+
+    points = EdwardsPointExt::batch_as_affine(multiples);
+    montgomery = EdwardsPointExt::batch_as_montgomery(multiples, in_params);
+}
+
+
+std::shared_ptr<const FixedBaseTable> FixedBaseTable::get(
+    const Params& in_params,
+    const EdwardsPoint& in_base,
+    size_t in_window_bits,
+    size_t in_n_windows,
+    size_t in_n_multiples
+) {
+    static std::mutex tables_mutex;
+    static std::map<std::string, std::shared_ptr<const FixedBaseTable>> tables;
+
+    std::string key(std::to_string(in_window_bits) + "," + std::to_string(in_n_multiples));
+    for( const auto& value : {in_params.a, in_params.d, in_base.x, in_base.y} )
+    {
+        const auto limbs = value.as_bigint();
+        key.append(reinterpret_cast<const char*>(limbs.data), sizeof(limbs.data));
+    }
+
+    std::lock_guard<std::mutex> guard(tables_mutex);
+    auto& table = tables[key];
+    if( ! table || table->n_windows() < in_n_windows ) {
+        // Instances already holding the shorter table keep it
+        table = std::make_shared<const FixedBaseTable>(in_params, in_base, in_window_bits, in_n_windows, in_n_multiples);
+    }
+    return table;
+}
+
+
+// namespace jubjub
+}
+
+// namespace ethsnarks
+}
@@ -0,0 +1,68 @@
+#ifndef JUBJUB_FIXED_BASE_TABLE_HPP_
+#define JUBJUB_FIXED_BASE_TABLE_HPP_
+
+// Copyright (c) 2018 @HarryR
+// License: LGPL-3.0+
+
+#include "jubjub/point.hpp"
+
+#include <memory>
+
+
+namespace ethsnarks {
+
+namespace jubjub {
+
+
+/**
+* Multiples of a fixed base for windowed scalar multiplication
+*
+* Window i has base * 2^(window_bits * i) times 1 to n_multiples, in both
+* edwards and montgomery form. The default of 4 covers the 2-bit windows of
+* fixed_base_mul and the signed 3-bit windows of fixed_base_mul_zcash.
+*
+* Tables are made once per parameters, base, window size and number of
+* multiples, and shared by
+* every gadget and native multiplication for the rest of the process. They
+* are extended when more windows are asked for than a table has.
+*/
+class FixedBaseTable
+{
+public:
+    static const size_t MULTIPLES = 4;
+
+    const size_t window_bits;
+    const size_t n_multiples;
+    std::vector<EdwardsPoint> points;           // n_multiples per window
+    std::vector<MontgomeryPoint> montgomery;
+
+    FixedBaseTable(const Params& in_params, const EdwardsPoint& in_base, size_t in_window_bits, size_t in_n_windows, size_t in_n_multiples = MULTIPLES);
+
+    size_t n_windows() const
+    {
+        return points.size() / n_multiples;
+    }
+
+    /** `k` times the base of window `i`, where 1 <= k <= n_multiples */
+    const EdwardsPoint& multiple(size_t i, size_t k) const
+    {
+        return points[(i * n_multiples) + k - 1];
+    }
+
+    const MontgomeryPoint& multiple_montgomery(size_t i, size_t k) const
+    {
+        return montgomery[(i * n_multiples) + k - 1];
+    }
+
+    static std::shared_ptr<const FixedBaseTable> get(const Params& in_params, const EdwardsPoint& in_base, size_t in_window_bits, size_t in_n_windows, size_t in_n_multiples = MULTIPLES);
+};
+
+
+// namespace jubjub
+}
+
+// namespace ethsnarks
+}
+
+// JUBJUB_FIXED_BASE_TABLE_HPP_
+#endif
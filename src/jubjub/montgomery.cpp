@@ -2,6 +2,7 @@
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
 #include "jubjub/montgomery.hpp"
+#include "jubjub/point.hpp"
 #include "utils.hpp"
 
 
@@ -58,6 +59,101 @@ void MontgomeryAdder::generate_r1cs_witness()
     this->pb.val(m_Y3) = -(this->pb.val(m_Y1) + (this->pb.val(lambda)*(this->pb.val(m_X3) - this->pb.lc_val(m_X1))));
 }
 
+void MontgomeryAdder::generate_r1cs_witness( batch_inverter& inverter )
+{
+    inverter.add(this->pb.lc_val(m_X2) - this->pb.lc_val(m_X1), [this]( const FieldT& dx_inv ) {
+        this->pb.val(lambda) = (this->pb.val(m_Y2) - this->pb.val(m_Y1)) * dx_inv;
+        this->pb.val(m_X3) = this->pb.val(lambda).squared() - m_params.A - this->pb.lc_val(m_X1) - this->pb.lc_val(m_X2);
+        this->pb.val(m_Y3) = -(this->pb.val(m_Y1) + (this->pb.val(lambda)*(this->pb.val(m_X3) - this->pb.lc_val(m_X1))));
+    });
+}
+
+void MontgomeryAdder::generate_r1cs_witness_chain( std::vector<MontgomeryAdder>& adders, size_t begin, size_t end )
+{
+    if( begin >= end ) {
+        return;
+    }
+    auto& pb = adders[begin].pb;
+    const auto& params = adders[begin].m_params;
+
+    std::vector<MontgomeryPointProj> sums;
+    sums.reserve(end - begin);
+    MontgomeryPointProj sum(pb.lc_val(adders[begin].m_X1), pb.val(adders[begin].m_Y1), FieldT::one());
+    for( size_t i = begin; i < end; i++ )
+    {
+        sum = sum.add(MontgomeryPointProj(pb.lc_val(adders[i].m_X2), pb.val(adders[i].m_Y2), FieldT::one()), params);
+        sums.push_back(sum);
+    }
+
+    const auto results = MontgomeryPointProj::batch_as_affine(sums);
+    for( size_t i = begin; i < end; i++ )
+    {
+        pb.val(adders[i].m_X3) = results[i - begin].x;
+        pb.val(adders[i].m_Y3) = results[i - begin].y;
+    }
+
+    batch_inverter inverter;
+    for( size_t i = begin; i < end; i++ ) {
+        adders[i].generate_r1cs_witness(inverter);
+    }
+    inverter.run();
+}
+
+
+// --------------------------------------------------------------------
+
+
+MontgomeryDoubler::MontgomeryDoubler(
+    ProtoboardT& in_pb,
+    const Params& in_params,
+    const VariableT in_X1,
+    const VariableT in_Y1,
+    const std::string &annotation_prefix
+) :
+    GadgetT(in_pb, annotation_prefix),
+    m_params(in_params),
+    m_X1(in_X1), m_Y1(in_Y1),
+    m_XX(make_variable(in_pb, FMT(annotation_prefix, ".XX"))),
+    lambda(make_variable(in_pb, FMT(annotation_prefix, ".lambda"))),
+    m_X3(make_variable(in_pb, FMT(annotation_prefix, ".X3"))),
+    m_Y3(make_variable(in_pb, FMT(annotation_prefix, ".Y3")))
+{}
+
+void MontgomeryDoubler::generate_r1cs_constraints()
+{
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_X1, m_X1, m_XX),
+            FMT(annotation_prefix, ".xx = x * x"));
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_Y1 * FieldT(2), lambda, {(m_XX * FieldT(3)) + (m_X1 * (m_params.A + m_params.A)) + 1}),
+            FMT(annotation_prefix, ".lambda = (3*xx + 2*A*x + 1) / (2*y)"));
+    this->pb.add_r1cs_constraint(
+        ConstraintT(lambda, lambda, {m_params.A + m_X1 + m_X1 + m_X3}),
+            FMT(annotation_prefix, ".(lambda) * (lambda) = (A + x + x + x'')"));
+    this->pb.add_r1cs_constraint(
+        ConstraintT({m_X1 - m_X3}, lambda, {m_Y3 + m_Y1}),
+            FMT(annotation_prefix, ".y'' = -(y + lambda(x'' - x))"));
+}
+
+const VariableT& MontgomeryDoubler::result_x() const
+{
+    return m_X3;
+}
+
+const VariableT& MontgomeryDoubler::result_y() const
+{
+    return m_Y3;
+}
+
+void MontgomeryDoubler::generate_r1cs_witness()
+{
+    const auto x = this->pb.val(m_X1);
+    this->pb.val(m_XX) = x.squared();
+    this->pb.val(lambda) = ((FieldT(3) * this->pb.val(m_XX)) + (FieldT(2) * m_params.A * x) + FieldT::one()) * (FieldT(2) * this->pb.val(m_Y1)).inverse();
+    this->pb.val(m_X3) = this->pb.val(lambda).squared() - m_params.A - x - x;
+    this->pb.val(m_Y3) = -(this->pb.val(m_Y1) + (this->pb.val(lambda)*(this->pb.val(m_X3) - x)));
+}
+
 
 // --------------------------------------------------------------------
 
@@ -103,6 +199,50 @@ const VariableT& MontgomeryToEdwards::result_y() const
 }
 
 
+// --------------------------------------------------------------------
+
+
+EdwardsToMontgomery::EdwardsToMontgomery(
+    ProtoboardT &in_pb,
+    const Params& in_params,
+    const VariableT in_X,
+    const VariableT in_Y,
+    const std::string &annotation_prefix
+) :
+    GadgetT(in_pb, annotation_prefix),
+    m_params(in_params),
+    m_X1(in_X), m_Y1(in_Y),
+    m_X2(make_variable(in_pb, FMT(annotation_prefix, ".result_x"))),
+    m_Y2(make_variable(in_pb, FMT(annotation_prefix, ".result_y")))
+{}
+
+void EdwardsToMontgomery::generate_r1cs_constraints()
+{
+    this->pb.add_r1cs_constraint(
+        ConstraintT({FieldT::one() - m_Y1}, m_X2, {FieldT::one() + m_Y1}),
+            FMT(annotation_prefix, ".x_result = (1 + y) / (1 - y)"));
+    this->pb.add_r1cs_constraint(
+        ConstraintT(m_X1, m_Y2, m_X2 * m_params.scale),
+            FMT(annotation_prefix, ".y_result = (scale*x_result) / x"));
+}
+
+void EdwardsToMontgomery::generate_r1cs_witness()
+{
+    this->pb.val(m_X2) = (FieldT::one() + this->pb.val(m_Y1)) * (FieldT::one() - this->pb.val(m_Y1)).inverse();
+    this->pb.val(m_Y2) = m_params.scale * this->pb.val(m_X2) * this->pb.val(m_X1).inverse();
+}
+
+const VariableT& EdwardsToMontgomery::result_x() const
+{
+    return m_X2;
+}
+
+const VariableT& EdwardsToMontgomery::result_y() const
+{
+    return m_Y2;
+}
+
+
 // namespace jubjub
 }
 
@@ -6,6 +6,7 @@
 
 #include "ethsnarks.hpp"
 #include "jubjub/params.hpp"
+#include "gadgets/batch_inverter.hpp"
 
 
 namespace ethsnarks {
@@ -47,6 +48,62 @@ public:
     void generate_r1cs_constraints();
 
     void generate_r1cs_witness();
+
+    /**
+    * Defer the inversion of the denominators to the batch, the result is
+    * set by `inverter.run()`
+    */
+    void generate_r1cs_witness( batch_inverter& inverter );
+
+    /**
+    * Witness of the chain adders[begin] ... adders[end-1], where each adds
+    * its second point to the result of the one before
+    *
+    * The sums are computed natively in projective coordinates and made
+    * affine together, after which every input is known and the lambdas
+    * share a batch, so the chain costs two inversions rather than one per
+    * adder. The second points must already be known.
+    */
+    static void generate_r1cs_witness_chain( std::vector<MontgomeryAdder>& adders, size_t begin, size_t end );
+};
+
+
+/**
+* Doubles a point in Montgomery form
+*
+*   lambda = (3*x^2 + 2*A*x + 1) / (2*y)
+*
+* The point mustn't have order 2, i.e. y != 0
+*/
+class MontgomeryDoubler : public GadgetT {
+public:
+    const Params& m_params;
+
+    // Input point
+    const VariableT m_X1;
+    const VariableT m_Y1;
+
+    // Intermediate variables
+    const VariableT m_XX;
+    const VariableT lambda;
+    const VariableT m_X3;
+    const VariableT m_Y3;
+
+    MontgomeryDoubler(
+        ProtoboardT& in_pb,
+        const Params& in_params,
+        const VariableT in_X1,
+        const VariableT in_Y1,
+        const std::string& annotation_prefix
+    );
+
+    const VariableT& result_x() const;
+
+    const VariableT& result_y() const;
+
+    void generate_r1cs_constraints();
+
+    void generate_r1cs_witness();
 };
 
 
@@ -82,6 +139,40 @@ public:
 }; 
 
 
+/**
+* Gadget to verify the conversion from the twisted Edwards form of a point
+* to its Montgomery form, the reverse of MontgomeryToEdwards
+*
+* The point mustn't be infinity, (0, 1), or of order 2, (0, -1)
+*/
+class EdwardsToMontgomery : public GadgetT {
+public:
+    const Params& m_params;
+
+    // Input point
+    const VariableT m_X1;
+    const VariableT m_Y1;
+
+    // Output point
+    const VariableT m_X2;
+    const VariableT m_Y2;
+
+    EdwardsToMontgomery(
+        ProtoboardT &in_pb,
+        const Params& in_params,
+        const VariableT in_X,
+        const VariableT in_Y,
+        const std::string &annotation_prefix
+    );
+
+    const VariableT& result_x() const;
+    const VariableT& result_y() const;
+
+    void generate_r1cs_constraints();
+    void generate_r1cs_witness();
+};
+
+
 // namespace jubjub
 }
 
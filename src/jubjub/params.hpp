@@ -23,13 +23,35 @@ public:
     const FieldT A;
     const FieldT scale;
 
+    // Order of the prime order subgroup, L, the base point's order
+    const FieldT order;
+
+    /**
+    * A copy of the parameters, which are parsed once per process, after
+    * libff's number system is initialised
+    */
     Params() :
+        Params(shared())
+    {}
+
+private:
+    struct Parse {};
+
+    static const Params& shared()
+    {
+        // Initialised once and thread safe, a static local of an inline function is shared by every TU
+        static const Params params((Parse()));
+        return params;
+    }
+
+    explicit Params(Parse) :
         Gx("16540640123574156134436876038791482806971768689494387082833631921987005038935"),
         Gy("20819045374670962167435360035096875258406992893633759881276124905556507972311"),
         a("168700"),
         d("168696"),
         A("168698"),
-        scale("1")
+        scale("1"),
+        order("2736030358979909402780800718157159386076813972158567259200215660948447373041")
     {}
 };
 
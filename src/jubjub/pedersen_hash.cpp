@@ -51,6 +51,45 @@ void PedersenHash::generate_r1cs_witness ()
 // --------------------------------------------------------------------
 
 
+PedersenHashInstance::PedersenHashInstance(
+    ProtoboardT& in_pb,
+    const Params& in_params,
+    const char *name,
+    const VariableArrayT& in_bits,
+    const std::string& annotation_prefix
+) :
+    instanced_gadget<PedersenHash>(
+        in_pb,
+        in_bits,
+        VariableArrayT(),
+        instance_key(std::string(name) + "/" + std::to_string(in_bits.size()), {in_params.a, in_params.d}),
+        [&]( ProtoboardT& master_pb ) {
+            const auto bits = make_var_array(master_pb, in_bits.size(), ".dummy_inputs");
+            // The master lives for the rest of the process, so does its copy of the parameters
+            return new PedersenHash(master_pb, *new Params(in_params), name, bits, ".pedersen_master");
+        },
+        annotation_prefix)
+{
+    m_result_x = variable(master.gadget->result_x());
+    m_result_y = variable(master.gadget->result_y());
+}
+
+
+const VariableT& PedersenHashInstance::result_x() const
+{
+    return m_result_x;
+}
+
+
+const VariableT& PedersenHashInstance::result_y() const
+{
+    return m_result_y;
+}
+
+
+// --------------------------------------------------------------------
+
+
 PedersenHashToBits::PedersenHashToBits(
     ProtoboardT& in_pb,
     const Params& in_params,
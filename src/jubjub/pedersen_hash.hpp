@@ -7,6 +7,7 @@
 #include "jubjub/point.hpp"
 #include "jubjub/fixed_base_mul_zcash.hpp"
 #include "gadgets/field2bits_strict.hpp"
+#include "gadgets/instanced_gadget.hpp"
 
 
 namespace ethsnarks {
@@ -69,6 +70,29 @@ public:
 };
 
 
+/**
+* PedersenHash sharing the constraints of one master per name and input
+* size, see instanced_gadget
+*/
+class PedersenHashInstance : public instanced_gadget<PedersenHash>
+{
+public:
+    VariableT m_result_x;
+    VariableT m_result_y;
+
+    PedersenHashInstance(
+        ProtoboardT& in_pb,
+        const Params& in_params,
+        const char *name,
+        const VariableArrayT& in_bits,
+        const std::string& annotation_prefix);
+
+    const VariableT& result_x() const;
+
+    const VariableT& result_y() const;
+};
+
+
 // namespace jubjub
 }
 
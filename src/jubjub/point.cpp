@@ -2,9 +2,16 @@
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
 #include "jubjub/point.hpp"
+#include "jubjub/basepoints.hpp"
 #include "utils.hpp"
 #include "crypto/sha256.h"
 
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
+
 using libff::bigint;
 
 
@@ -130,6 +137,12 @@ const EdwardsPoint EdwardsPoint::from_y_always (const FieldT in_y, const Params&
 }
 
 
+const EdwardsPointExt EdwardsPoint::as_extended() const
+{
+    return EdwardsPointExt(x, y, FieldT::one(), x * y);
+}
+
+
 const MontgomeryPoint EdwardsPoint::as_montgomery(const Params& in_params) const
 {
     // The only points on the curve with x=0 or y=1 (for which birational equivalence is not valid), 
@@ -143,7 +156,7 @@ const MontgomeryPoint EdwardsPoint::as_montgomery(const Params& in_params) const
 }
 
 
-const EdwardsPoint EdwardsPoint::make_basepoint(const char *name, unsigned int sequence, const Params& in_params)
+static const EdwardsPoint derive_basepoint(const char *name, unsigned int sequence, const Params& in_params)
 {
     unsigned int name_sz = ::strlen(name);
     assert( name_sz <= 28 );
@@ -158,7 +171,64 @@ const EdwardsPoint EdwardsPoint::make_basepoint(const char *name, unsigned int s
 }
 
 
-const std::vector<EdwardsPoint> EdwardsPoint::make_basepoints(const char *name, unsigned int n, const Params& in_params)
+/**
+* The basepoint from BASEPOINT_TABLE, if it is for these parameters
+*/
+static bool table_basepoint(const char *name, unsigned int sequence, const Params& in_params, EdwardsPoint& result)
+{
+    static const Params default_params;
+    if( in_params.a != default_params.a || in_params.d != default_params.d ) {
+        return false;
+    }
+
+    for( size_t i = 0; i < BASEPOINT_TABLE_COUNT; i++ )
+    {
+        const auto& entry = BASEPOINT_TABLE[i];
+        if( entry.sequence == sequence && ::strcmp(entry.name, name) == 0 ) {
+            result = EdwardsPoint(FieldT(entry.x), FieldT(entry.y));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+const EdwardsPoint EdwardsPoint::make_basepoint(const char *name, unsigned int sequence, const Params& in_params)
+{
+    // Every gadget instance asks for the same points, they're derived once
+    // per process, keyed by the curve too in case other parameters are used
+    typedef std::tuple<std::string, unsigned int, std::string> KeyT;
+    static std::mutex cache_mutex;
+    static std::map<KeyT, EdwardsPoint> cache;
+
+    const auto a = in_params.a.as_bigint();
+    const auto d = in_params.d.as_bigint();
+    std::string curve(reinterpret_cast<const char*>(a.data), sizeof(a.data));
+    curve.append(reinterpret_cast<const char*>(d.data), sizeof(d.data));
+    const KeyT key(name, sequence, curve);
+
+    {
+        std::lock_guard<std::mutex> guard(cache_mutex);
+        const auto it = cache.find(key);
+        if( it != cache.end() ) {
+            return it->second;
+        }
+    }
+
+    // Derived without the lock, another thread may find the same point
+    EdwardsPoint result;
+    if( ! table_basepoint(name, sequence, in_params, result) ) {
+        result = derive_basepoint(name, sequence, in_params);
+    }
+
+    std::lock_guard<std::mutex> guard(cache_mutex);
+    cache.emplace(key, result);
+    return result;
+}
+
+
+std::vector<EdwardsPoint> EdwardsPoint::make_basepoints(const char *name, unsigned int n, const Params& in_params)
 {
     std::vector<EdwardsPoint> ret;
 
@@ -183,6 +253,175 @@ const VariablePointT EdwardsPoint::as_VariablePointT (ProtoboardT& pb, const std
 // --------------------------------------------------------------------
 
 
+EdwardsPointExt::EdwardsPointExt(
+    const FieldT& in_X,
+    const FieldT& in_Y,
+    const FieldT& in_Z,
+    const FieldT& in_T
+) :
+    X(in_X),
+    Y(in_Y),
+    Z(in_Z),
+    T(in_T)
+{ }
+
+
+const EdwardsPointExt EdwardsPointExt::infinity()
+{
+    return EdwardsPointExt(FieldT::zero(), FieldT::one(), FieldT::one(), FieldT::zero());
+}
+
+
+const EdwardsPointExt EdwardsPointExt::neg() const
+{
+    return EdwardsPointExt(-X, Y, Z, -T);
+}
+
+
+const EdwardsPointExt EdwardsPointExt::dbl(const Params& params) const
+{
+    const auto A = X.squared();
+    const auto B = Y.squared();
+    const auto C = Z.squared() + Z.squared();
+    const auto D = params.a * A;
+    const auto E = (X + Y).squared() - A - B;
+    const auto G = D + B;
+    const auto F = G - C;
+    const auto H = D - B;
+
+    return EdwardsPointExt(E * F, G * H, F * G, E * H);
+}
+
+
+const EdwardsPointExt EdwardsPointExt::add(const EdwardsPointExt& other, const Params& params) const
+{
+    const auto A = X * other.X;
+    const auto B = Y * other.Y;
+    const auto C = params.d * T * other.T;
+    const auto D = Z * other.Z;
+    const auto E = (X + Y) * (other.X + other.Y) - A - B;
+    const auto F = D - C;
+    const auto G = D + C;
+    const auto H = B - (params.a * A);
+
+    return EdwardsPointExt(E * F, G * H, F * G, E * H);
+}
+
+
+const EdwardsPoint EdwardsPointExt::as_affine() const
+{
+    const auto Z_inv = Z.inverse();
+    return EdwardsPoint(X * Z_inv, Y * Z_inv);
+}
+
+
+std::vector<EdwardsPoint> EdwardsPointExt::batch_as_affine(const std::vector<EdwardsPointExt>& points)
+{
+    std::vector<FieldT> Z_inv;
+    Z_inv.reserve(points.size());
+    for( const auto& point : points ) {
+        Z_inv.push_back(point.Z);
+    }
+    batch_inverse(Z_inv);
+
+    std::vector<EdwardsPoint> result;
+    result.reserve(points.size());
+    for( size_t i = 0; i < points.size(); i++ ) {
+        result.emplace_back(points[i].X * Z_inv[i], points[i].Y * Z_inv[i]);
+    }
+    return result;
+}
+
+
+std::vector<MontgomeryPoint> EdwardsPointExt::batch_as_montgomery(const std::vector<EdwardsPointExt>& points, const Params& params)
+{
+    // u = (1 + y) / (1 - y) = (Z + Y) / (Z - Y)
+    // v = u / x = ((Z + Y) * Z) / ((Z - Y) * X)
+    std::vector<FieldT> denominators;
+    denominators.reserve(points.size());
+    for( const auto& point : points )
+    {
+        assert( ! point.X.is_zero() && point.Y != point.Z );
+        denominators.push_back((point.Z - point.Y) * point.X);
+    }
+    batch_inverse(denominators);
+
+    std::vector<MontgomeryPoint> result;
+    result.reserve(points.size());
+    for( size_t i = 0; i < points.size(); i++ )
+    {
+        const auto numerator = (points[i].Z + points[i].Y) * denominators[i];
+        result.emplace_back(numerator * points[i].X, params.scale * numerator * points[i].Z);
+    }
+    return result;
+}
+
+
+bool EdwardsPointExt::is_infinity() const
+{
+    return X.is_zero() && Y == Z;
+}
+
+
+const EdwardsPointExt multi_scalar_mul(const Params& params, const std::vector<EdwardsPointExt>& points, const std::vector<libff::bit_vector>& scalars)
+{
+    assert( points.size() == scalars.size() );
+
+    size_t n_bits = 0;
+    for( const auto& scalar : scalars ) {
+        n_bits = std::max(n_bits, scalar.size());
+    }
+
+    // Roughly log2(n) - 2 bits per window, from 2 up to 16
+    size_t window_bits = 2;
+    while( window_bits < 16 && (size_t(1) << (window_bits + 3)) <= points.size() ) {
+        window_bits++;
+    }
+    const size_t n_windows = (n_bits + window_bits - 1) / window_bits;
+
+    // Each window, from the most significant, puts every point in the bucket
+    // of its digit, then the buckets are summed by their digit
+    EdwardsPointExt result = EdwardsPointExt::infinity();
+    std::vector<EdwardsPointExt> buckets;
+    for( size_t w = n_windows; w-- > 0; )
+    {
+        for( size_t i = 0; i < window_bits; i++ ) {
+            result = result.dbl(params);
+        }
+
+        buckets.assign((size_t(1) << window_bits) - 1, EdwardsPointExt::infinity());
+        for( size_t i = 0; i < points.size(); i++ )
+        {
+            size_t digit = 0;
+            for( size_t j = 0; j < window_bits; j++ )
+            {
+                const size_t bit = (w * window_bits) + j;
+                if( bit < scalars[i].size() && scalars[i][bit] ) {
+                    digit |= size_t(1) << j;
+                }
+            }
+
+            if( digit != 0 ) {
+                buckets[digit - 1] = buckets[digit - 1].add(points[i], params);
+            }
+        }
+
+        // sum(digit * bucket[digit]), as a running sum from the highest
+        EdwardsPointExt running = EdwardsPointExt::infinity();
+        for( size_t j = buckets.size(); j-- > 0; )
+        {
+            running = running.add(buckets[j], params);
+            result = result.add(running, params);
+        }
+    }
+
+    return result;
+}
+
+
+// --------------------------------------------------------------------
+
+
 MontgomeryPoint::MontgomeryPoint(const FieldT& in_x, const FieldT& in_y)
 : x(in_x), y(in_y)
 {}
@@ -197,6 +436,172 @@ const EdwardsPoint MontgomeryPoint::as_edwards(const Params& in_params) const
 }
 
 
+const MontgomeryPointProj MontgomeryPoint::as_projective() const
+{
+    return MontgomeryPointProj(x, y, FieldT::one());
+}
+
+
+// --------------------------------------------------------------------
+
+
+MontgomeryPointProj::MontgomeryPointProj(const FieldT& in_X, const FieldT& in_Y, const FieldT& in_Z)
+: X(in_X), Y(in_Y), Z(in_Z)
+{}
+
+
+const MontgomeryPointProj MontgomeryPointProj::infinity()
+{
+    return MontgomeryPointProj(FieldT::zero(), FieldT::one(), FieldT::zero());
+}
+
+
+const MontgomeryPointProj MontgomeryPointProj::neg() const
+{
+    return MontgomeryPointProj(X, -Y, Z);
+}
+
+
+bool MontgomeryPointProj::is_infinity() const
+{
+    return Z.is_zero();
+}
+
+
+const MontgomeryPointProj MontgomeryPointProj::dbl(const Params& params) const
+{
+    // Points of order 2 double to infinity
+    if( is_infinity() || Y.is_zero() ) {
+        return infinity();
+    }
+
+    // lambda = (3*x^2 + 2*A*x + 1) / (2*y) = u / v
+    // x3 = lambda^2 - A - 2*x = R / (v^2 * Z)
+    // y3 = lambda * (x - x3) - y
+    const auto u = (FieldT(3) * X.squared()) + (FieldT(2) * params.A * X * Z) + Z.squared();
+    const auto v = FieldT(2) * Y * Z;
+    const auto vv = v.squared();
+    const auto vvv = vv * v;
+    const auto R = (u.squared() * Z) - (vv * ((params.A * Z) + X + X));
+
+    return MontgomeryPointProj(v * R, (u * ((vv * X) - R)) - (vvv * Y), vvv * Z);
+}
+
+
+const MontgomeryPointProj MontgomeryPointProj::add(const MontgomeryPointProj& other, const Params& params) const
+{
+    if( is_infinity() ) {
+        return other;
+    }
+    if( other.is_infinity() ) {
+        return *this;
+    }
+
+    // lambda = (y2 - y1) / (x2 - x1) = u / v
+    // x3 = lambda^2 - A - x1 - x2 = R / (v^2 * Z1 * Z2)
+    // y3 = lambda * (x1 - x3) - y1
+    const auto X1Z2 = X * other.Z;
+    const auto X2Z1 = other.X * Z;
+    const auto Y1Z2 = Y * other.Z;
+    const auto u = (other.Y * Z) - Y1Z2;
+    const auto v = X2Z1 - X1Z2;
+
+    if( v.is_zero() ) {
+        // Either the same point, or its negation
+        return u.is_zero() ? dbl(params) : infinity();
+    }
+
+    const auto w = Z * other.Z;
+    const auto vv = v.squared();
+    const auto vvv = vv * v;
+    const auto R = (u.squared() * w) - (vv * ((params.A * w) + X1Z2 + X2Z1));
+
+    return MontgomeryPointProj(v * R, (u * ((vv * X1Z2) - R)) - (vvv * Y1Z2), vvv * w);
+}
+
+
+const MontgomeryPoint MontgomeryPointProj::as_affine() const
+{
+    assert( ! is_infinity() );
+    const auto Z_inv = Z.inverse();
+    return MontgomeryPoint(X * Z_inv, Y * Z_inv);
+}
+
+
+std::vector<MontgomeryPoint> MontgomeryPointProj::batch_as_affine(const std::vector<MontgomeryPointProj>& points)
+{
+    std::vector<FieldT> Z_inv;
+    Z_inv.reserve(points.size());
+    for( const auto& point : points ) {
+        assert( ! point.is_infinity() );
+        Z_inv.push_back(point.Z);
+    }
+    batch_inverse(Z_inv);
+
+    std::vector<MontgomeryPoint> result;
+    result.reserve(points.size());
+    for( size_t i = 0; i < points.size(); i++ ) {
+        result.emplace_back(points[i].X * Z_inv[i], points[i].Y * Z_inv[i]);
+    }
+    return result;
+}
+
+
+const MontgomeryPointProj montgomery_ladder(const Params& params, const MontgomeryPoint& point, const libff::bit_vector& scalar)
+{
+    assert( ! point.y.is_zero() );
+    const auto& x = point.x;
+    const auto a24 = (params.A + FieldT(2)) * FieldT(4).inverse();
+
+    // R0 = k*P and R1 = (k+1)*P, as (X : Z), for the bits seen so far
+    FieldT X0 = FieldT::one(), Z0 = FieldT::zero();
+    FieldT X1 = x, Z1 = FieldT::one();
+    for( size_t i = scalar.size(); i-- > 0; )
+    {
+        // The sum of R0 and R1, whose difference is always P
+        const auto U = (X0 - Z0) * (X1 + Z1);
+        const auto V = (X0 + Z0) * (X1 - Z1);
+        const auto X_add = (U + V).squared();
+        const auto Z_add = x * (U - V).squared();
+
+        // Double whichever the bit doesn't replace with the sum
+        auto& Xd = scalar[i] ? X1 : X0;
+        auto& Zd = scalar[i] ? Z1 : Z0;
+        const auto sum = (Xd + Zd).squared();
+        const auto diff = (Xd - Zd).squared();
+        const auto XZ4 = sum - diff;
+        Xd = sum * diff;
+        Zd = XZ4 * (diff + (a24 * XZ4));
+
+        if( scalar[i] ) {
+            X0 = X_add;
+            Z0 = Z_add;
+        }
+        else {
+            X1 = X_add;
+            Z1 = Z_add;
+        }
+    }
+
+    if( Z0.is_zero() ) {
+        return MontgomeryPointProj::infinity();
+    }
+    if( Z1.is_zero() ) {
+        // k*P = -P
+        return point.as_projective().neg();
+    }
+
+    // y(k*P) = ((x*x0 + 1) * (x0 + x + 2*A) - 2*A - (x0 - x)^2 * x1) / (2*y)
+    // with x0 = X0/Z0 and x1 = X1/Z1, over the common denominator
+    const auto A2Z0 = FieldT(2) * params.A * Z0;
+    const auto xZ0 = x * Z0;
+    const auto Y = (Z1 * ((((X0 + xZ0 + A2Z0) * ((x * X0) + Z0))) - (A2Z0 * Z0))) - ((X0 - xZ0).squared() * X1);
+    const auto D = FieldT(2) * point.y * Z0 * Z1;
+
+    return MontgomeryPointProj(D * X0, Y, D * Z0);
+}
+
+
 // namespace jubjub
 }
 
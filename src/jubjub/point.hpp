@@ -35,6 +35,7 @@ public:
 
 
 class MontgomeryPoint;
+class EdwardsPointExt;
 
 
 /**
@@ -64,6 +65,8 @@ public:
 
     const MontgomeryPoint as_montgomery(const Params& params) const;
 
+    const EdwardsPointExt as_extended() const;
+
     /**
     * Recover the X coordinate from the Y
     * This will increment Y until X can be recovered
@@ -74,13 +77,16 @@ public:
 
     /**
     * Determine the Y coordinate for a base point sequence
+    *
+    * Points are cached for the rest of the process, and come from
+    * BASEPOINT_TABLE for the namespaces it has, see basepoints.hpp
     */
     static const EdwardsPoint make_basepoint(const char *name, unsigned int sequence, const Params& in_params);
 
     /**
     * Return a sequence of base points for the given namespace
     */
-    static const std::vector<EdwardsPoint> make_basepoints(const char *name, unsigned int n, const Params& in_params);
+    static std::vector<EdwardsPoint> make_basepoints(const char *name, unsigned int n, const Params& in_params);
 
     /**
     * Convert to a VariablePoint - allocates two new variables for its X and Y coordinates
@@ -103,6 +109,66 @@ public:
 
 
 
+/**
+* Edwards point in extended twisted Edwards coordinates (X : Y : Z : T)
+*
+*   x = X/Z, y = Y/Z, x*y = T/Z
+*
+* Addition and doubling need no inversions, so chains of them are computed
+* in this form and only the points which are needed are converted back to
+* affine, together, with one inversion, see `batch_as_affine`.
+*
+* The formulas are add-2008-hwcd and dbl-2008-hwcd from:
+*   "Twisted Edwards Curves Revisited", Hisil, Wong, Carter, Dawson (2008)
+*   https://eprint.iacr.org/2008/522
+*/
+class EdwardsPointExt
+{
+public:
+    FieldT X;
+    FieldT Y;
+    FieldT Z;
+    FieldT T;
+
+    EdwardsPointExt() {}
+
+    EdwardsPointExt(const FieldT& in_X, const FieldT& in_Y, const FieldT& in_Z, const FieldT& in_T);
+
+    static const EdwardsPointExt infinity();
+
+    const EdwardsPointExt neg() const;
+
+    const EdwardsPointExt dbl(const Params& params) const;
+
+    const EdwardsPointExt add(const EdwardsPointExt& other, const Params& params) const;
+
+    const EdwardsPoint as_affine() const;
+
+    static std::vector<EdwardsPoint> batch_as_affine(const std::vector<EdwardsPointExt>& points);
+
+    /**
+    * Montgomery form of each point, with one inversion for all of them,
+    * neither coordinate may be zero, like EdwardsPoint::as_montgomery
+    */
+    static std::vector<MontgomeryPoint> batch_as_montgomery(const std::vector<EdwardsPointExt>& points, const Params& params);
+
+    bool is_infinity() const;
+};
+
+
+/**
+* Sum of points[i] * scalars[i], the scalars are bits, little endian
+*
+* Uses Pippenger's bucket method, the windows are wider for more points,
+* costing about n_bits/w * (n + 2^w) additions instead of the n_bits * n of
+* multiplying each point on its own.
+*/
+const EdwardsPointExt multi_scalar_mul(const Params& params, const std::vector<EdwardsPointExt>& points, const std::vector<libff::bit_vector>& scalars);
+
+
+class MontgomeryPointProj;
+
+
 class MontgomeryPoint
 {
 public:
@@ -112,9 +178,64 @@ public:
     MontgomeryPoint(const FieldT& in_x, const FieldT& in_y);
 
     const EdwardsPoint as_edwards(const Params& in_params) const;
+
+    const MontgomeryPointProj as_projective() const;
+};
+
+
+/**
+* Montgomery point in projective coordinates (X : Y : Z), on the curve
+*
+*   y^2 = x^3 + A*x^2 + x, where x = X/Z, y = Y/Z
+*
+* which is the form used by MontgomeryAdder. Like EdwardsPointExt, chains of
+* additions need no inversions, only the points which are needed are made
+* affine, together, with `batch_as_affine`. Infinity is (0 : 1 : 0).
+*/
+class MontgomeryPointProj
+{
+public:
+    FieldT X;
+    FieldT Y;
+    FieldT Z;
+
+    MontgomeryPointProj() {}
+
+    MontgomeryPointProj(const FieldT& in_X, const FieldT& in_Y, const FieldT& in_Z);
+
+    static const MontgomeryPointProj infinity();
+
+    const MontgomeryPointProj neg() const;
+
+    const MontgomeryPointProj dbl(const Params& params) const;
+
+    const MontgomeryPointProj add(const MontgomeryPointProj& other, const Params& params) const;
+
+    const MontgomeryPoint as_affine() const;
+
+    /** One inversion for all of the points, none of which may be infinity */
+    static std::vector<MontgomeryPoint> batch_as_affine(const std::vector<MontgomeryPointProj>& points);
+
+    bool is_infinity() const;
 };
 
 
+/**
+* point * scalar, the scalar is bits, little endian
+*
+* A Montgomery ladder on the x coordinate alone, (X : Z), with y recovered
+* at the end from the last pair of the ladder, per Okeya and Sakurai:
+*
+*   "Efficient Elliptic Curve Cryptosystems from a Scalar Multiplication
+*    Algorithm with Recovery of the y-Coordinate on a Montgomery-Form
+*    Elliptic Curve", CHES 2001
+*
+* Every bit costs one differential addition and one doubling, whatever its
+* value. The point mustn't have order 2, i.e. y != 0.
+*/
+const MontgomeryPointProj montgomery_ladder(const Params& params, const MontgomeryPoint& point, const libff::bit_vector& scalar);
+
+
 // namespace jubjub
 }
 
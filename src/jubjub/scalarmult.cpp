@@ -2,6 +2,9 @@
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
 #include "jubjub/scalarmult.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
 
 
 namespace ethsnarks {
@@ -43,32 +46,16 @@ ScalarMult::ScalarMult(
 				FMT(this->annotation_prefix, ".doublers[%u]", i));
 		}
 
+		// The accumulator starts as the first conditional point
 		const auto& cur_dbl = doublers.back();
-		conditionals.emplace_back(
-			in_pb,
+		const VariableT acc_x = (i == 1 ? conditionals[0].result_x() : adders.back().result_x());
+		const VariableT acc_y = (i == 1 ? conditionals[0].result_y() : adders.back().result_y());
+		adders.emplace_back(
+			in_pb, in_params,
+			acc_x, acc_y,
 			cur_dbl.result_x(), cur_dbl.result_y(),
 			in_scalar[i],
-			FMT(annotation_prefix, ".conditionals[%u]", i));
-
-		if( i == 1 )
-		{			
-			const auto& cond_a = conditionals[i-1];
-			const auto& cond_b = conditionals[i];
-			adders.emplace_back(
-				in_pb, in_params,
-				cond_a.result_x(), cond_a.result_y(),
-				cond_b.result_x(), cond_b.result_y(),
-				FMT(this->annotation_prefix, ".adders[%u]", i));
-		}
-		else {
-			const auto& cond = conditionals[i];
-			const auto& adder = adders.back();
-			adders.emplace_back(
-				in_pb, in_params,
-				adder.result_x(), adder.result_y(),
-				cond.result_x(), cond.result_y(),
-				FMT(this->annotation_prefix, ".adders[%u]", i));
-		}
+			FMT(this->annotation_prefix, ".adders[%u]", i));
 	}
 }
 
@@ -111,6 +98,276 @@ void ScalarMult::generate_r1cs_witness()
 }
 
 
+// --------------------------------------------------------------------
+
+
+SignedWindowLookup::SignedWindowLookup(
+	ProtoboardT& in_pb,
+	const VariableT in_b0,
+	const VariableT in_b1,
+	const VariableT in_same_1,
+	const VariableT in_negated_1,
+	const VariableT in_same_3,
+	const VariableT in_negated_3,
+	const std::string& annotation_prefix
+) :
+	GadgetT(in_pb, annotation_prefix),
+	m_b0(in_b0),
+	m_b1(in_b1),
+	m_magnitude(make_variable(in_pb, FMT(annotation_prefix, ".magnitude"))),
+	m_same(make_variable(in_pb, FMT(annotation_prefix, ".same"))),
+	m_unsigned(make_variable(in_pb, FMT(annotation_prefix, ".unsigned"))),
+	m_signed(make_variable(in_pb, FMT(annotation_prefix, ".signed"))),
+	m_same_1(in_same_1),
+	m_negated_1(in_negated_1),
+	m_same_3(in_same_3),
+	m_negated_3(in_negated_3)
+{ }
+
+
+void SignedWindowLookup::generate_r1cs_constraints()
+{
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_b0 * FieldT(2), m_b1, m_magnitude - 1 + m_b0 + m_b1),
+		FMT(this->annotation_prefix, ".2*b0*b1 == magnitude - 1 + b0 + b1"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_magnitude, m_same_3 - m_same_1, m_same - m_same_1),
+		FMT(this->annotation_prefix, ".magnitude * (same_3 - same_1) == same - same_1"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_magnitude, m_negated_3 - m_negated_1, m_unsigned - m_negated_1),
+		FMT(this->annotation_prefix, ".magnitude * (negated_3 - negated_1) == unsigned - negated_1"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_unsigned, (m_b1 * FieldT(2)) - 1, m_signed),
+		FMT(this->annotation_prefix, ".unsigned * (2*b1 - 1) == signed"));
+}
+
+
+void SignedWindowLookup::generate_r1cs_witness()
+{
+	const bool b0 = this->pb.val(m_b0) == FieldT::one();
+	const bool b1 = this->pb.val(m_b1) == FieldT::one();
+	const bool magnitude = b0 == b1;
+
+	this->pb.val(m_magnitude) = magnitude ? FieldT::one() : FieldT::zero();
+	this->pb.val(m_same) = this->pb.val(magnitude ? m_same_3 : m_same_1);
+	this->pb.val(m_unsigned) = this->pb.val(magnitude ? m_negated_3 : m_negated_1);
+	this->pb.val(m_signed) = b1 ? this->pb.val(m_unsigned) : -this->pb.val(m_unsigned);
+}
+
+
+// --------------------------------------------------------------------
+
+
+ScalarMultWindowed::ScalarMultWindowed(
+	ProtoboardT& in_pb,
+	const Params& in_params,
+	const VariableT in_X1,
+	const VariableT in_Y1,
+	const VariableArrayT& in_scalar,
+	const std::string& annotation_prefix
+) :
+	GadgetT(in_pb, annotation_prefix),
+	m_X(in_X1),
+	m_Y(in_Y1),
+	m_scalar(in_scalar),
+	m_point(in_pb, in_params, in_X1, in_Y1, FMT(this->annotation_prefix, ".point")),
+	m_point_dbl(in_pb, in_params, m_point.result_x(), m_point.result_y(), FMT(this->annotation_prefix, ".point_dbl")),
+	m_point_triple(in_pb, in_params,
+		m_point_dbl.result_x(), m_point_dbl.result_y(),
+		m_point.result_x(), m_point.result_y(),
+		FMT(this->annotation_prefix, ".point_triple")),
+	m_parity_x(make_variable(in_pb, FMT(this->annotation_prefix, ".parity_x"))),
+	m_parity_y(make_variable(in_pb, FMT(this->annotation_prefix, ".parity_y")))
+{
+	assert( in_scalar.size() > 0 );
+
+	const size_t n_windows = (in_scalar.size() + 1) / 2;
+	const size_t max_montgomery = montgomery_windows_max(in_params);
+
+	const VariableT u1 = m_point.result_x();
+	const VariableT v1 = m_point.result_y();
+	const VariableT u3 = m_point_triple.result_x();
+	const VariableT v3 = m_point_triple.result_y();
+
+	// The top digit is 1 + 2*s[2n - 1], which is past the end for an odd number of bits
+	VariableT acc_x = u1;
+	VariableT acc_y = v1;
+	if( (in_scalar.size() % 2) == 0 )
+	{
+		m_top.emplace_back(in_pb, in_scalar.back(), libsnark::ONE, u1, v1, u3, v3, FMT(this->annotation_prefix, ".top"));
+		acc_x = m_top.back().m_same;
+		acc_y = m_top.back().m_signed;
+	}
+
+	m_doublers.reserve(2 * std::min(n_windows, max_montgomery));
+	m_lookups.reserve(std::min(n_windows, max_montgomery));
+	m_adders.reserve(std::min(n_windows, max_montgomery));
+
+	// After j windows below the top, the accumulator is a*P with |a| < 4^(j+1)
+	for( size_t j = 1; j < n_windows; j++ )
+	{
+		const size_t window = n_windows - 1 - j;
+		const VariableT& b0 = in_scalar[(2 * window) + 1];
+		const VariableT& b1 = in_scalar[(2 * window) + 2];
+
+		if( (j + 1) <= max_montgomery )
+		{
+			m_doublers.emplace_back(in_pb, in_params, acc_x, acc_y, pb_annotation(in_pb, this->annotation_prefix, ".doublers[%zu]", 2 * window));
+			acc_x = m_doublers.back().result_x();
+			acc_y = m_doublers.back().result_y();
+			m_doublers.emplace_back(in_pb, in_params, acc_x, acc_y, pb_annotation(in_pb, this->annotation_prefix, ".doublers[%zu]", (2 * window) + 1));
+			m_lookups.emplace_back(in_pb, b0, b1, u1, v1, u3, v3, pb_annotation(in_pb, this->annotation_prefix, ".lookups[%zu]", window));
+			m_adders.emplace_back(in_pb, in_params,
+				m_doublers.back().result_x(), m_doublers.back().result_y(),
+				m_lookups.back().m_same, m_lookups.back().m_signed,
+				pb_annotation(in_pb, this->annotation_prefix, ".adders[%zu]", window));
+			acc_x = m_adders.back().result_x();
+			acc_y = m_adders.back().result_y();
+			continue;
+		}
+
+		// Edwards form from here on, for the accumulator and 3 times the point
+		if( m_converters.empty() )
+		{
+			m_converters.emplace_back(in_pb, in_params, acc_x, acc_y, FMT(this->annotation_prefix, ".accumulator_edwards"));
+			m_converters.emplace_back(in_pb, in_params, u3, v3, FMT(this->annotation_prefix, ".triple_edwards"));
+			acc_x = m_converters[0].result_x();
+			acc_y = m_converters[0].result_y();
+		}
+
+		const VariableT triple_x = m_converters[1].result_x();
+		const VariableT triple_y = m_converters[1].result_y();
+		m_edwards_doublers.emplace_back(in_pb, in_params, acc_x, acc_y, pb_annotation(in_pb, this->annotation_prefix, ".edwards_doublers[%zu]", 2 * window));
+		acc_x = m_edwards_doublers.back().result_x();
+		acc_y = m_edwards_doublers.back().result_y();
+		m_edwards_doublers.emplace_back(in_pb, in_params, acc_x, acc_y, pb_annotation(in_pb, this->annotation_prefix, ".edwards_doublers[%zu]", (2 * window) + 1));
+		m_edwards_lookups.emplace_back(in_pb, b0, b1, in_Y1, in_X1, triple_y, triple_x, pb_annotation(in_pb, this->annotation_prefix, ".edwards_lookups[%zu]", window));
+		m_edwards_adders.emplace_back(in_pb, in_params,
+			m_edwards_doublers.back().result_x(), m_edwards_doublers.back().result_y(),
+			m_edwards_lookups.back().m_signed, m_edwards_lookups.back().m_same,
+			pb_annotation(in_pb, this->annotation_prefix, ".edwards_adders[%zu]", window));
+		acc_x = m_edwards_adders.back().result_x();
+		acc_y = m_edwards_adders.back().result_y();
+	}
+
+	if( m_converters.empty() )
+	{
+		m_converters.emplace_back(in_pb, in_params, acc_x, acc_y, FMT(this->annotation_prefix, ".accumulator_edwards"));
+		acc_x = m_converters[0].result_x();
+		acc_y = m_converters[0].result_y();
+	}
+
+	m_edwards_adders.emplace_back(in_pb, in_params,
+		acc_x, acc_y, m_parity_x, m_parity_y,
+		FMT(this->annotation_prefix, ".parity_adder"));
+}
+
+
+size_t ScalarMultWindowed::montgomery_windows_max( const Params& in_params )
+{
+	// 4^k <= L when 2*k is less than the bit length of L
+	return (in_params.order.as_bigint().num_bits() - 1) / 2;
+}
+
+
+const VariableT& ScalarMultWindowed::result_x() const
+{
+	return m_edwards_adders.back().result_x();
+}
+
+
+const VariableT& ScalarMultWindowed::result_y() const
+{
+	return m_edwards_adders.back().result_y();
+}
+
+
+void ScalarMultWindowed::generate_r1cs_constraints()
+{
+	m_point.generate_r1cs_constraints();
+	m_point_dbl.generate_r1cs_constraints();
+	m_point_triple.generate_r1cs_constraints();
+
+	for( auto& gadget : m_top )
+		gadget.generate_r1cs_constraints();
+
+	for( auto& gadget : m_doublers )
+		gadget.generate_r1cs_constraints();
+
+	for( auto& gadget : m_lookups )
+		gadget.generate_r1cs_constraints();
+
+	for( auto& gadget : m_adders )
+		gadget.generate_r1cs_constraints();
+
+	for( auto& gadget : m_converters )
+		gadget.generate_r1cs_constraints();
+
+	for( auto& gadget : m_edwards_doublers )
+		gadget.generate_r1cs_constraints();
+
+	for( auto& gadget : m_edwards_lookups )
+		gadget.generate_r1cs_constraints();
+
+	// (-x, y) when the lowest bit isn't set, otherwise (0, 1)
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_X, m_scalar[0] - 1, m_parity_x),
+		FMT(this->annotation_prefix, ".x * (s0 - 1) == parity_x"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_Y - 1, FieldT::one() - m_scalar[0], m_parity_y - 1),
+		FMT(this->annotation_prefix, ".(y - 1) * (1 - s0) == parity_y - 1"));
+
+	for( auto& gadget : m_edwards_adders )
+		gadget.generate_r1cs_constraints();
+}
+
+
+void ScalarMultWindowed::generate_r1cs_witness()
+{
+	m_point.generate_r1cs_witness();
+	m_point_dbl.generate_r1cs_witness();
+	m_point_triple.generate_r1cs_witness();
+
+	for( auto& gadget : m_top )
+		gadget.generate_r1cs_witness();
+
+	// Each window depends on the one before it
+	for( size_t i = 0; i < m_adders.size(); i++ )
+	{
+		m_doublers[2 * i].generate_r1cs_witness();
+		m_doublers[(2 * i) + 1].generate_r1cs_witness();
+		m_lookups[i].generate_r1cs_witness();
+		m_adders[i].generate_r1cs_witness();
+	}
+
+	for( auto& gadget : m_converters )
+		gadget.generate_r1cs_witness();
+
+	for( size_t i = 0; i < m_edwards_lookups.size(); i++ )
+	{
+		m_edwards_doublers[2 * i].generate_r1cs_witness();
+		m_edwards_doublers[(2 * i) + 1].generate_r1cs_witness();
+		m_edwards_lookups[i].generate_r1cs_witness();
+		m_edwards_adders[i].generate_r1cs_witness();
+	}
+
+	if( this->pb.val(m_scalar[0]).is_zero() ) {
+		this->pb.val(m_parity_x) = -this->pb.val(m_X);
+		this->pb.val(m_parity_y) = this->pb.val(m_Y);
+	}
+	else {
+		this->pb.val(m_parity_x) = FieldT::zero();
+		this->pb.val(m_parity_y) = FieldT::one();
+	}
+
+	m_edwards_adders.back().generate_r1cs_witness();
+}
+
+
 // namespace jubjub
 }
 
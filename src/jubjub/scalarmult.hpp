@@ -7,6 +7,7 @@
 #include "jubjub/adder.hpp"
 #include "jubjub/doubler.hpp"
 #include "jubjub/conditional_point.hpp"
+#include "jubjub/montgomery.hpp"
 
 
 namespace ethsnarks {
@@ -30,32 +31,31 @@ namespace jubjub {
 *  +-------+    +-----+      +-----+      +-----+
 *     |            |            |            |
 *     v            v            v            v
+*  +------+     +-------+    +-------+    +-------+
+*  | COND |---->| CADD  |--->| CADD  |--->| CADD  |---> Result
+*  +------+     +-------+    +-------+    +-------+
+*     ^            ^            ^            ^
+*     |            |            |            |
+*  +------+     +------+     +------+     +------+
+*  | Bit0 |     | Bit1 |     | Bit2 |     | Bit3 |
 *  +------+     +------+     +------+     +------+
-*  | COND |--,  | COND |--,  | COND |--,  | COND |--,
-*  +------+  |  +------+  |  +------+  |  +------+  |
-*     ^      |     ^      |     ^      |     ^      |
-*     |      |     |      |     |      |     |      |
-*  +------+  |  +------+  |  +------+  |  +------+  |
-*  | Bit0 |  |  | Bit1 |  |  | Bit2 |  |  | Bit3 |  |
-*  +------+  |  +------+  |  +------+  |  +------+  |
-*            |            v            v            v
-*            |        +-------+    +-------+    +-------+     
-*            `------->| ADDER |--->| ADDER |--->| ADDER |---> Result
-*                     +-------+    +-------+    +-------+
 *
 * -------------------------------------------------------
 *
 *  i=0		P*bit
-*  i=1		(P*2*bit) + (P*bit)
-*  i=2		(P*4*bit) + ((P*2*bit) + (P*bit))
+*  i=1		(P*bit) + (P*2*bit)
+*  i=2		((P*bit) + (P*2*bit)) + (P*4*bit)
 *  etc..
+*
+* Each bit after the first is a PointDoubler and a ConditionalPointAdder,
+* 14 constraints per bit.
 */
 class ScalarMult : public GadgetT 
 {
 public:
 	std::vector<PointDoubler> doublers;
-	std::vector<ConditionalPoint> conditionals;
-	std::vector<PointAdder> adders;
+	std::vector<ConditionalPoint> conditionals;		// Only the first bit
+	std::vector<ConditionalPointAdder> adders;
 
 	ScalarMult(
 		ProtoboardT& in_pb,
@@ -76,6 +76,134 @@ public:
 };
 
 
+/**
+* Selects one of the signed digits -3, -1, 1 or 3 times a point, from two
+* bits b0 + 2*b1 as the digit 2*(b0 + 2*b1) - 3
+*
+* The point and 3 times it are given as a pair of coordinates, one which is
+* the same for the point and its negation and one which is negated, the V
+* coordinate in Montgomery form, or the X coordinate in Edwards form.
+*
+* The magnitude is 3 when b0 == b1, and the digit is negative when b1 isn't
+* set, which takes 4 constraints.
+*/
+class SignedWindowLookup : public GadgetT
+{
+public:
+	const VariableT m_b0;
+	const VariableT m_b1;
+
+	const VariableT m_magnitude;
+	const VariableT m_same;			// Coordinate of the magnitude, not negated
+	const VariableT m_unsigned;		// Coordinate of the magnitude, before negating
+	const VariableT m_signed;
+
+	SignedWindowLookup(
+		ProtoboardT& in_pb,
+		const VariableT in_b0,
+		const VariableT in_b1,
+		const VariableT in_same_1,
+		const VariableT in_negated_1,
+		const VariableT in_same_3,
+		const VariableT in_negated_3,
+		const std::string& annotation_prefix
+	);
+
+	void generate_r1cs_constraints();
+
+	void generate_r1cs_witness();
+
+protected:
+	const VariableT m_same_1;
+	const VariableT m_negated_1;
+	const VariableT m_same_3;
+	const VariableT m_negated_3;
+};
+
+
+/**
+* Windowed variable base scalar multiplication, with most of the additions
+* and doublings in Montgomery form
+*
+* The odd scalar s|1 is written with n signed digits d_i, each one of -3,
+* -1, 1 or 3, starting from the most significant:
+*
+*	s|1 = 2*W - (4^n - 1)		where W = (s >> 1) + 2^(2n - 1)
+*
+* so the digits come from the bits of the scalar shifted down by one, and
+* the top digit is always positive. Each window quadruples the accumulator
+* then adds the digit times the point, from a table of 1 and 3 times the
+* point made once, and when the scalar is even the point is subtracted at
+* the end.
+*
+* Montgomery addition and doubling are incomplete, but while the
+* accumulator is a*P with |4*a| < L, and a odd, neither the points added
+* together nor a point and its negation can be the same, and no point has
+* order 2. The windows after that, where the sum may be larger than L, are
+* in Edwards form, which is complete. So up to 250 bit scalars are entirely
+* in Montgomery form, and a 254 bit scalar has its last 2 windows in
+* Edwards form.
+*
+* The point mustn't be of small order, e.g. one checked by PointValidator,
+* as the argument needs L to divide its order.
+*
+* Each window in Montgomery form is two MontgomeryDoubler, a
+* SignedWindowLookup and a MontgomeryAdder, 15 constraints per 2 bits,
+* instead of the 14 per bit of ScalarMult.
+*/
+class ScalarMultWindowed : public GadgetT
+{
+public:
+	const VariableT m_X;
+	const VariableT m_Y;
+	const VariableArrayT m_scalar;
+
+	// Montgomery form of the point, twice and 3 times it
+	EdwardsToMontgomery m_point;
+	MontgomeryDoubler m_point_dbl;
+	MontgomeryAdder m_point_triple;
+
+	// The top digit, when it isn't always 1
+	std::vector<SignedWindowLookup> m_top;
+
+	// Two doublers, a lookup and an adder per window
+	std::vector<MontgomeryDoubler> m_doublers;
+	std::vector<SignedWindowLookup> m_lookups;
+	std::vector<MontgomeryAdder> m_adders;
+
+	// The accumulator, and 3 times the point if there are edwards windows
+	std::vector<MontgomeryToEdwards> m_converters;
+
+	std::vector<PointDoubler> m_edwards_doublers;
+	std::vector<SignedWindowLookup> m_edwards_lookups;
+	std::vector<PointAdder> m_edwards_adders;	// The last adds the parity point
+
+	// The negated point when the scalar is even, otherwise infinity
+	const VariableT m_parity_x;
+	const VariableT m_parity_y;
+
+	ScalarMultWindowed(
+		ProtoboardT& in_pb,
+		const Params &in_params,
+		const VariableT in_X1,
+		const VariableT in_Y1,
+		const VariableArrayT& in_scalar,
+		const std::string& annotation_prefix
+	);
+
+	/** Windows which are done in Montgomery form, including the top */
+	static size_t montgomery_windows_max(const Params& in_params);
+
+	const VariableT& result_x() const;
+
+	const VariableT& result_y() const;
+
+	void generate_r1cs_constraints();
+
+	void generate_r1cs_witness();
+};
+
+
 // namespace jubjub
 }
 
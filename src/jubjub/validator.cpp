@@ -16,8 +16,16 @@ PointValidator::PointValidator(
     const std::string& annotation_prefix
 ) :
 	GadgetT(in_pb, annotation_prefix),
-	m_notloworder(in_pb, in_params, in_X, in_Y, FMT(this->annotation_prefix, ".notloworder")),
-	m_isoncurve(in_pb, in_params, in_X, in_Y, FMT(this->annotation_prefix, ".isoncurve"))
+	m_params(in_params),
+	m_isoncurve(in_pb, in_params, in_X, in_Y, FMT(this->annotation_prefix, ".isoncurve")),
+	m_delta(make_variable(in_pb, FMT(this->annotation_prefix, ".delta"))),
+	m_X2(make_variable(in_pb, FMT(this->annotation_prefix, ".X2"))),
+	m_Y2(make_variable(in_pb, FMT(this->annotation_prefix, ".Y2"))),
+	m_xx2(make_variable(in_pb, FMT(this->annotation_prefix, ".xx2"))),
+	m_yy2(make_variable(in_pb, FMT(this->annotation_prefix, ".yy2"))),
+	m_xy2(make_variable(in_pb, FMT(this->annotation_prefix, ".xy2"))),
+	m_product(make_variable(in_pb, FMT(this->annotation_prefix, ".product"))),
+	m_inverse(make_variable(in_pb, FMT(this->annotation_prefix, ".inverse")))
 {
 
 }
@@ -26,14 +34,74 @@ PointValidator::PointValidator(
 void PointValidator::generate_r1cs_constraints()
 {
 	m_isoncurve.generate_r1cs_constraints();
-	m_notloworder.generate_r1cs_constraints();
+
+	const auto& X = m_isoncurve.m_X;
+	const auto& Y = m_isoncurve.m_Y;
+	const auto& xx = m_isoncurve.m_xx;
+	const auto& yy = m_isoncurve.m_yy;
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(2*X, Y, m_delta),
+		FMT(this->annotation_prefix, ".delta = 2*X * Y"));
+
+	// 1 + d*xx*yy == a*xx + yy, on the curve
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_params.a*xx + yy, m_X2, m_delta),
+		FMT(this->annotation_prefix, ".x2 * (a*xx + yy) == delta"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(2 - m_params.a*xx - yy, m_Y2, yy - m_params.a*xx),
+		FMT(this->annotation_prefix, ".y2 * (2 - a*xx - yy) == yy - a*xx"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_X2, m_X2, m_xx2),
+		FMT(this->annotation_prefix, ".xx2 = X2 * X2"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_Y2, m_Y2, m_yy2),
+		FMT(this->annotation_prefix, ".yy2 = Y2 * Y2"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_X2, m_Y2, m_xy2),
+		FMT(this->annotation_prefix, ".xy2 = X2 * Y2"));
+
+	// x4 is zero when x2*y2 is, y4 is zero when yy2 == a*xx2
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_xy2, m_yy2 - m_params.a*m_xx2, m_product),
+		FMT(this->annotation_prefix, ".product = xy2 * (yy2 - a*xx2)"));
+
+	this->pb.add_r1cs_constraint(
+		ConstraintT(m_product, m_inverse, 1),
+		FMT(this->annotation_prefix, ".product * inverse == 1"));
 }
 
 
 void PointValidator::generate_r1cs_witness()
 {
 	m_isoncurve.generate_r1cs_witness();
-	m_notloworder.generate_r1cs_witness();
+
+	const auto x = this->pb.val(m_isoncurve.m_X);
+	const auto y = this->pb.val(m_isoncurve.m_Y);
+	const auto xx = this->pb.val(m_isoncurve.m_xx);
+	const auto yy = this->pb.val(m_isoncurve.m_yy);
+
+	const auto x2_denominator = (m_params.a * xx) + yy;
+	const auto y2_denominator = FieldT(2) - x2_denominator;
+
+	// The denominators are only zero for points not on the curve
+	this->pb.val(m_delta) = FieldT(2) * x * y;
+	this->pb.val(m_X2) = x2_denominator.is_zero() ? FieldT::zero() : this->pb.val(m_delta) * x2_denominator.inverse();
+	this->pb.val(m_Y2) = y2_denominator.is_zero() ? FieldT::zero() : (yy - (m_params.a * xx)) * y2_denominator.inverse();
+
+	const auto x2 = this->pb.val(m_X2);
+	const auto y2 = this->pb.val(m_Y2);
+	this->pb.val(m_xx2) = x2 * x2;
+	this->pb.val(m_yy2) = y2 * y2;
+	this->pb.val(m_xy2) = x2 * y2;
+
+	const auto product = this->pb.val(m_xy2) * (this->pb.val(m_yy2) - (m_params.a * this->pb.val(m_xx2)));
+	this->pb.val(m_product) = product;
+	this->pb.val(m_inverse) = product.is_zero() ? FieldT::zero() : product.inverse();
 }
 
 
@@ -6,7 +6,6 @@
 
 #include "ethsnarks.hpp"
 #include "jubjub/isoncurve.hpp"
-#include "jubjub/notloworder.hpp"
 
 
 namespace ethsnarks {
@@ -18,22 +17,46 @@ namespace jubjub {
 * Validates a curve point, ensures that it is:
 *  - Is on the curve
 *  - Not of low-order
+*
+* This is IsOnCurve and NotLowOrder sharing their work. Once the point is
+* known to be on the curve, 1 + d*x^2*y^2 is a*x^2 + y^2, so doubling it
+* needs no more multiplications than those of IsOnCurve and 2*x*y:
+*
+*   x2 = 2*x*y / (a*x^2 + y^2)
+*   y2 = (y^2 - a*x^2) / (2 - a*x^2 - y^2)
+*
+* Then 8*P is infinity when the X of 8*P is zero, which is when x4*y4 is
+* zero, and so when x2*y2*(y2^2 - a*x2^2) is. So 2*P is the only doubling
+* done, and that product is shown to have an inverse.
+*
+* It is 11 constraints, IsOnCurve and NotLowOrder together are 24.
 */
 class PointValidator : public GadgetT {
 public:
-    NotLowOrder m_notloworder;
-    IsOnCurve m_isoncurve;
+	const Params& m_params;
+	IsOnCurve m_isoncurve;		// xx, yy and the curve equation
 
-    PointValidator(
-        ProtoboardT& in_pb,
-        const Params& in_params,
-        const VariableT in_X,
-        const VariableT in_Y,
-        const std::string& annotation_prefix);
+	// 2*P
+	const VariableT m_delta;	// 2*x*y
+	const VariableT m_X2;
+	const VariableT m_Y2;
 
-    void generate_r1cs_constraints();
+	const VariableT m_xx2;
+	const VariableT m_yy2;
+	const VariableT m_xy2;		// x2 * y2
+	const VariableT m_product;	// x2*y2 * (y2^2 - a*x2^2)
+	const VariableT m_inverse;
 
-    void generate_r1cs_witness();
+	PointValidator(
+		ProtoboardT& in_pb,
+		const Params& in_params,
+		const VariableT in_X,
+		const VariableT in_Y,
+		const std::string& annotation_prefix);
+
+	void generate_r1cs_constraints();
+
+	void generate_r1cs_witness();
 };
 
 
@@ -30,10 +30,19 @@ SOFTWARE.
 #include "utils.hpp"
 #include "gadgets/lookup_1bit.cpp"
 #include "gadgets/lookup_2bit.cpp"
-#include "gadgets/lookup_3bit.cpp"
 #include "libsnark/gadgetlib1/gadgets/basic_gadgets.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_trace.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 using std::istringstream;
@@ -42,8 +51,8 @@ using std::string;
 using std::cout;
 using std::endl;
 
-using libff::enter_block;
-using libff::leave_block;
+using libsnark::trace_enter_block;
+using libsnark::trace_leave_block;
 
 using libsnark::generate_boolean_r1cs_constraint;
 
@@ -80,42 +89,157 @@ static const FieldT readFieldElementFromHex(const char* inputStr){
 }
 
 
+/**
+* Inputs of the largest supported `table`, it has 2^TABLE_MAX_BITS values
+*/
+static const size_t TABLE_MAX_BITS = 8;
+
+
+/**
+* Constraints for a table of `n_bits` split at `k` low bits: one per product
+* of two or more low bits, then one per select between two sub-tables by a
+* high bit, or a single one when there are no high bits.
+*/
+static size_t tableCost( size_t n_bits, size_t k )
+{
+	return ((size_t(1) << k) - k - 1) + std::max((size_t(1) << (n_bits - k)) - 1, size_t(1));
+}
+
+
+/** The split with the fewest constraints, with at most 3 low bits */
+static size_t tableLowBits( size_t n_bits )
+{
+	size_t best = 1;
+	for( size_t k = 2; k <= std::min(n_bits, size_t(3)); k++ ) {
+		if( tableCost(n_bits, k) < tableCost(n_bits, best) ) {
+			best = k;
+		}
+	}
+	return best;
+}
+
+
+static bool isSplitTable( size_t n_bits )
+{
+	return n_bits > 2;
+}
+
+
+size_t CircuitReader::tableConstraints( size_t n_bits )
+{
+	return isSplitTable(n_bits) ? tableCost(n_bits, tableLowBits(n_bits)) : 1;
+}
+
+
 CircuitReader::CircuitReader(
 	ProtoboardT& in_pb,
 	const char* arithFilepath,
 	const char* inputsFilepath,
-	bool in_traceEnabled
+	bool in_traceEnabled,
+	bool in_witnessOnly,
+	CSProfile* in_profile
 ) :
 	GadgetT(in_pb, "CircuitReader"),
-	traceEnabled(in_traceEnabled)
+	traceEnabled(in_traceEnabled),
+	witnessOnly(in_witnessOnly),
+	profile(in_profile)
 {
 	parseCircuit(arithFilepath);
 
+	if( profile ) {
+		(*profile)["input"].variables += pb.num_variables();
+	}
+
+	allocateWires();
+
+	compileTape();
+
 	if( inputsFilepath ) {
-		parseInputs(inputsFilepath);
+		evalInputs(inputsFilepath);
+	}
 
-		if( traceEnabled ) {
-			enter_block("Evaluating instructions");
+	// In witness-only mode this still allocates the auxiliary variables
+	makeAllConstraints();
+}
+
+
+CircuitReader::CircuitReader( ProtoboardT& in_pb ) :
+	GadgetT(in_pb, "CircuitReader"),
+	traceEnabled(false),
+	witnessOnly(false),
+	profile(nullptr)
+{
+}
+
+
+void CircuitReader::evalInputs( const char *inputsFilepath )
+{
+	parseInputs(inputsFilepath);
+
+	if( traceEnabled ) {
+		trace_enter_block("Evaluating instructions");
+	}
+
+	std::vector<FieldT> inverses;
+	std::vector<FieldT> scratch;
+
+	for( size_t level = 0; level + 1 < evalLevels.size(); level++ )
+	{
+		const size_t begin = evalLevels[level];
+		const size_t end = evalLevels[level + 1];
+
+		if( profile ) {
+			for( size_t i = begin; i < end; i++ ) {
+				CSProfileTimer timer((*profile)[opcodeName(Opcode(tape[tapeOffsets[i]]))]);
+				evalTape(tapeOffsets[i]);
+			}
+		}
+		else {
+#ifdef MULTICORE
+			#pragma omp parallel for schedule(dynamic, 256) if(end - begin > 256)
+#endif
+			for( size_t i = begin; i < end; i++ ) {
+				evalTape(tapeOffsets[i]);
+			}
 		}
 
-		for( const auto& inst : instructions ) {
-			evalInstruction(inst);
+		// zerop needs the inverse of its input, they're all found at once
+		inverses.clear();
+		for( size_t i = begin; i < end; i++ ) {
+			const uint32_t *record = &tape[tapeOffsets[i]];
+			if( record[0] == ZEROP_OPCODE ) {
+				inverses.push_back(tapeValue(record[TAPE_HEADER]));
+			}
 		}
 
-		if( traceEnabled ) {
-			leave_block("Evaluating instructions");
+		if( inverses.size() ) {
+			std::unique_ptr<CSProfileTimer> timer(profile ? new CSProfileTimer((*profile)["zerop"]) : nullptr);
+			batch_inverse(inverses, scratch);
+
+			size_t j = 0;
+			for( size_t i = begin; i < end; i++ ) {
+				const uint32_t *record = &tape[tapeOffsets[i]];
+				if( record[0] == ZEROP_OPCODE ) {
+					// The inverse is the first output, see addNonzeroCheckConstraint
+					this->pb.val(VariableT(record[TAPE_HEADER + record[1]])) = inverses[j++];
+				}
+			}
 		}
 	}
 
-	makeAllConstraints();
+	if( traceEnabled ) {
+		trace_leave_block("Evaluating instructions");
+	}
 }
 
 /**
-* Parse file containing inputs, one line at a time, each line is two numbers:
+* Read a jsnark inputs file, one line at a time, each line is two numbers:
 *
 * 	<wire-id> <value>
+*
+* The value is hexadecimal. Exits if the file can't be read or is malformed.
 */
-void CircuitReader::parseInputs( const char *inputsFilepath )
+static void readTextInputs( const char *inputsFilepath, const std::function<void(Wire, const FieldT&)>& callback )
 {
 	ifstream inputfs(inputsFilepath, ifstream::in);
 	string line;
@@ -135,8 +259,7 @@ void CircuitReader::parseInputs( const char *inputsFilepath )
 			inputStr = new char[line.size()];
 			char separator[2];
 			if (3 == sscanf(line.c_str(), "%u%[= ]%s", &wireId, separator, inputStr)) {
-				const auto value = readFieldElementFromHex(inputStr);
-				varSet(wireId, value);
+				callback(wireId, readFieldElementFromHex(inputStr));
 			}
 			else {
 				std::cerr << "Error in Input" << endl;
@@ -149,78 +272,717 @@ void CircuitReader::parseInputs( const char *inputsFilepath )
 }
 
 
-void CircuitReader::evalInstruction( const CircuitInstruction &inst )
+/**
+* Parse the inputs, either a jsnark text file or the binary format written
+* by `convertInputs`, which is recognised by its magic
+*/
+void CircuitReader::parseInputs( const char *inputsFilepath )
+{
+	if( parseBinaryInputs(inputsFilepath) ) {
+		return;
+	}
+
+	readTextInputs(inputsFilepath, [this]( Wire wireId, const FieldT& value ) {
+		varSet(wireId, value);
+	});
+}
+
+
+/**
+* Marks a tape operand as the offset of a folded wire's terms in `foldTape`
+*/
+static const uint32_t TAPE_FOLDED = 1u << 31;
+
+/** Words before the operands of each tape record */
+static const size_t TAPE_HEADER = 4;
+
+
+uint32_t CircuitReader::internConstant( const FieldT& value, std::map<std::string, uint32_t>& interned )
 {
-	const auto opcode = inst.opcode;
-	const auto& outWires = inst.outputs;
-	const auto& constant = inst.constant;
+	const auto limbs = value.as_bigint();
+	const std::string key(reinterpret_cast<const char*>(limbs.data), sizeof(limbs.data));
 
-	std::vector<FieldT> inValues;
-	for( auto& wire : inst.inputs ) {
-		inValues.push_back( varValue(wire));
+	const auto it = interned.find(key);
+	if( it != interned.end() ) {
+		return it->second;
 	}
 
+	constants.push_back(value);
+	interned.emplace(key, constants.size() - 1);
+	return constants.size() - 1;
+}
+
+
+/**
+* Compile the instructions into the evaluation tape, in level order, with
+* every wire resolved to its variable index. Must be done after the wires
+* are allocated.
+*/
+void CircuitReader::compileTape( )
+{
+	std::vector<size_t> order;
+	levelInstructions(order);
+
+	std::map<std::string, uint32_t> interned;
+	std::vector<uint32_t> foldOffsets(foldedTerms.size(), 0);
+
+	const auto operand = [&]( Wire wire_id ) -> uint32_t {
+		if( ! isFolded(wire_id) ) {
+			return wireVariables[wire_id].index;
+		}
+
+		const size_t k = wireFolds[wire_id] - 1;
+		if( ! foldOffsets[k] ) {
+			// Offset 0 is never used, so it marks a fold which isn't compiled yet
+			if( foldTape.empty() ) {
+				foldTape.push_back(0);
+			}
+			foldOffsets[k] = foldTape.size();
+			foldTape.push_back(foldedTerms[k].size());
+			for( const auto& term : foldedTerms[k] ) {
+				foldTape.push_back(wireVariables[term.wire].index);
+				foldTape.push_back(internConstant(term.coeff, interned));
+			}
+		}
+		return TAPE_FOLDED | foldOffsets[k];
+	};
+
+	tape.clear();
+	tapeOffsets.resize(order.size());
+	for( size_t i = 0; i < order.size(); i++ )
+	{
+		const auto& inst = instructions[order[i]];
+		tapeOffsets[i] = tape.size();
+
+		uint32_t constant = 0;
+		if( inst.opcode == CONST_MUL_OPCODE || inst.opcode == CONST_MUL_NEG_OPCODE ) {
+			constant = internConstant(inst.constant, interned);
+		}
+		else if( inst.opcode == TABLE_OPCODE ) {
+			// Tables are contiguous, so they aren't interned
+			constant = constants.size();
+			constants.insert(constants.end(), inst.table.begin(), inst.table.end());
+		}
+
+		tape.push_back(inst.opcode);
+		tape.push_back(inst.inputs.size());
+		tape.push_back(inst.outputs.size());
+		tape.push_back(constant);
+		for( const auto& wire_id : inst.inputs ) {
+			tape.push_back(operand(wire_id));
+		}
+		for( const auto& wire_id : inst.outputs ) {
+			tape.push_back(wireVariables[wire_id].index);
+		}
+		if( inst.opcode == TABLE_OPCODE && isSplitTable(inst.inputs.size()) ) {
+			tape.push_back(inst.auxIndex);
+		}
+	}
+}
+
+
+FieldT CircuitReader::tapeValue( uint32_t operand )
+{
+	if( operand & TAPE_FOLDED ) {
+		const uint32_t *terms = &foldTape[operand & ~TAPE_FOLDED];
+		FieldT sum = FieldT::zero();
+		for( uint32_t i = 0; i < terms[0]; i++ ) {
+			sum += constants[terms[2 + (2 * i)]] * this->pb.val(VariableT(terms[1 + (2 * i)]));
+		}
+		return sum;
+	}
+
+	return this->pb.val(VariableT(operand));
+}
+
+
+/**
+* Evaluate the outputs of the tape record at `offset` from its inputs, so
+* records in the same level can be evaluated concurrently.
+*
+* The inverse wire of `zerop` is set by `evalInputs`, in one batch per level.
+*/
+void CircuitReader::evalTape( size_t offset )
+{
+	const uint32_t *record = &tape[offset];
+	const auto opcode = Opcode(record[0]);
+	const uint32_t n_in = record[1];
+	const uint32_t n_out = record[2];
+	const uint32_t *in = record + TAPE_HEADER;
+	const uint32_t *out = in + n_in;
+
+	const auto set = [&]( uint32_t var_index, const FieldT& value ) {
+		this->pb.val(VariableT(var_index)) = value;
+	};
+
 	if (opcode == ADD_OPCODE) {
 		FieldT sum;
-		for (auto &v : inValues) {
-			sum += v;
+		for (uint32_t i = 0; i < n_in; i++) {
+			sum += tapeValue(in[i]);
 		}
-		varSet(outWires[0], sum, "add, [input + [input ...]] = C");
+		set(out[0], sum);
 	}
 	else if (opcode == MUL_OPCODE) {
-		varSet(outWires[0], inValues[0] * inValues[1], "mul, A * B = C");
+		set(out[0], tapeValue(in[0]) * tapeValue(in[1]));
 	}
 	else if (opcode == XOR_OPCODE) {
-		varSet(outWires[0], (inValues[0] == inValues[1]) ? FieldT::zero() : FieldT::one(), "xor, A ^ B = C");
+		set(out[0], (tapeValue(in[0]) == tapeValue(in[1])) ? FieldT::zero() : FieldT::one());
 	}
 	else if (opcode == OR_OPCODE) {
-		varSet(outWires[0], (inValues[0] == FieldT::zero() && inValues[1] == FieldT::zero()) ?
-								FieldT::zero() : FieldT::one(), "or, A | B = C");
+		set(out[0], (tapeValue(in[0]) == FieldT::zero() && tapeValue(in[1]) == FieldT::zero()) ?
+								FieldT::zero() : FieldT::one());
 	}
 	else if (opcode == ZEROP_OPCODE) {
-		varSet(outWires[1], (inValues[0] == FieldT::zero()) ? FieldT::zero() : FieldT::one(), "zerop");
+		set(out[1], (tapeValue(in[0]) == FieldT::zero()) ? FieldT::zero() : FieldT::one());
 	}
 	else if (opcode == PACK_OPCODE) {
 		FieldT sum;
 		FieldT two = FieldT::one();
-		for (auto &v : inValues) {
-			sum += two * v;
+		for (uint32_t i = 0; i < n_in; i++) {
+			sum += two * tapeValue(in[i]);
 			two += two;
 		}
-		varSet(outWires[0], sum, "pack");
+		set(out[0], sum);
 	}
 	else if (opcode == SPLIT_OPCODE) {
-		int size = outWires.size();
-		FieldT& inVal = inValues[0];
-		for (int i = 0; i < size; i++) {
-			varSet(outWires[i], inVal.as_bigint().test_bit(i), FMT("split_", "%d", i));
+		// Convert out of Montgomery form once, rather than for every bit
+		const auto inBits = tapeValue(in[0]).as_bigint();
+		for (uint32_t i = 0; i < n_out; i++) {
+			set(out[i], inBits.test_bit(i) ? FieldT::one() : FieldT::zero());
 		}
 	}
-	else if (opcode == CONST_MUL_NEG_OPCODE ) {
-		varSet(outWires[0], constant * inValues[0], "const-mul-neg, A * -constant = C");
-	}
-	else if( opcode == CONST_MUL_OPCODE) {
-		varSet(outWires[0], constant * inValues[0], "const-mul, A * constant = C");
+	else if (opcode == CONST_MUL_NEG_OPCODE || opcode == CONST_MUL_OPCODE) {
+		// The constant of const-mul-neg is already negated
+		set(out[0], constants[record[3]] * tapeValue(in[0]));
 	}
 	else if( opcode == TABLE_OPCODE ) {
 		unsigned int idx = 0;
-		for( unsigned int i = 0; i < inValues.size(); i++ ) {
-			const auto& val = inValues[inValues.size() - 1 - i].as_ulong();
+		for( uint32_t i = 0; i < n_in; i++ ) {
+			const auto& val = tapeValue(in[n_in - 1 - i]).as_ulong();
 			assert( val == 0 || val == 1 );
 			idx += idx + val;
 		}
 
-		varSet(outWires[0], inst.table[idx], "table lookup");
+		const FieldT *table = &constants[record[3]];
+		set(out[0], table[idx]);
+
+		if( isSplitTable(n_in) ) {
+			// The same order as addSplitTableConstraints allocates them
+			uint32_t aux = out[n_out];
+			const size_t k = tableLowBits(n_in);
+			const size_t low = idx & ((1u << k) - 1);
+			const size_t high = idx >> k;
+
+			for( size_t mask = 3; mask < (1u << k); mask++ ) {
+				if( mask & (mask - 1) ) {
+					set(aux++, (low & mask) == mask ? FieldT::one() : FieldT::zero());
+				}
+			}
+
+			// Each select picks a sub-table, by one more of the high bits
+			for( size_t level = 0; level + 1 < n_in - k; level++ )
+			{
+				const size_t chosen = high & ((2u << level) - 1);
+				for( size_t j = 0; j < (size_t(1) << (n_in - k - level - 1)); j++ ) {
+					set(aux++, table[(((j << (level + 1)) | chosen) << k) | low]);
+				}
+			}
+		}
+	}
+}
+
+
+/**
+* Allocate the wires of every instruction in file order, before they're
+* evaluated or constrained, so variables get the same indices whichever is
+* done first and evaluation never allocates.
+*/
+void CircuitReader::allocateWires( )
+{
+	for( auto& inst : instructions )
+	{
+		if( inst.outputs.size() && isFolded(inst.outputs[0]) ) {
+			continue;
+		}
+
+		const size_t n_variables = pb.num_variables();
+
+		for( const auto& wire_id : inst.inputs ) {
+			if( isFolded(wire_id) ) {
+				for( const auto& term : foldedTerms[wireFolds[wire_id] - 1] ) {
+					varGet(term.wire, inst.name());
+				}
+			}
+			else {
+				varGet(wire_id, inst.name());
+			}
+		}
+
+		for( const auto& wire_id : inst.outputs ) {
+			varGet(wire_id, inst.name());
+		}
+
+		if( inst.opcode == TABLE_OPCODE && isSplitTable(inst.inputs.size()) ) {
+			// Every constraint but the last defines an intermediate value
+			inst.auxIndex = pb.num_variables() + 1;
+			for( size_t i = 1; i < tableConstraints(inst.inputs.size()); i++ ) {
+				VariableT aux;
+				aux.allocate(pb, "table aux");
+			}
+		}
+
+		if( profile ) {
+			(*profile)[inst.name()].variables += pb.num_variables() - n_variables;
+		}
+	}
+}
+
+
+/**
+* Group the instructions into levels, where every input of an instruction
+* is computed by an instruction in an earlier level, so the instructions
+* within a level are independent of each other.
+*/
+void CircuitReader::levelInstructions( std::vector<size_t>& order )
+{
+	static const uint32_t NO_LEVEL = ~uint32_t(0);
+
+	std::vector<uint32_t> wireLevel(wireVariables.size(), 0);
+	std::vector<uint32_t> instLevel(instructions.size(), NO_LEVEL);
+	uint32_t n_levels = 0;
+
+	for( size_t i = 0; i < instructions.size(); i++ )
+	{
+		const auto& inst = instructions[i];
+
+		uint32_t level = 0;
+		for( const auto& wire_id : inst.inputs ) {
+			level = std::max(level, wireLevel[wire_id]);
+		}
+
+		if( inst.outputs.size() && isFolded(inst.outputs[0]) ) {
+			// Not evaluated, but its value depends on its inputs
+			wireLevel[inst.outputs[0]] = level;
+			continue;
+		}
+
+		if( inst.opcode == ASSERT_OPCODE ) {
+			// Nothing to evaluate
+			continue;
+		}
+
+		for( const auto& wire_id : inst.outputs ) {
+			wireLevel[wire_id] = level + 1;
+		}
+		instLevel[i] = level;
+		n_levels = std::max(n_levels, level + 1);
+	}
+
+	// Counting sort by level, keeping file order within each level
+	evalLevels.assign(n_levels + 1, 0);
+	for( const auto& level : instLevel ) {
+		if( level != NO_LEVEL ) {
+			evalLevels[level + 1]++;
+		}
+	}
+	for( size_t i = 0; i < n_levels; i++ ) {
+		evalLevels[i + 1] += evalLevels[i];
+	}
+
+	std::vector<size_t> next(evalLevels.begin(), evalLevels.end() - 1);
+	order.resize(evalLevels.back());
+	for( size_t i = 0; i < instructions.size(); i++ ) {
+		if( instLevel[i] != NO_LEVEL ) {
+			order[next[instLevel[i]]++] = i;
+		}
+	}
+}
+
+
+/**
+* The binary circuit format, all integers are little-endian:
+*
+*	header: magic[8] version:u32 field_bytes:u32
+*	        wires:u64 declarations:u64 instructions:u64
+*	        instruction_wires:u64 table_values:u64
+*	declaration: kind:u32 wire:u32
+*	instruction: opcode:u32 n_in:u32 n_out:u32 wire:u32[n_in + n_out]
+*	             [constant] [table_value[1 << n_in]]
+*
+* Field elements are `field_bytes` wide, the constant is only present for
+* `const-mul` and `const-mul-neg` and is already negated for the latter.
+* Every wire is less than `wires`, files which aren't are rejected.
+*/
+static const char ARITH_BIN_MAGIC[8] = {'E', 'S', 'A', 'R', 'I', 'T', 'H', 'B'};
+static const uint32_t ARITH_BIN_VERSION = 1;
+static const size_t ARITH_BIN_HEADER_SIZE = 56;
+static const size_t ARITH_BIN_FIELD_BYTES = FieldT::num_limbs * sizeof(mp_limb_t);
+
+enum DeclarationKind {
+	DECLARE_INPUT,
+	DECLARE_NIZKINPUT,
+	DECLARE_OUTPUT
+};
+
+
+static uint32_t read_u32( const uint8_t *p )
+{
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+
+static uint64_t read_u64( const uint8_t *p )
+{
+	return uint64_t(read_u32(p)) | (uint64_t(read_u32(p + 4)) << 32);
+}
+
+
+static FieldT read_field( const uint8_t *p )
+{
+	libff::bigint<FieldT::num_limbs> value;
+	for( size_t i = 0; i < FieldT::num_limbs; i++ ) {
+		mp_limb_t limb = 0;
+		for( size_t j = 0; j < sizeof(mp_limb_t); j++ ) {
+			limb |= mp_limb_t(p[(i * sizeof(mp_limb_t)) + j]) << (8 * j);
+		}
+		value.data[i] = limb;
+	}
+	return FieldT(value);
+}
+
+
+static void put_u32( std::string& out, uint32_t value )
+{
+	for( size_t i = 0; i < 4; i++ ) {
+		out.push_back(char((value >> (8 * i)) & 0xFF));
 	}
 }
 
 
+static void put_u64( std::string& out, uint64_t value )
+{
+	put_u32(out, uint32_t(value));
+	put_u32(out, uint32_t(value >> 32));
+}
+
+
+static void put_field( std::string& out, const FieldT& value )
+{
+	const auto limbs = value.as_bigint();
+	for( size_t i = 0; i < FieldT::num_limbs; i++ ) {
+		for( size_t j = 0; j < sizeof(mp_limb_t); j++ ) {
+			out.push_back(char((limbs.data[i] >> (8 * j)) & 0xFF));
+		}
+	}
+}
+
+
+/**
+* The same number of wires that `makeConstraints` expects for each opcode
+*/
+static bool validArity( uint32_t opcode, uint32_t n_in, uint32_t n_out )
+{
+	switch( opcode ) {
+		case ADD_OPCODE: return n_in > 1 && n_out == 1;
+		case MUL_OPCODE:
+		case XOR_OPCODE:
+		case OR_OPCODE:
+		case ASSERT_OPCODE: return n_in == 2 && n_out == 1;
+		case CONST_MUL_NEG_OPCODE:
+		case CONST_MUL_OPCODE: return n_in == 1 && n_out == 1;
+		case ZEROP_OPCODE: return n_in == 1 && n_out == 2;
+		case SPLIT_OPCODE: return n_in == 1 && n_out > 0;
+		case PACK_OPCODE: return n_in > 0 && n_out == 1;
+		case TABLE_OPCODE: return n_in > 0 && n_in <= TABLE_MAX_BITS && n_out == 1;
+		default: return false;
+	}
+}
+
+
+void CircuitReader::addDeclaration( uint32_t kind, Wire wireId )
+{
+	if( kind == DECLARE_INPUT ) {
+		// XXX: public inputs need to go first!
+		numInputs++;
+		varNew(wireId, FMT("input_", "%zu", wireId));
+		inputWireIds.push_back(wireId);
+	}
+	else if( kind == DECLARE_NIZKINPUT ) {
+		numNizkInputs++;
+		varNew(wireId, FMT("nizkinput_", "%zu", wireId));
+		nizkWireIds.push_back(wireId);
+	}
+	else {
+		numOutputs++;
+		varNew(wireId, FMT("output_", "%zu", wireId));
+		outputWireIds.push_back(wireId);
+	}
+}
+
+
+InputWires CircuitReader::addWires( const std::vector<Wire>& wires )
+{
+	const size_t offset = instructionWires.size();
+	instructionWires.insert(instructionWires.end(), wires.begin(), wires.end());
+	return InputWires(instructionWires, offset, wires.size());
+}
+
+
+/**
+* Folded wires reached through other folded wires are flattened, so their
+* terms grow. Past this many they get a variable of their own instead.
+*/
+static const size_t FOLD_MAX_TERMS = 64;
+
+
+/**
+* Decide which linear gates are folded, before any variables are allocated
+* for them. Wires which are declared, or are the bits of a lookup table,
+* need a variable so they are never folded.
+*/
+void CircuitReader::foldLinearGates( )
+{
+	std::vector<bool> needsVariable(wireVariables.size(), false);
+	for( const auto& inst : instructions ) {
+		if( inst.opcode == TABLE_OPCODE ) {
+			for( const auto& wire_id : inst.inputs ) {
+				needsVariable[wire_id] = true;
+			}
+		}
+	}
+
+	wireFolds.assign(wireVariables.size(), 0);
+
+	std::vector<WireTerm> terms;
+	for( const auto& inst : instructions )
+	{
+		const auto opcode = inst.opcode;
+		if( opcode != ADD_OPCODE && opcode != CONST_MUL_OPCODE && opcode != CONST_MUL_NEG_OPCODE ) {
+			continue;
+		}
+
+		if( inst.outputs.size() != 1 ) {
+			continue;
+		}
+
+		const Wire out = inst.outputs[0];
+		if( varExists(out) || needsVariable[out] ) {
+			continue;
+		}
+
+		const FieldT scale = (opcode == ADD_OPCODE) ? FieldT::one() : inst.constant;
+
+		terms.clear();
+		for( const auto& wire_id : inst.inputs ) {
+			if( isFolded(wire_id) ) {
+				for( const auto& term : foldedTerms[wireFolds[wire_id] - 1] ) {
+					terms.push_back({term.wire, term.coeff * scale});
+				}
+			}
+			else {
+				terms.push_back({wire_id, scale});
+			}
+		}
+
+		// Merge the terms for the same wire
+		std::sort(terms.begin(), terms.end(), [](const WireTerm& a, const WireTerm& b) {
+			return a.wire < b.wire;
+		});
+		size_t n_terms = 0;
+		for( const auto& term : terms ) {
+			if( n_terms && terms[n_terms - 1].wire == term.wire ) {
+				terms[n_terms - 1].coeff += term.coeff;
+			}
+			else {
+				terms[n_terms++] = term;
+			}
+		}
+
+		if( n_terms > FOLD_MAX_TERMS ) {
+			continue;
+		}
+
+		foldedTerms.emplace_back(termPool, termPool.size(), n_terms);
+		termPool.insert(termPool.end(), terms.begin(), terms.begin() + n_terms);
+		wireFolds[out] = foldedTerms.size();
+	}
+}
+
+
+bool CircuitReader::isFolded( Wire wire_id ) const
+{
+	return wire_id < wireFolds.size() && wireFolds[wire_id] != 0;
+}
+
+
 void CircuitReader::parseCircuit(const char* arithFilepath)
 {
 	if( traceEnabled ) {
-		enter_block("Parsing Circuit");
+		trace_enter_block("Parsing Circuit");
+	}
+
+	if( ! parseBinaryCircuit(arithFilepath) ) {
+		parseTextCircuit(arithFilepath);
+	}
+
+	// The text `total` header isn't always right, so size the table from the
+	// wires used. The binary header is, every wire is checked against it.
+	size_t n_wires = wireVariables.size();
+	for( const auto& wire_id : instructionWires ) {
+		n_wires = std::max(n_wires, size_t(wire_id) + 1);
+	}
+	wireVariables.resize(n_wires);
+
+	foldLinearGates();
+
+	this->pb.set_input_sizes(numInputs);
+
+	if( traceEnabled ) {
+		trace_leave_block("Parsing Circuit");
+	}
+}
+
+
+/**
+* Returns false, without reading anything, when the file isn't in the
+* binary format. Malformed binary files are fatal like malformed text.
+*/
+bool CircuitReader::parseBinaryCircuit(const char* binFilepath)
+{
+	const int fd = ::open(binFilepath, O_RDONLY);
+	if( fd < 0 ) {
+		return false;
+	}
+
+	struct stat st;
+	char magic[sizeof(ARITH_BIN_MAGIC)];
+	if( 0 != ::fstat(fd, &st)
+	 || size_t(st.st_size) < ARITH_BIN_HEADER_SIZE
+	 || ::read(fd, magic, sizeof(magic)) != ssize_t(sizeof(magic))
+	 || 0 != ::memcmp(magic, ARITH_BIN_MAGIC, sizeof(magic)) ) {
+		::close(fd);
+		return false;
+	}
+
+	void *mapped = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if( mapped == MAP_FAILED ) {
+		std::cerr << "Unable to mmap circuit file " << binFilepath << std::endl;
+		exit(-1);
+	}
+	::madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+
+	const uint8_t *data = static_cast<const uint8_t*>(mapped);
+	const size_t size = st.st_size;
+
+	const auto fail = [&]( const char *reason ) {
+		std::cerr << "Error parsing " << binFilepath << ": " << reason << std::endl;
+		exit(6);
+	};
+
+	if( read_u32(data + 8) != ARITH_BIN_VERSION ) {
+		fail("unsupported version");
+	}
+
+	if( read_u32(data + 12) != ARITH_BIN_FIELD_BYTES ) {
+		fail("field element size mismatch");
+	}
+
+	numWires = read_u64(data + 16);
+	const uint64_t n_declarations = read_u64(data + 24);
+	const uint64_t n_instructions = read_u64(data + 32);
+	const uint64_t n_instruction_wires = read_u64(data + 40);
+	const uint64_t n_table_values = read_u64(data + 48);
+
+	// Every declaration and instruction takes at least 8 bytes, which bounds the counts
+	size_t offset = ARITH_BIN_HEADER_SIZE;
+	if( n_declarations > (size - offset) / 8
+	 || n_instructions > (size - offset) / 8
+	 || n_instruction_wires > (size - offset) / 4
+	 || n_table_values > (size - offset) / ARITH_BIN_FIELD_BYTES ) {
+		fail("truncated");
+	}
+
+	for( uint64_t i = 0; i < n_declarations; i++, offset += 8 ) {
+		if( size - offset < 8 ) {
+			fail("truncated declarations");
+		}
+		const uint32_t kind = read_u32(data + offset);
+		const Wire wire_id = read_u32(data + offset + 4);
+		if( kind > DECLARE_OUTPUT ) {
+			fail("unknown declaration");
+		}
+		if( wire_id >= numWires ) {
+			fail("wire out of range");
+		}
+		addDeclaration(kind, wire_id);
+	}
+
+	instructions.reserve(n_instructions);
+	instructionWires.reserve(n_instruction_wires);
+	tableValues.reserve(n_table_values);
+
+	for( uint64_t i = 0; i < n_instructions; i++ )
+	{
+		if( size - offset < 12 ) {
+			fail("truncated instructions");
+		}
+		const uint32_t opcode = read_u32(data + offset);
+		const uint32_t n_in = read_u32(data + offset + 4);
+		const uint32_t n_out = read_u32(data + offset + 8);
+		offset += 12;
+
+		if( ! validArity(opcode, n_in, n_out) ) {
+			fail("bad instruction");
+		}
+
+		const bool has_constant = (opcode == CONST_MUL_OPCODE || opcode == CONST_MUL_NEG_OPCODE);
+		const size_t n_table = (opcode == TABLE_OPCODE) ? (size_t(1) << n_in) : 0;
+		const uint64_t n_bytes = (uint64_t(n_in) + n_out) * 4 + ((has_constant ? 1 : 0) + n_table) * ARITH_BIN_FIELD_BYTES;
+		if( size - offset < n_bytes
+		 || instructionWires.size() + n_in + n_out > n_instruction_wires
+		 || tableValues.size() + n_table > n_table_values ) {
+			fail("truncated instruction");
+		}
+
+		CircuitInstruction inst;
+		inst.opcode = Opcode(opcode);
+
+		const size_t wires_offset = instructionWires.size();
+		for( uint32_t j = 0; j < n_in + n_out; j++, offset += 4 ) {
+			const Wire wire_id = read_u32(data + offset);
+			if( wire_id >= numWires ) {
+				fail("wire out of range");
+			}
+			instructionWires.push_back(wire_id);
+		}
+		inst.inputs = InputWires(instructionWires, wires_offset, n_in);
+		inst.outputs = OutputWires(instructionWires, wires_offset + n_in, n_out);
+
+		if( has_constant ) {
+			inst.constant = read_field(data + offset);
+			offset += ARITH_BIN_FIELD_BYTES;
+		}
+
+		if( n_table ) {
+			const size_t table_offset = tableValues.size();
+			for( size_t j = 0; j < n_table; j++, offset += ARITH_BIN_FIELD_BYTES ) {
+				tableValues.push_back(read_field(data + offset));
+			}
+			inst.table = TableValues(tableValues, table_offset, n_table);
+		}
+
+		instructions.push_back(inst);
 	}
 
+	::munmap(mapped, st.st_size);
+
+	return true;
+}
+
+
+void CircuitReader::parseTextCircuit(const char* arithFilepath)
+{
 	ifstream arithfs(arithFilepath, ifstream::in);
 	string line;
 
@@ -236,11 +998,16 @@ void CircuitReader::parseCircuit(const char* arithFilepath)
 		std::cerr << "File Format Does not Match" << endl;;
 		exit(-1);
 	}
-
-	char type[200];	// XXX: buffer overflow!
-	char* inputStr;
-	char* outputStr;
-	char* tableStr;
+	wireVariables.reserve(numWires);
+
+	// Re-used for every line, only growing when a line is longer than any before it
+	std::vector<char> type;
+	std::vector<char> inputStr;
+	std::vector<char> outputStr;
+	std::vector<char> tableStr;
+	std::vector<Wire> inWires;
+	std::vector<Wire> outWires;
+	std::vector<FieldT> table;
 	unsigned int numGateInputs, numGateOutputs;
 
 	// Parse the circuit: few lines were imported from Pinocchio's code.
@@ -249,36 +1016,32 @@ void CircuitReader::parseCircuit(const char* arithFilepath)
 		if (line.length() == 0) {
 			continue;
 		}
-		inputStr = new char[line.size()];
-		outputStr = new char[line.size()];
-		tableStr = new char[line.size()];
+		if (inputStr.size() <= line.size()) {
+			type.resize(line.size() + 1);
+			inputStr.resize(line.size() + 1);
+			outputStr.resize(line.size() + 1);
+			tableStr.resize(line.size() + 1);
+		}
+		inWires.clear();
+		outWires.clear();
 
 		Wire wireId;
 		if (line[0] == '#') {
 			continue;
 		}
 		else if (1 == sscanf(line.c_str(), "input %u", &wireId)) {
-			// XXX: public inputs need to go first!
-			numInputs++;
-			varNew(wireId, FMT("input_", "%zu", wireId));
-			inputWireIds.push_back(wireId);
+			addDeclaration(DECLARE_INPUT, wireId);
 		}
 		else if (1 == sscanf(line.c_str(), "nizkinput %u", &wireId)) {
-			numNizkInputs++;
-			varNew(wireId, FMT("nizkinput_", "%zu", wireId));
-			nizkWireIds.push_back(wireId);
+			addDeclaration(DECLARE_NIZKINPUT, wireId);
 		}
 		else if (1 == sscanf(line.c_str(), "output %u", &wireId)) {
-			numOutputs++;
-			varNew(wireId, FMT("output_", "%zu", wireId));
-			outputWireIds.push_back(wireId);
+			addDeclaration(DECLARE_OUTPUT, wireId);
 		}
 		else if (4 == sscanf(line.c_str(), "table %u <%[^>]> in <%[^>]> out <%[^>]>",
-							 &numGateInputs, tableStr, inputStr, outputStr)) {
-			InputWires inWires;
-			OutputWires outWires;
-			readIds(inputStr, inWires);
-			readIds(outputStr, outWires);
+							 &numGateInputs, tableStr.data(), inputStr.data(), outputStr.data())) {
+			readIds(inputStr.data(), inWires);
+			readIds(outputStr.data(), outWires);
 			numGateOutputs = outWires.size();
 
 			if( numGateInputs != inWires.size() ) {
@@ -293,28 +1056,33 @@ void CircuitReader::parseCircuit(const char* arithFilepath)
 				exit(6);
 			}
 
-			if( numGateInputs <= 0 || numGateInputs > 3u ) {
+			if( numGateInputs <= 0 || numGateInputs > TABLE_MAX_BITS ) {
 				std::cerr << "Error parsing line: " << line << std::endl;
 				std::cerr << " unsupported lookup table size: " << numGateInputs << std::endl;
 				exit(6);
 			}
 
-			std::vector<FieldT> table;
-			readTable(tableStr, table);
+			table.clear();
+			readTable(tableStr.data(), table);
 			if( table.size() != (1u<<numGateInputs) ) {
 				std::cerr << "Error parsing line: " << line << std::endl;
 				std::cerr << " bad number of table entries, got " << table.size() << " expected " << (1<<inWires.size()) << std::endl;
 				exit(6);
 			}
-			instructions.push_back({TABLE_OPCODE, 0, inWires, outWires, table});
+
+			CircuitInstruction inst;
+			inst.opcode = TABLE_OPCODE;
+			inst.inputs = addWires(inWires);
+			inst.outputs = addWires(outWires);
+			inst.table = TableValues(tableValues, tableValues.size(), table.size());
+			tableValues.insert(tableValues.end(), table.begin(), table.end());
+			instructions.push_back(inst);
 		}
 		else if (5 == sscanf(line.c_str(), "%s in %u <%[^>]> out %u <%[^>]>",
-						type, &numGateInputs, inputStr, &numGateOutputs, outputStr)) {
+						type.data(), &numGateInputs, inputStr.data(), &numGateOutputs, outputStr.data())) {
 
-			OutputWires outWires;
-			InputWires inWires;
-			readIds(inputStr, inWires);
-			readIds(outputStr, outWires);
+			readIds(inputStr.data(), inWires);
+			readIds(outputStr.data(), outWires);
 
 			if( numGateInputs != inWires.size() ) {
 				std::cerr << "Error parsing line: " << line << std::endl;
@@ -328,40 +1096,41 @@ void CircuitReader::parseCircuit(const char* arithFilepath)
 				exit(6);
 			}
 
+			const char *typeStr = type.data();
 			Opcode opcode;
 			FieldT constant;
-			if (strcmp(type, "add") == 0) {
+			if (strcmp(typeStr, "add") == 0) {
 				opcode = ADD_OPCODE;
 			}
-			else if (strcmp(type, "mul") == 0) {
+			else if (strcmp(typeStr, "mul") == 0) {
 				opcode = MUL_OPCODE;
 			}
-			else if (strcmp(type, "xor") == 0) {
+			else if (strcmp(typeStr, "xor") == 0) {
 				opcode = XOR_OPCODE;
 			}
-			else if (strcmp(type, "or") == 0) {
+			else if (strcmp(typeStr, "or") == 0) {
 				opcode = OR_OPCODE;
 			}
-			else if (strcmp(type, "assert") == 0) {
+			else if (strcmp(typeStr, "assert") == 0) {
 				opcode = ASSERT_OPCODE;
 			}
-			else if (strcmp(type, "pack") == 0) {
+			else if (strcmp(typeStr, "pack") == 0) {
 				opcode = PACK_OPCODE;
 			}
-			else if (strcmp(type, "zerop") == 0) {
+			else if (strcmp(typeStr, "zerop") == 0) {
 				opcode = ZEROP_OPCODE;
 			}
-			else if (strcmp(type, "split") == 0) {
+			else if (strcmp(typeStr, "split") == 0) {
 				opcode = SPLIT_OPCODE;
 			}
-			else if (strstr(type, "const-mul-neg-")) {
+			else if (strstr(typeStr, "const-mul-neg-")) {
 				opcode = CONST_MUL_NEG_OPCODE;
-				char* constStr = type + sizeof("const-mul-neg-") - 1;
+				const char* constStr = typeStr + sizeof("const-mul-neg-") - 1;
 				constant = readFieldElementFromHex(constStr) * FieldT(-1);
 			}
-			else if (strstr(type, "const-mul-")) {
+			else if (strstr(typeStr, "const-mul-")) {
 				opcode = CONST_MUL_OPCODE;
-				char* constStr = type + sizeof("const-mul-") - 1;
+				const char* constStr = typeStr + sizeof("const-mul-") - 1;
 				constant = readFieldElementFromHex(constStr);
 			}
 			else {
@@ -369,22 +1138,208 @@ void CircuitReader::parseCircuit(const char* arithFilepath)
 				exit(-1);
 			}
 
-			instructions.push_back({opcode, constant, inWires, outWires});
+			CircuitInstruction inst;
+			inst.opcode = opcode;
+			inst.constant = constant;
+			inst.inputs = addWires(inWires);
+			inst.outputs = addWires(outWires);
+			instructions.push_back(inst);
 		}
 		else {
 			printf("Error: unrecognized line: %s\n", line.c_str());
 			assert(0);
 		}
-		delete[] inputStr;
-		delete[] outputStr;
-		delete[] tableStr;
 	}
 	arithfs.close();
+}
 
-	this->pb.set_input_sizes(numInputs);
 
-	if( traceEnabled ) {
-		leave_block("Parsing Circuit");
+bool CircuitReader::writeBinaryCircuit(const char* binFilepath) const
+{
+	// Declarations are written in the order their variables were allocated
+	std::vector<std::pair<size_t, std::pair<uint32_t, Wire>>> declarations;
+	for( const auto& wire_id : inputWireIds ) {
+		declarations.push_back({wireVariables[wire_id].index, {DECLARE_INPUT, wire_id}});
+	}
+	for( const auto& wire_id : nizkWireIds ) {
+		declarations.push_back({wireVariables[wire_id].index, {DECLARE_NIZKINPUT, wire_id}});
+	}
+	for( const auto& wire_id : outputWireIds ) {
+		declarations.push_back({wireVariables[wire_id].index, {DECLARE_OUTPUT, wire_id}});
+	}
+	std::sort(declarations.begin(), declarations.end());
+
+	std::ofstream out(binFilepath, std::ios::binary);
+	if( ! out.good() ) {
+		std::cerr << "Unable to open " << binFilepath << std::endl;
+		return false;
+	}
+
+	std::string buf(ARITH_BIN_MAGIC, sizeof(ARITH_BIN_MAGIC));
+	put_u32(buf, ARITH_BIN_VERSION);
+	put_u32(buf, ARITH_BIN_FIELD_BYTES);
+	put_u64(buf, std::max(numWires, wireVariables.size()));
+	put_u64(buf, declarations.size());
+	put_u64(buf, instructions.size());
+	put_u64(buf, instructionWires.size());
+	put_u64(buf, tableValues.size());
+
+	for( const auto& decl : declarations ) {
+		put_u32(buf, decl.second.first);
+		put_u32(buf, decl.second.second);
+	}
+
+	for( const auto& inst : instructions )
+	{
+		put_u32(buf, inst.opcode);
+		put_u32(buf, inst.inputs.size());
+		put_u32(buf, inst.outputs.size());
+		for( const auto& wire_id : inst.inputs ) {
+			put_u32(buf, wire_id);
+		}
+		for( const auto& wire_id : inst.outputs ) {
+			put_u32(buf, wire_id);
+		}
+		if( inst.opcode == CONST_MUL_OPCODE || inst.opcode == CONST_MUL_NEG_OPCODE ) {
+			put_field(buf, inst.constant);
+		}
+		for( const auto& value : inst.table ) {
+			put_field(buf, value);
+		}
+
+		if( buf.size() > (1 << 20) ) {
+			out.write(buf.data(), buf.size());
+			buf.clear();
+		}
+	}
+
+	out.write(buf.data(), buf.size());
+	out.close();
+
+	return out.good();
+}
+
+
+bool CircuitReader::convertCircuit( const char *arithFilepath, const char *binFilepath )
+{
+	ProtoboardT pb;
+	CircuitReader reader(pb);
+	reader.parseCircuit(arithFilepath);
+
+	return reader.writeBinaryCircuit(binFilepath);
+}
+
+
+/**
+* The binary inputs format, all integers are little-endian:
+*
+*	header: magic[8] version:u32 field_bytes:u32 count:u64
+*	input:  wire:u32 reserved:u32 value[field_bytes]
+*
+* Each input is a fixed size, so the values stay aligned and the table can
+* be read in place from a memory map. Values are the integers, not their
+* Montgomery form, as in the binary circuit format.
+*/
+static const char INPUTS_BIN_MAGIC[8] = {'E', 'S', 'I', 'N', 'P', 'U', 'T', 'B'};
+static const uint32_t INPUTS_BIN_VERSION = 1;
+static const size_t INPUTS_BIN_HEADER_SIZE = 24;
+static const size_t INPUTS_BIN_ENTRY_SIZE = 8 + ARITH_BIN_FIELD_BYTES;
+
+
+/**
+* Returns false, without reading anything, when the file isn't in the
+* binary format. Malformed binary files are fatal like malformed text.
+*/
+bool CircuitReader::parseBinaryInputs( const char *binFilepath )
+{
+	const int fd = ::open(binFilepath, O_RDONLY);
+	if( fd < 0 ) {
+		return false;
+	}
+
+	struct stat st;
+	char magic[sizeof(INPUTS_BIN_MAGIC)];
+	if( 0 != ::fstat(fd, &st)
+	 || size_t(st.st_size) < INPUTS_BIN_HEADER_SIZE
+	 || ::read(fd, magic, sizeof(magic)) != ssize_t(sizeof(magic))
+	 || 0 != ::memcmp(magic, INPUTS_BIN_MAGIC, sizeof(magic)) ) {
+		::close(fd);
+		return false;
+	}
+
+	void *mapped = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if( mapped == MAP_FAILED ) {
+		std::cerr << "Unable to mmap input file " << binFilepath << std::endl;
+		exit(-1);
+	}
+	::madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+
+	const uint8_t *data = static_cast<const uint8_t*>(mapped);
+	const size_t size = st.st_size;
+
+	const auto fail = [&]( const char *reason ) {
+		std::cerr << "Error parsing " << binFilepath << ": " << reason << std::endl;
+		exit(6);
+	};
+
+	if( read_u32(data + 8) != INPUTS_BIN_VERSION ) {
+		fail("unsupported version");
+	}
+
+	if( read_u32(data + 12) != ARITH_BIN_FIELD_BYTES ) {
+		fail("field element size mismatch");
+	}
+
+	const uint64_t count = read_u64(data + 16);
+	if( count > (size - INPUTS_BIN_HEADER_SIZE) / INPUTS_BIN_ENTRY_SIZE ) {
+		fail("truncated");
+	}
+
+	const uint8_t *entry = data + INPUTS_BIN_HEADER_SIZE;
+	for( uint64_t i = 0; i < count; i++, entry += INPUTS_BIN_ENTRY_SIZE ) {
+		varSet(read_u32(entry), read_field(entry + 8));
+	}
+
+	::munmap(mapped, size);
+	return true;
+}
+
+
+bool CircuitReader::convertInputs( const char *inputsFilepath, const char *binFilepath )
+{
+	std::string table;
+	uint64_t count = 0;
+	readTextInputs(inputsFilepath, [&]( Wire wireId, const FieldT& value ) {
+		put_u32(table, wireId);
+		put_u32(table, 0);
+		put_field(table, value);
+		count++;
+	});
+
+	std::ofstream out(binFilepath, std::ios::binary);
+	if( ! out.good() ) {
+		std::cerr << "Unable to open " << binFilepath << std::endl;
+		return false;
+	}
+
+	std::string header(INPUTS_BIN_MAGIC, sizeof(INPUTS_BIN_MAGIC));
+	put_u32(header, INPUTS_BIN_VERSION);
+	put_u32(header, ARITH_BIN_FIELD_BYTES);
+	put_u64(header, count);
+
+	out.write(header.data(), header.size());
+	out.write(table.data(), table.size());
+	out.close();
+
+	return out.good();
+}
+
+
+void CircuitReader::addConstraint( const ConstraintT& constraint, const std::string& annotation )
+{
+	if( ! witnessOnly ) {
+		pb.add_r1cs_constraint(constraint, annotation);
 	}
 }
 
@@ -399,6 +1354,12 @@ void CircuitReader::makeAllConstraints( )
 
 
 const char* CircuitInstruction::name( ) const
+{
+	return opcodeName(opcode);
+}
+
+
+const char* opcodeName( Opcode opcode )
 {
 	switch( opcode ) {
 		case ADD_OPCODE: return "add";
@@ -417,7 +1378,7 @@ const char* CircuitInstruction::name( ) const
 }
 
 
-static void printWires( const std::vector<Wire> wire_id_list )
+static void printWires( const PoolRange<Wire>& wire_id_list )
 {
 	bool first = true;
 	cout << "<";
@@ -434,7 +1395,7 @@ static void printWires( const std::vector<Wire> wire_id_list )
 }
 
 
-static void printTable( const std::vector<FieldT> &table ) {
+static void printTable( const TableValues& table ) {
 	bool first = true;
 	cout << "<";
 	for( const auto& item : table ) {
@@ -494,7 +1455,13 @@ void CircuitReader::makeConstraints( const CircuitInstruction& inst )
 		inst.print();
 	}
 
-	if ( opcode == ADD_OPCODE ) {
+	const size_t n_constraints = pb.num_constraints();
+	const size_t n_variables = pb.num_variables();
+
+	if( outWires.size() && isFolded(outWires[0]) ) {
+		// Folded into the constraints of the gates which use it
+	}
+	else if ( opcode == ADD_OPCODE ) {
 		assert(inWires.size() > 1);
 		handleAddition(inWires, outWires);
 	}
@@ -535,7 +1502,18 @@ void CircuitReader::makeConstraints( const CircuitInstruction& inst )
 		addPackConstraint(inWires, outWires);
 	}
 	else if( opcode == TABLE_OPCODE ) {
-		addTableConstraint(inWires, outWires, inst.table);
+		addTableConstraint(inWires, outWires, inst.table, inst.auxIndex);
+	}
+
+	if( profile )
+	{
+		auto& entry = (*profile)[inst.name()];
+		entry.count++;
+		entry.variables += pb.num_variables() - n_variables;
+		for( size_t c = n_constraints; c < pb.num_constraints(); c++ ) {
+			entry.constraints++;
+			entry.terms += cs_constraint_terms(pb.constraint_system, c);
+		}
 	}
 
 	if( traceEnabled )
@@ -558,6 +1536,14 @@ void CircuitReader::makeConstraints( const CircuitInstruction& inst )
 
 FieldT CircuitReader::varValue( Wire wire_id )
 {
+	if( isFolded(wire_id) ) {
+		FieldT sum = FieldT::zero();
+		for( const auto& term : foldedTerms[wireFolds[wire_id] - 1] ) {
+			sum += term.coeff * varValue(term.wire);
+		}
+		return sum;
+	}
+
 	auto& var = varGet(wire_id);
 
 	return this->pb.val(var);
@@ -566,22 +1552,29 @@ FieldT CircuitReader::varValue( Wire wire_id )
 
 void CircuitReader::varSet( Wire wire_id, const FieldT& value, const std::string& annotation )
 {
+	if( isFolded(wire_id) ) {
+		return;
+	}
+
 	this->pb.val(varGet(wire_id, annotation)) = value;
 }
 
 
 bool CircuitReader::varExists( Wire wire_id )
 {
-	return variableMap.find(wire_id) != variableMap.end();
+	return wire_id < wireVariables.size() && wireVariables[wire_id].index != 0;
 }
 
 
 const VariableT& CircuitReader::varNew( Wire wire_id, const std::string &annotation )
 {
-	VariableT v;
+	if( wire_id >= wireVariables.size() ) {
+		wireVariables.resize(size_t(wire_id) + 1);
+	}
+
+	auto& v = wireVariables[wire_id];
 	v.allocate(this->pb, annotation);
-	variableMap.emplace(wire_id, v);
-	return variableMap[wire_id];
+	return v;
 }
 
 
@@ -590,64 +1583,171 @@ const VariableT& CircuitReader::varGet( Wire wire_id, const std::string &annotat
 	if ( ! varExists(wire_id) ) {
 		return varNew(wire_id, annotation);
 	}
-	return variableMap[wire_id];
+	return wireVariables[wire_id];
 }
 
 
-void CircuitReader::addTableConstraint(const InputWires& inputs, const OutputWires& outputs, const std::vector<FieldT> table)
+/**
+* Add `scale * wire` to `lc`, expanding folded wires into their terms
+*/
+void CircuitReader::addTerms( LinearCombinationT& lc, Wire wire_id, const FieldT& scale, const std::string &annotation )
+{
+	if( isFolded(wire_id) ) {
+		for( const auto& term : foldedTerms[wireFolds[wire_id] - 1] ) {
+			lc.add_term(varGet(term.wire), term.coeff * scale);
+		}
+	}
+	else {
+		lc.add_term(varGet(wire_id, annotation), scale);
+	}
+}
+
+
+LinearCombinationT CircuitReader::varLC( Wire wire_id, const std::string &annotation )
+{
+	LinearCombinationT lc;
+	addTerms(lc, wire_id, FieldT::one(), annotation);
+	return lc;
+}
+
+
+void CircuitReader::addTableConstraint(const InputWires& inputs, const OutputWires& outputs, const TableValues& table, size_t auxIndex)
 {
 	if( table.size() == 2 ) {
-		lookup_1bit_constraints(pb, table, varGet(inputs[0]), varGet(outputs[0]), "lookup_1bit");
+		if( ! witnessOnly ) {
+			lookup_1bit_constraints(pb, table.vector(), varGet(inputs[0]), varGet(outputs[0]), "lookup_1bit");
+		}
 	}
 	else if( table.size() == 4 ) {
-		std::vector<VariableT> lut_inputs = {varGet(inputs[0]), varGet(inputs[1])};
-		lookup_2bit_constraints(pb, table, {lut_inputs.begin(), lut_inputs.end()}, varGet(outputs[0]), "lookup_2bit");
+		if( ! witnessOnly ) {
+			std::vector<VariableT> lut_inputs = {varGet(inputs[0]), varGet(inputs[1])};
+			lookup_2bit_constraints(pb, table.vector(), {lut_inputs.begin(), lut_inputs.end()}, varGet(outputs[0]), "lookup_2bit");
+		}
+	}
+	else {
+		addSplitTableConstraints(inputs, outputs, table, auxIndex);
+	}
+}
+
+
+/**
+* A table of more than 2 bits is split at its `k` low bits into 2^(n-k)
+* sub-tables. Every product of two or more low bits is a variable, shared by
+* the sub-tables, so each sub-table is a linear combination of the products,
+* like lookup_3bit_gadget, without a constraint. The high bits then select
+* between pairs of sub-tables, one constraint each, down to the output.
+*
+* The intermediate variables, the products then the selects of each level,
+* are allocated by allocateWires and evaluated by evalTape.
+*/
+void CircuitReader::addSplitTableConstraints(const InputWires& inputs, const OutputWires& outputs, const TableValues& table, size_t auxIndex)
+{
+	typedef libsnark::linear_combination<FieldT> LC;
+
+	const size_t n_bits = inputs.size();
+	const size_t k = tableLowBits(n_bits);
+	size_t aux = auxIndex;
+
+	// Products of the low bits, by mask of the bits, 0 is the constant term
+	std::vector<VariableT> products(size_t(1) << k, VariableT(0));
+	for( size_t mask = 1; mask < products.size(); mask++ )
+	{
+		size_t top = 0;
+		while( mask >> (top + 1) ) {
+			top++;
+		}
+
+		if( mask == (size_t(1) << top) ) {
+			products[mask] = varGet(inputs[top]);
+		}
+		else {
+			products[mask] = VariableT(aux++);
+			addConstraint(ConstraintT(products[mask & ~(size_t(1) << top)], products[size_t(1) << top], products[mask]), "table product");
+		}
 	}
-	else if( table.size() == 8 ) {
-		std::vector<VariableT> lut_inputs = {varGet(inputs[0]), varGet(inputs[1]), varGet(inputs[2])};
-		lookup_3bit_gadget lut(pb, table, {lut_inputs.begin(), lut_inputs.end()}, "lookup_3bit");
-		lut.generate_r1cs_constraints();
+
+	// Each sub-table as a combination of the products, its coefficients are
+	// the Moebius transform of its values
+	std::vector<LC> selected;
+	std::vector<FieldT> coeffs(products.size());
+	for( size_t offset = 0; offset < table.size(); offset += products.size() )
+	{
+		std::copy(table.begin() + offset, table.begin() + offset + products.size(), coeffs.begin());
+		for( size_t bit = 1; bit < products.size(); bit <<= 1 ) {
+			for( size_t mask = 0; mask < products.size(); mask++ ) {
+				if( mask & bit ) {
+					coeffs[mask] -= coeffs[mask ^ bit];
+				}
+			}
+		}
+
+		LC lc;
+		for( size_t mask = 0; mask < products.size(); mask++ ) {
+			if( ! coeffs[mask].is_zero() ) {
+				lc.add_term(products[mask], coeffs[mask]);
+			}
+		}
+		selected.push_back(lc);
+	}
+
+	if( selected.size() == 1 ) {
+		addConstraint(ConstraintT(selected[0], FieldT::one(), varGet(outputs[0])), "table result");
+		return;
+	}
+
+	// bit * (odd - even) = result - even
+	for( size_t bit = k; selected.size() > 1; bit++ )
+	{
+		const auto& select = varGet(inputs[bit]);
+		std::vector<LC> next;
+		for( size_t j = 0; j < selected.size(); j += 2 )
+		{
+			const VariableT result = selected.size() == 2 ? varGet(outputs[0]) : VariableT(aux++);
+			addConstraint(ConstraintT(select, selected[j + 1] - selected[j], result - selected[j]), "table select");
+			next.push_back(LC(result));
+		}
+		selected.swap(next);
 	}
 }
 
 
 void CircuitReader::addMulConstraint(const InputWires& inputs, const OutputWires& outputs)
 {
-	auto& l1 = varGet(inputs[0], FMT("mul A ", "(%zu)", inputs[0]));
-	auto& l2 = varGet(inputs[1], FMT("mul B ", "(%zu)", inputs[1]));
+	const auto l1 = varLC(inputs[0], FMT("mul A ", "(%zu)", inputs[0]));
+	const auto l2 = varLC(inputs[1], FMT("mul B ", "(%zu)", inputs[1]));
 	auto& outvar = varGet(outputs[0], FMT("mul out", "%zu", outputs[0]));
 
-	pb.add_r1cs_constraint(ConstraintT(l1, l2, outvar), "mul, A * B = C");
+	addConstraint(ConstraintT(l1, l2, outvar), "mul, A * B = C");
 }
 
 
 void CircuitReader::addXorConstraint(const InputWires& inputs, const OutputWires& outputs)
 {
-	auto& l1 = varGet(inputs[0], "xor A");
-	auto& l2 = varGet(inputs[1], "xor B");
+	const auto l1 = varLC(inputs[0], "xor A");
+	const auto l2 = varLC(inputs[1], "xor B");
 	auto& outvar = varGet(outputs[0], "xor result");
 
-	pb.add_r1cs_constraint(ConstraintT(2 * l1, l2, l1 + l2 - outvar), "xor, A ^ B = C");
+	addConstraint(ConstraintT(2 * l1, l2, l1 + l2 - outvar), "xor, A ^ B = C");
 }
 
 
 void CircuitReader::addOrConstraint(const InputWires& inputs, const OutputWires& outputs)
 {
-	auto& l1 = varGet(inputs[0], "or A");
-	auto& l2 = varGet(inputs[1], "or B");
+	const auto l1 = varLC(inputs[0], "or A");
+	const auto l2 = varLC(inputs[1], "or B");
 	auto& outvar = varGet(outputs[0], "or result");
 
-	pb.add_r1cs_constraint(ConstraintT(l1, l2, l1 + l2 - outvar), "or, A | B = C");
+	addConstraint(ConstraintT(l1, l2, l1 + l2 - outvar), "or, A | B = C");
 }
 
 
 void CircuitReader::addAssertionConstraint(const InputWires& inputs, const OutputWires& outputs)
 {
-	auto& l1 = varGet(inputs[0], "assert A");
-	auto& l2 = varGet(inputs[1], "assert B");
-	auto& l3 = varGet(outputs[0], "assert C");
+	const auto l1 = varLC(inputs[0], "assert A");
+	const auto l2 = varLC(inputs[1], "assert B");
+	const auto l3 = varLC(outputs[0], "assert C");
 
-	pb.add_r1cs_constraint(ConstraintT(l1, l2, l3), "assert, A * B = C");
+	addConstraint(ConstraintT(l1, l2, l3), "assert, A * B = C");
 }
 
 
@@ -661,16 +1761,18 @@ void CircuitReader::addSplitConstraint(const InputWires& inputs, const OutputWir
 	{
 		auto &out_bit_var = varGet(outputs[i], FMT("split.output", "[%d][%zu]", outputs[i], i));
 
-		generate_boolean_r1cs_constraint<FieldT>(pb, out_bit_var);
+		if( ! witnessOnly ) {
+			generate_boolean_r1cs_constraint<FieldT>(pb, out_bit_var);
+		}
 
 		sum.add_term( out_bit_var * two_i );
 
 		two_i += two_i;
 	}
 
-	pb.add_r1cs_constraint(
+	addConstraint(
 		ConstraintT(
-			varGet(inputs[0], FMT("split.input", "[%d]", inputs[0])), 1, sum),
+			varLC(inputs[0], FMT("split.input", "[%d]", inputs[0])), 1, sum),
 			"split result");
 }
 
@@ -683,11 +1785,11 @@ void CircuitReader::addPackConstraint(const InputWires& inputs, const OutputWire
 
 	for( size_t i = 0; i < inputs.size(); i++ )
 	{
-		sum.add_term(varGet(inputs[i], FMT("pack.input", "[%d]", inputs[i])) * two_i);
+		addTerms(sum, inputs[i], two_i, FMT("pack.input", "[%d]", inputs[i]));
 		two_i += two_i;
 	}
 
-	pb.add_r1cs_constraint(
+	addConstraint(
 		ConstraintT(
 			varGet(outputs[0], FMT("pack.output", "[%d]", outputs[0])), 1, sum),
 			"pack");
@@ -715,23 +1817,24 @@ void CircuitReader::addPackConstraint(const InputWires& inputs, const OutputWire
 *   Y * Y = Y
 *
 * For any value M, M should be (1.0/X), where `X*M==1` if X is non-zero.
+*
+* As jsnark writes it, M is the first output wire and Y the second.
 */
 void CircuitReader::addNonzeroCheckConstraint(const InputWires& inputs, const OutputWires& outputs)
 {
-	auto& X = varGet(inputs[0], FMT("zerop input", " (%zu)", inputs[0]));
-
-	auto& Y = varGet(outputs[0], FMT("zerop output", " (%zu)", outputs[0]));
+	const auto X = varLC(inputs[0], FMT("zerop input", " (%zu)", inputs[0]));
 
-	VariableT M;
-	M.allocate(this->pb, FMT("zerop aux", " (%zu,%zu)", inputs[0], outputs[0]));
+	auto& M = varGet(outputs[0], FMT("zerop aux", " (%zu)", outputs[0]));
 
-	generate_boolean_r1cs_constraint<FieldT>(pb, Y);
+	auto& Y = varGet(outputs[1], FMT("zerop output", " (%zu)", outputs[1]));
 
-	pb.add_r1cs_constraint(ConstraintT(X, 1 - LinearCombinationT(Y), 0), "X is 0, or Y is 1");
+	if( ! witnessOnly ) {
+		generate_boolean_r1cs_constraint<FieldT>(pb, Y);
+	}
 
-	pb.add_r1cs_constraint(ConstraintT(X, M, Y), "X * (1/X) = Y");
+	addConstraint(ConstraintT(X, 1 - LinearCombinationT(Y), 0), "X is 0, or Y is 1");
 
-	zerop_items.push_back({inputs[0], M});
+	addConstraint(ConstraintT(X, M, Y), "X * (1/X) = Y");
 }
 
 
@@ -743,30 +1846,30 @@ void CircuitReader::handleAddition(const InputWires& inputs, const OutputWires&
 
 	for( auto& input_id : inputs )
 	{
-		sum.add_term(varGet(input_id));
+		addTerms(sum, input_id, FieldT::one());
 	}
 
-	pb.add_r1cs_constraint(ConstraintT(1, sum, outwire), "add, [input + [input ...]] = C");
+	addConstraint(ConstraintT(1, sum, outwire), "add, [input + [input ...]] = C");
 }
 
 
 void CircuitReader::handleMulConst(const InputWires& inputs, const OutputWires& outputs, const FieldT& constant)
 {
-	auto& A = varGet(inputs[0], "mul const input");
+	const auto A = varLC(inputs[0], "mul const input");
 
 	auto& C = varGet(outputs[0], "mul const output");
 
-	pb.add_r1cs_constraint(ConstraintT(A, constant, C), "mulconst, A * constant = C");
+	addConstraint(ConstraintT(A, constant, C), "mulconst, A * constant = C");
 }
 
 
 void CircuitReader::handleMulNegConst(const InputWires& inputs, const OutputWires& outputs, const FieldT &constant)
 {
-	auto& A = varGet(inputs[0], "const-mul-neg input");
+	const auto A = varLC(inputs[0], "const-mul-neg input");
 
 	auto& C = varGet(outputs[0], "const-mul-neg output");
 
-	pb.add_r1cs_constraint(ConstraintT(A, constant, C), "mulnegconst, A * -constant = C");
+	addConstraint(ConstraintT(A, constant, C), "mulnegconst, A * -constant = C");
 }
 
 // namespace ethsnarks
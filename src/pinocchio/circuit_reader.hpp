@@ -24,13 +24,68 @@ SOFTWARE.
 */
 
 #include "ethsnarks.hpp"
+#include "cs_profile.hpp"
 
 
 namespace ethsnarks {
 
 typedef unsigned int Wire;
-typedef std::vector<Wire> InputWires;
-typedef std::vector<Wire> OutputWires;
+
+
+/**
+* A run of items stored contiguously in a pool owned by the CircuitReader,
+* so instructions don't need a heap allocation each. The pool must not grow
+* once the ranges are read.
+*/
+template<typename T>
+class PoolRange {
+public:
+	PoolRange() : m_pool(nullptr), m_offset(0), m_size(0) {}
+
+	PoolRange(const std::vector<T>& in_pool, size_t in_offset, size_t in_size) :
+		m_pool(&in_pool), m_offset(in_offset), m_size(in_size)
+	{}
+
+	const T* begin() const {
+		return m_pool ? m_pool->data() + m_offset : nullptr;
+	}
+
+	const T* end() const {
+		return begin() + m_size;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	const T& operator[]( size_t i ) const {
+		return begin()[i];
+	}
+
+	std::vector<T> vector() const {
+		return std::vector<T>(begin(), end());
+	}
+
+protected:
+	const std::vector<T>* m_pool;
+	size_t m_offset;
+	size_t m_size;
+};
+
+typedef PoolRange<Wire> InputWires;
+typedef PoolRange<Wire> OutputWires;
+typedef PoolRange<FieldT> TableValues;
+
+
+/**
+* A wire scaled by a coefficient, one term of a folded wire
+*/
+struct WireTerm {
+	Wire wire;
+	FieldT coeff;
+};
+
+typedef PoolRange<WireTerm> WireTerms;
 
 
 enum Opcode {
@@ -48,10 +103,7 @@ enum Opcode {
 };
 
 
-struct ZeroEqualityItem {
-	Wire in_wire_id;
-	ethsnarks::VariableT aux_var;
-};
+const char *opcodeName( Opcode opcode );
 
 
 class CircuitInstruction {
@@ -60,7 +112,10 @@ public:
 	FieldT constant;
 	InputWires inputs;
 	OutputWires outputs;
-	std::vector<FieldT> table;
+	TableValues table;
+
+	/** First of the consecutive variables holding the intermediate values of a split table */
+	size_t auxIndex = 0;
 
 	const char *name() const;
 	void print() const;
@@ -69,7 +124,23 @@ public:
 
 class CircuitReader : public GadgetT {
 public:
-	CircuitReader(ProtoboardT& in_pb, const char* arithFilepath, const char* inputsFilepath, bool in_traceEnabled=false);
+	/**
+	* Version of the constraints emitted for a circuit, part of the key of the
+	* constraint system cache. Bump it whenever the same circuit would give
+	* different constraints or variables, e.g. linear gates being folded.
+	*/
+	static const uint32_t CONSTRAINT_LAYOUT_VERSION = 2;
+
+	/**
+	* With `in_witnessOnly` the variables are allocated and evaluated as usual
+	* but no constraints are emitted, for when the constraint system is loaded
+	* from a cache instead.
+	*
+	* With `in_profile` the constraints, variables and terms made by each
+	* opcode, and the time spent evaluating it, are added to the profile.
+	* The instructions are then evaluated one at a time.
+	*/
+	CircuitReader(ProtoboardT& in_pb, const char* arithFilepath, const char* inputsFilepath, bool in_traceEnabled=false, bool in_witnessOnly=false, CSProfile* in_profile=nullptr);
 
 	int getNumInputs() const {
 		return numInputs;
@@ -89,6 +160,31 @@ public:
 
 	void parseInputs( const char *inputsFilepath );
 
+	/**
+	* Load a new set of inputs and re-compute every wire in the circuit, the
+	* constraints are left as-is so the circuit can be evaluated many times.
+	*/
+	void evalInputs( const char *inputsFilepath );
+
+	/**
+	* Convert a `.arith` circuit into the binary format, which the
+	* constructor accepts in its place and parses much faster.
+	*/
+	static bool convertCircuit( const char *arithFilepath, const char *binFilepath );
+
+	/**
+	* Convert a jsnark inputs file into the binary format, which
+	* `parseInputs` and `evalInputs` accept in its place.
+	*/
+	static bool convertInputs( const char *inputsFilepath, const char *binFilepath );
+
+	/**
+	* Constraints made for a `table` with `n_bits` inputs. Tables of 1 and 2
+	* bits are a single constraint, larger tables are split, see
+	* addSplitTableConstraints.
+	*/
+	static size_t tableConstraints( size_t n_bits );
+
 	void varSet( Wire wire_id, const FieldT& value, const std::string &annotation="" );
 	FieldT varValue( Wire wire_id );
 	bool varExists( Wire wire_id );
@@ -96,14 +192,56 @@ public:
 	const VariableT& varGet( Wire wire_id, const std::string &annotation="");
 
 	bool traceEnabled;
+	bool witnessOnly;
+	CSProfile* profile;
 
 protected:
-	std::map<Wire,VariableT> variableMap;
-
-	std::vector<ZeroEqualityItem> zerop_items;
+	/** Only parses, for `convertCircuit` */
+	CircuitReader(ProtoboardT& in_pb);
+
+	/**
+	* Variable for each wire id, indexed by wire. Index 0 is the constant
+	* term so a default VariableT marks a wire without a variable yet.
+	*
+	* After parsing it covers every wire used by an instruction, so it
+	* doesn't grow, and references into it stay valid, while they're made.
+	*/
+	std::vector<VariableT> wireVariables;
+
+	/**
+	* The outputs of `add`, `const-mul` and `const-mul-neg` gates are kept as
+	* linear combinations of other wires, instead of as a variable and a
+	* constraint each, and are folded into the constraints which use them.
+	*
+	* Indexed by wire, 0 when the wire isn't folded, otherwise one more than
+	* the index of its terms in `foldedTerms`.
+	*/
+	std::vector<uint32_t> wireFolds;
+	std::vector<WireTerms> foldedTerms;
+	std::vector<WireTerm> termPool;
 
 	std::vector<CircuitInstruction> instructions;
 
+	/**
+	* The instructions compiled for evaluation, in level order. Each record is
+	* `opcode n_in n_out constant operand[n_in + n_out]`, where an operand is
+	* a variable index or, for a folded wire, the offset of its terms in
+	* `foldTape` as `n_terms (variable constant)[n_terms]`. Constants are
+	* indices into `constants`, a table's values are consecutive. The record
+	* of a split table ends with its `auxIndex`.
+	*/
+	std::vector<uint32_t> tape;
+	std::vector<uint32_t> foldTape;
+	std::vector<FieldT> constants;
+
+	/** Where each record starts in `tape` */
+	std::vector<size_t> tapeOffsets;
+
+	/** Where each level starts in `tapeOffsets`, followed by the end */
+	std::vector<size_t> evalLevels;
+	std::vector<Wire> instructionWires;
+	std::vector<FieldT> tableValues;
+
 	std::vector<Wire> inputWireIds;
 	std::vector<Wire> nizkWireIds;
 	std::vector<Wire> outputWireIds;
@@ -114,8 +252,24 @@ protected:
 	size_t numOutputs{0};
 
 	void parseCircuit(const char* arithFilepath);
-	void evalInstruction( const CircuitInstruction &inst );
+	void parseTextCircuit(const char* arithFilepath);
+	bool parseBinaryCircuit(const char* binFilepath);
+	bool parseBinaryInputs(const char* binFilepath);
+	bool writeBinaryCircuit(const char* binFilepath) const;
+	void addDeclaration( uint32_t kind, Wire wire_id );
+	InputWires addWires( const std::vector<Wire>& wires );
+	void foldLinearGates( );
+	bool isFolded( Wire wire_id ) const;
+	void addTerms( LinearCombinationT& lc, Wire wire_id, const FieldT& scale, const std::string &annotation="" );
+	LinearCombinationT varLC( Wire wire_id, const std::string &annotation="" );
+	void allocateWires( );
+	void levelInstructions( std::vector<size_t>& order );
+	void compileTape( );
+	uint32_t internConstant( const FieldT& value, std::map<std::string, uint32_t>& interned );
+	FieldT tapeValue( uint32_t operand );
+	void evalTape( size_t offset );
 	void makeAllConstraints( );
+	void addConstraint( const ConstraintT& constraint, const std::string& annotation );
 	void makeConstraints( const CircuitInstruction& inst );
 	void addOperationConstraints( const char *type, const InputWires& inWires, const OutputWires& outWires );
 
@@ -130,7 +284,8 @@ protected:
 	void addPackConstraint(const InputWires& inputs, const OutputWires& outputs);
 	void addNonzeroCheckConstraint(const InputWires& inputs, const OutputWires& outputs);
 
-	void addTableConstraint(const InputWires& inputs, const OutputWires& outputs, const std::vector<FieldT> table);
+	void addTableConstraint(const InputWires& inputs, const OutputWires& outputs, const TableValues& table, size_t auxIndex);
+	void addSplitTableConstraints(const InputWires& inputs, const OutputWires& outputs, const TableValues& table, size_t auxIndex);
 
 	void handleAddition(const InputWires& inputs, const OutputWires& outputs);
 	void handleMulConst(const InputWires& inputs, const OutputWires& outputs, const FieldT& constant);
@@ -4,7 +4,6 @@
 #include "circuit_reader.hpp"
 #include "stubs.hpp"
 
-using ethsnarks::ppT;
 using ethsnarks::CircuitReader;
 using ethsnarks::ProtoboardT;
 
@@ -17,7 +16,7 @@ using std::endl;
 int main(int argc, char **argv)
 {
 	ProtoboardT pb;
-	ppT::init_public_params();
+	ethsnarks::stub_init_public_params();
 
 	const string usage(string("Usage: ") + argv[0] + " <circuit.arith> <circuit.input>");
 
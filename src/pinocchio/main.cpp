@@ -3,42 +3,179 @@
 
 #include "circuit_reader.hpp"
 #include "stubs.hpp"
+#include "prover_profile.hpp"
+#include "cs_cache.hpp"
+#include "cs_optimize.hpp"
+#include "cs_memory.hpp"
+#include "cs_check.hpp"
+#include "export.hpp"
+#include "prover_shard.hpp"
+#include "prover_cache.hpp"
+#include "prover_metrics.hpp"
+#include "witness_ring.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <future>
+#include <memory>
+#include <sstream>
+
+#include <dirent.h>
+#include <sys/stat.h>
 
 using ethsnarks::ppT;
 using ethsnarks::CircuitReader;
 using ethsnarks::ProtoboardT;
 using ethsnarks::stub_prove_from_pb;
 using ethsnarks::stub_genkeys_from_pb;
+using ethsnarks::stub_genkeys_prepare;
+using ethsnarks::stub_genkeys_worker;
+using ethsnarks::stub_genkeys_assemble;
 using ethsnarks::stub_main_verify;
+using ethsnarks::ProvingKeyT;
+using ethsnarks::ProverContextT;
+using ethsnarks::FieldT;
 
 using std::ofstream;
+using std::ifstream;
 using std::cout;
 using std::cerr;
 using std::endl;
 using std::string;
 
 
-static int main_genkeys( ProtoboardT& pb, const char *arith_file, const char *pk_raw, const char *vk_json )
+/**
+* With `--optimize` keys are made for, and proofs made with, the optimized
+* constraint system. Its witness is the circuit's, mapped to the new layout.
+* With `--reorder` the variables are then renumbered, see cs_reorder.
+*/
+static ProtoboardT& optimize_protoboard( ProtoboardT& pb, ProtoboardT& optimized, bool optimize, bool reorder )
+{
+	if( ! optimize && ! reorder ) {
+		return pb;
+	}
+
+	ethsnarks::CSRemap remap;
+	if( optimize ) {
+		ethsnarks::cs_optimize(pb.constraint_system, optimized.constraint_system, remap);
+		ethsnarks::cs_remap_assignment(remap, pb.values, optimized.values);
+
+		cerr << "Optimized: removed " << remap.removed_constraints << " constraints and "
+			 << remap.removed_variables << " variables, "
+			 << optimized.num_constraints() << " constraints remain" << endl;
+	}
+	else {
+		optimized.constraint_system = pb.constraint_system;
+		optimized.values = pb.values;
+	}
+
+	if( reorder ) {
+		ethsnarks::ConstraintSystemT reordered;
+		std::vector<FieldT> values;
+		ethsnarks::cs_reorder(optimized.constraint_system, reordered, remap);
+		ethsnarks::cs_remap_assignment(remap, optimized.values, values);
+		optimized.constraint_system = std::move(reordered);
+		optimized.values = std::move(values);
+	}
+
+	return optimized;
+}
+
+
+static int main_genkeys( ProtoboardT& pb, const char *arith_file, const char *pk_raw, const char *vk_json, bool optimize, bool reorder, bool lagrange_H )
 {
 	CircuitReader circuit(pb, arith_file, nullptr);
 
-	if( ! pb.is_satisfied() ) {
+	if( ! ethsnarks::cs_check_protoboard(pb) ) {
 		cerr << "Error: not satisfied!" << endl;
 	}
 
-	return stub_genkeys_from_pb(pb, pk_raw, vk_json);
+	ProtoboardT optimized;
+	return stub_genkeys_from_pb(optimize_protoboard(pb, optimized, optimize, reorder), pk_raw, vk_json, lagrange_H);
 }
 
 
-static int main_prove( ProtoboardT& pb, const char *arith_file, const char *circuit_inputs, const char* pk_raw, const char *proof_json )
+/**
+* The first step of distributed key generation, the setup directory is
+* created only readable by its owner as it holds the toxic waste
+*/
+static int main_genkeys_prepare( ProtoboardT& pb, const char *arith_file, const char *setup_dir, size_t segment_size, bool optimize, bool reorder, bool lagrange_H )
 {
-	CircuitReader circuit(pb, arith_file, circuit_inputs);
+	if( ::mkdir(setup_dir, 0700) != 0 && errno != EEXIST ) {
+		cerr << "Error: cannot create " << setup_dir << endl;
+		return 1;
+	}
+
+	CircuitReader circuit(pb, arith_file, nullptr);
+
+	ProtoboardT optimized;
+	return stub_genkeys_prepare(optimize_protoboard(pb, optimized, optimize, reorder), setup_dir, segment_size, lagrange_H);
+}
+
+
+static int main_genkeys_assemble( ProtoboardT& pb, const char *arith_file, const char *setup_dir, const char *pk_raw, const char *vk_json, bool optimize, bool reorder )
+{
+	CircuitReader circuit(pb, arith_file, nullptr);
+
+	ProtoboardT optimized;
+	return stub_genkeys_assemble(optimize_protoboard(pb, optimized, optimize, reorder), setup_dir, pk_raw, vk_json);
+}
+
+
+/**
+* Load the circuit and compute the witness for the inputs. When the circuit's
+* constraint system cache is valid no constraints are emitted, the cached
+* ones are used instead, otherwise the cache is written for the next proof.
+*
+* The inputs must be given, evaluating them allocates the wires in the same
+* order as when the constraints are made.
+*/
+static std::unique_ptr<CircuitReader> load_circuit_for_proving( ProtoboardT& pb, const char *arith_file, const char *circuit_inputs )
+{
+	uint8_t hash[ethsnarks::CS_CACHE_HASH_SIZE];
+	const string cache_file = ethsnarks::cs_cache_path(arith_file);
+	const bool have_hash = ethsnarks::cs_cache_hash_file(arith_file, hash, CircuitReader::CONSTRAINT_LAYOUT_VERSION);
+
+	ethsnarks::ConstraintSystemT cs;
+	if( have_hash && ethsnarks::cs_cache_load(cache_file.c_str(), hash, cs) )
+	{
+		std::unique_ptr<CircuitReader> circuit(new CircuitReader(pb, arith_file, circuit_inputs, false, true));
+
+		if( cs.primary_input_size == pb.constraint_system.primary_input_size
+		 && cs.auxiliary_input_size == pb.constraint_system.auxiliary_input_size ) {
+			pb.constraint_system = std::move(cs);
+			return circuit;
+		}
+
+		cerr << "Warning: ignoring mismatched " << cache_file << endl;
+		circuit.reset();
+		pb = ProtoboardT();
+	}
+
+	std::unique_ptr<CircuitReader> circuit(new CircuitReader(pb, arith_file, circuit_inputs));
+
+	if( have_hash && ! ethsnarks::cs_cache_save(cache_file.c_str(), hash, pb.constraint_system) ) {
+		cerr << "Warning: cannot write " << cache_file << endl;
+	}
+
+	return circuit;
+}
+
 
-	if( ! pb.is_satisfied() ) {
+static int main_prove( ProtoboardT& pb, const char *arith_file, const char *circuit_inputs, const char* pk_raw, const char *proof_json, bool optimize, bool reorder )
+{
+	const auto circuit = load_circuit_for_proving(pb, arith_file, circuit_inputs);
+
+	if( ! ethsnarks::cs_check_protoboard(pb) ) {
 		cerr << "Error: not satisfied!" << endl;
 	}
 
-    auto json = stub_prove_from_pb(pb, pk_raw);
+	ProtoboardT optimized;
+    auto json = stub_prove_from_pb(optimize_protoboard(pb, optimized, optimize, reorder), pk_raw, ethsnarks::is_binary_path(proof_json), arith_file);
 
     ofstream fh;
     fh.open(proof_json, std::ios::binary);
@@ -50,11 +187,12 @@ static int main_prove( ProtoboardT& pb, const char *arith_file, const char *circ
 }
 
 
-static int main_test( ProtoboardT& pb, const char *arith_file, const char *circuit_inputs )
+static int main_test( ProtoboardT& pb, const char *arith_file, const char *circuit_inputs, bool optimize, bool reorder )
 {
 	CircuitReader circuit(pb, arith_file, circuit_inputs);
 
-	if( ! ethsnarks::stub_test_proof_verify(pb) ) {
+	ProtoboardT optimized;
+	if( ! ethsnarks::stub_test_proof_verify(optimize_protoboard(pb, optimized, optimize, reorder)) ) {
 		cerr << "Error: failed to test!" << endl;
 		return  2;
 	}
@@ -63,11 +201,639 @@ static int main_test( ProtoboardT& pb, const char *arith_file, const char *circu
 }
 
 
+/**
+* Load the circuit, proving key and prover context once, then read requests
+* from stdin, one per line:
+*
+*	<circuit.inputs> <output-proof.json>
+*
+* Each request is answered on stdout with either `OK <output-proof.json>` or
+* `ERROR <reason>`. This keeps the proving key and evaluation domain warm
+* between proofs, the pipe can be bound to a socket with e.g. socat.
+*
+* With `cache_entries` the proofs of that many recent witnesses are kept, for
+* at most `cache_ttl` seconds if non-zero, and a repeated witness is answered
+* from the cache. With `rerandomize` every proof is re-randomized, so
+* repeated answers can't be linked to each other.
+*
+* With ETHSNARKS_METRICS_PORT set, the proofs, their per-phase latencies,
+* the cache and the proving key are exported on that port in the
+* Prometheus text format, see prover_metrics.hpp.
+*/
+static int main_serve( ProtoboardT& pb, const char *arith_file, const char *pk_raw, size_t cache_entries, unsigned int cache_ttl, bool rerandomize )
+{
+	CircuitReader circuit(pb, arith_file, nullptr);
+
+	libsnark::Config config;
+	ethsnarks::load_prover_config(pk_raw, ethsnarks::circuit_name_from_path(arith_file), pb, config);
+
+	auto pk = ethsnarks::load_proving_key(pk_raw, config.huge_pages);
+	ProverContextT context(pk);
+	ethsnarks::init_prover_context(context, pb, config, ethsnarks::fixed_base_table_path(pk_raw, config).c_str());
+
+	ethsnarks::ProofCache cache(pk, cache_entries, cache_ttl);
+
+	ethsnarks::ProverMetrics metrics(config.num_threads);
+	metrics.add_proof_cache(cache);
+	metrics.add_proving_key(pk);
+
+	// Requests are answered one at a time, so at most one is queued
+	metrics.add_gauge("ethsnarks_prover_queue_depth", "Proofs waiting to be admitted", [](){ return 0.0; });
+
+	libsnark::ProverStats stats;
+	std::unique_ptr<ethsnarks::MetricsServer> metrics_server;
+	const char *metrics_port = ::getenv("ETHSNARKS_METRICS_PORT");
+	if( metrics_port != nullptr ) {
+		metrics_server.reset(new ethsnarks::MetricsServer(metrics, std::stoul(metrics_port)));
+		if( ! metrics_server->listening() ) {
+			return 1;
+		}
+		context.stats = &stats;
+		cerr << "Metrics on port " << metrics_server->port() << endl;
+	}
+
+	string line;
+	while( getline(std::cin, line) )
+	{
+		if( line.length() == 0 ) {
+			continue;
+		}
+
+		std::istringstream request(line);
+		string circuit_inputs;
+		string proof_json;
+		if( ! (request >> circuit_inputs >> proof_json) ) {
+			cout << "ERROR expected <circuit.inputs> <output-proof.json>" << endl;
+			continue;
+		}
+
+		if( ! ifstream(circuit_inputs).good() ) {
+			cout << "ERROR cannot open " << circuit_inputs << endl;
+			continue;
+		}
+
+		metrics.begin_proof();
+		const auto wall_start = std::chrono::steady_clock::now();
+		const auto cpu_start = std::clock();
+
+		circuit.evalInputs(circuit_inputs.c_str());
+
+		if( ! ethsnarks::cs_check_protoboard(pb) ) {
+			metrics.record_error();
+			cout << "ERROR not satisfied " << circuit_inputs << endl;
+			continue;
+		}
+
+		ofstream fh(proof_json, std::ios::binary);
+		if( ! fh.good() ) {
+			metrics.record_error();
+			cout << "ERROR cannot open " << proof_json << endl;
+			continue;
+		}
+
+		// A cached proof leaves the stats without phases
+		stats.clear();
+		auto proof = ethsnarks::prove_cached(context, cache, pb.values, rerandomize);
+		fh << (ethsnarks::is_binary_path(proof_json) ? ethsnarks::proof_to_bytes(proof, context.primary_input)
+		                                              : ethsnarks::proof_to_json(proof, context.primary_input));
+		fh.close();
+
+		metrics.record_proof(std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count(),
+		                     double(std::clock() - cpu_start) / CLOCKS_PER_SEC,
+		                     context.stats);
+
+		cout << "OK " << proof_json << endl;
+	}
+
+	return 0;
+}
+
+
+struct BatchJob {
+	string inputs;
+	string proof;
+};
+
+
+static bool is_directory( const char *path )
+{
+	struct stat st;
+	return 0 == ::stat(path, &st) && S_ISDIR(st.st_mode);
+}
+
+
+/**
+* Either every file in a directory, in name order, with the proofs written to
+* `output_dir` as `<name>.proof.json`. Or a manifest file with one job per
+* line, as `<circuit.inputs>`, or `<circuit.inputs> <output-proof.json>`.
+*/
+static bool read_batch_jobs( const char *source, const char *output_dir, std::vector<BatchJob>& jobs )
+{
+	if( is_directory(source) )
+	{
+		if( output_dir == nullptr ) {
+			cerr << "Error: an output directory is needed for " << source << endl;
+			return false;
+		}
+
+		DIR *dir = ::opendir(source);
+		if( dir == nullptr ) {
+			cerr << "Error: cannot open " << source << endl;
+			return false;
+		}
+
+		std::vector<string> names;
+		while( const struct dirent *entry = ::readdir(dir) ) {
+			const string path = string(source) + "/" + entry->d_name;
+			if( entry->d_name[0] != '.' && ! is_directory(path.c_str()) ) {
+				names.push_back(entry->d_name);
+			}
+		}
+		::closedir(dir);
+
+		std::sort(names.begin(), names.end());
+		for( const auto& name : names ) {
+			jobs.push_back({string(source) + "/" + name, string(output_dir) + "/" + name + ".proof.json"});
+		}
+		return true;
+	}
+
+	ifstream manifest(source);
+	if( ! manifest.good() ) {
+		cerr << "Error: cannot open " << source << endl;
+		return false;
+	}
+
+	string line;
+	while( getline(manifest, line) )
+	{
+		std::istringstream request(line);
+		BatchJob job;
+		if( ! (request >> job.inputs) || job.inputs[0] == '#' ) {
+			continue;
+		}
+
+		if( ! (request >> job.proof) ) {
+			if( output_dir == nullptr ) {
+				cerr << "Error: no proof file or output directory for " << job.inputs << endl;
+				return false;
+			}
+			const auto slash = job.inputs.rfind('/');
+			job.proof = string(output_dir) + "/" + job.inputs.substr(slash == string::npos ? 0 : slash + 1) + ".proof.json";
+		}
+		jobs.push_back(job);
+	}
+
+	return true;
+}
+
+
+/** Witnesses evaluated together, then proven by one call of the batch prover */
+static const size_t PROVE_BATCH_SIZE = 4;
+
+
+struct BatchWitness {
+	string error;
+	std::vector<FieldT> values;
+};
+
+
+/**
+* Load the circuit, proving key and prover context once, then prove the jobs
+* in chunks of PROVE_BATCH_SIZE. The witnesses of a chunk are evaluated at the
+* same time, each with its own reader and protoboard, and the chunk is proven
+* with r1cs_gg_ppzksnark_zok_prover_batch. The next chunk is evaluated while
+* the current one is proven, so the prover is never left waiting for it.
+*
+* Like `serve`, each job is reported on stdout as `OK <output-proof.json>` or
+* `ERROR <reason>`, the other jobs continue after a failure.
+*/
+static int main_prove_batch( ProtoboardT& pb, const char *arith_file, const char *source, const char *pk_raw, const char *output_dir )
+{
+	std::vector<BatchJob> jobs;
+	if( ! read_batch_jobs(source, output_dir, jobs) ) {
+		return 3;
+	}
+
+	CircuitReader circuit(pb, arith_file, nullptr);
+
+	libsnark::Config config;
+	ethsnarks::load_prover_config(pk_raw, ethsnarks::circuit_name_from_path(arith_file), pb, config);
+
+	auto pk = ethsnarks::load_proving_key(pk_raw, config.huge_pages);
+	ProverContextT context(pk);
+	ethsnarks::init_prover_context(context, pb, config, ethsnarks::fixed_base_table_path(pk_raw, config).c_str());
+
+	// The evaluators only have the variables, the witnesses are checked
+	// against the constraints of `pb`
+	const size_t chunk_size = std::min(PROVE_BATCH_SIZE, jobs.size());
+	std::vector<std::unique_ptr<ProtoboardT>> boards;
+	std::vector<std::unique_ptr<CircuitReader>> evaluators;
+	for( size_t j = 0; j < chunk_size; j++ ) {
+		boards.emplace_back(new ProtoboardT);
+		evaluators.emplace_back(new CircuitReader(*boards.back(), arith_file, nullptr, false, true));
+	}
+
+	// Evaluates the chunk of jobs starting at `begin`, one per evaluator
+	const auto evaluate = [&]( size_t begin, std::vector<BatchWitness>& witnesses ) {
+		witnesses.assign(std::min(chunk_size, jobs.size() - begin), BatchWitness());
+
+		std::vector<std::future<void>> pending;
+		for( size_t j = 0; j < witnesses.size(); j++ )
+		{
+			pending.push_back(std::async(std::launch::async, [&, j] {
+				const auto& job = jobs[begin + j];
+				auto& witness = witnesses[j];
+				if( ! ifstream(job.inputs).good() ) {
+					witness.error = "cannot open " + job.inputs;
+					return;
+				}
+
+				evaluators[j]->evalInputs(job.inputs.c_str());
+
+				// One thread each, the chunk's witnesses are checked side by side
+				const auto& values = boards[j]->values;
+				if( ethsnarks::cs_first_unsatisfied(pb.constraint_system, values, 1) != pb.constraint_system.num_constraints() ) {
+					witness.error = "not satisfied " + job.inputs;
+					return;
+				}
+				witness.values.assign(values.begin(), values.end());
+			}));
+		}
+
+		for( auto& evaluation : pending ) {
+			evaluation.get();
+		}
+	};
+
+	std::vector<BatchWitness> current;
+	std::vector<BatchWitness> next;
+	std::future<void> pending;
+	if( jobs.size() ) {
+		pending = std::async(std::launch::async, evaluate, size_t(0), std::ref(next));
+	}
+
+	const size_t primary_size = pb.constraint_system.primary_input_size;
+	int failures = 0;
+	for( size_t begin = 0; begin < jobs.size(); begin += chunk_size )
+	{
+		pending.get();
+		std::swap(current, next);
+
+		// The evaluators are only used by the evaluating thread
+		if( begin + chunk_size < jobs.size() ) {
+			pending = std::async(std::launch::async, evaluate, begin + chunk_size, std::ref(next));
+		}
+
+		std::vector<size_t> proven;
+		std::vector<std::vector<FieldT>> assignments;
+		for( size_t j = 0; j < current.size(); j++ )
+		{
+			if( current[j].error.size() ) {
+				continue;
+			}
+			proven.push_back(j);
+			assignments.push_back(std::move(current[j].values));
+		}
+
+		std::vector<ethsnarks::ProofT> proofs;
+		if( assignments.size() )
+		{
+			try {
+				proofs = libsnark::r1cs_gg_ppzksnark_zok_prover_batch<ppT>(context, assignments);
+			}
+			catch( const std::exception& ex ) {
+				// Already checked, so this fails the whole chunk
+				for( const size_t j : proven ) {
+					current[j].error = string("proving ") + jobs[begin + j].inputs + ": " + ex.what();
+				}
+				proven.clear();
+			}
+		}
+
+		// Reported in job order
+		for( size_t j = 0, k = 0; j < current.size(); j++ )
+		{
+			const auto& job = jobs[begin + j];
+			if( current[j].error.size() ) {
+				cout << "ERROR " << current[j].error << endl;
+				failures++;
+				continue;
+			}
+
+			const auto& values = assignments[k];
+			const auto& proof = proofs[k++];
+			const ethsnarks::PrimaryInputT primary_input(values.begin() + 1, values.begin() + 1 + primary_size);
+
+			ofstream fh(job.proof, std::ios::binary);
+			if( ! fh.good() ) {
+				cout << "ERROR cannot open " << job.proof << endl;
+				failures++;
+				continue;
+			}
+			fh << (ethsnarks::is_binary_path(job.proof) ? ethsnarks::proof_to_bytes(proof, primary_input)
+			                                            : ethsnarks::proof_to_json(proof, primary_input));
+			fh.close();
+
+			cout << "OK " << job.proof << endl;
+		}
+	}
+
+	return failures ? 2 : 0;
+}
+
+
+/**
+* Load the proving key once, then prove every witness the `witness-worker`
+* processes put in the shared-memory ring, until they have all finished.
+* Workers are started separately, as many as the witnesses need to keep the
+* prover busy, and the prover keeps every thread it is configured with.
+*
+* Like `serve`, each job is reported on stdout as `OK <output-proof.json>` or
+* `ERROR <reason>`.
+*/
+static int main_serve_ring( ProtoboardT& pb, const char *arith_file, const char *pk_raw, const char *ring_name, size_t num_slots )
+{
+	CircuitReader circuit(pb, arith_file, nullptr);
+
+	libsnark::Config config;
+	ethsnarks::load_prover_config(pk_raw, ethsnarks::circuit_name_from_path(arith_file), pb, config);
+
+	auto pk = ethsnarks::load_proving_key(pk_raw, config.huge_pages);
+	ProverContextT context(pk);
+	ethsnarks::init_prover_context(context, pb, config, ethsnarks::fixed_base_table_path(pk_raw, config).c_str());
+
+	// Created after the key is loaded, so workers only start once it's ready
+	auto ring = ethsnarks::WitnessRing::create(ring_name, num_slots, pb.values.size());
+	if( ! ring ) {
+		return 1;
+	}
+	cerr << "Witness ring " << ring_name << " of " << ring->num_slots() << " slots" << endl;
+
+	ethsnarks::ProverMetrics metrics(config.num_threads);
+	metrics.add_proving_key(pk);
+	metrics.add_gauge("ethsnarks_prover_queue_depth", "Proofs waiting to be admitted", [&ring](){ return double(ring->num_ready()); });
+
+	libsnark::ProverStats stats;
+	std::unique_ptr<ethsnarks::MetricsServer> metrics_server;
+	const char *metrics_port = ::getenv("ETHSNARKS_METRICS_PORT");
+	if( metrics_port != nullptr ) {
+		metrics_server.reset(new ethsnarks::MetricsServer(metrics, std::stoul(metrics_port)));
+		if( ! metrics_server->listening() ) {
+			return 1;
+		}
+		context.stats = &stats;
+		cerr << "Metrics on port " << metrics_server->port() << endl;
+	}
+
+	std::vector<FieldT> values;
+	string proof_path;
+	while( ring->pop(values, proof_path) )
+	{
+		metrics.begin_proof();
+		const auto wall_start = std::chrono::steady_clock::now();
+		const auto cpu_start = std::clock();
+
+		ofstream fh(proof_path, std::ios::binary);
+		if( ! fh.good() ) {
+			metrics.record_error();
+			cout << "ERROR cannot open " << proof_path << endl;
+			continue;
+		}
+
+		stats.clear();
+		fh << ethsnarks::prove_assignment(context, values, ethsnarks::is_binary_path(proof_path));
+		fh.close();
+
+		metrics.record_proof(std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count(),
+		                     double(std::clock() - cpu_start) / CLOCKS_PER_SEC,
+		                     context.stats);
+
+		cout << "OK " << proof_path << endl;
+	}
+
+	return 0;
+}
+
+
+/**
+* Evaluate the witness of every job, as for `prove-batch`, and hand each to
+* the `serve-ring` prover through its ring. Jobs which fail are reported on
+* stdout as `ERROR <reason>`, the others as `QUEUED <output-proof.json>`.
+*/
+static int main_witness_worker( ProtoboardT& pb, const char *arith_file, const char *ring_name, const char *source, const char *output_dir )
+{
+	std::vector<BatchJob> jobs;
+	if( ! read_batch_jobs(source, output_dir, jobs) ) {
+		return 3;
+	}
+
+	CircuitReader circuit(pb, arith_file, nullptr);
+
+	auto ring = ethsnarks::WitnessRing::attach(ring_name);
+	if( ! ring ) {
+		return 1;
+	}
+	if( ring->num_values() != pb.values.size() ) {
+		cerr << "Error: the prover expects " << ring->num_values() << " values, " << arith_file << " has " << pb.values.size() << endl;
+		return 1;
+	}
+
+	int failures = 0;
+	for( const auto& job : jobs )
+	{
+		if( ! ifstream(job.inputs).good() ) {
+			cout << "ERROR cannot open " << job.inputs << endl;
+			failures++;
+			continue;
+		}
+
+		circuit.evalInputs(job.inputs.c_str());
+
+		if( ! ethsnarks::cs_check_protoboard(pb) ) {
+			cout << "ERROR not satisfied " << job.inputs << endl;
+			failures++;
+			continue;
+		}
+
+		if( ! ring->push(pb.values, job.proof) ) {
+			cout << "ERROR the prover has closed " << ring_name << endl;
+			return 2;
+		}
+
+		cout << "QUEUED " << job.proof << endl;
+	}
+
+	return failures ? 2 : 0;
+}
+
+
+/**
+* Benchmark a sweep of prover parameters using a real witness, then save the
+* fastest configuration as the profile for this proving key on this host,
+* `prove` and `serve` load it automatically.
+*/
+static int main_tune( ProtoboardT& pb, const char *arith_file, const char *circuit_inputs, const char *pk_raw )
+{
+	CircuitReader circuit(pb, arith_file, circuit_inputs);
+
+	if( ! ethsnarks::cs_check_protoboard(pb) ) {
+		cerr << "Error: not satisfied!" << endl;
+		return 2;
+	}
+
+	auto pk = ethsnarks::load_proving_key(pk_raw);
+	ProverContextT context(pk);
+	ethsnarks::init_prover_context(context, pb);
+
+	double seconds = 0;
+	const auto best = ethsnarks::tune_prover_config(context, pb, seconds);
+	cerr << "Best (" << seconds << "s): " << best << endl;
+
+	if( ! ethsnarks::save_prover_profile(pk_raw, pb.num_constraints(), best, seconds) ) {
+		cerr << "Error: cannot write " << ethsnarks::prover_profile_path(pk_raw) << endl;
+		return 3;
+	}
+
+	cout << ethsnarks::prover_profile_path(pk_raw) << endl;
+
+	return 0;
+}
+
+
+static int main_compile( const char *arith_file, const char *bin_file )
+{
+	if( ! CircuitReader::convertCircuit(arith_file, bin_file) ) {
+		cerr << "Error: cannot write " << bin_file << endl;
+		return 3;
+	}
+
+	return 0;
+}
+
+
+static int main_compile_inputs( const char *circuit_inputs, const char *bin_file )
+{
+	if( ! CircuitReader::convertInputs(circuit_inputs, bin_file) ) {
+		cerr << "Error: cannot write " << bin_file << endl;
+		return 3;
+	}
+
+	return 0;
+}
+
+
+/**
+* Evaluate the circuit with the inputs and write what each opcode costs, in
+* constraints, variables, terms and witness time, to the report file
+*/
+static int main_profile( ProtoboardT& pb, const char *arith_file, const char *circuit_inputs, const char *report_file )
+{
+	ethsnarks::CSProfile profile;
+	CircuitReader circuit(pb, arith_file, circuit_inputs, false, false, &profile);
+
+	if( ! ethsnarks::cs_check_protoboard(pb) ) {
+		cerr << "Error: not satisfied!" << endl;
+	}
+
+	if( ! ethsnarks::cs_profile_write(profile, report_file) ) {
+		cerr << "Error: cannot write " << report_file << endl;
+		return 3;
+	}
+
+	return 0;
+}
+
+
+/**
+* Print what the circuit costs in memory, as JSON. The circuit's constraint
+* system cache is used when it's valid, otherwise the circuit is loaded
+* without inputs. The proving key is projected, or measured when given.
+*/
+static int main_memory( ProtoboardT& pb, const char *arith_file, const char *pk_raw, unsigned int fixed_base_c )
+{
+	ethsnarks::CSMemoryReport report;
+
+	uint8_t hash[ethsnarks::CS_CACHE_HASH_SIZE];
+	const string cache_file = ethsnarks::cs_cache_path(arith_file);
+	ethsnarks::ConstraintSystemT cs;
+	if( ethsnarks::cs_cache_hash_file(arith_file, hash, CircuitReader::CONSTRAINT_LAYOUT_VERSION) && ethsnarks::cs_cache_load(cache_file.c_str(), hash, cs) )
+	{
+		ethsnarks::cs_memory_constraints(cs, report);
+		report.value_bytes = cs.num_variables() * sizeof(FieldT);
+	}
+	else {
+		CircuitReader circuit(pb, arith_file, nullptr);
+		ethsnarks::cs_memory_protoboard(pb, report);
+	}
+
+	ethsnarks::cs_memory_project(report, 0, fixed_base_c);
+
+	if( pk_raw ) {
+		ethsnarks::cs_memory_proving_key(ethsnarks::load_proving_key(pk_raw), report);
+	}
+
+	ethsnarks::cs_memory_json(report, cout);
+
+	return 0;
+}
+
+
+static int main_split_pk( const char *pk_file, size_t num_shards, const char *prefix )
+{
+	return ethsnarks::pk_split(pk_file, num_shards, prefix) ? 0 : 3;
+}
+
+
+/**
+* A worker of prove-distributed, see prover_shard.hpp. With a port it
+* listens for the coordinator on `bind_address`, otherwise requests are read
+* from stdin. Jobs are files in the directory of the shard prefix.
+*/
+static int main_serve_shard( const char *prefix, size_t index, unsigned int port, const char *bind_address )
+{
+	const auto shard_file = ethsnarks::prover_shard_path(prefix, index);
+
+	ethsnarks::ProverShardInfo info;
+	if( ! ethsnarks::load_shard_info(shard_file.c_str(), info) ) {
+		return 3;
+	}
+
+	auto pk = ethsnarks::load_proving_key(shard_file.c_str());
+	ProverContextT context(pk);
+
+	return ethsnarks::shard_serve(context, info, ethsnarks::shard_spool_dir(prefix).c_str(), port, bind_address);
+}
+
+
+static int main_prove_distributed( ProtoboardT& pb, const char *arith_file, const char *circuit_inputs, const char *prefix, const char *proof_file, const std::vector<string>& workers )
+{
+	CircuitReader circuit(pb, arith_file, circuit_inputs);
+
+	if( ! ethsnarks::cs_check_protoboard(pb) ) {
+		cerr << "Error: not satisfied!" << endl;
+		return 2;
+	}
+
+	ethsnarks::ProofT proof;
+	if( ! ethsnarks::prove_distributed(pb, prefix, workers, proof) ) {
+		return 3;
+	}
+
+	auto primary_input = pb.primary_input();
+	ofstream fh(proof_file, std::ios::binary);
+	fh << (ethsnarks::is_binary_path(proof_file) ? ethsnarks::proof_to_bytes(proof, primary_input) : ethsnarks::proof_to_json(proof, primary_input));
+	fh.close();
+
+	return fh.fail() ? 4 : 0;
+}
+
+
 static int main_eval( ProtoboardT& pb, const char *arith_file, const char *circuit_inputs, bool traceEnabled )
 {
 	CircuitReader circuit(pb, arith_file, circuit_inputs, traceEnabled);
 
-	if( ! pb.is_satisfied() ) {
+	if( ! ethsnarks::cs_check_protoboard(pb) ) {
 		cerr << "Error: not satisfied!" << endl;
 	}
 
@@ -85,29 +851,74 @@ static int main_eval( ProtoboardT& pb, const char *arith_file, const char *circu
 int main(int argc, char **argv)
 {
 	ProtoboardT pb;
-	ppT::init_public_params();
+	ethsnarks::stub_init_public_params();
 
 	const string progname(argv[0]);
 	const string usage_prefix(string("Usage: ") + progname + " <circuit.arith> ");
 	if( argc < 3 ) {
-		cerr << usage_prefix << "<genkeys|prove|verify|eval|trace|test>" << endl;
+		cerr << usage_prefix << "[--optimize] [--reorder] <genkeys|genkeys-prepare|genkeys-worker|genkeys-assemble|prove|prove-batch|serve|serve-ring|witness-worker|split-pk|serve-shard|prove-distributed|tune|compile|compile-inputs|verify|eval|trace|profile|memory|test>" << endl;
 		return 1;
 	}
 
 	const char *arith_file = argv[1];
+	bool optimize = false;
+	bool reorder = false;
+	while( argc >= 3 && (string(argv[2]) == "--optimize" || string(argv[2]) == "--reorder") ) {
+		if( string(argv[2]) == "--optimize" ) {
+			optimize = true;
+		}
+		else {
+			reorder = true;
+		}
+		argv++;
+		argc--;
+	}
+	if( (optimize || reorder) && argc < 3 ) {
+		cerr << usage_prefix << "[--optimize] [--reorder] <genkeys|genkeys-prepare|genkeys-assemble|prove|test>" << endl;
+		return 1;
+	}
 	const string cmd(argv[2]);
 
+	if( (optimize || reorder) && cmd != "genkeys" && cmd != "genkeys-prepare" && cmd != "genkeys-assemble" && cmd != "prove" && cmd != "test" ) {
+		cerr << "Error: --optimize and --reorder are only supported by genkeys, genkeys-prepare, genkeys-assemble, prove and test" << endl;
+		return 1;
+	}
+
 	int sub_argc = argc - 3;
 	const char **sub_argv = (const char**)&argv[3];
 
 	if( cmd == "genkeys" ) {
 		if( sub_argc < 2 ) {
-			cerr << usage_prefix << cmd << " <proving-key.raw> <verification-key.json>" << endl;
+			cerr << usage_prefix << cmd << " <proving-key.raw> <verification-key.json> [lagrange]" << endl;
 			return 5;
 		}
 		const char *pk_raw = sub_argv[0];
 		const char *vk_json = sub_argv[1];
-		return main_genkeys(pb, arith_file, pk_raw, vk_json );
+		const bool lagrange_H = sub_argc > 2 && string(sub_argv[2]) == "lagrange";
+		return main_genkeys(pb, arith_file, pk_raw, vk_json, optimize, reorder, lagrange_H);
+	}
+	else if( cmd == "genkeys-prepare" ) {
+		if( sub_argc < 1 ) {
+			cerr << usage_prefix << cmd << " <setup-dir> [lagrange] [segment-size]" << endl;
+			return 5;
+		}
+		const bool lagrange_H = sub_argc > 1 && string(sub_argv[1]) == "lagrange";
+		const size_t segment_size = sub_argc > 2 ? std::stoul(sub_argv[2]) : (1ul << 18);
+		return main_genkeys_prepare(pb, arith_file, sub_argv[0], segment_size, optimize, reorder, lagrange_H);
+	}
+	else if( cmd == "genkeys-worker" ) {
+		if( sub_argc < 3 ) {
+			cerr << usage_prefix << cmd << " <setup-dir> <index> <num-workers>" << endl;
+			return 5;
+		}
+		return stub_genkeys_worker(sub_argv[0], std::stoul(sub_argv[1]), std::stoul(sub_argv[2]));
+	}
+	else if( cmd == "genkeys-assemble" ) {
+		if( sub_argc < 3 ) {
+			cerr << usage_prefix << cmd << " <setup-dir> <proving-key.raw> <verification-key.json>" << endl;
+			return 5;
+		}
+		return main_genkeys_assemble(pb, arith_file, sub_argv[0], sub_argv[1], sub_argv[2], optimize, reorder);
 	}
 	else if( cmd == "prove" ) {
 		if( sub_argc < 3 ) {
@@ -117,7 +928,91 @@ int main(int argc, char **argv)
 		const char *circuit_inputs = sub_argv[0];
 		const char *pk_raw = sub_argv[1];
 		const char *proof_json = sub_argv[2];
-		return main_prove(pb, arith_file, circuit_inputs, pk_raw, proof_json );
+		return main_prove(pb, arith_file, circuit_inputs, pk_raw, proof_json, optimize, reorder);
+	}
+	else if( cmd == "prove-batch" ) {
+		if( sub_argc < 2 ) {
+			cerr << usage_prefix << cmd << " <inputs-dir|manifest> <proving-key.raw> [output-dir]" << endl;
+			return 5;
+		}
+		const char *source = sub_argv[0];
+		const char *pk_raw = sub_argv[1];
+		const char *output_dir = sub_argc > 2 ? sub_argv[2] : nullptr;
+		return main_prove_batch(pb, arith_file, source, pk_raw, output_dir);
+	}
+	else if( cmd == "serve" ) {
+		if( sub_argc < 1 ) {
+			cerr << usage_prefix << cmd << " <proving-key.raw> [cache-entries [cache-ttl-seconds [rerandomize]]]" << endl;
+			return 5;
+		}
+		const char *pk_raw = sub_argv[0];
+		const size_t cache_entries = sub_argc > 1 ? std::stoul(sub_argv[1]) : 0;
+		const unsigned int cache_ttl = sub_argc > 2 ? std::stoul(sub_argv[2]) : 0;
+		const bool rerandomize = sub_argc > 3 && string(sub_argv[3]) == "rerandomize";
+		return main_serve(pb, arith_file, pk_raw, cache_entries, cache_ttl, rerandomize);
+	}
+	else if( cmd == "serve-ring" ) {
+		if( sub_argc < 2 ) {
+			cerr << usage_prefix << cmd << " <proving-key.raw> <ring-name> [slots]" << endl;
+			return 5;
+		}
+		const size_t num_slots = sub_argc > 2 ? std::stoul(sub_argv[2]) : 4;
+		return main_serve_ring(pb, arith_file, sub_argv[0], sub_argv[1], num_slots);
+	}
+	else if( cmd == "witness-worker" ) {
+		if( sub_argc < 2 ) {
+			cerr << usage_prefix << cmd << " <ring-name> <inputs-dir|manifest> [output-dir]" << endl;
+			return 5;
+		}
+		const char *output_dir = sub_argc > 2 ? sub_argv[2] : nullptr;
+		return main_witness_worker(pb, arith_file, sub_argv[0], sub_argv[1], output_dir);
+	}
+	else if( cmd == "split-pk" ) {
+		if( sub_argc < 3 ) {
+			cerr << usage_prefix << cmd << " <proving-key.mmap> <num-shards> <shard-prefix>" << endl;
+			return 5;
+		}
+		return main_split_pk(sub_argv[0], std::stoul(sub_argv[1]), sub_argv[2]);
+	}
+	else if( cmd == "serve-shard" ) {
+		if( sub_argc < 2 ) {
+			cerr << usage_prefix << cmd << " <shard-prefix> <index> [port] [bind-address]" << endl;
+			return 5;
+		}
+		const unsigned int port = sub_argc > 2 ? std::stoul(sub_argv[2]) : 0;
+		const char *bind_address = sub_argc > 3 ? sub_argv[3] : "127.0.0.1";
+		return main_serve_shard(sub_argv[0], std::stoul(sub_argv[1]), port, bind_address);
+	}
+	else if( cmd == "prove-distributed" ) {
+		if( sub_argc < 4 ) {
+			cerr << usage_prefix << cmd << " <circuit.inputs> <shard-prefix> <output-proof.json> <host:port>..." << endl;
+			return 5;
+		}
+		const std::vector<string> workers(sub_argv + 3, sub_argv + sub_argc);
+		return main_prove_distributed(pb, arith_file, sub_argv[0], sub_argv[1], sub_argv[2], workers);
+	}
+	else if( cmd == "tune" ) {
+		if( sub_argc < 2 ) {
+			cerr << usage_prefix << cmd << " <circuit.inputs> <proving-key.raw>" << endl;
+			return 5;
+		}
+		const char *circuit_inputs = sub_argv[0];
+		const char *pk_raw = sub_argv[1];
+		return main_tune(pb, arith_file, circuit_inputs, pk_raw);
+	}
+	else if( cmd == "compile" ) {
+		if( sub_argc < 1 ) {
+			cerr << usage_prefix << cmd << " <circuit.arithb>" << endl;
+			return 5;
+		}
+		return main_compile(arith_file, sub_argv[0]);
+	}
+	else if( cmd == "compile-inputs" ) {
+		if( sub_argc < 2 ) {
+			cerr << usage_prefix << cmd << " <circuit.inputs> <circuit.inputsb>" << endl;
+			return 5;
+		}
+		return main_compile_inputs(sub_argv[0], sub_argv[1]);
 	}
 	else if( cmd == "verify" ) {
 		if( sub_argc < 2 ) {
@@ -132,7 +1027,19 @@ int main(int argc, char **argv)
 			return 5;
 		}
 		const char *circuit_inputs = sub_argv[0];
-		return main_test(pb, arith_file, circuit_inputs);
+		return main_test(pb, arith_file, circuit_inputs, optimize, reorder);
+	}
+	else if( cmd == "profile" ) {
+		if( sub_argc < 2 ) {
+			cerr << usage_prefix << cmd << " <circuit.inputs> <report.json|report.folded>" << endl;
+			return 5;
+		}
+		return main_profile(pb, arith_file, sub_argv[0], sub_argv[1]);
+	}
+	else if( cmd == "memory" ) {
+		const char *pk_raw = sub_argc > 0 && string(sub_argv[0]) != "-" ? sub_argv[0] : nullptr;
+		const unsigned int fixed_base_c = sub_argc > 1 ? std::stoul(sub_argv[1]) : 0;
+		return main_memory(pb, arith_file, pk_raw, fixed_base_c);
 	}
 	else if( cmd == "eval" || cmd == "trace" ) {
 		if( sub_argc == 0 ) {
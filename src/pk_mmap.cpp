@@ -0,0 +1,346 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pk_mmap.hpp"
+#include "huge_pages.hpp"
+#include "pk_normalise.hpp"
+#include "utils.hpp"
+
+
+namespace ethsnarks {
+
+static const char PK_MMAP_MAGIC[8] = {'E', 'S', 'P', 'K', 'M', 'A', 'P', '\0'};
+static const uint32_t PK_MMAP_VERSION = 1;
+static const uint64_t PK_MMAP_ALIGN = 4096;
+
+#ifdef CURVE_ALT_BN128
+static const uint32_t PK_MMAP_CURVE = 1;
+#elif CURVE_MCL_BN128
+static const uint32_t PK_MMAP_CURVE = 2;
+#endif
+
+static_assert(std::is_trivially_copyable<G1T>::value, "G1 points must be trivially copyable");
+static_assert(std::is_trivially_copyable<G2T>::value, "G2 points must be trivially copyable");
+
+
+static uint64_t align_up( uint64_t offset )
+{
+    return (offset + PK_MMAP_ALIGN - 1) & ~(PK_MMAP_ALIGN - 1);
+}
+
+
+/** The section offsets and file size for the counts of the header */
+static void layout_sections( ProvingKeyMmapHeader& header )
+{
+    uint64_t offset = align_up(sizeof(header));
+    header.points_offset = offset;
+    offset = align_up(offset + (3 * sizeof(G1T)) + (2 * sizeof(G2T)));
+    header.A_indices_offset = offset;
+    offset = align_up(offset + header.A_count * sizeof(size_t));
+    header.A_values_offset = offset;
+    offset = align_up(offset + header.A_count * sizeof(G1T));
+    header.B_indices_offset = offset;
+    offset = align_up(offset + header.B_count * sizeof(size_t));
+    header.B_values_offset = offset;
+    offset = align_up(offset + header.B_count * sizeof(G2T));
+    header.H_offset = offset;
+    offset = align_up(offset + header.H_count * sizeof(G1T));
+    header.L_offset = offset;
+    header.file_size = offset + header.L_count * sizeof(G1T);
+}
+
+
+static void fill_header( const ProvingKeyT& pk, ProvingKeyMmapHeader& header )
+{
+    ::memset(&header, 0, sizeof(header));
+    ::memcpy(header.magic, PK_MMAP_MAGIC, sizeof(header.magic));
+    header.version = PK_MMAP_VERSION;
+    header.curve = PK_MMAP_CURVE;
+    header.sizeof_G1 = sizeof(G1T);
+    header.sizeof_G2 = sizeof(G2T);
+    header.sizeof_index = sizeof(size_t);
+    header.flags = pk_is_normalised(pk) ? PK_MMAP_NORMALISED : 0;
+
+    header.A_domain_size = pk.A_query.domain_size_;
+    header.A_count = pk.A_query.indices.size();
+    header.B_domain_size = pk.B_query.domain_size_;
+    header.B_count = pk.B_query.indices.size();
+    header.H_count = pk.H_query.size();
+    header.L_count = pk.L_query.size();
+
+    layout_sections(header);
+}
+
+
+static bool check_header( const ProvingKeyMmapHeader& header, uint64_t file_size )
+{
+    if( 0 != ::memcmp(header.magic, PK_MMAP_MAGIC, sizeof(header.magic)) ) {
+        std::cerr << "Error: not an mmap proving key" << std::endl;
+        return false;
+    }
+
+    if( header.version != PK_MMAP_VERSION
+     || header.curve != PK_MMAP_CURVE
+     || header.sizeof_G1 != sizeof(G1T)
+     || header.sizeof_G2 != sizeof(G2T)
+     || header.sizeof_index != sizeof(size_t) ) {
+        std::cerr << "Error: mmap proving key was written by an incompatible build" << std::endl;
+        return false;
+    }
+
+    if( header.file_size != file_size ) {
+        std::cerr << "Error: mmap proving key is truncated" << std::endl;
+        return false;
+    }
+
+    // No section can be larger than the file, so the layout can't overflow
+    if( header.A_count > file_size / sizeof(G1T)
+     || header.B_count > file_size / sizeof(G2T)
+     || header.H_count > file_size / sizeof(G1T)
+     || header.L_count > file_size / sizeof(G1T)
+     || header.A_count > header.A_domain_size
+     || header.B_count > header.B_domain_size ) {
+        std::cerr << "Error: mmap proving key has invalid section counts" << std::endl;
+        return false;
+    }
+
+    // Every section must be where the counts put it, within the file
+    ProvingKeyMmapHeader expected = header;
+    layout_sections(expected);
+    if( expected.points_offset != header.points_offset
+     || expected.A_indices_offset != header.A_indices_offset
+     || expected.A_values_offset != header.A_values_offset
+     || expected.B_indices_offset != header.B_indices_offset
+     || expected.B_values_offset != header.B_values_offset
+     || expected.H_offset != header.H_offset
+     || expected.L_offset != header.L_offset
+     || expected.file_size != file_size ) {
+        std::cerr << "Error: mmap proving key has invalid section offsets" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+/** Sparse query indices must be increasing, and within the domain */
+static bool check_indices( const uint8_t* base, uint64_t offset, uint64_t count, uint64_t domain_size, const char *name )
+{
+    const size_t* indices = reinterpret_cast<const size_t*>(base + offset);
+    for( uint64_t i = 0; i < count; i++ )
+    {
+        if( indices[i] >= domain_size || (i > 0 && indices[i] <= indices[i - 1]) ) {
+            std::cerr << "Error: mmap proving key has an invalid " << name << " query index at " << i << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool pk_is_mmap( const char *pk_file )
+{
+    std::ifstream fh(pk_file, std::ios::binary);
+    char magic[sizeof(PK_MMAP_MAGIC)];
+    if( ! fh.read(magic, sizeof(magic)) ) {
+        return false;
+    }
+    return 0 == ::memcmp(magic, PK_MMAP_MAGIC, sizeof(magic));
+}
+
+
+template<typename T>
+static void write_section( std::ofstream& fh, uint64_t offset, const T* data, size_t count )
+{
+    fh.seekp(offset);
+    fh.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+}
+
+
+bool pk_write_mmap( const ProvingKeyT& pk, const char *pk_file )
+{
+    ProvingKeyMmapHeader header;
+    fill_header(pk, header);
+
+    std::ofstream fh(pk_file, std::ios::binary | std::ios::trunc);
+    if( ! fh.is_open() ) {
+        std::cerr << "Error: cannot open " << pk_file << std::endl;
+        return false;
+    }
+
+    fh.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    fh.seekp(header.points_offset);
+    fh.write(reinterpret_cast<const char*>(&pk.alpha_g1), sizeof(G1T));
+    fh.write(reinterpret_cast<const char*>(&pk.beta_g1), sizeof(G1T));
+    fh.write(reinterpret_cast<const char*>(&pk.delta_g1), sizeof(G1T));
+    fh.write(reinterpret_cast<const char*>(&pk.beta_g2), sizeof(G2T));
+    fh.write(reinterpret_cast<const char*>(&pk.delta_g2), sizeof(G2T));
+
+    write_section(fh, header.A_indices_offset, pk.A_query.indices.data(), header.A_count);
+    write_section(fh, header.A_values_offset, pk.A_query.values.data(), header.A_count);
+    write_section(fh, header.B_indices_offset, pk.B_query.indices.data(), header.B_count);
+    write_section(fh, header.B_values_offset, pk.B_query.values.data(), header.B_count);
+    write_section(fh, header.H_offset, pk.H_query.data(), header.H_count);
+    write_section(fh, header.L_offset, pk.L_query.data(), header.L_count);
+
+    // Sections are padded, make sure the file extends to its full size
+    fh.seekp(0, std::ios::end);
+    for( uint64_t offset = fh.tellp(); offset < header.file_size; offset++ ) {
+        fh.put(0);
+    }
+
+    fh.close();
+
+    return ! fh.fail();
+}
+
+
+template<typename T>
+static void read_section( const uint8_t* base, uint64_t offset, size_t count, std::vector<T>& out, bool huge_pages )
+{
+    if( huge_pages ) {
+        huge_pages_reserve(out, count);
+    }
+    const T* begin = reinterpret_cast<const T*>(base + offset);
+    out.assign(begin, begin + count);
+}
+
+
+const uint8_t* pk_map_mmap( const char *pk_file, ProvingKeyMmapHeader& header, bool willneed )
+{
+    const int fd = ::open(pk_file, O_RDONLY);
+    if( fd < 0 ) {
+        std::cerr << "Error: cannot open " << pk_file << std::endl;
+        return nullptr;
+    }
+
+    struct stat st;
+    if( 0 != ::fstat(fd, &st) || size_t(st.st_size) < sizeof(ProvingKeyMmapHeader) ) {
+        std::cerr << "Error: cannot stat " << pk_file << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *mapped = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if( mapped == MAP_FAILED ) {
+        std::cerr << "Error: cannot mmap " << pk_file << std::endl;
+        return nullptr;
+    }
+
+    ::madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+    if( willneed ) {
+        ::madvise(mapped, st.st_size, MADV_WILLNEED);
+    }
+
+    const uint8_t* base = static_cast<const uint8_t*>(mapped);
+    ::memcpy(&header, base, sizeof(header));
+
+    if( ! check_header(header, st.st_size)
+     || ! check_indices(base, header.A_indices_offset, header.A_count, header.A_domain_size, "A")
+     || ! check_indices(base, header.B_indices_offset, header.B_count, header.B_domain_size, "B") ) {
+        ::munmap(mapped, st.st_size);
+        return nullptr;
+    }
+
+    return base;
+}
+
+
+void pk_unmap_mmap( const uint8_t* mapped, const ProvingKeyMmapHeader& header )
+{
+    ::munmap(const_cast<uint8_t*>(mapped), header.file_size);
+}
+
+
+void pk_read_mmap_points( const uint8_t* mapped, const ProvingKeyMmapHeader& header, ProvingKeyT& pk )
+{
+    const uint8_t* points = mapped + header.points_offset;
+    ::memcpy(&pk.alpha_g1, points, sizeof(G1T));
+    ::memcpy(&pk.beta_g1, points + sizeof(G1T), sizeof(G1T));
+    ::memcpy(&pk.delta_g1, points + (2 * sizeof(G1T)), sizeof(G1T));
+    ::memcpy(&pk.beta_g2, points + (3 * sizeof(G1T)), sizeof(G2T));
+    ::memcpy(&pk.delta_g2, points + (3 * sizeof(G1T)) + sizeof(G2T), sizeof(G2T));
+}
+
+
+static void read_points_AB( const uint8_t* base, const ProvingKeyMmapHeader& header, ProvingKeyT& pk, bool huge_pages )
+{
+    pk_read_mmap_points(base, header, pk);
+
+    pk.A_query.domain_size_ = header.A_domain_size;
+    read_section(base, header.A_indices_offset, header.A_count, pk.A_query.indices, huge_pages);
+    read_section(base, header.A_values_offset, header.A_count, pk.A_query.values, huge_pages);
+
+    pk.B_query.domain_size_ = header.B_domain_size;
+    read_section(base, header.B_indices_offset, header.B_count, pk.B_query.indices, huge_pages);
+    read_section(base, header.B_values_offset, header.B_count, pk.B_query.values, huge_pages);
+}
+
+
+bool pk_load_mmap( const char *pk_file, ProvingKeyT& pk, bool huge_pages )
+{
+    ProvingKeyMmapHeader header;
+    const uint8_t* base = pk_map_mmap(pk_file, header);
+    if( base == nullptr ) {
+        return false;
+    }
+
+    read_points_AB(base, header, pk, huge_pages);
+    read_section(base, header.H_offset, header.H_count, pk.H_query, huge_pages);
+    read_section(base, header.L_offset, header.L_count, pk.L_query, huge_pages);
+
+    pk_unmap_mmap(base, header);
+
+    if( ! (header.flags & PK_MMAP_NORMALISED) ) {
+        pk_normalise(pk);
+    }
+
+    return true;
+}
+
+
+bool pk_load_mmap_AB( const char *pk_file, ProvingKeyT& pk, ProvingKeyMmapHeader& header )
+{
+    // Without reading ahead into the H and L queries
+    const uint8_t* base = pk_map_mmap(pk_file, header, false);
+    if( base == nullptr ) {
+        return false;
+    }
+
+    read_points_AB(base, header, pk, false);
+    pk.H_query.clear();
+    pk.L_query.clear();
+
+    pk_unmap_mmap(base, header);
+
+    // The streamed H and L queries use full additions, their points can stay
+    if( ! (header.flags & PK_MMAP_NORMALISED) ) {
+        pk_normalise(pk);
+    }
+
+    return true;
+}
+
+
+bool pk_raw2mmap( const char *raw_pk_file, const char *mmap_pk_file )
+{
+    // Normalised once here, so loading the mmap key never needs to
+    auto pk = loadFromFile<ProvingKeyT>(raw_pk_file);
+    pk_normalise(pk);
+    return pk_write_mmap(pk, mmap_pk_file);
+}
+
+// namespace ethsnarks
+}
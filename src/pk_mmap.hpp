@@ -0,0 +1,89 @@
+#ifndef ETHSNARKS_PK_MMAP_HPP_
+#define ETHSNARKS_PK_MMAP_HPP_
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Fixed-width proving key layout, designed to be mmap'd
+*
+* The file starts with a header, followed by the points and indices of each
+* query as they are laid out in memory, every section starts on a page
+* boundary. Loading is a bulk copy from the page cache, there is no parsing,
+* and many prover processes on one host share the same cached pages.
+*
+* The layout depends on the curve and the in-memory representation of points
+* (e.g. MONTGOMERY_OUTPUT), both are recorded in the header and checked.
+*/
+/** Every point is affine, loading doesn't need to check, see pk_normalise.hpp */
+static const uint32_t PK_MMAP_NORMALISED = 1;
+
+struct ProvingKeyMmapHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t curve;
+    uint32_t sizeof_G1;
+    uint32_t sizeof_G2;
+    uint32_t sizeof_index;
+    uint32_t flags;             // PK_MMAP_NORMALISED
+
+    uint64_t A_domain_size;
+    uint64_t A_count;
+    uint64_t B_domain_size;
+    uint64_t B_count;
+    uint64_t H_count;
+    uint64_t L_count;
+
+    // Byte offsets from the start of the file
+    uint64_t points_offset;     // alpha_g1, beta_g1, beta_g2, delta_g1, delta_g2
+    uint64_t A_indices_offset;
+    uint64_t A_values_offset;
+    uint64_t B_indices_offset;
+    uint64_t B_values_offset;
+    uint64_t H_offset;
+    uint64_t L_offset;
+    uint64_t file_size;
+};
+
+/** Is the file in the mmap'able format? */
+bool pk_is_mmap( const char *pk_file );
+
+bool pk_write_mmap( const ProvingKeyT& pk, const char *pk_file );
+
+/**
+* With `huge_pages` the queries are copied into memory advised for
+* transparent huge pages before it's written, see huge_pages.hpp
+*/
+bool pk_load_mmap( const char *pk_file, ProvingKeyT& pk, bool huge_pages = false );
+
+/**
+* Load all of an mmap proving key but the H and L queries, which are left on
+* disk at the header's offsets to be streamed, see prover_stream.hpp
+*/
+bool pk_load_mmap_AB( const char *pk_file, ProvingKeyT& pk, ProvingKeyMmapHeader& header );
+
+/**
+* Map an mmap proving key read-only and check its header, for reading parts
+* of it without loading the whole key. Returns nullptr on error, otherwise
+* the mapping must be released with pk_unmap_mmap(). Sections are at the
+* header's byte offsets from the returned pointer. With `willneed` the whole
+* file is read ahead.
+*/
+const uint8_t* pk_map_mmap( const char *pk_file, ProvingKeyMmapHeader& header, bool willneed = true );
+
+void pk_unmap_mmap( const uint8_t* mapped, const ProvingKeyMmapHeader& header );
+
+/** Copy alpha, beta and delta from a mapped key */
+void pk_read_mmap_points( const uint8_t* mapped, const ProvingKeyMmapHeader& header, ProvingKeyT& pk );
+
+/** Convert a .raw proving key (written with writeToFile) to the mmap format */
+bool pk_raw2mmap( const char *raw_pk_file, const char *mmap_pk_file );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PK_MMAP_HPP_
+#endif
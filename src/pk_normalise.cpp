@@ -0,0 +1,104 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+
+#include <libff/algebra/scalar_multiplication/multiexp.hpp>   // batch_to_special
+
+#include "pk_normalise.hpp"
+
+
+namespace ethsnarks {
+
+
+template<typename T>
+static bool is_special( const std::vector<T>& points )
+{
+    return std::all_of(points.begin(), points.end(), [](const T& p) { return p.is_special(); });
+}
+
+
+/**
+* Each thread gathers the points of its range which aren't affine and
+* converts them with one batched inversion
+*/
+template<typename T>
+static size_t normalise( std::vector<T>& points, unsigned int num_threads )
+{
+    if( points.empty() ) {
+        return 0;
+    }
+
+    const auto ranges = get_cpu_ranges(0, points.size(), num_threads);
+    std::vector<size_t> converted(ranges.size(), 0);
+
+#ifdef MULTICORE
+    #pragma omp parallel for num_threads(ranges.size())
+#endif
+    for( size_t r = 0; r < ranges.size(); r++ )
+    {
+        std::vector<size_t> indices;
+        for( size_t i = ranges[r].first; i < ranges[r].second; i++ ) {
+            if( ! points[i].is_special() ) {
+                indices.push_back(i);
+            }
+        }
+        if( indices.empty() ) {
+            continue;
+        }
+
+        std::vector<T> batch;
+        batch.reserve(indices.size());
+        for( size_t i : indices ) {
+            batch.push_back(points[i]);
+        }
+
+        libff::batch_to_special<T>(batch);
+
+        for( size_t j = 0; j < indices.size(); j++ ) {
+            points[indices[j]] = batch[j];
+        }
+        converted[r] = indices.size();
+    }
+
+    size_t total = 0;
+    for( size_t n : converted ) {
+        total += n;
+    }
+    return total;
+}
+
+
+template<typename T>
+static size_t normalise( T& point )
+{
+    if( point.is_special() ) {
+        return 0;
+    }
+    point.to_special();
+    return 1;
+}
+
+
+bool pk_is_normalised( const ProvingKeyT& pk )
+{
+    return pk.alpha_g1.is_special() && pk.beta_g1.is_special() && pk.delta_g1.is_special()
+        && pk.beta_g2.is_special() && pk.delta_g2.is_special()
+        && is_special(pk.A_query.values) && is_special(pk.B_query.values)
+        && is_special(pk.H_query) && is_special(pk.L_query);
+}
+
+
+size_t pk_normalise( ProvingKeyT& pk, unsigned int num_threads )
+{
+    return normalise(pk.alpha_g1) + normalise(pk.beta_g1) + normalise(pk.delta_g1)
+         + normalise(pk.beta_g2) + normalise(pk.delta_g2)
+         + normalise(pk.A_query.values, num_threads)
+         + normalise(pk.B_query.values, num_threads)
+         + normalise(pk.H_query, num_threads)
+         + normalise(pk.L_query, num_threads);
+}
+
+
+// namespace ethsnarks
+}
@@ -0,0 +1,27 @@
+#ifndef ETHSNARKS_PK_NORMALISE_HPP_
+#define ETHSNARKS_PK_NORMALISE_HPP_
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Affine normalisation of the proving key's points
+*
+* The prover's mixed-addition multi-exps assume their bases are affine
+* (Z = 1), keys written by the generator are, but keys converted from other
+* provers or curve implementations needn't be. The points which aren't are
+* converted with a batched inversion per thread, so the cost is one field
+* inversion per thread rather than per point.
+*/
+bool pk_is_normalised( const ProvingKeyT& pk );
+
+/** Returns the number of points which were converted */
+size_t pk_normalise( ProvingKeyT& pk, unsigned int num_threads = 0 );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PK_NORMALISE_HPP_
+#endif
@@ -0,0 +1,113 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <chrono>
+#include <iostream>
+#include <iterator>
+
+#include "pk_store.hpp"
+#include "cs_memory.hpp"
+#include "stubs.hpp"
+
+
+namespace ethsnarks {
+
+
+ProvingKeyStore::ProvingKeyStore( size_t limit_bytes, bool huge_pages ) :
+    m_limit_bytes(limit_bytes),
+    m_huge_pages(huge_pages)
+{ }
+
+
+ProvingKeyStore::KeyPtrT ProvingKeyStore::get( const std::string& pk_file )
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    const auto found = m_entries.find(pk_file);
+    if( found != m_entries.end() )
+    {
+        auto& entry = found->second;
+        m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+        m_metrics.hits++;
+
+        if( entry.bytes == 0 ) {
+            // Wait for the thread loading it
+            const auto loading = entry.key;
+            lock.unlock();
+            return loading.get();
+        }
+
+        // Keys released since the last get() may be evicted now
+        KeyPtrT key = entry.key.get();
+        evict(false);
+        return key;
+    }
+
+    std::promise<KeyPtrT> loaded;
+    auto& entry = m_entries[pk_file];
+    entry.key = loaded.get_future().share();
+    m_lru.push_front(pk_file);
+    entry.lru = m_lru.begin();
+    m_metrics.misses++;
+    lock.unlock();
+
+    const auto begin = std::chrono::steady_clock::now();
+    KeyPtrT key = std::make_shared<ProvingKeyT>(load_proving_key(pk_file.c_str(), m_huge_pages));
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    CSMemoryReport report;
+    cs_memory_proving_key(*key, report);
+
+    lock.lock();
+    // The entry can't have been evicted while its bytes are 0
+    m_entries[pk_file].bytes = report.pk_bytes;
+    m_metrics.load_seconds += elapsed.count();
+    m_metrics.resident_bytes += report.pk_bytes;
+    loaded.set_value(key);
+    evict(false);
+
+    return key;
+}
+
+
+void ProvingKeyStore::evict( bool all )
+{
+    auto it = m_lru.end();
+    while( it != m_lru.begin() && (all || (m_limit_bytes > 0 && m_metrics.resident_bytes > m_limit_bytes)) )
+    {
+        --it;
+        const auto found = m_entries.find(*it);
+        const auto& entry = found->second;
+
+        // Keys still loading, or held by a caller, stay
+        if( entry.bytes == 0 || entry.key.get().use_count() > 1 ) {
+            continue;
+        }
+
+        std::cerr << "Evicting proving key " << *it << ", " << entry.bytes << " bytes" << std::endl;
+        m_metrics.resident_bytes -= entry.bytes;
+        m_metrics.evictions++;
+        m_entries.erase(found);
+        it = m_lru.erase(it);
+    }
+}
+
+
+void ProvingKeyStore::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    evict(true);
+}
+
+
+ProvingKeyStore::Metrics ProvingKeyStore::metrics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Metrics result = m_metrics;
+    result.num_keys = m_entries.size();
+    return result;
+}
+
+
+// namespace ethsnarks
+}
@@ -0,0 +1,80 @@
+#ifndef ETHSNARKS_PK_STORE_HPP_
+#define ETHSNARKS_PK_STORE_HPP_
+
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Proving keys of many circuits, loaded on demand and shared by every
+* ProverContext which proves with them
+*
+* get() returns the key of a file, loading it with load_proving_key() the
+* first time. Contexts must hold the returned pointer for as long as they
+* use the key. Keys are evicted least recently used first once the keys
+* loaded exceed `limit_bytes`, as measured by cs_memory_proving_key(), but
+* a key which is still held is never evicted, so the limit may be exceeded
+* by the keys in use. A limit of 0 keeps every key.
+*
+* Concurrent get()s of the same file wait for the one load.
+*/
+class ProvingKeyStore
+{
+public:
+    typedef std::shared_ptr<ProvingKeyT> KeyPtrT;
+
+    struct Metrics
+    {
+        size_t hits = 0;
+        size_t misses = 0;              // each a load
+        size_t evictions = 0;
+        double load_seconds = 0;        // the total of every load
+        size_t num_keys = 0;
+        size_t resident_bytes = 0;      // of the keys which are loaded
+    };
+
+    explicit ProvingKeyStore( size_t limit_bytes, bool huge_pages = false );
+
+    ProvingKeyStore( const ProvingKeyStore& ) = delete;
+    ProvingKeyStore& operator=( const ProvingKeyStore& ) = delete;
+
+    KeyPtrT get( const std::string& pk_file );
+
+    /** Evict every key which isn't held */
+    void clear();
+
+    Metrics metrics() const;
+
+protected:
+    struct Entry
+    {
+        std::shared_future<KeyPtrT> key;
+        size_t bytes = 0;               // 0 while it's loading
+        std::list<std::string>::iterator lru;
+    };
+
+    /** Evict unused keys until the limit is met, or all of them if `all` */
+    void evict( bool all );
+
+    const size_t m_limit_bytes;
+    const bool m_huge_pages;
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Entry> m_entries;
+    std::list<std::string> m_lru;       // most recently used first
+    Metrics m_metrics;
+};
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PK_STORE_HPP_
+#endif
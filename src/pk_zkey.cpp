@@ -0,0 +1,481 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+#include <libff/common/utils.hpp>   // log2, bitreverse
+#include <libff/algebra/fields/field_utils.hpp>   // get_root_of_unity
+#include <libff/algebra/scalar_multiplication/multiexp.hpp>   // batch_to_special
+
+#include "pk_zkey.hpp"
+#include "export.hpp"   // G2_in_subgroup
+#include "import.hpp"
+
+
+namespace ethsnarks {
+
+static const char ZKEY_MAGIC[4] = {'z', 'k', 'e', 'y'};
+static const uint32_t ZKEY_GROTH16 = 1;
+static const size_t ZKEY_N8 = 32;
+
+enum ZkeySection {
+    ZKEY_HEADER = 1,
+    ZKEY_GROTH16_HEADER = 2,
+    ZKEY_IC = 3,
+    ZKEY_COEFFS = 4,
+    ZKEY_POINTS_A = 5,
+    ZKEY_POINTS_B1 = 6,
+    ZKEY_POINTS_B2 = 7,
+    ZKEY_POINTS_C = 8,
+    ZKEY_POINTS_H = 9
+};
+
+static const LimbT ZKEY_FQ_MODULUS("21888242871839275222246405745257275088696311157297823662689037894645226208583");
+
+
+struct ZkeyFile
+{
+    const uint8_t *base = nullptr;
+    size_t size = 0;
+    std::map<uint32_t, std::pair<const uint8_t*, uint64_t>> sections;
+
+    bool section( uint32_t type, uint64_t size_needed, const uint8_t*& out ) const
+    {
+        const auto it = sections.find(type);
+        if( it == sections.end() || it->second.second < size_needed ) {
+            std::cerr << "Error: zkey section " << type << " is missing or truncated" << std::endl;
+            return false;
+        }
+        out = it->second.first;
+        return true;
+    }
+
+    ~ZkeyFile()
+    {
+        if( base ) {
+            ::munmap(const_cast<uint8_t*>(base), size);
+        }
+    }
+};
+
+
+static uint32_t read_u32( const uint8_t *in )
+{
+    uint32_t out;
+    ::memcpy(&out, in, sizeof(out));
+    return out;
+}
+
+
+static uint64_t read_u64( const uint8_t *in )
+{
+    uint64_t out;
+    ::memcpy(&out, in, sizeof(out));
+    return out;
+}
+
+
+static void le_to_limbs( const uint8_t *in, LimbT& out )
+{
+    out = LimbT();
+    for( size_t i = 0; i < ZKEY_N8; i++ ) {
+        const size_t bit = i * 8;
+        out.data[bit / GMP_NUMB_BITS] |= mp_limb_t(in[i]) << (bit % GMP_NUMB_BITS);
+    }
+}
+
+
+/** Little-endian bytes to limbs, false unless less than the modulus */
+static bool le_to_bigint( const uint8_t *in, LimbT& out, const LimbT& modulus )
+{
+    le_to_limbs(in, out);
+    return ::mpn_cmp(out.data, modulus.data, LimbT::N) < 0;
+}
+
+
+static bool is_zero( const uint8_t *in, size_t n )
+{
+    for( size_t i = 0; i < n; i++ ) {
+        if( in[i] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+#ifdef CURVE_ALT_BN128
+/**
+* libff and snarkjs both use R = 2^256, so the Montgomery form is used as-is
+*/
+static bool fq_from_mont( const uint8_t *in, FqT& out )
+{
+    LimbT mont;
+    if( ! le_to_bigint(in, mont, ZKEY_FQ_MODULUS) ) {
+        return false;
+    }
+    out.mont_repr = mont;
+    return true;
+}
+#elif CURVE_MCL_BN128
+/**
+* mcl's internal representation differs, convert to a hex string of x / R
+*/
+static bool fq_from_mont( const uint8_t *in, std::string& out )
+{
+    static mpz_t q, R_inv;
+    static std::once_flag init_flag;
+    std::call_once(init_flag, [](){
+        ::mpz_init(q);
+        ::mpz_init_set_ui(R_inv, 1);
+        ZKEY_FQ_MODULUS.to_mpz(q);
+        ::mpz_mul_2exp(R_inv, R_inv, ZKEY_N8 * 8);
+        ::mpz_invert(R_inv, R_inv, q);
+    });
+
+    LimbT mont;
+    if( ! le_to_bigint(in, mont, ZKEY_FQ_MODULUS) ) {
+        return false;
+    }
+
+    mpz_t value;
+    ::mpz_init(value);
+    mont.to_mpz(value);
+    ::mpz_mul(value, value, R_inv);
+    ::mpz_mod(value, value, q);
+    char *value_hex = ::mpz_get_str(nullptr, 16, value);
+    out = std::string("0x") + value_hex;
+    ::free(value_hex);
+    ::mpz_clear(value);
+    return true;
+}
+#endif
+
+
+/**
+* Affine G1 point as x, y, all zero is the point at infinity. The points
+* must be on the curve, G1 has cofactor 1 so that is the subgroup check.
+*/
+static bool zkey_G1( const uint8_t *in, G1T& out )
+{
+    if( is_zero(in, ZKEY_N8 * 2) ) {
+        out = G1T::zero();
+        return true;
+    }
+#ifdef CURVE_ALT_BN128
+    FqT x, y;
+    if( ! fq_from_mont(in, x) || ! fq_from_mont(in + ZKEY_N8, y) ) {
+        return false;
+    }
+    out = G1T(x, y, FqT::one());
+#elif CURVE_MCL_BN128
+    std::string x, y;
+    if( ! fq_from_mont(in, x) || ! fq_from_mont(in + ZKEY_N8, y) ) {
+        return false;
+    }
+    out = create_G1(x, y);
+#endif
+    return out.is_well_formed();
+}
+
+
+/** Affine G2 point as x.c0, x.c1, y.c0, y.c1, on the twist and in G2 */
+static bool zkey_G2( const uint8_t *in, G2T& out )
+{
+    if( is_zero(in, ZKEY_N8 * 4) ) {
+        out = G2T::zero();
+        return true;
+    }
+#ifdef CURVE_ALT_BN128
+    typedef typename ppT::Fqe_type Fq2_T;
+    FqT x_c0, x_c1, y_c0, y_c1;
+    if( ! fq_from_mont(in, x_c0) || ! fq_from_mont(in + ZKEY_N8, x_c1)
+     || ! fq_from_mont(in + ZKEY_N8 * 2, y_c0) || ! fq_from_mont(in + ZKEY_N8 * 3, y_c1) ) {
+        return false;
+    }
+    out = G2T(Fq2_T(x_c0, x_c1), Fq2_T(y_c0, y_c1), Fq2_T::one());
+#elif CURVE_MCL_BN128
+    std::string x_c0, x_c1, y_c0, y_c1;
+    if( ! fq_from_mont(in, x_c0) || ! fq_from_mont(in + ZKEY_N8, x_c1)
+     || ! fq_from_mont(in + ZKEY_N8 * 2, y_c0) || ! fq_from_mont(in + ZKEY_N8 * 3, y_c1) ) {
+        return false;
+    }
+    out = create_G2(x_c1, x_c0, y_c1, y_c0);
+#endif
+    return out.is_well_formed() && G2_in_subgroup(out);
+}
+
+
+template<typename T>
+static bool zkey_points( const uint8_t *in, size_t count, size_t stride, std::vector<T>& out, bool (*decode)(const uint8_t*, T&) )
+{
+    out.resize(count);
+    std::atomic<bool> ok(true);
+
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( size_t i = 0; i < count; i++ ) {
+        if( ! decode(in + (i * stride), out[i]) ) {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+
+/**
+* In-place radix-2 DFT of G1 points, out[j] = sum(omega^(i*j) * in[i])
+*/
+static void G1_fft( std::vector<G1T>& a, const FieldT& omega )
+{
+    const size_t n = a.size();
+    const size_t log_n = libff::log2(n);
+
+    for( size_t k = 0; k < n; k++ ) {
+        const size_t rk = libff::bitreverse(k, log_n);
+        if( k < rk ) {
+            std::swap(a[k], a[rk]);
+        }
+    }
+
+    for( size_t m = 1; m < n; m *= 2 )
+    {
+        // w_m is a primitive 2m-th root of unity
+        const FieldT w_m = omega ^ (n / (2 * m));
+
+        std::vector<FieldT> twiddles(m);
+        twiddles[0] = FieldT::one();
+        for( size_t j = 1; j < m; j++ ) {
+            twiddles[j] = twiddles[j - 1] * w_m;
+        }
+
+#ifdef MULTICORE
+        #pragma omp parallel for
+#endif
+        for( size_t i = 0; i < n / 2; i++ )
+        {
+            const size_t j = i % m;
+            const size_t k = (i / m) * 2 * m;
+            const G1T t = (j == 0) ? a[k + j + m] : twiddles[j] * a[k + j + m];
+            a[k + j + m] = a[k + j] - t;
+            a[k + j] = a[k + j] + t;
+        }
+    }
+}
+
+
+/**
+* snarkjs' H points are P_i = L_{2i+1}(tau) / delta, the Lagrange basis of
+* the odd points x_i = g * omega^i of a domain of size 2n. The prover's
+* H query is Q_j = tau^j * Z(tau) / delta, and as Z(x_i) = -2 for every odd
+* point, Q_j = -2 * g^j * sum(omega^(i*j) * P_i).
+*/
+static void zkey_H_to_powers( std::vector<G1T>& points )
+{
+    const size_t n = points.size();
+    const FieldT g = libff::get_root_of_unity<FieldT>(2 * n);
+
+    G1_fft(points, g * g);
+
+    // coefficients of degree n-1 and above are never used by the prover
+    points.resize(n - 1);
+
+    std::vector<FieldT> scale(points.size());
+    scale[0] = -FieldT(2);
+    for( size_t j = 1; j < scale.size(); j++ ) {
+        scale[j] = scale[j - 1] * g;
+    }
+
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( size_t j = 0; j < points.size(); j++ ) {
+        points[j] = scale[j] * points[j];
+    }
+
+    libff::batch_to_special<G1T>(points);
+}
+
+
+static bool zkey_open( const char *zkey_file, ZkeyFile& out )
+{
+    const int fd = ::open(zkey_file, O_RDONLY);
+    if( fd < 0 ) {
+        std::cerr << "Error: cannot open " << zkey_file << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if( 0 != ::fstat(fd, &st) || st.st_size < 12 ) {
+        std::cerr << "Error: cannot stat " << zkey_file << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void *mapped = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if( mapped == MAP_FAILED ) {
+        std::cerr << "Error: cannot mmap " << zkey_file << std::endl;
+        return false;
+    }
+    ::madvise(mapped, st.st_size, MADV_WILLNEED);
+
+    out.base = static_cast<const uint8_t*>(mapped);
+    out.size = st.st_size;
+
+    if( 0 != ::memcmp(out.base, ZKEY_MAGIC, sizeof(ZKEY_MAGIC)) ) {
+        std::cerr << "Error: not a zkey file" << std::endl;
+        return false;
+    }
+
+    // magic, version, number of sections, then (type, size, data) for each
+    const uint32_t n_sections = read_u32(out.base + 8);
+    size_t offset = 12;
+    for( uint32_t i = 0; i < n_sections; i++ )
+    {
+        if( offset + 12 > out.size ) {
+            std::cerr << "Error: zkey is truncated" << std::endl;
+            return false;
+        }
+        const uint32_t type = read_u32(out.base + offset);
+        const uint64_t size = read_u64(out.base + offset + 4);
+        offset += 12;
+        if( size > out.size - offset ) {
+            std::cerr << "Error: zkey is truncated" << std::endl;
+            return false;
+        }
+        out.sections[type] = std::make_pair(out.base + offset, size);
+        offset += size;
+    }
+
+    return true;
+}
+
+
+static bool zkey_read( const ZkeyFile& zkey, ProvingKeyT& pk )
+{
+    const uint8_t *header;
+    if( ! zkey.section(ZKEY_HEADER, 4, header) ) {
+        return false;
+    }
+    if( read_u32(header) != ZKEY_GROTH16 ) {
+        std::cerr << "Error: zkey is not a Groth16 key" << std::endl;
+        return false;
+    }
+
+    // n8q, q, n8r, r, nVars, nPublic, domainSize, then the vk points
+    const size_t G1_size = 2 * ZKEY_N8;
+    const size_t G2_size = 4 * ZKEY_N8;
+    const size_t points_offset = 4 + ZKEY_N8 + 4 + ZKEY_N8 + 12;
+    const uint8_t *groth16;
+    if( ! zkey.section(ZKEY_GROTH16_HEADER, points_offset + (3 * G1_size) + (3 * G2_size), groth16) ) {
+        return false;
+    }
+
+    LimbT q, r;
+    le_to_limbs(groth16 + 4, q);
+    le_to_limbs(groth16 + 8 + ZKEY_N8, r);
+    if( read_u32(groth16) != ZKEY_N8 || read_u32(groth16 + 4 + ZKEY_N8) != ZKEY_N8
+     || q != ZKEY_FQ_MODULUS || r != FieldT::mod ) {
+        std::cerr << "Error: zkey is for a different curve" << std::endl;
+        return false;
+    }
+
+    const uint8_t *sizes = groth16 + 8 + (2 * ZKEY_N8);
+    const size_t n_vars = read_u32(sizes);
+    const size_t n_public = read_u32(sizes + 4);
+    const size_t domain_size = read_u32(sizes + 8);
+    if( n_vars < n_public + 1 || domain_size < 2 || (domain_size & (domain_size - 1)) != 0 ) {
+        std::cerr << "Error: zkey header is invalid" << std::endl;
+        return false;
+    }
+
+    // alpha_1, beta_1, beta_2, gamma_2, delta_1, delta_2
+    const uint8_t *vk = groth16 + points_offset;
+    G2T gamma_g2;
+    if( ! zkey_G1(vk, pk.alpha_g1)
+     || ! zkey_G1(vk + G1_size, pk.beta_g1)
+     || ! zkey_G2(vk + (2 * G1_size), pk.beta_g2)
+     || ! zkey_G2(vk + (2 * G1_size) + G2_size, gamma_g2)
+     || ! zkey_G1(vk + (2 * G1_size) + (2 * G2_size), pk.delta_g1)
+     || ! zkey_G2(vk + (3 * G1_size) + (2 * G2_size), pk.delta_g2) ) {
+        std::cerr << "Error: zkey verification key points are invalid" << std::endl;
+        return false;
+    }
+
+    const uint8_t *A, *B1, *B2, *C, *H;
+    if( ! zkey.section(ZKEY_POINTS_A, n_vars * G1_size, A)
+     || ! zkey.section(ZKEY_POINTS_B1, n_vars * G1_size, B1)
+     || ! zkey.section(ZKEY_POINTS_B2, n_vars * G2_size, B2)
+     || ! zkey.section(ZKEY_POINTS_C, (n_vars - n_public - 1) * G1_size, C)
+     || ! zkey.section(ZKEY_POINTS_H, domain_size * G1_size, H) ) {
+        return false;
+    }
+
+    std::vector<G1T> A_points, H_points;
+    std::vector<G2T> B_points;
+    if( ! zkey_points<G1T>(A, n_vars, G1_size, A_points, zkey_G1)
+     || ! zkey_points<G2T>(B2, n_vars, G2_size, B_points, zkey_G2)
+     || ! zkey_points<G1T>(C, n_vars - n_public - 1, G1_size, pk.L_query, zkey_G1)
+     || ! zkey_points<G1T>(H, domain_size, G1_size, H_points, zkey_G1) ) {
+        std::cerr << "Error: zkey contains an invalid point" << std::endl;
+        return false;
+    }
+
+    // The sparse queries only keep the non-zero entries
+    pk.A_query.domain_size_ = n_vars;
+    pk.B_query.domain_size_ = n_vars;
+    for( size_t i = 0; i < n_vars; i++ )
+    {
+        if( ! A_points[i].is_zero() ) {
+            pk.A_query.indices.emplace_back(i);
+            pk.A_query.values.emplace_back(A_points[i]);
+        }
+        if( ! is_zero(B1 + (i * G1_size), G1_size) ) {
+            pk.B_query.indices.emplace_back(i);
+            pk.B_query.values.emplace_back(B_points[i]);
+        }
+    }
+
+    zkey_H_to_powers(H_points);
+    pk.H_query = std::move(H_points);
+
+    return true;
+}
+
+
+bool pk_is_zkey( const char *pk_file )
+{
+    std::ifstream fh(pk_file, std::ios::binary);
+    char magic[sizeof(ZKEY_MAGIC)];
+    if( ! fh.read(magic, sizeof(magic)) ) {
+        return false;
+    }
+    return 0 == ::memcmp(magic, ZKEY_MAGIC, sizeof(magic));
+}
+
+
+bool pk_load_zkey( const char *zkey_file, ProvingKeyT& pk )
+{
+    ZkeyFile zkey;
+    return zkey_open(zkey_file, zkey) && zkey_read(zkey, pk);
+}
+
+// namespace ethsnarks
+}
@@ -0,0 +1,31 @@
+#ifndef ETHSNARKS_PK_ZKEY_HPP_
+#define ETHSNARKS_PK_ZKEY_HPP_
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Import of snarkjs Groth16 .zkey proving keys
+*
+* The file is mmap'd and points are decoded from snarkjs's little-endian
+* Montgomery form in parallel, without any JSON step. The A, B and C (L)
+* queries map directly onto the nozk key, the variable order being the same.
+*
+* snarkjs commits to H through the Lagrange basis of the odd points of a
+* domain twice the size, the libsnark prover uses powers of tau times Z(tau).
+* These are related by a DFT over G1 which is computed on load, the circuit
+* must use a radix-2 evaluation domain of the zkey's domain size.
+*/
+
+/** Is the file a snarkjs .zkey? */
+bool pk_is_zkey( const char *pk_file );
+
+bool pk_load_zkey( const char *zkey_file, ProvingKeyT& pk );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PK_ZKEY_HPP_
+#endif
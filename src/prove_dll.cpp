@@ -0,0 +1,169 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+#include <libff/common/profiling.hpp>
+
+#include "prove_dll.h"
+#include "cs_cache.hpp"
+#include "export.hpp"
+#include "import.hpp"
+#include "prover_profile.hpp"
+#include "stubs.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok.hpp"
+
+using ethsnarks::FieldT;
+using ethsnarks::LimbT;
+
+
+/**
+* Opaque handle, the context refers to the key and the protoboard's
+* constraint system so they're allocated once and never move
+*/
+struct ethsnarks_prover {
+    ethsnarks::ProtoboardT pb;
+    ethsnarks::ProvingKeyT pk;
+    std::unique_ptr<ethsnarks::ProverContextT> context;
+    // The witness, re-used between proofs so it's never re-allocated
+    std::vector<FieldT> values;
+    std::mutex mutex;
+};
+
+
+static_assert(sizeof(FieldT) == sizeof(LimbT::data), "field elements are their Montgomery limbs");
+
+
+/**
+* The profiling counters are global state, proving with many handles at
+* once requires them to be disabled
+*/
+static void init_handle_api()
+{
+    static std::once_flag once;
+    std::call_once(once, [](){
+        ethsnarks::stub_init_public_params();
+        libff::inhibit_profiling_info = true;
+        libff::inhibit_profiling_counters = true;
+    });
+}
+
+
+extern "C" {
+
+ethsnarks_prover *ethsnarks_prover_load( const char *pk_file, const char *cs_file )
+{
+    init_handle_api();
+
+    std::unique_ptr<ethsnarks_prover> prover(new ethsnarks_prover);
+    auto& cs = prover->pb.constraint_system;
+    const bool loaded = ethsnarks::is_r1cs_bin(cs_file) ? ethsnarks::r1cs_from_bin(cs_file, cs)
+                                                        : ethsnarks::cs_cache_load(cs_file, nullptr, cs);
+    if( ! loaded ) {
+        std::cerr << "Error: cannot load the constraint system " << cs_file << std::endl;
+        return nullptr;
+    }
+
+    try {
+        libsnark::Config config;
+        ethsnarks::load_prover_config(pk_file, ethsnarks::circuit_name_from_path(cs_file), prover->pb, config);
+
+        prover->pk = ethsnarks::load_proving_key(pk_file, config.huge_pages);
+        prover->context.reset(new ethsnarks::ProverContextT(prover->pk));
+        ethsnarks::init_prover_context(*prover->context, prover->pb, config, ethsnarks::fixed_base_table_path(pk_file, config).c_str());
+    }
+    catch( const std::exception& ex ) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return nullptr;
+    }
+
+    if( prover->pk.A_query.domain_size() != ethsnarks_prover_num_values(prover.get()) ) {
+        std::cerr << "Error: " << pk_file << " is for a different constraint system" << std::endl;
+        return nullptr;
+    }
+
+    // The witness is checked as the prover evaluates the constraints
+    prover->context->check_satisfied = true;
+    prover->values.resize(ethsnarks_prover_num_values(prover.get()));
+
+    return prover.release();
+}
+
+
+size_t ethsnarks_field_size( void )
+{
+    return sizeof(FieldT);
+}
+
+
+size_t ethsnarks_prover_num_values( const ethsnarks_prover *prover )
+{
+    return prover->pb.constraint_system.num_variables() + 1;
+}
+
+
+size_t ethsnarks_prover_proof_size( const ethsnarks_prover *prover )
+{
+    return ethsnarks::WIRE_PROOF_SIZE + (prover->pb.constraint_system.primary_input_size * ethsnarks::WIRE_WORD_SIZE);
+}
+
+
+size_t ethsnarks_prove( ethsnarks_prover *prover, const uint8_t *values, size_t num_values, int format,
+                        uint8_t *proof, size_t proof_size )
+{
+    if( prover == nullptr
+     || num_values != ethsnarks_prover_num_values(prover)
+     || proof_size < ethsnarks_prover_proof_size(prover)
+     || (format != ETHSNARKS_FIELD_MONTGOMERY && format != ETHSNARKS_FIELD_CANONICAL) ) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(prover->mutex);
+    auto& context = *prover->context;
+    auto& witness = prover->values;
+
+    // One copy into the buffer the prover reads, its interfaces are vectors
+    if( format == ETHSNARKS_FIELD_MONTGOMERY ) {
+        ::memcpy(witness.data(), values, num_values * sizeof(FieldT));
+    }
+    else {
+#ifdef MULTICORE
+#pragma omp parallel for num_threads(context.config.num_threads)
+#endif
+        for( size_t i = 0; i < num_values; i++ )
+        {
+            LimbT limbs;
+            ::memcpy(limbs.data, values + (i * sizeof(limbs.data)), sizeof(limbs.data));
+            witness[i] = FieldT(limbs);
+        }
+    }
+
+    context.primary_input.assign(witness.begin() + 1, witness.begin() + 1 + prover->pb.constraint_system.primary_input_size);
+
+    try {
+        const auto result = libsnark::r1cs_gg_ppzksnark_zok_prover<ethsnarks::ppT>(context, witness);
+        const auto bytes = ethsnarks::proof_to_bytes(result, context.primary_input);
+        ::memcpy(proof, bytes.data(), bytes.size());
+        return bytes.size();
+    }
+    catch( const std::exception& ex ) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 0;
+    }
+}
+
+
+void ethsnarks_prover_free( ethsnarks_prover *prover )
+{
+    delete prover;
+}
+
+}
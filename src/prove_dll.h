@@ -0,0 +1,63 @@
+#ifndef ETHSNARKS_PROVE_DLL_H_
+#define ETHSNARKS_PROVE_DLL_H_
+
+/**
+* C API of the ethsnarks_prove shared library, for services which prove
+* in-process rather than running the pinocchio binary
+*
+* A handle holds a proving key, a constraint system and a prover context
+* which is re-used for every proof. The witness is passed as a contiguous
+* buffer of field elements, the full variable assignment starting with ONE,
+* of ethsnarks_prover_num_values() elements of ethsnarks_field_size() bytes:
+*
+*  - ETHSNARKS_FIELD_MONTGOMERY, the in-memory representation of the
+*    library's field elements, e.g. as computed by a previous call
+*  - ETHSNARKS_FIELD_CANONICAL, the integers as little-endian 64-bit limbs
+*
+* Proofs are returned in the binary encoding of proof_to_bytes.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETHSNARKS_FIELD_MONTGOMERY 0
+#define ETHSNARKS_FIELD_CANONICAL 1
+
+typedef struct ethsnarks_prover ethsnarks_prover;
+
+/**
+* Load a proving key in any of the supported formats, and either the
+* constraint system cache written next to a circuit by `pinocchio prove` or
+* a circom binary .r1cs file. Returns NULL on failure. The prover config is
+* loaded as by `pinocchio prove`.
+*/
+ethsnarks_prover *ethsnarks_prover_load( const char *pk_file, const char *cs_file );
+
+size_t ethsnarks_field_size( void );
+
+size_t ethsnarks_prover_num_values( const ethsnarks_prover *prover );
+
+/** The size of the proofs of ethsnarks_prove, including the primary input */
+size_t ethsnarks_prover_proof_size( const ethsnarks_prover *prover );
+
+/**
+* Prove the witness into `proof`, returns the size written or 0 if the
+* buffer is too small, the witness has the wrong size or doesn't satisfy
+* the constraints. Calls with the same handle are serialised.
+*/
+size_t ethsnarks_prove( ethsnarks_prover *prover, const uint8_t *values, size_t num_values, int format,
+                        uint8_t *proof, size_t proof_size );
+
+void ethsnarks_prover_free( ethsnarks_prover *prover );
+
+#ifdef __cplusplus
+}
+#endif
+
+// ETHSNARKS_PROVE_DLL_H_
+#endif
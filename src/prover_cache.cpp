@@ -0,0 +1,164 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <iterator>     // prev
+
+#include "prover_cache.hpp"
+#include "crypto/blake2b.h"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok.hpp"
+
+
+namespace ethsnarks {
+
+
+template<typename T>
+static void hash_point( blake2b_ctx& ctx, T point )
+{
+    // Points are hashed in affine coordinates, so equal points hash the same
+    point.to_affine_coordinates();
+    blake2b_update(&ctx, &point, sizeof(point));
+}
+
+
+static void hash_size( blake2b_ctx& ctx, uint64_t size )
+{
+    blake2b_update(&ctx, &size, sizeof(size));
+}
+
+
+ProofCache::ProofCache( const ProvingKeyT& pk, size_t max_entries, unsigned int ttl_seconds ) :
+    m_max_entries(max_entries),
+    m_ttl(std::chrono::seconds(ttl_seconds)),
+    m_hits(0),
+    m_misses(0)
+{
+    // delta is the trapdoor of the setup, so differs for every key
+    blake2b_ctx ctx;
+    blake2b_init(&ctx, PROOF_CACHE_KEY_SIZE, nullptr, 0);
+    hash_point(ctx, pk.alpha_g1);
+    hash_point(ctx, pk.beta_g2);
+    hash_point(ctx, pk.delta_g1);
+    hash_point(ctx, pk.delta_g2);
+    hash_size(ctx, pk.A_query.domain_size());
+    hash_size(ctx, pk.B_query.domain_size());
+    hash_size(ctx, pk.H_query.size());
+    hash_size(ctx, pk.L_query.size());
+    blake2b_final(&ctx, m_fingerprint);
+}
+
+
+ProofCache::KeyT ProofCache::key( const std::vector<FieldT>& values ) const
+{
+    KeyT result;
+    blake2b_ctx ctx;
+    blake2b_init(&ctx, result.size(), m_fingerprint, sizeof(m_fingerprint));
+    hash_size(ctx, values.size());
+    blake2b_update(&ctx, values.data(), values.size() * sizeof(FieldT));
+    blake2b_final(&ctx, result.data());
+    return result;
+}
+
+
+void ProofCache::erase( ListT::iterator it )
+{
+    m_index.erase(it->key);
+    m_entries.erase(it);
+}
+
+
+bool ProofCache::lookup( const KeyT& key, ProofT& proof )
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto found = m_index.find(key);
+    if( found == m_index.end() ) {
+        m_misses++;
+        return false;
+    }
+
+    const auto it = found->second;
+    if( m_ttl.count() > 0 && ClockT::now() - it->created > m_ttl ) {
+        erase(it);
+        m_misses++;
+        return false;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it);
+    proof = it->proof;
+    m_hits++;
+    return true;
+}
+
+
+void ProofCache::insert( const KeyT& key, const ProofT& proof )
+{
+    if( m_max_entries == 0 ) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto found = m_index.find(key);
+    if( found != m_index.end() ) {
+        erase(found->second);
+    }
+
+    while( m_entries.size() >= m_max_entries ) {
+        erase(std::prev(m_entries.end()));
+    }
+
+    m_entries.push_front({key, proof, ClockT::now()});
+    m_index[key] = m_entries.begin();
+}
+
+
+void ProofCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+}
+
+
+size_t ProofCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+
+ProofT rerandomize_proof( const G2T& delta_g2, const ProofT& proof )
+{
+    const FieldT r1 = FieldT::random_element();
+    const FieldT r2 = FieldT::random_element();
+
+    return ProofT(r1.inverse() * proof.g_A,
+                  r1 * proof.g_B + (r1 * r2) * delta_g2,
+                  proof.g_C + r2 * proof.g_A);
+}
+
+
+ProofT rerandomize_proof( const ProvingKeyT& pk, const ProofT& proof )
+{
+    return rerandomize_proof(pk.delta_g2, proof);
+}
+
+
+ProofT prove_cached( ProverContextT& context, ProofCache& cache, const std::vector<FieldT>& values, bool rerandomize )
+{
+    context.primary_input.assign(values.begin() + 1, values.begin() + 1 + context.constraint_system->primary_input_size);
+
+    const auto key = cache.key(values);
+    ProofT proof;
+    if( ! cache.lookup(key, proof) )
+    {
+        proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, values);
+        cache.insert(key, proof);
+    }
+
+    return rerandomize ? rerandomize_proof(context.provingKey, proof) : proof;
+}
+
+
+// namespace ethsnarks
+}
@@ -0,0 +1,102 @@
+#ifndef ETHSNARKS_PROVER_CACHE_HPP_
+#define ETHSNARKS_PROVER_CACHE_HPP_
+
+#include "ethsnarks.hpp"
+
+#include <array>
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+
+
+namespace ethsnarks {
+
+/**
+* Proofs of recently seen witnesses, so a repeated request isn't proven again
+*
+* The prover is deterministic, it adds no randomness of its own, so the same
+* full variable assignment and proving key always give the same proof. Each
+* entry is keyed by a BLAKE2b of the assignment, keyed in turn by a
+* fingerprint of the proving key, so one cache is only ever valid for one key.
+*
+* The cache holds at most `max_entries`, evicting the least recently used,
+* and with a non-zero `ttl_seconds` entries older than that are ignored.
+* It may be shared by threads.
+*/
+class ProofCache
+{
+public:
+    static const size_t PROOF_CACHE_KEY_SIZE = 32;
+
+    typedef std::array<uint8_t, PROOF_CACHE_KEY_SIZE> KeyT;
+    typedef std::chrono::steady_clock ClockT;
+
+    ProofCache( const ProvingKeyT& pk, size_t max_entries, unsigned int ttl_seconds = 0 );
+
+    /** The cache key of a full variable assignment */
+    KeyT key( const std::vector<FieldT>& values ) const;
+
+    /** Returns false if the key is missing or has expired */
+    bool lookup( const KeyT& key, ProofT& proof );
+
+    void insert( const KeyT& key, const ProofT& proof );
+
+    void clear();
+
+    size_t size() const;
+    size_t hits() const { return m_hits; }
+    size_t misses() const { return m_misses; }
+
+protected:
+    struct Entry
+    {
+        KeyT key;
+        ProofT proof;
+        ClockT::time_point created;
+    };
+
+    typedef std::list<Entry> ListT;
+
+    void erase( ListT::iterator it );
+
+    uint8_t m_fingerprint[PROOF_CACHE_KEY_SIZE];
+    const size_t m_max_entries;
+    const ClockT::duration m_ttl;
+
+    mutable std::mutex m_mutex;
+    ListT m_entries;                // most recently used first
+    std::map<KeyT, ListT::iterator> m_index;
+    size_t m_hits;
+    size_t m_misses;
+};
+
+
+/**
+* A proof of the same statement which can't be linked to `proof`, for
+* random r1 and r2:
+*
+*   A' = A / r1,  B' = r1 * B + r1 * r2 * delta,  C' = C + r2 * A
+*
+* As e(A', B') = e(A, B) * e(r2 * A, delta) it satisfies the same pairing
+* equation. This is much cheaper than proving again.
+*
+* Only delta in G2 is needed, which the verification key has too, so a proof
+* can be re-randomized by anyone holding it and the verification key.
+*/
+ProofT rerandomize_proof( const G2T& delta_g2, const ProofT& proof );
+
+ProofT rerandomize_proof( const ProvingKeyT& pk, const ProofT& proof );
+
+/**
+* Prove the full variable assignment unless the cache holds its proof, the
+* primary input is copied into the context either way. With `rerandomize`
+* the proof returned is re-randomized, both when cached and when new.
+*/
+ProofT prove_cached( ProverContextT& context, ProofCache& cache, const std::vector<FieldT>& values, bool rerandomize = false );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PROVER_CACHE_HPP_
+#endif
@@ -1,6 +1,7 @@
 #ifndef ETHSNARKS_PROVER_CONFIG_HPP_
 #define ETHSNARKS_PROVER_CONFIG_HPP_
 
+#include <string>
 #include <vector>
 
 namespace libsnark {
@@ -18,9 +19,17 @@ struct Config
         smt = false;
         swapAB = true;
         multi_exp_c = 0;
+        multi_exp_method = "bdlo12";
         multi_exp_prefetch_locality = 0;
         prefetch_stride = 128;
         multi_exp_look_ahead = 1;
+        parallel_multi_exp = false;
+        fixed_base_c = 0;
+        msm_backend = "";
+        numa = false;
+        huge_pages = false;
+        stream_budget_mb = 0;
+        msm_threads = 0;
     }
 
     unsigned int num_threads;
@@ -29,9 +38,17 @@ struct Config
     std::vector<unsigned int> radixes;
     bool swapAB;
     unsigned int multi_exp_c;
+    std::string multi_exp_method;               // "bdlo12" (libff) or "sorted" buckets, see r1cs_gg_ppzksnark_zok_sorted_multi_exp, the sparse A and L queries are always sorted
     unsigned int multi_exp_prefetch_locality;   // 4 == no prefetching, [0, 3] prefetch locality
     unsigned int prefetch_stride;               // 4 * L1_CACHE_BYTES
     unsigned int multi_exp_look_ahead;
+    bool parallel_multi_exp;                    // run the A/B/H/L multi-exps as concurrent tasks
+    unsigned int fixed_base_c;                  // window of the precomputed H/L query tables, 0 == disabled
+    std::string msm_backend;                    // registered backend for the H/L queries, empty == CPU
+    bool numa;                                  // pin workers, move H/L query ranges to their nodes
+    bool huge_pages;                            // transparent huge pages for the pk and scratch vectors
+    unsigned int stream_budget_mb;              // stream the H/L queries from an mmap pk in this much memory, 0 == load them
+    unsigned int msm_threads;                   // threads of the multi-exps, 0 == num_threads, see smt_plan_config
 };
 
 static std::ostream &operator<<(std::ostream &os, const Config& c)
@@ -49,9 +66,17 @@ static std::ostream &operator<<(std::ostream &os, const Config& c)
     "fft: " << c.fft << ", " <<
     "radixes: " << radixes << ", " <<
     "exp_c: " << c.multi_exp_c << ", " <<
+    "exp_method: " << c.multi_exp_method << ", " <<
     "pre_stride: " << c.prefetch_stride << ", " <<
     "exp_preloc: " << c.multi_exp_prefetch_locality << ", " <<
-    "exp_lookahead: " << c.multi_exp_look_ahead;
+    "exp_lookahead: " << c.multi_exp_look_ahead << ", " <<
+    "parallel_exp: " << c.parallel_multi_exp << ", " <<
+    "fixed_base_c: " << c.fixed_base_c << ", " <<
+    "msm_backend: " << (c.msm_backend.empty() ? "cpu" : c.msm_backend) << ", " <<
+    "numa: " << c.numa << ", " <<
+    "huge_pages: " << c.huge_pages << ", " <<
+    "stream_budget_mb: " << c.stream_budget_mb << ", " <<
+    "msm_threads: " << c.msm_threads;
 }
 
 static inline std::vector<std::pair<unsigned int, unsigned int>> get_cpu_ranges(unsigned int startIdx, unsigned int length, unsigned int num_threads = 0)
@@ -0,0 +1,53 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "prover_incremental.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok.hpp"
+
+
+namespace ethsnarks {
+
+
+IncrementalProver::IncrementalProver( ProverContextT& context, size_t full_ratio ) :
+    m_context(context),
+    m_full_ratio(full_ratio),
+    m_valid(false),
+    m_incremental(false)
+{ }
+
+
+void IncrementalProver::reset()
+{
+    m_valid = false;
+    m_values.clear();
+}
+
+
+ProofT IncrementalProver::prove( const std::vector<FieldT>& values, const std::vector<size_t>& changed )
+{
+    m_context.primary_input.assign(values.begin() + 1, values.begin() + 1 + m_context.constraint_system->primary_input_size);
+
+    m_incremental = m_valid
+                 && values.size() == m_values.size()
+                 && changed.size() * m_full_ratio <= values.size();
+
+    if( m_incremental )
+    {
+        libsnark::r1cs_gg_ppzksnark_zok_update_linear<ppT>(m_context, m_evaluation, m_values, values, changed);
+        for( const size_t i : changed ) {
+            m_values[i] = values[i];
+        }
+    }
+    else
+    {
+        m_evaluation = libsnark::r1cs_gg_ppzksnark_zok_evaluate_linear<ppT>(m_context, values);
+        m_values = values;
+        m_valid = true;
+    }
+
+    return libsnark::r1cs_gg_ppzksnark_zok_prover_linear<ppT>(m_context, values, m_evaluation);
+}
+
+
+// namespace ethsnarks
+}
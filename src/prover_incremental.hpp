@@ -0,0 +1,55 @@
+#ifndef ETHSNARKS_PROVER_INCREMENTAL_HPP_
+#define ETHSNARKS_PROVER_INCREMENTAL_HPP_
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Proves consecutive assignments of one circuit which differ in few variables
+*
+* The A, B and L query evaluations are linear in the full variable
+* assignment, so they're kept from one proof to the next and only the
+* changed variables are added to them, as reported by
+* incremental_witness::update(). The witness map and the H query are
+* computed in full for every proof.
+*
+* The first proof, and any where more than 1/full_ratio of the variables
+* changed, evaluates the queries with multi-exponentiations.
+*/
+class IncrementalProver
+{
+public:
+    // A scalar multiplication costs about as much as this many bases of a
+    // multi-exponentiation
+    static const size_t INCREMENTAL_FULL_RATIO = 16;
+
+    IncrementalProver( ProverContextT& context, size_t full_ratio = INCREMENTAL_FULL_RATIO );
+
+    /**
+    * Prove the full variable assignment `values`, which differs from that of
+    * the previous proof at the sorted indices in `changed`.
+    */
+    ProofT prove( const std::vector<FieldT>& values, const std::vector<size_t>& changed );
+
+    /** The next proof evaluates the queries in full */
+    void reset();
+
+    /** Did the last proof re-use the evaluations of the one before? */
+    bool was_incremental() const { return m_incremental; }
+
+protected:
+    ProverContextT& m_context;
+    const size_t m_full_ratio;
+    std::vector<FieldT> m_values;
+    libsnark::r1cs_gg_ppzksnark_zok_linear_evaluation<ppT> m_evaluation;
+    bool m_valid;
+    bool m_incremental;
+};
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PROVER_INCREMENTAL_HPP_
+#endif
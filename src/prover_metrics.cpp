@@ -0,0 +1,374 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "prover_metrics.hpp"
+#include "cs_memory.hpp"
+#include "pk_store.hpp"
+#include "prover_cache.hpp"
+#include "prover_scheduler.hpp"
+
+
+namespace ethsnarks {
+
+
+static std::string format_value( double value )
+{
+    char buf[32];
+    ::snprintf(buf, sizeof(buf), "%.9g", value);
+    return buf;
+}
+
+
+static std::string escape_label( const std::string& value )
+{
+    std::string result;
+    for( const char c : value )
+    {
+        if( c == '\\' || c == '"' ) {
+            result += '\\';
+            result += c;
+        }
+        else if( c == '\n' ) {
+            result += "\\n";
+        }
+        else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+
+static void write_header( std::ostream& out, const std::string& name, const char *type, const std::string& help )
+{
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+
+/** The lines of one histogram, `labels` are e.g. `phase="fft",` */
+static void write_histogram( std::ostream& out, const std::string& name, const std::string& labels, const MetricsHistogram& histogram )
+{
+    size_t cumulative = 0;
+    for( size_t i = 0; i <= histogram.bounds.size(); i++ )
+    {
+        cumulative += histogram.counts[i];
+        const std::string le = i < histogram.bounds.size() ? format_value(histogram.bounds[i]) : "+Inf";
+        out << name << "_bucket{" << labels << "le=\"" << le << "\"} " << cumulative << "\n";
+    }
+
+    const std::string braces = labels.empty() ? "" : "{" + labels.substr(0, labels.size() - 1) + "}";
+    out << name << "_sum" << braces << " " << format_value(histogram.sum) << "\n";
+    out << name << "_count" << braces << " " << histogram.count << "\n";
+}
+
+
+MetricsHistogram::MetricsHistogram( const std::vector<double>& in_bounds ) :
+    bounds(in_bounds),
+    counts(in_bounds.size() + 1, 0)
+{ }
+
+
+void MetricsHistogram::observe( double value )
+{
+    const size_t i = std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+    counts[i]++;
+    sum += value;
+    count++;
+}
+
+
+const std::vector<double>& ProverMetrics::default_buckets()
+{
+    static const std::vector<double> buckets = {
+        0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+        1, 2.5, 5, 10, 25, 50, 100
+    };
+    return buckets;
+}
+
+
+ProverMetrics::ProverMetrics( unsigned int num_threads ) :
+    m_num_threads(num_threads ? num_threads : std::max(1u, std::thread::hardware_concurrency())),
+    m_start_time(std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count()),
+    m_proof_seconds(default_buckets())
+{ }
+
+
+void ProverMetrics::begin_proof()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_in_progress++;
+}
+
+
+void ProverMetrics::record_proof( double wall_seconds, double cpu_seconds, const libsnark::ProverStats *stats )
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_in_progress -= std::min<size_t>(m_in_progress, 1);
+    m_proofs++;
+    m_wall_seconds += wall_seconds;
+    m_cpu_seconds += cpu_seconds;
+    m_proof_seconds.observe(wall_seconds);
+
+    if( stats == nullptr ) {
+        return;
+    }
+
+    // A phase which runs more than once per proof, e.g. 'fft', is observed once with its total
+    std::set<std::string> names;
+    for( const auto& phase : stats->phases ) {
+        names.insert(phase.name);
+    }
+    for( const auto& name : names ) {
+        auto it = m_phase_seconds.find(name);
+        if( it == m_phase_seconds.end() ) {
+            it = m_phase_seconds.emplace(name, MetricsHistogram(default_buckets())).first;
+        }
+        it->second.observe(stats->wall_seconds(name));
+    }
+}
+
+
+void ProverMetrics::record_error()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_in_progress -= std::min<size_t>(m_in_progress, 1);
+    m_errors++;
+}
+
+
+void ProverMetrics::add_gauge( const std::string& name, const std::string& help, const ValueFnT& value )
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_values.push_back({name, "gauge", help, value});
+}
+
+
+void ProverMetrics::add_counter( const std::string& name, const std::string& help, const ValueFnT& value )
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_values.push_back({name, "counter", help, value});
+}
+
+
+void ProverMetrics::add_proof_cache( const ProofCache& cache )
+{
+    add_counter("ethsnarks_proof_cache_hits_total", "Proofs answered from the proof cache", [&cache](){ return double(cache.hits()); });
+    add_counter("ethsnarks_proof_cache_misses_total", "Proofs not in the proof cache", [&cache](){ return double(cache.misses()); });
+    add_gauge("ethsnarks_proof_cache_entries", "Proofs held by the proof cache", [&cache](){ return double(cache.size()); });
+}
+
+
+void ProverMetrics::add_key_store( const ProvingKeyStore& store )
+{
+    add_counter("ethsnarks_pk_cache_hits_total", "Proving keys found loaded", [&store](){ return double(store.metrics().hits); });
+    add_counter("ethsnarks_pk_cache_misses_total", "Proving keys loaded", [&store](){ return double(store.metrics().misses); });
+    add_counter("ethsnarks_pk_cache_evictions_total", "Proving keys evicted", [&store](){ return double(store.metrics().evictions); });
+    add_counter("ethsnarks_pk_load_seconds_total", "Time spent loading proving keys", [&store](){ return store.metrics().load_seconds; });
+    add_gauge("ethsnarks_pk_keys", "Proving keys loaded", [&store](){ return double(store.metrics().num_keys); });
+    add_gauge("ethsnarks_pk_resident_bytes", "Bytes of the proving keys loaded", [&store](){ return double(store.metrics().resident_bytes); });
+}
+
+
+void ProverMetrics::add_scheduler( const ProverScheduler& scheduler )
+{
+    add_gauge("ethsnarks_prover_queue_depth", "Proofs waiting to be admitted", [&scheduler](){ return double(scheduler.num_waiting()); });
+    add_gauge("ethsnarks_prover_busy_threads", "Threads of the proofs running", [&scheduler](){ return double(scheduler.busy_threads()); });
+    add_gauge("ethsnarks_prover_scheduler_threads", "Threads the scheduler admits proofs within", [&scheduler](){ return double(scheduler.num_threads()); });
+}
+
+
+void ProverMetrics::add_proving_key( const ProvingKeyT& pk )
+{
+    CSMemoryReport report;
+    cs_memory_proving_key(pk, report);
+    const double bytes = report.pk_bytes;
+    add_gauge("ethsnarks_pk_resident_bytes", "Bytes of the proving keys loaded", [bytes](){ return bytes; });
+}
+
+
+std::string ProverMetrics::to_prometheus() const
+{
+    std::ostringstream out;
+
+    // The values are read without the lock, they may take locks of their own
+    std::vector<Value> values;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        values = m_values;
+
+        write_header(out, "ethsnarks_proofs_total", "counter", "Proofs completed");
+        out << "ethsnarks_proofs_total " << m_proofs << "\n";
+
+        write_header(out, "ethsnarks_proof_errors_total", "counter", "Requests which failed before or while proving");
+        out << "ethsnarks_proof_errors_total " << m_errors << "\n";
+
+        write_header(out, "ethsnarks_proofs_in_progress", "gauge", "Proofs started and not yet finished");
+        out << "ethsnarks_proofs_in_progress " << m_in_progress << "\n";
+
+        write_header(out, "ethsnarks_prover_wall_seconds_total", "counter", "Wall time of the proofs completed");
+        out << "ethsnarks_prover_wall_seconds_total " << format_value(m_wall_seconds) << "\n";
+
+        write_header(out, "ethsnarks_prover_cpu_seconds_total", "counter", "CPU time of the proofs completed, of every thread");
+        out << "ethsnarks_prover_cpu_seconds_total " << format_value(m_cpu_seconds) << "\n";
+
+        write_header(out, "ethsnarks_prover_threads", "gauge", "Threads available to the prover");
+        out << "ethsnarks_prover_threads " << m_num_threads << "\n";
+
+        write_header(out, "ethsnarks_prover_start_time_seconds", "gauge", "Start time of the prover since the epoch");
+        out << "ethsnarks_prover_start_time_seconds " << format_value(m_start_time) << "\n";
+
+        write_header(out, "ethsnarks_proof_seconds", "histogram", "Latency of each proof");
+        write_histogram(out, "ethsnarks_proof_seconds", "", m_proof_seconds);
+
+        if( ! m_phase_seconds.empty() ) {
+            write_header(out, "ethsnarks_prover_phase_seconds", "histogram", "Latency of each phase of the prover");
+            for( const auto& it : m_phase_seconds ) {
+                write_histogram(out, "ethsnarks_prover_phase_seconds", "phase=\"" + escape_label(it.first) + "\",", it.second);
+            }
+        }
+    }
+
+    // A name may be added more than once, only its first value is exported
+    std::set<std::string> seen;
+    for( const auto& value : values )
+    {
+        if( ! seen.insert(value.name).second ) {
+            continue;
+        }
+        write_header(out, value.name, value.type.c_str(), value.help);
+        out << value.name << " " << format_value(value.value()) << "\n";
+    }
+
+    return out.str();
+}
+
+
+MetricsServer::MetricsServer( const ProverMetrics& in_metrics, unsigned int in_port ) :
+    m_metrics(in_metrics),
+    m_listener(-1),
+    m_port(in_port),
+    m_stopping(false)
+{
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if( listener < 0 ) {
+        std::cerr << "Error: cannot create socket" << std::endl;
+        return;
+    }
+
+    const int reuse = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(in_port);
+
+    socklen_t addr_size = sizeof(addr);
+    if( 0 != ::bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))
+     || 0 != ::listen(listener, 4)
+     || 0 != ::getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &addr_size) ) {
+        std::cerr << "Error: cannot listen on port " << in_port << std::endl;
+        ::close(listener);
+        return;
+    }
+
+    m_listener = listener;
+    m_port = ntohs(addr.sin_port);
+    m_thread = std::thread(&MetricsServer::run, this);
+}
+
+
+MetricsServer::~MetricsServer()
+{
+    if( m_listener < 0 ) {
+        return;
+    }
+
+    // Wakes the accept() of the server thread
+    m_stopping = true;
+    ::shutdown(m_listener, SHUT_RDWR);
+    m_thread.join();
+    ::close(m_listener);
+}
+
+
+void MetricsServer::run()
+{
+    while( ! m_stopping )
+    {
+        const int fd = ::accept(m_listener, nullptr, nullptr);
+        if( fd < 0 ) {
+            continue;
+        }
+
+        // A client which doesn't send its request can't hold up the others for long
+        struct timeval timeout = {1, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        // Only the request line matters, the rest of the headers are read and ignored
+        std::string request;
+        char buf[1024];
+        while( request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos && request.size() < 8192 )
+        {
+            const ssize_t n = ::read(fd, buf, sizeof(buf));
+            if( n <= 0 ) {
+                break;
+            }
+            request.append(buf, n);
+        }
+
+        std::string method;
+        std::string path;
+        std::istringstream(request.substr(0, request.find('\n'))) >> method >> path;
+
+        std::string status = "200 OK";
+        std::string body;
+        if( method != "GET" ) {
+            status = "405 Method Not Allowed";
+        }
+        else if( path == "/metrics" || path == "/" ) {
+            body = m_metrics.to_prometheus();
+        }
+        else {
+            status = "404 Not Found";
+        }
+
+        const std::string response =
+            "HTTP/1.1 " + status + "\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n"
+            "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            "Connection: close\r\n"
+            "\r\n" + body;
+
+        size_t sent = 0;
+        while( sent < response.size() )
+        {
+            const ssize_t n = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if( n <= 0 ) {
+                break;
+            }
+            sent += n;
+        }
+
+        ::close(fd);
+    }
+}
+
+
+// namespace ethsnarks
+}
@@ -0,0 +1,153 @@
+#ifndef ETHSNARKS_PROVER_METRICS_HPP_
+#define ETHSNARKS_PROVER_METRICS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+class ProofCache;
+class ProverScheduler;
+class ProvingKeyStore;
+
+
+/**
+* A Prometheus histogram, the counts are per bucket rather than cumulative
+*/
+struct MetricsHistogram {
+    std::vector<double> bounds;
+    std::vector<size_t> counts;     // one more than bounds, the last is +Inf
+    double sum = 0;
+    size_t count = 0;
+
+    explicit MetricsHistogram( const std::vector<double>& in_bounds );
+
+    void observe( double value );
+};
+
+
+/**
+* What a long-lived prover has done, exported in the Prometheus text format
+*
+* Proofs are counted with their wall and CPU time, and the latency of each
+* proof and of each phase of its ProverStats go into histograms of seconds.
+* Rates, e.g. proofs per second or thread utilisation, are derived from the
+* counters by Prometheus:
+*
+*   rate(ethsnarks_proofs_total[1m])
+*   rate(ethsnarks_prover_cpu_seconds_total[1m]) / ethsnarks_prover_threads
+*
+* Anything else, e.g. queue depth or the bytes of the loaded keys, is read
+* when the metrics are exported from the gauges and counters added with
+* add_gauge() and add_counter(). Every method may be called from any thread.
+*/
+class ProverMetrics
+{
+public:
+    typedef std::function<double()> ValueFnT;
+
+    /** The seconds of the histogram buckets, 1ms to 100s */
+    static const std::vector<double>& default_buckets();
+
+    explicit ProverMetrics( unsigned int num_threads = 0 );
+
+    ProverMetrics( const ProverMetrics& ) = delete;
+    ProverMetrics& operator=( const ProverMetrics& ) = delete;
+
+    /** A proof has started, it's in progress until recorded */
+    void begin_proof();
+
+    /**
+    * A proof has finished, with the phases of `stats` unless it's null or
+    * has no phases, e.g. when the proof came from a cache
+    */
+    void record_proof( double wall_seconds, double cpu_seconds, const libsnark::ProverStats *stats = nullptr );
+
+    void record_error();
+
+    void add_gauge( const std::string& name, const std::string& help, const ValueFnT& value );
+
+    void add_counter( const std::string& name, const std::string& help, const ValueFnT& value );
+
+    /** Hits, misses and entries */
+    void add_proof_cache( const ProofCache& cache );
+
+    /** Hits, misses, evictions, load time, keys and resident bytes */
+    void add_key_store( const ProvingKeyStore& store );
+
+    /** Queue depth, busy threads and the thread budget */
+    void add_scheduler( const ProverScheduler& scheduler );
+
+    /** The bytes of a proving key which is held for the prover's lifetime */
+    void add_proving_key( const ProvingKeyT& pk );
+
+    std::string to_prometheus() const;
+
+protected:
+    struct Value {
+        std::string name;
+        std::string type;
+        std::string help;
+        ValueFnT value;
+    };
+
+    const unsigned int m_num_threads;
+    const double m_start_time;
+
+    mutable std::mutex m_mutex;
+    size_t m_proofs = 0;
+    size_t m_errors = 0;
+    size_t m_in_progress = 0;
+    double m_wall_seconds = 0;
+    double m_cpu_seconds = 0;
+    MetricsHistogram m_proof_seconds;
+    std::map<std::string, MetricsHistogram> m_phase_seconds;
+    std::vector<Value> m_values;
+};
+
+
+/**
+* Answers each HTTP request on a TCP port with the metrics, one at a time on
+* its own thread: `GET /metrics` (or `/`) gets the text format, anything
+* else 404. With port 0 any free port is used, see port().
+*/
+class MetricsServer
+{
+public:
+    MetricsServer( const ProverMetrics& in_metrics, unsigned int in_port );
+
+    /** Stops listening, and waits for the request being answered */
+    ~MetricsServer();
+
+    MetricsServer( const MetricsServer& ) = delete;
+    MetricsServer& operator=( const MetricsServer& ) = delete;
+
+    /** False if the port couldn't be listened on */
+    bool listening() const { return m_listener >= 0; }
+
+    unsigned int port() const { return m_port; }
+
+protected:
+    void run();
+
+    const ProverMetrics& m_metrics;
+    int m_listener;
+    unsigned int m_port;
+    std::atomic<bool> m_stopping;
+    std::thread m_thread;
+};
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PROVER_METRICS_HPP_
+#endif
@@ -0,0 +1,369 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+#include "prover_numa.hpp"
+
+
+namespace ethsnarks {
+
+
+#ifdef __linux__
+
+// MPOL_MF_MOVE of <linux/mempolicy.h>, move the pages only mapped by this process
+static const int NUMA_MPOL_MF_MOVE = 1 << 1;
+
+// Nodes are numbered densely in practice, this bounds the scan of sysfs
+static const int NUMA_MAX_NODES = 256;
+
+
+/**
+* Parse a sysfs CPU list, e.g. `0-3,8-11`
+*/
+static bool read_cpu_list( const std::string& path, std::vector<int>& out )
+{
+    std::ifstream fh(path);
+    std::string text;
+    if( ! std::getline(fh, text) ) {
+        return false;
+    }
+
+    std::stringstream ss(text);
+    std::string item;
+    while( std::getline(ss, item, ',') )
+    {
+        if( item.empty() ) {
+            continue;
+        }
+
+        const auto dash = item.find('-');
+        const int first = std::atoi(item.c_str());
+        const int last = dash == std::string::npos ? first : std::atoi(item.c_str() + dash + 1);
+        for( int cpu = first; cpu <= last; cpu++ ) {
+            out.push_back(cpu);
+        }
+    }
+
+    return true;
+}
+
+
+static std::map<int, int> cpu_nodes()
+{
+    std::map<int, int> result;
+    for( int node = 0; node < NUMA_MAX_NODES; node++ )
+    {
+        std::vector<int> cpus;
+        if( ! read_cpu_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", cpus) ) {
+            continue;
+        }
+        for( int cpu : cpus ) {
+            result[cpu] = node;
+        }
+    }
+    return result;
+}
+
+
+/**
+* 0 for the first hardware thread of the CPU's core, 1 for the second etc.
+*/
+static int cpu_sibling_index( int cpu )
+{
+    std::vector<int> siblings;
+    if( ! read_cpu_list("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list", siblings) ) {
+        return 0;
+    }
+
+    const auto it = std::find(siblings.begin(), siblings.end(), cpu);
+    return it == siblings.end() ? 0 : int(it - siblings.begin());
+}
+
+
+std::vector<int> numa_worker_cpus( bool smt )
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if( 0 != sched_getaffinity(0, sizeof(allowed), &allowed) ) {
+        return std::vector<int>();
+    }
+
+    const auto nodes = cpu_nodes();
+
+    // (node, sibling, cpu)
+    std::vector<std::tuple<int, int, int>> order;
+    for( int cpu = 0; cpu < CPU_SETSIZE; cpu++ )
+    {
+        if( ! CPU_ISSET(cpu, &allowed) ) {
+            continue;
+        }
+
+        const int sibling = cpu_sibling_index(cpu);
+        if( ! smt && sibling > 0 ) {
+            continue;
+        }
+
+        const auto it = nodes.find(cpu);
+        order.emplace_back(it == nodes.end() ? 0 : it->second, sibling, cpu);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<int> result;
+    for( const auto& it : order ) {
+        result.push_back(std::get<2>(it));
+    }
+    return result;
+}
+
+
+static int read_topology_id( int cpu, const char *name )
+{
+    std::ifstream fh("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+    int id = 0;
+    return (fh >> id) ? id : 0;
+}
+
+
+CPUTopology cpu_topology()
+{
+    CPUTopology result;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if( 0 != sched_getaffinity(0, sizeof(allowed), &allowed) ) {
+        return result;
+    }
+
+    // Core ids are only unique within a socket
+    std::vector<std::pair<int, int>> cores;
+    std::vector<int> sockets;
+    for( int cpu = 0; cpu < CPU_SETSIZE; cpu++ )
+    {
+        if( ! CPU_ISSET(cpu, &allowed) ) {
+            continue;
+        }
+
+        const int socket = read_topology_id(cpu, "physical_package_id");
+        const auto core = std::make_pair(socket, read_topology_id(cpu, "core_id"));
+        if( std::find(cores.begin(), cores.end(), core) == cores.end() ) {
+            cores.push_back(core);
+        }
+        if( std::find(sockets.begin(), sockets.end(), socket) == sockets.end() ) {
+            sockets.push_back(socket);
+        }
+        result.hw_threads++;
+    }
+
+    result.cores = cores.size();
+    result.sockets = sockets.size();
+    return result;
+}
+
+
+size_t numa_num_nodes()
+{
+    const auto nodes = cpu_nodes();
+    std::vector<int> used;
+    for( int cpu : numa_worker_cpus(true) )
+    {
+        const auto it = nodes.find(cpu);
+        const int node = it == nodes.end() ? 0 : it->second;
+        if( std::find(used.begin(), used.end(), node) == used.end() ) {
+            used.push_back(node);
+        }
+    }
+    return used.size();
+}
+
+
+bool numa_pin_workers( unsigned int num_threads, bool smt )
+{
+    const auto cpus = numa_worker_cpus(smt);
+    if( cpus.empty() ) {
+        return false;
+    }
+
+    std::atomic<bool> ok(true);
+
+#ifdef MULTICORE
+#pragma omp parallel num_threads(num_threads)
+#else
+    num_threads = 1;
+#endif
+    {
+#ifdef MULTICORE
+        const size_t i = omp_get_thread_num();
+#else
+        const size_t i = 0;
+#endif
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[i % cpus.size()], &set);
+        if( 0 != pthread_setaffinity_np(pthread_self(), sizeof(set), &set) ) {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+
+bool numa_place_ranges( const void *data, size_t elem_size, size_t n, unsigned int num_threads )
+{
+    if( n == 0 ) {
+        return true;
+    }
+
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t base = uintptr_t(data);
+    const auto ranges = libsnark::get_cpu_ranges(0, n, num_threads);
+
+    std::atomic<bool> ok(true);
+
+#ifdef MULTICORE
+#pragma omp parallel for schedule(static, 1) num_threads(ranges.size())
+#endif
+    for( size_t r = 0; r < ranges.size(); r++ )
+    {
+        unsigned int cpu = 0;
+        unsigned int node = 0;
+        if( 0 != syscall(SYS_getcpu, &cpu, &node, nullptr) ) {
+            ok = false;
+            continue;
+        }
+
+        // Each range owns the pages which begin inside it, the first owns the partial page before it
+        const uintptr_t begin = base + ranges[r].first * elem_size;
+        const uintptr_t end = base + ranges[r].second * elem_size;
+        uintptr_t page = r == 0 ? (begin & ~(page_size - 1)) : ((begin + page_size - 1) & ~(page_size - 1));
+
+        std::vector<void*> pages;
+        for( ; page < end; page += page_size ) {
+            pages.push_back(reinterpret_cast<void*>(page));
+        }
+        if( pages.empty() ) {
+            continue;
+        }
+
+        const std::vector<int> nodes(pages.size(), int(node));
+        std::vector<int> status(pages.size());
+        if( syscall(SYS_move_pages, 0, pages.size(), pages.data(), nodes.data(), status.data(), NUMA_MPOL_MF_MOVE) < 0 ) {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+#else
+
+std::vector<int> numa_worker_cpus( bool )
+{
+    return std::vector<int>();
+}
+
+
+CPUTopology cpu_topology()
+{
+    return CPUTopology();
+}
+
+
+size_t numa_num_nodes()
+{
+    return 1;
+}
+
+
+bool numa_pin_workers( unsigned int, bool )
+{
+    return false;
+}
+
+
+bool numa_place_ranges( const void *, size_t, size_t, unsigned int )
+{
+    return false;
+}
+
+#endif
+
+
+void smt_plan_config( libsnark::Config& config )
+{
+    if( ! config.smt || config.msm_threads > 0 ) {
+        return;
+    }
+
+    const auto topology = cpu_topology();
+    if( topology.cores == 0 || topology.cores >= topology.hw_threads ) {
+        return;
+    }
+
+    // The same share of the cores as num_threads is of the hardware threads
+    const unsigned int per_core = (topology.hw_threads + topology.cores - 1) / topology.cores;
+    config.msm_threads = std::max(1u, config.num_threads / per_core);
+
+    std::cerr << "SMT plan: " << topology.sockets << " sockets, " << topology.cores << " cores, "
+              << topology.hw_threads << " hardware threads; FFT " << config.num_threads
+              << " threads, MSM " << config.msm_threads << " threads" << std::endl;
+}
+
+
+template<typename T>
+static bool numa_place_fixed_base( const libsnark::FixedBaseTable<T>& table, unsigned int num_threads )
+{
+    // The fixed-base multi-exp splits by base, each base has num_windows points
+    return table.empty() || numa_place_ranges(table.points.data(), table.num_windows * sizeof(T), table.num_bases, num_threads);
+}
+
+
+bool numa_place_prover_context( ProverContextT& context )
+{
+    const auto& config = context.config;
+
+    if( ! numa_pin_workers(config.num_threads, config.smt) ) {
+        std::cerr << "Warning: cannot pin the prover's workers to CPUs" << std::endl;
+        return false;
+    }
+
+    // The pinning still keeps workers on the same cores between proofs
+    if( numa_num_nodes() < 2 ) {
+        return true;
+    }
+
+    const auto& pk = context.provingKey;
+    const bool ok = numa_place_ranges(pk.H_query.data(), sizeof(pk.H_query[0]), pk.H_query.size(), config.num_threads)
+                 && numa_place_ranges(pk.L_query.data(), sizeof(pk.L_query[0]), pk.L_query.size(), config.num_threads)
+                 && numa_place_fixed_base(context.H_fixed, config.num_threads)
+                 && numa_place_fixed_base(context.L_fixed, config.num_threads);
+
+    if( ! ok ) {
+        std::cerr << "Warning: cannot move the H and L queries to the nodes of their workers" << std::endl;
+    }
+
+    return ok;
+}
+
+
+// namespace ethsnarks
+}
@@ -0,0 +1,81 @@
+#ifndef ETHSNARKS_PROVER_NUMA_HPP_
+#define ETHSNARKS_PROVER_NUMA_HPP_
+
+#include "ethsnarks.hpp"
+#include "prover_config.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* With config.numa the prover's OpenMP workers are pinned one per CPU, and
+* the H and L query bases are moved so that each get_cpu_ranges range is on
+* the NUMA node of the worker which reads it in the multi-exps.
+*
+* This relies on the multi-exps giving range `i` to OpenMP thread `i`, as
+* their `schedule(static)` loops over the ranges do, and on OpenMP re-using
+* the same pool of threads for each parallel region.
+*/
+
+/**
+* The CPUs which the process may run on, in the order workers are pinned to
+* them: by NUMA node, then the first hardware thread of every core before the
+* second ones. Without `smt` only the first hardware thread of each core.
+*/
+std::vector<int> numa_worker_cpus( bool smt );
+
+/** The number of NUMA nodes with CPUs which the process may run on */
+size_t numa_num_nodes();
+
+/**
+* Pin OpenMP thread `i` of a `num_threads` team to the `i`th of the
+* numa_worker_cpus(), wrapping around when there are fewer CPUs. Thread 0 is
+* the calling thread.
+*/
+bool numa_pin_workers( unsigned int num_threads, bool smt );
+
+/**
+* Move the pages of `n` elements of `elem_size` bytes, which are split into
+* get_cpu_ranges(0, n, num_threads), to the node of the pinned worker of each
+* range. A page which straddles two ranges goes with the first.
+*/
+bool numa_place_ranges( const void *data, size_t elem_size, size_t n, unsigned int num_threads );
+
+/**
+* The CPUs which the process may run on: hardware threads, the physical
+* cores they belong to and the sockets of those
+*/
+struct CPUTopology
+{
+    unsigned int hw_threads = 0;
+    unsigned int cores = 0;
+    unsigned int sockets = 0;
+};
+
+CPUTopology cpu_topology();
+
+/**
+* With config.smt, plan the threads of each phase of the prover: the FFTs
+* and the witness map are memory bound and use the SMT siblings, all of
+* config.num_threads, while the multi-exps are limited to one thread per
+* physical core of that share of the machine, as two hyperthreads filling
+* buckets in one core's L1 and L2 evict each other's. A config.msm_threads
+* which is already set is kept. Without config.smt nothing changes.
+*
+* With config.numa too the workers are pinned to the first hardware thread
+* of every core before the siblings, so the smaller team of the multi-exps
+* runs one thread per core.
+*/
+void smt_plan_config( libsnark::Config& config );
+
+/**
+* Pin the workers and place the H and L queries of the context's proving key,
+* and its fixed-base tables if there are any, for context.config
+*/
+bool numa_place_prover_context( ProverContextT& context );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PROVER_NUMA_HPP_
+#endif
@@ -0,0 +1,290 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <chrono>
+#include <cstdlib>      // getenv
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>     // gethostname
+
+#include "prover_profile.hpp"
+#include "stubs.hpp"
+
+using json = nlohmann::json;
+
+namespace ethsnarks {
+
+
+static std::string get_hostname()
+{
+    char name[256] = {0};
+    if( 0 != ::gethostname(name, sizeof(name) - 1) ) {
+        return "localhost";
+    }
+    return std::string(name);
+}
+
+
+std::string prover_profile_path( const char *pk_file )
+{
+    return std::string(pk_file) + "." + get_hostname() + ".profile.json";
+}
+
+
+json config_to_json( const libsnark::Config& config )
+{
+    json out;
+    out["num_threads"] = config.num_threads;
+    out["smt"] = config.smt;
+    out["fft"] = config.fft;
+    out["radixes"] = config.radixes;
+    out["swapAB"] = config.swapAB;
+    out["multi_exp_c"] = config.multi_exp_c;
+    out["multi_exp_method"] = config.multi_exp_method;
+    out["multi_exp_prefetch_locality"] = config.multi_exp_prefetch_locality;
+    out["prefetch_stride"] = config.prefetch_stride;
+    out["multi_exp_look_ahead"] = config.multi_exp_look_ahead;
+    out["parallel_multi_exp"] = config.parallel_multi_exp;
+    out["fixed_base_c"] = config.fixed_base_c;
+    out["msm_backend"] = config.msm_backend;
+    out["numa"] = config.numa;
+    out["huge_pages"] = config.huge_pages;
+    out["stream_budget_mb"] = config.stream_budget_mb;
+    out["msm_threads"] = config.msm_threads;
+    return out;
+}
+
+
+void config_from_json( const json& in_tree, libsnark::Config& config )
+{
+    // Only the keys which are present are changed, the rest keep their value
+    config.num_threads = in_tree.value("num_threads", config.num_threads);
+    config.smt = in_tree.value("smt", config.smt);
+    config.fft = in_tree.value("fft", config.fft);
+    config.radixes = in_tree.value("radixes", config.radixes);
+    config.swapAB = in_tree.value("swapAB", config.swapAB);
+    config.multi_exp_c = in_tree.value("multi_exp_c", config.multi_exp_c);
+    config.multi_exp_method = in_tree.value("multi_exp_method", config.multi_exp_method);
+    config.multi_exp_prefetch_locality = in_tree.value("multi_exp_prefetch_locality", config.multi_exp_prefetch_locality);
+    config.prefetch_stride = in_tree.value("prefetch_stride", config.prefetch_stride);
+    config.multi_exp_look_ahead = in_tree.value("multi_exp_look_ahead", config.multi_exp_look_ahead);
+    config.parallel_multi_exp = in_tree.value("parallel_multi_exp", config.parallel_multi_exp);
+    config.fixed_base_c = in_tree.value("fixed_base_c", config.fixed_base_c);
+    config.msm_backend = in_tree.value("msm_backend", config.msm_backend);
+    config.numa = in_tree.value("numa", config.numa);
+    config.huge_pages = in_tree.value("huge_pages", config.huge_pages);
+    config.stream_budget_mb = in_tree.value("stream_budget_mb", config.stream_budget_mb);
+    config.msm_threads = in_tree.value("msm_threads", config.msm_threads);
+}
+
+
+bool load_prover_profile( const char *pk_file, size_t num_constraints, libsnark::Config& config )
+{
+    std::ifstream fh(prover_profile_path(pk_file));
+    if( ! fh.is_open() ) {
+        return false;
+    }
+
+    json profile;
+    try {
+        fh >> profile;
+    }
+    catch( const json::exception& ex ) {
+        std::cerr << "Warning: ignoring invalid prover profile: " << ex.what() << std::endl;
+        return false;
+    }
+
+    if( profile.value("num_constraints", size_t(0)) != num_constraints ) {
+        std::cerr << "Warning: ignoring prover profile made for a different circuit" << std::endl;
+        return false;
+    }
+
+    config_from_json(profile["config"], config);
+
+    return true;
+}
+
+
+bool save_prover_profile( const char *pk_file, size_t num_constraints, const libsnark::Config& config, double seconds )
+{
+    json profile;
+    profile["host"] = get_hostname();
+    profile["num_constraints"] = num_constraints;
+    profile["seconds"] = seconds;
+    profile["config"] = config_to_json(config);
+
+    std::ofstream fh(prover_profile_path(pk_file));
+    if( ! fh.is_open() ) {
+        return false;
+    }
+    fh << profile.dump(4) << std::endl;
+
+    return fh.good();
+}
+
+
+static bool read_json( std::istream& in, json& out, const char *what )
+{
+    try {
+        in >> out;
+    }
+    catch( const json::exception& ex ) {
+        std::cerr << "Warning: ignoring invalid " << what << ": " << ex.what() << std::endl;
+        return false;
+    }
+
+    if( ! out.is_object() ) {
+        std::cerr << "Warning: ignoring " << what << ", it isn't an object" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool load_config_profiles( const char *profiles_file, const std::string& circuit_name, size_t domain_size, libsnark::Config& config )
+{
+    std::ifstream fh(profiles_file);
+    if( ! fh.is_open() ) {
+        std::cerr << "Warning: cannot open prover profiles " << profiles_file << std::endl;
+        return false;
+    }
+
+    json profiles;
+    if( ! read_json(fh, profiles, "prover profiles") ) {
+        return false;
+    }
+
+    const auto apply = [&config]( const json& section, const std::string& key ) {
+        if( section.is_object() && section.count(key) ) {
+            config_from_json(section[key], config);
+        }
+    };
+
+    try {
+        apply(profiles, "default");
+        if( profiles.count("domain_size") ) {
+            apply(profiles["domain_size"], std::to_string(domain_size));
+        }
+        if( profiles.count("circuits") && ! circuit_name.empty() ) {
+            apply(profiles["circuits"], circuit_name);
+        }
+    }
+    catch( const json::exception& ex ) {
+        std::cerr << "Warning: invalid prover profiles " << profiles_file << ": " << ex.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+void config_from_env( const std::string& circuit_name, size_t domain_size, libsnark::Config& config )
+{
+    const char *profiles_file = ::getenv("ETHSNARKS_PROVER_PROFILES");
+    if( profiles_file && *profiles_file ) {
+        load_config_profiles(profiles_file, circuit_name, domain_size, config);
+    }
+
+    const char *inline_config = ::getenv("ETHSNARKS_PROVER_CONFIG");
+    if( inline_config && *inline_config )
+    {
+        std::istringstream in(inline_config);
+        json tree;
+        try {
+            if( read_json(in, tree, "ETHSNARKS_PROVER_CONFIG") ) {
+                config_from_json(tree, config);
+            }
+        }
+        catch( const json::exception& ex ) {
+            std::cerr << "Warning: invalid ETHSNARKS_PROVER_CONFIG: " << ex.what() << std::endl;
+        }
+    }
+}
+
+
+std::string circuit_name_from_path( const char *path )
+{
+    std::string name(path);
+    const auto slash = name.rfind('/');
+    if( slash != std::string::npos ) {
+        name = name.substr(slash + 1);
+    }
+
+    const auto dot = name.find('.');
+    return name.substr(0, dot);
+}
+
+
+void load_prover_config( const char *pk_file, const std::string& circuit_name, const ProtoboardT& pb, libsnark::Config& config )
+{
+    load_prover_profile(pk_file, pb.num_constraints(), config);
+
+    // As the domain of get_domain
+    const size_t min_size = pb.num_constraints() + pb.num_inputs() + 1;
+    size_t domain_size = 1;
+    while( domain_size < min_size ) {
+        domain_size <<= 1;
+    }
+
+    config_from_env(circuit_name, domain_size, config);
+}
+
+
+static double time_prove( ProverContextT& context, ProtoboardT& pb, const libsnark::Config& config )
+{
+    init_prover_context(context, pb, config);
+
+    const auto begin = std::chrono::steady_clock::now();
+    prove(context, pb);
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+
+libsnark::Config tune_prover_config( ProverContextT& context, ProtoboardT& pb, double& best_seconds )
+{
+    libsnark::Config best = context.config;
+
+    // Warm up caches and page in the proving key before timing anything
+    time_prove(context, pb, best);
+    best_seconds = time_prove(context, pb, best);
+
+    auto sweep = [&]( const char *name, std::function<void(libsnark::Config&, unsigned int)> apply, const std::vector<unsigned int>& values ) {
+        for( auto value : values )
+        {
+            libsnark::Config candidate = best;
+            apply(candidate, value);
+
+            const double seconds = time_prove(context, pb, candidate);
+            std::cerr << "# " << name << "=" << value << " " << seconds << "s" << std::endl;
+
+            if( seconds < best_seconds ) {
+                best_seconds = seconds;
+                best = candidate;
+            }
+        }
+    };
+
+    sweep("fft", [](libsnark::Config& c, unsigned int v){ c.fft = v ? "basic_radix2" : "recursive"; }, {0, 1});
+    sweep("multi_exp_c", [](libsnark::Config& c, unsigned int v){ c.multi_exp_c = v; }, {0, 10, 12, 14, 16, 18, 20});
+    sweep("multi_exp_method", [](libsnark::Config& c, unsigned int v){ c.multi_exp_method = v ? "sorted" : "bdlo12"; }, {0, 1});
+    sweep("multi_exp_prefetch_locality", [](libsnark::Config& c, unsigned int v){ c.multi_exp_prefetch_locality = v; }, {0, 1, 2, 3, 4});
+    sweep("prefetch_stride", [](libsnark::Config& c, unsigned int v){ c.prefetch_stride = v; }, {64, 128, 256, 512});
+    sweep("multi_exp_look_ahead", [](libsnark::Config& c, unsigned int v){ c.multi_exp_look_ahead = v; }, {1, 2, 4, 8});
+    sweep("swapAB", [](libsnark::Config& c, unsigned int v){ c.swapAB = v; }, {0, 1});
+#ifdef MULTICORE
+    sweep("parallel_multi_exp", [](libsnark::Config& c, unsigned int v){ c.parallel_multi_exp = v; }, {0, 1});
+    sweep("msm_threads", [](libsnark::Config& c, unsigned int v){ c.msm_threads = v; }, {best.num_threads / 2, best.num_threads});
+#endif
+
+    init_prover_context(context, pb, best);
+
+    return best;
+}
+
+// namespace ethsnarks
+}
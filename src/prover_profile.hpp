@@ -0,0 +1,70 @@
+#ifndef ETHSNARKS_PROVER_PROFILE_HPP_
+#define ETHSNARKS_PROVER_PROFILE_HPP_
+
+#include "ethsnarks.hpp"
+#include "prover_config.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* A prover profile records the best libsnark::Config found for a specific
+* circuit (proving key) on a specific host, it's stored next to the proving
+* key as `<proving-key>.<hostname>.profile.json`
+*/
+std::string prover_profile_path( const char *pk_file );
+
+nlohmann::json config_to_json( const libsnark::Config& config );
+
+void config_from_json( const nlohmann::json& in_tree, libsnark::Config& config );
+
+/**
+* Load the profile for the proving key on this host into `config`, if one
+* exists and was made for a circuit with the same number of constraints.
+*/
+bool load_prover_profile( const char *pk_file, size_t num_constraints, libsnark::Config& config );
+
+bool save_prover_profile( const char *pk_file, size_t num_constraints, const libsnark::Config& config, double seconds );
+
+/**
+* Deployment profiles, shared by many circuits and hosts, are a JSON file of
+* configs applied in turn: the `"default"`, then the one for the domain size
+* in `"domain_size"`, then the one for the circuit name in `"circuits"`:
+*
+*   {"default": {"num_threads": 8},
+*    "domain_size": {"1048576": {"fft": "basic_radix2", "multi_exp_c": 16}},
+*    "circuits": {"transfer": {"fixed_base_c": 12}}}
+*
+* Each only changes the keys it has, see config_from_json. Returns false if
+* the file can't be read.
+*/
+bool load_config_profiles( const char *profiles_file, const std::string& circuit_name, size_t domain_size, libsnark::Config& config );
+
+/**
+* Apply the environment: the profiles file named by ETHSNARKS_PROVER_PROFILES,
+* then the config given as a JSON object by ETHSNARKS_PROVER_CONFIG
+*/
+void config_from_env( const std::string& circuit_name, size_t domain_size, libsnark::Config& config );
+
+/** The name of a circuit or key file, without its directory or extension */
+std::string circuit_name_from_path( const char *path );
+
+/**
+* The config to prove the circuit with: this host's tuned profile of the
+* proving key, if any, then the environment, which takes precedence
+*/
+void load_prover_config( const char *pk_file, const std::string& circuit_name, const ProtoboardT& pb, libsnark::Config& config );
+
+/**
+* Find the fastest configuration for the context's circuit by proving `pb`
+* repeatedly, tuning one parameter at a time while holding the others at the
+* best value found so far. Returns the best configuration, its time is
+* written to `best_seconds`.
+*/
+libsnark::Config tune_prover_config( ProverContextT& context, ProtoboardT& pb, double& best_seconds );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PROVER_PROFILE_HPP_
+#endif
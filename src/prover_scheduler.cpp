@@ -0,0 +1,238 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <future>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+#include "prover_scheduler.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok.hpp"
+
+
+namespace ethsnarks {
+
+
+struct ProverScheduler::Job
+{
+    ProverContextT* context;
+    std::vector<FieldT> values;
+    int priority;
+    bool binary;
+    std::function<void(const char*)> progress;
+    std::shared_ptr<ProveTask> task;
+    std::promise<std::string> proof;
+};
+
+
+static unsigned int default_num_threads()
+{
+#ifdef MULTICORE
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+
+ProverScheduler::ProverScheduler( unsigned int num_threads, unsigned int reserved_threads ) :
+    m_num_threads(num_threads ? num_threads : default_num_threads()),
+    m_reserved_threads(std::min(reserved_threads, m_num_threads - 1))
+{
+    // Every proof takes at least one thread, so there's never more running
+    for( unsigned int i = 0; i < m_num_threads; i++ ) {
+        m_workers.emplace_back(&ProverScheduler::worker, this);
+    }
+}
+
+
+ProverScheduler::~ProverScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        for( auto& job : m_waiting ) {
+            job->proof.set_exception(std::make_exception_ptr(libsnark::r1cs_gg_ppzksnark_zok_cancelled("scheduler")));
+        }
+        m_waiting.clear();
+    }
+    m_admit.notify_all();
+    m_idle.notify_all();
+
+    for( auto& t : m_workers ) {
+        t.join();
+    }
+}
+
+
+std::shared_ptr<ProveTask> ProverScheduler::submit( ProverContextT& context, const ProtoboardT& pb, int priority, bool binary, const std::function<void(const char*)>& progress )
+{
+    auto job = std::make_shared<Job>();
+    job->context = &context;
+    job->values = pb.values;
+    job->priority = priority;
+    job->binary = binary;
+    job->progress = progress;
+    job->task = std::make_shared<ProveTask>();
+    job->task->proof = job->proof.get_future();
+
+    auto task = job->task;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Highest priority first, then in the order submitted
+        auto it = std::find_if(m_waiting.begin(), m_waiting.end(), [priority] (const std::shared_ptr<Job>& other) {
+            return other->priority < priority;
+        });
+        m_waiting.insert(it, std::move(job));
+    }
+    m_admit.notify_all();
+
+    return task;
+}
+
+
+void ProverScheduler::suspend()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_suspended = true;
+}
+
+
+void ProverScheduler::resume()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_suspended = false;
+    }
+    m_admit.notify_all();
+}
+
+
+void ProverScheduler::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_stopping || (m_waiting.empty() && m_running == 0); });
+}
+
+
+unsigned int ProverScheduler::busy_threads() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_busy_threads;
+}
+
+
+size_t ProverScheduler::num_waiting() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_waiting.size();
+}
+
+
+unsigned int ProverScheduler::thread_limit( int priority ) const
+{
+    return priority > 0 ? m_num_threads : m_num_threads - m_reserved_threads;
+}
+
+
+unsigned int ProverScheduler::budget( const Job& job ) const
+{
+    return std::max(1u, std::min(job.context->config.num_threads, thread_limit(job.priority)));
+}
+
+
+std::shared_ptr<ProverScheduler::Job> ProverScheduler::next_job()
+{
+    for( auto it = m_waiting.begin(); it != m_waiting.end(); )
+    {
+        auto& job = *it;
+
+        if( job->task->cancelled ) {
+            job->proof.set_exception(std::make_exception_ptr(libsnark::r1cs_gg_ppzksnark_zok_cancelled("queued")));
+            it = m_waiting.erase(it);
+            continue;
+        }
+
+        if( m_busy_contexts.count(job->context) ) {
+            it++;
+            continue;
+        }
+
+        // A proof which doesn't fit holds back all of those after it
+        if( m_busy_threads + budget(*job) > thread_limit(job->priority) ) {
+            break;
+        }
+
+        auto result = std::move(job);
+        m_waiting.erase(it);
+        return result;
+    }
+
+    if( m_waiting.empty() && m_running == 0 ) {
+        m_idle.notify_all();
+    }
+
+    return nullptr;
+}
+
+
+void ProverScheduler::worker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while( true )
+    {
+        std::shared_ptr<Job> job;
+        m_admit.wait(lock, [this, &job] {
+            if( m_stopping ) {
+                return true;
+            }
+            if( ! m_suspended ) {
+                job = next_job();
+            }
+            return job != nullptr;
+        });
+
+        if( ! job ) {
+            return;
+        }
+
+        const unsigned int threads = budget(*job);
+        m_busy_threads += threads;
+        m_busy_contexts.insert(job->context);
+        m_running++;
+        lock.unlock();
+
+        // Within this thread the kernels' teams are limited to the budget
+#ifdef MULTICORE
+        omp_set_num_threads(threads);
+#endif
+
+        auto& context = *job->context;
+        context.cancel = &job->task->cancelled;
+        context.progress = job->progress;
+        try {
+            job->proof.set_value(prove_assignment(context, job->values, job->binary));
+        }
+        catch( ... ) {
+            job->proof.set_exception(std::current_exception());
+        }
+        context.cancel = nullptr;
+        context.progress = nullptr;
+
+        lock.lock();
+        m_busy_threads -= threads;
+        m_busy_contexts.erase(job->context);
+        m_running--;
+        if( m_waiting.empty() && m_running == 0 ) {
+            m_idle.notify_all();
+        }
+        m_admit.notify_all();
+    }
+}
+
+
+// namespace ethsnarks
+}
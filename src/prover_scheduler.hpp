@@ -0,0 +1,107 @@
+#ifndef ETHSNARKS_PROVER_SCHEDULER_HPP_
+#define ETHSNARKS_PROVER_SCHEDULER_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "ethsnarks.hpp"
+#include "stubs.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Runs the proofs of any number of circuits, each with its own ProverContext,
+* within one budget of threads
+*
+* A proof is admitted when the threads of its context's config.num_threads
+* are free, and runs on one of the scheduler's persistent threads with its
+* OpenMP threads limited to that budget, so the kernels which ask
+* omp_get_max_threads() get the same answer. Concurrent proofs then share
+* the machine instead of each sizing its teams for all of it.
+*
+* Waiting proofs are admitted highest priority first, and in the order they
+* were submitted within a priority. A proof which doesn't fit in the free
+* threads stops any after it from being admitted, so that large proofs
+* aren't starved by a stream of small ones. A context proves one proof at a
+* time, proofs waiting for their context are passed over.
+*
+* Proofs of priority 0 may only use the threads which aren't reserved, the
+* rest are kept for proofs of a higher priority, which are then only ever
+* delayed by each other.
+*/
+class ProverScheduler
+{
+public:
+    /** Threads default to omp_get_max_threads() */
+    explicit ProverScheduler( unsigned int num_threads = 0, unsigned int reserved_threads = 0 );
+
+    /** Waits for the running proofs, the waiting ones are cancelled */
+    ~ProverScheduler();
+
+    ProverScheduler( const ProverScheduler& ) = delete;
+    ProverScheduler& operator=( const ProverScheduler& ) = delete;
+
+    /**
+    * Queue a proof of the protoboard's current values, which are copied.
+    * The context must be bound to the protoboard's constraint system and not
+    * be used outside of the scheduler until every proof of it has finished.
+    * Releasing the task doesn't cancel the proof, call cancel() for that.
+    */
+    std::shared_ptr<ProveTask> submit( ProverContextT& context, const ProtoboardT& pb, int priority = 0, bool binary = false, const std::function<void(const char*)>& progress = nullptr );
+
+    /** Stop admitting proofs, those which are running carry on */
+    void suspend();
+
+    void resume();
+
+    /** Block until no proofs are waiting or running */
+    void wait();
+
+    unsigned int num_threads() const { return m_num_threads; }
+
+    /** Threads of the proofs which are running */
+    unsigned int busy_threads() const;
+
+    size_t num_waiting() const;
+
+protected:
+    struct Job;
+
+    /** Threads which proofs of the priority may be admitted up to */
+    unsigned int thread_limit( int priority ) const;
+
+    /** Threads of the job's proof, its context's config.num_threads within the limit */
+    unsigned int budget( const Job& job ) const;
+
+    /** The next job to run, or nullptr, with the lock held */
+    std::shared_ptr<Job> next_job();
+
+    void worker();
+
+    const unsigned int m_num_threads;
+    const unsigned int m_reserved_threads;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_admit;
+    std::condition_variable m_idle;
+    std::deque<std::shared_ptr<Job>> m_waiting;
+    std::set<const ProverContextT*> m_busy_contexts;
+    unsigned int m_busy_threads = 0;
+    size_t m_running = 0;
+    bool m_suspended = false;
+    bool m_stopping = false;
+
+    std::vector<std::thread> m_workers;
+};
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PROVER_SCHEDULER_HPP_
+#endif
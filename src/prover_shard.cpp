@@ -0,0 +1,668 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <cctype>   // isalnum
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "prover_shard.hpp"
+#include "stubs.hpp"
+
+using json = nlohmann::json;
+
+
+namespace ethsnarks {
+
+
+static const char SHARD_REQUEST_MAGIC[8] = {'E', 'S', 'S', 'H', 'R', 'E', 'Q', '\0'};
+static const char SHARD_SHARE_MAGIC[8] = {'E', 'S', 'S', 'H', 'A', 'R', 'E', '\0'};
+
+// Requests and shares hold field elements and points as they are in memory,
+// like the mmap proving key, so workers and coordinator must be the same build
+static_assert(std::is_trivially_copyable<FieldT>::value, "field elements must be trivially copyable");
+static_assert(std::is_trivially_copyable<G1T>::value, "G1 points must be trivially copyable");
+static_assert(std::is_trivially_copyable<G2T>::value, "G2 points must be trivially copyable");
+
+
+std::string prover_shard_path( const char *prefix, size_t index )
+{
+    return std::string(prefix) + "." + std::to_string(index) + ".pk";
+}
+
+
+json shard_info_to_json( const ProverShardInfo& info )
+{
+    json out;
+    out["index"] = info.index;
+    out["num_shards"] = info.num_shards;
+    out["var_begin"] = info.var_begin;
+    out["var_end"] = info.var_end;
+    out["L_begin"] = info.L_begin;
+    out["L_end"] = info.L_end;
+    out["L_offset"] = info.L_offset;
+    out["h_begin"] = info.h_begin;
+    out["h_end"] = info.h_end;
+    return out;
+}
+
+
+bool shard_info_from_json( const json& in_tree, ProverShardInfo& info )
+{
+    try {
+        info.index = in_tree.at("index");
+        info.num_shards = in_tree.at("num_shards");
+        info.var_begin = in_tree.at("var_begin");
+        info.var_end = in_tree.at("var_end");
+        info.L_begin = in_tree.at("L_begin");
+        info.L_end = in_tree.at("L_end");
+        info.L_offset = in_tree.at("L_offset");
+        info.h_begin = in_tree.at("h_begin");
+        info.h_end = in_tree.at("h_end");
+    }
+    catch( const json::exception& ex ) {
+        std::cerr << "Error: invalid shard info, " << ex.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool load_shard_info( const char *shard_pk_file, ProverShardInfo& info )
+{
+    const std::string path = std::string(shard_pk_file) + ".json";
+    std::ifstream fh(path);
+    if( ! fh.is_open() ) {
+        std::cerr << "Error: cannot open " << path << std::endl;
+        return false;
+    }
+
+    json tree;
+    try {
+        fh >> tree;
+    }
+    catch( const json::exception& ex ) {
+        std::cerr << "Error: cannot parse " << path << ", " << ex.what() << std::endl;
+        return false;
+    }
+
+    return shard_info_from_json(tree, info);
+}
+
+
+std::vector<ProverShardInfo> prover_shard_ranges( const ProvingKeyMmapHeader& header, size_t num_shards )
+{
+    // L_query[0] pairs with the first variable after the primary inputs
+    const size_t num_vars = header.A_domain_size;
+    const size_t L_first_var = num_vars - header.L_count;
+
+    std::vector<ProverShardInfo> result(num_shards);
+    for( size_t i = 0; i < num_shards; i++ )
+    {
+        auto& info = result[i];
+        info.index = i;
+        info.num_shards = num_shards;
+
+        info.var_begin = (num_vars * i) / num_shards;
+        info.var_end = (num_vars * (i + 1)) / num_shards;
+
+        const size_t first = std::max(info.var_begin, L_first_var);
+        if( first < info.var_end ) {
+            info.L_begin = first - L_first_var;
+            info.L_end = info.var_end - L_first_var;
+            info.L_offset = first - info.var_begin;
+        }
+
+        info.h_begin = (header.H_count * i) / num_shards;
+        info.h_end = (header.H_count * (i + 1)) / num_shards;
+    }
+
+    return result;
+}
+
+
+/**
+* The entries of a mapped sparse query whose indices are in [begin, end),
+* re-based to start at 0
+*/
+template<typename T>
+static void read_sparse_range( const uint8_t* base, uint64_t indices_offset, uint64_t values_offset, size_t count,
+                               size_t begin, size_t end, libsnark::sparse_vector<T>& out )
+{
+    const size_t* indices = reinterpret_cast<const size_t*>(base + indices_offset);
+    const T* values = reinterpret_cast<const T*>(base + values_offset);
+
+    const size_t first = std::lower_bound(indices, indices + count, begin) - indices;
+    const size_t last = std::lower_bound(indices, indices + count, end) - indices;
+
+    out.domain_size_ = end - begin;
+    out.indices.resize(last - first);
+    for( size_t i = first; i < last; i++ ) {
+        out.indices[i - first] = indices[i] - begin;
+    }
+    out.values.assign(values + first, values + last);
+}
+
+
+bool pk_load_mmap_shard( const char *pk_file, const ProverShardInfo& info, ProvingKeyT& pk )
+{
+    ProvingKeyMmapHeader header;
+    const uint8_t* base = pk_map_mmap(pk_file, header);
+    if( base == nullptr ) {
+        return false;
+    }
+
+    if( info.var_end > header.A_domain_size || info.L_end > header.L_count || info.h_end > header.H_count ) {
+        std::cerr << "Error: shard " << info.index << " is outside of " << pk_file << std::endl;
+        pk_unmap_mmap(base, header);
+        return false;
+    }
+
+    pk_read_mmap_points(base, header, pk);
+
+    read_sparse_range(base, header.A_indices_offset, header.A_values_offset, header.A_count, info.var_begin, info.var_end, pk.A_query);
+    read_sparse_range(base, header.B_indices_offset, header.B_values_offset, header.B_count, info.var_begin, info.var_end, pk.B_query);
+
+    const G1T* H = reinterpret_cast<const G1T*>(base + header.H_offset);
+    pk.H_query.assign(H + info.h_begin, H + info.h_end);
+
+    const G1T* L = reinterpret_cast<const G1T*>(base + header.L_offset);
+    pk.L_query.assign(L + info.L_begin, L + info.L_end);
+
+    pk_unmap_mmap(base, header);
+
+    return true;
+}
+
+
+bool pk_split( const char *pk_file, size_t num_shards, const char *out_prefix )
+{
+    if( num_shards == 0 ) {
+        std::cerr << "Error: at least one shard is needed" << std::endl;
+        return false;
+    }
+
+    ProvingKeyMmapHeader header;
+    const uint8_t* base = pk_map_mmap(pk_file, header);
+    if( base == nullptr ) {
+        std::cerr << "Error: " << pk_file << " must be an mmap proving key, see pk_raw2mmap" << std::endl;
+        return false;
+    }
+    pk_unmap_mmap(base, header);
+
+    for( const auto& info : prover_shard_ranges(header, num_shards) )
+    {
+        const auto path = prover_shard_path(out_prefix, info.index);
+
+        ProvingKeyT shard;
+        if( ! pk_load_mmap_shard(pk_file, info, shard) || ! pk_write_mmap(shard, path.c_str()) ) {
+            return false;
+        }
+
+        std::ofstream fh(path + ".json");
+        fh << shard_info_to_json(info).dump(2) << std::endl;
+        fh.close();
+        if( fh.fail() ) {
+            std::cerr << "Error: cannot write " << path << ".json" << std::endl;
+            return false;
+        }
+
+        std::cerr << "Shard " << info.index << ": " << path << ", "
+                  << shard.A_query.indices.size() << " A, " << shard.B_query.indices.size() << " B, "
+                  << shard.H_query.size() << " H, " << shard.L_query.size() << " L" << std::endl;
+    }
+
+    return true;
+}
+
+
+static void write_elements( std::ofstream& fh, const FieldT* data, size_t count )
+{
+    const uint64_t n = count;
+    fh.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    fh.write(reinterpret_cast<const char*>(data), count * sizeof(FieldT));
+}
+
+
+/** The count is checked before anything is allocated for it */
+static bool read_elements( std::ifstream& fh, std::vector<FieldT>& out, size_t expected )
+{
+    uint64_t n = 0;
+    if( ! fh.read(reinterpret_cast<char*>(&n), sizeof(n)) || n != expected ) {
+        return false;
+    }
+
+    out.resize(n);
+    return bool(fh.read(reinterpret_cast<char*>(out.data()), n * sizeof(FieldT)));
+}
+
+
+bool write_shard_requests( ProverContextT& context, const std::vector<FieldT>& values, const std::vector<ProverShardInfo>& shards, const char *prefix )
+{
+    // The coordinator may not hold the H query, its basis is known from the shards
+    if( ! shards.empty() ) {
+        context.lagrange_H = shards.back().h_end == context.domain->m;
+    }
+
+    libsnark::r1cs_gg_ppzksnark_zok_prover_witness_map<ppT>(context, values, context.aA, context.aB, context.aH);
+
+    for( const auto& info : shards )
+    {
+        if( info.var_end > values.size() || info.h_end > context.aH.size() ) {
+            std::cerr << "Error: shard " << info.index << " doesn't match the circuit" << std::endl;
+            return false;
+        }
+
+        const std::string path = std::string(prefix) + "." + std::to_string(info.index) + ".request";
+        std::ofstream fh(path, std::ios::binary | std::ios::trunc);
+        fh.write(SHARD_REQUEST_MAGIC, sizeof(SHARD_REQUEST_MAGIC));
+        write_elements(fh, values.data() + info.var_begin, info.var_end - info.var_begin);
+        write_elements(fh, context.aH.data() + info.h_begin, info.h_end - info.h_begin);
+        fh.close();
+
+        if( fh.fail() ) {
+            std::cerr << "Error: cannot write " << path << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool read_shard_request( const char *request_file, const ProverShardInfo& info, std::vector<FieldT>& assignment, std::vector<FieldT>& aH )
+{
+    std::ifstream fh(request_file, std::ios::binary);
+    char magic[sizeof(SHARD_REQUEST_MAGIC)];
+    if( ! fh.read(magic, sizeof(magic)) || 0 != ::memcmp(magic, SHARD_REQUEST_MAGIC, sizeof(magic)) ) {
+        std::cerr << "Error: " << request_file << " isn't a shard request" << std::endl;
+        return false;
+    }
+
+    if( ! read_elements(fh, assignment, info.var_end - info.var_begin) || ! read_elements(fh, aH, info.h_end - info.h_begin) ) {
+        std::cerr << "Error: " << request_file << " is truncated or isn't for shard " << info.index << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool write_shard_share( const char *share_file, const ProofT& share )
+{
+    std::ofstream fh(share_file, std::ios::binary | std::ios::trunc);
+    fh.write(SHARD_SHARE_MAGIC, sizeof(SHARD_SHARE_MAGIC));
+    fh.write(reinterpret_cast<const char*>(&share.g_A), sizeof(G1T));
+    fh.write(reinterpret_cast<const char*>(&share.g_B), sizeof(G2T));
+    fh.write(reinterpret_cast<const char*>(&share.g_C), sizeof(G1T));
+    fh.close();
+
+    return ! fh.fail();
+}
+
+
+bool read_shard_share( const char *share_file, ProofT& share )
+{
+    std::ifstream fh(share_file, std::ios::binary);
+    char magic[sizeof(SHARD_SHARE_MAGIC)];
+    if( ! fh.read(magic, sizeof(magic)) || 0 != ::memcmp(magic, SHARD_SHARE_MAGIC, sizeof(magic)) ) {
+        std::cerr << "Error: " << share_file << " isn't a shard share" << std::endl;
+        return false;
+    }
+
+    return fh.read(reinterpret_cast<char*>(&share.g_A), sizeof(G1T))
+        && fh.read(reinterpret_cast<char*>(&share.g_B), sizeof(G2T))
+        && fh.read(reinterpret_cast<char*>(&share.g_C), sizeof(G1T));
+}
+
+
+bool prove_shard( ProverContextT& context, const ProverShardInfo& info, const char *request_file, const char *share_file )
+{
+    std::vector<FieldT> assignment;
+    std::vector<FieldT> aH;
+    if( ! read_shard_request(request_file, info, assignment, aH) ) {
+        return false;
+    }
+
+    const auto share = libsnark::r1cs_gg_ppzksnark_zok_prover_shard<ppT>(context, assignment, info.L_offset, aH);
+
+    if( ! write_shard_share(share_file, share) ) {
+        std::cerr << "Error: cannot write " << share_file << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+ProofT combine_shard_shares( const ProvingKeyT& pk, const std::vector<ProofT>& shares )
+{
+    G1T A = pk.alpha_g1;
+    G2T B = pk.beta_g2;
+    G1T C = G1T::zero();
+    for( const auto& share : shares )
+    {
+        A = A + share.g_A;
+        B = B + share.g_B;
+        C = C + share.g_C;
+    }
+
+    return ProofT(std::move(A), std::move(B), std::move(C));
+}
+
+
+static int shard_connect( const std::string& address )
+{
+    const auto colon = address.rfind(':');
+    if( colon == std::string::npos ) {
+        std::cerr << "Error: expected host:port, not " << address << std::endl;
+        return -1;
+    }
+    const std::string host = address.substr(0, colon);
+    const std::string port = address.substr(colon + 1);
+
+    struct addrinfo hints;
+    ::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *found = nullptr;
+    if( 0 != ::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) ) {
+        std::cerr << "Error: cannot resolve " << address << std::endl;
+        return -1;
+    }
+
+    int fd = -1;
+    for( auto it = found; it != nullptr && fd < 0; it = it->ai_next )
+    {
+        fd = ::socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+        if( fd >= 0 && 0 != ::connect(fd, it->ai_addr, it->ai_addrlen) ) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(found);
+
+    if( fd < 0 ) {
+        std::cerr << "Error: cannot connect to " << address << std::endl;
+    }
+    return fd;
+}
+
+
+static bool send_line( int fd, const std::string& line )
+{
+    const std::string data = line + "\n";
+    size_t sent = 0;
+    while( sent < data.size() )
+    {
+        const ssize_t n = ::write(fd, data.data() + sent, data.size() - sent);
+        if( n <= 0 ) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+
+static bool receive_line( int fd, std::string& line )
+{
+    // Lines are short, one byte at a time keeps the rest of the stream unread
+    line.clear();
+    char c;
+    while( ::read(fd, &c, 1) == 1 )
+    {
+        if( c == '\n' ) {
+            return true;
+        }
+        line += c;
+    }
+    return false;
+}
+
+
+std::vector<std::string> shard_call_all( const std::vector<std::string>& addresses, const std::vector<std::string>& lines )
+{
+    std::vector<int> fds;
+    for( size_t i = 0; i < addresses.size(); i++ )
+    {
+        int fd = shard_connect(addresses[i]);
+        if( fd >= 0 && ! send_line(fd, lines[i]) ) {
+            ::close(fd);
+            fd = -1;
+        }
+        fds.push_back(fd);
+    }
+
+    std::vector<std::string> replies(addresses.size());
+    for( size_t i = 0; i < fds.size(); i++ )
+    {
+        if( fds[i] < 0 ) {
+            continue;
+        }
+        if( ! receive_line(fds[i], replies[i]) ) {
+            replies[i].clear();
+        }
+        ::close(fds[i]);
+    }
+
+    return replies;
+}
+
+
+
+bool shard_job_valid( const std::string& job )
+{
+    if( job.empty() || job.size() > 255 || ! ::isalnum(static_cast<unsigned char>(job[0])) || job.find("..") != std::string::npos ) {
+        return false;
+    }
+    for( const char c : job ) {
+        if( ! ::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '_' && c != '-' ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+std::string shard_job_path( const char *spool_dir, const std::string& job, const char *suffix )
+{
+    return std::string(spool_dir) + "/" + job + suffix;
+}
+
+
+static std::string shard_answer( ProverContextT& context, const ProverShardInfo& info, const char *spool_dir, const std::string& line )
+{
+    std::istringstream request(line);
+    std::string job;
+    std::string extra;
+    if( ! (request >> job) || (request >> extra) ) {
+        return "ERROR expected <job>";
+    }
+
+    // Only files of the spool directory are ever read or written
+    if( ! shard_job_valid(job) ) {
+        return "ERROR invalid job";
+    }
+
+    const auto request_file = shard_job_path(spool_dir, job, ".request");
+    const auto share_file = shard_job_path(spool_dir, job, ".share");
+    if( ! prove_shard(context, info, request_file.c_str(), share_file.c_str()) ) {
+        return "ERROR cannot prove " + job;
+    }
+
+    return "OK " + job;
+}
+
+
+int shard_serve( ProverContextT& context, const ProverShardInfo& info, const char *spool_dir, unsigned int port, const char *bind_address )
+{
+    if( port == 0 )
+    {
+        std::string line;
+        while( std::getline(std::cin, line) )
+        {
+            if( line.length() == 0 ) {
+                continue;
+            }
+            std::cout << shard_answer(context, info, spool_dir, line) << std::endl;
+        }
+        return 0;
+    }
+
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if( 1 != ::inet_pton(AF_INET, bind_address, &addr.sin_addr) ) {
+        std::cerr << "Error: invalid address " << bind_address << std::endl;
+        return 1;
+    }
+
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if( listener < 0 ) {
+        std::cerr << "Error: cannot create socket" << std::endl;
+        return 1;
+    }
+
+    const int reuse = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if( 0 != ::bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) || 0 != ::listen(listener, 4) ) {
+        std::cerr << "Error: cannot listen on " << bind_address << ":" << port << std::endl;
+        ::close(listener);
+        return 1;
+    }
+
+    std::cerr << "Shard " << info.index << " of " << info.num_shards << " listening on " << bind_address << ":" << port
+              << ", jobs in " << spool_dir << std::endl;
+
+    // One coordinator at a time, each may send many requests
+    while( true )
+    {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if( fd < 0 ) {
+            continue;
+        }
+
+        std::string line;
+        while( receive_line(fd, line) )
+        {
+            if( line.length() == 0 ) {
+                continue;
+            }
+            if( ! send_line(fd, shard_answer(context, info, spool_dir, line)) ) {
+                break;
+            }
+        }
+
+        ::close(fd);
+    }
+}
+
+
+std::string shard_spool_dir( const char *prefix )
+{
+    const std::string path(prefix);
+    const auto slash = path.rfind('/');
+    if( slash == std::string::npos ) {
+        return ".";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+
+bool prove_distributed( ProtoboardT& pb, const char *prefix, const std::vector<std::string>& addresses, ProofT& proof )
+{
+    std::vector<ProverShardInfo> shards(1);
+    if( ! load_shard_info(prover_shard_path(prefix, 0).c_str(), shards[0]) ) {
+        return false;
+    }
+
+    if( addresses.size() != shards[0].num_shards ) {
+        std::cerr << "Error: " << shards[0].num_shards << " shards, but " << addresses.size() << " workers" << std::endl;
+        return false;
+    }
+
+    shards.resize(shards[0].num_shards);
+    for( size_t i = 1; i < shards.size(); i++ )
+    {
+        if( ! load_shard_info(prover_shard_path(prefix, i).c_str(), shards[i]) ) {
+            return false;
+        }
+    }
+
+    // Only alpha and beta of the key are needed here
+    ProvingKeyT pk;
+    ProvingKeyMmapHeader header;
+    const uint8_t* base = pk_map_mmap(prover_shard_path(prefix, 0).c_str(), header);
+    if( base == nullptr ) {
+        return false;
+    }
+    pk_read_mmap_points(base, header, pk);
+    pk_unmap_mmap(base, header);
+
+    ProverContextT context(pk);
+    init_prover_context(context, pb);
+
+    if( ! write_shard_requests(context, pb.values, shards, prefix) ) {
+        return false;
+    }
+
+    // The workers only take the job, `<prefix>.<i>` relative to their spool directory
+    const std::string path(prefix);
+    const std::string name = path.substr(path.rfind('/') == std::string::npos ? 0 : path.rfind('/') + 1);
+    std::vector<std::string> requests;
+    std::vector<std::string> share_files;
+    std::vector<std::string> lines;
+    for( size_t i = 0; i < shards.size(); i++ )
+    {
+        const std::string base_path = path + "." + std::to_string(i);
+        requests.push_back(base_path + ".request");
+        share_files.push_back(base_path + ".share");
+        lines.push_back(name + "." + std::to_string(i));
+        if( ! shard_job_valid(lines.back()) ) {
+            std::cerr << "Error: " << lines.back() << " isn't a valid job for the workers" << std::endl;
+            return false;
+        }
+    }
+
+    const auto replies = shard_call_all(addresses, lines);
+
+    bool ok = true;
+    std::vector<ProofT> shares(shards.size());
+    for( size_t i = 0; i < shards.size(); i++ )
+    {
+        if( replies[i] != "OK " + lines[i] ) {
+            std::cerr << "Error: shard " << i << " at " << addresses[i] << ": " << (replies[i].empty() ? "no reply" : replies[i]) << std::endl;
+            ok = false;
+        }
+        else if( ! read_shard_share(share_files[i].c_str(), shares[i]) ) {
+            ok = false;
+        }
+
+        ::remove(requests[i].c_str());
+        ::remove(share_files[i].c_str());
+    }
+
+    if( ok ) {
+        proof = combine_shard_shares(pk, shares);
+    }
+
+    return ok;
+}
+
+
+// namespace ethsnarks
+}
@@ -0,0 +1,139 @@
+#ifndef ETHSNARKS_PROVER_SHARD_HPP_
+#define ETHSNARKS_PROVER_SHARD_HPP_
+
+#include "ethsnarks.hpp"
+#include "pk_mmap.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Distributed proving, for circuits whose proving key doesn't fit on one host
+*
+* The key is split into shards by pk_split(), each covers a slice of the
+* full variable assignment (its A, B and L query entries) and a slice of the
+* witness map's H (its H query entries). A worker holds one shard in memory
+* with its own ProverContext and Config, and computes a share of the proof
+* with r1cs_gg_ppzksnark_zok_prover_shard().
+*
+* The coordinator holds only the circuit: it computes the witness and the
+* witness map, writes every shard's slices to a request file, and sums the
+* shares which the workers write back. Requests and shares are exchanged as
+* files on storage which both can reach, in a spool directory. The workers
+* are told which job to answer over a line-based protocol, see
+* shard_call_all(), and only ever read `<spool>/<job>.request` and write
+* `<spool>/<job>.share`. The protocol isn't authenticated, so workers listen
+* on loopback unless given an address on a trusted network.
+*
+* Shard `i` of `<prefix>` is the mmap proving key `<prefix>.<i>.pk` and its
+* ranges in `<prefix>.<i>.pk.json`.
+*/
+struct ProverShardInfo
+{
+    size_t index = 0;
+    size_t num_shards = 0;
+
+    // Slice of the full variable assignment, the shard's A and B query
+    // indices are relative to var_begin
+    size_t var_begin = 0;
+    size_t var_end = 0;
+
+    // L_query[L_begin, L_end) of the whole key, the first pairs with
+    // variable var_begin + L_offset
+    size_t L_begin = 0;
+    size_t L_end = 0;
+    size_t L_offset = 0;
+
+    // Slice of the witness map's H and of H_query
+    size_t h_begin = 0;
+    size_t h_end = 0;
+};
+
+std::string prover_shard_path( const char *prefix, size_t index );
+
+nlohmann::json shard_info_to_json( const ProverShardInfo& info );
+
+bool shard_info_from_json( const nlohmann::json& in_tree, ProverShardInfo& info );
+
+/** Read the `.json` ranges of a shard's proving key */
+bool load_shard_info( const char *shard_pk_file, ProverShardInfo& info );
+
+/**
+* The ranges of `num_shards` shards of a key, the variables and H are each
+* split evenly
+*/
+std::vector<ProverShardInfo> prover_shard_ranges( const ProvingKeyMmapHeader& header, size_t num_shards );
+
+/**
+* Load one shard from a whole mmap proving key, without reading the rest of
+* it. The points alpha, beta and delta are in every shard.
+*/
+bool pk_load_mmap_shard( const char *pk_file, const ProverShardInfo& info, ProvingKeyT& pk );
+
+/**
+* Split an mmap proving key into `num_shards` shards of `out_prefix`, one
+* shard at a time is held in memory
+*/
+bool pk_split( const char *pk_file, size_t num_shards, const char *out_prefix );
+
+/**
+* Compute the witness map of `context`, whose proving key only needs the
+* points, and write each shard's slices of `values` and of H to
+* `<prefix>.<i>.request`
+*/
+bool write_shard_requests( ProverContextT& context, const std::vector<FieldT>& values, const std::vector<ProverShardInfo>& shards, const char *prefix );
+
+/** Fails, before allocating them, unless the slices are the sizes of `info`'s */
+bool read_shard_request( const char *request_file, const ProverShardInfo& info, std::vector<FieldT>& assignment, std::vector<FieldT>& aH );
+
+bool write_shard_share( const char *share_file, const ProofT& share );
+
+bool read_shard_share( const char *share_file, ProofT& share );
+
+/**
+* Answer a request with the share of the shard whose key is in `context`
+*/
+bool prove_shard( ProverContextT& context, const ProverShardInfo& info, const char *request_file, const char *share_file );
+
+/** The proof is alpha_g1 and beta_g2 of the key plus the sum of the shares */
+ProofT combine_shard_shares( const ProvingKeyT& pk, const std::vector<ProofT>& shares );
+
+/**
+* Send one line to each `host:port` and return each reply line, or an empty
+* string for a worker which couldn't be reached. Every line is sent before
+* any reply is read, so the workers run at the same time.
+*/
+std::vector<std::string> shard_call_all( const std::vector<std::string>& addresses, const std::vector<std::string>& lines );
+
+/**
+* Job names are one path component, of letters, digits, '.', '_' and '-',
+* starting with a letter or digit and without "..", so they can't name a
+* file outside the spool directory
+*/
+bool shard_job_valid( const std::string& job );
+
+std::string shard_job_path( const char *spool_dir, const std::string& job, const char *suffix );
+
+/** The directory of a shard prefix, where the coordinator writes its jobs */
+std::string shard_spool_dir( const char *prefix );
+
+/**
+* A worker: answer `<job>` lines with `OK <job>` or `ERROR <reason>`, from
+* stdin when `port` is 0, otherwise from each connection to the TCP port on
+* `bind_address` in turn. The shard stays loaded throughout.
+*/
+int shard_serve( ProverContextT& context, const ProverShardInfo& info, const char *spool_dir, unsigned int port, const char *bind_address = "127.0.0.1" );
+
+/**
+* The coordinator: prove `pb` with the workers at `addresses`, worker `i`
+* serving shard `i` of `prefix`. Requests and shares are written next to the
+* shards, as `<prefix>.<i>.request` and `<prefix>.<i>.share`, the job of
+* worker `i` is the last component of `<prefix>.<i>`.
+*/
+bool prove_distributed( ProtoboardT& pb, const char *prefix, const std::vector<std::string>& addresses, ProofT& proof );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PROVER_SHARD_HPP_
+#endif
@@ -0,0 +1,149 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <future>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "prover_stream.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok.hpp"
+
+
+namespace ethsnarks {
+
+
+static bool read_points( int fd, uint64_t offset, size_t count, std::vector<G1T>& out )
+{
+    out.resize(count);
+    uint8_t* data = reinterpret_cast<uint8_t*>(out.data());
+    const size_t bytes = count * sizeof(G1T);
+
+    size_t done = 0;
+    while( done < bytes )
+    {
+        const ssize_t n = ::pread(fd, data + done, bytes - done, offset + done);
+        if( n <= 0 ) {
+            return false;
+        }
+        done += n;
+    }
+
+#ifdef POSIX_FADV_DONTNEED
+    ::posix_fadvise(fd, offset, bytes, POSIX_FADV_DONTNEED);
+#endif
+
+    return true;
+}
+
+
+/**
+* The multi-exp of `count` points at `offset` of the file with the scalars
+* from `scalars`, `chunk` points at a time, reading the next chunk into the
+* other buffer while the current one is computed
+*/
+static bool stream_multi_exp( ProverContextT& context, int fd, uint64_t offset, size_t count,
+                              std::vector<FieldT>::const_iterator scalars, size_t chunk,
+                              std::vector<G1T> (&buffers)[2], G1T& result )
+{
+    result = G1T::zero();
+
+    size_t current = 0;
+    std::future<bool> next;
+    if( count > 0 ) {
+        next = std::async(std::launch::async, read_points, fd, offset, std::min(chunk, count), std::ref(buffers[0]));
+    }
+
+    for( size_t begin = 0; begin < count; begin += chunk )
+    {
+        const size_t end = std::min(begin + chunk, count);
+        if( ! next.get() ) {
+            return false;
+        }
+
+        if( end < count ) {
+            next = std::async(std::launch::async, read_points, fd, offset + end * sizeof(G1T),
+                              std::min(chunk, count - end), std::ref(buffers[current ^ 1]));
+        }
+
+        const auto& bases = buffers[current];
+        result = result + libff::multi_exp<G1T, FieldT, libff::multi_exp_method_BDLO12>(
+            bases.cbegin(), bases.cend(),
+            scalars + begin, scalars + end,
+            context.scratch_exponents,
+            context.config);
+
+        current ^= 1;
+    }
+
+    return true;
+}
+
+
+bool prove_streamed( ProverContextT& context, const std::vector<FieldT>& values, const char *pk_file,
+                     const ProvingKeyMmapHeader& header, size_t budget_bytes, ProofT& proof )
+{
+    const auto& pk = context.provingKey;
+    if( ! pk.H_query.empty() || ! pk.L_query.empty() ) {
+        std::cerr << "Error: the proving key must be loaded without its H and L queries, see pk_load_mmap_AB" << std::endl;
+        return false;
+    }
+
+    const size_t num_inputs = context.constraint_system->num_inputs();
+    if( values.size() != header.A_domain_size || header.L_count + num_inputs + 1 > values.size() ) {
+        std::cerr << "Error: " << pk_file << " doesn't match the circuit" << std::endl;
+        return false;
+    }
+
+    const int fd = ::open(pk_file, O_RDONLY);
+    if( fd < 0 ) {
+        std::cerr << "Error: cannot open " << pk_file << std::endl;
+        return false;
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd, header.H_offset, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // Two chunks are held at once, the one being computed and the next
+    const size_t chunk = std::max<size_t>(1, budget_bytes / (2 * sizeof(G1T)));
+    std::cerr << "Streaming the H and L queries " << chunk << " points at a time" << std::endl;
+
+    context.primary_input.assign(values.begin() + 1, values.begin() + 1 + context.constraint_system->primary_input_size);
+
+    // The H query isn't loaded, so its basis is known from its size
+    context.lagrange_H = header.H_count == context.domain->m;
+
+    libsnark::r1cs_gg_ppzksnark_zok_prover_witness_map<ppT>(context, values, context.aA, context.aB, context.aH);
+    if( context.aH.size() < header.H_count ) {
+        std::cerr << "Error: " << pk_file << " doesn't match the circuit" << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    // The A and B queries are in memory, a shard without H and L gives them
+    const auto share = libsnark::r1cs_gg_ppzksnark_zok_prover_shard<ppT>(context, values, 0, std::vector<FieldT>());
+
+    std::vector<G1T> buffers[2];
+    G1T evaluation_Ht;
+    G1T evaluation_Lt;
+    libsnark::trace_enter_block("Stream the H and L queries");
+    const bool ok = stream_multi_exp(context, fd, header.H_offset, header.H_count, context.aH.cbegin(), chunk, buffers, evaluation_Ht)
+                 && stream_multi_exp(context, fd, header.L_offset, header.L_count, values.cbegin() + num_inputs + 1, chunk, buffers, evaluation_Lt);
+    libsnark::trace_leave_block("Stream the H and L queries");
+    ::close(fd);
+
+    if( ! ok ) {
+        std::cerr << "Error: cannot read the H and L queries of " << pk_file << std::endl;
+        return false;
+    }
+
+    proof = ProofT(pk.alpha_g1 + share.g_A, pk.beta_g2 + share.g_B, evaluation_Ht + evaluation_Lt);
+    return true;
+}
+
+
+// namespace ethsnarks
+}
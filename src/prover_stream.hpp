@@ -0,0 +1,33 @@
+#ifndef ETHSNARKS_PROVER_STREAM_HPP_
+#define ETHSNARKS_PROVER_STREAM_HPP_
+
+#include "ethsnarks.hpp"
+#include "pk_mmap.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Out-of-core proving, for hosts which can't hold the H and L queries in
+* memory alongside the witness
+*
+* The key is loaded with pk_load_mmap_AB(), without its H and L queries, and
+* they're read from the mmap proving key in chunks of at most `budget_bytes`
+* for two chunks: one is multi-exped against its slice of the witness map's
+* H, or of the auxiliary input, while the next is read. The pages which were
+* read are dropped from the page cache, as they won't be needed again until
+* the next proof.
+*
+* The budget only bounds the bases of the H and L queries, the witness, the
+* witness map and the A and B queries are held in memory as usual. Each
+* chunk is a separate multi-exp, so smaller budgets cost more throughput.
+* The context's fixed-base tables and MSM backend aren't used.
+*/
+bool prove_streamed( ProverContextT& context, const std::vector<FieldT>& values, const char *pk_file,
+                     const ProvingKeyMmapHeader& header, size_t budget_bytes, ProofT& proof );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_PROVER_STREAM_HPP_
+#endif
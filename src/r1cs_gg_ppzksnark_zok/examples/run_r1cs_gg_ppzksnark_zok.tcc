@@ -104,6 +104,18 @@ bool run_r1cs_gg_ppzksnark_zok(const r1cs_example<libff::Fr<ppT> > &example,
 
     test_affine_verifier<ppT>(keypair.vk, example.primary_input, proof, ans);
 
+    libff::print_header("R1CS GG-ppzkSNARK Batch Verifier");
+    std::vector<r1cs_gg_ppzksnark_zok_batch_item<ppT>> batch(3, {example.primary_input, proof});
+    std::vector<bool> batch_valid;
+    assert(r1cs_gg_ppzksnark_zok_online_verifier_batch<ppT>(pvk, batch, &batch_valid) == ans);
+    if (!batch.back().first.empty())
+    {
+        // A bad input on one proof must fail the batch and be singled out
+        batch[1].first[0] += libff::Fr<ppT>::one();
+        assert(!r1cs_gg_ppzksnark_zok_online_verifier_batch<ppT>(pvk, batch, &batch_valid));
+        assert(batch_valid[0] == ans && !batch_valid[1] && batch_valid[2] == ans);
+    }
+
     libff::leave_block("Call to run_r1cs_gg_ppzksnark_zok");
 
     return ans;
@@ -46,14 +46,26 @@ References:
 #ifndef R1CS_GG_PPZKSNARK_HPP_
 #define R1CS_GG_PPZKSNARK_HPP_
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <functional>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <libff/algebra/curves/public_params.hpp>
 
 #include <libsnark/common/data_structures/accumulation_vector.hpp>
 #include <libsnark/knowledge_commitment/knowledge_commitment.hpp>
 #include <libsnark/relations/constraint_satisfaction_problems/r1cs/r1cs.hpp>
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_index_map.hpp"
 #include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_params.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_msm_backend.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_perf.hpp"
 
 #include <libfqfft/evaluation_domain/evaluation_domain.hpp>
 
@@ -214,6 +226,10 @@ public:
         delta_g1 = other.delta_g1;
         delta_g2 = other.delta_g2;
         A_query.domain_size_ = other.A_query.size();
+        const size_t A_nonzero = std::count_if(other.A_query.begin(), other.A_query.end(),
+                                               [](const libff::G1<ppT> &p) { return p != libff::G1<ppT>::zero(); });
+        A_query.indices.reserve(A_nonzero);
+        A_query.values.reserve(A_nonzero);
         for (unsigned int i = 0; i < other.A_query.size(); i++)
         {
             if (other.A_query[i] != libff::G1<ppT>::zero())
@@ -223,6 +239,8 @@ public:
             }
         }
         B_query.domain_size_ = other.B_query.domain_size_;
+        B_query.indices.reserve(other.B_query.indices.size());
+        B_query.values.reserve(other.B_query.indices.size());
         for (unsigned int i = 0; i < other.B_query.indices.size(); i++)
         {
             B_query.indices.emplace_back(other.B_query.indices[i]);
@@ -244,7 +262,7 @@ public:
 
     size_t G1_sparse_size() const
     {
-        return 1 + A_query.domain_size() + B_query.size() + H_query.size() + L_query.size();
+        return 1 + A_query.size() + B_query.size() + H_query.size() + L_query.size();
     }
 
     size_t G2_sparse_size() const
@@ -252,11 +270,18 @@ public:
         return 1 + B_query.size();
     }
 
+    /**
+     * The points, and the A and B indices as the prover holds them, with
+     * each segment in the encoding its density selects, see query_index_map
+     */
     size_t size_in_bits() const
     {
-        return (libff::size_in_bits(A_query) + B_query.size_in_bits() +
+        return (A_query.size() * libff::G1<ppT>::size_in_bits() +
+                query_index_map::size_in_bits(A_query.indices, A_query.domain_size()) +
+                B_query.size() * libff::G2<ppT>::size_in_bits() +
+                query_index_map::size_in_bits(B_query.indices, B_query.domain_size()) +
                 libff::size_in_bits(H_query) + libff::size_in_bits(L_query) +
-                1 * libff::G1<ppT>::size_in_bits() + 1 * libff::G2<ppT>::size_in_bits());
+                3 * libff::G1<ppT>::size_in_bits() + 2 * libff::G2<ppT>::size_in_bits());
     }
 
     void print_size() const
@@ -274,8 +299,195 @@ public:
 };
 
 
+/******************************** Prover statistics ********************************/
+
+/**
+ * Per-phase timings and sizes recorded by the prover when a ProverStats is
+ * attached to the ProverContext. Bytes touched is an estimate from the number
+ * of elements read and written by each phase. The 'fft' phases are nested in
+ * 'witness_map' and have no bytes of their own, so they aren't counted twice.
+ *
+ * With `hardware_counters` set each phase also has the perf_event counters
+ * of the process while it ran, see r1cs_gg_ppzksnark_zok_perf.hpp.
+ */
+struct ProverStats
+{
+    struct Phase
+    {
+        std::string name;
+        double wall_seconds;
+        double cpu_seconds;
+        size_t bytes;
+        std::chrono::steady_clock::time_point wall_start;
+        std::clock_t cpu_start;
+        bool has_counters;
+        PerfCounterValues counters;
+        PerfCounterValues counters_start;
+    };
+
+    // How the witness scalars of a query were handled: zeros are skipped,
+    // ones are accumulated with additions, only the rest go to the MSM
+    struct ScalarSplit
+    {
+        size_t zeros = 0;
+        size_t ones = 0;
+        size_t msm = 0;
+    };
+
+    std::vector<Phase> phases;
+    unsigned int num_threads = 0;       // of the FFTs and the witness map
+    unsigned int msm_threads = 0;       // of the multi-exps
+    size_t domain_size = 0;
+    size_t num_variables = 0;
+    size_t num_inputs = 0;
+    size_t num_constraints = 0;
+    size_t A_nonzero = 0;
+    size_t B_nonzero = 0;
+    size_t H_size = 0;
+    size_t L_size = 0;
+    ScalarSplit A_split;
+    ScalarSplit L_split;
+    // Set by the caller to sample the hardware counters of each phase
+    bool hardware_counters = false;
+
+    void clear()
+    {
+        const bool keep_hardware_counters = hardware_counters;
+        *this = ProverStats();
+        hardware_counters = keep_hardware_counters;
+    }
+
+    void begin_phase(const std::string& name)
+    {
+        phases.push_back({name, 0, 0, 0, std::chrono::steady_clock::now(), std::clock(), false});
+        if (hardware_counters)
+        {
+            phases.back().has_counters = perf_counters_read(phases.back().counters_start);
+        }
+    }
+
+    void end_phase(const std::string& name, size_t bytes)
+    {
+        for (auto it = phases.rbegin(); it != phases.rend(); it++)
+        {
+            if (it->name == name)
+            {
+                it->wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - it->wall_start).count();
+                it->cpu_seconds = double(std::clock() - it->cpu_start) / CLOCKS_PER_SEC;
+                it->bytes = bytes;
+                PerfCounterValues counters_end;
+                if (it->has_counters && perf_counters_read(counters_end))
+                {
+                    it->counters = counters_end - it->counters_start;
+                }
+                break;
+            }
+        }
+    }
+
+    size_t total_bytes() const
+    {
+        size_t total = 0;
+        for (const auto& phase : phases)
+        {
+            total += phase.bytes;
+        }
+        return total;
+    }
+
+    /* The wall time of every phase with this name, e.g. the 'fft' phases */
+    double wall_seconds(const std::string& name) const
+    {
+        double total = 0;
+        for (const auto& phase : phases)
+        {
+            if (phase.name == name)
+            {
+                total += phase.wall_seconds;
+            }
+        }
+        return total;
+    }
+};
+
+/**
+ * The shifted multiples 2^{c*j} * P_i of a fixed set of bases P_i, stored
+ * base-major with `num_windows` entries per base. A multi-exponentiation
+ * over these needs a single bucket pass, without any doublings.
+ */
+template<typename T>
+struct FixedBaseTable
+{
+    unsigned int c = 0;
+    size_t num_windows = 0;
+    size_t num_bases = 0;
+    std::vector<T> points;
+
+    bool empty() const
+    {
+        return points.empty();
+    }
+
+    static size_t size_in_bytes(size_t num_bases, size_t scalar_bits, unsigned int c)
+    {
+        return num_bases * ((scalar_bits + c - 1) / c) * sizeof(T);
+    }
+};
+
+template<typename T>
+FixedBaseTable<T> r1cs_gg_ppzksnark_zok_fixed_base_precompute(const std::vector<T> &bases,
+                                                          size_t scalar_bits,
+                                                          unsigned int c,
+                                                          unsigned int num_threads);
+
+template<typename T, typename FieldT>
+T r1cs_gg_ppzksnark_zok_fixed_base_multi_exp(const FixedBaseTable<T> &table,
+                                             typename std::vector<FieldT>::const_iterator scalars,
+                                             unsigned int num_threads);
+
+/**
+ * Bucket MSM which counting-sorts the bases of each window by their digit
+ * first, so every bucket is summed in one pass over its own bases rather
+ * than the buckets being updated in the order of the bases. Base `i` pairs
+ * with `scalars[indices[i]]`, or `scalars[i]` when `indices` is null, or
+ * through `index_map` when it's given, which is then used instead. With
+ * `base_indices` base `i` is `bases[base_indices[i]]`, rather than a copy.
+ * Selected with Config::multi_exp_method = "sorted".
+ */
+template<typename T, typename FieldT>
+T r1cs_gg_ppzksnark_zok_sorted_multi_exp(typename std::vector<T>::const_iterator bases,
+                                         const std::vector<size_t> *indices,
+                                         typename std::vector<FieldT>::const_iterator scalars,
+                                         size_t n,
+                                         std::vector<libff::bigint<FieldT::num_limbs>> &scratch,
+                                         const Config &config,
+                                         const query_index_map *index_map = nullptr,
+                                         const size_t *base_indices = nullptr);
+
 /******************************** Proving Context ********************************/
 
+/**
+ * Thrown by the prover at the next checkpoint after ProverContext::cancel is
+ * set, the message is the name of the stage which wasn't started.
+ */
+class r1cs_gg_ppzksnark_zok_cancelled : public std::runtime_error
+{
+public:
+    explicit r1cs_gg_ppzksnark_zok_cancelled(const std::string &stage) : std::runtime_error(stage) {}
+};
+
+/**
+ * Thrown by the witness map when ProverContext::check_satisfied is set and
+ * a constraint isn't satisfied, `constraint` is the first which isn't.
+ */
+class r1cs_gg_ppzksnark_zok_unsatisfied : public std::runtime_error
+{
+public:
+    r1cs_gg_ppzksnark_zok_unsatisfied(size_t constraint, const std::string &what) : std::runtime_error(what), constraint(constraint) {}
+
+    size_t constraint;
+};
+
 template<typename ppT>
 struct ProverContext
 {
@@ -284,10 +496,226 @@ struct ProverContext
     Config config;
     std::shared_ptr<libfqfft::evaluation_domain<libff::Fr<ppT>>> domain;
     std::vector<libff::bigint<libff::Fr<ppT>::num_limbs>> scratch_exponents;
+    // Per-task scratch space for the concurrent multi-exps and the MSM
+    // backend, sized by preallocate_tasks() only when they're used
+    std::vector<libff::bigint<libff::Fr<ppT>::num_limbs>> scratch_exponents_B;
+    std::vector<libff::bigint<libff::Fr<ppT>::num_limbs>> scratch_exponents_H;
+    std::vector<libff::bigint<libff::Fr<ppT>::num_limbs>> scratch_exponents_L;
     std::vector<libff::Fr<ppT>> aA;
     std::vector<libff::Fr<ppT>> aB;
     std::vector<libff::Fr<ppT>> aH;
+    // Second set of witness map buffers, used by the batch prover to compute
+    // the next witness map while the current one is being evaluated, sized
+    // by preallocate_next() for the first batch of more than one proof
+    std::vector<libff::Fr<ppT>> aA_next;
+    std::vector<libff::Fr<ppT>> aB_next;
+    std::vector<libff::Fr<ppT>> aH_next;
+    // Positions of the A and L query bases whose scalars aren't 0 or 1, and
+    // the scalars, the capacity is kept between proofs
+    std::vector<size_t> msm_indices_A;
+    std::vector<size_t> msm_indices_L;
+    std::vector<libff::Fr<ppT>> msm_scalars_A;
+    std::vector<libff::Fr<ppT>> msm_scalars_L;
+    // Segment encodings of the A and B query indices, see index_maps()
+    query_index_map A_index_map;
+    query_index_map B_index_map;
+    // Precomputed multiples of the H and L query bases, used instead of the
+    // bucket MSM when config.fixed_base_c is set, see precompute_fixed_base()
+    FixedBaseTable<libff::G1<ppT>> H_fixed;
+    FixedBaseTable<libff::G1<ppT>> L_fixed;
+    // External backend for the H and L queries, see attach_msm_backend()
+    std::shared_ptr<r1cs_gg_ppzksnark_zok_msm_backend<ppT>> msm_backend;
+    // Re-used copy of the primary input, for serialising the proof
+    std::vector<libff::Fr<ppT>> primary_input;
+    // Optional, filled by r1cs_gg_ppzksnark_zok_prover when set
+    ProverStats* stats = nullptr;
+    // Optional, set from another thread to abandon the proof, see checkpoint()
+    const std::atomic<bool>* cancel = nullptr;
+    // Optional, called on the prover's thread with the name of each stage
+    std::function<void(const char*)> progress;
+    // The H query pairs with the evaluations of H on the coset rather than
+    // its coefficients, set by preallocate() from the size of the H query
+    bool lagrange_H = false;
+    // Check every constraint as the witness map evaluates it, which costs a
+    // multiplication each, see r1cs_gg_ppzksnark_zok_unsatisfied
+    bool check_satisfied = false;
     ProverContext(r1cs_gg_ppzksnark_zok_proving_key_nozk<ppT> & pk) : provingKey(pk){};
+
+    /**
+     * Called between the stages of the prover, and between chunks of the
+     * multi-exps when `cancel` is set, but never inside a parallel region.
+     * Reports the stage to `progress`, then throws if `cancel` is set.
+     */
+    void checkpoint(const char* stage) const
+    {
+        if (progress)
+        {
+            progress(stage);
+        }
+        if (cancel && cancel->load(std::memory_order_relaxed))
+        {
+            throw r1cs_gg_ppzksnark_zok_cancelled(stage);
+        }
+    }
+
+    /**
+     * Build the index maps of the A and B queries the first time they're
+     * needed, the multi-exps gather their scalars through them. The key
+     * mustn't be changed afterwards.
+     */
+    void index_maps()
+    {
+        const auto &A = provingKey.A_query;
+        const auto &B = provingKey.B_query;
+        if (A_index_map.size() != A.indices.size() || A_index_map.domain_size() != A.domain_size())
+        {
+            A_index_map = query_index_map(A.indices, A.domain_size());
+        }
+        if (B_index_map.size() != B.indices.size() || B_index_map.domain_size() != B.domain_size())
+        {
+            B_index_map = query_index_map(B.indices, B.domain_size());
+        }
+    }
+
+    /**
+     * Size the per-proof buffers from the constraint system and domain, so
+     * repeated proofs re-use memory which has already been faulted in rather
+     * than allocating it again. Requires `constraint_system` and `domain`.
+     * The per-task scratch space is only sized when the config runs the
+     * multi-exps concurrently, and the batch prover's second witness map
+     * only when it's first used.
+     */
+    void preallocate()
+    {
+        const size_t num_variables = constraint_system->num_variables();
+        const size_t m = domain->m;
+
+        for (auto v : {&aA, &aB, &aH})
+        {
+            v->resize(m + 1, libff::Fr<ppT>::zero());
+        }
+
+        scratch_exponents.resize(std::max(num_variables + 1, m));
+
+        if (concurrent_multi_exp())
+        {
+            preallocate_tasks();
+        }
+
+        primary_input.resize(constraint_system->num_inputs());
+
+        if (!provingKey.H_query.empty())
+        {
+            lagrange_H = provingKey.H_query.size() == m;
+        }
+    }
+
+    /**
+     * Whether the A, B, H and L multi-exps run as concurrent tasks, each with
+     * its own scratch space: with an MSM backend, or config.parallel_multi_exp
+     * and at least four threads
+     */
+    bool concurrent_multi_exp() const
+    {
+#ifdef MULTICORE
+        if (config.parallel_multi_exp && config.num_threads >= 4)
+        {
+            return true;
+        }
+#endif
+        return msm_backend != nullptr;
+    }
+
+    /**
+     * Size the per-task scratch space like scratch_exponents, called before
+     * the multi-exps run concurrently
+     */
+    void preallocate_tasks()
+    {
+        for (auto v : {&scratch_exponents_B, &scratch_exponents_H, &scratch_exponents_L})
+        {
+            if (v->size() < scratch_exponents.size())
+            {
+                v->resize(scratch_exponents.size());
+            }
+        }
+    }
+
+    /**
+     * Size the batch prover's second set of witness map buffers like the
+     * first, they're kept for later batches
+     */
+    void preallocate_next()
+    {
+        for (auto v : {&aA_next, &aB_next, &aH_next})
+        {
+            if (v->size() < aA.size())
+            {
+                v->resize(aA.size(), libff::Fr<ppT>::zero());
+            }
+        }
+    }
+
+    /**
+     * Entries of the witness map's H, and of the H query, which the prover
+     * uses: the m evaluations on the coset, or the m-1 coefficients.
+     */
+    size_t H_size() const
+    {
+        return lagrange_H ? domain->m : domain->m - 1;
+    }
+
+    /**
+     * Memory needed by precompute_fixed_base() for a window of `c` bits
+     */
+    size_t fixed_base_bytes(unsigned int c) const
+    {
+        const size_t scalar_bits = libff::Fr<ppT>::size_in_bits();
+        return FixedBaseTable<libff::G1<ppT>>::size_in_bytes(provingKey.H_query.size(), scalar_bits, c)
+             + FixedBaseTable<libff::G1<ppT>>::size_in_bytes(provingKey.L_query.size(), scalar_bits, c);
+    }
+
+    /**
+     * Build the H and L tables for config.fixed_base_c, or release them when
+     * it is zero. The cost is fixed_base_bytes(), check it first.
+     */
+    void precompute_fixed_base()
+    {
+        if (config.fixed_base_c == 0)
+        {
+            H_fixed = FixedBaseTable<libff::G1<ppT>>();
+            L_fixed = FixedBaseTable<libff::G1<ppT>>();
+            return;
+        }
+
+        const size_t scalar_bits = libff::Fr<ppT>::size_in_bits();
+        H_fixed = r1cs_gg_ppzksnark_zok_fixed_base_precompute(provingKey.H_query, scalar_bits, config.fixed_base_c, config.num_threads);
+        L_fixed = r1cs_gg_ppzksnark_zok_fixed_base_precompute(provingKey.L_query, scalar_bits, config.fixed_base_c, config.num_threads);
+    }
+
+    /**
+     * Select the backend named by config.msm_backend and give it the proving
+     * key bases. Returns false, and leaves every query on the CPU, when the
+     * backend isn't registered, has no device or can't be prepared.
+     */
+    bool attach_msm_backend()
+    {
+        msm_backend.reset();
+        if (config.msm_backend.empty())
+        {
+            return true;
+        }
+
+        auto backend = r1cs_gg_ppzksnark_zok_create_msm_backend<ppT>(config.msm_backend);
+        if (!backend || !backend->prepare(provingKey.H_query, provingKey.L_query))
+        {
+            libff::print_indent(); printf("* MSM backend '%s' unavailable, using the CPU\n", config.msm_backend.c_str());
+            return false;
+        }
+
+        msm_backend = std::move(backend);
+        return true;
+    }
 };
 
 
@@ -392,6 +820,11 @@ public:
 
     accumulation_vector<libff::G1<ppT> > gamma_ABC_g1;
 
+    /* Optional shifted multiples of the gamma_ABC_g1 bases, see
+       r1cs_gg_ppzksnark_zok_verifier_process_vk. They're derived from the
+       key so aren't serialised or compared. */
+    FixedBaseTable<libff::G1<ppT> > gamma_ABC_fixed;
+
     bool operator==(const r1cs_gg_ppzksnark_zok_processed_verification_key &other) const;
     friend std::ostream& operator<< <ppT>(std::ostream &out, const r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> &pvk);
     friend std::istream& operator>> <ppT>(std::istream &in, r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> &pvk);
@@ -502,9 +935,74 @@ public:
  * A generator algorithm for the R1CS GG-ppzkSNARK.
  *
  * Given a R1CS constraint system CS, this algorithm produces proving and verification keys for CS.
+ *
+ * With `lagrange_H` the H query is in the Lagrange basis of the coset which
+ * the prover evaluates H on, rather than in powers of tau, and has m rather
+ * than m-1 entries. The prover then skips the inverse coset FFT of H.
+ */
+template<typename ppT>
+r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &cs,
+                                                                bool lagrange_H = false);
+
+/**
+ * A generator which emits the nozk proving key directly, each query is
+ * written to `pk_out` (in the same format as operator<< of the nozk key)
+ * segment by segment as it is computed, so peak memory is about one query's
+ * scalars rather than two full proving keys. Returns the verification key.
+ *
+ * If `checkpoint_dir` is given, the randomness, generators, window tables
+ * and every completed segment are persisted there, and an interrupted run
+ * resumes from the last completed segment. Its `manifest` has a hash of the
+ * constraint system and the segment size, a resume with either different is
+ * refused. The `secrets` are only readable by their owner and are removed
+ * once the key has been written, the rest of the directory must then be
+ * destroyed. `lagrange_H` is as for r1cs_gg_ppzksnark_zok_generator.
+ *
+ * Throws std::runtime_error if the checkpoint can't be written or resumed.
  */
 template<typename ppT>
-r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &cs);
+r1cs_gg_ppzksnark_zok_verification_key<ppT> r1cs_gg_ppzksnark_zok_generator_nozk(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &cs,
+                                                                             std::ostream &pk_out,
+                                                                             const std::string &checkpoint_dir = "",
+                                                                             size_t segment_size = (1ul << 18),
+                                                                             bool lagrange_H = false);
+
+/**
+ * The nozk generator split across machines, for circuits where a single
+ * machine would take days. The queries are cut into the same segments as
+ * the checkpoints of r1cs_gg_ppzksnark_zok_generator_nozk, in three steps:
+ *
+ *  1. r1cs_gg_ppzksnark_zok_generator_prepare evaluates the QAP and writes
+ *     the scalars of each query, and the window tables, to `setup_dir`
+ *  2. r1cs_gg_ppzksnark_zok_generator_worker, which doesn't need the
+ *     circuit, exponentiates every `num_workers`-th segment from
+ *     `worker_index` and writes them next to the scalars
+ *  3. r1cs_gg_ppzksnark_zok_generator_nozk with `setup_dir` as its
+ *     checkpoint directory, and the segment size and `lagrange_H` from
+ *     r1cs_gg_ppzksnark_zok_generator_read_params, resumes every segment
+ *     and writes the key. Any missing segment is computed there.
+ *
+ * Workers only read `params`, `g1_table`, `g2_table` and `<query>.scalars`,
+ * but the scalars are field elements, not group elements: H_i = t^i*Z(t)/delta,
+ * so H_1/H_0 is t and Z(t)/H_0 is delta. Every worker, and anyone who can
+ * read the directory, can recover the trapdoor and forge proofs, they must be
+ * trusted as fully as the machine which prepares. The files are only
+ * readable by their owner, and the directory must be destroyed afterwards.
+ */
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_generator_prepare(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &cs,
+                                             const std::string &setup_dir,
+                                             size_t segment_size = (1ul << 18),
+                                             bool lagrange_H = false);
+
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_generator_worker(const std::string &setup_dir,
+                                            size_t worker_index,
+                                            size_t num_workers);
+
+inline bool r1cs_gg_ppzksnark_zok_generator_read_params(const std::string &setup_dir,
+                                                        size_t &segment_size,
+                                                        bool &lagrange_H);
 
 /**
  * A prover algorithm for the R1CS GG-ppzkSNARK.
@@ -519,6 +1017,110 @@ r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover(const r1cs_gg_ppzk
                                                       const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
                                                       const r1cs_gg_ppzksnark_zok_auxiliary_input<ppT> &auxiliary_input);
 
+/**
+ * Prover which re-uses the domain, constraint system and scratch space held
+ * by the context, the full variable assignment includes the leading one.
+ * Throws r1cs_gg_ppzksnark_zok_cancelled when context.cancel is set.
+ */
+template<typename ppT>
+r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover(ProverContext<ppT>& context,
+                                                      const std::vector<libff::Fr<ppT>>& full_variable_assignment);
+
+/**
+ * The two stages of the prover: the witness map (FFTs, producing H) and the
+ * evaluation of the proving key queries (multi-exponentiations).
+ *
+ * The witness map's point-wise passes use `num_threads`, or
+ * context.config.num_threads when 0, the FFTs use those of the domain.
+ * Throws r1cs_gg_ppzksnark_zok_unsatisfied when context.check_satisfied is set.
+ */
+template<typename ppT>
+void r1cs_gg_ppzksnark_zok_prover_witness_map(ProverContext<ppT>& context,
+                                              const std::vector<libff::Fr<ppT>>& full_variable_assignment,
+                                              std::vector<libff::Fr<ppT>>& aA,
+                                              std::vector<libff::Fr<ppT>>& aB,
+                                              std::vector<libff::Fr<ppT>>& aH,
+                                              unsigned int num_threads = 0);
+
+template<typename ppT>
+r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover_evaluate(ProverContext<ppT>& context,
+                                                               const Config& config,
+                                                               const std::vector<libff::Fr<ppT>>& full_variable_assignment,
+                                                               const std::vector<libff::Fr<ppT>>& aH);
+
+/**
+ * The multi-exponentiations of one shard of a proving key, for a prover whose
+ * key is split over many machines. The shard's A and B query indices are
+ * relative to `assignment`, a slice of the full variable assignment, its
+ * L query pairs with `assignment` from `L_offset`, and its H query is a
+ * slice of the witness map's H, given as `aH`.
+ *
+ * The result is a share of the proof without alpha and beta, the proof is
+ * alpha_g1 and beta_g2 plus the sum of the shares of every shard.
+ */
+template<typename ppT>
+r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover_shard(ProverContext<ppT>& context,
+                                                            const std::vector<libff::Fr<ppT>>& assignment,
+                                                            size_t L_offset,
+                                                            const std::vector<libff::Fr<ppT>>& aH);
+
+/**
+ * The evaluations of the A, B and L queries, which are linear in the full
+ * variable assignment, unlike H which depends on the witness map.
+ */
+template<typename ppT>
+struct r1cs_gg_ppzksnark_zok_linear_evaluation
+{
+    libff::G1<ppT> At;
+    libff::G2<ppT> Bt;
+    libff::G1<ppT> Lt;
+};
+
+/**
+ * The multi-exponentiations of the A, B and L queries for a full variable
+ * assignment.
+ */
+template<typename ppT>
+r1cs_gg_ppzksnark_zok_linear_evaluation<ppT> r1cs_gg_ppzksnark_zok_evaluate_linear(ProverContext<ppT>& context,
+                                                                                  const std::vector<libff::Fr<ppT>>& full_variable_assignment);
+
+/**
+ * Update the evaluation of `previous` to that of `full_variable_assignment`,
+ * which differs from it only at the indices in `changed`. Each changed
+ * variable costs a scalar multiplication per query it's in, rather than
+ * multi-exponentiations over the whole assignment.
+ */
+template<typename ppT>
+void r1cs_gg_ppzksnark_zok_update_linear(const ProverContext<ppT>& context,
+                                         r1cs_gg_ppzksnark_zok_linear_evaluation<ppT>& evaluation,
+                                         const std::vector<libff::Fr<ppT>>& previous,
+                                         const std::vector<libff::Fr<ppT>>& full_variable_assignment,
+                                         const std::vector<size_t>& changed);
+
+/**
+ * Prover for an assignment whose A, B and L queries are already evaluated,
+ * only the witness map and the H query are computed.
+ */
+template<typename ppT>
+r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover_linear(ProverContext<ppT>& context,
+                                                             const std::vector<libff::Fr<ppT>>& full_variable_assignment,
+                                                             const r1cs_gg_ppzksnark_zok_linear_evaluation<ppT>& evaluation);
+
+/**
+ * Create proofs for many assignments of the same circuit.
+ *
+ * The witness map of assignment N+1 is computed while the multi-exponentiations
+ * of assignment N are running, the former is memory-bandwidth bound and the
+ * latter is compute bound, so overlapping them raises throughput.
+ *
+ * Throws like the single prover, e.g. r1cs_gg_ppzksnark_zok_unsatisfied for
+ * the first assignment which isn't satisfied when context.check_satisfied is
+ * set, and the context's stats, cancel and progress are restored either way.
+ */
+template<typename ppT>
+std::vector<r1cs_gg_ppzksnark_zok_proof<ppT>> r1cs_gg_ppzksnark_zok_prover_batch(ProverContext<ppT>& context,
+                                                                         const std::vector<std::vector<libff::Fr<ppT>>>& full_variable_assignments);
+
 /*
   Below are four variants of verifier algorithm for the R1CS GG-ppzkSNARK.
 
@@ -555,9 +1157,16 @@ bool r1cs_gg_ppzksnark_zok_verifier_strong_IC(const r1cs_gg_ppzksnark_zok_verifi
 
 /**
  * Convert a (non-processed) verification key into a processed verification key.
+ *
+ * When `fixed_base_c` is non-zero the gamma_ABC_g1 bases are precomputed in
+ * windows of that many bits, and the online verifiers accumulate the input
+ * with a single bucket pass instead of a scalar multiplication per input.
+ * This pays off for circuits with many public inputs, the table takes
+ * ceil(254/c) points per input.
  */
 template<typename ppT>
-r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> r1cs_gg_ppzksnark_zok_verifier_process_vk(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk);
+r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> r1cs_gg_ppzksnark_zok_verifier_process_vk(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk,
+                                                                                        unsigned int fixed_base_c = 0);
 
 /**
  * A verifier algorithm for the R1CS GG-ppzkSNARK that:
@@ -579,6 +1188,36 @@ bool r1cs_gg_ppzksnark_zok_online_verifier_strong_IC(const r1cs_gg_ppzksnark_zok
                                                  const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
                                                  const r1cs_gg_ppzksnark_zok_proof<ppT> &proof);
 
+template<typename ppT>
+using r1cs_gg_ppzksnark_zok_batch_item = std::pair<r1cs_gg_ppzksnark_zok_primary_input<ppT>, r1cs_gg_ppzksnark_zok_proof<ppT>>;
+
+/**
+ * A batch verifier for many proofs of the same verification key, with strong
+ * input consistency.
+ *
+ * Each proof is scaled by a random r_i and all are checked at once:
+ *
+ *   prod_i e(r_i*A_i, B_i) * e(-sum(r_i)*alpha, beta)
+ *     * e(-sum(r_i*acc_i), gamma) * e(-sum(r_i*C_i), delta) == 1
+ *
+ * which is a Miller loop over N+3 pairs and one final exponentiation.
+ *
+ * The proofs' points are checked to be on the curve first, and each of
+ * their B points to be in the G2 subgroup, in parallel. Proofs
+ * which fail these checks are rejected on their own and left out of the
+ * combined check. If `valid` is given it gets one entry per proof, when the
+ * combined check fails each proof in it is re-checked to find the bad ones.
+ */
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_online_verifier_batch(const r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> &pvk,
+                                             const std::vector<r1cs_gg_ppzksnark_zok_batch_item<ppT>> &items,
+                                             std::vector<bool> *valid = nullptr);
+
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_verifier_batch(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk,
+                                      const std::vector<r1cs_gg_ppzksnark_zok_batch_item<ppT>> &items,
+                                      std::vector<bool> *valid = nullptr);
+
 /****************************** Miscellaneous ********************************/
 
 /**
@@ -16,9 +16,21 @@ See r1cs_gg_ppzksnark_zok.hpp .
 
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
 #include <functional>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
 #include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <libff/algebra/scalar_multiplication/multiexp.hpp>
 #include <libff/common/profiling.hpp>
@@ -31,6 +43,9 @@ See r1cs_gg_ppzksnark_zok.hpp .
 #include <libsnark/knowledge_commitment/kc_multiexp.hpp>
 #include <libsnark/reductions/r1cs_to_qap/r1cs_to_qap.hpp>
 
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_simd.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_trace.hpp"
+
 namespace libsnark {
 
 /******************************** Proving key ********************************/
@@ -274,10 +289,111 @@ r1cs_gg_ppzksnark_zok_verification_key<ppT> r1cs_gg_ppzksnark_zok_verification_k
     return result;
 }
 
+/**
+ * The Lagrange basis at t of the coset g*S, of the QAP's domain S and the
+ * multiplicative generator g which the prover's coset FFTs use. As H has
+ * degree below m, H(t) = sum(H(g*s_i) * L_i(t)), so an H query of these
+ * times Z(t)/delta pairs with the evaluations of H on the coset.
+ */
+template<typename FieldT>
+static std::vector<FieldT> r1cs_gg_ppzksnark_zok_coset_lagrange(libfqfft::evaluation_domain<FieldT> &domain, const FieldT &t)
+{
+    /* The basis of g*S at t is that of S at t/g */
+    return domain.evaluate_all_lagrange_polynomials(t * FieldT::multiplicative_generator.inverse());
+}
+
+/**
+ * The memory of libff::get_window_table for a window of `window_size` bits
+ */
+template<typename T>
+static size_t r1cs_gg_ppzksnark_zok_window_table_bytes(size_t scalar_size, size_t window_size)
+{
+    const size_t outerc = (scalar_size + window_size - 1) / window_size;
+    const size_t last_in_window = 1ul << (scalar_size - (outerc - 1) * window_size);
+    return ((outerc - 1) * (1ul << window_size) + last_in_window) * sizeof(T);
+}
+
+/**
+ * The additions of `count` windowed exponentiations, with building the table
+ */
+static inline double r1cs_gg_ppzksnark_zok_window_cost(size_t count, size_t scalar_size, size_t window_size)
+{
+    const size_t outerc = (scalar_size + window_size - 1) / window_size;
+    return double(count) * outerc + double(outerc) * (1ul << window_size);
+}
+
+/**
+ * The window of a table read back from a checkpoint
+ */
+template<typename T>
+static size_t r1cs_gg_ppzksnark_zok_table_window(const libff::window_table<T> &table)
+{
+    size_t window_size = 1;
+    while (!table.empty() && (1ul << window_size) < table[0].size())
+    {
+        window_size++;
+    }
+    return window_size;
+}
+
+/**
+ * Choose the G1 and G2 window sizes. Like libff they're sized for the number
+ * of exponentiations, unless ETHSNARKS_TABLE_BUDGET_MB is set, then the
+ * larger of the two tables is narrowed by a bit until both fit the budget.
+ * Each table, and how much slower a narrowed one makes the exponentiations,
+ * is reported before either is built.
+ */
+template<typename ppT>
+static void r1cs_gg_ppzksnark_zok_window_sizes(size_t g1_scalar_count,
+                                               size_t g2_scalar_count,
+                                               size_t &g1_window_size,
+                                               size_t &g2_window_size)
+{
+    const size_t scalar_size = libff::Fr<ppT>::size_in_bits();
+    const size_t g1_default = libff::get_exp_window_size<libff::G1<ppT> >(g1_scalar_count);
+    const size_t g2_default = libff::get_exp_window_size<libff::G2<ppT> >(g2_scalar_count);
+    g1_window_size = g1_default;
+    g2_window_size = g2_default;
+
+    const auto g1_bytes = [&]() { return r1cs_gg_ppzksnark_zok_window_table_bytes<libff::G1<ppT> >(scalar_size, g1_window_size); };
+    const auto g2_bytes = [&]() { return r1cs_gg_ppzksnark_zok_window_table_bytes<libff::G2<ppT> >(scalar_size, g2_window_size); };
+
+    const char *budget_env = ::getenv("ETHSNARKS_TABLE_BUDGET_MB");
+    const size_t budget = budget_env ? (std::strtoull(budget_env, nullptr, 10) << 20) : 0;
+    if (budget)
+    {
+        while (g1_bytes() + g2_bytes() > budget && (g1_window_size > 1 || g2_window_size > 1))
+        {
+            if (g2_window_size == 1 || (g1_window_size > 1 && g1_bytes() >= g2_bytes()))
+            {
+                g1_window_size--;
+            }
+            else
+            {
+                g2_window_size--;
+            }
+        }
+    }
+
+    const double g1_slowdown = r1cs_gg_ppzksnark_zok_window_cost(g1_scalar_count, scalar_size, g1_window_size)
+                             / r1cs_gg_ppzksnark_zok_window_cost(g1_scalar_count, scalar_size, g1_default);
+    const double g2_slowdown = r1cs_gg_ppzksnark_zok_window_cost(g2_scalar_count, scalar_size, g2_window_size)
+                             / r1cs_gg_ppzksnark_zok_window_cost(g2_scalar_count, scalar_size, g2_default);
+    libff::print_indent(); printf("* G1 window: %zu, table %.1f MB, %.2fx the additions of window %zu\n",
+                                  g1_window_size, g1_bytes() / 1048576.0, g1_slowdown, g1_default);
+    libff::print_indent(); printf("* G2 window: %zu, table %.1f MB, %.2fx the additions of window %zu\n",
+                                  g2_window_size, g2_bytes() / 1048576.0, g2_slowdown, g2_default);
+    if (budget && g1_bytes() + g2_bytes() > budget)
+    {
+        libff::print_indent(); printf("* Window tables exceed the budget of %zu MB\n", budget >> 20);
+    }
+}
+
 template <typename ppT>
-r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &r1cs)
+r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &r1cs,
+                                                                bool lagrange_H)
 {
-    libff::enter_block("Call to r1cs_gg_ppzksnark_zok_generator");
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_generator");
 
     /* Generate secret randomness */
     const libff::Fr<ppT> t = libff::Fr<ppT>::random_element();
@@ -296,7 +412,7 @@ r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg
     libff::print_indent(); printf("* QAP degree: %zu\n", qap.degree());
     libff::print_indent(); printf("* QAP number of input variables: %zu\n", qap.num_inputs());
 
-    libff::enter_block("Compute query densities");
+    trace_enter_block("Compute query densities");
     size_t non_zero_At = 0;
     size_t non_zero_Bt = 0;
     for (size_t i = 0; i < qap.num_variables() + 1; ++i)
@@ -310,7 +426,7 @@ r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg
             ++non_zero_Bt;
         }
     }
-    libff::leave_block("Compute query densities");
+    trace_leave_block("Compute query densities");
 
     /* qap.{At,Bt,Ct,Ht} are now in unspecified state, but we do not use them later */
     libff::Fr_vector<ppT> At = std::move(qap.At);
@@ -319,7 +435,7 @@ r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg
     libff::Fr_vector<ppT> Ht = std::move(qap.Ht);
 
     /* The gamma inverse product component: (beta*A_i(t) + alpha*B_i(t) + C_i(t)) * gamma^{-1}. */
-    libff::enter_block("Compute gamma_ABC for R1CS verification key");
+    trace_enter_block("Compute gamma_ABC for R1CS verification key");
     libff::Fr_vector<ppT> gamma_ABC;
     gamma_ABC.reserve(qap.num_inputs());
 
@@ -328,10 +444,10 @@ r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg
     {
         gamma_ABC.emplace_back((beta * At[i] + alpha * Bt[i] + Ct[i]) * gamma_inverse);
     }
-    libff::leave_block("Compute gamma_ABC for R1CS verification key");
+    trace_leave_block("Compute gamma_ABC for R1CS verification key");
 
     /* The delta inverse product component: (beta*A_i(t) + alpha*B_i(t) + C_i(t)) * delta^{-1}. */
-    libff::enter_block("Compute L query for R1CS proving key");
+    trace_enter_block("Compute L query for R1CS proving key");
     libff::Fr_vector<ppT> Lt;
     Lt.reserve(qap.num_variables() - qap.num_inputs());
 
@@ -340,7 +456,7 @@ r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg
     {
         Lt.emplace_back((beta * At[Lt_offset + i] + alpha * Bt[Lt_offset + i] + Ct[Lt_offset + i]) * delta_inverse);
     }
-    libff::leave_block("Compute L query for R1CS proving key");
+    trace_leave_block("Compute L query for R1CS proving key");
 
     /**
      * Note that H for Groth's proof system is degree d-2, but the QAP
@@ -348,6 +464,10 @@ r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg
      * style of PGHR-type proof systems)
      */
     Ht.resize(Ht.size() - 2);
+    if (lagrange_H)
+    {
+        Ht = r1cs_gg_ppzksnark_zok_coset_lagrange(*qap.domain, t);
+    }
 
 #ifdef MULTICORE
     const size_t chunks = omp_get_max_threads(); // to override, set OMP_NUM_THREADS env var or call omp_set_num_threads()
@@ -355,74 +475,71 @@ r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg
     const size_t chunks = 1;
 #endif
 
-    libff::enter_block("Generating G1 MSM window table");
-    const libff::G1<ppT> g1_generator = libff::G1<ppT>::random_element();
     const size_t g1_scalar_count = non_zero_At + non_zero_Bt + qap.num_variables();
     const size_t g1_scalar_size = libff::Fr<ppT>::size_in_bits();
-    const size_t g1_window_size = libff::get_exp_window_size<libff::G1<ppT> >(g1_scalar_count);
+    const size_t g2_scalar_count = non_zero_Bt;
+    const size_t g2_scalar_size = libff::Fr<ppT>::size_in_bits();
+    size_t g1_window_size, g2_window_size;
+    r1cs_gg_ppzksnark_zok_window_sizes<ppT>(g1_scalar_count, g2_scalar_count, g1_window_size, g2_window_size);
 
-    libff::print_indent(); printf("* G1 window: %zu\n", g1_window_size);
+    trace_enter_block("Generating G1 MSM window table");
+    const libff::G1<ppT> g1_generator = libff::G1<ppT>::random_element();
     libff::window_table<libff::G1<ppT> > g1_table = libff::get_window_table(g1_scalar_size, g1_window_size, g1_generator);
-    libff::leave_block("Generating G1 MSM window table");
+    trace_leave_block("Generating G1 MSM window table");
 
-    libff::enter_block("Generating G2 MSM window table");
+    trace_enter_block("Generating G2 MSM window table");
     const libff::G2<ppT> G2_gen = libff::G2<ppT>::random_element();
-    const size_t g2_scalar_count = non_zero_Bt;
-    const size_t g2_scalar_size = libff::Fr<ppT>::size_in_bits();
-    size_t g2_window_size = libff::get_exp_window_size<libff::G2<ppT> >(g2_scalar_count);
-
-    libff::print_indent(); printf("* G2 window: %zu\n", g2_window_size);
     libff::window_table<libff::G2<ppT> > g2_table = libff::get_window_table(g2_scalar_size, g2_window_size, G2_gen);
-    libff::leave_block("Generating G2 MSM window table");
+    trace_leave_block("Generating G2 MSM window table");
 
-    libff::enter_block("Generate R1CS proving key");
+    trace_enter_block("Generate R1CS proving key");
     libff::G1<ppT> alpha_g1 = alpha * g1_generator;
     libff::G1<ppT> beta_g1 = beta * g1_generator;
     libff::G2<ppT> beta_g2 = beta * G2_gen;
     libff::G1<ppT> delta_g1 = delta * g1_generator;
     libff::G2<ppT> delta_g2 = delta * G2_gen;
 
-    libff::enter_block("Generate queries");
-    libff::enter_block("Compute the A-query", false);
+    trace_enter_block("Generate queries");
+    trace_enter_block("Compute the A-query", false);
     libff::G1_vector<ppT> A_query = batch_exp(g1_scalar_size, g1_window_size, g1_table, At);
 #ifdef USE_MIXED_ADDITION
     libff::batch_to_special<libff::G1<ppT> >(A_query);
 #endif
-    libff::leave_block("Compute the A-query", false);
+    trace_leave_block("Compute the A-query", false);
 
-    libff::enter_block("Compute the B-query", false);
+    trace_enter_block("Compute the B-query", false);
     knowledge_commitment_vector<libff::G2<ppT>, libff::G1<ppT> > B_query = kc_batch_exp(libff::Fr<ppT>::size_in_bits(), g2_window_size, g1_window_size, g2_table, g1_table, libff::Fr<ppT>::one(), libff::Fr<ppT>::one(), Bt, chunks);
     // NOTE: if USE_MIXED_ADDITION is defined,
     // kc_batch_exp will convert its output to special form internally
-    libff::leave_block("Compute the B-query", false);
+    trace_leave_block("Compute the B-query", false);
 
-    libff::enter_block("Compute the H-query", false);
+    trace_enter_block("Compute the H-query", false);
     libff::G1_vector<ppT> H_query = batch_exp_with_coeff(g1_scalar_size, g1_window_size, g1_table, qap.Zt * delta_inverse, Ht);
 #ifdef USE_MIXED_ADDITION
     libff::batch_to_special<libff::G1<ppT> >(H_query);
 #endif
-    libff::leave_block("Compute the H-query", false);
+    trace_leave_block("Compute the H-query", false);
 
-    libff::enter_block("Compute the L-query", false);
+    trace_enter_block("Compute the L-query", false);
     libff::G1_vector<ppT> L_query = batch_exp(g1_scalar_size, g1_window_size, g1_table, Lt);
 #ifdef USE_MIXED_ADDITION
     libff::batch_to_special<libff::G1<ppT> >(L_query);
 #endif
-    libff::leave_block("Compute the L-query", false);
-    libff::leave_block("Generate queries");
+    trace_leave_block("Compute the L-query", false);
+    trace_leave_block("Generate queries");
 
-    libff::leave_block("Generate R1CS proving key");
+    trace_leave_block("Generate R1CS proving key");
 
-    libff::enter_block("Generate R1CS verification key");
+    trace_enter_block("Generate R1CS verification key");
     libff::G2<ppT> gamma_g2 = gamma * G2_gen;
 
-    libff::enter_block("Encode gamma_ABC for R1CS verification key");
+    trace_enter_block("Encode gamma_ABC for R1CS verification key");
     libff::G1<ppT> gamma_ABC_g1_0 = gamma_ABC_0 * g1_generator;
     libff::G1_vector<ppT> gamma_ABC_g1_values = batch_exp(g1_scalar_size, g1_window_size, g1_table, gamma_ABC);
-    libff::leave_block("Encode gamma_ABC for R1CS verification key");
-    libff::leave_block("Generate R1CS verification key");
+    trace_leave_block("Encode gamma_ABC for R1CS verification key");
+    trace_leave_block("Generate R1CS verification key");
 
-    libff::leave_block("Call to r1cs_gg_ppzksnark_zok_generator");
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_generator");
 
     accumulation_vector<libff::G1<ppT> > gamma_ABC_g1(std::move(gamma_ABC_g1_0), std::move(gamma_ABC_g1_values));
 
@@ -448,224 +565,2359 @@ r1cs_gg_ppzksnark_zok_keypair<ppT> r1cs_gg_ppzksnark_zok_generator(const r1cs_gg
     return r1cs_gg_ppzksnark_zok_keypair<ppT>(std::move(pk), std::move(vk));
 }
 
-template <typename ppT>
-r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover(ProverContext<ppT>& context, const std::vector<libff::Fr<ppT>>& full_variable_assignment)
+/**
+ * Select the non-zero entries of a QAP evaluation, for the sparse A and B queries
+ */
+template<typename FieldT>
+static void r1cs_gg_ppzksnark_zok_compact(const std::vector<FieldT> &in, std::vector<size_t> &indices, std::vector<FieldT> &values)
 {
-    libff::enter_block("Call to r1cs_gg_ppzksnark_zok_prover");
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        if (!in[i].is_zero())
+        {
+            indices.emplace_back(i);
+            values.emplace_back(in[i]);
+        }
+    }
+}
 
-    const std::shared_ptr<libfqfft::evaluation_domain<libff::Fr<ppT>>>& domain = context.domain;
-    const r1cs_gg_ppzksnark_zok_proving_key_nozk<ppT>& pk = context.provingKey;
-    const r1cs_constraint_system<libff::Fr<ppT>>& cs = *context.constraint_system;
+/**
+ * Checkpoint files are written to a temporary name, synced to disk, then
+ * renamed, so a file which exists is always complete. Window tables and
+ * point vectors use the std::vector serialization of libff. Returns false
+ * if it couldn't be written, leaving no file behind.
+ */
+template<typename T>
+static bool r1cs_gg_ppzksnark_zok_checkpoint_write(const std::string &path, const T &obj, mode_t mode = 0644)
+{
+    const std::string tmp_path = path + ".tmp";
 
-    libff::enter_block("Compute the polynomial H");
-    r1cs_to_qap_witness_map(
-        context.domain,
-        cs,
-        full_variable_assignment,
-        context.aA,
-        context.aB,
-        context.aH
-    );
+    /* Created first so it has `mode` before anything is written to it,
+       the stream opens and keeps the same file */
+    const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+    bool ok = fd >= 0 && 0 == ::fchmod(fd, mode);
+    if (ok)
+    {
+        std::ofstream out(tmp_path, std::ios::binary);
+        out << obj;
+        out.close();
+        ok = !out.fail() && 0 == ::fsync(fd);
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
 
-    /* We are dividing degree 2(d-1) polynomial by degree d polynomial
-       and not adding a PGHR-style ZK-patch, so our H is degree d-2 */
-    assert(!context.aH[domain->m-2].is_zero());
-    assert(context.aH[domain->m-1].is_zero());
-    assert(context.aH[domain->m].is_zero());
-    libff::leave_block("Compute the polynomial H");
+    if (!ok || 0 != std::rename(tmp_path.c_str(), path.c_str()))
+    {
+        std::cerr << "Error: cannot write " << path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
 
-#ifdef DEBUG
-    assert(full_variable_assignment.size() == cs.num_variables() + 1);
-    assert(pk.A_query.domain_size() == cs.num_variables()+1);
-    assert(pk.B_query.domain_size() == cs.num_variables()+1);
-    assert(pk.H_query.size() == domain->m - 1);
-    assert(pk.L_query.size() == cs.num_variables() - cs.num_inputs());
+template<typename T>
+static bool r1cs_gg_ppzksnark_zok_checkpoint_read(const std::string &path, T &obj)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+    {
+        return false;
+    }
+    in >> obj;
+    return !in.fail();
+}
+
+/**
+ * Exponentiate the scalars of one segment of a query
+ */
+template<typename T, typename FieldT>
+static std::vector<T> r1cs_gg_ppzksnark_zok_query_segment(size_t offset,
+                                                          size_t segment_size,
+                                                          size_t scalar_size,
+                                                          size_t window_size,
+                                                          const libff::window_table<T> &table,
+                                                          const FieldT &coeff,
+                                                          const std::vector<FieldT> &scalars)
+{
+    const size_t end = std::min(scalars.size(), offset + segment_size);
+    const std::vector<FieldT> segment_scalars(scalars.begin() + offset, scalars.begin() + end);
+    std::vector<T> points = batch_exp_with_coeff(scalar_size, window_size, table, coeff, segment_scalars);
+#ifdef USE_MIXED_ADDITION
+    libff::batch_to_special<T>(points);
 #endif
+    return points;
+}
 
-    libff::enter_block("Compute the proof");
+/**
+ * Exponentiate `scalars` segment by segment, writing the points of each
+ * segment to `out` as they are completed. When a checkpoint directory is
+ * given each segment is persisted there first, and when resuming segments
+ * which already exist are read back instead of being recomputed.
+ */
+template<typename T, typename FieldT>
+static void r1cs_gg_ppzksnark_zok_generate_query(std::ostream &out,
+                                                 const std::string &name,
+                                                 const std::string &checkpoint_dir,
+                                                 bool resume,
+                                                 size_t segment_size,
+                                                 size_t scalar_size,
+                                                 size_t window_size,
+                                                 const libff::window_table<T> &table,
+                                                 const FieldT &coeff,
+                                                 const std::vector<FieldT> &scalars)
+{
+    out << scalars.size() << "\n";
 
-    libff::enter_block("Compute evaluation to A-query", false);
-    libff::G1<ppT> evaluation_At = kc_multi_exp_with_mixed_addition<libff::G1<ppT>,
-                                                                    libff::Fr<ppT>,
-                                                                    libff::multi_exp_method_BDLO12>(
-        pk.A_query,
-        full_variable_assignment.begin(),
-        full_variable_assignment.begin() + cs.num_variables() + 1,
-        context.scratch_exponents,
-        context.config);
-    libff::leave_block("Compute evaluation to A-query", false);
+    for (size_t offset = 0, segment = 0; offset < scalars.size(); offset += segment_size, segment++)
+    {
+        std::vector<T> points;
+        const std::string path = checkpoint_dir + "/" + name + "." + std::to_string(segment);
 
-    libff::enter_block("Compute evaluation to B-query", false);
-    libff::G2<ppT> evaluation_Bt = kc_multi_exp_with_mixed_addition<libff::G2<ppT>,
-                                                                    libff::Fr<ppT>,
-                                                                    libff::multi_exp_method_BDLO12>(
-        pk.B_query,
-        full_variable_assignment.begin(),
-        full_variable_assignment.begin() + cs.num_variables() + 1,
-        context.scratch_exponents,
-        context.config);
-    libff::leave_block("Compute evaluation to B-query", false);
-
-    libff::enter_block("Compute evaluation to H-query", false);
-    libff::G1<ppT> evaluation_Ht = libff::multi_exp<libff::G1<ppT>,
-                                                    libff::Fr<ppT>,
-                                                    libff::multi_exp_method_BDLO12>(
-        pk.H_query.begin(),
-        pk.H_query.begin() + (domain->m - 1),
-        context.aH.begin(),
-        context.aH.begin() + (domain->m - 1),
-        context.scratch_exponents,
-        context.config);
-    libff::leave_block("Compute evaluation to H-query", false);
-
-    libff::enter_block("Compute evaluation to L-query", false);
-    libff::G1<ppT> evaluation_Lt = libff::multi_exp_with_mixed_addition<libff::G1<ppT>,
-                                                                        libff::Fr<ppT>,
-                                                                        libff::multi_exp_method_BDLO12>(
-        pk.L_query.begin(),
-        pk.L_query.end(),
-        full_variable_assignment.begin() + cs.num_inputs() + 1,
-        full_variable_assignment.begin() + cs.num_variables() + 1,
-        context.scratch_exponents,
-        context.config);
-    libff::leave_block("Compute evaluation to L-query", false);
+        if (!resume || !r1cs_gg_ppzksnark_zok_checkpoint_read(path, points))
+        {
+            points = r1cs_gg_ppzksnark_zok_query_segment(offset, segment_size, scalar_size, window_size, table, coeff, scalars);
+            if (!checkpoint_dir.empty() && !r1cs_gg_ppzksnark_zok_checkpoint_write(path, points))
+            {
+                throw std::runtime_error("cannot write the checkpoint " + path);
+            }
+        }
+        else
+        {
+            libff::print_indent(); printf("* Resumed %s segment %zu\n", name.c_str(), segment);
+        }
 
-    /* A = alpha + sum_i(a_i*A_i(t)) */
-    libff::G1<ppT> g1_A = pk.alpha_g1 + evaluation_At;
+        for (const auto &p : points)
+        {
+            out << p << OUTPUT_NEWLINE;
+        }
+    }
+}
 
-    /* B = beta + sum_i(a_i*B_i(t)) */
-    libff::G2<ppT> g2_B = pk.beta_g2 + evaluation_Bt;
+/**
+ * Everything the nozk generator derives from the secrets before the queries
+ * are exponentiated: the evaluated QAP as the scalars of each query, and the
+ * generators with their window tables.
+ */
+template<typename ppT>
+struct r1cs_gg_ppzksnark_zok_generator_setup
+{
+    libff::Fr<ppT> alpha;
+    libff::Fr<ppT> beta;
+    libff::Fr<ppT> gamma;
+    libff::Fr<ppT> delta;
+    libff::Fr<ppT> Zt_delta_inverse;
+    libff::Fr<ppT> gamma_ABC_0;
+    libff::Fr_vector<ppT> gamma_ABC;
 
-    /* C = sum_i(a_i*((beta*A_i(t) + alpha*B_i(t) + C_i(t)) + H(t)*Z(t))/delta) */
-    libff::G1<ppT> g1_C = evaluation_Ht + evaluation_Lt;
+    sparse_vector<libff::G1<ppT>> A_query;
+    sparse_vector<libff::G2<ppT>> B_query;
+    libff::Fr_vector<ppT> At_values;
+    libff::Fr_vector<ppT> Bt_values;
+    libff::Fr_vector<ppT> Ht;
+    libff::Fr_vector<ppT> Lt;
 
-    libff::leave_block("Compute the proof");
+    libff::G1<ppT> g1_generator;
+    libff::G2<ppT> g2_generator;
+    libff::window_table<libff::G1<ppT> > g1_table;
+    libff::window_table<libff::G2<ppT> > g2_table;
+    size_t g1_scalar_size;
+    size_t g1_window_size;
+    size_t g2_scalar_size;
+    size_t g2_window_size;
+
+    bool resumed;   // the secrets, tables and segments are the checkpoint's
+};
+
+/**
+ * A 64-bit FNV-1a hash of everything written to it, which identifies the
+ * constraint system of a checkpoint without holding its serialization
+ */
+class r1cs_gg_ppzksnark_zok_hash_buf : public std::streambuf
+{
+public:
+    uint64_t hash = 14695981039346656037ull;
 
-    libff::leave_block("Call to r1cs_gg_ppzksnark_zok_prover");
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+        }
+        return traits_type::not_eof(c);
+    }
 
-    r1cs_gg_ppzksnark_zok_proof<ppT> proof = r1cs_gg_ppzksnark_zok_proof<ppT>(std::move(g1_A), std::move(g2_B), std::move(g1_C));
-    proof.print_size();
+    std::streamsize xsputn(const char *data, std::streamsize n) override
+    {
+        for (std::streamsize i = 0; i < n; i++)
+        {
+            hash = (hash ^ uint8_t(data[i])) * 1099511628211ull;
+        }
+        return n;
+    }
+};
 
-    return proof;
+/**
+ * The `manifest` of a checkpoint directory, a resume is refused unless the
+ * circuit and the way its queries are cut into segments are the same
+ */
+template<typename ppT>
+static std::string r1cs_gg_ppzksnark_zok_setup_manifest(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &r1cs,
+                                                        size_t segment_size,
+                                                        bool lagrange_H)
+{
+    r1cs_gg_ppzksnark_zok_hash_buf buf;
+    std::ostream hasher(&buf);
+    hasher << r1cs;
+
+    std::ostringstream manifest;
+    manifest << "constraint_system " << std::hex << buf.hash << std::dec << "\n"
+             << "segment_size " << segment_size << "\n"
+             << "lagrange_H " << lagrange_H << "\n";
+    return manifest.str();
 }
 
-template <typename ppT>
-r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> r1cs_gg_ppzksnark_zok_verifier_process_vk(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk)
+/**
+ * Remove the checkpointed segments of a query with `size` scalars
+ */
+static inline void r1cs_gg_ppzksnark_zok_remove_segments(const std::string &checkpoint_dir,
+                                                         const std::string &name,
+                                                         size_t size,
+                                                         size_t segment_size)
 {
-    libff::enter_block("Call to r1cs_gg_ppzksnark_zok_verifier_process_vk");
-
-    r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> pvk;
-    pvk.vk_alpha_g1 = vk.alpha_g1;
-    pvk.vk_beta_g2 = vk.beta_g2;
-    pvk.vk_gamma_g2_precomp = ppT::precompute_G2(vk.gamma_g2);
-    pvk.vk_delta_g2_precomp = ppT::precompute_G2(vk.delta_g2);
-    pvk.gamma_ABC_g1 = vk.gamma_ABC_g1;
-
-    libff::leave_block("Call to r1cs_gg_ppzksnark_zok_verifier_process_vk");
-
-    return pvk;
+    for (size_t segment = 0; segment * segment_size < size; segment++)
+    {
+        std::remove((checkpoint_dir + "/" + name + "." + std::to_string(segment)).c_str());
+    }
 }
 
+/**
+ * Throws std::runtime_error if the checkpoint can't be resumed or written.
+ * The secrets are written last, so a checkpoint with them is complete.
+ */
 template <typename ppT>
-bool r1cs_gg_ppzksnark_zok_online_verifier_weak_IC(const r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> &pvk,
-                                               const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
-                                               const r1cs_gg_ppzksnark_zok_proof<ppT> &proof)
+static void r1cs_gg_ppzksnark_zok_generator_setup_init(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &r1cs,
+                                                       const std::string &checkpoint_dir,
+                                                       size_t segment_size,
+                                                       bool lagrange_H,
+                                                       r1cs_gg_ppzksnark_zok_generator_setup<ppT> &setup)
 {
-    libff::enter_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_weak_IC");
-    assert(pvk.gamma_ABC_g1.domain_size() >= primary_input.size());
+    /* Generate secret randomness, or resume with the randomness of an interrupted run */
+    std::vector<libff::Fr<ppT>> secrets;
+    const std::string secrets_path = checkpoint_dir + "/secrets";
+    const std::string manifest_path = checkpoint_dir + "/manifest";
+    std::string manifest;
+    setup.resumed = false;
+    if (!checkpoint_dir.empty())
+    {
+        manifest = r1cs_gg_ppzksnark_zok_setup_manifest(r1cs, segment_size, lagrange_H);
+        setup.resumed = r1cs_gg_ppzksnark_zok_checkpoint_read(secrets_path, secrets) && secrets.size() == 5;
+    }
+    if (setup.resumed)
+    {
+        std::ifstream in(manifest_path);
+        std::stringstream found;
+        found << in.rdbuf();
+        if (found.str() != manifest)
+        {
+            throw std::runtime_error(checkpoint_dir + " is the setup of another constraint system or segment size, it can't be resumed");
+        }
+        libff::print_indent(); printf("* Resumed the setup in %s\n", checkpoint_dir.c_str());
+    }
+    else
+    {
+        secrets.clear();
+        for (size_t i = 0; i < 5; i++)
+        {
+            secrets.emplace_back(libff::Fr<ppT>::random_element());
+        }
+    }
+    const libff::Fr<ppT> t = secrets[0];
+    const libff::Fr<ppT> alpha = secrets[1];
+    const libff::Fr<ppT> beta = secrets[2];
+    const libff::Fr<ppT> gamma = secrets[3];
+    const libff::Fr<ppT> delta = secrets[4];
+    const libff::Fr<ppT> gamma_inverse = gamma.inverse();
+    const libff::Fr<ppT> delta_inverse = delta.inverse();
+    setup.alpha = alpha;
+    setup.beta = beta;
+    setup.gamma = gamma;
+    setup.delta = delta;
 
-    libff::enter_block("Accumulate input");
-    const accumulation_vector<libff::G1<ppT> > accumulated_IC = pvk.gamma_ABC_g1.template accumulate_chunk<libff::Fr<ppT> >(primary_input.begin(), primary_input.end(), 0);
-    const libff::G1<ppT> &acc = accumulated_IC.first;
-    libff::leave_block("Accumulate input");
+    /* A quadratic arithmetic program evaluated at t. */
+    qap_instance_evaluation<libff::Fr<ppT> > qap = r1cs_to_qap_instance_map_with_evaluation(r1cs, t);
 
-    bool result = true;
+    const size_t num_variables = qap.num_variables();
+    const size_t num_inputs = qap.num_inputs();
+    setup.Zt_delta_inverse = qap.Zt * delta_inverse;
 
-    libff::enter_block("Check if the proof is well-formed");
-    if (!proof.is_well_formed())
+    libff::Fr_vector<ppT> At = std::move(qap.At);
+    libff::Fr_vector<ppT> Bt = std::move(qap.Bt);
+    libff::Fr_vector<ppT> Ct = std::move(qap.Ct);
+    setup.Ht = std::move(qap.Ht);
+
+    trace_enter_block("Compute gamma_ABC and L query scalars");
+    setup.gamma_ABC_0 = (beta * At[0] + alpha * Bt[0] + Ct[0]) * gamma_inverse;
+    setup.gamma_ABC.reserve(num_inputs);
+    for (size_t i = 1; i < num_inputs + 1; ++i)
     {
-        if (!libff::inhibit_profiling_info)
-        {
-            libff::print_indent(); printf("At least one of the proof elements does not lie on the curve.\n");
-        }
-        result = false;
+        setup.gamma_ABC.emplace_back((beta * At[i] + alpha * Bt[i] + Ct[i]) * gamma_inverse);
     }
-    libff::leave_block("Check if the proof is well-formed");
 
-    libff::enter_block("Online pairing computations");
-    libff::enter_block("Check QAP divisibility");
-    const libff::G1_precomp<ppT> proof_g_A_precomp = ppT::precompute_G1(proof.g_A);
-    const libff::G2_precomp<ppT> proof_g_B_precomp = ppT::precompute_G2(proof.g_B);
-    const libff::G1_precomp<ppT> proof_g_C_precomp = ppT::precompute_G1(proof.g_C);
-    const libff::G1_precomp<ppT> acc_precomp = ppT::precompute_G1(acc);
+    setup.Lt.reserve(num_variables - num_inputs);
+    const size_t Lt_offset = num_inputs + 1;
+    for (size_t i = 0; i < num_variables - num_inputs; ++i)
+    {
+        setup.Lt.emplace_back((beta * At[Lt_offset + i] + alpha * Bt[Lt_offset + i] + Ct[Lt_offset + i]) * delta_inverse);
+    }
+    libff::Fr_vector<ppT>().swap(Ct);
+    trace_leave_block("Compute gamma_ABC and L query scalars");
 
-    const libff::Fqk<ppT> QAP1 = ppT::miller_loop(proof_g_A_precomp,  proof_g_B_precomp);
-    const libff::Fqk<ppT> QAP2 = ppT::double_miller_loop(
-        acc_precomp, pvk.vk_gamma_g2_precomp,
-        proof_g_C_precomp, pvk.vk_delta_g2_precomp);
-    const libff::GT<ppT> QAP = ppT::final_exponentiation(QAP1 * QAP2.unitary_inverse());
+    /* See r1cs_gg_ppzksnark_zok_generator, H is degree d-2 */
+    setup.Ht.resize(setup.Ht.size() - 2);
+    if (lagrange_H)
+    {
+        setup.Ht = r1cs_gg_ppzksnark_zok_coset_lagrange(*qap.domain, t);
+    }
 
-    libff::GT<ppT> vk_alpha_g1_beta_g2 = ppT::reduced_pairing(pvk.vk_alpha_g1, pvk.vk_beta_g2);
+    /* Only the non-zero A and B entries are kept by the nozk key, and the
+       G1 half of the B-query knowledge commitment isn't needed at all */
+    setup.A_query.domain_size_ = At.size();
+    setup.B_query.domain_size_ = Bt.size();
+    r1cs_gg_ppzksnark_zok_compact(At, setup.A_query.indices, setup.At_values);
+    r1cs_gg_ppzksnark_zok_compact(Bt, setup.B_query.indices, setup.Bt_values);
+    libff::Fr_vector<ppT>().swap(At);
+    libff::Fr_vector<ppT>().swap(Bt);
 
-    if (QAP != vk_alpha_g1_beta_g2)
+    if (!checkpoint_dir.empty() && !setup.resumed)
     {
-        if (!libff::inhibit_profiling_info)
+        /* Segments left by an earlier setup are of other secrets */
+        r1cs_gg_ppzksnark_zok_remove_segments(checkpoint_dir, "A_query", setup.At_values.size(), segment_size);
+        r1cs_gg_ppzksnark_zok_remove_segments(checkpoint_dir, "B_query", setup.Bt_values.size(), segment_size);
+        r1cs_gg_ppzksnark_zok_remove_segments(checkpoint_dir, "H_query", setup.Ht.size(), segment_size);
+        r1cs_gg_ppzksnark_zok_remove_segments(checkpoint_dir, "L_query", setup.Lt.size(), segment_size);
+    }
+
+    /* The generators are chosen once, with their window tables, and both are
+       kept in the checkpoint so resumed segments are consistent */
+    std::vector<libff::G1<ppT>> g1_generator_v;
+    std::vector<libff::G2<ppT>> g2_generator_v;
+    const bool resume_tables = setup.resumed
+        && r1cs_gg_ppzksnark_zok_checkpoint_read(checkpoint_dir + "/g1_generator", g1_generator_v)
+        && r1cs_gg_ppzksnark_zok_checkpoint_read(checkpoint_dir + "/g2_generator", g2_generator_v)
+        && r1cs_gg_ppzksnark_zok_checkpoint_read(checkpoint_dir + "/g1_table", setup.g1_table)
+        && r1cs_gg_ppzksnark_zok_checkpoint_read(checkpoint_dir + "/g2_table", setup.g2_table);
+
+    const size_t g1_scalar_count = setup.At_values.size() + num_variables;
+    setup.g1_scalar_size = libff::Fr<ppT>::size_in_bits();
+    setup.g2_scalar_size = libff::Fr<ppT>::size_in_bits();
+    if (setup.resumed && !resume_tables)
+    {
+        throw std::runtime_error("the window tables of " + checkpoint_dir + " are missing, it can't be resumed");
+    }
+    if (resume_tables)
+    {
+        /* The budget may have changed, the tables decide the windows */
+        setup.g1_window_size = r1cs_gg_ppzksnark_zok_table_window(setup.g1_table);
+        setup.g2_window_size = r1cs_gg_ppzksnark_zok_table_window(setup.g2_table);
+        libff::print_indent(); printf("* Resumed G1 window: %zu\n", setup.g1_window_size);
+        libff::print_indent(); printf("* Resumed G2 window: %zu\n", setup.g2_window_size);
+    }
+    else
+    {
+        r1cs_gg_ppzksnark_zok_window_sizes<ppT>(g1_scalar_count, setup.Bt_values.size(), setup.g1_window_size, setup.g2_window_size);
+
+        trace_enter_block("Generating G1 MSM window table");
+        g1_generator_v = {libff::G1<ppT>::random_element()};
+        setup.g1_table = libff::get_window_table(setup.g1_scalar_size, setup.g1_window_size, g1_generator_v[0]);
+        trace_leave_block("Generating G1 MSM window table");
+
+        trace_enter_block("Generating G2 MSM window table");
+        g2_generator_v = {libff::G2<ppT>::random_element()};
+        setup.g2_table = libff::get_window_table(setup.g2_scalar_size, setup.g2_window_size, g2_generator_v[0]);
+        trace_leave_block("Generating G2 MSM window table");
+
+        if (!checkpoint_dir.empty())
         {
-            libff::print_indent(); printf("QAP divisibility check failed.\n");
+            /* Only the owner may read any of the setup */
+            if (!r1cs_gg_ppzksnark_zok_checkpoint_write(checkpoint_dir + "/g1_table", setup.g1_table, 0600)
+             || !r1cs_gg_ppzksnark_zok_checkpoint_write(checkpoint_dir + "/g2_table", setup.g2_table, 0600)
+             || !r1cs_gg_ppzksnark_zok_checkpoint_write(checkpoint_dir + "/g1_generator", g1_generator_v, 0600)
+             || !r1cs_gg_ppzksnark_zok_checkpoint_write(checkpoint_dir + "/g2_generator", g2_generator_v, 0600)
+             || !r1cs_gg_ppzksnark_zok_checkpoint_write(manifest_path, manifest)
+             || !r1cs_gg_ppzksnark_zok_checkpoint_write(secrets_path, secrets, 0600))
+            {
+                throw std::runtime_error("cannot write the checkpoint in " + checkpoint_dir);
+            }
         }
-        result = false;
     }
-    libff::leave_block("Check QAP divisibility");
-    libff::leave_block("Online pairing computations");
+    setup.g1_generator = g1_generator_v[0];
+    setup.g2_generator = g2_generator_v[0];
+}
 
-    libff::leave_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_weak_IC");
+template <typename ppT>
+r1cs_gg_ppzksnark_zok_verification_key<ppT> r1cs_gg_ppzksnark_zok_generator_nozk(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &r1cs,
+                                                                             std::ostream &pk_out,
+                                                                             const std::string &checkpoint_dir,
+                                                                             size_t segment_size,
+                                                                             bool lagrange_H)
+{
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_generator_nozk");
+
+    r1cs_gg_ppzksnark_zok_generator_setup<ppT> setup;
+    r1cs_gg_ppzksnark_zok_generator_setup_init(r1cs, checkpoint_dir, segment_size, lagrange_H, setup);
+    const libff::G1<ppT> g1_generator = setup.g1_generator;
+    const libff::G2<ppT> G2_gen = setup.g2_generator;
+
+    trace_enter_block("Generate and write R1CS proving key");
+    const libff::G1<ppT> alpha_g1 = setup.alpha * g1_generator;
+    const libff::G2<ppT> beta_g2 = setup.beta * G2_gen;
+    const libff::G2<ppT> delta_g2 = setup.delta * G2_gen;
+
+    pk_out << alpha_g1 << OUTPUT_NEWLINE;
+    pk_out << (setup.beta * g1_generator) << OUTPUT_NEWLINE;
+    pk_out << beta_g2 << OUTPUT_NEWLINE;
+    pk_out << (setup.delta * g1_generator) << OUTPUT_NEWLINE;
+    pk_out << delta_g2 << OUTPUT_NEWLINE;
+
+    /* Sections are written in the format of operator<< for sparse_vector and G1_vector */
+    trace_enter_block("Compute the A-query", false);
+    pk_out << setup.A_query.domain_size_ << "\n";
+    pk_out << setup.A_query.indices.size() << "\n";
+    for (const size_t &i : setup.A_query.indices)
+    {
+        pk_out << i << "\n";
+    }
+    r1cs_gg_ppzksnark_zok_generate_query(pk_out, "A_query", checkpoint_dir, setup.resumed, segment_size, setup.g1_scalar_size, setup.g1_window_size, setup.g1_table, libff::Fr<ppT>::one(), setup.At_values);
+    libff::Fr_vector<ppT>().swap(setup.At_values);
+    trace_leave_block("Compute the A-query", false);
+
+    trace_enter_block("Compute the B-query", false);
+    pk_out << setup.B_query.domain_size_ << "\n";
+    pk_out << setup.B_query.indices.size() << "\n";
+    for (const size_t &i : setup.B_query.indices)
+    {
+        pk_out << i << "\n";
+    }
+    r1cs_gg_ppzksnark_zok_generate_query(pk_out, "B_query", checkpoint_dir, setup.resumed, segment_size, setup.g2_scalar_size, setup.g2_window_size, setup.g2_table, libff::Fr<ppT>::one(), setup.Bt_values);
+    libff::Fr_vector<ppT>().swap(setup.Bt_values);
+    trace_leave_block("Compute the B-query", false);
+
+    trace_enter_block("Compute the H-query", false);
+    r1cs_gg_ppzksnark_zok_generate_query(pk_out, "H_query", checkpoint_dir, setup.resumed, segment_size, setup.g1_scalar_size, setup.g1_window_size, setup.g1_table, setup.Zt_delta_inverse, setup.Ht);
+    libff::Fr_vector<ppT>().swap(setup.Ht);
+    trace_leave_block("Compute the H-query", false);
+
+    trace_enter_block("Compute the L-query", false);
+    r1cs_gg_ppzksnark_zok_generate_query(pk_out, "L_query", checkpoint_dir, setup.resumed, segment_size, setup.g1_scalar_size, setup.g1_window_size, setup.g1_table, libff::Fr<ppT>::one(), setup.Lt);
+    libff::Fr_vector<ppT>().swap(setup.Lt);
+    trace_leave_block("Compute the L-query", false);
+
+    pk_out.flush();
+    trace_leave_block("Generate and write R1CS proving key");
+
+    trace_enter_block("Generate R1CS verification key");
+    libff::G2<ppT> gamma_g2 = setup.gamma * G2_gen;
+    libff::G1<ppT> gamma_ABC_g1_0 = setup.gamma_ABC_0 * g1_generator;
+    libff::G1_vector<ppT> gamma_ABC_g1_values = batch_exp(setup.g1_scalar_size, setup.g1_window_size, setup.g1_table, setup.gamma_ABC);
+    accumulation_vector<libff::G1<ppT> > gamma_ABC_g1(std::move(gamma_ABC_g1_0), std::move(gamma_ABC_g1_values));
+    trace_leave_block("Generate R1CS verification key");
 
-    return result;
+    /* The key is written, nothing is resumed after this */
+    if (!checkpoint_dir.empty() && pk_out.good())
+    {
+        std::remove((checkpoint_dir + "/secrets").c_str());
+        std::remove((checkpoint_dir + "/manifest").c_str());
+    }
+
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_generator_nozk");
+
+    return r1cs_gg_ppzksnark_zok_verification_key<ppT>(alpha_g1, beta_g2, gamma_g2, delta_g2, gamma_ABC_g1);
 }
 
-template<typename ppT>
-bool r1cs_gg_ppzksnark_zok_verifier_weak_IC(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk,
-                                        const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
-                                        const r1cs_gg_ppzksnark_zok_proof<ppT> &proof)
+/**
+ * The parameters of a prepared setup directory are one line of text:
+ * the segment size, the G1 and G2 window sizes and whether H is Lagrange
+ */
+static inline bool r1cs_gg_ppzksnark_zok_read_setup_params(const std::string &setup_dir,
+                                                           size_t &segment_size,
+                                                           size_t &g1_window_size,
+                                                           size_t &g2_window_size,
+                                                           bool &lagrange_H)
 {
-    libff::enter_block("Call to r1cs_gg_ppzksnark_zok_verifier_weak_IC");
-    r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> pvk = r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(vk);
-    bool result = r1cs_gg_ppzksnark_zok_online_verifier_weak_IC<ppT>(pvk, primary_input, proof);
-    libff::leave_block("Call to r1cs_gg_ppzksnark_zok_verifier_weak_IC");
-    return result;
+    std::ifstream in(setup_dir + "/params");
+    if (!(in >> segment_size >> g1_window_size >> g2_window_size >> lagrange_H) || segment_size == 0)
+    {
+        std::cerr << "Error: cannot read " << setup_dir << "/params, run the prepare step first" << std::endl;
+        return false;
+    }
+    return true;
 }
 
-template<typename ppT>
-bool r1cs_gg_ppzksnark_zok_online_verifier_strong_IC(const r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> &pvk,
-                                                 const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
-                                                 const r1cs_gg_ppzksnark_zok_proof<ppT> &proof)
+inline bool r1cs_gg_ppzksnark_zok_generator_read_params(const std::string &setup_dir,
+                                                        size_t &segment_size,
+                                                        bool &lagrange_H)
 {
-    bool result = true;
-    libff::enter_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_strong_IC");
+    size_t g1_window_size, g2_window_size;
+    return r1cs_gg_ppzksnark_zok_read_setup_params(setup_dir, segment_size, g1_window_size, g2_window_size, lagrange_H);
+}
 
-    if (pvk.gamma_ABC_g1.domain_size() != primary_input.size())
+template <typename ppT>
+bool r1cs_gg_ppzksnark_zok_generator_prepare(const r1cs_gg_ppzksnark_zok_constraint_system<ppT> &r1cs,
+                                             const std::string &setup_dir,
+                                             size_t segment_size,
+                                             bool lagrange_H)
+{
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_generator_prepare");
+
+    r1cs_gg_ppzksnark_zok_generator_setup<ppT> setup;
+    try
     {
-        libff::print_indent(); printf("Input length differs from expected (got %zu, expected %zu).\n", primary_input.size(), pvk.gamma_ABC_g1.domain_size());
-        result = false;
+        r1cs_gg_ppzksnark_zok_generator_setup_init(r1cs, setup_dir, segment_size, lagrange_H, setup);
     }
-    else
+    catch (const std::runtime_error &ex)
     {
-        result = r1cs_gg_ppzksnark_zok_online_verifier_weak_IC(pvk, primary_input, proof);
+        std::cerr << "Error: " << ex.what() << std::endl;
+        trace_leave_block("Call to r1cs_gg_ppzksnark_zok_generator_prepare");
+        return false;
     }
 
-    libff::leave_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_strong_IC");
-    return result;
+    /* The coefficient of the H query is folded into its scalars, so workers
+       exponentiate every query the same way */
+    for (auto &h : setup.Ht)
+    {
+        h *= setup.Zt_delta_inverse;
+    }
+
+    /* Only the owner may read the scalars, anyone holding them can recover t and delta and forge proofs */
+    trace_enter_block("Write the query scalars");
+    const bool scalars_ok = r1cs_gg_ppzksnark_zok_checkpoint_write(setup_dir + "/A_query.scalars", setup.At_values, 0600)
+        && r1cs_gg_ppzksnark_zok_checkpoint_write(setup_dir + "/B_query.scalars", setup.Bt_values, 0600)
+        && r1cs_gg_ppzksnark_zok_checkpoint_write(setup_dir + "/H_query.scalars", setup.Ht, 0600)
+        && r1cs_gg_ppzksnark_zok_checkpoint_write(setup_dir + "/L_query.scalars", setup.Lt, 0600);
+    trace_leave_block("Write the query scalars");
+
+    /* Written last, its presence means the directory is ready for workers */
+    std::ostringstream params;
+    params << segment_size << " " << setup.g1_window_size << " " << setup.g2_window_size << " " << lagrange_H << "\n";
+    if (!scalars_ok || !r1cs_gg_ppzksnark_zok_checkpoint_write(setup_dir + "/params", params.str()))
+    {
+        trace_leave_block("Call to r1cs_gg_ppzksnark_zok_generator_prepare");
+        return false;
+    }
+
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_generator_prepare");
+
+    return true;
 }
 
-template<typename ppT>
-bool r1cs_gg_ppzksnark_zok_verifier_strong_IC(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk,
-                                          const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
-                                          const r1cs_gg_ppzksnark_zok_proof<ppT> &proof)
+/**
+ * Exponentiate the segments of one query which belong to `worker_index`,
+ * those which already exist in the setup directory are skipped
+ */
+template<typename T, typename FieldT>
+static bool r1cs_gg_ppzksnark_zok_generator_worker_query(const std::string &setup_dir,
+                                                         const std::string &name,
+                                                         size_t segment_size,
+                                                         size_t window_size,
+                                                         const libff::window_table<T> &table,
+                                                         size_t worker_index,
+                                                         size_t num_workers)
 {
-    libff::enter_block("Call to r1cs_gg_ppzksnark_zok_verifier_strong_IC");
-    r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> pvk = r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(vk);
-    bool result = r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<ppT>(pvk, primary_input, proof);
-    libff::leave_block("Call to r1cs_gg_ppzksnark_zok_verifier_strong_IC");
+    std::vector<FieldT> scalars;
+    if (!r1cs_gg_ppzksnark_zok_checkpoint_read(setup_dir + "/" + name + ".scalars", scalars))
+    {
+        std::cerr << "Error: cannot read " << setup_dir << "/" << name << ".scalars" << std::endl;
+        return false;
+    }
+
+    const size_t num_segments = (scalars.size() + segment_size - 1) / segment_size;
+    for (size_t segment = worker_index; segment < num_segments; segment += num_workers)
+    {
+        const std::string path = setup_dir + "/" + name + "." + std::to_string(segment);
+        if (std::ifstream(path).is_open())
+        {
+            libff::print_indent(); printf("* Skipped %s segment %zu\n", name.c_str(), segment);
+            continue;
+        }
+
+        const auto points = r1cs_gg_ppzksnark_zok_query_segment(segment * segment_size, segment_size, FieldT::size_in_bits(),
+                                                                window_size, table, FieldT::one(), scalars);
+        if (!r1cs_gg_ppzksnark_zok_checkpoint_write(path, points))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename ppT>
+bool r1cs_gg_ppzksnark_zok_generator_worker(const std::string &setup_dir,
+                                            size_t worker_index,
+                                            size_t num_workers)
+{
+    assert(worker_index < num_workers);
+
+    size_t segment_size, g1_window_size, g2_window_size;
+    bool lagrange_H;
+    if (!r1cs_gg_ppzksnark_zok_read_setup_params(setup_dir, segment_size, g1_window_size, g2_window_size, lagrange_H))
+    {
+        return false;
+    }
+
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_generator_worker");
+
+    bool ok;
+    {
+        libff::window_table<libff::G1<ppT> > g1_table;
+        if (!r1cs_gg_ppzksnark_zok_checkpoint_read(setup_dir + "/g1_table", g1_table))
+        {
+            std::cerr << "Error: cannot read " << setup_dir << "/g1_table" << std::endl;
+            return false;
+        }
+
+        /* One query's scalars are held at a time */
+        trace_enter_block("Compute the A, H and L query segments");
+        ok = r1cs_gg_ppzksnark_zok_generator_worker_query<libff::G1<ppT>, libff::Fr<ppT>>(setup_dir, "A_query", segment_size, g1_window_size, g1_table, worker_index, num_workers)
+          && r1cs_gg_ppzksnark_zok_generator_worker_query<libff::G1<ppT>, libff::Fr<ppT>>(setup_dir, "H_query", segment_size, g1_window_size, g1_table, worker_index, num_workers)
+          && r1cs_gg_ppzksnark_zok_generator_worker_query<libff::G1<ppT>, libff::Fr<ppT>>(setup_dir, "L_query", segment_size, g1_window_size, g1_table, worker_index, num_workers);
+        trace_leave_block("Compute the A, H and L query segments");
+    }
+
+    if (ok)
+    {
+        libff::window_table<libff::G2<ppT> > g2_table;
+        if (!r1cs_gg_ppzksnark_zok_checkpoint_read(setup_dir + "/g2_table", g2_table))
+        {
+            std::cerr << "Error: cannot read " << setup_dir << "/g2_table" << std::endl;
+            return false;
+        }
+
+        trace_enter_block("Compute the B query segments");
+        ok = r1cs_gg_ppzksnark_zok_generator_worker_query<libff::G2<ppT>, libff::Fr<ppT>>(setup_dir, "B_query", segment_size, g2_window_size, g2_table, worker_index, num_workers);
+        trace_leave_block("Compute the B query segments");
+    }
+
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_generator_worker");
+
+    return ok;
+}
+
+/**
+ * The powers g^i and g^-i of the multiplicative generator for a domain of
+ * size m, which cosetFFT and icosetFFT would otherwise recompute on every
+ * call. Tables are built once per size and shared read-only.
+ */
+template<typename FieldT>
+struct r1cs_gg_ppzksnark_zok_coset_table
+{
+    std::vector<FieldT> powers;
+    std::vector<FieldT> inverse_powers;
+};
+
+template<typename FieldT>
+static std::shared_ptr<const r1cs_gg_ppzksnark_zok_coset_table<FieldT>> r1cs_gg_ppzksnark_zok_get_coset_table(size_t m, unsigned int num_threads)
+{
+    static std::mutex cache_mutex;
+    static std::map<size_t, std::shared_ptr<const r1cs_gg_ppzksnark_zok_coset_table<FieldT>>> cache;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto &entry = cache[m];
+    if (entry)
+    {
+        return entry;
+    }
+
+    trace_enter_block("Compute coset powers");
+    auto table = std::make_shared<r1cs_gg_ppzksnark_zok_coset_table<FieldT>>();
+    table->powers.resize(m);
+    table->inverse_powers.resize(m);
+
+    const FieldT g = FieldT::multiplicative_generator;
+    const FieldT g_inverse = g.inverse();
+    const auto ranges = get_cpu_ranges(0, m, num_threads);
+#ifdef MULTICORE
+#pragma omp parallel for num_threads(ranges.size())
+#endif
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        FieldT power = g ^ ranges[r].first;
+        FieldT inverse_power = g_inverse ^ ranges[r].first;
+        for (size_t i = ranges[r].first; i < ranges[r].second; i++)
+        {
+            table->powers[i] = power;
+            table->inverse_powers[i] = inverse_power;
+            power *= g;
+            inverse_power *= g_inverse;
+        }
+    }
+    trace_leave_block("Compute coset powers");
+
+    entry = table;
+    return entry;
+}
+
+/**
+ * A linear combination of a constraint at the full variable assignment,
+ * whose index 0 is ONE
+ */
+template <typename FieldT>
+static FieldT r1cs_gg_ppzksnark_zok_evaluate_lc(const linear_combination_light<FieldT>& lc,
+                                                const std::vector<FieldT>& full_variable_assignment)
+{
+    FieldT acc = FieldT::zero();
+    for (const linear_term_light<FieldT>& lt : lc.getTerms())
+    {
+        acc += lt.getCoeff() * full_variable_assignment[lt.index];
+    }
+    return acc;
+}
+
+/**
+ * The witness map of r1cs_to_qap, with the evaluation of every constraint's
+ * A, B and C linear combinations split over `get_cpu_ranges` partitions.
+ * Each worker writes only its own range of `aA`, `aB` and `aH` (which holds
+ * C until the quotient is computed in place), and the same static ranges
+ * are re-used for the point-wise products so a range stays with its worker.
+ * Each group of FFTs is recorded as an 'fft' phase, nested in 'witness_map'.
+ */
+template <typename ppT>
+static void r1cs_gg_ppzksnark_zok_qap_witness_map(const ProverContext<ppT>& context,
+                                                  const std::vector<libff::Fr<ppT>>& full_variable_assignment,
+                                                  std::vector<libff::Fr<ppT>>& aA,
+                                                  std::vector<libff::Fr<ppT>>& aB,
+                                                  std::vector<libff::Fr<ppT>>& aH,
+                                                  unsigned int num_threads)
+{
+    typedef libff::Fr<ppT> FieldT;
+
+    const std::shared_ptr<libfqfft::evaluation_domain<FieldT>>& domain = context.domain;
+    const r1cs_constraint_system<FieldT>& cs = *context.constraint_system;
+    const size_t m = domain->m;
+    const size_t num_constraints = cs.num_constraints();
+    const size_t num_inputs = cs.num_inputs();
+    const FieldT zero = FieldT::zero();
+
+    /* Shrinking keeps the capacity from ProverContext::preallocate() */
+    aA.resize(m);
+    aB.resize(m);
+    aH.resize(m);
+
+    const auto ranges = get_cpu_ranges(0, m, num_threads);
+    const auto coset = r1cs_gg_ppzksnark_zok_get_coset_table<FieldT>(m, num_threads);
+
+    context.checkpoint("evaluate");
+
+    /* The first constraint which isn't satisfied, when checking */
+    std::atomic<size_t> unsatisfied(num_constraints);
+
+    trace_enter_block("Compute evaluation of polynomials A, B and C on set S");
+#ifdef MULTICORE
+#pragma omp parallel for schedule(static, 1) num_threads(ranges.size())
+#endif
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        for (size_t i = ranges[r].first; i < ranges[r].second; i++)
+        {
+            if (i < num_constraints)
+            {
+                const auto& constraint = *cs.constraints[i];
+                aA[i] = r1cs_gg_ppzksnark_zok_evaluate_lc(constraint.getA(), full_variable_assignment);
+                aB[i] = r1cs_gg_ppzksnark_zok_evaluate_lc(constraint.getB(), full_variable_assignment);
+                aH[i] = r1cs_gg_ppzksnark_zok_evaluate_lc(constraint.getC(), full_variable_assignment);
+
+                if (context.check_satisfied && aA[i] * aB[i] != aH[i])
+                {
+                    size_t first = unsatisfied.load();
+                    while (i < first && !unsatisfied.compare_exchange_weak(first, i)) {}
+                }
+            }
+            else if (i <= num_constraints + num_inputs)
+            {
+                /* Input consistency constraints, x_i * 0 = 0, where x_0 is ONE */
+                aA[i] = full_variable_assignment[i - num_constraints];
+                aB[i] = zero;
+                aH[i] = zero;
+            }
+            else
+            {
+                aA[i] = zero;
+                aB[i] = zero;
+                aH[i] = zero;
+            }
+        }
+    }
+    trace_leave_block("Compute evaluation of polynomials A, B and C on set S");
+
+    if (unsatisfied < num_constraints)
+    {
+        std::string what = "constraint " + std::to_string(unsatisfied) + " not satisfied";
+#ifdef DEBUG
+        const auto it = cs.constraint_annotations.find(unsatisfied);
+        if (it != cs.constraint_annotations.end())
+        {
+            what += ": " + it->second;
+        }
+#endif
+        throw r1cs_gg_ppzksnark_zok_unsatisfied(unsatisfied, what);
+    }
+
+    ProverStats* stats = context.stats;
+
+    context.checkpoint("ifft");
+
+    trace_enter_block("Compute coefficients of polynomials A, B and C");
+    if (stats) stats->begin_phase("fft");
+    domain->iFFT(aA);
+    domain->iFFT(aB);
+    domain->iFFT(aH);
+    if (stats) stats->end_phase("fft", 0);
+    trace_leave_block("Compute coefficients of polynomials A, B and C");
+
+    context.checkpoint("coset_fft");
+
+    trace_enter_block("Compute evaluation of polynomials A, B and C on set T");
+    /* cosetFFT, with the cached powers of the generator */
+#ifdef MULTICORE
+#pragma omp parallel for schedule(static, 1) num_threads(ranges.size())
+#endif
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        const size_t begin = ranges[r].first;
+        const size_t count = ranges[r].second - begin;
+        batch_mul(aA.data() + begin, aA.data() + begin, coset->powers.data() + begin, count);
+        batch_mul(aB.data() + begin, aB.data() + begin, coset->powers.data() + begin, count);
+        batch_mul(aH.data() + begin, aH.data() + begin, coset->powers.data() + begin, count);
+    }
+    if (stats) stats->begin_phase("fft");
+    domain->FFT(aA);
+    domain->FFT(aB);
+    domain->FFT(aH);
+    if (stats) stats->end_phase("fft", 0);
+    trace_leave_block("Compute evaluation of polynomials A, B and C on set T");
+
+    trace_enter_block("Compute evaluation of polynomial H on set T");
+#ifdef MULTICORE
+#pragma omp parallel for schedule(static, 1) num_threads(ranges.size())
+#endif
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        /* The products a chunk at a time, to stay in the cache */
+        const size_t chunk = 256;
+        libff::Fr<ppT> products[chunk];
+        for (size_t begin = ranges[r].first; begin < ranges[r].second; begin += chunk)
+        {
+            const size_t count = std::min(chunk, ranges[r].second - begin);
+            batch_mul(products, aA.data() + begin, aB.data() + begin, count);
+            for (size_t i = 0; i < count; i++)
+            {
+                aH[begin + i] = products[i] - aH[begin + i];
+            }
+        }
+    }
+    domain->divide_by_Z_on_coset(aH);
+    trace_leave_block("Compute evaluation of polynomial H on set T");
+
+    if (context.lagrange_H)
+    {
+        /* The H query is in the Lagrange basis of the coset */
+        return;
+    }
+
+    context.checkpoint("ifft_H");
+
+    trace_enter_block("Compute coefficients of polynomial H");
+    if (stats) stats->begin_phase("fft");
+    domain->iFFT(aH);
+    if (stats) stats->end_phase("fft", 0);
+#ifdef MULTICORE
+#pragma omp parallel for schedule(static, 1) num_threads(ranges.size())
+#endif
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        const size_t begin = ranges[r].first;
+        batch_mul(aH.data() + begin, aH.data() + begin, coset->inverse_powers.data() + begin, ranges[r].second - begin);
+    }
+    aH.resize(m + 1, zero);
+    trace_leave_block("Compute coefficients of polynomial H");
+}
+
+template <typename ppT>
+void r1cs_gg_ppzksnark_zok_prover_witness_map(ProverContext<ppT>& context,
+                                              const std::vector<libff::Fr<ppT>>& full_variable_assignment,
+                                              std::vector<libff::Fr<ppT>>& aA,
+                                              std::vector<libff::Fr<ppT>>& aB,
+                                              std::vector<libff::Fr<ppT>>& aH,
+                                              unsigned int num_threads)
+{
+    const std::shared_ptr<libfqfft::evaluation_domain<libff::Fr<ppT>>>& domain = context.domain;
+
+    if (context.stats) context.stats->begin_phase("witness_map");
+
+    trace_enter_block("Compute the polynomial H");
+    r1cs_gg_ppzksnark_zok_qap_witness_map<ppT>(context, full_variable_assignment, aA, aB, aH,
+                                               num_threads ? num_threads : context.config.num_threads);
+
+    /* We are dividing degree 2(d-1) polynomial by degree d polynomial
+       and not adding a PGHR-style ZK-patch, so our H is degree d-2 */
+    assert(context.lagrange_H || !aH[domain->m-2].is_zero());
+    assert(context.lagrange_H || aH[domain->m-1].is_zero());
+    assert(context.lagrange_H || aH[domain->m].is_zero());
+    trace_leave_block("Compute the polynomial H");
+
+    if (context.stats)
+    {
+        context.stats->end_phase("witness_map",
+            (full_variable_assignment.size() + aA.size() + aB.size() + aH.size()) * sizeof(libff::Fr<ppT>));
+    }
+}
+
+template<typename T>
+FixedBaseTable<T> r1cs_gg_ppzksnark_zok_fixed_base_precompute(const std::vector<T> &bases,
+                                                          size_t scalar_bits,
+                                                          unsigned int c,
+                                                          unsigned int num_threads)
+{
+    trace_enter_block("Precompute fixed-base table");
+
+    FixedBaseTable<T> table;
+    table.c = c;
+    table.num_windows = (scalar_bits + c - 1) / c;
+    table.num_bases = bases.size();
+    table.points.resize(table.num_bases * table.num_windows);
+
+    libff::print_indent(); printf("* Fixed-base table: %zu bases, %zu windows, %zu bytes\n",
+        table.num_bases, table.num_windows, table.points.size() * sizeof(T));
+
+#ifdef MULTICORE
+#pragma omp parallel for num_threads(num_threads)
+#else
+    libff::UNUSED(num_threads);
+#endif
+    for (size_t i = 0; i < table.num_bases; i++)
+    {
+        T shifted = bases[i];
+        for (size_t j = 0; j < table.num_windows; j++)
+        {
+            table.points[i * table.num_windows + j] = shifted;
+            for (unsigned int k = 0; k < c; k++)
+            {
+                shifted = shifted.dbl();
+            }
+        }
+    }
+
+#ifdef USE_MIXED_ADDITION
+    libff::batch_to_special<T>(table.points);
+#endif
+
+    trace_leave_block("Precompute fixed-base table");
+
+    return table;
+}
+
+/**
+ * Bits [offset, offset+c) of a scalar, c must be less than the limb width
+ */
+template<mp_size_t n>
+static inline size_t r1cs_gg_ppzksnark_zok_scalar_window(const libff::bigint<n> &scalar, size_t offset, unsigned int c)
+{
+    const size_t limb = offset / GMP_NUMB_BITS;
+    const size_t shift = offset % GMP_NUMB_BITS;
+    if (limb >= n)
+    {
+        return 0;
+    }
+
+    mp_limb_t bits = scalar.data[limb] >> shift;
+    if (shift + c > GMP_NUMB_BITS && limb + 1 < n)
+    {
+        bits |= scalar.data[limb + 1] << (GMP_NUMB_BITS - shift);
+    }
+    return bits & ((mp_limb_t(1) << c) - 1);
+}
+
+template<typename T, typename FieldT>
+T r1cs_gg_ppzksnark_zok_fixed_base_multi_exp(const FixedBaseTable<T> &table,
+                                             typename std::vector<FieldT>::const_iterator scalars,
+                                             unsigned int num_threads)
+{
+    trace_counter("fixed-base MSM size", table.num_bases);
+    const size_t num_buckets = (size_t(1) << table.c) - 1;
+
+    /* Every window of every scalar selects one precomputed point, so each
+       thread fills its own buckets then reduces them with a running sum */
+    const auto ranges = get_cpu_ranges(0, table.num_bases, num_threads);
+    std::vector<T> partial(ranges.size(), T::zero());
+
+#ifdef MULTICORE
+#pragma omp parallel for num_threads(ranges.size())
+#endif
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        std::vector<T> buckets(num_buckets, T::zero());
+
+        for (size_t i = ranges[r].first; i < ranges[r].second; i++)
+        {
+            const libff::bigint<FieldT::num_limbs> scalar = scalars[i].as_bigint();
+            const T *points = &table.points[i * table.num_windows];
+
+            for (size_t j = 0; j < table.num_windows; j++)
+            {
+                const size_t digit = r1cs_gg_ppzksnark_zok_scalar_window(scalar, j * table.c, table.c);
+                if (digit != 0)
+                {
+#ifdef USE_MIXED_ADDITION
+                    buckets[digit - 1] = buckets[digit - 1].mixed_add(points[j]);
+#else
+                    buckets[digit - 1] = buckets[digit - 1] + points[j];
+#endif
+                }
+            }
+        }
+
+        T running = T::zero();
+        T acc = T::zero();
+        for (size_t d = num_buckets; d > 0; d--)
+        {
+            running = running + buckets[d - 1];
+            acc = acc + running;
+        }
+        partial[r] = acc;
+    }
+
+    T result = T::zero();
+    for (const auto &p : partial)
+    {
+        result = result + p;
+    }
+    return result;
+}
+
+template<typename T, typename FieldT>
+T r1cs_gg_ppzksnark_zok_sorted_multi_exp(typename std::vector<T>::const_iterator bases,
+                                         const std::vector<size_t> *indices,
+                                         typename std::vector<FieldT>::const_iterator scalars,
+                                         size_t n,
+                                         std::vector<libff::bigint<FieldT::num_limbs>> &scratch,
+                                         const Config &config,
+                                         const query_index_map *index_map,
+                                         const size_t *base_indices)
+{
+    if (n == 0)
+    {
+        return T::zero();
+    }
+
+    /* The same window as libff's BDLO12 for the size, unless it's set */
+    unsigned int c = config.multi_exp_c;
+    if (c == 0)
+    {
+        const size_t log2_n = libff::log2(n);
+        c = log2_n - log2_n / 3 + 2;
+    }
+    /* The offsets of 2^c buckets per task */
+    c = std::min(c, 20u);
+
+    const size_t scalar_bits = FieldT::size_in_bits();
+    const size_t num_windows = (scalar_bits + c - 1) / c;
+    const size_t num_buckets = size_t(1) << c;
+
+    if (scratch.size() < n)
+    {
+        scratch.resize(n);
+    }
+
+    if (index_map)
+    {
+        assert(index_map->size() == n);
+        const auto &segments = index_map->segments();
+#ifdef MULTICORE
+#pragma omp parallel for schedule(dynamic) num_threads(config.num_threads)
+#endif
+        for (size_t s = 0; s < segments.size(); s++)
+        {
+            index_map->for_each(segments[s], [&](size_t i, size_t j) {
+                scratch[i] = scalars[j].as_bigint();
+            });
+        }
+    }
+    else
+    {
+#ifdef MULTICORE
+#pragma omp parallel for num_threads(config.num_threads)
+#endif
+        for (size_t i = 0; i < n; i++)
+        {
+            scratch[i] = (indices ? scalars[(*indices)[i]] : scalars[i]).as_bigint();
+        }
+    }
+
+    /* Each task is one window of a range of the bases, so there are enough
+       of them for every thread even when there are few windows */
+    const size_t num_parts = std::max<size_t>(1, (config.num_threads + num_windows - 1) / num_windows);
+    const auto ranges = get_cpu_ranges(0, n, num_parts);
+    std::vector<T> partial(num_windows * ranges.size(), T::zero());
+
+#ifdef MULTICORE
+#pragma omp parallel for schedule(dynamic) num_threads(config.num_threads)
+#endif
+    for (size_t task = 0; task < partial.size(); task++)
+    {
+        const size_t window = task / ranges.size();
+        const auto &range = ranges[task % ranges.size()];
+
+        /* Counting sort of the base indices by their digit in this window */
+        std::vector<uint32_t> offsets(num_buckets + 1, 0);
+        for (size_t i = range.first; i < range.second; i++)
+        {
+            offsets[r1cs_gg_ppzksnark_zok_scalar_window(scratch[i], window * c, c) + 1]++;
+        }
+        for (size_t d = 1; d <= num_buckets; d++)
+        {
+            offsets[d] += offsets[d - 1];
+        }
+
+        std::vector<uint32_t> order(range.second - range.first);
+        std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+        for (size_t i = range.first; i < range.second; i++)
+        {
+            order[next[r1cs_gg_ppzksnark_zok_scalar_window(scratch[i], window * c, c)]++] = i;
+        }
+
+        /* The bases of digit zero are first, and skipped. The bases of the
+           next few additions are prefetched, as they're no longer in order */
+        const size_t prefetch_distance = 8;
+        T running = T::zero();
+        T acc = T::zero();
+        for (size_t d = num_buckets - 1; d > 0; d--)
+        {
+            T bucket = T::zero();
+            for (size_t k = offsets[d]; k < offsets[d + 1]; k++)
+            {
+                if (config.multi_exp_prefetch_locality != 4 && k + prefetch_distance < order.size())
+                {
+                    const size_t ahead = order[k + prefetch_distance];
+                    __builtin_prefetch(&bases[base_indices ? base_indices[ahead] : ahead]);
+                }
+                const T &base = bases[base_indices ? base_indices[order[k]] : order[k]];
+#ifdef USE_MIXED_ADDITION
+                bucket = bucket.mixed_add(base);
+#else
+                bucket = bucket + base;
+#endif
+            }
+            running = running + bucket;
+            acc = acc + running;
+        }
+        partial[task] = acc;
+    }
+
+    /* Horner's rule over the windows, from the most significant */
+    T result = T::zero();
+    for (size_t window = num_windows; window-- > 0; )
+    {
+        for (unsigned int k = 0; k < c; k++)
+        {
+            result = result.dbl();
+        }
+        for (size_t r = 0; r < ranges.size(); r++)
+        {
+            result = result + partial[window * ranges.size() + r];
+        }
+    }
+    return result;
+}
+
+/* With a checkpoint the multi-exps are split into chunks of this many bases,
+   so a cancelled proof stops within one chunk. Larger chunks cost less. */
+static const size_t r1cs_gg_ppzksnark_zok_cancel_chunk = 1ul << 22;
+
+/**
+ * libff::multi_exp over `n` bases and scalars, in chunks with a checkpoint
+ * between each when `checkpoint` isn't empty. With `base_indices` scalar `i`
+ * pairs with `bases[base_indices[i]]`, which only the sorted MSM can read,
+ * so it's used whatever the method.
+ */
+template<typename T, typename FieldT>
+static T r1cs_gg_ppzksnark_zok_chunked_multi_exp(typename std::vector<T>::const_iterator bases,
+                                                 typename std::vector<FieldT>::const_iterator scalars,
+                                                 size_t n,
+                                                 std::vector<libff::bigint<FieldT::num_limbs>> &scratch,
+                                                 const Config &config,
+                                                 const std::function<void()> &checkpoint,
+                                                 const size_t *base_indices = nullptr)
+{
+    trace_counter("MSM size", n);
+    const bool sorted = base_indices || config.multi_exp_method == "sorted";
+    const size_t chunk = r1cs_gg_ppzksnark_zok_cancel_chunk;
+    if (!checkpoint || n <= chunk)
+    {
+        if (sorted)
+        {
+            return r1cs_gg_ppzksnark_zok_sorted_multi_exp<T, FieldT>(bases, nullptr, scalars, n, scratch, config, nullptr, base_indices);
+        }
+        return libff::multi_exp<T, FieldT, libff::multi_exp_method_BDLO12>(
+            bases, bases + n, scalars, scalars + n, scratch, config);
+    }
+
+    T acc = T::zero();
+    for (size_t first = 0; first < n; first += chunk)
+    {
+        if (first > 0)
+        {
+            checkpoint();
+        }
+        const size_t last = std::min(n, first + chunk);
+        if (sorted)
+        {
+            /* The positions are of the whole of `bases` */
+            acc = acc + r1cs_gg_ppzksnark_zok_sorted_multi_exp<T, FieldT>(
+                base_indices ? bases : bases + first, nullptr, scalars + first, last - first, scratch, config,
+                nullptr, base_indices ? base_indices + first : nullptr);
+            continue;
+        }
+        acc = acc + libff::multi_exp<T, FieldT, libff::multi_exp_method_BDLO12>(
+            bases + first, bases + last, scalars + first, scalars + last, scratch, config);
+    }
+    return acc;
+}
+
+/**
+ * f(position of the base, its scalar) for the bases of one chunk, which is a
+ * range of the bases, or of the index map's segments when it's given.
+ */
+template<typename FieldT, typename F>
+static void r1cs_gg_ppzksnark_zok_for_each_scalar(const std::pair<unsigned int, unsigned int> &range,
+                                                  const std::vector<size_t> *indices,
+                                                  typename std::vector<FieldT>::const_iterator scalars,
+                                                  const query_index_map *index_map,
+                                                  F f)
+{
+    if (index_map)
+    {
+        const auto &segments = index_map->segments();
+        for (size_t s = range.first; s < range.second; s++)
+        {
+            index_map->for_each(segments[s], [&](size_t i, size_t j) { f(i, scalars[j]); });
+        }
+        return;
+    }
+
+    for (size_t i = range.first; i < range.second; i++)
+    {
+        f(i, indices ? scalars[(*indices)[i]] : scalars[i]);
+    }
+}
+
+/**
+ * Multi-exponentiation which classifies the scalars first, for witnesses
+ * which are mostly bits and selectors. Zero scalars are skipped, bases with
+ * a scalar of one are accumulated with additions, and only the positions and
+ * scalars of the remaining pairs are put in `msm_indices` and `msm_scalars`,
+ * the sorted bucket MSM reads their bases through the positions, whatever
+ * Config::multi_exp_method is, as libff's needs the bases copied together.
+ *
+ * The scalars are classified in `get_cpu_ranges` chunks, each with its own
+ * sum of the ones and count of the others, then the others are written at
+ * the offset of their chunk, so neither pass is serial.
+ *
+ * Base `i` is paired with `scalars[indices[i]]`, or with `scalars[i]` when
+ * `indices` is null, or through `index_map` when it's given, which is then
+ * used instead. The bucket MSM is chunked when `checkpoint` is given.
+ */
+template<typename T, typename FieldT>
+static T r1cs_gg_ppzksnark_zok_sparse_multi_exp(const std::vector<T> &bases,
+                                                const std::vector<size_t> *indices,
+                                                typename std::vector<FieldT>::const_iterator scalars,
+                                                std::vector<size_t> &msm_indices,
+                                                std::vector<FieldT> &msm_scalars,
+                                                std::vector<libff::bigint<FieldT::num_limbs>> &scratch,
+                                                const Config &config,
+                                                ProverStats::ScalarSplit *split,
+                                                const std::function<void()> &checkpoint = std::function<void()>(),
+                                                const query_index_map *index_map = nullptr)
+{
+    const FieldT zero = FieldT::zero();
+    const FieldT one = FieldT::one();
+
+    if (index_map)
+    {
+        assert(index_map->size() == bases.size());
+    }
+
+    const auto ranges = get_cpu_ranges(0, index_map ? index_map->segments().size() : bases.size(), config.num_threads);
+    if (ranges.empty())
+    {
+        if (split)
+        {
+            *split = ProverStats::ScalarSplit();
+        }
+        return T::zero();
+    }
+
+    std::vector<T> partial(ranges.size(), T::zero());
+    std::vector<size_t> num_zeros(ranges.size(), 0);
+    std::vector<size_t> num_ones(ranges.size(), 0);
+    std::vector<size_t> offsets(ranges.size() + 1, 0);
+
+#ifdef MULTICORE
+#pragma omp parallel for num_threads(ranges.size())
+#endif
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        T acc = T::zero();
+        r1cs_gg_ppzksnark_zok_for_each_scalar<FieldT>(ranges[r], indices, scalars, index_map, [&](size_t i, const FieldT &scalar) {
+            if (scalar == zero)
+            {
+                num_zeros[r]++;
+            }
+            else if (scalar == one)
+            {
+#ifdef USE_MIXED_ADDITION
+                acc = acc.mixed_add(bases[i]);
+#else
+                acc = acc + bases[i];
+#endif
+                num_ones[r]++;
+            }
+            else
+            {
+                offsets[r + 1]++;
+            }
+        });
+        partial[r] = acc;
+    }
+
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        offsets[r + 1] += offsets[r];
+    }
+
+    /* The capacity is kept between proofs */
+    msm_indices.resize(offsets.back());
+    msm_scalars.resize(offsets.back());
+
+#ifdef MULTICORE
+#pragma omp parallel for num_threads(ranges.size())
+#endif
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        size_t k = offsets[r];
+        r1cs_gg_ppzksnark_zok_for_each_scalar<FieldT>(ranges[r], indices, scalars, index_map, [&](size_t i, const FieldT &scalar) {
+            if (scalar != zero && scalar != one)
+            {
+                msm_indices[k] = i;
+                msm_scalars[k] = scalar;
+                k++;
+            }
+        });
+    }
+
+    T acc = T::zero();
+    for (const auto &p : partial)
+    {
+        acc = acc + p;
+    }
+
+    if (split)
+    {
+        split->zeros = std::accumulate(num_zeros.begin(), num_zeros.end(), size_t(0));
+        split->ones = std::accumulate(num_ones.begin(), num_ones.end(), size_t(0));
+        split->msm = msm_scalars.size();
+    }
+
+    if (msm_scalars.empty())
+    {
+        return acc;
+    }
+
+    return acc + r1cs_gg_ppzksnark_zok_chunked_multi_exp<T, FieldT>(
+        bases.begin(),
+        msm_scalars.begin(),
+        msm_scalars.size(),
+        scratch,
+        config,
+        checkpoint,
+        msm_indices.data());
+}
+
+/**
+ * The B query's multi-exp, with the sorted bucket MSM when it's selected
+ */
+template<typename T, typename FieldT>
+static T r1cs_gg_ppzksnark_zok_B_multi_exp(const sparse_vector<T> &query,
+                                           typename std::vector<FieldT>::const_iterator scalars_begin,
+                                           typename std::vector<FieldT>::const_iterator scalars_end,
+                                           std::vector<libff::bigint<FieldT::num_limbs>> &scratch,
+                                           const Config &config,
+                                           const query_index_map *index_map = nullptr)
+{
+    if (config.multi_exp_method == "sorted")
+    {
+        trace_counter("MSM size", query.values.size());
+        return r1cs_gg_ppzksnark_zok_sorted_multi_exp<T, FieldT>(
+            query.values.begin(), &query.indices, scalars_begin, query.values.size(), scratch, config, index_map);
+    }
+    return kc_multi_exp_with_mixed_addition<T, FieldT, libff::multi_exp_method_BDLO12>(
+        query, scalars_begin, scalars_end, scratch, config);
+}
+
+template <typename ppT>
+r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover_evaluate(ProverContext<ppT>& context,
+                                                               const Config& in_config,
+                                                               const std::vector<libff::Fr<ppT>>& full_variable_assignment,
+                                                               const std::vector<libff::Fr<ppT>>& aH)
+{
+    /* The multi-exps may use fewer threads than the FFTs, e.g. one per core */
+    Config prover_config = in_config;
+    if (in_config.msm_threads > 0)
+    {
+        prover_config.num_threads = std::min(in_config.msm_threads, in_config.num_threads);
+    }
+
+    const std::shared_ptr<libfqfft::evaluation_domain<libff::Fr<ppT>>>& domain = context.domain;
+    const r1cs_gg_ppzksnark_zok_proving_key_nozk<ppT>& pk = context.provingKey;
+    const r1cs_constraint_system<libff::Fr<ppT>>& cs = *context.constraint_system;
+
+#ifdef DEBUG
+    assert(full_variable_assignment.size() == cs.num_variables() + 1);
+    assert(pk.A_query.domain_size() == cs.num_variables()+1);
+    assert(pk.B_query.domain_size() == cs.num_variables()+1);
+    assert(pk.H_query.size() == context.H_size());
+    assert(pk.L_query.size() == cs.num_variables() - cs.num_inputs());
+#endif
+
+    trace_enter_block("Compute the proof");
+
+    ProverStats* stats = context.stats;
+    context.index_maps();
+
+    /* The A, H and L multi-exps are chunked with a checkpoint, when one is
+       given, but it mustn't throw out of the parallel sections below */
+    typedef std::function<void()> CheckpointT;
+    auto interruptible = [&](const char* stage) {
+        return context.cancel ? CheckpointT([&context, stage]() { context.checkpoint(stage); }) : CheckpointT();
+    };
+
+    auto compute_At = [&](const Config& config, std::vector<libff::bigint<libff::Fr<ppT>::num_limbs>>& scratch, const CheckpointT& checkpoint) {
+        return r1cs_gg_ppzksnark_zok_sparse_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+            pk.A_query.values,
+            &pk.A_query.indices,
+            full_variable_assignment.begin(),
+            context.msm_indices_A,
+            context.msm_scalars_A,
+            scratch,
+            config,
+            stats ? &stats->A_split : nullptr,
+            checkpoint,
+            &context.A_index_map);
+    };
+
+    auto compute_Bt = [&](const Config& config, std::vector<libff::bigint<libff::Fr<ppT>::num_limbs>>& scratch) {
+        return r1cs_gg_ppzksnark_zok_B_multi_exp<libff::G2<ppT>, libff::Fr<ppT>>(
+            pk.B_query,
+            full_variable_assignment.begin(),
+            full_variable_assignment.begin() + cs.num_variables() + 1,
+            scratch,
+            config,
+            &context.B_index_map);
+    };
+
+    auto compute_Ht = [&](const Config& config, std::vector<libff::bigint<libff::Fr<ppT>::num_limbs>>& scratch, const CheckpointT& checkpoint) {
+        if (!context.H_fixed.empty() && context.H_fixed.c == config.fixed_base_c)
+        {
+            return r1cs_gg_ppzksnark_zok_fixed_base_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+                context.H_fixed,
+                aH.begin(),
+                config.num_threads);
+        }
+        return r1cs_gg_ppzksnark_zok_chunked_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+            pk.H_query.begin(),
+            aH.begin(),
+            context.H_size(),
+            scratch,
+            config,
+            checkpoint);
+    };
+
+    auto compute_Lt = [&](const Config& config, std::vector<libff::bigint<libff::Fr<ppT>::num_limbs>>& scratch, const CheckpointT& checkpoint) {
+        if (!context.L_fixed.empty() && context.L_fixed.c == config.fixed_base_c)
+        {
+            return r1cs_gg_ppzksnark_zok_fixed_base_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+                context.L_fixed,
+                full_variable_assignment.begin() + cs.num_inputs() + 1,
+                config.num_threads);
+        }
+        return r1cs_gg_ppzksnark_zok_sparse_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+            pk.L_query,
+            nullptr,
+            full_variable_assignment.begin() + cs.num_inputs() + 1,
+            context.msm_indices_L,
+            context.msm_scalars_L,
+            scratch,
+            config,
+            stats ? &stats->L_split : nullptr,
+            checkpoint);
+    };
+
+    libff::G1<ppT> evaluation_At;
+    libff::G2<ppT> evaluation_Bt;
+    libff::G1<ppT> evaluation_Ht;
+    libff::G1<ppT> evaluation_Lt;
+
+    const size_t bytes_At = pk.A_query.size() * (sizeof(libff::G1<ppT>) + sizeof(libff::Fr<ppT>));
+    const size_t bytes_Bt = pk.B_query.size() * (sizeof(libff::G2<ppT>) + sizeof(libff::Fr<ppT>));
+    const size_t bytes_Ht = context.H_size() * (sizeof(libff::G1<ppT>) + sizeof(libff::Fr<ppT>));
+    const size_t bytes_Lt = pk.L_query.size() * (sizeof(libff::G1<ppT>) + sizeof(libff::Fr<ppT>));
+
+    if (context.msm_backend)
+    {
+        /* The H and L queries go to the backend, with the CPU as a fallback
+           if it fails, while the A and B queries are computed on the CPU */
+        context.checkpoint("ABHL_query");
+        context.preallocate_tasks();
+
+        trace_enter_block("Compute evaluations to H/L-query on the MSM backend", false);
+        if (stats) stats->begin_phase("ABHL_query");
+
+        auto offload_Ht = [&]() {
+            libff::G1<ppT> result;
+            if (context.msm_backend->multi_exp_H(aH.data(), context.H_size(), result))
+            {
+                return result;
+            }
+            libff::print_indent(); printf("* MSM backend failed on the H-query, using the CPU\n");
+            return compute_Ht(prover_config, context.scratch_exponents_H, CheckpointT());
+        };
+
+        auto offload_Lt = [&]() {
+            libff::G1<ppT> result;
+            if (context.msm_backend->multi_exp_L(full_variable_assignment.data() + cs.num_inputs() + 1,
+                                                 cs.num_variables() - cs.num_inputs(), result))
+            {
+                return result;
+            }
+            libff::print_indent(); printf("* MSM backend failed on the L-query, using the CPU\n");
+            return compute_Lt(prover_config, context.scratch_exponents_L, CheckpointT());
+        };
+
+#ifdef MULTICORE
+        const int saved_max_active_levels = omp_get_max_active_levels();
+        omp_set_max_active_levels(std::max(2, saved_max_active_levels));
+
+#pragma omp parallel sections num_threads(2)
+        {
+#pragma omp section
+            {
+                evaluation_Ht = offload_Ht();
+                evaluation_Lt = offload_Lt();
+            }
+#pragma omp section
+            {
+                evaluation_Bt = compute_Bt(prover_config, context.scratch_exponents_B);
+                evaluation_At = compute_At(prover_config, context.scratch_exponents, CheckpointT());
+            }
+        }
+
+        omp_set_max_active_levels(saved_max_active_levels);
+#else
+        evaluation_Ht = offload_Ht();
+        evaluation_Lt = offload_Lt();
+        evaluation_Bt = compute_Bt(prover_config, context.scratch_exponents_B);
+        evaluation_At = compute_At(prover_config, context.scratch_exponents, CheckpointT());
+#endif
+
+        if (stats) stats->end_phase("ABHL_query", bytes_At + bytes_Bt + bytes_Ht + bytes_Lt);
+        trace_leave_block("Compute evaluations to H/L-query on the MSM backend", false);
+    }
+#ifdef MULTICORE
+    else if (prover_config.parallel_multi_exp && prover_config.num_threads >= 4)
+    {
+        /* The four evaluations are independent, so instead of paying for four
+           serial tails they run as concurrent tasks sharing the thread budget.
+           The G2 B-query costs roughly three times as much per point as the
+           G1 queries, so it gets half of the threads and is started first. */
+        context.checkpoint("ABHL_query");
+        context.preallocate_tasks();
+
+        trace_enter_block("Compute evaluations to A/B/H/L-query concurrently", false);
+        if (stats) stats->begin_phase("ABHL_query");
+
+        Config config_B = prover_config;
+        config_B.num_threads = prover_config.num_threads / 2;
+
+        Config config_G1 = prover_config;
+        config_G1.num_threads = std::max(1u, (prover_config.num_threads - config_B.num_threads) / 3);
+
+        const int saved_max_active_levels = omp_get_max_active_levels();
+        omp_set_max_active_levels(std::max(2, saved_max_active_levels));
+
+#pragma omp parallel sections num_threads(4)
+        {
+#pragma omp section
+            evaluation_Bt = compute_Bt(config_B, context.scratch_exponents_B);
+#pragma omp section
+            evaluation_At = compute_At(config_G1, context.scratch_exponents, CheckpointT());
+#pragma omp section
+            evaluation_Ht = compute_Ht(config_G1, context.scratch_exponents_H, CheckpointT());
+#pragma omp section
+            evaluation_Lt = compute_Lt(config_G1, context.scratch_exponents_L, CheckpointT());
+        }
+
+        omp_set_max_active_levels(saved_max_active_levels);
+
+        if (stats) stats->end_phase("ABHL_query", bytes_At + bytes_Bt + bytes_Ht + bytes_Lt);
+        trace_leave_block("Compute evaluations to A/B/H/L-query concurrently", false);
+    }
+#endif
+    else
+    {
+        context.checkpoint("A_query");
+        trace_enter_block("Compute evaluation to A-query", false);
+        if (stats) stats->begin_phase("A_query");
+        evaluation_At = compute_At(prover_config, context.scratch_exponents, interruptible("A_query"));
+        if (stats) stats->end_phase("A_query", bytes_At);
+        trace_leave_block("Compute evaluation to A-query", false);
+
+        context.checkpoint("B_query");
+        trace_enter_block("Compute evaluation to B-query", false);
+        if (stats) stats->begin_phase("B_query");
+        evaluation_Bt = compute_Bt(prover_config, context.scratch_exponents);
+        if (stats) stats->end_phase("B_query", bytes_Bt);
+        trace_leave_block("Compute evaluation to B-query", false);
+
+        context.checkpoint("H_query");
+        trace_enter_block("Compute evaluation to H-query", false);
+        if (stats) stats->begin_phase("H_query");
+        evaluation_Ht = compute_Ht(prover_config, context.scratch_exponents, interruptible("H_query"));
+        if (stats) stats->end_phase("H_query", bytes_Ht);
+        trace_leave_block("Compute evaluation to H-query", false);
+
+        context.checkpoint("L_query");
+        trace_enter_block("Compute evaluation to L-query", false);
+        if (stats) stats->begin_phase("L_query");
+        evaluation_Lt = compute_Lt(prover_config, context.scratch_exponents, interruptible("L_query"));
+        if (stats) stats->end_phase("L_query", bytes_Lt);
+        trace_leave_block("Compute evaluation to L-query", false);
+    }
+
+    /* A = alpha + sum_i(a_i*A_i(t)) */
+    libff::G1<ppT> g1_A = pk.alpha_g1 + evaluation_At;
+
+    /* B = beta + sum_i(a_i*B_i(t)) */
+    libff::G2<ppT> g2_B = pk.beta_g2 + evaluation_Bt;
+
+    /* C = sum_i(a_i*((beta*A_i(t) + alpha*B_i(t) + C_i(t)) + H(t)*Z(t))/delta) */
+    libff::G1<ppT> g1_C = evaluation_Ht + evaluation_Lt;
+
+    trace_leave_block("Compute the proof");
+
+    return r1cs_gg_ppzksnark_zok_proof<ppT>(std::move(g1_A), std::move(g2_B), std::move(g1_C));
+}
+
+template <typename ppT>
+r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover_shard(ProverContext<ppT>& context,
+                                                            const std::vector<libff::Fr<ppT>>& assignment,
+                                                            size_t L_offset,
+                                                            const std::vector<libff::Fr<ppT>>& aH)
+{
+    const r1cs_gg_ppzksnark_zok_proving_key_nozk<ppT>& pk = context.provingKey;
+    const Config& config = context.config;
+
+    assert(pk.A_query.domain_size() == assignment.size());
+    assert(pk.B_query.domain_size() == assignment.size());
+    assert(pk.L_query.size() <= assignment.size() - std::min(L_offset, assignment.size()));
+    assert(pk.H_query.size() == aH.size());
+
+    trace_enter_block("Compute the proof shard");
+
+    context.index_maps();
+
+    /* There's no constraint system or domain to preallocate() from */
+    const size_t num_scratch = std::max(assignment.size(), aH.size());
+    if (context.scratch_exponents.size() < num_scratch)
+    {
+        context.scratch_exponents.resize(num_scratch);
+    }
+
+    const libff::G1<ppT> evaluation_At = r1cs_gg_ppzksnark_zok_sparse_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+        pk.A_query.values,
+        &pk.A_query.indices,
+        assignment.begin(),
+        context.msm_indices_A,
+        context.msm_scalars_A,
+        context.scratch_exponents,
+        config,
+        nullptr,
+        std::function<void()>(),
+        &context.A_index_map);
+
+    const libff::G2<ppT> evaluation_Bt = pk.B_query.indices.empty() ? libff::G2<ppT>::zero() :
+        r1cs_gg_ppzksnark_zok_B_multi_exp<libff::G2<ppT>, libff::Fr<ppT>>(
+            pk.B_query,
+            assignment.begin(),
+            assignment.end(),
+            context.scratch_exponents,
+            config,
+            &context.B_index_map);
+
+    const libff::G1<ppT> evaluation_Ht = pk.H_query.empty() ? libff::G1<ppT>::zero() :
+        libff::multi_exp<libff::G1<ppT>,
+                         libff::Fr<ppT>,
+                         libff::multi_exp_method_BDLO12>(
+            pk.H_query.begin(),
+            pk.H_query.end(),
+            aH.begin(),
+            aH.end(),
+            context.scratch_exponents,
+            config);
+
+    const libff::G1<ppT> evaluation_Lt = pk.L_query.empty() ? libff::G1<ppT>::zero() :
+        r1cs_gg_ppzksnark_zok_sparse_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+            pk.L_query,
+            nullptr,
+            assignment.begin() + L_offset,
+            context.msm_indices_L,
+            context.msm_scalars_L,
+            context.scratch_exponents,
+            config,
+            nullptr);
+
+    trace_leave_block("Compute the proof shard");
+
+    /* Without alpha and beta, which are added once when the shares are summed */
+    libff::G1<ppT> g1_A = evaluation_At;
+    libff::G2<ppT> g2_B = evaluation_Bt;
+    libff::G1<ppT> g1_C = evaluation_Ht + evaluation_Lt;
+
+    return r1cs_gg_ppzksnark_zok_proof<ppT>(std::move(g1_A), std::move(g2_B), std::move(g1_C));
+}
+
+template<typename ppT>
+r1cs_gg_ppzksnark_zok_linear_evaluation<ppT> r1cs_gg_ppzksnark_zok_evaluate_linear(ProverContext<ppT>& context,
+                                                                                  const std::vector<libff::Fr<ppT>>& full_variable_assignment)
+{
+    const r1cs_gg_ppzksnark_zok_proving_key_nozk<ppT>& pk = context.provingKey;
+    const r1cs_constraint_system<libff::Fr<ppT>>& cs = *context.constraint_system;
+    const Config& config = context.config;
+
+    trace_enter_block("Compute evaluations to A/B/L-query");
+
+    context.index_maps();
+
+    r1cs_gg_ppzksnark_zok_linear_evaluation<ppT> evaluation;
+
+    evaluation.At = r1cs_gg_ppzksnark_zok_sparse_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+        pk.A_query.values,
+        &pk.A_query.indices,
+        full_variable_assignment.begin(),
+        context.msm_indices_A,
+        context.msm_scalars_A,
+        context.scratch_exponents,
+        config,
+        nullptr,
+        std::function<void()>(),
+        &context.A_index_map);
+
+    evaluation.Bt = r1cs_gg_ppzksnark_zok_B_multi_exp<libff::G2<ppT>, libff::Fr<ppT>>(
+        pk.B_query,
+        full_variable_assignment.begin(),
+        full_variable_assignment.end(),
+        context.scratch_exponents,
+        config,
+        &context.B_index_map);
+
+    if (!context.L_fixed.empty() && context.L_fixed.c == config.fixed_base_c)
+    {
+        evaluation.Lt = r1cs_gg_ppzksnark_zok_fixed_base_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+            context.L_fixed,
+            full_variable_assignment.begin() + cs.num_inputs() + 1,
+            config.num_threads);
+    }
+    else
+    {
+        evaluation.Lt = r1cs_gg_ppzksnark_zok_sparse_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+            pk.L_query,
+            nullptr,
+            full_variable_assignment.begin() + cs.num_inputs() + 1,
+            context.msm_indices_L,
+            context.msm_scalars_L,
+            context.scratch_exponents,
+            config,
+            nullptr);
+    }
+
+    trace_leave_block("Compute evaluations to A/B/L-query");
+
+    return evaluation;
+}
+
+template<typename ppT>
+void r1cs_gg_ppzksnark_zok_update_linear(const ProverContext<ppT>& context,
+                                         r1cs_gg_ppzksnark_zok_linear_evaluation<ppT>& evaluation,
+                                         const std::vector<libff::Fr<ppT>>& previous,
+                                         const std::vector<libff::Fr<ppT>>& full_variable_assignment,
+                                         const std::vector<size_t>& changed)
+{
+    const r1cs_gg_ppzksnark_zok_proving_key_nozk<ppT>& pk = context.provingKey;
+    const size_t L_first = context.constraint_system->num_inputs() + 1;
+
+    trace_enter_block("Update evaluations to A/B/L-query");
+
+    const std::vector<size_t>& A_indices = pk.A_query.indices;
+    const std::vector<size_t>& B_indices = pk.B_query.indices;
+
+    for (const size_t i : changed)
+    {
+        const libff::Fr<ppT> delta = full_variable_assignment[i] - previous[i];
+        if (delta.is_zero())
+        {
+            continue;
+        }
+
+        /* The sparse queries are sorted by index */
+        const auto A_it = std::lower_bound(A_indices.begin(), A_indices.end(), i);
+        if (A_it != A_indices.end() && *A_it == i)
+        {
+            evaluation.At = evaluation.At + delta * pk.A_query.values[A_it - A_indices.begin()];
+        }
+
+        const auto B_it = std::lower_bound(B_indices.begin(), B_indices.end(), i);
+        if (B_it != B_indices.end() && *B_it == i)
+        {
+            evaluation.Bt = evaluation.Bt + delta * pk.B_query.values[B_it - B_indices.begin()];
+        }
+
+        if (i >= L_first && i - L_first < pk.L_query.size())
+        {
+            evaluation.Lt = evaluation.Lt + delta * pk.L_query[i - L_first];
+        }
+    }
+
+    trace_leave_block("Update evaluations to A/B/L-query");
+}
+
+template<typename ppT>
+r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover_linear(ProverContext<ppT>& context,
+                                                             const std::vector<libff::Fr<ppT>>& full_variable_assignment,
+                                                             const r1cs_gg_ppzksnark_zok_linear_evaluation<ppT>& evaluation)
+{
+    const r1cs_gg_ppzksnark_zok_proving_key_nozk<ppT>& pk = context.provingKey;
+    const Config& config = context.config;
+
+    r1cs_gg_ppzksnark_zok_prover_witness_map<ppT>(context, full_variable_assignment, context.aA, context.aB, context.aH);
+
+    trace_enter_block("Compute evaluation to H-query", false);
+    libff::G1<ppT> evaluation_Ht;
+    if (!context.H_fixed.empty() && context.H_fixed.c == config.fixed_base_c)
+    {
+        evaluation_Ht = r1cs_gg_ppzksnark_zok_fixed_base_multi_exp<libff::G1<ppT>, libff::Fr<ppT>>(
+            context.H_fixed,
+            context.aH.begin(),
+            config.num_threads);
+    }
+    else
+    {
+        const std::vector<libff::Fr<ppT>>& aH = context.aH;
+        trace_counter("MSM size", context.H_size());
+        evaluation_Ht = libff::multi_exp<libff::G1<ppT>,
+                                         libff::Fr<ppT>,
+                                         libff::multi_exp_method_BDLO12>(
+            pk.H_query.begin(),
+            pk.H_query.begin() + context.H_size(),
+            aH.begin(),
+            aH.begin() + context.H_size(),
+            context.scratch_exponents,
+            config);
+    }
+    trace_leave_block("Compute evaluation to H-query", false);
+
+    libff::G1<ppT> g1_A = pk.alpha_g1 + evaluation.At;
+    libff::G2<ppT> g2_B = pk.beta_g2 + evaluation.Bt;
+    libff::G1<ppT> g1_C = evaluation_Ht + evaluation.Lt;
+
+    return r1cs_gg_ppzksnark_zok_proof<ppT>(std::move(g1_A), std::move(g2_B), std::move(g1_C));
+}
+
+template <typename ppT>
+r1cs_gg_ppzksnark_zok_proof<ppT> r1cs_gg_ppzksnark_zok_prover(ProverContext<ppT>& context, const std::vector<libff::Fr<ppT>>& full_variable_assignment)
+{
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_prover");
+    trace_counter("domain size", context.domain->m);
+
+    ProverStats* stats = context.stats;
+    if (stats)
+    {
+        const r1cs_constraint_system<libff::Fr<ppT>>& cs = *context.constraint_system;
+        stats->clear();
+        stats->num_threads = context.config.num_threads;
+        stats->msm_threads = context.config.msm_threads ? std::min(context.config.msm_threads, context.config.num_threads) : context.config.num_threads;
+        stats->domain_size = context.domain->m;
+        stats->num_variables = cs.num_variables();
+        stats->num_inputs = cs.num_inputs();
+        stats->num_constraints = cs.num_constraints();
+        stats->A_nonzero = context.provingKey.A_query.size();
+        stats->B_nonzero = context.provingKey.B_query.size();
+        stats->H_size = context.provingKey.H_query.size();
+        stats->L_size = context.provingKey.L_query.size();
+        stats->begin_phase("total");
+    }
+
+    r1cs_gg_ppzksnark_zok_prover_witness_map<ppT>(context, full_variable_assignment, context.aA, context.aB, context.aH);
+
+    r1cs_gg_ppzksnark_zok_proof<ppT> proof = r1cs_gg_ppzksnark_zok_prover_evaluate<ppT>(context, context.config, full_variable_assignment, context.aH);
+
+    if (stats)
+    {
+        // The 'total' phase accounts for the bytes of all other phases
+        const size_t bytes = stats->total_bytes();
+        stats->end_phase("total", bytes);
+    }
+
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_prover");
+
+    proof.print_size();
+
+    return proof;
+}
+
+template <typename ppT>
+std::vector<r1cs_gg_ppzksnark_zok_proof<ppT>> r1cs_gg_ppzksnark_zok_prover_batch(ProverContext<ppT>& context,
+                                                                         const std::vector<std::vector<libff::Fr<ppT>>>& full_variable_assignments)
+{
+    std::vector<r1cs_gg_ppzksnark_zok_proof<ppT>> proofs;
+    proofs.reserve(full_variable_assignments.size());
+
+    if (full_variable_assignments.empty())
+    {
+        return proofs;
+    }
+
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_prover_batch");
+
+    /* Stats are per-proof, and the overlapping stages can't share them. The
+       stages run in parallel sections, so they can't be cancelled either,
+       cancellation is only checked between proofs. The caller's are put
+       back however the batch ends. */
+    struct context_guard
+    {
+        ProverContext<ppT>& context;
+        ProverStats* stats;
+        const std::atomic<bool>* cancel;
+        std::function<void(const char*)> progress;
+
+        ~context_guard()
+        {
+            context.stats = stats;
+            context.cancel = cancel;
+            context.progress = std::move(progress);
+        }
+    } saved{context, context.stats, context.cancel, std::move(context.progress)};
+    context.stats = nullptr;
+    context.cancel = nullptr;
+    context.progress = nullptr;
+
+    if (full_variable_assignments.size() > 1)
+    {
+        context.preallocate_next();
+    }
+
+    r1cs_gg_ppzksnark_zok_prover_witness_map<ppT>(context, full_variable_assignments[0], context.aA, context.aB, context.aH);
+
+    /* While both stages run at once, a quarter of the threads (at least one)
+       go to the witness map's point-wise passes and the rest to the
+       multi-exps. The witness map's FFTs use the domain's own threads. */
+    Config msm_config = context.config;
+    unsigned int witness_threads = context.config.num_threads;
+#ifdef MULTICORE
+    witness_threads = std::max(1u, context.config.num_threads / 4);
+    msm_config.num_threads = std::max(1u, context.config.num_threads - witness_threads);
+#endif
+
+    for (size_t i = 0; i < full_variable_assignments.size(); i++)
+    {
+        const bool has_next = (i + 1) < full_variable_assignments.size();
+
+        if (saved.progress)
+        {
+            saved.progress("batch_proof");
+        }
+        if (saved.cancel && saved.cancel->load(std::memory_order_relaxed))
+        {
+            throw r1cs_gg_ppzksnark_zok_cancelled("batch_proof");
+        }
+
+#ifdef MULTICORE
+        if (has_next && context.config.num_threads > 1)
+        {
+            /* libff profiling isn't thread-safe, inhibit it while both stages run */
+            const bool saved_inhibit_profiling_counters = libff::inhibit_profiling_counters;
+            libff::inhibit_profiling_counters = true;
+
+            const int saved_max_active_levels = omp_get_max_active_levels();
+            omp_set_max_active_levels(std::max(2, saved_max_active_levels));
+
+            r1cs_gg_ppzksnark_zok_proof<ppT> proof;
+
+            /* An exception can't leave a section, it's rethrown after both finish */
+            std::exception_ptr evaluate_error;
+            std::exception_ptr witness_map_error;
+
+#pragma omp parallel sections num_threads(2)
+            {
+#pragma omp section
+                {
+                    try
+                    {
+                        proof = r1cs_gg_ppzksnark_zok_prover_evaluate<ppT>(context, msm_config, full_variable_assignments[i], context.aH);
+                    }
+                    catch (...)
+                    {
+                        evaluate_error = std::current_exception();
+                    }
+                }
+#pragma omp section
+                {
+                    try
+                    {
+                        r1cs_gg_ppzksnark_zok_prover_witness_map<ppT>(context, full_variable_assignments[i + 1], context.aA_next, context.aB_next, context.aH_next, witness_threads);
+                    }
+                    catch (...)
+                    {
+                        witness_map_error = std::current_exception();
+                    }
+                }
+            }
+
+            omp_set_max_active_levels(saved_max_active_levels);
+            libff::inhibit_profiling_counters = saved_inhibit_profiling_counters;
+
+            if (evaluate_error)
+            {
+                std::rethrow_exception(evaluate_error);
+            }
+            if (witness_map_error)
+            {
+                std::rethrow_exception(witness_map_error);
+            }
+
+            proofs.emplace_back(std::move(proof));
+        }
+        else
+#endif
+        {
+            proofs.emplace_back(r1cs_gg_ppzksnark_zok_prover_evaluate<ppT>(context, context.config, full_variable_assignments[i], context.aH));
+
+            if (has_next)
+            {
+                r1cs_gg_ppzksnark_zok_prover_witness_map<ppT>(context, full_variable_assignments[i + 1], context.aA_next, context.aB_next, context.aH_next);
+            }
+        }
+
+        if (has_next)
+        {
+            context.aA.swap(context.aA_next);
+            context.aB.swap(context.aB_next);
+            context.aH.swap(context.aH_next);
+        }
+    }
+
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_prover_batch");
+
+    return proofs;
+}
+
+template <typename ppT>
+r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> r1cs_gg_ppzksnark_zok_verifier_process_vk(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk,
+                                                                                        unsigned int fixed_base_c)
+{
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_verifier_process_vk");
+
+    r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> pvk;
+    pvk.vk_alpha_g1 = vk.alpha_g1;
+    pvk.vk_beta_g2 = vk.beta_g2;
+    pvk.vk_gamma_g2_precomp = ppT::precompute_G2(vk.gamma_g2);
+    pvk.vk_delta_g2_precomp = ppT::precompute_G2(vk.delta_g2);
+    pvk.gamma_ABC_g1 = vk.gamma_ABC_g1;
+
+    /* The table is indexed by input, so only a dense vector of bases has one */
+    const auto &rest = vk.gamma_ABC_g1.rest;
+    bool dense = rest.indices.size() == rest.domain_size();
+    for (size_t i = 0; dense && i < rest.indices.size(); i++)
+    {
+        dense = rest.indices[i] == i;
+    }
+    if (fixed_base_c > 0 && dense && !rest.values.empty())
+    {
+        pvk.gamma_ABC_fixed = r1cs_gg_ppzksnark_zok_fixed_base_precompute(rest.values, libff::Fr<ppT>::size_in_bits(), fixed_base_c, 1);
+    }
+
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_verifier_process_vk");
+
+    return pvk;
+}
+
+/**
+ * gamma_ABC_g1[0] + sum(input[i] * gamma_ABC_g1[i+1]), using the processed
+ * key's fixed-base table when it has one. Missing inputs are zero.
+ */
+template <typename ppT>
+static libff::G1<ppT> r1cs_gg_ppzksnark_zok_accumulate_input(const r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> &pvk,
+                                                             const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input)
+{
+    const auto &table = pvk.gamma_ABC_fixed;
+    if (table.empty() || primary_input.size() > table.num_bases)
+    {
+        return pvk.gamma_ABC_g1.template accumulate_chunk<libff::Fr<ppT> >(primary_input.begin(), primary_input.end(), 0).first;
+    }
+
+    std::vector<libff::Fr<ppT> > scalars(primary_input.begin(), primary_input.end());
+    scalars.resize(table.num_bases, libff::Fr<ppT>::zero());
+
+    return pvk.gamma_ABC_g1.first + r1cs_gg_ppzksnark_zok_fixed_base_multi_exp<libff::G1<ppT>, libff::Fr<ppT> >(table, scalars.cbegin(), 1);
+}
+
+template <typename ppT>
+bool r1cs_gg_ppzksnark_zok_online_verifier_weak_IC(const r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> &pvk,
+                                               const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
+                                               const r1cs_gg_ppzksnark_zok_proof<ppT> &proof)
+{
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_weak_IC");
+    assert(pvk.gamma_ABC_g1.domain_size() >= primary_input.size());
+
+    trace_enter_block("Accumulate input");
+    const libff::G1<ppT> acc = r1cs_gg_ppzksnark_zok_accumulate_input<ppT>(pvk, primary_input);
+    trace_leave_block("Accumulate input");
+
+    bool result = true;
+
+    trace_enter_block("Check if the proof is well-formed");
+    if (!proof.is_well_formed())
+    {
+        if (!libff::inhibit_profiling_info)
+        {
+            libff::print_indent(); printf("At least one of the proof elements does not lie on the curve.\n");
+        }
+        result = false;
+    }
+    trace_leave_block("Check if the proof is well-formed");
+
+    trace_enter_block("Online pairing computations");
+    trace_enter_block("Check QAP divisibility");
+    const libff::G1_precomp<ppT> proof_g_A_precomp = ppT::precompute_G1(proof.g_A);
+    const libff::G2_precomp<ppT> proof_g_B_precomp = ppT::precompute_G2(proof.g_B);
+    const libff::G1_precomp<ppT> proof_g_C_precomp = ppT::precompute_G1(proof.g_C);
+    const libff::G1_precomp<ppT> acc_precomp = ppT::precompute_G1(acc);
+
+    const libff::Fqk<ppT> QAP1 = ppT::miller_loop(proof_g_A_precomp,  proof_g_B_precomp);
+    const libff::Fqk<ppT> QAP2 = ppT::double_miller_loop(
+        acc_precomp, pvk.vk_gamma_g2_precomp,
+        proof_g_C_precomp, pvk.vk_delta_g2_precomp);
+    const libff::GT<ppT> QAP = ppT::final_exponentiation(QAP1 * QAP2.unitary_inverse());
+
+    libff::GT<ppT> vk_alpha_g1_beta_g2 = ppT::reduced_pairing(pvk.vk_alpha_g1, pvk.vk_beta_g2);
+
+    if (QAP != vk_alpha_g1_beta_g2)
+    {
+        if (!libff::inhibit_profiling_info)
+        {
+            libff::print_indent(); printf("QAP divisibility check failed.\n");
+        }
+        result = false;
+    }
+    trace_leave_block("Check QAP divisibility");
+    trace_leave_block("Online pairing computations");
+
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_weak_IC");
+
+    return result;
+}
+
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_verifier_weak_IC(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk,
+                                        const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
+                                        const r1cs_gg_ppzksnark_zok_proof<ppT> &proof)
+{
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_verifier_weak_IC");
+    r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> pvk = r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(vk);
+    bool result = r1cs_gg_ppzksnark_zok_online_verifier_weak_IC<ppT>(pvk, primary_input, proof);
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_verifier_weak_IC");
+    return result;
+}
+
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_online_verifier_strong_IC(const r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> &pvk,
+                                                 const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
+                                                 const r1cs_gg_ppzksnark_zok_proof<ppT> &proof)
+{
+    bool result = true;
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_strong_IC");
+
+    if (pvk.gamma_ABC_g1.domain_size() != primary_input.size())
+    {
+        libff::print_indent(); printf("Input length differs from expected (got %zu, expected %zu).\n", primary_input.size(), pvk.gamma_ABC_g1.domain_size());
+        result = false;
+    }
+    else
+    {
+        result = r1cs_gg_ppzksnark_zok_online_verifier_weak_IC(pvk, primary_input, proof);
+    }
+
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_strong_IC");
+    return result;
+}
+
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_verifier_strong_IC(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk,
+                                          const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
+                                          const r1cs_gg_ppzksnark_zok_proof<ppT> &proof)
+{
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_verifier_strong_IC");
+    r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> pvk = r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(vk);
+    bool result = r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<ppT>(pvk, primary_input, proof);
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_verifier_strong_IC");
+    return result;
+}
+
+/**
+ * Whether a point is in the subgroup of order r, on-curve points of G1 are
+ * for BN curves, whose G1 cofactor is one, but points of G2 needn't be
+ */
+template<typename ppT>
+static bool r1cs_gg_ppzksnark_zok_G2_in_subgroup(const libff::G2<ppT> &point)
+{
+    return (libff::Fr<ppT>::field_char() * point).is_zero();
+}
+
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_online_verifier_batch(const r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> &pvk,
+                                             const std::vector<r1cs_gg_ppzksnark_zok_batch_item<ppT>> &items,
+                                             std::vector<bool> *valid)
+{
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_batch");
+
+    const size_t n = items.size();
+
+    /* Malformed items can't take part in the combined check, they're left
+       out of it and rejected on their own */
+    trace_enter_block("Check if the proofs are well-formed");
+    std::vector<char> formed(n);
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < n; i++)
+    {
+        formed[i] = items[i].first.size() == pvk.gamma_ABC_g1.domain_size() && items[i].second.is_well_formed();
+    }
+
+    /* Each B on its own, a random combination of them lets a point outside
+       the subgroup through with probability the inverse of the smallest
+       prime of G2's cofactor, which for BN254 is only 1/10069 */
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < n; i++)
+    {
+        formed[i] = formed[i] && r1cs_gg_ppzksnark_zok_G2_in_subgroup<ppT>(items[i].second.g_B);
+    }
+    trace_leave_block("Check if the proofs are well-formed");
+
+    std::vector<size_t> combined;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (formed[i])
+        {
+            combined.push_back(i);
+        }
+    }
+
+    bool combined_ok = true;
+    if (!combined.empty())
+    {
+        const size_t m = combined.size();
+
+        trace_enter_block("Combine proofs");
+        std::vector<libff::Fr<ppT>> r(m);
+        for (auto &r_i : r)
+        {
+            r_i = libff::Fr<ppT>::random_element();
+        }
+
+        std::vector<libff::Fqk<ppT>> miller_AB(m);
+        std::vector<libff::G1<ppT>> r_acc(m);
+        std::vector<libff::G1<ppT>> r_C(m);
+
+#ifdef MULTICORE
+#pragma omp parallel for
+#endif
+        for (size_t j = 0; j < m; j++)
+        {
+            const auto &primary_input = items[combined[j]].first;
+            const auto &proof = items[combined[j]].second;
+            const libff::G1<ppT> acc = r1cs_gg_ppzksnark_zok_accumulate_input<ppT>(pvk, primary_input);
+
+            miller_AB[j] = ppT::miller_loop(ppT::precompute_G1(r[j] * proof.g_A), ppT::precompute_G2(proof.g_B));
+            r_acc[j] = r[j] * acc;
+            r_C[j] = r[j] * proof.g_C;
+        }
+
+        libff::Fr<ppT> sum_r = libff::Fr<ppT>::zero();
+        libff::G1<ppT> sum_acc = libff::G1<ppT>::zero();
+        libff::G1<ppT> sum_C = libff::G1<ppT>::zero();
+        libff::Fqk<ppT> miller = libff::Fqk<ppT>::one();
+        for (size_t j = 0; j < m; j++)
+        {
+            sum_r += r[j];
+            sum_acc = sum_acc + r_acc[j];
+            sum_C = sum_C + r_C[j];
+            miller = miller * miller_AB[j];
+        }
+        trace_leave_block("Combine proofs");
+
+        trace_enter_block("Check combined QAP divisibility");
+        const libff::Fqk<ppT> miller_alpha_beta = ppT::miller_loop(ppT::precompute_G1(sum_r * pvk.vk_alpha_g1), ppT::precompute_G2(pvk.vk_beta_g2));
+        const libff::Fqk<ppT> miller_gamma_delta = ppT::double_miller_loop(
+            ppT::precompute_G1(sum_acc), pvk.vk_gamma_g2_precomp,
+            ppT::precompute_G1(sum_C), pvk.vk_delta_g2_precomp);
+        const libff::GT<ppT> QAP = ppT::final_exponentiation(miller * (miller_alpha_beta * miller_gamma_delta).unitary_inverse());
+        combined_ok = (QAP == libff::GT<ppT>::one());
+        trace_leave_block("Check combined QAP divisibility");
+    }
+
+    const bool result = combined_ok && combined.size() == n;
+
+    if (valid)
+    {
+        valid->assign(formed.begin(), formed.end());
+        if (!combined_ok)
+        {
+            trace_enter_block("Check proofs individually");
+            for (size_t i : combined)
+            {
+                (*valid)[i] = r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<ppT>(pvk, items[i].first, items[i].second);
+            }
+            trace_leave_block("Check proofs individually");
+        }
+    }
+
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_online_verifier_batch");
+
+    return result;
+}
+
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_verifier_batch(const r1cs_gg_ppzksnark_zok_verification_key<ppT> &vk,
+                                      const std::vector<r1cs_gg_ppzksnark_zok_batch_item<ppT>> &items,
+                                      std::vector<bool> *valid)
+{
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_verifier_batch");
+    r1cs_gg_ppzksnark_zok_processed_verification_key<ppT> pvk = r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(vk);
+    bool result = r1cs_gg_ppzksnark_zok_online_verifier_batch<ppT>(pvk, items, valid);
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_verifier_batch");
     return result;
 }
 
@@ -674,20 +2926,20 @@ bool r1cs_gg_ppzksnark_zok_affine_verifier_weak_IC(const r1cs_gg_ppzksnark_zok_v
                                                const r1cs_gg_ppzksnark_zok_primary_input<ppT> &primary_input,
                                                const r1cs_gg_ppzksnark_zok_proof<ppT> &proof)
 {
-    libff::enter_block("Call to r1cs_gg_ppzksnark_zok_affine_verifier_weak_IC");
+    trace_enter_block("Call to r1cs_gg_ppzksnark_zok_affine_verifier_weak_IC");
     assert(vk.gamma_ABC_g1.domain_size() >= primary_input.size());
 
     libff::affine_ate_G2_precomp<ppT> pvk_vk_gamma_g2_precomp = ppT::affine_ate_precompute_G2(vk.gamma_g2);
     libff::affine_ate_G2_precomp<ppT> pvk_vk_delta_g2_precomp = ppT::affine_ate_precompute_G2(vk.delta_g2);
 
-    libff::enter_block("Accumulate input");
+    trace_enter_block("Accumulate input");
     const accumulation_vector<libff::G1<ppT> > accumulated_IC = vk.gamma_ABC_g1.template accumulate_chunk<libff::Fr<ppT> >(primary_input.begin(), primary_input.end(), 0);
     const libff::G1<ppT> &acc = accumulated_IC.first;
-    libff::leave_block("Accumulate input");
+    trace_leave_block("Accumulate input");
 
     bool result = true;
 
-    libff::enter_block("Check if the proof is well-formed");
+    trace_enter_block("Check if the proof is well-formed");
     if (!proof.is_well_formed())
     {
         if (!libff::inhibit_profiling_info)
@@ -696,9 +2948,9 @@ bool r1cs_gg_ppzksnark_zok_affine_verifier_weak_IC(const r1cs_gg_ppzksnark_zok_v
         }
         result = false;
     }
-    libff::leave_block("Check if the proof is well-formed");
+    trace_leave_block("Check if the proof is well-formed");
 
-    libff::enter_block("Check QAP divisibility");
+    trace_enter_block("Check QAP divisibility");
     const libff::affine_ate_G1_precomp<ppT> proof_g_A_precomp = ppT::affine_ate_precompute_G1(proof.g_A);
     const libff::affine_ate_G2_precomp<ppT> proof_g_B_precomp = ppT::affine_ate_precompute_G2(proof.g_B);
     const libff::affine_ate_G1_precomp<ppT> proof_g_C_precomp = ppT::affine_ate_precompute_G1(proof.g_C);
@@ -720,9 +2972,9 @@ bool r1cs_gg_ppzksnark_zok_affine_verifier_weak_IC(const r1cs_gg_ppzksnark_zok_v
         }
         result = false;
     }
-    libff::leave_block("Check QAP divisibility");
+    trace_leave_block("Check QAP divisibility");
 
-    libff::leave_block("Call to r1cs_gg_ppzksnark_zok_affine_verifier_weak_IC");
+    trace_leave_block("Call to r1cs_gg_ppzksnark_zok_affine_verifier_weak_IC");
 
     return result;
 }
@@ -0,0 +1,153 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/** @file
+ *****************************************************************************
+
+ Implementation of the density-adaptive index map of the sparse queries.
+
+ See r1cs_gg_ppzksnark_zok_index_map.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_index_map.hpp"
+
+namespace libsnark {
+
+const size_t query_index_map::SEGMENT_SIZE;
+
+static const size_t SEGMENT_HEADER_BITS = sizeof(query_index_map::segment) * 8;
+
+
+/**
+ * The encoding of a segment with `count` bases out of `span` variables
+ */
+static query_index_map::encoding choose_encoding(size_t count, size_t span)
+{
+    if (count == span)
+    {
+        return query_index_map::encoding_dense;
+    }
+    // A bitmap is always the full segment, even when the last is shorter
+    return (count * 16) < query_index_map::SEGMENT_SIZE ? query_index_map::encoding_offsets : query_index_map::encoding_bitmap;
+}
+
+
+static size_t encoding_bits(query_index_map::encoding type, size_t count)
+{
+    switch (type)
+    {
+    case query_index_map::encoding_dense:
+        return 0;
+    case query_index_map::encoding_offsets:
+        return count * 16;
+    default:
+        return query_index_map::SEGMENT_SIZE;
+    }
+}
+
+
+/**
+ * Calls f(domain_begin, first, last) for the bases [first, last) of each
+ * segment which has any
+ */
+template<typename F>
+static void for_each_segment(const std::vector<size_t> &indices, F f)
+{
+    size_t first = 0;
+    while (first < indices.size())
+    {
+        const size_t domain_begin = indices[first] - (indices[first] % query_index_map::SEGMENT_SIZE);
+        const size_t domain_end = domain_begin + query_index_map::SEGMENT_SIZE;
+        size_t last = first;
+        while (last < indices.size() && indices[last] < domain_end)
+        {
+            last++;
+        }
+        f(domain_begin, first, last);
+        first = last;
+    }
+}
+
+
+query_index_map::query_index_map(const std::vector<size_t> &indices, size_t domain_size) :
+    m_size(indices.size()),
+    m_domain_size(domain_size)
+{
+    assert(std::is_sorted(indices.begin(), indices.end()));
+    assert(indices.empty() || indices.back() < domain_size);
+
+    for_each_segment(indices, [&](size_t domain_begin, size_t first, size_t last) {
+        const size_t count = last - first;
+        const size_t span = std::min(SEGMENT_SIZE, domain_size - domain_begin);
+
+        segment seg;
+        seg.domain_begin = domain_begin;
+        seg.value_begin = first;
+        seg.count = uint32_t(count);
+        seg.type = choose_encoding(count, span);
+        seg.data_begin = 0;
+
+        if (seg.type == encoding_offsets)
+        {
+            seg.data_begin = m_offsets.size();
+            for (size_t i = first; i < last; i++)
+            {
+                m_offsets.push_back(uint16_t(indices[i] - domain_begin));
+            }
+        }
+        else if (seg.type == encoding_bitmap)
+        {
+            seg.data_begin = m_bitmap.size();
+            m_bitmap.resize(m_bitmap.size() + (SEGMENT_SIZE / 64), 0);
+            for (size_t i = first; i < last; i++)
+            {
+                const size_t bit = indices[i] - domain_begin;
+                m_bitmap[seg.data_begin + (bit / 64)] |= uint64_t(1) << (bit % 64);
+            }
+        }
+
+        m_segments.push_back(seg);
+    });
+}
+
+
+size_t query_index_map::num_segments(encoding type) const
+{
+    return std::count_if(m_segments.begin(), m_segments.end(), [type](const segment &seg) { return seg.type == type; });
+}
+
+
+size_t query_index_map::size_in_bits() const
+{
+    return (m_segments.size() * SEGMENT_HEADER_BITS) + (m_offsets.size() * 16) + (m_bitmap.size() * 64);
+}
+
+
+size_t query_index_map::size_in_bits(const std::vector<size_t> &indices, size_t domain_size)
+{
+    size_t bits = 0;
+    for_each_segment(indices, [&](size_t domain_begin, size_t first, size_t last) {
+        const size_t count = last - first;
+        const size_t span = std::min(SEGMENT_SIZE, domain_size - domain_begin);
+        bits += SEGMENT_HEADER_BITS + encoding_bits(choose_encoding(count, span), count);
+    });
+    return bits;
+}
+
+
+std::vector<size_t> query_index_map::indices() const
+{
+    std::vector<size_t> out(m_size);
+    for_each([&out](size_t position, size_t index) { out[position] = index; });
+    return out;
+}
+
+} // libsnark
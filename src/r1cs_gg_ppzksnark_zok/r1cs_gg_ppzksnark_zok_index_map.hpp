@@ -0,0 +1,138 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of the density-adaptive index map of the sparse A and B queries.
+
+ The queries keep a base only for the variables whose coefficient isn't
+ zero, and each base is paired with its variable through an array of
+ indices, eight bytes per base. Circuits have dense runs, e.g. the bits of
+ a hash, where the indices are consecutive and say nothing, and very sparse
+ stretches where the gaps are wide. The map splits the domain into segments
+ of SEGMENT_SIZE variables and encodes each by whichever is smallest for
+ its density:
+
+   - dense, every variable of the segment has a base: no index data
+   - offsets, 16 bits per base from the start of the segment
+   - bitmap, one bit per variable of the segment
+
+ so the multi-exps which gather the scalars of the bases read a fraction of
+ the memory the indices take. Segments without any base aren't stored.
+
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef R1CS_GG_PPZKSNARK_INDEX_MAP_HPP_
+#define R1CS_GG_PPZKSNARK_INDEX_MAP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libsnark {
+
+class query_index_map
+{
+public:
+    static const size_t SEGMENT_SIZE = 1 << 12;
+
+    enum encoding : uint8_t
+    {
+        encoding_dense = 0,
+        encoding_offsets = 1,
+        encoding_bitmap = 2
+    };
+
+    struct segment
+    {
+        size_t domain_begin;    // first variable of the segment
+        size_t value_begin;     // position of its first base
+        uint32_t count;         // number of bases in the segment
+        encoding type;
+        size_t data_begin;      // into the offsets or the bitmap words
+    };
+
+    query_index_map() {}
+
+    /** `indices` must be sorted and less than `domain_size` */
+    query_index_map(const std::vector<size_t> &indices, size_t domain_size);
+
+    /** Number of bases */
+    size_t size() const { return m_size; }
+
+    size_t domain_size() const { return m_domain_size; }
+
+    const std::vector<segment> &segments() const { return m_segments; }
+
+    /** Number of segments with each encoding */
+    size_t num_segments(encoding type) const;
+
+    /** Bits of the encoded indices, with the segment headers */
+    size_t size_in_bits() const;
+
+    /** The same as size_in_bits(), without building the map */
+    static size_t size_in_bits(const std::vector<size_t> &indices, size_t domain_size);
+
+    /** The indices again, in order */
+    std::vector<size_t> indices() const;
+
+    /** f(position of the base, its variable) for each base of the segment */
+    template<typename F>
+    void for_each(const segment &seg, F f) const
+    {
+        switch (seg.type)
+        {
+        case encoding_dense:
+            for (size_t k = 0; k < seg.count; k++)
+            {
+                f(seg.value_begin + k, seg.domain_begin + k);
+            }
+            break;
+
+        case encoding_offsets:
+            for (size_t k = 0; k < seg.count; k++)
+            {
+                f(seg.value_begin + k, seg.domain_begin + m_offsets[seg.data_begin + k]);
+            }
+            break;
+
+        case encoding_bitmap:
+        {
+            size_t position = seg.value_begin;
+            for (size_t w = 0; w < SEGMENT_SIZE / 64; w++)
+            {
+                uint64_t word = m_bitmap[seg.data_begin + w];
+                while (word)
+                {
+                    f(position++, seg.domain_begin + (w * 64) + __builtin_ctzll(word));
+                    word &= word - 1;
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    /** f(position of the base, its variable) for every base, in order */
+    template<typename F>
+    void for_each(F f) const
+    {
+        for (const auto &seg : m_segments)
+        {
+            for_each(seg, f);
+        }
+    }
+
+protected:
+    size_t m_size = 0;
+    size_t m_domain_size = 0;
+    std::vector<segment> m_segments;
+    std::vector<uint16_t> m_offsets;
+    std::vector<uint64_t> m_bitmap;
+};
+
+} // libsnark
+
+#endif // R1CS_GG_PPZKSNARK_INDEX_MAP_HPP_
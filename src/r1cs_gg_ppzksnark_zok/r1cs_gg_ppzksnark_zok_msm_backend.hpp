@@ -0,0 +1,103 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of the interface for external multi-exponentiation backends of
+ the R1CS GG-ppzkSNARK prover.
+
+ A backend (e.g. CUDA or OpenCL) is registered by name, and is selected with
+ `Config::msm_backend`. The prover hands it the G1 H-query and L-query
+ multi-exponentiations, while the G2 B-query and A-query run concurrently on
+ the CPU. When the backend isn't registered, has no device, or fails, the
+ prover falls back to the CPU multi-exponentiation.
+
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef R1CS_GG_PPZKSNARK_MSM_BACKEND_HPP_
+#define R1CS_GG_PPZKSNARK_MSM_BACKEND_HPP_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <libff/algebra/curves/public_params.hpp>
+
+namespace libsnark {
+
+template<typename ppT>
+class r1cs_gg_ppzksnark_zok_msm_backend {
+public:
+    virtual ~r1cs_gg_ppzksnark_zok_msm_backend() = default;
+
+    virtual const char *name() const = 0;
+
+    /**
+     * False when there is no usable device
+     */
+    virtual bool available() = 0;
+
+    /**
+     * Called once per proving key with the fixed bases, e.g. to upload them
+     * to the device. Returning false disables the backend.
+     */
+    virtual bool prepare(const libff::G1_vector<ppT> &H_query, const libff::G1_vector<ppT> &L_query) = 0;
+
+    /**
+     * result = sum(scalars[i] * H_query[i]) for i < n, false on failure
+     */
+    virtual bool multi_exp_H(const libff::Fr<ppT> *scalars, size_t n, libff::G1<ppT> &result) = 0;
+
+    /**
+     * result = sum(scalars[i] * L_query[i]) for i < n, false on failure
+     */
+    virtual bool multi_exp_L(const libff::Fr<ppT> *scalars, size_t n, libff::G1<ppT> &result) = 0;
+};
+
+template<typename ppT>
+using r1cs_gg_ppzksnark_zok_msm_backend_factory = std::function<std::unique_ptr<r1cs_gg_ppzksnark_zok_msm_backend<ppT>>()>;
+
+template<typename ppT>
+std::map<std::string, r1cs_gg_ppzksnark_zok_msm_backend_factory<ppT>>& r1cs_gg_ppzksnark_zok_msm_backends()
+{
+    static std::map<std::string, r1cs_gg_ppzksnark_zok_msm_backend_factory<ppT>> backends;
+    return backends;
+}
+
+/**
+ * Make a backend selectable by name, usually from a static initialiser in
+ * the translation unit which implements it.
+ */
+template<typename ppT>
+bool r1cs_gg_ppzksnark_zok_register_msm_backend(const std::string &name, r1cs_gg_ppzksnark_zok_msm_backend_factory<ppT> factory)
+{
+    return r1cs_gg_ppzksnark_zok_msm_backends<ppT>().emplace(name, std::move(factory)).second;
+}
+
+/**
+ * Create the named backend, nullptr if it isn't registered or has no device
+ */
+template<typename ppT>
+std::shared_ptr<r1cs_gg_ppzksnark_zok_msm_backend<ppT>> r1cs_gg_ppzksnark_zok_create_msm_backend(const std::string &name)
+{
+    const auto &backends = r1cs_gg_ppzksnark_zok_msm_backends<ppT>();
+    const auto it = backends.find(name);
+    if (it == backends.end())
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<r1cs_gg_ppzksnark_zok_msm_backend<ppT>> backend = it->second();
+    if (!backend || !backend->available())
+    {
+        return nullptr;
+    }
+    return backend;
+}
+
+} // libsnark
+
+#endif // R1CS_GG_PPZKSNARK_MSM_BACKEND_HPP_
@@ -0,0 +1,178 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/** @file
+ *****************************************************************************
+
+ Implementation of hardware performance counters for the prover's phases.
+
+ See r1cs_gg_ppzksnark_zok_perf.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_perf.hpp"
+
+namespace libsnark {
+
+#ifdef __linux__
+
+namespace {
+
+enum PerfCounterKind {
+    PERF_INSTRUCTIONS = 0,
+    PERF_CYCLES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_NUM_KINDS
+};
+
+struct PerfCounterFds {
+    std::mutex mutex;
+    std::vector<int> fds[PERF_NUM_KINDS];
+    bool available = false;
+};
+
+PerfCounterFds &perf_counter_fds()
+{
+    static PerfCounterFds counters;
+    return counters;
+}
+
+int perf_open(uint32_t type, uint64_t config, bool inherit)
+{
+    struct perf_event_attr attr;
+    ::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = inherit;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // This thread, on any CPU
+    return ::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+uint64_t perf_cache_miss(uint64_t cache)
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+/**
+ * The calling thread's counters, which its threads made later inherit
+ */
+void perf_open_thread(PerfCounterFds &counters)
+{
+    const int fds[PERF_NUM_KINDS] = {
+        perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true),
+        perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true),
+        perf_open(PERF_TYPE_HW_CACHE, perf_cache_miss(PERF_COUNT_HW_CACHE_LL), true),
+        perf_open(PERF_TYPE_HW_CACHE, perf_cache_miss(PERF_COUNT_HW_CACHE_DTLB), true)
+    };
+
+    std::lock_guard<std::mutex> guard(counters.mutex);
+    for (size_t kind = 0; kind < PERF_NUM_KINDS; kind++)
+    {
+        if (fds[kind] >= 0)
+        {
+            counters.fds[kind].push_back(fds[kind]);
+            counters.available = true;
+        }
+    }
+}
+
+/**
+ * The sum over every thread's counter, scaled up for any time it wasn't
+ * running because the CPU had more events than counters
+ */
+uint64_t perf_read_total(const std::vector<int> &fds)
+{
+    double total = 0;
+    for (const int fd : fds)
+    {
+        uint64_t data[3];
+        if (::read(fd, data, sizeof(data)) != sizeof(data) || data[2] == 0)
+        {
+            continue;
+        }
+        total += double(data[0]) * (double(data[1]) / double(data[2]));
+    }
+    return uint64_t(total);
+}
+
+} // namespace
+
+bool perf_counters_available()
+{
+    static std::once_flag opened;
+    std::call_once(opened, [](){
+        PerfCounterFds &counters = perf_counter_fds();
+
+        /* The threads which already exist aren't inherited, so the OpenMP
+           threads open their own first. Only then the calling thread opens
+           its counters, so threads made by this region aren't counted twice. */
+#ifdef MULTICORE
+#pragma omp parallel num_threads(omp_get_max_threads())
+        {
+            if (omp_get_thread_num() != 0)
+            {
+                perf_open_thread(counters);
+            }
+        }
+#endif
+        perf_open_thread(counters);
+    });
+
+    return perf_counter_fds().available;
+}
+
+bool perf_counters_read(PerfCounterValues &values)
+{
+    if (!perf_counters_available())
+    {
+        return false;
+    }
+
+    PerfCounterFds &counters = perf_counter_fds();
+    std::lock_guard<std::mutex> guard(counters.mutex);
+    values.instructions = perf_read_total(counters.fds[PERF_INSTRUCTIONS]);
+    values.cycles = perf_read_total(counters.fds[PERF_CYCLES]);
+    values.llc_misses = perf_read_total(counters.fds[PERF_LLC_MISSES]);
+    values.dtlb_misses = perf_read_total(counters.fds[PERF_DTLB_MISSES]);
+    return true;
+}
+
+#else
+
+bool perf_counters_available()
+{
+    return false;
+}
+
+bool perf_counters_read(PerfCounterValues &values)
+{
+    return false;
+}
+
+#endif
+
+} // libsnark
@@ -0,0 +1,66 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of hardware performance counters for the prover's phases.
+
+ When `ProverStats::hardware_counters` is set, each phase records the
+ instructions, cycles, last-level cache misses and data TLB misses of the
+ process while it ran, from Linux perf_event counters in user space. They
+ are opened once, on the calling thread and every OpenMP thread, and
+ inherited by any thread created afterwards. Phases which overlap, such as
+ the concurrent multi-exps, each count the whole process.
+
+ Counters which the kernel or CPU doesn't provide read as zero, and none are
+ available where perf_event_paranoid forbids them, in which case
+ `perf_counters_available` is false.
+
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef R1CS_GG_PPZKSNARK_PERF_HPP_
+#define R1CS_GG_PPZKSNARK_PERF_HPP_
+
+#include <cstdint>
+
+namespace libsnark {
+
+struct PerfCounterValues
+{
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+    uint64_t llc_misses = 0;
+    uint64_t dtlb_misses = 0;
+
+    PerfCounterValues operator-(const PerfCounterValues &other) const
+    {
+        PerfCounterValues result;
+        result.instructions = instructions - other.instructions;
+        result.cycles = cycles - other.cycles;
+        result.llc_misses = llc_misses - other.llc_misses;
+        result.dtlb_misses = dtlb_misses - other.dtlb_misses;
+        return result;
+    }
+
+    double ipc() const
+    {
+        return cycles ? double(instructions) / cycles : 0;
+    }
+};
+
+/**
+ * Open the counters, the first time it's called, returns false if there are
+ * none. Call it before making threads to have them counted explicitly.
+ */
+bool perf_counters_available();
+
+/**
+ * The totals since the counters were opened, false if unavailable
+ */
+bool perf_counters_read(PerfCounterValues &values);
+
+} // libsnark
+
+#endif // R1CS_GG_PPZKSNARK_PERF_HPP_
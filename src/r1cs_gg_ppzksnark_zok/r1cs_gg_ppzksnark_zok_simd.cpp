@@ -0,0 +1,244 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/** @file
+ *****************************************************************************
+
+ Implementation of batched field multiplication for the prover's kernels.
+
+ See r1cs_gg_ppzksnark_zok_simd.hpp .
+
+ Each of the eight lanes of a zmm register holds one limb of a different
+ element, so the five limbs of eight elements are five registers. IFMA
+ multiplies the low 52 bits of each lane, adding either the low or high half
+ of the 104-bit product to a 64-bit accumulator, which leaves enough room
+ for the carries of a whole multiplication to be propagated at the end.
+
+ The reduction divides by 2^260 rather than 2^256, so the first operand is
+ shifted left by 4 bits as it's converted, giving the same result as
+ libff's Montgomery multiplication. That operand is then below 16p, and
+ the result below 2p, so one conditional subtraction is enough.
+
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <cstdlib>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define BATCH_MUL_IFMA
+#endif
+
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_simd.hpp"
+
+namespace libsnark {
+
+#ifdef BATCH_MUL_IFMA
+
+namespace {
+
+const uint64_t MASK52 = (uint64_t(1) << 52) - 1;
+
+const size_t LANES = 8;
+
+const size_t LIMBS = 5;
+
+/**
+ * 52 bits of the 4-limb value shifted left by `shift`, from bit `52 * k`
+ */
+inline uint64_t limb52(const uint64_t *x, size_t k, unsigned shift)
+{
+    const int start = int(52 * k) - int(shift);
+    if (start < 0)
+    {
+        return (x[0] << -start) & MASK52;
+    }
+
+    const size_t word = start / 64;
+    const unsigned offset = start % 64;
+    uint64_t result = x[word] >> offset;
+    if (offset > 12 && word + 1 < 4)
+    {
+        result |= x[word + 1] << (64 - offset);
+    }
+    return result & MASK52;
+}
+
+/**
+ * Load eight 4-limb values as five registers of 52-bit limbs
+ */
+__attribute__((target("avx512f,avx512ifma")))
+inline void load8(const uint64_t *x, unsigned shift, __m512i (&out)[LIMBS])
+{
+    alignas(64) uint64_t limbs[LIMBS][LANES];
+    for (size_t lane = 0; lane < LANES; lane++)
+    {
+        for (size_t k = 0; k < LIMBS; k++)
+        {
+            limbs[k][lane] = limb52(x + 4 * lane, k, shift);
+        }
+    }
+
+    for (size_t k = 0; k < LIMBS; k++)
+    {
+        out[k] = _mm512_load_si512(limbs[k]);
+    }
+}
+
+__attribute__((target("avx512f,avx512ifma")))
+inline void store8(const __m512i (&in)[LIMBS], uint64_t *x)
+{
+    alignas(64) uint64_t limbs[LIMBS][LANES];
+    for (size_t k = 0; k < LIMBS; k++)
+    {
+        _mm512_store_si512(limbs[k], in[k]);
+    }
+
+    for (size_t lane = 0; lane < LANES; lane++)
+    {
+        uint64_t *y = x + 4 * lane;
+        y[0] = limbs[0][lane] | (limbs[1][lane] << 52);
+        y[1] = (limbs[1][lane] >> 12) | (limbs[2][lane] << 40);
+        y[2] = (limbs[2][lane] >> 24) | (limbs[3][lane] << 28);
+        y[3] = (limbs[3][lane] >> 36) | (limbs[4][lane] << 16);
+    }
+}
+
+__attribute__((target("avx512f,avx512ifma")))
+void mul8(uint64_t *out, const uint64_t *a, const uint64_t *b,
+          const __m512i (&P)[LIMBS], const __m512i &inv)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i mask = _mm512_set1_epi64(MASK52);
+
+    __m512i A[LIMBS];
+    __m512i B[LIMBS];
+    load8(a, 4, A);
+    load8(b, 0, B);
+
+    __m512i T[LIMBS + 1];
+    for (size_t j = 0; j <= LIMBS; j++)
+    {
+        T[j] = zero;
+    }
+
+    for (size_t i = 0; i < LIMBS; i++)
+    {
+        for (size_t j = 0; j < LIMBS; j++)
+        {
+            T[j] = _mm512_madd52lo_epu64(T[j], A[i], B[j]);
+            T[j + 1] = _mm512_madd52hi_epu64(T[j + 1], A[i], B[j]);
+        }
+
+        /* The low 52 bits of T[0] become zero */
+        const __m512i m = _mm512_madd52lo_epu64(zero, T[0], inv);
+        for (size_t j = 0; j < LIMBS; j++)
+        {
+            T[j] = _mm512_madd52lo_epu64(T[j], m, P[j]);
+            T[j + 1] = _mm512_madd52hi_epu64(T[j + 1], m, P[j]);
+        }
+
+        const __m512i carry = _mm512_srli_epi64(T[0], 52);
+        for (size_t j = 0; j < LIMBS; j++)
+        {
+            T[j] = T[j + 1];
+        }
+        T[0] = _mm512_add_epi64(T[0], carry);
+        T[LIMBS] = zero;
+    }
+
+    for (size_t j = 0; j + 1 < LIMBS; j++)
+    {
+        T[j + 1] = _mm512_add_epi64(T[j + 1], _mm512_srli_epi64(T[j], 52));
+        T[j] = _mm512_and_si512(T[j], mask);
+    }
+
+    /* Subtract p where the result isn't already below it */
+    __m512i D[LIMBS];
+    __m512i borrow = zero;
+    for (size_t j = 0; j < LIMBS; j++)
+    {
+        const __m512i d = _mm512_sub_epi64(_mm512_sub_epi64(T[j], P[j]), borrow);
+        borrow = _mm512_srli_epi64(d, 63);
+        D[j] = _mm512_and_si512(d, mask);
+    }
+    const __mmask8 reduce = _mm512_cmpeq_epi64_mask(borrow, zero);
+    for (size_t j = 0; j < LIMBS; j++)
+    {
+        D[j] = _mm512_mask_blend_epi64(reduce, T[j], D[j]);
+    }
+
+    store8(D, out);
+}
+
+__attribute__((target("avx512f,avx512ifma")))
+size_t mul_all(uint64_t *out, const uint64_t *a, const uint64_t *b, size_t count,
+               const uint64_t *modulus, uint64_t inv)
+{
+    __m512i P[LIMBS];
+    for (size_t k = 0; k < LIMBS; k++)
+    {
+        P[k] = _mm512_set1_epi64(limb52(modulus, k, 0));
+    }
+    const __m512i inv52 = _mm512_set1_epi64(inv & MASK52);
+
+    for (size_t i = 0; i < count; i += LANES)
+    {
+        mul8(out + 4 * i, a + 4 * i, b + 4 * i, P, inv52);
+    }
+    return count;
+}
+
+bool select_ifma()
+{
+    if (getenv("ETHSNARKS_DISABLE_SIMD") != nullptr)
+    {
+        return false;
+    }
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512ifma");
+}
+
+bool use_ifma()
+{
+    static const bool result = select_ifma();
+    return result;
+}
+
+} // namespace
+
+const char *batch_mul_kernel()
+{
+    return use_ifma() ? "avx512ifma" : "scalar";
+}
+
+size_t batch_mul_4limbs(uint64_t *out, const uint64_t *a, const uint64_t *b, size_t n,
+                        const uint64_t *modulus, uint64_t inv)
+{
+    if (!use_ifma() || n < LANES)
+    {
+        return 0;
+    }
+
+    return mul_all(out, a, b, n - (n % LANES), modulus, inv);
+}
+
+#else // BATCH_MUL_IFMA
+
+const char *batch_mul_kernel()
+{
+    return "scalar";
+}
+
+size_t batch_mul_4limbs(uint64_t *, const uint64_t *, const uint64_t *, size_t,
+                        const uint64_t *, uint64_t)
+{
+    return 0;
+}
+
+#endif // BATCH_MUL_IFMA
+
+} // libsnark
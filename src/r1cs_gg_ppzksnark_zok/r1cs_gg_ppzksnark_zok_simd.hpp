@@ -0,0 +1,80 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of batched field multiplication for the prover's kernels.
+
+ The witness map multiplies whole domains of field elements pointwise,
+ each product independent of the others. `batch_mul` does these eight at a
+ time with AVX-512 IFMA, where the CPU has it, by converting the Montgomery
+ form of four 64-bit limbs into five 52-bit limbs per lane. Any other field
+ or CPU falls back to the scalar multiplication, as does the remainder of
+ a batch which isn't a multiple of eight.
+
+ The kernel is selected when first used, from the CPU features, unless the
+ environment variable ETHSNARKS_DISABLE_SIMD is set.
+
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef R1CS_GG_PPZKSNARK_SIMD_HPP_
+#define R1CS_GG_PPZKSNARK_SIMD_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <libff/algebra/fields/fp.hpp>
+
+namespace libsnark {
+
+/**
+ * Name of the selected kernel, either "avx512ifma" or "scalar"
+ */
+const char *batch_mul_kernel();
+
+/**
+ * Montgomery multiplication of `n` pairs of 4-limb values modulo `modulus`,
+ * where `inv` is -1/modulus mod 2^64, as libff's Fp_model keeps them.
+ * Returns how many were done, a multiple of eight, zero without the kernel.
+ */
+size_t batch_mul_4limbs(uint64_t *out, const uint64_t *a, const uint64_t *b, size_t n,
+                        const uint64_t *modulus, uint64_t inv);
+
+/**
+ * out[i] = a[i] * b[i] for `n` elements, out may be either input
+ */
+template<typename FieldT>
+void batch_mul(FieldT *out, const FieldT *a, const FieldT *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = a[i] * b[i];
+    }
+}
+
+template<mp_size_t N, const libff::bigint<N>& modulus>
+void batch_mul(libff::Fp_model<N, modulus> *out, const libff::Fp_model<N, modulus> *a,
+               const libff::Fp_model<N, modulus> *b, size_t n)
+{
+    typedef libff::Fp_model<N, modulus> FieldT;
+
+    size_t done = 0;
+    if (N == 4 && sizeof(mp_limb_t) == sizeof(uint64_t) && sizeof(FieldT) == N * sizeof(uint64_t))
+    {
+        done = batch_mul_4limbs(reinterpret_cast<uint64_t*>(out),
+                                reinterpret_cast<const uint64_t*>(a),
+                                reinterpret_cast<const uint64_t*>(b), n,
+                                reinterpret_cast<const uint64_t*>(modulus.data), FieldT::inv);
+    }
+
+    for (size_t i = done; i < n; i++)
+    {
+        out[i] = a[i] * b[i];
+    }
+}
+
+} // libsnark
+
+#endif // R1CS_GG_PPZKSNARK_SIMD_HPP_
@@ -0,0 +1,205 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/** @file
+ *****************************************************************************
+
+ Implementation of the tracer for profiling blocks.
+
+ See r1cs_gg_ppzksnark_zok_trace.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <libff/common/profiling.hpp>
+
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_trace.hpp"
+
+namespace libsnark {
+
+namespace {
+
+struct TraceEvent {
+    char phase;             // 'B' begin, 'E' end or 'C' counter
+    std::string name;
+    uint64_t timestamp;     // microseconds since the trace started
+    uint32_t thread;
+    int64_t value;
+};
+
+struct TraceState {
+    std::atomic<bool> enabled{false};
+    std::mutex mutex;
+    std::string path;
+    std::chrono::steady_clock::time_point start;
+    std::vector<TraceEvent> events;
+};
+
+TraceState &trace_state()
+{
+    static TraceState state;
+    return state;
+}
+
+/** Threads are numbered as they first record an event */
+uint32_t trace_thread_id()
+{
+    static std::atomic<uint32_t> next_id{0};
+    thread_local const uint32_t id = next_id++;
+    return id;
+}
+
+void trace_record(const char phase, const std::string &name, const int64_t value)
+{
+    TraceState &state = trace_state();
+    if (!state.enabled.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    const uint32_t thread = trace_thread_id();
+    std::lock_guard<std::mutex> guard(state.mutex);
+    if (!state.enabled)
+    {
+        return;
+    }
+    const uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - state.start).count();
+    state.events.push_back(TraceEvent{phase, name, timestamp, thread, value});
+}
+
+void trace_write_string(std::ostream &out, const std::string &str)
+{
+    out << '"';
+    for (const char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) >= 0x20)
+        {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void trace_at_exit()
+{
+    trace_stop();
+}
+
+} // namespace
+
+bool trace_start(const std::string &path)
+{
+    TraceState &state = trace_state();
+    std::lock_guard<std::mutex> guard(state.mutex);
+    if (state.enabled)
+    {
+        return false;
+    }
+
+    static std::once_flag registered;
+    std::call_once(registered, [](){ std::atexit(trace_at_exit); });
+
+    state.path = path;
+    state.events.clear();
+    state.start = std::chrono::steady_clock::now();
+    state.enabled = true;
+    return true;
+}
+
+bool trace_start_from_env()
+{
+    const char *path = ::getenv("ETHSNARKS_TRACE_EVENTS");
+    if (!path || !*path)
+    {
+        return false;
+    }
+    return trace_start(path);
+}
+
+bool trace_stop()
+{
+    TraceState &state = trace_state();
+    std::vector<TraceEvent> events;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> guard(state.mutex);
+        if (!state.enabled)
+        {
+            return true;
+        }
+        state.enabled = false;
+        events.swap(state.events);
+        path.swap(state.path);
+    }
+
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        std::cerr << "Error: cannot open " << path << " to write the trace" << std::endl;
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const TraceEvent &event = events[i];
+        out << (i ? ",\n" : "\n") << "{\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << event.timestamp << ",\"name\":";
+        trace_write_string(out, event.name);
+        if (event.phase == 'C')
+        {
+            out << ",\"args\":{\"value\":" << event.value << "}";
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+
+    if (!out.good())
+    {
+        std::cerr << "Error: cannot write the trace to " << path << std::endl;
+        return false;
+    }
+
+    std::cerr << "Wrote " << events.size() << " trace events to " << path << std::endl;
+    return true;
+}
+
+bool trace_enabled()
+{
+    return trace_state().enabled.load(std::memory_order_relaxed);
+}
+
+void trace_enter_block(const std::string &msg, const bool indent)
+{
+    trace_record('B', msg, 0);
+    libff::enter_block(msg, indent);
+}
+
+void trace_leave_block(const std::string &msg, const bool indent)
+{
+    libff::leave_block(msg, indent);
+    trace_record('E', msg, 0);
+}
+
+void trace_counter(const char *name, const int64_t value)
+{
+    trace_record('C', name, value);
+}
+
+} // libsnark
@@ -0,0 +1,61 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of a tracer for the profiling blocks of the prover, generator
+ and verifier.
+
+ `trace_enter_block` and `trace_leave_block` are `libff::enter_block` and
+ `libff::leave_block`, which print the indented timings as before, but also
+ record the block with its thread and timestamps while a trace is started.
+ With counters, such as the domain or MSM sizes, the trace is written as a
+ Trace Event Format JSON file which chrome://tracing and Perfetto open, to
+ show each thread's blocks and the gaps where it was idle.
+
+ A trace is started by `trace_start`, or with the environment variable
+ ETHSNARKS_TRACE_EVENTS set to the output file by `trace_start_from_env`, and
+ is written at `trace_stop` or when the process exits.
+
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef R1CS_GG_PPZKSNARK_TRACE_HPP_
+#define R1CS_GG_PPZKSNARK_TRACE_HPP_
+
+#include <cstdint>
+#include <string>
+
+namespace libsnark {
+
+/**
+ * Start recording events, to be written to `path`. Returns false if a trace
+ * is already started.
+ */
+bool trace_start(const std::string &path);
+
+/**
+ * Start a trace to the file named by ETHSNARKS_TRACE_EVENTS, if it's set
+ */
+bool trace_start_from_env();
+
+/**
+ * Write the trace and stop recording, returns false if it can't be written
+ */
+bool trace_stop();
+
+bool trace_enabled();
+
+void trace_enter_block(const std::string &msg, const bool indent = true);
+
+void trace_leave_block(const std::string &msg, const bool indent = true);
+
+/**
+ * The value of the counter `name` from now on, e.g. the size of a MSM
+ */
+void trace_counter(const char *name, int64_t value);
+
+} // libsnark
+
+#endif // R1CS_GG_PPZKSNARK_TRACE_HPP_
@@ -4,18 +4,130 @@
 #include <libsnark/gadgetlib1/protoboard.hpp>
 
 #include <sstream>  // stringstream
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <chrono>
+#include <cstdio>   // fprintf
+#include <cstdlib>  // strtoull, getenv
+#include <cstring>  // memcmp
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
 
 #include "utils.hpp"
+#include "gadgets/mimc.hpp"
+#include "gadgets/poseidon.hpp"
 #include "import.hpp"
 #include "export.hpp"
+#include "prover_profile.hpp"
+#include "prover_numa.hpp"
+#include "huge_pages.hpp"
+#include "pk_mmap.hpp"
+#include "pk_normalise.hpp"
+#include "prover_stream.hpp"
+#include "pk_zkey.hpp"
+#include "vk_cache.hpp"
+#include "crypto/blake2b.h"
 
 #include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_trace.hpp"
 
 namespace ethsnarks {
 
+static StartupCost g_startup_cost;
+
+
+static double seconds_since( const std::chrono::steady_clock::time_point& begin )
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+
+void stub_init_public_params( bool warm_up )
+{
+    const bool report = ::getenv("ETHSNARKS_STARTUP_REPORT") != nullptr;
+
+    static std::once_flag once;
+    std::call_once(once, [report](){
+        const auto begin = std::chrono::steady_clock::now();
+        ppT::init_public_params();
+        libsnark::trace_start_from_env();
+        g_startup_cost.curve_seconds = seconds_since(begin);
+        if( report ) {
+            ::fprintf(stderr, "Startup: curve parameters in %.3f ms\n", g_startup_cost.curve_seconds * 1000);
+        }
+    });
+
+    if( ! warm_up && ::getenv("ETHSNARKS_WARM_UP") == nullptr ) {
+        return;
+    }
+
+    // The constants are otherwise computed by the first hash which needs them
+    static std::once_flag warm_once;
+    std::call_once(warm_once, [report](){
+        const auto begin = std::chrono::steady_clock::now();
+        MiMC_e7_gadget::static_constants();
+        MiMC_e5_gadget::static_constants();
+        poseidon_params<6, 8, 57>();
+        g_startup_cost.tables_seconds = seconds_since(begin);
+        if( report ) {
+            ::fprintf(stderr, "Startup: constant tables in %.3f ms\n", g_startup_cost.tables_seconds * 1000);
+        }
+    });
+}
+
+
+StartupCost stub_startup_cost()
+{
+    return g_startup_cost;
+}
+
+
+ProcessedVerificationKeyT stub_process_vk( const char *vk_json )
+{
+    stub_init_public_params();
+
+    std::stringstream vk_stream;
+    vk_stream << vk_json;
+    auto vk = vk_from_json(vk_stream);
+
+    return libsnark::r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(vk);
+}
+
+
+bool stub_verify_processed( const ProcessedVerificationKeyT& pvk, const char *proof_json )
+{
+    std::stringstream proof_stream;
+    proof_stream << proof_json;
+    auto proof_pair = proof_from_json(proof_stream);
+
+    return libsnark::r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<ppT>(pvk, proof_pair.first, proof_pair.second);
+}
+
+
+bool stub_verify_processed_bytes( const ProcessedVerificationKeyT& pvk, const uint8_t *proof, size_t proof_size )
+{
+    InputProofPairType proof_pair;
+    if( ! proof_from_bytes(proof, proof_size, proof_pair) ) {
+        return false;
+    }
+
+    return libsnark::r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<ppT>(pvk, proof_pair.first, proof_pair.second);
+}
+
+
 bool stub_verify( const char *vk_json, const char *proof_json )
 {
-    ppT::init_public_params();
+    stub_init_public_params();
 
     std::stringstream vk_stream;
     vk_stream << vk_json;
@@ -33,17 +145,307 @@ bool stub_verify( const char *vk_json, const char *proof_json )
 }
 
 
-ethsnarks::ProvingKeyT load_proving_key( const char *pk_file )
+/**
+* Read-only stream over a region of memory, which can tell how much was consumed
+*/
+class MemoryStreamBuf : public std::streambuf
 {
+public:
+    MemoryStreamBuf( const char *begin, const char *end )
+    {
+        char *b = const_cast<char*>(begin);
+        setg(b, b, const_cast<char*>(end));
+    }
+
+    size_t consumed() const
+    {
+        return gptr() - eback();
+    }
+};
+
+
+static bool parse_size( const char *&cursor, const char *end, size_t &out )
+{
+    char *next = nullptr;
+    out = ::strtoull(cursor, &next, 10);
+    if( next == cursor || next >= end || *next != '\n' ) {
+        return false;
+    }
+    cursor = next + 1;
+    return true;
+}
+
+
+template<typename T>
+static bool parse_point( const char *&cursor, const char *end, T &out )
+{
+    MemoryStreamBuf buf(cursor, end);
+    std::istream in(&buf);
+    in >> out;
+    libff::consume_OUTPUT_NEWLINE(in);
+    if( ! in ) {
+        return false;
+    }
+    cursor += buf.consumed();
+    return true;
+}
+
+
+/**
+* Decode `count` points written with a trailing OUTPUT_NEWLINE each
+*
+* The width of the first point is measured and every other point is assumed
+* to have the same width (as is the case with BINARY_OUTPUT), which allows
+* the rest to be decoded and validated in parallel chunks. Returns false if
+* the assumption doesn't hold, or any point isn't well formed.
+*/
+template<typename T>
+static bool parse_points( const char *&cursor, const char *end, size_t count, std::vector<T> &out )
+{
+    out.resize(count);
+    if( count == 0 ) {
+        return true;
+    }
+
+    const char *first = cursor;
+    if( ! parse_point(cursor, end, out[0]) || ! out[0].is_well_formed() ) {
+        return false;
+    }
+    const size_t width = cursor - first;
+
+    if( size_t(end - first) < (count * width) ) {
+        return false;
+    }
+
+    std::atomic<bool> ok(true);
+    const auto ranges = libsnark::get_cpu_ranges(1, count);
+
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for( size_t r = 0; r < ranges.size(); r++ )
+    {
+        const char *chunk_begin = first + (ranges[r].first * width);
+        const char *chunk_end = first + (ranges[r].second * width);
+        MemoryStreamBuf buf(chunk_begin, chunk_end);
+        std::istream in(&buf);
+
+        for( size_t i = ranges[r].first; i < ranges[r].second && ok; i++ )
+        {
+            in >> out[i];
+            libff::consume_OUTPUT_NEWLINE(in);
+            if( ! in || buf.consumed() != ((i + 1 - ranges[r].first) * width) || ! out[i].is_well_formed() ) {
+                ok = false;
+            }
+        }
+    }
+
+    cursor = first + (count * width);
+    return ok;
+}
+
+
+template<typename T>
+static bool parse_sparse_vector( const char *&cursor, const char *end, libsnark::sparse_vector<T> &out )
+{
+    size_t n_indices, n_values;
+
+    if( ! parse_size(cursor, end, out.domain_size_) || ! parse_size(cursor, end, n_indices) ) {
+        return false;
+    }
+
+    out.indices.resize(n_indices);
+    for( size_t i = 0; i < n_indices; i++ ) {
+        if( ! parse_size(cursor, end, out.indices[i]) ) {
+            return false;
+        }
+    }
+
+    if( ! parse_size(cursor, end, n_values) ) {
+        return false;
+    }
+
+    return parse_points(cursor, end, n_values, out.values);
+}
+
+
+static bool parse_proving_key( const char *begin, const char *end, ethsnarks::ProvingKeyT& pk )
+{
+    const char *cursor = begin;
+    size_t n_H, n_L;
+
+    return parse_point(cursor, end, pk.alpha_g1)
+        && parse_point(cursor, end, pk.beta_g1)
+        && parse_point(cursor, end, pk.beta_g2)
+        && parse_point(cursor, end, pk.delta_g1)
+        && parse_point(cursor, end, pk.delta_g2)
+        && parse_sparse_vector(cursor, end, pk.A_query)
+        && parse_sparse_vector(cursor, end, pk.B_query)
+        && parse_size(cursor, end, n_H)
+        && parse_points(cursor, end, n_H, pk.H_query)
+        && parse_size(cursor, end, n_L)
+        && parse_points(cursor, end, n_L, pk.L_query);
+}
+
+
+/**
+* Load a .raw proving key, decoding the point vectors on all cores
+*
+* Falls back to the sequential stream parser if the points in the file
+* don't have a fixed width.
+*/
+static bool load_proving_key_parallel( const char *pk_file, ethsnarks::ProvingKeyT& pk )
+{
+    const int fd = ::open(pk_file, O_RDONLY);
+    if( fd < 0 ) {
+        return false;
+    }
+
+    struct stat st;
+    if( 0 != ::fstat(fd, &st) || st.st_size == 0 ) {
+        ::close(fd);
+        return false;
+    }
+
+    void *mapped = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if( mapped == MAP_FAILED ) {
+        return false;
+    }
+    ::madvise(mapped, st.st_size, MADV_WILLNEED);
+
+    const char *begin = static_cast<const char*>(mapped);
+    const bool ok = parse_proving_key(begin, begin + st.st_size, pk);
+
+    ::munmap(mapped, st.st_size);
+
+    return ok;
+}
+
+
+static ethsnarks::ProvingKeyT load_proving_key_file( const char *pk_file, bool huge_pages )
+{
+    ethsnarks::ProvingKeyT pk;
+
+    if( pk_is_mmap(pk_file) )
+    {
+        if( ! pk_load_mmap(pk_file, pk, huge_pages) ) {
+            std::cerr << "Error: failed to load proving key " << pk_file << std::endl;
+            exit(1);
+        }
+        return pk;
+    }
+
+    if( pk_is_zkey(pk_file) )
+    {
+        if( ! pk_load_zkey(pk_file, pk) ) {
+            std::cerr << "Error: failed to load proving key " << pk_file << std::endl;
+            exit(1);
+        }
+        return pk;
+    }
+
+    if( pk_is_compressed(pk_file) )
+    {
+        if( ! pk_compressed_load(pk_file, pk) ) {
+            std::cerr << "Error: failed to load proving key " << pk_file << std::endl;
+            exit(1);
+        }
+        return pk;
+    }
+
+    if( load_proving_key_parallel(pk_file, pk) ) {
+        return pk;
+    }
+
     return ethsnarks::loadFromFile<ethsnarks::ProvingKeyT>(pk_file);
 }
 
 
+ethsnarks::ProvingKeyT load_proving_key( const char *pk_file, bool huge_pages )
+{
+    auto pk = load_proving_key_file(pk_file, huge_pages);
+
+    // The mmap loader normalises unless the header says it's already done
+    if( ! pk_is_mmap(pk_file) ) {
+        const size_t converted = pk_normalise(pk);
+        if( converted ) {
+            std::cerr << "Normalised " << converted << " non-affine proving key points" << std::endl;
+        }
+    }
+
+    if( huge_pages ) {
+        huge_pages_proving_key(pk);
+    }
+
+    return pk;
+}
+
+
+static ProofT prove_with_context(ProverContextT& context, const std::vector<FieldT>& values)
+{
+    // Copy the primary input into the context's buffer, rather than allocating,
+    // it follows the leading one of the full variable assignment
+    context.primary_input.resize(context.constraint_system->primary_input_size);
+    for( size_t i = 0; i < context.primary_input.size(); i++ ) {
+        context.primary_input[i] = values[i + 1];
+    }
+
+    return libsnark::r1cs_gg_ppzksnark_zok_prover<ethsnarks::ppT>(context, values);
+}
+
+
 std::string prove(ProverContextT& context, ProtoboardT& pb)
 {
-    auto primary_input = pb.primary_input();
-    auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ethsnarks::ppT>(context, pb.values);
-    return ethsnarks::proof_to_json(proof, primary_input);
+    auto proof = prove_with_context(context, pb.values);
+    return ethsnarks::proof_to_json(proof, context.primary_input);
+}
+
+
+std::string prove_bytes(ProverContextT& context, ProtoboardT& pb)
+{
+    auto proof = prove_with_context(context, pb.values);
+    return ethsnarks::proof_to_bytes(proof, context.primary_input);
+}
+
+
+std::string prove_assignment(ProverContextT& context, const std::vector<FieldT>& values, bool binary)
+{
+    auto proof = prove_with_context(context, values);
+    return binary ? ethsnarks::proof_to_bytes(proof, context.primary_input)
+                  : ethsnarks::proof_to_json(proof, context.primary_input);
+}
+
+
+std::unique_ptr<ProveTask> prove_async( ProverContextT& context, const ProtoboardT& pb, bool binary, const std::function<void(const char*)>& progress )
+{
+    std::unique_ptr<ProveTask> task(new ProveTask);
+    const std::atomic<bool>* cancelled = &task->cancelled;
+
+    task->proof = std::async(std::launch::async, [&context, cancelled, binary, progress] (std::vector<FieldT> values) {
+        // The context goes back to blocking proofs however this one ends
+        struct ResetContext {
+            ProverContextT& context;
+            ~ResetContext() {
+                context.cancel = nullptr;
+                context.progress = nullptr;
+            }
+        } reset{context};
+
+        context.cancel = cancelled;
+        context.progress = progress;
+        return prove_assignment(context, values, binary);
+    }, pb.values);
+
+    return task;
+}
+
+
+bool is_binary_path( const std::string& path )
+{
+    static const std::string suffix(".bin");
+    return path.size() >= suffix.size()
+        && 0 == path.compare(path.size() - suffix.size(), suffix.size(), suffix);
 }
 
 static unsigned int roundUpToNearestPowerOf2(unsigned int v)
@@ -61,8 +463,22 @@ static unsigned int roundUpToNearestPowerOf2(unsigned int v)
 const std::shared_ptr<libfqfft::evaluation_domain<FieldT>> get_domain ( ProtoboardT& pb, const ethsnarks::ProvingKeyT& proving_key, const libsnark::Config& config )
 {
     const auto& cs = pb.constraint_system;
-    std::shared_ptr<libfqfft::evaluation_domain<FieldT>> result;
     unsigned int domain_size = roundUpToNearestPowerOf2(cs.num_constraints() + cs.num_inputs() + 1);
+
+    // Domains precompute their roots of unity when constructed, and are only
+    // read by the FFTs, so every context with the same parameters shares one
+    typedef std::tuple<std::string, unsigned int, std::vector<unsigned int>, unsigned int> DomainKeyT;
+    static std::mutex cache_mutex;
+    static std::map<DomainKeyT, std::weak_ptr<libfqfft::evaluation_domain<FieldT>>> cache;
+
+    const DomainKeyT key(config.fft, domain_size, config.radixes, config.num_threads);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    auto result = cache[key].lock();
+    if( result ) {
+        return result;
+    }
+
     if (config.fft.compare("basic_radix2") == 0)
     {
         result.reset(new libfqfft::basic_radix2_domain<FieldT>(domain_size));
@@ -71,22 +487,282 @@ const std::shared_ptr<libfqfft::evaluation_domain<FieldT>> get_domain ( Protoboa
     {
         result.reset(new libfqfft::recursive_domain<FieldT>(domain_size, config));
     }
+    cache[key] = result;
     return result;
 }
 
-int stub_genkeys_from_pb( ProtoboardT& pb, const char *pk_file, const char *vk_file )
+static const char FIXED_BASE_MAGIC[8] = {'E', 'S', 'F', 'I', 'X', 'B', 'T', '\0'};
+static const uint32_t FIXED_BASE_VERSION = 2;
+static const size_t FIXED_BASE_HASH_SIZE = 32;
+
+typedef libsnark::FixedBaseTable<libff::G1<ppT>> FixedBaseTableT;
+
+
+static bool write_fixed_base_table( FILE *fh, const FixedBaseTableT& table )
+{
+    const uint64_t header[3] = {table.c, table.num_windows, table.num_bases};
+    return fwrite(header, sizeof(header), 1, fh) == 1
+        && fwrite(table.points.data(), sizeof(table.points[0]), table.points.size(), fh) == table.points.size();
+}
+
+
+static bool read_fixed_base_table( FILE *fh, FixedBaseTableT& table, unsigned int c, size_t num_bases )
+{
+    uint64_t header[3];
+    if( fread(header, sizeof(header), 1, fh) != 1 || header[0] != c || header[2] != num_bases ) {
+        return false;
+    }
+
+    table.c = c;
+    table.num_windows = header[1];
+    table.num_bases = num_bases;
+    table.points.resize(table.num_windows * table.num_bases);
+    return fread(table.points.data(), sizeof(table.points[0]), table.points.size(), fh) == table.points.size();
+}
+
+
+/**
+* The tables are only valid for the bases they were built from, so the file
+* records a hash of the H and L queries, as they are in memory
+*/
+static void fixed_base_hash( const ProverContextT& context, uint8_t (&out)[FIXED_BASE_HASH_SIZE] )
+{
+    const auto& pk = context.provingKey;
+    const uint64_t sizes[2] = {pk.H_query.size(), pk.L_query.size()};
+
+    blake2b_ctx ctx;
+    blake2b_init(&ctx, FIXED_BASE_HASH_SIZE, nullptr, 0);
+    blake2b_update(&ctx, sizes, sizeof(sizes));
+    blake2b_update(&ctx, pk.H_query.data(), pk.H_query.size() * sizeof(pk.H_query[0]));
+    blake2b_update(&ctx, pk.L_query.data(), pk.L_query.size() * sizeof(pk.L_query[0]));
+    blake2b_final(&ctx, out);
+}
+
+
+static bool load_fixed_base_tables( const char *path, ProverContextT& context )
+{
+    FILE *fh = fopen(path, "rb");
+    if( fh == nullptr ) {
+        return false;
+    }
+
+    uint8_t expected[FIXED_BASE_HASH_SIZE], hash[FIXED_BASE_HASH_SIZE];
+    fixed_base_hash(context, expected);
+
+    char magic[sizeof(FIXED_BASE_MAGIC)];
+    uint32_t version = 0;
+    const unsigned int c = context.config.fixed_base_c;
+    const bool ok = fread(magic, sizeof(magic), 1, fh) == 1
+                 && memcmp(magic, FIXED_BASE_MAGIC, sizeof(magic)) == 0
+                 && fread(&version, sizeof(version), 1, fh) == 1
+                 && version == FIXED_BASE_VERSION
+                 && fread(hash, sizeof(hash), 1, fh) == 1
+                 && memcmp(hash, expected, sizeof(hash)) == 0
+                 && read_fixed_base_table(fh, context.H_fixed, c, context.provingKey.H_query.size())
+                 && read_fixed_base_table(fh, context.L_fixed, c, context.provingKey.L_query.size());
+    fclose(fh);
+
+    if( ! ok ) {
+        context.H_fixed = FixedBaseTableT();
+        context.L_fixed = FixedBaseTableT();
+    }
+    return ok;
+}
+
+
+static bool save_fixed_base_tables( const char *path, const ProverContextT& context )
+{
+    FILE *fh = fopen(path, "wb");
+    if( fh == nullptr ) {
+        return false;
+    }
+
+    uint8_t hash[FIXED_BASE_HASH_SIZE];
+    fixed_base_hash(context, hash);
+
+    const bool ok = fwrite(FIXED_BASE_MAGIC, sizeof(FIXED_BASE_MAGIC), 1, fh) == 1
+                 && fwrite(&FIXED_BASE_VERSION, sizeof(FIXED_BASE_VERSION), 1, fh) == 1
+                 && fwrite(hash, sizeof(hash), 1, fh) == 1
+                 && write_fixed_base_table(fh, context.H_fixed)
+                 && write_fixed_base_table(fh, context.L_fixed);
+    return (fclose(fh) == 0) && ok;
+}
+
+
+std::string fixed_base_table_path( const char *pk_file, const libsnark::Config& config )
+{
+    return std::string(pk_file) + ".fixed" + std::to_string(config.fixed_base_c);
+}
+
+
+static void init_fixed_base( ProverContextT& context, const char *fixed_base_file )
+{
+    const auto& config = context.config;
+
+    if( config.fixed_base_c == 0 ) {
+        context.precompute_fixed_base();
+        return;
+    }
+
+    std::cerr << "Fixed-base H/L tables (c=" << config.fixed_base_c << ") need "
+              << (context.fixed_base_bytes(config.fixed_base_c) >> 20) << " MiB" << std::endl;
+
+    if( fixed_base_file != nullptr && load_fixed_base_tables(fixed_base_file, context) ) {
+        return;
+    }
+
+    context.precompute_fixed_base();
+
+    if( fixed_base_file != nullptr && ! save_fixed_base_tables(fixed_base_file, context) ) {
+        std::cerr << "Warning: cannot write " << fixed_base_file << std::endl;
+    }
+}
+
+
+void init_prover_context( ProverContextT& context, ProtoboardT& pb, const libsnark::Config& config, const char *fixed_base_file )
+{
+    context.config = config;
+    smt_plan_config(context.config);
+    context.constraint_system = &pb.constraint_system;
+    context.domain = get_domain(pb, context.provingKey, context.config);
+
+    if( config.huge_pages ) {
+        huge_pages_prover_context(context);
+    }
+
+    context.preallocate();
+    context.attach_msm_backend();
+
+    if( config.huge_pages ) {
+        huge_pages_report("scratch_exponents", context.scratch_exponents.data(),
+                          context.scratch_exponents.size() * sizeof(context.scratch_exponents[0]));
+    }
+
+    init_fixed_base(context, fixed_base_file);
+
+    if( config.numa ) {
+        numa_place_prover_context(context);
+    }
+}
+
+
+static std::string stub_prove_streamed( ProtoboardT& pb, const char *pk_file, libsnark::Config config, bool binary )
+{
+    ProvingKeyT pk;
+    ProvingKeyMmapHeader header;
+    if( ! pk_load_mmap_AB(pk_file, pk, header) ) {
+        std::cerr << "Error: failed to load proving key " << pk_file << std::endl;
+        exit(1);
+    }
+
+    // The tables would need the whole of the H and L queries
+    config.fixed_base_c = 0;
+    ProverContextT context(pk);
+    init_prover_context(context, pb, config);
+
+    ProofT proof;
+    if( ! prove_streamed(context, pb.values, pk_file, header, size_t(config.stream_budget_mb) << 20, proof) ) {
+        exit(1);
+    }
+
+    return binary ? ethsnarks::proof_to_bytes(proof, context.primary_input)
+                  : ethsnarks::proof_to_json(proof, context.primary_input);
+}
+
+
+std::string stub_prove_from_pb( ProtoboardT& pb, const char *pk_file, bool binary, const char *circuit_name )
+{
+    libsnark::Config config;
+    load_prover_config(pk_file, circuit_name_from_path(circuit_name ? circuit_name : pk_file), pb, config);
+
+    if( config.stream_budget_mb && pk_is_mmap(pk_file) )
+    {
+        return stub_prove_streamed(pb, pk_file, config, binary);
+    }
+
+    auto pk = load_proving_key(pk_file, config.huge_pages);
+    ProverContextT context(pk);
+
+    init_prover_context(context, pb, config, fixed_base_table_path(pk_file, config).c_str());
+
+    return binary ? prove_bytes(context, pb) : prove(context, pb);
+}
+
+
+static int genkeys_nozk( ProtoboardT& pb, const char *pk_file, const char *vk_file,
+                         const std::string& checkpoint_dir, size_t segment_size, bool lagrange_H )
 {
     const auto& constraints = pb.constraint_system;
-    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(constraints);
-    vk2json_file(keypair.vk, vk_file);
 
-    auto pk = ProvingKeyT(keypair.pk);
-    writeToFile<ProvingKeyT>(pk_file, pk);
+    std::ofstream pk_out(pk_file, std::ios::binary);
+    if( ! pk_out.is_open() ) {
+        std::cerr << "Error: cannot open " << pk_file << std::endl;
+        return 1;
+    }
+
+    // The proving key is streamed to disk one query at a time
+    VerificationKeyT vk;
+    try {
+        vk = libsnark::r1cs_gg_ppzksnark_zok_generator_nozk<ppT>(constraints, pk_out, checkpoint_dir, segment_size, lagrange_H);
+    }
+    catch( const std::runtime_error& ex ) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    pk_out.close();
+    if( pk_out.fail() ) {
+        std::cerr << "Error: failed to write " << pk_file << std::endl;
+        return 1;
+    }
+
+    vk2json_file(vk, vk_file);
 
     return 0;
 }
 
 
+int stub_genkeys_from_pb( ProtoboardT& pb, const char *pk_file, const char *vk_file, bool lagrange_H )
+{
+    return genkeys_nozk(pb, pk_file, vk_file, "", (1ul << 18), lagrange_H);
+}
+
+
+int stub_genkeys_prepare( ProtoboardT& pb, const char *setup_dir, size_t segment_size, bool lagrange_H )
+{
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_generator_prepare<ppT>(pb.constraint_system, setup_dir, segment_size, lagrange_H) ) {
+        return 1;
+    }
+    return 0;
+}
+
+
+int stub_genkeys_worker( const char *setup_dir, size_t worker_index, size_t num_workers )
+{
+    if( num_workers == 0 || worker_index >= num_workers ) {
+        std::cerr << "Error: worker index " << worker_index << " out of " << num_workers << std::endl;
+        return 1;
+    }
+
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_generator_worker<ppT>(setup_dir, worker_index, num_workers) ) {
+        return 1;
+    }
+    return 0;
+}
+
+
+int stub_genkeys_assemble( ProtoboardT& pb, const char *setup_dir, const char *pk_file, const char *vk_file )
+{
+    // The segments must be cut the same way as when they were computed
+    size_t segment_size;
+    bool lagrange_H;
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_generator_read_params(setup_dir, segment_size, lagrange_H) ) {
+        return 1;
+    }
+
+    return genkeys_nozk(pb, pk_file, vk_file, setup_dir, segment_size, lagrange_H);
+}
+
+
 int stub_main_verify( const char *prog_name, int argc, const char **argv )
 {
     if( argc < 3 )
@@ -98,15 +774,11 @@ int stub_main_verify( const char *prog_name, int argc, const char **argv )
     auto vk_json_file = argv[1];
     auto proof_json_file = argv[2];
 
-    // Read verifying key file
-    std::stringstream vk_stream;
-    std::ifstream vk_input(vk_json_file);
-    if( ! vk_input ) {
-        std::cerr << "Error: cannot open " << vk_json_file << std::endl;
+    // Load the processed verifying key, from its cache when there is one
+    ProcessedVerificationKeyT pvk;
+    if( ! load_processed_vk(vk_json_file, pvk) ) {
         return 2;
     }
-    vk_stream << vk_input.rdbuf();
-    vk_input.close();
 
     // Read proof file
     std::stringstream proof_stream;
@@ -119,9 +791,8 @@ int stub_main_verify( const char *prog_name, int argc, const char **argv )
     proof_input.close();
 
     // Then verify if proof is correct
-    auto vk_str = vk_stream.str();
     auto proof_str = proof_stream.str();
-    if( stub_verify( vk_str.c_str(), proof_str.c_str() ) )
+    if( stub_verify_processed( pvk, proof_str.c_str() ) )
     {
         return 0;
     }
@@ -139,8 +810,7 @@ bool stub_test_proof_verify( const ProtoboardT &in_pb )
 
     auto pk = ProvingKeyT(keypair.pk);
     ProverContextT context(pk);
-    // context.provingKey = keypair.pk;
-    context.config = libsnark::Config();
+    init_prover_context(context, const_cast<ProtoboardT&>(in_pb));
 
     auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, in_pb.values);
 
@@ -1,6 +1,11 @@
 #ifndef ETHSNARKS_STUBS_HPP
 #define ETHSNARKS_STUBS_HPP
 
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+
 #include "utils.hpp"
 #include "export.hpp"
 
@@ -9,21 +14,150 @@ namespace ethsnarks {
 
 bool stub_verify( const char *vk_json, const char *proof_json );
 
+/**
+* Initialise the curve parameters once per process, safe to call from any
+* thread and every entry point should use it rather than init_public_params.
+*
+* With `warm_up`, or when ETHSNARKS_WARM_UP is set, the MiMC and Poseidon
+* constants are computed now too rather than by the first hash, so a short
+* lived process doesn't pay for them in its first request. When
+* ETHSNARKS_STARTUP_REPORT is set each step prints how long it took.
+*/
+void stub_init_public_params( bool warm_up = false );
+
+struct StartupCost {
+    double curve_seconds = 0;
+    double tables_seconds = 0;
+};
+
+/**
+* The time taken by each step of stub_init_public_params, zero for a step
+* which hasn't run
+*/
+StartupCost stub_startup_cost();
+
+/**
+* Parse a verification key and do its G2 precomputations, the result only
+* depends on the key and can be shared by any number of verifying threads
+*/
+ProcessedVerificationKeyT stub_process_vk( const char *vk_json );
+
+bool stub_verify_processed( const ProcessedVerificationKeyT& pvk, const char *proof_json );
+
+/**
+* Verify a proof in the binary encoding of proof_to_bytes
+*/
+bool stub_verify_processed_bytes( const ProcessedVerificationKeyT& pvk, const uint8_t *proof, size_t proof_size );
+
 int stub_main_verify( const char *prog_name, int argc, const char **argv );
 
 bool stub_test_proof_verify( const ProtoboardT &in_pb );
 
-int stub_genkeys_from_pb( ProtoboardT& pb, const char *pk_file, const char *vk_file );
-
-ethsnarks::ProvingKeyT load_proving_key( const char *pk_file );
+/**
+* Generate the keys for the circuit, with `lagrange_H` the H query is in the
+* Lagrange basis, see r1cs_gg_ppzksnark_zok_generator
+*/
+int stub_genkeys_from_pb( ProtoboardT& pb, const char *pk_file, const char *vk_file, bool lagrange_H = false );
+
+/**
+* Key generation across machines, see r1cs_gg_ppzksnark_zok_generator_prepare.
+* Prepare writes the query scalars and window tables to `setup_dir`, each
+* worker computes its share of the segments there, then assemble writes the
+* keys from them. Every step reads and writes the same directory.
+*/
+int stub_genkeys_prepare( ProtoboardT& pb, const char *setup_dir, size_t segment_size = (1ul << 18), bool lagrange_H = false );
+
+int stub_genkeys_worker( const char *setup_dir, size_t worker_index, size_t num_workers );
+
+int stub_genkeys_assemble( ProtoboardT& pb, const char *setup_dir, const char *pk_file, const char *vk_file );
+
+/**
+* Load a proving key in any of the supported formats. With `huge_pages` its
+* queries are advised for transparent huge pages, before they're written for
+* the mmap format and afterwards for the others, and the result is reported.
+*/
+ethsnarks::ProvingKeyT load_proving_key( const char *pk_file, bool huge_pages = false );
 std::string prove(ProverContextT& context, ProtoboardT& pb);
 
+/**
+* Like prove(), but returns the binary encoding of proof_to_bytes
+*/
+std::string prove_bytes(ProverContextT& context, ProtoboardT& pb);
+
+/**
+* Like prove(), but for a full variable assignment of the constraint system
+* the context is bound to instead of the protoboard's values, in the binary
+* encoding when `binary` is set
+*/
+std::string prove_assignment(ProverContextT& context, const std::vector<FieldT>& values, bool binary);
+
+/**
+* A proof running on its own thread, see prove_async(). Destroying the task
+* cancels the proof and waits for its thread.
+*/
+struct ProveTask
+{
+    // Declared before `proof`, so it outlives the thread which reads it
+    std::atomic<bool> cancelled;
+    // Throws libsnark::r1cs_gg_ppzksnark_zok_cancelled from get() if cancelled
+    std::future<std::string> proof;
+
+    ProveTask() : cancelled(false) {}
+    ~ProveTask() { cancel(); }
+
+    /** The proof stops at its next checkpoint, between stages of the prover */
+    void cancel() { cancelled = true; }
+};
+
+/**
+* Start proving the protoboard's current values on a new thread, the values
+* are copied so `pb` can be re-used straight away but `context` is in use
+* until the proof finishes. `progress` is called from that thread with the
+* name of each stage of the prover.
+*/
+std::unique_ptr<ProveTask> prove_async( ProverContextT& context, const ProtoboardT& pb, bool binary = false, const std::function<void(const char*)>& progress = nullptr );
+
+/**
+* Files ending in `.bin` hold the binary encoding rather than JSON
+*/
+bool is_binary_path( const std::string& path );
+
+/**
+* Domains are cached by FFT type, size, radixes and thread count, so contexts
+* of the same size share the precomputed tables of one domain
+*/
 const std::shared_ptr<libfqfft::evaluation_domain<FieldT>> get_domain ( ProtoboardT& pb, const ethsnarks::ProvingKeyT& proving_key, const libsnark::Config& config );
 
+/**
+* Bind a prover context to the protoboard's constraint system and create the
+* evaluation domain, after this the context can be re-used for any number of
+* proofs as long as the constraint system doesn't change. All per-proof
+* buffers are sized up-front so the steady state doesn't allocate them.
+*
+* When config.fixed_base_c is set the H and L query tables are built too,
+* their size is printed first. If `fixed_base_file` is given the tables are
+* read from it when it was written for the same window and H and L queries,
+* otherwise they are built and written to it.
+*/
+void init_prover_context( ProverContextT& context, ProtoboardT& pb, const libsnark::Config& config = libsnark::Config(), const char *fixed_base_file = nullptr );
+
+/**
+* Fixed-base tables are cached next to the proving key, one file per window
+* size. The file records a hash of the key's H and L queries, so a key which
+* is replaced at the same path rebuilds them.
+*/
+std::string fixed_base_table_path( const char *pk_file, const libsnark::Config& config );
+
+/**
+* The config is loaded with load_prover_config(), for `circuit_name` or
+* otherwise the name of the proving key file
+*/
+std::string stub_prove_from_pb( ProtoboardT& pb, const char *pk_file, bool binary = false, const char *circuit_name = nullptr );
+
 template<class GadgetT>
 int stub_genkeys( const char *pk_file, const char *vk_file )
 {
-    ppT::init_public_params();
+    stub_init_public_params();
 
     ProtoboardT pb;
     GadgetT mod(pb, "module");
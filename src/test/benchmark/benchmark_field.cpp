@@ -0,0 +1,149 @@
+#include "ethsnarks.hpp"
+
+#include <libff/algebra/fields/field_utils.hpp>
+#include <libff/common/profiling.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCHMARK_HAVE_RDTSC 1
+#endif
+
+// Usage: benchmark_field [iterations]
+//
+// Cycles per operation of the scalar and base fields, Fr and Fq, of both
+// curve backends: MCL_BN128 (the default CURVE) and ALT_BN128. Each operation
+// depends on the result of the previous one, so this is their latency.
+//
+// Cycles are read from the TSC, which counts at the nominal frequency even
+// when the CPU boosts or throttles, so compare them on the same machine.
+// Without a TSC only the nanoseconds are printed.
+
+using namespace libff;
+
+
+struct op_time
+{
+    double ns;
+    double cycles;
+};
+
+
+template<typename F>
+static op_time time_op( size_t n, F f )
+{
+#ifdef BENCHMARK_HAVE_RDTSC
+    const unsigned long long tsc_begin = __rdtsc();
+#endif
+    const auto begin = std::chrono::steady_clock::now();
+
+    f(n);
+
+    const auto end = std::chrono::steady_clock::now();
+#ifdef BENCHMARK_HAVE_RDTSC
+    const unsigned long long tsc_end = __rdtsc();
+    const double cycles = double(tsc_end - tsc_begin) / n;
+#else
+    const double cycles = 0;
+#endif
+
+    return {std::chrono::duration<double, std::nano>(end - begin).count() / n, cycles};
+}
+
+
+static void print_op( const char *curve, const char *field, const char *op, const op_time& t )
+{
+    std::cout << curve << " " << field << " " << op << ": " << t.ns << " ns";
+#ifdef BENCHMARK_HAVE_RDTSC
+    std::cout << ", " << t.cycles << " cycles";
+#endif
+    std::cout << std::endl;
+}
+
+
+template<typename FieldT>
+static void benchmark_field( const char *curve, const char *field, size_t n )
+{
+    FieldT a = FieldT::random_element();
+    const FieldT b = FieldT::random_element();
+
+    print_op(curve, field, "mul", time_op(n, [&]( size_t k ) {
+        for( size_t i = 0; i < k; i++ ) {
+            a = a * b;
+        }
+    }));
+
+    print_op(curve, field, "square", time_op(n, [&]( size_t k ) {
+        for( size_t i = 0; i < k; i++ ) {
+            a = a.squared();
+        }
+    }));
+
+    print_op(curve, field, "add", time_op(n, [&]( size_t k ) {
+        for( size_t i = 0; i < k; i++ ) {
+            a = a + b;
+        }
+    }));
+
+    // Inversions are ~100x a multiplication
+    const size_t n_inverse = std::max<size_t>(1, n / 100);
+    print_op(curve, field, "inverse", time_op(n_inverse, [&]( size_t k ) {
+        for( size_t i = 0; i < k; i++ ) {
+            a = (a + b).inverse();
+        }
+    }));
+
+    // Per element, with Montgomery's trick over 1024 elements at a time
+    std::vector<FieldT> batch(1024);
+    for( auto& x : batch ) {
+        x = FieldT::random_element();
+    }
+    const size_t n_batches = std::max<size_t>(1, n / (3 * batch.size()));
+    print_op(curve, field, "batch_invert", time_op(n_batches * batch.size(), [&]( size_t ) {
+        for( size_t i = 0; i < n_batches; i++ ) {
+            batch_invert(batch);
+        }
+    }));
+
+    print_op(curve, field, "as_bigint", time_op(n, [&]( size_t k ) {
+        for( size_t i = 0; i < k; i++ ) {
+            const auto limbs = a.as_bigint();
+            a += FieldT(limbs.data[0] & 1);
+        }
+    }));
+
+    // Keep the chains from being optimised away
+    if( a.is_zero() ) {
+        std::cout << curve << " " << field << ": zero" << std::endl;
+    }
+}
+
+
+template<typename curve_pp>
+static void benchmark_curve( const char *curve, size_t n )
+{
+    curve_pp::init_public_params();
+
+    benchmark_field<libff::Fr<curve_pp>>(curve, "Fr", n);
+    benchmark_field<libff::Fq<curve_pp>>(curve, "Fq", n);
+}
+
+
+int main( int argc, char **argv )
+{
+    const size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    if( n == 0 ) {
+        std::cerr << "Usage: " << argv[0] << " [iterations]" << std::endl;
+        return 1;
+    }
+
+    print_compilation_info();
+
+    benchmark_curve<mcl_bn128_pp>("MCL_BN128", n);
+    benchmark_curve<alt_bn128_pp>("ALT_BN128", n);
+
+    return 0;
+}
@@ -1,23 +1,54 @@
 #include "utils.hpp"
 #include "ethsnarks.hpp"
+#include "stubs.hpp"
+
+#include <chrono>
+#include <sys/stat.h>
 
 using ethsnarks::ppT;
 using ethsnarks::ProvingKeyT;
 using ethsnarks::loadFromFile;
+using ethsnarks::load_proving_key;
+
+
+static void print_throughput( const char *name, double seconds, size_t nbytes )
+{
+	std::cout << name << ": " << seconds << "s, "
+			  << (nbytes / seconds / (1024 * 1024)) << " MiB/s" << std::endl;
+}
 
 
 int main( int argc, char **argv )
 {
-	ppT::init_public_params();
+	ethsnarks::stub_init_public_params();
 
 	if( argc < 2 ) {
 		std::cerr << "Usage: " << argv[0] << " <proofkey.raw>\n";
 		return 1;
 	}
 
+	struct stat st;
+	if( 0 != ::stat(argv[1], &st) ) {
+		std::cerr << "Error: cannot stat " << argv[1] << "\n";
+		return 2;
+	}
+
+	auto begin = std::chrono::steady_clock::now();
 	ProvingKeyT pk = loadFromFile<ProvingKeyT>(argv[1]);
+	auto end = std::chrono::steady_clock::now();
+	print_throughput("loadFromFile", std::chrono::duration<double>(end - begin).count(), st.st_size);
+
+	begin = std::chrono::steady_clock::now();
+	ProvingKeyT pk_parallel = load_proving_key(argv[1]);
+	end = std::chrono::steady_clock::now();
+	print_throughput("load_proving_key", std::chrono::duration<double>(end - begin).count(), st.st_size);
+
+	if( pk_parallel.H_query != pk.H_query || pk_parallel.L_query != pk.L_query ) {
+		std::cerr << "Error: loaded keys differ\n";
+		return 3;
+	}
 
     std::cout << "OK\n";
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -2,24 +2,53 @@
 
 //#include "common/default_types/r1cs_ppzksnark_pp.hpp"
 #include <libff/common/profiling.hpp>
+#include <libsnark/relations/constraint_satisfaction_problems/r1cs/examples/r1cs_examples.hpp>
+
+#include <chrono>
+#include <cstdlib>
 
 // CXXFLAGS="-fPIC -DBINARY_OUTPUT -DNO_PT_COMPRESSION=1" make lib CURVE=ALT_BN128 MULTICORE=1 NO_PROCPS=1 NO_GTEST=1 NO_DOCS=1 STATIC=1 NO_SUPERCOP=1 FEATUREFLAGS=-DMONTGOMERY_OUTPUT
 // g++ -std=c++11 -O3 test.cpp -o test -Isrc/ -DMULTICORE -fopenmp -DBINARY_OUTPUT -DCURVE_ALT_BN128 -DSTATIC -L. -lsnark -lgmp -lsodium
 
-using namespace ethsnarks;
+// Usage: benchmark_pairing [max_pairs] [max_batch]
+//
+// For both MCL_BN128 and ALT_BN128: single pairings, G2 precomputation,
+// Miller loops over 3 to max_pairs pairs and the final exponentiation, then
+// verification with and without a processed key and batch verification of
+// 1 to max_batch proofs, with the batch size recommended for throughput.
 
-typedef ppT curve_pp;
-typedef ppT::G1_type curve_G1;
-typedef ppT::G2_type curve_G2;
-typedef ppT::GT_type curve_GT;
-typedef ppT::Fp_type curve_Fr;
+using namespace libsnark;
+
+
+// A larger batch is only recommended if it's this much faster per proof
+static const double BATCH_RECOMMEND_GAIN = 0.05;
+
+
+template<typename F>
+static double seconds_per_call( size_t n, F f )
+{
+    const auto begin = std::chrono::steady_clock::now();
+    for( size_t i = 0; i < n; i++ ) {
+        f();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin).count() / n;
+}
+
+
+static void print_time( const char *curve, const std::string& name, double seconds )
+{
+    std::cout << curve << " " << name << ": " << (seconds * 1000000) << " us" << std::endl;
+}
 
-int main() {
-    curve_pp::init_public_params();
-    #ifdef DEBUG
-    libff::inhibit_profiling_info = true;
-    libff::inhibit_profiling_counters = true;
-    #endif
+
+template<typename curve_pp>
+static bool test_pairing_bilinear()
+{
+    typedef libff::G1<curve_pp> curve_G1;
+    typedef libff::G2<curve_pp> curve_G2;
+    typedef libff::GT<curve_pp> curve_GT;
+    typedef libff::Fr<curve_pp> curve_Fr;
 
     curve_G1 a = curve_G1::one();
     curve_G2 b = curve_G2::one();
@@ -46,5 +75,126 @@ int main() {
         b = c * b;
     }
 
-    assert(acc1 == acc2);
+    return acc1 == acc2;
+}
+
+
+template<typename curve_pp>
+static void benchmark_miller_loops( const char *curve, size_t max_pairs )
+{
+    const size_t n_calls = 100;
+
+    std::vector<libff::G1_precomp<curve_pp>> P;
+    std::vector<libff::G2_precomp<curve_pp>> Q;
+    for( size_t i = 0; i < max_pairs; i++ ) {
+        P.push_back(curve_pp::precompute_G1(libff::G1<curve_pp>::random_element()));
+        Q.push_back(curve_pp::precompute_G2(libff::G2<curve_pp>::random_element()));
+    }
+
+    const auto a = libff::G1<curve_pp>::random_element();
+    const auto b = libff::G2<curve_pp>::random_element();
+    print_time(curve, "reduced_pairing", seconds_per_call(n_calls, [&](){ curve_pp::reduced_pairing(a, b); }));
+    print_time(curve, "precompute_G1", seconds_per_call(n_calls, [&](){ curve_pp::precompute_G1(a); }));
+    print_time(curve, "precompute_G2", seconds_per_call(n_calls, [&](){ curve_pp::precompute_G2(b); }));
+
+    libff::Fqk<curve_pp> miller = libff::Fqk<curve_pp>::one();
+    for( size_t k = 3; k <= max_pairs; k++ )
+    {
+        // Pairs are taken two at a time, as the verifiers do
+        const double seconds = seconds_per_call(n_calls, [&](){
+            miller = libff::Fqk<curve_pp>::one();
+            size_t i = 0;
+            for( ; i + 1 < k; i += 2 ) {
+                miller = miller * curve_pp::double_miller_loop(P[i], Q[i], P[i + 1], Q[i + 1]);
+            }
+            if( i < k ) {
+                miller = miller * curve_pp::miller_loop(P[i], Q[i]);
+            }
+        });
+        print_time(curve, "miller_loop[" + std::to_string(k) + "]", seconds);
+    }
+
+    print_time(curve, "final_exponentiation", seconds_per_call(n_calls, [&](){ curve_pp::final_exponentiation(miller); }));
+}
+
+
+template<typename curve_pp>
+static bool benchmark_verifiers( const char *curve, size_t max_batch )
+{
+    const size_t n_calls = 20;
+
+    const auto example = generate_r1cs_example_with_field_input<libff::Fr<curve_pp>>(100, 10);
+    const auto keypair = r1cs_gg_ppzksnark_zok_generator<curve_pp>(example.constraint_system);
+    const auto proof = r1cs_gg_ppzksnark_zok_prover<curve_pp>(keypair.pk, example.primary_input, example.auxiliary_input);
+    const auto pvk = r1cs_gg_ppzksnark_zok_verifier_process_vk<curve_pp>(keypair.vk);
+
+    if( ! r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<curve_pp>(pvk, example.primary_input, proof) ) {
+        std::cerr << curve << ": proof doesn't verify" << std::endl;
+        return false;
+    }
+
+    print_time(curve, "process_vk", seconds_per_call(n_calls, [&](){
+        r1cs_gg_ppzksnark_zok_verifier_process_vk<curve_pp>(keypair.vk);
+    }));
+    print_time(curve, "verify (uncached vk)", seconds_per_call(n_calls, [&](){
+        r1cs_gg_ppzksnark_zok_verifier_strong_IC<curve_pp>(keypair.vk, example.primary_input, proof);
+    }));
+    print_time(curve, "verify (processed vk)", seconds_per_call(n_calls, [&](){
+        r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<curve_pp>(pvk, example.primary_input, proof);
+    }));
+
+    size_t best_size = 1;
+    double best_per_proof = 0;
+    for( size_t batch_size = 1; batch_size <= max_batch; batch_size *= 2 )
+    {
+        const std::vector<r1cs_gg_ppzksnark_zok_batch_item<curve_pp>> batch(batch_size, {example.primary_input, proof});
+        const double per_proof = seconds_per_call(n_calls, [&](){
+            r1cs_gg_ppzksnark_zok_online_verifier_batch<curve_pp>(pvk, batch);
+        }) / batch_size;
+        print_time(curve, "verify_batch[" + std::to_string(batch_size) + "] per proof", per_proof);
+
+        if( batch_size == 1 || per_proof < best_per_proof * (1 - BATCH_RECOMMEND_GAIN) ) {
+            best_size = batch_size;
+            best_per_proof = per_proof;
+        }
+    }
+
+    std::cout << curve << " recommended batch size: " << best_size << std::endl;
+    return true;
+}
+
+
+template<typename curve_pp>
+static bool benchmark_curve( const char *curve, size_t max_pairs, size_t max_batch )
+{
+    curve_pp::init_public_params();
+
+    if( ! test_pairing_bilinear<curve_pp>() ) {
+        std::cerr << curve << ": pairing isn't bilinear" << std::endl;
+        return false;
+    }
+
+    benchmark_miller_loops<curve_pp>(curve, max_pairs);
+    return benchmark_verifiers<curve_pp>(curve, max_batch);
+}
+
+
+int main( int argc, char **argv ) {
+    // The generator, prover and verifiers print their profiling blocks
+    libff::inhibit_profiling_info = true;
+    libff::inhibit_profiling_counters = true;
+
+    const size_t max_pairs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    const size_t max_batch = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+    if( max_pairs < 3 || max_batch < 1 ) {
+        std::cerr << "Usage: " << argv[0] << " [max_pairs >= 3] [max_batch >= 1]" << std::endl;
+        return 1;
+    }
+
+    if( ! benchmark_curve<libff::mcl_bn128_pp>("MCL_BN128", max_pairs, max_batch)
+     || ! benchmark_curve<libff::alt_bn128_pp>("ALT_BN128", max_pairs, max_batch) ) {
+        return 2;
+    }
+
+    return 0;
 }
@@ -0,0 +1,265 @@
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+/**
+* Proves reference circuits with every thread count from 1 to the maximum,
+* with and without `smt`, and reports the time of each prover phase with
+* its speedup and efficiency over 1 thread, as JSON:
+*
+*   benchmark_prover_scaling [num_constraints] [repeats] > scaling.json
+*
+* The circuits are the synthetic R1CS of profile_r1cs_gg_ppzksnark_zok with
+* `num_constraints` (default 2^16), a MiMC merkle path of depth 29, and an
+* EdDSA_batch of 4 signatures. Each configuration takes the best of `repeats`
+* proofs (default 3), phase by phase.
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+#include <libff/common/profiling.hpp>
+#include <libsnark/relations/constraint_satisfaction_problems/r1cs/examples/r1cs_examples.hpp>
+
+#include "ethsnarks.hpp"
+#include "utils.hpp"
+#include "stubs.hpp"
+
+#include "gadgets/merkle_tree.hpp"
+#include "gadgets/mimc.hpp"
+#include "jubjub/eddsa.hpp"
+
+using json = nlohmann::json;
+
+
+namespace ethsnarks {
+
+
+// The phases of ProverStats which are reported, 'evaluation' is the part of
+// the witness map which isn't an FFT
+static const char *SCALING_PHASES[] = {
+    "witness_map", "evaluation", "fft", "A_query", "B_query", "H_query", "L_query", "total"
+};
+
+
+static void make_synthetic( ProtoboardT& pb, size_t num_constraints )
+{
+    auto example = libsnark::generate_r1cs_example_with_field_input<FieldT>(num_constraints, 10);
+
+    pb.constraint_system = std::move(example.constraint_system);
+    pb.values = example.primary_input;
+    pb.values.insert(pb.values.end(), example.auxiliary_input.begin(), example.auxiliary_input.end());
+}
+
+
+static void make_merkle( ProtoboardT& pb, size_t depth )
+{
+    const auto root = make_variable(pb, "root");
+    pb.set_input_sizes(1);
+
+    const auto address_bits = make_var_array(pb, depth, "address_bits");
+    const auto path = make_var_array(pb, depth, "path");
+    for( size_t i = 0; i < depth; i++ )
+    {
+        pb.val(address_bits[i]) = (std::rand() & 1) ? FieldT::one() : FieldT::zero();
+        pb.val(path[i]) = FieldT::random_element();
+    }
+
+    const auto leaf = make_variable(pb, FieldT::random_element(), "leaf");
+
+    merkle_path_authenticator<MiMC_e7_hash_gadget> authenticator(
+        pb, depth, address_bits, merkle_tree_IVs(pb), leaf, root, path, "authenticator");
+    authenticator.generate_r1cs_constraints();
+    authenticator.generate_r1cs_witness();
+    pb.val(root) = pb.val(authenticator.result());
+}
+
+
+static void make_eddsa_batch( ProtoboardT& pb, size_t n )
+{
+    // The HashEdDSA test vector of test_jubjub_eddsa, for every signature
+    const jubjub::Params params;
+    const jubjub::EdwardsPoint B(params.Gx, params.Gy);
+    const jubjub::EdwardsPoint A(
+        FieldT("333671881179914989291633188949569309119725676183802886621140166987382124337"),
+        FieldT("4050436616325076046600891135828313078248584449767955905006778857958871314574"));
+    const jubjub::EdwardsPoint R(
+        FieldT("21473010389772475573783051334263374448039981396476357164143587141689900886674"),
+        FieldT("11330590229113935667895133446882512506792533479705847316689101265088791098646"));
+    const FieldT s("21807294168737929637405719327036335125520717961882955117047593281820367379946");
+    const auto msg = bytes_to_bv((const uint8_t*)"abc", 3);
+
+    std::vector<jubjub::VariablePointT> A_vars, R_vars;
+    std::vector<VariableArrayT> s_vars, msg_vars;
+    for( size_t i = 0; i < n; i++ )
+    {
+        A_vars.push_back(A.as_VariablePointT(pb, FMT("A", "[%zu]", i)));
+        R_vars.push_back(R.as_VariablePointT(pb, FMT("R", "[%zu]", i)));
+
+        s_vars.push_back(make_var_array(pb, FieldT::size_in_bits(), FMT("s", "[%zu]", i)));
+        s_vars.back().fill_with_bits_of_field_element(pb, s);
+
+        msg_vars.push_back(make_var_array(pb, msg.size(), FMT("msg", "[%zu]", i)));
+        msg_vars.back().fill_with_bits(pb, msg);
+    }
+
+    jubjub::EdDSA_batch the_gadget(pb, params, B, A_vars, R_vars, s_vars, msg_vars, "the_gadget");
+    the_gadget.generate_r1cs_constraints();
+    the_gadget.generate_r1cs_witness();
+}
+
+
+static std::vector<unsigned int> thread_counts()
+{
+#ifdef MULTICORE
+    const unsigned int max_threads = omp_get_max_threads();
+#else
+    const unsigned int max_threads = 1;
+#endif
+
+    std::vector<unsigned int> result;
+    for( unsigned int n = 1; n < max_threads; n *= 2 ) {
+        result.push_back(n);
+    }
+    result.push_back(max_threads);
+    return result;
+}
+
+
+/**
+* The best time of each phase, over `repeats` proofs with the config
+*/
+static std::map<std::string, double> time_phases( ProtoboardT& pb, ProvingKeyT& pk, const libsnark::Config& config, unsigned int repeats )
+{
+#ifdef MULTICORE
+    omp_set_num_threads(config.num_threads);
+#endif
+
+    ProverContextT context(pk);
+    init_prover_context(context, pb, config);
+
+    libsnark::ProverStats stats;
+    context.stats = &stats;
+
+    std::map<std::string, double> best;
+    for( unsigned int i = 0; i < repeats; i++ )
+    {
+        libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+
+        std::map<std::string, double> times;
+        for( const char *name : SCALING_PHASES ) {
+            times[name] = stats.wall_seconds(name);
+        }
+        times["evaluation"] = times["witness_map"] - times["fft"];
+
+        for( const auto& it : times )
+        {
+            if( i == 0 || it.second < best[it.first] ) {
+                best[it.first] = it.second;
+            }
+        }
+    }
+
+    return best;
+}
+
+
+static json scale_circuit( const char *name, ProtoboardT& pb, unsigned int repeats )
+{
+    std::cerr << name << ": " << pb.constraint_system.num_constraints() << " constraints" << std::endl;
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    ProvingKeyT pk(keypair.pk);
+
+    json runs = json::array();
+    for( bool smt : {false, true} )
+    {
+        std::map<std::string, double> baseline;
+        for( unsigned int num_threads : thread_counts() )
+        {
+            libsnark::Config config;
+            config.num_threads = num_threads;
+            config.smt = smt;
+
+            std::cerr << "  threads=" << num_threads << " smt=" << smt << std::endl;
+            const auto times = time_phases(pb, pk, config, repeats);
+            if( num_threads == 1 ) {
+                baseline = times;
+            }
+
+            json phases;
+            for( const char *phase : SCALING_PHASES )
+            {
+                const double seconds = times.at(phase);
+                const double speedup = seconds > 0 ? baseline.at(phase) / seconds : 0;
+                phases[phase] = {
+                    {"seconds", seconds},
+                    {"speedup", speedup},
+                    {"efficiency", speedup / num_threads}
+                };
+            }
+
+            runs.push_back({
+                {"num_threads", num_threads},
+                {"smt", smt},
+                {"phases", phases}
+            });
+        }
+    }
+
+    return {
+        {"circuit", name},
+        {"num_constraints", pb.constraint_system.num_constraints()},
+        {"num_variables", pb.constraint_system.num_variables()},
+        {"runs", runs}
+    };
+}
+
+
+// namespace ethsnarks
+}
+
+
+int main( int argc, char **argv )
+{
+    using namespace ethsnarks;
+
+    ppT::init_public_params();
+    libff::inhibit_profiling_info = true;
+    libff::inhibit_profiling_counters = true;
+
+    const size_t num_constraints = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (1 << 16);
+    const unsigned int repeats = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 3;
+    if( num_constraints == 0 || repeats == 0 ) {
+        std::cerr << "Usage: " << argv[0] << " [num_constraints] [repeats]" << std::endl;
+        return 1;
+    }
+
+    json result = json::array();
+
+    {
+        ProtoboardT pb;
+        make_synthetic(pb, num_constraints);
+        result.push_back(scale_circuit("synthetic", pb, repeats));
+    }
+
+    {
+        ProtoboardT pb;
+        make_merkle(pb, 29);
+        result.push_back(scale_circuit("mimc_merkle_29", pb, repeats));
+    }
+
+    {
+        ProtoboardT pb;
+        make_eddsa_batch(pb, 4);
+        result.push_back(scale_circuit("eddsa_batch_4", pb, repeats));
+    }
+
+    std::cout << result.dump(2) << std::endl;
+
+    return 0;
+}
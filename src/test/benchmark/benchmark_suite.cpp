@@ -0,0 +1,664 @@
+// Copyright (c) 2018 HarryR
+// License: LGPL-3.0+
+
+/**
+* Parameterised benchmarks of the prover stages, the gadgets and the JSON
+* encodings, using Google Benchmark
+*
+* Results are written as JSON, to track them across releases, with:
+*
+*   benchmark_suite --benchmark_out=benchmark.json --benchmark_out_format=json
+*
+* A subset is chosen with `--benchmark_filter=<regex>`, e.g. `multi_exp`.
+* Fixtures, random points or circuits, are made once per size and shared by
+* every benchmark which needs them, outside of the timed loops.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#include <libff/algebra/scalar_multiplication/multiexp.hpp>
+#include <libff/common/profiling.hpp>
+
+#include "ethsnarks.hpp"
+#include "utils.hpp"
+#include "stubs.hpp"
+#include "import.hpp"
+#include "export.hpp"
+
+#include "gadgets/mimc.hpp"
+#include "gadgets/poseidon.hpp"
+#include "gadgets/sha256_full.hpp"
+#include "gadgets/merkle_tree.hpp"
+#include "jubjub/pedersen_hash.hpp"
+#include "jubjub/eddsa.hpp"
+
+
+namespace ethsnarks {
+
+
+// The domains which libsnark::Config::fft selects, by index
+static const char *FFT_TYPES[] = {"basic_radix2", "recursive"};
+
+
+template<typename T>
+static const std::vector<T>& random_points( size_t n )
+{
+    static std::vector<T> points;
+    while( points.size() < n ) {
+        points.push_back(T::random_element());
+    }
+    return points;
+}
+
+
+static const std::vector<FieldT>& random_scalars( size_t n )
+{
+    static std::vector<FieldT> scalars;
+    while( scalars.size() < n ) {
+        scalars.push_back(FieldT::random_element());
+    }
+    return scalars;
+}
+
+
+static const VariableArrayT random_variables( ProtoboardT& pb, size_t n, const std::string& annotation )
+{
+    const auto result = make_var_array(pb, n, annotation);
+    for( const auto& var : result ) {
+        pb.val(var) = FieldT::random_element();
+    }
+    return result;
+}
+
+
+static const VariableArrayT random_bits( ProtoboardT& pb, size_t n, const std::string& annotation )
+{
+    const auto result = make_var_array(pb, n, annotation);
+    for( const auto& var : result ) {
+        pb.val(var) = (std::rand() & 1) ? FieldT::one() : FieldT::zero();
+    }
+    return result;
+}
+
+
+/**
+* One public input squared `n - 2` times, the smallest circuit with a
+* domain of `n`, for the FFTs, the witness map and the encodings
+*/
+static ProtoboardT& squaring_chain( size_t n )
+{
+    static std::map<size_t, std::unique_ptr<ProtoboardT>> cache;
+
+    auto& pb = cache[n];
+    if( ! pb )
+    {
+        pb.reset(new ProtoboardT);
+
+        VariableT x = make_variable(*pb, FieldT::random_element(), "x");
+        pb->set_input_sizes(1);
+
+        for( size_t i = 2; i < n; i++ )
+        {
+            const VariableT y = make_variable(*pb, pb->val(x) * pb->val(x), "y");
+            pb->add_r1cs_constraint(ConstraintT(x, x, y), "x * x = y");
+            x = y;
+        }
+    }
+    return *pb;
+}
+
+
+/**
+* A verification key and a proof of squaring_chain(1024), for the encodings
+*/
+struct proof_fixture
+{
+    VerificationKeyT vk;
+    ProofT proof;
+    PrimaryInputT input;
+
+    proof_fixture()
+    {
+        ProtoboardT& pb = squaring_chain(1 << 10);
+        auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+
+        ProvingKeyT pk(keypair.pk);
+        ProverContextT context(pk);
+        init_prover_context(context, pb);
+
+        proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+        vk = keypair.vk;
+        input = pb.primary_input();
+    }
+
+    static proof_fixture& get()
+    {
+        static proof_fixture fixture;
+        return fixture;
+    }
+};
+
+
+// ----------------------------------------------------------------
+// Prover stages
+
+
+/**
+* Args are the number of bases, Config::multi_exp_c (0 picks the window
+* from the size) and Config::multi_exp_prefetch_locality (4 doesn't prefetch)
+*/
+template<typename T>
+static void BM_multi_exp( benchmark::State& state )
+{
+    const size_t n = state.range(0);
+
+    libsnark::Config config;
+    config.multi_exp_c = state.range(1);
+    config.multi_exp_prefetch_locality = state.range(2);
+
+    const std::vector<T>& bases = random_points<T>(n);
+    const std::vector<FieldT>& scalars = random_scalars(n);
+    std::vector<LimbT> scratch(n);
+
+    for( auto _ : state )
+    {
+        benchmark::DoNotOptimize(libff::multi_exp<T, FieldT, libff::multi_exp_method_BDLO12>(
+            bases.begin(), bases.begin() + n,
+            scalars.begin(), scalars.begin() + n,
+            scratch,
+            config));
+    }
+
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+
+/**
+* The same args with the bases sorted by bucket first, to compare against
+* BM_multi_exp, see Config::multi_exp_method
+*/
+template<typename T>
+static void BM_sorted_multi_exp( benchmark::State& state )
+{
+    const size_t n = state.range(0);
+
+    libsnark::Config config;
+    config.multi_exp_c = state.range(1);
+    config.multi_exp_prefetch_locality = state.range(2);
+
+    const std::vector<T>& bases = random_points<T>(n);
+    const std::vector<FieldT>& scalars = random_scalars(n);
+    std::vector<LimbT> scratch(n);
+
+    for( auto _ : state )
+    {
+        benchmark::DoNotOptimize(libsnark::r1cs_gg_ppzksnark_zok_sorted_multi_exp<T, FieldT>(
+            bases.begin(), nullptr, scalars.begin(), n, scratch, config));
+    }
+
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+
+static void multi_exp_args( benchmark::internal::Benchmark* b, int max_log_n )
+{
+    b->ArgNames({"n", "c", "prefetch"});
+    for( int log_n = 10; log_n <= max_log_n; log_n += 2 )
+    {
+        for( int c : {0, 12, 16} ) {
+            b->Args({1 << log_n, c, 0});
+        }
+        b->Args({1 << log_n, 0, 4});
+    }
+}
+
+
+static void multi_exp_args_G1( benchmark::internal::Benchmark* b )
+{
+    multi_exp_args(b, 16);
+}
+
+
+static void multi_exp_args_G2( benchmark::internal::Benchmark* b )
+{
+    multi_exp_args(b, 14);
+}
+
+
+BENCHMARK_TEMPLATE(BM_multi_exp, G1T)->Apply(multi_exp_args_G1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multi_exp, G2T)->Apply(multi_exp_args_G2)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_sorted_multi_exp, G1T)->Apply(multi_exp_args_G1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_sorted_multi_exp, G2T)->Apply(multi_exp_args_G2)->Unit(benchmark::kMillisecond);
+
+
+/**
+* Args are the domain size and the index of its type in FFT_TYPES
+*/
+static void BM_fft( benchmark::State& state )
+{
+    const size_t n = state.range(0);
+
+    libsnark::Config config;
+    config.fft = FFT_TYPES[state.range(1)];
+
+    const ProvingKeyT pk;
+    const auto domain = get_domain(squaring_chain(n), pk, config);
+
+    const auto& scalars = random_scalars(n);
+    std::vector<FieldT> values(scalars.begin(), scalars.begin() + n);
+
+    for( auto _ : state ) {
+        domain->FFT(values);
+    }
+
+    state.SetLabel(config.fft);
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+
+/**
+* The witness map of the prover: the constraints evaluated, the FFTs and
+* the quotient H, args as for BM_fft
+*/
+static void BM_qap_witness_map( benchmark::State& state )
+{
+    const size_t n = state.range(0);
+    ProtoboardT& pb = squaring_chain(n);
+
+    // The witness map doesn't read the proving key
+    ProvingKeyT pk;
+    ProverContextT context(pk);
+    context.config.fft = FFT_TYPES[state.range(1)];
+    context.constraint_system = &pb.constraint_system;
+    context.domain = get_domain(pb, pk, context.config);
+
+    for( auto _ : state ) {
+        libsnark::r1cs_gg_ppzksnark_zok_prover_witness_map<ppT>(context, pb.values, context.aA, context.aB, context.aH);
+    }
+
+    state.SetLabel(context.config.fft);
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+
+static void domain_args( benchmark::internal::Benchmark* b )
+{
+    b->ArgNames({"n", "fft"});
+    for( int log_n = 10; log_n <= 18; log_n += 2 )
+    {
+        for( int fft = 0; fft < int(sizeof(FFT_TYPES) / sizeof(FFT_TYPES[0])); fft++ ) {
+            b->Args({1 << log_n, fft});
+        }
+    }
+}
+
+
+BENCHMARK(BM_fft)->Apply(domain_args)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_qap_witness_map)->Apply(domain_args)->Unit(benchmark::kMillisecond);
+
+
+// ----------------------------------------------------------------
+// Gadgets, each made with its inputs filled in from a size `n`
+
+
+/** MiMC of `n` messages */
+struct mimc_circuit
+{
+    const VariableArrayT messages;
+    const VariableT iv;
+    MiMC_e7_hash_gadget hasher;
+
+    mimc_circuit( ProtoboardT& pb, size_t n ) :
+        messages(random_variables(pb, n, "messages")),
+        iv(make_variable(pb, FieldT::random_element(), "iv")),
+        hasher(pb, iv, messages, "hasher")
+    { }
+
+    void generate_r1cs_constraints() { hasher.generate_r1cs_constraints(); }
+
+    void generate_r1cs_witness() { hasher.generate_r1cs_witness(); }
+};
+
+
+/** `n` Poseidon hashes of two inputs */
+struct poseidon_circuit
+{
+    std::vector<std::unique_ptr<Poseidon128<2, 1>>> hashers;
+
+    poseidon_circuit( ProtoboardT& pb, size_t n )
+    {
+        for( size_t i = 0; i < n; i++ )
+        {
+            const auto inputs = random_variables(pb, 2, FMT("inputs", "[%zu]", i));
+            hashers.emplace_back(new Poseidon128<2, 1>(pb, inputs, FMT("hashers", "[%zu]", i)));
+        }
+    }
+
+    void generate_r1cs_constraints()
+    {
+        for( auto& hasher : hashers ) {
+            hasher->generate_r1cs_constraints();
+        }
+    }
+
+    void generate_r1cs_witness()
+    {
+        for( auto& hasher : hashers ) {
+            hasher->generate_r1cs_witness();
+        }
+    }
+};
+
+
+/** `n` SHA256 hashes of a 512 bit block */
+struct sha256_circuit
+{
+    struct instance
+    {
+        libsnark::block_variable<FieldT> block;
+        libsnark::digest_variable<FieldT> digest;
+        sha256_full_gadget_512 hasher;
+
+        instance( ProtoboardT& pb, const std::string& annotation_prefix ) :
+            block(pb, libsnark::SHA256_block_size, FMT(annotation_prefix, ".block")),
+            digest(pb, libsnark::SHA256_digest_size, FMT(annotation_prefix, ".digest")),
+            hasher(pb, block, digest, FMT(annotation_prefix, ".hasher"))
+        {
+            libff::bit_vector bits(libsnark::SHA256_block_size);
+            for( size_t i = 0; i < bits.size(); i++ ) {
+                bits[i] = std::rand() & 1;
+            }
+            block.generate_r1cs_witness(bits);
+        }
+    };
+
+    std::vector<std::unique_ptr<instance>> instances;
+
+    sha256_circuit( ProtoboardT& pb, size_t n )
+    {
+        for( size_t i = 0; i < n; i++ ) {
+            instances.emplace_back(new instance(pb, FMT("instances", "[%zu]", i)));
+        }
+    }
+
+    void generate_r1cs_constraints()
+    {
+        for( auto& it : instances ) {
+            it->hasher.generate_r1cs_constraints();
+        }
+    }
+
+    void generate_r1cs_witness()
+    {
+        for( auto& it : instances ) {
+            it->hasher.generate_r1cs_witness();
+        }
+    }
+};
+
+
+/** Pedersen hash of `n` bits, a multiple of 3 */
+struct pedersen_circuit
+{
+    const jubjub::Params params;
+    const VariableArrayT bits;
+    jubjub::PedersenHash hasher;
+
+    pedersen_circuit( ProtoboardT& pb, size_t n ) :
+        bits(random_bits(pb, n, "bits")),
+        hasher(pb, params, "benchmark", bits, "hasher")
+    { }
+
+    void generate_r1cs_constraints() { hasher.generate_r1cs_constraints(); }
+
+    void generate_r1cs_witness() { hasher.generate_r1cs_witness(); }
+};
+
+
+/** `n` HashEdDSA signatures, from the test vectors of test_jubjub_eddsa */
+struct eddsa_circuit
+{
+    const jubjub::Params params;
+    std::vector<std::unique_ptr<jubjub::EdDSA>> verifiers;
+
+    eddsa_circuit( ProtoboardT& pb, size_t n )
+    {
+        const jubjub::EdwardsPoint B(params.Gx, params.Gy);
+        const jubjub::EdwardsPoint A(
+            FieldT("333671881179914989291633188949569309119725676183802886621140166987382124337"),
+            FieldT("4050436616325076046600891135828313078248584449767955905006778857958871314574"));
+        const jubjub::EdwardsPoint R(
+            FieldT("21473010389772475573783051334263374448039981396476357164143587141689900886674"),
+            FieldT("11330590229113935667895133446882512506792533479705847316689101265088791098646"));
+        const FieldT s("21807294168737929637405719327036335125520717961882955117047593281820367379946");
+        const auto msg = bytes_to_bv((const uint8_t*)"abc", 3);
+
+        for( size_t i = 0; i < n; i++ )
+        {
+            const auto msg_bits = make_var_array(pb, msg.size(), FMT("msg", "[%zu]", i));
+            msg_bits.fill_with_bits(pb, msg);
+
+            const auto s_bits = make_var_array(pb, FieldT::size_in_bits(), FMT("s", "[%zu]", i));
+            s_bits.fill_with_bits_of_field_element(pb, s);
+
+            verifiers.emplace_back(new jubjub::EdDSA(pb, params, B,
+                A.as_VariablePointT(pb, FMT("A", "[%zu]", i)),
+                R.as_VariablePointT(pb, FMT("R", "[%zu]", i)),
+                s_bits, msg_bits, FMT("verifiers", "[%zu]", i)));
+        }
+    }
+
+    void generate_r1cs_constraints()
+    {
+        for( auto& verifier : verifiers ) {
+            verifier->generate_r1cs_constraints();
+        }
+    }
+
+    void generate_r1cs_witness()
+    {
+        for( auto& verifier : verifiers ) {
+            verifier->generate_r1cs_witness();
+        }
+    }
+};
+
+
+/** A MiMC merkle path of depth `n` */
+struct merkle_circuit
+{
+    const VariableArrayT address_bits;
+    const VariableArrayT path;
+    const VariableT leaf;
+    const VariableT root;
+    merkle_path_authenticator<MiMC_e7_hash_gadget> authenticator;
+
+    merkle_circuit( ProtoboardT& pb, size_t n ) :
+        address_bits(random_bits(pb, n, "address_bits")),
+        path(random_variables(pb, n, "path")),
+        leaf(make_variable(pb, FieldT::random_element(), "leaf")),
+        root(make_variable(pb, "root")),
+        authenticator(pb, n, address_bits, merkle_tree_IVs(pb), leaf, root, path, "authenticator")
+    { }
+
+    void generate_r1cs_constraints() { authenticator.generate_r1cs_constraints(); }
+
+    void generate_r1cs_witness() { authenticator.generate_r1cs_witness(); }
+};
+
+
+/**
+* Making the circuit and its constraints, on a new protoboard each time
+*/
+template<typename CircuitT>
+static void BM_constraints( benchmark::State& state )
+{
+    size_t n_constraints = 0;
+    for( auto _ : state )
+    {
+        ProtoboardT pb;
+        CircuitT circuit(pb, state.range(0));
+        circuit.generate_r1cs_constraints();
+        n_constraints = pb.num_constraints();
+    }
+
+    state.counters["constraints"] = n_constraints;
+}
+
+
+/**
+* The witness, of a circuit made once
+*/
+template<typename CircuitT>
+static void BM_witness( benchmark::State& state )
+{
+    ProtoboardT pb;
+    CircuitT circuit(pb, state.range(0));
+    circuit.generate_r1cs_constraints();
+
+    for( auto _ : state ) {
+        circuit.generate_r1cs_witness();
+    }
+
+    state.counters["constraints"] = pb.num_constraints();
+}
+
+
+#define BENCHMARK_CIRCUIT(CircuitT, ...) \
+    BENCHMARK_TEMPLATE(BM_constraints, CircuitT)->ArgName("n")->Unit(benchmark::kMillisecond)__VA_ARGS__; \
+    BENCHMARK_TEMPLATE(BM_witness, CircuitT)->ArgName("n")->Unit(benchmark::kMillisecond)__VA_ARGS__
+
+BENCHMARK_CIRCUIT(mimc_circuit, ->Arg(1)->Arg(8)->Arg(64));
+BENCHMARK_CIRCUIT(poseidon_circuit, ->Arg(1)->Arg(8)->Arg(64));
+BENCHMARK_CIRCUIT(sha256_circuit, ->Arg(1)->Arg(4));
+BENCHMARK_CIRCUIT(pedersen_circuit, ->Arg(192)->Arg(768));
+BENCHMARK_CIRCUIT(eddsa_circuit, ->Arg(1)->Arg(4));
+BENCHMARK_CIRCUIT(merkle_circuit, ->Arg(8)->Arg(16)->Arg(32));
+
+
+// ----------------------------------------------------------------
+// JSON import and export
+
+
+static void BM_proof_to_json( benchmark::State& state )
+{
+    auto& fixture = proof_fixture::get();
+    for( auto _ : state ) {
+        benchmark::DoNotOptimize(proof_to_json(fixture.proof, fixture.input));
+    }
+}
+
+
+static void BM_proof_from_json( benchmark::State& state )
+{
+    auto& fixture = proof_fixture::get();
+    const auto proof_json = proof_to_json(fixture.proof, fixture.input);
+    for( auto _ : state )
+    {
+        std::stringstream in(proof_json);
+        benchmark::DoNotOptimize(proof_from_json(in));
+    }
+}
+
+
+static void BM_vk_to_json( benchmark::State& state )
+{
+    auto& fixture = proof_fixture::get();
+    for( auto _ : state ) {
+        benchmark::DoNotOptimize(vk2json(fixture.vk));
+    }
+}
+
+
+static void BM_vk_from_json( benchmark::State& state )
+{
+    auto& fixture = proof_fixture::get();
+    const auto vk_json = vk2json(fixture.vk);
+    for( auto _ : state )
+    {
+        std::stringstream in(vk_json);
+        benchmark::DoNotOptimize(vk_from_json(in));
+    }
+}
+
+
+/** A list of `n` field elements, as the inputs of a proof are read */
+static void BM_create_F_list( benchmark::State& state )
+{
+    const size_t n = state.range(0);
+    const auto& scalars = random_scalars(n);
+
+    nlohmann::json list = nlohmann::json::array();
+    for( size_t i = 0; i < n; i++ ) {
+        list.push_back("0x" + HexStringFromBigint(scalars[i].as_bigint()));
+    }
+
+    std::vector<FieldT> out;
+    for( auto _ : state ) {
+        create_F_list(list, out);
+    }
+
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+
+/** The constraints (arg 0) or the witness (arg 1) of a circuit, written to a file */
+static void BM_export_json( benchmark::State& state )
+{
+    const size_t n = state.range(0);
+    const bool witness = state.range(1);
+    ProtoboardT& pb = squaring_chain(n);
+    const std::string path = "benchmark_suite.tmp.json";
+
+    for( auto _ : state )
+    {
+        if( ! (witness ? witness2json(pb, path) : r1cs2json(pb, path)) ) {
+            state.SkipWithError("Cannot write file");
+            break;
+        }
+    }
+    std::remove(path.c_str());
+
+    state.SetLabel(witness ? "witness2json" : "r1cs2json");
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+
+BENCHMARK(BM_proof_to_json);
+BENCHMARK(BM_proof_from_json);
+BENCHMARK(BM_vk_to_json);
+BENCHMARK(BM_vk_from_json);
+BENCHMARK(BM_create_F_list)->ArgName("n")->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_export_json)->ArgNames({"n", "witness"})
+    ->Args({1 << 10, 0})->Args({1 << 10, 1})
+    ->Args({1 << 16, 0})->Args({1 << 16, 1})
+    ->Unit(benchmark::kMillisecond);
+
+
+// namespace ethsnarks
+}
+
+
+int main( int argc, char **argv )
+{
+    // Warmed up so the first iteration of a hash benchmark isn't an outlier
+    ethsnarks::stub_init_public_params(true);
+
+    // The prover's profiling blocks would be printed on every iteration
+    libff::inhibit_profiling_info = true;
+    libff::inhibit_profiling_counters = true;
+
+    benchmark::Initialize(&argc, argv);
+    if( benchmark::ReportUnrecognizedArguments(argc, argv) ) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "jubjub/adder.hpp"
+#include "jubjub/conditional_point.hpp"
 #include "stubs.hpp"
 
 namespace ethsnarks {
@@ -41,6 +42,45 @@ bool test_jubjub_add()
 }
 
 
+/**
+* a + bit*b, which is c when the bit is set and a otherwise
+*/
+bool test_jubjub_conditional_add( bool bit )
+{
+	jubjub::Params params;
+
+	ProtoboardT pb;
+
+	const FieldT a_x("16838670147829712932420991684129000253378636928981731224589534936353716235035");
+	const FieldT a_y("4937932098257800452675892262662102197939919307515526854605530277406221704113");
+	const FieldT c_x("6973964026021872993461206321838264291006454903617648820964060641444266170799");
+	const FieldT c_y("5058405786102109493822166715025707301516781386582502239931016782220981024527");
+
+	VariableT x1 = make_variable(pb, a_x, "x1");
+	VariableT y1 = make_variable(pb, a_y, "y1");
+	VariableT x2 = make_variable(pb, FieldT("1538898545681068144632304956674715144385644913102700797899565858629154026483"), "x2");
+	VariableT y2 = make_variable(pb, FieldT("2090866097726307108368399316617534306721374642464311386024657526409503477525"), "y2");
+	VariableT b = make_variable(pb, bit ? FieldT::one() : FieldT::zero(), "bit");
+
+	jubjub::ConditionalPointAdder the_gadget(pb, params, x1, y1, x2, y2, b, "the_gadget");
+
+	the_gadget.generate_r1cs_witness();
+	the_gadget.generate_r1cs_constraints();
+
+	if( pb.num_constraints() != 8 ) {
+		std::cerr << "FAIL conditional add has " << pb.num_constraints() << " constraints" << std::endl;
+		return false;
+	}
+
+	if( pb.val(the_gadget.result_x()) != (bit ? c_x : a_x) || pb.val(the_gadget.result_y()) != (bit ? c_y : a_y) ) {
+		std::cerr << "FAIL conditional add result, bit " << bit << std::endl;
+		return false;
+	}
+
+	return pb.is_satisfied();
+}
+
+
 // namespace ethsnarks
 }
 
@@ -56,6 +96,12 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if( ! ethsnarks::test_jubjub_conditional_add(false) || ! ethsnarks::test_jubjub_conditional_add(true) )
+    {
+        std::cerr << "FAIL conditional\n";
+        return 2;
+    }
+
     std::cout << "OK\n";
     return 0;
 }
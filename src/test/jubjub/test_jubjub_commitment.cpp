@@ -46,6 +46,80 @@ bool test_jubjub_commitment(
 }
 
 
+static VariableArrayT make_scalar( ProtoboardT& pb, const FieldT& value, const std::string& annotation )
+{
+    VariableArrayT var;
+    var.allocate(pb, 254, annotation);
+    var.fill_with_bits_of_field_element(pb, value);
+    return var;
+}
+
+
+/**
+* The batch gives the same results as a Commitment for each, at the same cost
+*/
+bool test_jubjub_commitment_batch(
+    const std::vector<jubjub::EdwardsPoint> in_points,
+    size_t n_commitments
+) {
+    jubjub::Params params;
+
+    ProtoboardT batch_pb;
+    std::vector<std::vector<VariableArrayT>> batch_scalars(n_commitments);
+    std::vector<std::vector<FieldT>> values(n_commitments);
+    for( size_t i = 0; i < n_commitments; i++ ) {
+        for( size_t j = 0; j < in_points.size(); j++ ) {
+            values[i].emplace_back(FieldT::random_element());
+            batch_scalars[i].emplace_back(make_scalar(batch_pb, values[i][j], FMT("s", "[%zu][%zu]", i, j)));
+        }
+    }
+    const size_t batch_n_constraints = batch_pb.num_constraints();
+
+    jubjub::CommitmentBatch the_batch(batch_pb, params, in_points, batch_scalars, "the_batch");
+    the_batch.generate_r1cs_witness();
+    the_batch.generate_r1cs_constraints();
+
+    if( ! batch_pb.is_satisfied() || the_batch.size() != n_commitments ) {
+        std::cerr << "FAIL batch not satisfied" << std::endl;
+        return false;
+    }
+
+    for( size_t i = 0; i < n_commitments; i++ )
+    {
+        ProtoboardT pb;
+        std::vector<VariableArrayT> scalars;
+        for( size_t j = 0; j < in_points.size(); j++ ) {
+            scalars.emplace_back(make_scalar(pb, values[i][j], FMT("s", "[%zu]", j)));
+        }
+        const size_t n_constraints = pb.num_constraints();
+
+        jubjub::Commitment the_gadget(pb, params, in_points, scalars, "the_gadget");
+        the_gadget.generate_r1cs_witness();
+        the_gadget.generate_r1cs_constraints();
+
+        if( pb.val(the_gadget.result_x()) != batch_pb.val(the_batch.result_x(i))
+         || pb.val(the_gadget.result_y()) != batch_pb.val(the_batch.result_y(i)) ) {
+            std::cerr << "FAIL batch result " << i << std::endl;
+            return false;
+        }
+
+        if( (pb.num_constraints() - n_constraints) * n_commitments != batch_pb.num_constraints() - batch_n_constraints ) {
+            std::cerr << "FAIL batch constraints" << std::endl;
+            return false;
+        }
+    }
+
+    // A wrong window is caught
+    batch_pb.val(the_batch.m_instances[0].windows_x[1]) += FieldT::one();
+    if( batch_pb.is_satisfied() ) {
+        std::cerr << "FAIL batch wrong window satisfied" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
 // namespace ethsnarks
 }
 
@@ -98,6 +172,20 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if( ! ethsnarks::test_jubjub_commitment_batch(
+        {
+            {FieldT("18711813783827180207124447196139534826112748455014411397103191885302573186177"),
+             FieldT("7894085631011368230905512940366369177490751126789162452408410394984840330485")},
+            {FieldT("7066372621571166136151614778064732022672458346166374172249046796138608396221"),
+             FieldT("15873128071097042084149123594062827139607854335508714396010550569589457829538")}
+        },
+        5
+    ) )
+    {
+        std::cerr << "FAIL (batch)\n";
+        return 1;
+    }
+
     std::cout << "OK\n";
     return 0;
 }
@@ -1,11 +1,18 @@
 #include "jubjub/eddsa.hpp"
+#include "cs_budget.hpp"
 #include "utils.hpp"
 
 using ethsnarks::jubjub::EdwardsPoint;
 using ethsnarks::jubjub::VariablePointT;
 using ethsnarks::jubjub::EdDSA;
 using ethsnarks::jubjub::PureEdDSA;
+using ethsnarks::jubjub::EdDSA_batch;
+using ethsnarks::jubjub::PureEdDSA_batch;
 using ethsnarks::jubjub::eddsa_open;
+using ethsnarks::jubjub::eddsa_open_batch;
+using ethsnarks::jubjub::eddsa_verify_batch;
+using ethsnarks::jubjub::eddsa_verify_native;
+using ethsnarks::jubjub::SignedMessage;
 
 using ethsnarks::bytes_to_bv;
 using ethsnarks::FieldT;
@@ -31,6 +38,32 @@ emsg = eddsa_sign(b'abc', k)
 print(emsg.A, emsg.sig.R, emsg.sig.s)
 */
 
+/**
+* One signature in a circuit, as eddsa_open, with its cost checked against the budget
+*/
+template<class T>
+static bool eddsa_cost( const char *name, const ethsnarks::jubjub::Params& params, const EdwardsPoint& B, const SignedMessage& signed_msg )
+{
+    ethsnarks::ProtoboardT pb;
+
+    const auto msg_var_bits = ethsnarks::make_var_array(pb, signed_msg.msg.size(), "msg_var_bits");
+    msg_var_bits.fill_with_bits(pb, signed_msg.msg);
+
+    const auto s_var_bits = ethsnarks::make_var_array(pb, FieldT::size_in_bits(), "s_var_bits");
+    s_var_bits.fill_with_bits_of_field_element(pb, signed_msg.s);
+
+    const auto A = signed_msg.A.as_VariablePointT(pb, "A");
+    const auto R = signed_msg.R.as_VariablePointT(pb, "R");
+
+    ethsnarks::CSBudgetScope cost(pb, name);
+    T the_gadget(pb, params, B, A, R, s_var_bits, msg_var_bits, "the_gadget");
+    the_gadget.generate_r1cs_constraints();
+    cost.witness([&](){ the_gadget.generate_r1cs_witness(); });
+
+    return pb.is_satisfied() && cost.check();
+}
+
+
 int main( int argc, char **argv )
 {
     ethsnarks::ppT::init_public_params();
@@ -76,6 +109,75 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    // The same signatures natively
+    const EdwardsPoint B(params.Gx, params.Gy);
+    const SignedMessage hash_signed = {A,
+        {FieldT("21473010389772475573783051334263374448039981396476357164143587141689900886674"),
+         FieldT("11330590229113935667895133446882512506792533479705847316689101265088791098646")},
+        FieldT("21807294168737929637405719327036335125520717961882955117047593281820367379946"),
+        msg_abc_bits};
+    const SignedMessage pure_signed = {A,
+        {FieldT("17815983127755465894346158776246779862712623073638768513395595796132990361464"),
+         FieldT("947174453624106321442736396890323086851143728754269151257776508699019857364")},
+        FieldT("13341814865473145800030207090487687417599620847405735706082771659861699337012"),
+        msg_abcd_bits};
+
+    if( ! eddsa_verify_native<EdDSA>(params, B, hash_signed)
+     || ! eddsa_verify_native<PureEdDSA>(params, B, pure_signed) ) {
+        std::cerr << "FAIL native\n";
+        return 2;
+    }
+
+    if( eddsa_verify_native<PureEdDSA>(params, B, hash_signed)
+     || eddsa_verify_native<EdDSA>(params, B, pure_signed) ) {
+        std::cerr << "FAIL native wrong scheme\n";
+        return 3;
+    }
+
+    if( ! eddsa_cost<EdDSA>("EdDSA[3 bytes]", params, B, hash_signed)
+     || ! eddsa_cost<PureEdDSA>("PureEdDSA[4 bytes]", params, B, pure_signed) ) {
+        std::cerr << "FAIL cost\n";
+        return 9;
+    }
+
+    // A batch with a bad s, and one with a bad R, finds exactly those
+    SignedMessage bad_s = pure_signed;
+    bad_s.s += FieldT::one();
+    SignedMessage bad_R = pure_signed;
+    bad_R.R.y += FieldT::one();
+
+    std::vector<bool> valid;
+    if( ! eddsa_verify_batch<PureEdDSA>(params, B, {pure_signed, pure_signed, pure_signed}, &valid)
+     || valid != std::vector<bool>({true, true, true}) ) {
+        std::cerr << "FAIL batch\n";
+        return 4;
+    }
+
+    if( eddsa_verify_batch<PureEdDSA>(params, B, {pure_signed, bad_s, pure_signed, bad_R}, &valid)
+     || valid != std::vector<bool>({true, false, true, false}) ) {
+        std::cerr << "FAIL batch with invalid signatures\n";
+        return 5;
+    }
+
+    if( ! eddsa_verify_batch<EdDSA>(params, B, {hash_signed, hash_signed}) ) {
+        std::cerr << "FAIL HashEdDSA batch\n";
+        return 6;
+    }
+
+    // The same, in one circuit
+    if( ! eddsa_open_batch<PureEdDSA_batch>(params, B, {pure_signed, pure_signed, pure_signed})
+     || ! eddsa_open_batch<EdDSA_batch>(params, B, {hash_signed, hash_signed}) ) {
+        std::cerr << "FAIL batch circuit\n";
+        return 7;
+    }
+
+    if( eddsa_open_batch<PureEdDSA_batch>(params, B, {pure_signed, bad_s, pure_signed})
+     || eddsa_open_batch<PureEdDSA_batch>(params, B, {bad_R, pure_signed})
+     || eddsa_open_batch<EdDSA_batch>(params, B, {hash_signed, pure_signed}) ) {
+        std::cerr << "FAIL batch circuit with invalid signatures\n";
+        return 8;
+    }
+
     std::cout << "OK\n";
     return 0;
 }
@@ -0,0 +1,102 @@
+#include "jubjub/fixed_base_mul.hpp"
+#include "utils.hpp"
+
+
+namespace ethsnarks {
+
+
+bool test_jubjub_add_instance()
+{
+    jubjub::Params params;
+    ProtoboardT pb;
+
+    VariableT a_x = make_variable(pb, FieldT("16838670147829712932420991684129000253378636928981731224589534936353716235035"), "a_x");
+    VariableT a_y = make_variable(pb, FieldT("4937932098257800452675892262662102197939919307515526854605530277406221704113"), "a_y");
+    VariableT b_x = make_variable(pb, FieldT("1538898545681068144632304956674715144385644913102700797899565858629154026483"), "b_x");
+    VariableT b_y = make_variable(pb, FieldT("2090866097726307108368399316617534306721374642464311386024657526409503477525"), "b_y");
+
+    // Both instances share the constraints of one master
+    jubjub::PointAdderInstance first(pb, params, a_x, a_y, b_x, b_y, "first");
+    jubjub::PointAdderInstance second(pb, params, b_x, b_y, a_x, a_y, "second");
+
+    first.generate_r1cs_witness();
+    second.generate_r1cs_witness();
+    first.generate_r1cs_constraints();
+    second.generate_r1cs_constraints();
+
+    const auto expected_x = FieldT("6973964026021872993461206321838264291006454903617648820964060641444266170799");
+    const auto expected_y = FieldT("5058405786102109493822166715025707301516781386582502239931016782220981024527");
+
+    for( const auto* adder : {&first, &second} )
+    {
+        if( pb.val(adder->result_x()) != expected_x || pb.val(adder->result_y()) != expected_y ) {
+            std::cerr << "adder result mismatch" << std::endl;
+            return false;
+        }
+    }
+
+    if( &first.master != &second.master ) {
+        std::cerr << "adders don't share a master" << std::endl;
+        return false;
+    }
+
+    return pb.is_satisfied();
+}
+
+
+bool test_jubjub_mul_fixed_instance()
+{
+    jubjub::Params params;
+    ProtoboardT pb;
+
+    VariableArrayT scalar;
+    scalar.allocate(pb, 252, "scalar");
+    scalar.fill_with_bits_of_field_element(pb, FieldT("6453482891510615431577168724743356132495662554103773572771861111634748265227"));
+
+    auto x = FieldT("17777552123799933955779906779655732241715742912184938656739573121738514868268");
+    auto y = FieldT("2626589144620713026669568689430873010625803728049924121243784502389097019475");
+
+    jubjub::fixed_base_mul_instance the_gadget(pb, params, x, y, scalar, "the_gadget");
+
+    the_gadget.generate_r1cs_witness();
+    the_gadget.generate_r1cs_constraints();
+
+    if( pb.val(the_gadget.result_x()) != FieldT("14404769628348642617958769113059441570295803354118213050215321178400191767982")
+     || pb.val(the_gadget.result_y()) != FieldT("18111766293807611156003252744789679243232262386740234472145247764702249886343") ) {
+        std::cerr << "fixed_base_mul result mismatch" << std::endl;
+        return false;
+    }
+
+    // A wrong scalar bit must not satisfy the shared constraints
+    if( ! pb.is_satisfied() ) {
+        return false;
+    }
+    pb.val(scalar[0]) = FieldT::one() - pb.val(scalar[0]);
+    return ! pb.is_satisfied();
+}
+
+
+// namespace ethsnarks
+}
+
+
+int main( int argc, char **argv )
+{
+    // Types for board 
+    ethsnarks::ppT::init_public_params();
+
+    if( ! ethsnarks::test_jubjub_add_instance() )
+    {
+        std::cerr << "FAIL add\n";
+        return 1;
+    }
+
+    if( ! ethsnarks::test_jubjub_mul_fixed_instance() )
+    {
+        std::cerr << "FAIL mul_fixed\n";
+        return 2;
+    }
+
+    std::cout << "OK\n";
+    return 0;
+}
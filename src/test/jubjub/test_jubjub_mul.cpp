@@ -1,49 +1,102 @@
 #include "jubjub/scalarmult.hpp"
+#include "jubjub/fixed_base_mul.hpp"
 #include "utils.hpp"
 
+#include <libff/algebra/fields/field_utils.hpp>
+
 
 namespace ethsnarks {
 
 
-bool test_jubjub_mul()
+static const FieldT point_x("17777552123799933955779906779655732241715742912184938656739573121738514868268");
+static const FieldT point_y("2626589144620713026669568689430873010625803728049924121243784502389097019475");
+
+
+template<typename MulT>
+static bool test_jubjub_mul_gadget( size_t n_bits, const FieldT& s, const jubjub::EdwardsPoint& expected, size_t& n_constraints )
 {
     jubjub::Params params;
     ProtoboardT pb;
 
     VariableArrayT scalar;
-    scalar.allocate(pb, 252, "scalar");
-    scalar.fill_with_bits_of_field_element(pb, FieldT("6453482891510615431577168724743356132495662554103773572771861111634748265227"));
+    scalar.allocate(pb, n_bits, "scalar");
+    scalar.fill_with_bits_of_field_element(pb, s);
 
     VariableT x = make_variable(pb, "x");
     VariableT y = make_variable(pb, "y");
-    pb.val(x) = FieldT("17777552123799933955779906779655732241715742912184938656739573121738514868268");
-    pb.val(y) = FieldT("2626589144620713026669568689430873010625803728049924121243784502389097019475");
+    pb.val(x) = point_x;
+    pb.val(y) = point_y;
 
-    auto expected_x = FieldT("14404769628348642617958769113059441570295803354118213050215321178400191767982");
-    auto expected_y = FieldT("18111766293807611156003252744789679243232262386740234472145247764702249886343");
-
-    jubjub::ScalarMult the_gadget(pb, params, x, y, scalar, "the_gadget");
+    MulT the_gadget(pb, params, x, y, scalar, "the_gadget");
 
     the_gadget.generate_r1cs_witness();
     the_gadget.generate_r1cs_constraints();
 
-    if( pb.val(the_gadget.result_x()) != expected_x ) {
+    if( pb.val(the_gadget.result_x()) != expected.x ) {
         std::cerr << "x mismatch" << std::endl;
         return false;
     }
 
-    if( pb.val(the_gadget.result_y()) != expected_y ) {
+    if( pb.val(the_gadget.result_y()) != expected.y ) {
         std::cerr << "y mismatch" << std::endl;
         return false;
     }
 
-    std::cout << pb.num_constraints() << " constraints" << std::endl;
-    std::cout << (pb.num_constraints() / float(scalar.size())) << " constraints per bit" << std::endl;
+    n_constraints = pb.num_constraints();
+    std::cout << "  " << n_bits << " bits: " << n_constraints << " constraints, "
+              << (n_constraints / float(n_bits)) << " constraints per bit" << std::endl;
 
     return pb.is_satisfied();
 }
 
 
+bool test_jubjub_mul()
+{
+    const FieldT s("6453482891510615431577168724743356132495662554103773572771861111634748265227");
+
+    const jubjub::EdwardsPoint expected = {
+        FieldT("14404769628348642617958769113059441570295803354118213050215321178400191767982"),
+        FieldT("18111766293807611156003252744789679243232262386740234472145247764702249886343")
+    };
+
+    size_t n_bitwise = 0;
+    size_t n_windowed = 0;
+
+    std::cout << "ScalarMult" << std::endl;
+    if( ! test_jubjub_mul_gadget<jubjub::ScalarMult>(252, s, expected, n_bitwise) ) {
+        return false;
+    }
+
+    std::cout << "ScalarMultWindowed" << std::endl;
+    if( ! test_jubjub_mul_gadget<jubjub::ScalarMultWindowed>(252, s, expected, n_windowed) ) {
+        return false;
+    }
+
+    if( n_windowed >= n_bitwise ) {
+        std::cerr << "windowed uses more constraints" << std::endl;
+        return false;
+    }
+
+    // Odd and even scalars, and odd numbers of bits, including those too
+    // large to stay in montgomery form
+    jubjub::Params params;
+    const FieldT even_s = s - FieldT::one();
+    for( const auto& scalar : {s, even_s, FieldT::zero(), FieldT::one(), -FieldT::one()} )
+    {
+        for( const size_t n_bits : {1, 2, 3, 4, 251, 253, 254} )
+        {
+            const auto bits = libff::convert_field_element_to_bit_vector(scalar, n_bits);
+            const auto expected_bits = jubjub::fixed_base_mul_native(params, {point_x, point_y}, bits);
+            if( ! test_jubjub_mul_gadget<jubjub::ScalarMultWindowed>(n_bits, scalar, expected_bits, n_windowed) ) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
 // namespace ethsnarks
 }
 
@@ -1,47 +1,102 @@
 #include "jubjub/fixed_base_mul.hpp"
 #include "utils.hpp"
 
+#include <libff/algebra/fields/field_utils.hpp>
+
 
 namespace ethsnarks {
 
 
-bool test_jubjub_mul_fixed()
+static const FieldT base_x("17777552123799933955779906779655732241715742912184938656739573121738514868268");
+static const FieldT base_y("2626589144620713026669568689430873010625803728049924121243784502389097019475");
+
+
+template<typename MulT>
+static bool test_jubjub_mul_fixed_gadget( size_t n_bits, const FieldT& s, const jubjub::EdwardsPoint& expected, size_t& n_constraints )
 {
     jubjub::Params params;
     ProtoboardT pb;
 
     VariableArrayT scalar;
-    scalar.allocate(pb, 252, "scalar");
-    scalar.fill_with_bits_of_field_element(pb, FieldT("6453482891510615431577168724743356132495662554103773572771861111634748265227"));
+    scalar.allocate(pb, n_bits, "scalar");
+    scalar.fill_with_bits_of_field_element(pb, s);
 
-    auto x = FieldT("17777552123799933955779906779655732241715742912184938656739573121738514868268");
-    auto y = FieldT("2626589144620713026669568689430873010625803728049924121243784502389097019475");
-
-    auto expected_x = FieldT("14404769628348642617958769113059441570295803354118213050215321178400191767982");
-    auto expected_y = FieldT("18111766293807611156003252744789679243232262386740234472145247764702249886343");
-
-    jubjub::fixed_base_mul the_gadget(pb, params, x, y, scalar, "the_gadget");
+    MulT the_gadget(pb, params, base_x, base_y, scalar, "the_gadget");
 
     the_gadget.generate_r1cs_witness();
     the_gadget.generate_r1cs_constraints();
 
-    if( pb.val(the_gadget.result_x()) != expected_x ) {
+    if( pb.val(the_gadget.result_x()) != expected.x ) {
         std::cerr << "x mismatch" << std::endl;
         return false;
     }
 
-    if( pb.val(the_gadget.result_y()) != expected_y ) {
+    if( pb.val(the_gadget.result_y()) != expected.y ) {
         std::cerr << "y mismatch" << std::endl;
         return false;
     }
 
-    std::cout << pb.num_constraints() << " constraints" << std::endl;
-    std::cout << (pb.num_constraints() / float(scalar.size())) << " constraints per bit" << std::endl;
+    n_constraints = pb.num_constraints();
+    std::cout << "  " << n_bits << " bits: " << n_constraints << " constraints, "
+              << (n_constraints / float(n_bits)) << " constraints per bit" << std::endl;
 
     return pb.is_satisfied();
 }
 
 
+bool test_jubjub_mul_fixed()
+{
+    jubjub::Params params;
+    const FieldT s("6453482891510615431577168724743356132495662554103773572771861111634748265227");
+
+    const jubjub::EdwardsPoint expected = {
+        FieldT("14404769628348642617958769113059441570295803354118213050215321178400191767982"),
+        FieldT("18111766293807611156003252744789679243232262386740234472145247764702249886343")
+    };
+
+    // Natively, twice to use the cached table
+    for( int i = 0; i < 2; i++ )
+    {
+        const auto bits = libff::convert_field_element_to_bit_vector(s, 252);
+        const auto result = jubjub::fixed_base_mul_native(params, {base_x, base_y}, bits);
+        if( result.x != expected.x || result.y != expected.y ) {
+            std::cerr << "native mismatch" << std::endl;
+            return false;
+        }
+    }
+
+    size_t n_unsigned = 0;
+    size_t n_signed = 0;
+
+    std::cout << "fixed_base_mul" << std::endl;
+    if( ! test_jubjub_mul_fixed_gadget<jubjub::fixed_base_mul>(252, s, expected, n_unsigned) ) {
+        return false;
+    }
+
+    std::cout << "fixed_base_mul_signed" << std::endl;
+    if( ! test_jubjub_mul_fixed_gadget<jubjub::fixed_base_mul_signed>(252, s, expected, n_signed) ) {
+        return false;
+    }
+
+    if( n_signed >= n_unsigned ) {
+        std::cerr << "signed windows use more constraints" << std::endl;
+        return false;
+    }
+
+    // With the 1 or 2 bits after the last signed window
+    for( const size_t n_bits : {3, 4, 5, 250, 253, 254} )
+    {
+        const auto bits = libff::convert_field_element_to_bit_vector(s, n_bits);
+        const auto expected_bits = jubjub::fixed_base_mul_native(params, {base_x, base_y}, bits);
+        if( ! test_jubjub_mul_fixed_gadget<jubjub::fixed_base_mul_signed>(n_bits, s, expected_bits, n_signed) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
 // namespace ethsnarks
 }
 
@@ -31,6 +31,12 @@ static bool test_jubjub_mul_fixed_zcash(ProtoboardT& pb, const VariableArrayT& i
         return false;
     }
 
+    const auto native = jubjub::fixed_base_mul_zcash_native(params, basepoints, in_bits.get_bits(pb));
+    if( native.x != expectedResult.x || native.y != expectedResult.y ) {
+        std::cerr << "native mismatch" << std::endl;
+        return false;
+    }
+
     std::cout << "\t" << pb.num_constraints() << " constraints" << std::endl;
     std::cout << "\t" << (pb.num_constraints() / float(in_bits.size())) << " constraints per bit" << std::endl;
 
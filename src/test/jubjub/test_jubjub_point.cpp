@@ -1,8 +1,14 @@
 #include "jubjub/point.hpp"
+#include "jubjub/basepoints.hpp"
+
+#include <cstdio>
 
 
 using ethsnarks::FieldT;
 using ethsnarks::jubjub::EdwardsPoint;
+using ethsnarks::jubjub::EdwardsPointExt;
+using ethsnarks::jubjub::MontgomeryPoint;
+using ethsnarks::jubjub::MontgomeryPointProj;
 
 namespace ethsnarks {
 
@@ -167,6 +173,175 @@ bool testcases_basepoint()
 }
 
 
+/**
+* The baked in basepoints are the ones derived from the hash, and repeated
+* requests return the same cached point
+*/
+static bool testcases_basepoint_table()
+{
+    const ethsnarks::jubjub::Params params;
+
+    for( size_t i = 0; i < ethsnarks::jubjub::BASEPOINT_TABLE_COUNT; i++ )
+    {
+        const auto& entry = ethsnarks::jubjub::BASEPOINT_TABLE[i];
+
+        char data[33];
+        ::sprintf(data, "%-28s%04X", entry.name, entry.sequence);
+        const auto expected = EdwardsPoint::from_hash(data, 32, params);
+
+        for( int j = 0; j < 2; j++ )
+        {
+            const auto p = EdwardsPoint::make_basepoint(entry.name, entry.sequence, params);
+            if( p.x != expected.x || p.y != expected.y ) {
+                std::cerr << "FAIL testcases_basepoint_table " << entry.name << " " << entry.sequence << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/**
+* Chains in extended coordinates match the affine ones
+*/
+static bool testcases_extended()
+{
+    const ethsnarks::jubjub::Params params;
+    const EdwardsPoint G(params.Gx, params.Gy);
+
+    std::vector<EdwardsPoint> expected;
+    std::vector<EdwardsPointExt> points;
+    EdwardsPoint affine = G;
+    EdwardsPointExt extended = G.as_extended();
+    for( int i = 0; i < 16; i++ )
+    {
+        // Alternate doubling and adding the base, through infinity and negation
+        if( i % 2 ) {
+            affine = affine.dbl(params);
+            extended = extended.dbl(params);
+        }
+        else {
+            affine = affine.add(G, params).add(G.infinity(), params);
+            extended = extended.add(G.as_extended(), params).add(EdwardsPointExt::infinity(), params);
+        }
+        expected.push_back(affine);
+        points.push_back(extended);
+
+        const auto cancelled = extended.add(extended.neg(), params).as_affine();
+        if( cancelled.x != FieldT::zero() || cancelled.y != FieldT::one() ) {
+            std::cerr << "FAIL testcases_extended neg " << i << std::endl;
+            return false;
+        }
+    }
+
+    const auto batch_affine = EdwardsPointExt::batch_as_affine(points);
+    const auto batch_montgomery = EdwardsPointExt::batch_as_montgomery(points, params);
+    for( size_t i = 0; i < points.size(); i++ )
+    {
+        const auto single = points[i].as_affine();
+        const auto montgomery = expected[i].as_montgomery(params);
+        if( single.x != expected[i].x || single.y != expected[i].y
+         || batch_affine[i].x != expected[i].x || batch_affine[i].y != expected[i].y ) {
+            std::cerr << "FAIL testcases_extended affine " << i << std::endl;
+            return false;
+        }
+
+        if( batch_montgomery[i].x != montgomery.x || batch_montgomery[i].y != montgomery.y ) {
+            std::cerr << "FAIL testcases_extended montgomery " << i << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+* Projective Montgomery chains, and the ladder, match the Edwards ones
+*/
+static bool testcases_montgomery()
+{
+    const ethsnarks::jubjub::Params params;
+    const EdwardsPoint G(params.Gx, params.Gy);
+    const auto M = G.as_montgomery(params);
+
+    // k*G for k = 1 ... 16, and 2^k * G
+    std::vector<EdwardsPointExt> multiples{G.as_extended()};
+    std::vector<EdwardsPointExt> doublings{G.as_extended()};
+    for( int i = 1; i < 16; i++ ) {
+        multiples.push_back(multiples.back().add(G.as_extended(), params));
+        doublings.push_back(doublings.back().dbl(params));
+    }
+    const auto expected = EdwardsPointExt::batch_as_montgomery(multiples, params);
+    const auto expected_dbl = EdwardsPointExt::batch_as_montgomery(doublings, params);
+
+    std::vector<MontgomeryPointProj> sums{M.as_projective()};
+    std::vector<MontgomeryPointProj> dbls{M.as_projective()};
+    for( int i = 1; i < 16; i++ ) {
+        sums.push_back(sums.back().add(M.as_projective(), params).add(MontgomeryPointProj::infinity(), params));
+        dbls.push_back(dbls.back().dbl(params));
+    }
+    const auto affine = MontgomeryPointProj::batch_as_affine(sums);
+    const auto affine_dbl = MontgomeryPointProj::batch_as_affine(dbls);
+
+    for( size_t i = 0; i < sums.size(); i++ )
+    {
+        if( affine[i].x != expected[i].x || affine[i].y != expected[i].y
+         || affine_dbl[i].x != expected_dbl[i].x || affine_dbl[i].y != expected_dbl[i].y ) {
+            std::cerr << "FAIL testcases_montgomery chain " << i << std::endl;
+            return false;
+        }
+
+        const auto single = sums[i].as_affine();
+        if( single.x != expected[i].x || single.y != expected[i].y ) {
+            std::cerr << "FAIL testcases_montgomery affine " << i << std::endl;
+            return false;
+        }
+
+        // Adding a point to itself doubles it, and to its negation cancels
+        const auto twice = sums[i].add(sums[i], params).as_affine();
+        const auto doubled = sums[i].dbl(params).as_affine();
+        if( twice.x != doubled.x || twice.y != doubled.y || ! sums[i].add(sums[i].neg(), params).is_infinity() ) {
+            std::cerr << "FAIL testcases_montgomery self " << i << std::endl;
+            return false;
+        }
+
+        // The ladder, for k = i + 1
+        libff::bit_vector k;
+        for( size_t j = i + 1; j != 0; j >>= 1 ) {
+            k.push_back(j & 1);
+        }
+        const auto laddered = ethsnarks::jubjub::montgomery_ladder(params, M, k).as_affine();
+        if( laddered.x != expected[i].x || laddered.y != expected[i].y ) {
+            std::cerr << "FAIL testcases_montgomery ladder " << (i + 1) << std::endl;
+            return false;
+        }
+    }
+
+    if( ! ethsnarks::jubjub::montgomery_ladder(params, M, {}).is_infinity() ) {
+        std::cerr << "FAIL testcases_montgomery ladder 0" << std::endl;
+        return false;
+    }
+
+    // A full width scalar, against the Edwards scalar multiplication
+    const auto scalar = ethsnarks::FieldT::random_element().as_bigint();
+    libff::bit_vector bits;
+    for( size_t i = 0; i < ethsnarks::FieldT::size_in_bits(); i++ ) {
+        bits.push_back(scalar.test_bit(i));
+    }
+    const auto product = ethsnarks::jubjub::multi_scalar_mul(params, {G.as_extended()}, {bits}).as_affine().as_montgomery(params);
+    const auto laddered = ethsnarks::jubjub::montgomery_ladder(params, M, bits).as_affine();
+    if( laddered.x != product.x || laddered.y != product.y ) {
+        std::cerr << "FAIL testcases_montgomery ladder random" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
 int main( void )
 {
     ethsnarks::ppT::init_public_params();
@@ -174,6 +349,9 @@ int main( void )
     bool result = testcases_from_y();
     result &= testcases_from_hash();
     result &= testcases_basepoint();
+    result &= testcases_basepoint_table();
+    result &= testcases_extended();
+    result &= testcases_montgomery();
 
     if( result ) {
         std::cout << "OK" << std::endl;
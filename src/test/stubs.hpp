@@ -0,0 +1,82 @@
+#ifndef ETHSNARKS_TEST_STUBS_HPP
+#define ETHSNARKS_TEST_STUBS_HPP
+
+// The tests' own helpers, on top of the library's stubs
+#include "../stubs.hpp"
+#include "gadgets/mimc.hpp"
+
+#include <cstdio>   // snprintf
+#include <cstdlib>  // mkstemp, mkdtemp
+#include <iostream>
+
+#include <unistd.h>
+
+
+namespace ethsnarks {
+
+/** Room for the paths made by make_temp_file and make_temp_dir */
+static const size_t TEMP_PATH_SIZE = 256;
+
+/**
+* Create an empty file for a test to write, as /tmp/<name>.XXXXXX. It's made
+* with mkstemp so, unlike a name from tmpnam, no other process can take it
+* first. The test removes it.
+*/
+inline bool make_temp_file( const char *name, char (&path)[TEMP_PATH_SIZE] )
+{
+    ::snprintf(path, sizeof(path), "/tmp/%s.XXXXXX", name);
+    const int fd = ::mkstemp(path);
+    if( fd < 0 ) {
+        std::cerr << "FAIL mkstemp " << path << std::endl;
+        return false;
+    }
+    ::close(fd);
+    return true;
+}
+
+
+/** As make_temp_file, but an empty directory made with mkdtemp */
+inline bool make_temp_dir( const char *name, char (&path)[TEMP_PATH_SIZE] )
+{
+    ::snprintf(path, sizeof(path), "/tmp/%s.XXXXXX", name);
+    if( ! ::mkdtemp(path) ) {
+        std::cerr << "FAIL mkdtemp " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+static const char MIMC_TEST_MESSAGE[] = "3703141493535563179657531719960160174296085208671919316200479060314459804651";
+static const char MIMC_TEST_IV[] = "918403109389145570117360101535982733651217667914747213867238065296420114726";
+
+/**
+* The circuit most tests prove, the MiMC hash of `num_messages` copies of
+* `message`, which is its one public input. The witness is generated.
+*/
+inline void make_mimc_circuit( ProtoboardT& pb, const FieldT& message = FieldT(MIMC_TEST_MESSAGE), size_t num_messages = 1 )
+{
+    VariableT m_0 = make_variable(pb, message, "m_0");
+    pb.set_input_sizes(1);
+    VariableT iv = make_variable(pb, FieldT(MIMC_TEST_IV), "iv");
+
+    MiMC_e7_hash_gadget the_gadget(pb, iv, std::vector<VariableT>(num_messages, m_0), "gadget");
+    the_gadget.generate_r1cs_witness();
+    the_gadget.generate_r1cs_constraints();
+}
+
+
+/** Prove the protoboard's assignment with a fresh context for `pk`, then verify */
+inline bool prove_and_verify( ProvingKeyT& pk, const VerificationKeyT& vk, ProtoboardT& pb )
+{
+    ProverContextT context(pk);
+    init_prover_context(context, pb);
+    const auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+    return libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(vk, pb.primary_input(), proof);
+}
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_TEST_STUBS_HPP
+#endif
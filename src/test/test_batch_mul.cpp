@@ -0,0 +1,53 @@
+#include "ethsnarks.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_simd.hpp"
+
+using namespace ethsnarks;
+
+
+// Not a multiple of the eight lanes, so the scalar remainder is covered too
+static const size_t N_VALUES = 8 * 40 + 5;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    std::vector<FieldT> a;
+    std::vector<FieldT> b;
+    for( size_t i = 0; i < N_VALUES; i++ ) {
+        a.push_back(FieldT::random_element());
+        b.push_back(FieldT::random_element());
+    }
+
+    // Ends of the range, which the final subtraction has to get right
+    a[0] = FieldT::zero();
+    a[1] = FieldT::one();
+    a[2] = b[2] = FieldT::zero() - FieldT::one();
+    a[3] = b[3] = FieldT::zero() - FieldT(2);
+
+    std::cerr << "Kernel: " << libsnark::batch_mul_kernel() << std::endl;
+
+    std::vector<FieldT> out(N_VALUES);
+    libsnark::batch_mul(out.data(), a.data(), b.data(), N_VALUES);
+    for( size_t i = 0; i < N_VALUES; i++ )
+    {
+        if( out[i] != a[i] * b[i] ) {
+            std::cerr << "FAIL product " << i << std::endl;
+            return 1;
+        }
+    }
+
+    // In place, as the witness map does
+    auto expected = a;
+    for( size_t i = 0; i < N_VALUES; i++ ) {
+        expected[i] *= b[i];
+    }
+    libsnark::batch_mul(a.data(), a.data(), b.data(), N_VALUES);
+    if( a != expected ) {
+        std::cerr << "FAIL in place" << std::endl;
+        return 2;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "prover_profile.hpp"
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+#include <cstdlib>  // setenv
+#include <fstream>
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    char profiles_file[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_config_profiles", profiles_file) ) {
+        return 1;
+    }
+
+    std::ofstream(profiles_file) << R"({
+        "default": {"num_threads": 3, "multi_exp_c": 10},
+        "domain_size": {"1024": {"fft": "basic_radix2", "multi_exp_c": 12}},
+        "circuits": {"transfer": {"multi_exp_c": 14, "radixes": [4, 2]}}
+    })";
+
+    // The circuit is more specific than the domain size, which is more than the default
+    libsnark::Config config;
+    if( ! load_config_profiles(profiles_file, "transfer", 1024, config)
+     || config.num_threads != 3 || config.fft != "basic_radix2" || config.multi_exp_c != 14 || config.radixes.size() != 2 ) {
+        std::cerr << "FAIL circuit profile" << std::endl;
+        ::remove(profiles_file);
+        return 2;
+    }
+
+    libsnark::Config other;
+    if( ! load_config_profiles(profiles_file, "other", 2048, other)
+     || other.num_threads != 3 || other.fft != libsnark::Config().fft || other.multi_exp_c != 10 ) {
+        std::cerr << "FAIL default profile" << std::endl;
+        ::remove(profiles_file);
+        return 3;
+    }
+
+    // The inline config is applied after the profiles file
+    ::setenv("ETHSNARKS_PROVER_PROFILES", profiles_file, 1);
+    ::setenv("ETHSNARKS_PROVER_CONFIG", R"({"multi_exp_c": 16})", 1);
+    libsnark::Config from_env;
+    config_from_env("transfer", 1024, from_env);
+    ::remove(profiles_file);
+    if( from_env.fft != "basic_radix2" || from_env.multi_exp_c != 16 ) {
+        std::cerr << "FAIL environment" << std::endl;
+        return 4;
+    }
+
+    if( circuit_name_from_path("/keys/transfer.arith") != "transfer" || circuit_name_from_path("transfer") != "transfer" ) {
+        std::cerr << "FAIL circuit_name_from_path" << std::endl;
+        return 5;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "cs_check.hpp"
+#include "stubs.hpp"
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    const auto& cs = pb.constraint_system;
+    if( ! cs_check_protoboard(pb) || cs_first_unsatisfied(cs, pb.values) != cs.num_constraints() ) {
+        std::cerr << "FAIL satisfied witness rejected" << std::endl;
+        return 1;
+    }
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(cs);
+    auto pk = ProvingKeyT(keypair.pk);
+    ProverContextT context(pk);
+    init_prover_context(context, pb);
+    context.check_satisfied = true;
+    libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+
+    // Corrupt a variable half way through the witness
+    const auto satisfied_values = pb.values;
+    pb.values[pb.values.size() / 2] += FieldT::one();
+    const size_t failed = cs_first_unsatisfied(cs, pb.values);
+    if( pb.is_satisfied() || cs_check_protoboard(pb) || failed == cs.num_constraints() || failed != cs_first_unsatisfied(cs, pb.values, 1) ) {
+        std::cerr << "FAIL unsatisfied witness accepted" << std::endl;
+        return 2;
+    }
+
+    for( size_t i = 0; i < failed; i++ ) {
+        const auto& constraint = *cs.constraints[i];
+        if( cs_evaluate_lc(constraint.getA(), pb.values) * cs_evaluate_lc(constraint.getB(), pb.values) != cs_evaluate_lc(constraint.getC(), pb.values) ) {
+            std::cerr << "FAIL constraint " << i << " fails before " << failed << std::endl;
+            return 3;
+        }
+    }
+
+    // The prover finds the same constraint as it evaluates them
+    try {
+        libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+        std::cerr << "FAIL prover didn't check the witness" << std::endl;
+        return 4;
+    }
+    catch( const libsnark::r1cs_gg_ppzksnark_zok_unsatisfied& ex ) {
+        if( ex.constraint != failed ) {
+            std::cerr << "FAIL prover reported constraint " << ex.constraint << " rather than " << failed << std::endl;
+            return 5;
+        }
+    }
+
+    // So does the batch prover, whether the witness is the first, or the
+    // next one which is mapped while a proof is evaluated, and the caller's
+    // progress callback is put back
+    for( size_t bad = 0; bad < 2; bad++ )
+    {
+        std::vector<std::vector<FieldT>> batch(3, satisfied_values);
+        batch[bad] = pb.values;
+        context.progress = [](const char*) {};
+        try {
+            libsnark::r1cs_gg_ppzksnark_zok_prover_batch<ppT>(context, batch);
+            std::cerr << "FAIL batch prover didn't check witness " << bad << std::endl;
+            return 6;
+        }
+        catch( const libsnark::r1cs_gg_ppzksnark_zok_unsatisfied& ex ) {
+            if( ex.constraint != failed || ! context.progress ) {
+                std::cerr << "FAIL batch prover reported constraint " << ex.constraint << " rather than " << failed << std::endl;
+                return 7;
+            }
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "cs_memory.hpp"
+#include "stubs.hpp"
+
+#include <sstream>
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    CSMemoryReport report;
+    cs_memory_protoboard(pb, report);
+
+    if( report.constraints != pb.num_constraints()
+     || report.variables != pb.num_variables()
+     || report.inputs != pb.num_inputs()
+     || report.terms < report.constraints
+     || report.constraint_bytes == 0
+     || report.value_bytes < pb.num_variables() * sizeof(FieldT) ) {
+        std::cerr << "FAIL constraint system" << std::endl;
+        return 1;
+    }
+
+#ifdef DEBUG
+    if( report.annotation_bytes == 0 ) {
+        std::cerr << "FAIL annotations" << std::endl;
+        return 2;
+    }
+#endif
+
+    const size_t m = cs_memory_domain_size(report);
+    if( (m & (m - 1)) != 0 || m < report.constraints + report.inputs + 1 || (m / 2) >= report.constraints + report.inputs + 1 ) {
+        std::cerr << "FAIL domain size " << m << std::endl;
+        return 3;
+    }
+
+    cs_memory_project(report);
+    const auto projected = report;
+    if( projected.domain_size != m || projected.pk_G1 == 0 || projected.context_bytes() == 0 || projected.context_fixed_base_bytes != 0 ) {
+        std::cerr << "FAIL projection" << std::endl;
+        return 4;
+    }
+
+    cs_memory_project(report, 0, 8);
+    if( report.context_fixed_base_bytes == 0 || report.total_bytes() <= projected.total_bytes() ) {
+        std::cerr << "FAIL fixed base tables" << std::endl;
+        return 5;
+    }
+
+    // The actual key is no larger than projected, its queries are sparse
+    // and the domain may be smaller than a power of two
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    const auto pk = ProvingKeyT(keypair.pk);
+    cs_memory_proving_key(pk, report);
+    if( report.pk_G1 > projected.pk_G1
+     || report.pk_G2 > projected.pk_G2
+     || report.pk_file_bytes == 0
+     || report.pk_G1 < 3 + pk.H_query.size() + pk.L_query.size() ) {
+        std::cerr << "FAIL proving key " << report.pk_G1 << " G1, projected " << projected.pk_G1 << std::endl;
+        return 6;
+    }
+
+    std::stringstream out;
+    cs_memory_json(report, out);
+    const auto parsed = nlohmann::json::parse(out.str());
+    if( parsed["constraints"] != report.constraints || parsed["proving_key"]["G1"] != report.pk_G1 ) {
+        std::cerr << "FAIL json" << std::endl;
+        return 7;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
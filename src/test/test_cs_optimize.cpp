@@ -0,0 +1,152 @@
+#include "cs_optimize.hpp"
+#include "gadgets/sha256_full.hpp"
+#include "utils.hpp"
+
+using namespace ethsnarks;
+
+
+static bool is_satisfied( const ConstraintSystemT& cs, const std::vector<FieldT>& values )
+{
+    const PrimaryInputT primary(values.begin(), values.begin() + cs.primary_input_size);
+    const AuxiliaryInputT auxiliary(values.begin() + cs.primary_input_size, values.end());
+    return cs.is_satisfied(primary, auxiliary);
+}
+
+
+/**
+* True if the auxiliary variables used in the A side of the constraints are
+* one range starting after the primary inputs, and those in B another range
+*/
+static bool query_ranges_contiguous( const ConstraintSystemT& cs )
+{
+    const size_t n = cs.num_variables() + 1;
+    std::vector<bool> in_a(n, false);
+    std::vector<bool> in_b(n, false);
+    for( const auto& constraint : cs.constraints )
+    {
+        for( const auto& term : constraint->getA().getTerms() ) { in_a[term.index] = true; }
+        for( const auto& term : constraint->getB().getTerms() ) { in_b[term.index] = true; }
+    }
+
+    const auto is_range = [&]( const std::vector<bool>& used, bool from_start ) {
+        size_t changes = 0;
+        bool previous = from_start;
+        for( size_t i = cs.primary_input_size + 1; i < n; i++ ) {
+            changes += used[i] != previous;
+            previous = used[i];
+        }
+        return changes <= (from_start ? 1 : 2);
+    };
+    return is_range(in_a, true) && is_range(in_b, false);
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    VariableT x = make_variable(pb, FieldT(3), "x");
+    pb.set_input_sizes(1);
+    VariableT y = make_variable(pb, FieldT(4), "y");
+    VariableT z = make_variable(pb, FieldT(16), "z");
+    VariableT u = make_variable(pb, FieldT(16), "u");
+    VariableT w = make_variable(pb, FieldT(1), "w");
+    VariableT secret = make_variable(pb, FieldT(3), "secret");
+
+    pb.add_r1cs_constraint(ConstraintT(1, x + 1, y), "alias, y = x + 1");
+    pb.add_r1cs_constraint(ConstraintT(y, y, z), "z = y * y");
+    pb.add_r1cs_constraint(ConstraintT(y, y, z), "duplicate");
+    pb.add_r1cs_constraint(ConstraintT(z, 1, u), "unused alias, u = z");
+    pb.add_r1cs_constraint(ConstraintT(w, w, w), "private range check");
+    pb.add_r1cs_constraint(ConstraintT(secret, secret, 9), "private assertion");
+
+    if( ! pb.is_satisfied() ) {
+        std::cerr << "FAIL original not satisfied" << std::endl;
+        return 1;
+    }
+
+    // Once u is substituted z is a dead definition, only the two assertions
+    // over private variables remain
+    ConstraintSystemT cs;
+    CSRemap remap;
+    cs_optimize(pb.constraint_system, cs, remap);
+
+    if( cs.num_constraints() != 2 || remap.num_variables != 3 || remap.removed_constraints != 4 || remap.removed_variables != 3
+     || remap.index[x.index] != 1 || remap.index[w.index] != 2 || remap.index[secret.index] != 3
+     || remap.index[y.index] != CS_REMOVED || remap.index[z.index] != CS_REMOVED ) {
+        std::cerr << "FAIL unexpected layout, " << cs.num_constraints() << " constraints, " << remap.num_variables << " variables" << std::endl;
+        return 2;
+    }
+
+    std::vector<FieldT> values;
+    cs_remap_assignment(remap, pb.full_variable_assignment(), values);
+    if( ! is_satisfied(cs, values) ) {
+        std::cerr << "FAIL optimized not satisfied" << std::endl;
+        return 3;
+    }
+
+    // The assertions are still enforced
+    values[2] = FieldT(2);
+    if( is_satisfied(cs, values) ) {
+        std::cerr << "FAIL bad range check satisfied" << std::endl;
+        return 4;
+    }
+    values[2] = FieldT(1);
+    values[3] = FieldT(4);
+    if( is_satisfied(cs, values) ) {
+        std::cerr << "FAIL bad private assertion satisfied" << std::endl;
+        return 4;
+    }
+
+    // Keeping dead definitions, z = (x + 1) * (x + 1) stays
+    CSOptimizeOptions options;
+    options.dead_definitions = false;
+    cs_optimize(pb.constraint_system, cs, remap, options);
+    cs_remap_assignment(remap, pb.full_variable_assignment(), values);
+    if( cs.num_constraints() != 3 || remap.num_variables != 4 || remap.index[z.index] == CS_REMOVED || ! is_satisfied(cs, values) ) {
+        std::cerr << "FAIL unexpected layout keeping dead definitions" << std::endl;
+        return 5;
+    }
+
+    // The second compression of SHA256 is over a constant padding block,
+    // its message schedule is folded away
+    ProtoboardT sha_pb;
+    libsnark::digest_variable<FieldT> digest(sha_pb, libsnark::SHA256_digest_size, "digest");
+    sha_pb.set_input_sizes(libsnark::SHA256_digest_size);
+    libsnark::block_variable<FieldT> block(sha_pb, libsnark::SHA256_block_size, "block");
+    sha256_full_gadget_512 hasher(sha_pb, block, digest, "hasher");
+    hasher.generate_r1cs_constraints();
+    block.generate_r1cs_witness(libff::bit_vector(libsnark::SHA256_block_size, true));
+    hasher.generate_r1cs_witness();
+
+    ConstraintSystemT unfolded;
+    options = CSOptimizeOptions();
+    options.fold_constants = false;
+    cs_optimize(sha_pb.constraint_system, unfolded, remap, options);
+
+    cs_optimize(sha_pb.constraint_system, cs, remap);
+    cs_remap_assignment(remap, sha_pb.full_variable_assignment(), values);
+    if( cs.num_constraints() >= unfolded.num_constraints() || ! is_satisfied(cs, values) ) {
+        std::cerr << "FAIL constants not folded, " << cs.num_constraints() << " of " << unfolded.num_constraints() << " constraints remain" << std::endl;
+        return 6;
+    }
+
+    // Reordering keeps every constraint, the variables of the A query come
+    // first and those of the B query are one range overlapping its end
+    ConstraintSystemT reordered;
+    cs_reorder(sha_pb.constraint_system, reordered, remap);
+    cs_remap_assignment(remap, sha_pb.full_variable_assignment(), values);
+    if( reordered.num_constraints() != sha_pb.num_constraints() || remap.num_variables != sha_pb.num_variables() || ! is_satisfied(reordered, values) ) {
+        std::cerr << "FAIL reordered not satisfied" << std::endl;
+        return 7;
+    }
+
+    if( ! query_ranges_contiguous(reordered) ) {
+        std::cerr << "FAIL reordered queries aren't contiguous" << std::endl;
+        return 8;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "cs_profile.hpp"
+#include "utils.hpp"
+
+#include <sstream>
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    VariableT x = make_variable(pb, FieldT(3), "x");
+    pb.set_input_sizes(1);
+    VariableT y = make_variable(pb, FieldT(9), "square.y");
+    VariableT z = make_variable(pb, FieldT(12), "sum.z");
+
+    pb.add_r1cs_constraint(ConstraintT(x, x, y), "square.mul");
+    pb.add_r1cs_constraint(ConstraintT(1, x + y, z), "sum.add");
+    pb.add_r1cs_constraint(ConstraintT(x, 4, z), "sum.check");
+
+    CSProfile profile;
+    cs_profile_annotations(pb.constraint_system, 1, profile);
+
+    size_t constraints = 0, variables = 0, terms = 0;
+    for( const auto& it : profile ) {
+        constraints += it.second.constraints;
+        variables += it.second.variables;
+        terms += it.second.terms;
+    }
+
+    // x*x=y has 3 terms, 1*(x+y)=z has 4, x*4=z has 3
+    if( constraints != 3 || variables != 3 || terms != 10 ) {
+        std::cerr << "FAIL totals " << constraints << " " << variables << " " << terms << std::endl;
+        return 1;
+    }
+
+#ifdef DEBUG
+    if( profile["square"].constraints != 1 || profile["sum"].constraints != 2 || profile["sum"].terms != 7 || profile["sum"].variables != 1 ) {
+        std::cerr << "FAIL annotation prefixes" << std::endl;
+        return 2;
+    }
+#endif
+
+    std::stringstream folded;
+    cs_profile_folded(profile, folded);
+    if( folded.str().empty() ) {
+        std::cerr << "FAIL folded output" << std::endl;
+        return 3;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
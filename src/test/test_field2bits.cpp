@@ -1,6 +1,8 @@
 #include "gadgets/field2bits_strict.hpp"
 #include "utils.hpp"
 
+#include <libff/algebra/fields/field_utils.hpp>
+
 
 namespace ethsnarks
 {
@@ -45,6 +47,55 @@ bool testcases_field2bits( void )
 }
 
 
+bool testcases_field2bits_batch( void )
+{
+	ProtoboardT pb;
+	const std::vector<FieldT> values = {FieldT::zero(), FieldT::one(), FieldT::zero() - FieldT::one(), FieldT("12345678901234567890")};
+	const auto vars = make_var_array(pb, "vars", values);
+
+	field2bits_strict_batch the_gadget(pb, vars, "the_gadget");
+	the_gadget.generate_r1cs_constraints();
+	the_gadget.generate_r1cs_witness();
+
+	if( ! pb.is_satisfied() ) {
+		std::cerr << "Batch not satisfied" << std::endl;
+		return false;
+	}
+
+	for( size_t i = 0; i < values.size(); i++ )
+	{
+		if( the_gadget.result(i).get_bits(pb) != libff::convert_field_element_to_bit_vector(values[i], FieldT::size_in_bits()) ) {
+			std::cerr << "Batch bits " << i << " mismatch" << std::endl;
+			return false;
+		}
+	}
+
+	// One constraint per bit saved, compared to field2bits_strict
+	ProtoboardT pb_single;
+	const auto var = make_variable(pb_single, FieldT::one(), "var");
+	field2bits_strict single(pb_single, var, "single");
+	single.generate_r1cs_constraints();
+	if( pb.num_constraints() >= values.size() * pb_single.num_constraints() ) {
+		std::cerr << "Batch uses " << pb.num_constraints() << " constraints, singles use " << (values.size() * pb_single.num_constraints()) << std::endl;
+		return false;
+	}
+
+	// The bits of `0 + q` pack to 0, but aren't less than the modulus
+	libff::bit_vector modulus_bits(FieldT::size_in_bits());
+	for( size_t i = 0; i < modulus_bits.size(); i++ ) {
+		modulus_bits[i] = FieldT::mod.test_bit(i);
+	}
+	the_gadget.result(0).fill_with_bits(pb, modulus_bits);
+	the_gadget.generate_r1cs_witness_from_bits();
+	if( pb.is_satisfied() ) {
+		std::cerr << "Bits of the modulus accepted" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
 // namespace ethsnarks
 }
 
@@ -60,6 +111,12 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if( ! ethsnarks::testcases_field2bits_batch() )
+    {
+        std::cerr << "FAIL" << std::endl;
+        return 2;
+    }
+
     std::cout << "OK\n";
     return 0;
 }
@@ -0,0 +1,61 @@
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+
+using namespace ethsnarks;
+
+
+/** Prove with the fixed-base tables, cached in `path`, then verify */
+static bool prove_with_tables( ProvingKeyT& pk, const VerificationKeyT& vk, ProtoboardT& pb, const char *path )
+{
+    libsnark::Config config;
+    config.fixed_base_c = 4;
+
+    ProverContextT context(pk);
+    init_prover_context(context, pb, config, path);
+    if( context.H_fixed.num_bases != pk.H_query.size() || context.L_fixed.num_bases != pk.L_query.size() ) {
+        std::cerr << "FAIL tables weren't built" << std::endl;
+        return false;
+    }
+
+    const auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+    return libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(vk, pb.primary_input(), proof);
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto other_keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    ProvingKeyT pk(keypair.pk), other_pk(other_keypair.pk);
+
+    char path[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_fixed_base_cache", path) ) {
+        return 1;
+    }
+
+    // Built and written, then read back for the same key
+    if( ! prove_with_tables(pk, keypair.vk, pb, path) || ! prove_with_tables(pk, keypair.vk, pb, path) ) {
+        std::cerr << "FAIL proof with cached tables" << std::endl;
+        ::remove(path);
+        return 2;
+    }
+
+    // Another key for the same circuit has the same sizes, but not the same
+    // bases, so the cached tables aren't used for it
+    if( ! prove_with_tables(other_pk, other_keypair.vk, pb, path) ) {
+        std::cerr << "FAIL proof used the tables of another key" << std::endl;
+        ::remove(path);
+        return 3;
+    }
+
+    ::remove(path);
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
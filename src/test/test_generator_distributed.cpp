@@ -0,0 +1,118 @@
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+#include <fstream>
+#include <sstream>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ethsnarks;
+
+
+static const size_t SEGMENT_SIZE = 16;
+static const size_t NUM_WORKERS = 3;
+
+
+static void remove_dir( const std::string& path )
+{
+    DIR *dir = ::opendir(path.c_str());
+    if( dir ) {
+        while( const struct dirent *entry = ::readdir(dir) ) {
+            const std::string name(entry->d_name);
+            if( name != "." && name != ".." ) {
+                ::remove((path + "/" + name).c_str());
+            }
+        }
+        ::closedir(dir);
+    }
+    ::rmdir(path.c_str());
+}
+
+
+static bool test_generator_distributed( const std::string& setup_dir )
+{
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_generator_prepare<ppT>(pb.constraint_system, setup_dir, SEGMENT_SIZE) ) {
+        std::cerr << "FAIL prepare" << std::endl;
+        return false;
+    }
+
+    // The secrets are the owner's alone
+    struct stat st;
+    if( 0 != ::stat((setup_dir + "/secrets").c_str(), &st) || (st.st_mode & 0777) != 0600
+     || 0 != ::stat((setup_dir + "/H_query.scalars").c_str(), &st) || (st.st_mode & 0777) != 0600 ) {
+        std::cerr << "FAIL secrets mode" << std::endl;
+        return false;
+    }
+
+    // Resuming with other segments would mix them
+    if( libsnark::r1cs_gg_ppzksnark_zok_generator_prepare<ppT>(pb.constraint_system, setup_dir, SEGMENT_SIZE * 2) ) {
+        std::cerr << "FAIL resumed with another segment size" << std::endl;
+        return false;
+    }
+
+    // The last worker doesn't run, the assembler computes its segments
+    for( size_t i = 0; i < NUM_WORKERS - 1; i++ ) {
+        if( ! libsnark::r1cs_gg_ppzksnark_zok_generator_worker<ppT>(setup_dir, i, NUM_WORKERS) ) {
+            std::cerr << "FAIL worker " << i << std::endl;
+            return false;
+        }
+    }
+
+    if( ! std::ifstream(setup_dir + "/L_query.1").is_open()
+     || std::ifstream(setup_dir + "/L_query.2").is_open() ) {
+        std::cerr << "FAIL workers computed the wrong segments" << std::endl;
+        return false;
+    }
+
+    size_t segment_size;
+    bool lagrange_H;
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_generator_read_params(setup_dir, segment_size, lagrange_H)
+     || segment_size != SEGMENT_SIZE || lagrange_H ) {
+        std::cerr << "FAIL params" << std::endl;
+        return false;
+    }
+
+    std::stringstream pk_stream;
+    const auto vk = libsnark::r1cs_gg_ppzksnark_zok_generator_nozk<ppT>(pb.constraint_system, pk_stream, setup_dir, segment_size, lagrange_H);
+
+    if( std::ifstream(setup_dir + "/secrets").is_open() ) {
+        std::cerr << "FAIL secrets kept after the key was written" << std::endl;
+        return false;
+    }
+
+    ProvingKeyT pk;
+    pk_stream >> pk;
+
+    if( ! prove_and_verify(pk, vk, pb) ) {
+        std::cerr << "FAIL assembled key doesn't verify" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    char setup_dir[TEMP_PATH_SIZE];
+    if( ! make_temp_dir("test_generator_distributed", setup_dir) ) {
+        return 1;
+    }
+
+    const bool ok = test_generator_distributed(setup_dir);
+    remove_dir(setup_dir);
+
+    if( ! ok ) {
+        return 2;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
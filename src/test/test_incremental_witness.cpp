@@ -0,0 +1,124 @@
+#include "gadgets/mimc.hpp"
+#include "gadgets/incremental_witness.hpp"
+#include "prover_incremental.hpp"
+#include "stubs.hpp"
+
+using namespace ethsnarks;
+
+
+static const size_t N_LEAVES = 8;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    incremental_witness witness(pb);
+
+    std::vector<VariableT> messages;
+    for( size_t i = 0; i < N_LEAVES; i++ ) {
+        messages.push_back(make_variable(pb, FieldT(long(i + 1)), FMT("message", "[%zu]", i)));
+    }
+    pb.set_input_sizes(N_LEAVES);
+    VariableT iv = make_variable(pb, FieldT(MIMC_TEST_IV), "iv");
+
+    // A binary tree of hashes over the hash of each message, the gadgets
+    // are reserved as the witness refers to them
+    std::vector<MiMC_e7_hash_gadget> hashes;
+    hashes.reserve(2 * N_LEAVES - 1);
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for( size_t i = 0; i < 2 * N_LEAVES - 1; i++ )
+    {
+        const size_t first = witness.next_variable();
+        std::vector<VariableT> inputs;
+        if( i < N_LEAVES ) {
+            inputs = {messages[i]};
+        }
+        else {
+            const size_t child = 2 * (i - N_LEAVES);
+            inputs = {hashes[child].result(), hashes[child + 1].result()};
+        }
+        hashes.emplace_back(pb, iv, inputs, FMT("hash", "[%zu]", i));
+
+        inputs.push_back(iv);
+        witness.add(hashes.back(), inputs, first);
+        ranges.emplace_back(first, witness.next_variable());
+    }
+
+    for( auto& hash : hashes ) {
+        hash.generate_r1cs_constraints();
+    }
+
+    witness.run();
+    if( ! pb.is_satisfied() ) {
+        std::cerr << "FAIL full witness not satisfied" << std::endl;
+        return 1;
+    }
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto pk = ProvingKeyT(keypair.pk);
+    ProverContextT context(pk);
+    init_prover_context(context, pb);
+
+    // A third of the variables change, which is too many for the default
+    IncrementalProver prover(context, 2);
+    prover.prove(pb.values, {});
+
+    const size_t leaf = 5;
+    for( long value : {5678, 91011} )
+    {
+        // Only the leaf and its path to the root are recomputed
+        pb.val(messages[leaf]) = FieldT(value);
+        const auto changed = witness.update();
+        if( witness.num_recomputed() != 4 ) {
+            std::cerr << "FAIL recomputed " << witness.num_recomputed() << " gadgets" << std::endl;
+            return 2;
+        }
+
+        if( changed.empty() || changed[0] != messages[leaf].index ) {
+            std::cerr << "FAIL changed input not reported" << std::endl;
+            return 3;
+        }
+
+        for( size_t i : changed ) {
+            if( i >= ranges[leaf ^ 1].first && i < ranges[leaf ^ 1].second ) {
+                std::cerr << "FAIL sibling reported as changed" << std::endl;
+                return 4;
+            }
+        }
+
+        if( ! pb.is_satisfied() ) {
+            std::cerr << "FAIL incremental witness not satisfied" << std::endl;
+            return 5;
+        }
+
+        // Against the witness and proof computed from scratch
+        const auto incremental_proof = prover.prove(pb.values, changed);
+        if( ! prover.was_incremental() ) {
+            std::cerr << "FAIL proof wasn't incremental" << std::endl;
+            return 6;
+        }
+
+        const auto incremental_values = pb.values;
+        witness.run();
+        if( pb.values != incremental_values ) {
+            std::cerr << "FAIL incremental witness differs" << std::endl;
+            return 7;
+        }
+
+        const auto expected = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+        if( incremental_proof.g_A != expected.g_A || incremental_proof.g_B != expected.g_B || incremental_proof.g_C != expected.g_C ) {
+            std::cerr << "FAIL incremental proof differs" << std::endl;
+            return 8;
+        }
+
+        if( ! libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(keypair.vk, pb.primary_input(), incremental_proof) ) {
+            std::cerr << "FAIL incremental proof doesn't verify" << std::endl;
+            return 9;
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "stubs.hpp"
+#include "gadgets/mimc.hpp"
+
+#include <thread>
+
+using namespace ethsnarks;
+
+
+static const size_t N_THREADS = 8;
+
+
+int main( void )
+{
+    // Racing initialisations must run each step exactly once
+    std::vector<std::thread> threads;
+    for( size_t i = 0; i < N_THREADS; i++ ) {
+        threads.emplace_back([i](){ stub_init_public_params(i % 2 == 0); });
+    }
+    for( auto& thread : threads ) {
+        thread.join();
+    }
+
+    const auto cost = stub_startup_cost();
+    if( cost.curve_seconds <= 0 || cost.tables_seconds <= 0 ) {
+        std::cerr << "FAIL startup cost not recorded" << std::endl;
+        return 1;
+    }
+
+    // Calling it again is free, and doesn't redo either step
+    stub_init_public_params(true);
+    const auto again = stub_startup_cost();
+    if( again.curve_seconds != cost.curve_seconds || again.tables_seconds != cost.tables_seconds ) {
+        std::cerr << "FAIL initialised twice" << std::endl;
+        return 2;
+    }
+
+    if( MiMC_e7_gadget::static_constants() != MiMC_e7_gadget::constants() ) {
+        std::cerr << "FAIL warmed up constants differ" << std::endl;
+        return 3;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
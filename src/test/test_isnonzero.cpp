@@ -24,6 +24,33 @@ bool test_zerop(FieldT value, FieldT expected_result)
 }
 
 
+bool test_zerop_batch()
+{
+    ProtoboardT pb;
+    std::vector<FieldT> values = {FieldT::zero(), FieldT::one(), FieldT::random_element(), FieldT::zero(), FieldT::zero() - FieldT::one()};
+
+    std::vector<IsNonZero> gadgets;
+    gadgets.reserve(values.size());
+    for( size_t i = 0; i < values.size(); i++ ) {
+        gadgets.emplace_back(pb, make_variable(pb, values[i], FMT("X", "[%zu]", i)), FMT("ZeroP", "[%zu]", i));
+        gadgets.back().generate_r1cs_constraints();
+    }
+
+    generate_r1cs_witness_batch(gadgets);
+
+    for( size_t i = 0; i < values.size(); i++ )
+    {
+        const auto expected = values[i].is_zero() ? FieldT::zero() : FieldT::one();
+        if( pb.val(gadgets[i].result()) != expected ) {
+            std::cerr << "Batch result " << i << " not expected result" << std::endl;
+            return false;
+        }
+    }
+
+    return pb.is_satisfied();
+}
+
+
 int main( void )
 {
     ppT::init_public_params();
@@ -43,6 +70,11 @@ int main( void )
         return 1;
     }
 
+    if( ! test_zerop_batch() ) {
+        std::cerr << "ZeroP batch failed" << std::endl;
+        return 1;
+    }
+
     std::cout << "OK" << std::endl;
     return 0;
 }
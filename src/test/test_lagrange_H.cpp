@@ -0,0 +1,31 @@
+#include "stubs.hpp"
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system, true);
+    auto pk = ProvingKeyT(keypair.pk);
+
+    ProverContextT context(pk);
+    init_prover_context(context, pb);
+    if( ! context.lagrange_H || pk.H_query.size() != context.domain->m ) {
+        std::cerr << "FAIL H query isn't in the Lagrange basis" << std::endl;
+        return 1;
+    }
+
+    const auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(keypair.vk, pb.primary_input(), proof) ) {
+        std::cerr << "FAIL" << std::endl;
+        return 2;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
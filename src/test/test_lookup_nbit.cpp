@@ -0,0 +1,194 @@
+#include "ethsnarks.hpp"
+#include "utils.hpp"
+#include "stubs.hpp"
+#include "gadgets/lookup_nbit.hpp"
+#include "gadgets/lookup_3bit.hpp"
+#include "gadgets/lookup_signed_3bit.hpp"
+
+namespace ethsnarks {
+
+
+template<size_t N, bool Signed>
+bool test_lookup_Nbit()
+{
+    typedef lookup_Nbit_gadget<N, Signed> LookupT;
+
+    std::vector<FieldT> constants;
+    for( size_t i = 0; i < LookupT::N_CONSTANTS; i++ ) {
+        constants.push_back(FieldT::random_element());
+    }
+
+    for( size_t i = 0; i < (size_t(1) << N); i++ )
+    {
+        ProtoboardT pb;
+        VariableArrayT bits;
+        bits.allocate(pb, N, "bits");
+        bits.fill_with_bits_of_ulong(pb, i);
+
+        LookupT the_gadget(pb, constants, bits, "the_gadget");
+        the_gadget.generate_r1cs_constraints();
+        the_gadget.generate_r1cs_witness();
+
+        if( pb.num_constraints() != LookupT::N_CONSTRAINTS ) {
+            std::cerr << N << " bits, " << pb.num_constraints() << " constraints, expected " << LookupT::N_CONSTRAINTS << std::endl;
+            return false;
+        }
+
+        const FieldT& value = constants[i % LookupT::N_CONSTANTS];
+        const FieldT expected = (Signed && (i >> (N - 1))) ? -value : value;
+        if( pb.val(the_gadget.result()) != expected ) {
+            std::cerr << N << " bits, wrong result for " << i << std::endl;
+            return false;
+        }
+
+        if( ! pb.is_satisfied() ) {
+            std::cerr << N << " bits, not satisfied for " << i << std::endl;
+            return false;
+        }
+
+        // Any other result is rejected
+        pb.val(the_gadget.result()) = expected + FieldT::one();
+        if( pb.is_satisfied() ) {
+            std::cerr << N << " bits, wrong result accepted for " << i << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+* The same constants, bits and result as lookup_signed_3bit_gadget, with
+* fewer constraints than lookup_3bit_gadget
+*/
+bool test_lookup_Nbit_compatible()
+{
+    const std::vector<FieldT> constants = {
+        FieldT::random_element(), FieldT::random_element(),
+        FieldT::random_element(), FieldT::random_element(),
+        FieldT::random_element(), FieldT::random_element(),
+        FieldT::random_element(), FieldT::random_element()
+    };
+    const std::vector<FieldT> signed_constants(constants.begin(), constants.begin() + 4);
+
+    for( size_t i = 0; i < 8; i++ )
+    {
+        ProtoboardT pb;
+        VariableArrayT bits;
+        bits.allocate(pb, 3, "bits");
+        bits.fill_with_bits_of_ulong(pb, i);
+
+        lookup_3bit_gadget lookup(pb, constants, bits, "lookup");
+        lookup_Nbit_gadget<3> lookup_N(pb, constants, bits, "lookup_N");
+        lookup_signed_3bit_gadget signed_lookup(pb, signed_constants, bits, "signed_lookup");
+        lookup_Nbit_gadget<3, true> signed_lookup_N(pb, signed_constants, bits, "signed_lookup_N");
+
+        lookup.generate_r1cs_witness();
+        lookup_N.generate_r1cs_witness();
+        signed_lookup.generate_r1cs_witness();
+        signed_lookup_N.generate_r1cs_witness();
+
+        if( pb.val(lookup.result()) != pb.val(lookup_N.result()) ) {
+            std::cerr << "lookup_3bit_gadget differs for " << i << std::endl;
+            return false;
+        }
+
+        if( pb.val(signed_lookup.result()) != pb.val(signed_lookup_N.result()) ) {
+            std::cerr << "lookup_signed_3bit_gadget differs for " << i << std::endl;
+            return false;
+        }
+    }
+
+    ProtoboardT pb;
+    VariableArrayT bits;
+    bits.allocate(pb, 3, "bits");
+
+    lookup_3bit_gadget lookup(pb, constants, bits, "lookup");
+    lookup.generate_r1cs_constraints();
+    const auto n_constraints_3bit = pb.num_constraints();
+
+    lookup_Nbit_gadget<3> lookup_N(pb, constants, bits, "lookup_N");
+    lookup_N.generate_r1cs_constraints();
+    const auto n_constraints_N = pb.num_constraints() - n_constraints_3bit;
+
+    if( n_constraints_N >= n_constraints_3bit ) {
+        std::cerr << "lookup_Nbit_gadget<3> uses " << n_constraints_N << " constraints, lookup_3bit_gadget " << n_constraints_3bit << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool test_lookup_Nbit_proof()
+{
+    ProtoboardT pb;
+
+    const std::vector<FieldT> constants = {
+        FieldT::random_element(), FieldT::random_element(),
+        FieldT::random_element(), FieldT::random_element(),
+        FieldT::random_element(), FieldT::random_element(),
+        FieldT::random_element(), FieldT::random_element()
+    };
+
+    VariableArrayT bits;
+    bits.allocate(pb, 4, "bits");
+    bits.fill_with_bits_of_ulong(pb, 13);
+
+    lookup_Nbit_gadget<4, true> the_gadget(pb, constants, bits, "the_gadget");
+    the_gadget.generate_r1cs_constraints();
+    the_gadget.generate_r1cs_witness();
+
+    if( ! pb.is_satisfied() ) {
+        std::cerr << "Not satisfied!\n";
+        return false;
+    }
+
+    return stub_test_proof_verify(pb);
+}
+
+
+// namespace ethsnarks
+}
+
+
+int main( int argc, char **argv )
+{
+    // Types for board
+    ethsnarks::ppT::init_public_params();
+
+    if( ! ethsnarks::test_lookup_Nbit<1, false>()
+     || ! ethsnarks::test_lookup_Nbit<2, false>()
+     || ! ethsnarks::test_lookup_Nbit<3, false>()
+     || ! ethsnarks::test_lookup_Nbit<4, false>()
+     || ! ethsnarks::test_lookup_Nbit<5, false>() )
+    {
+        std::cerr << "FAIL unsigned\n";
+        return 1;
+    }
+
+    if( ! ethsnarks::test_lookup_Nbit<2, true>()
+     || ! ethsnarks::test_lookup_Nbit<3, true>()
+     || ! ethsnarks::test_lookup_Nbit<4, true>()
+     || ! ethsnarks::test_lookup_Nbit<5, true>() )
+    {
+        std::cerr << "FAIL signed\n";
+        return 2;
+    }
+
+    if( ! ethsnarks::test_lookup_Nbit_compatible() )
+    {
+        std::cerr << "FAIL compatible\n";
+        return 3;
+    }
+
+    if( ! ethsnarks::test_lookup_Nbit_proof() )
+    {
+        std::cerr << "FAIL proof\n";
+        return 4;
+    }
+
+    std::cout << "OK\n";
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "gadgets/merkle_multi_update.hpp"
+#include "gadgets/merkle_tree_native.hpp"
+
+namespace ethsnarks {
+
+
+template<typename HashT>
+bool test_multi_update( const char *name, const std::vector<size_t>& indices )
+{
+    typedef merkle_multi_update<HashT> UpdateT;
+
+    const size_t depth = 4;
+    merkle_tree_native<HashT> tree(depth);
+    for( size_t i = 0; i < (1u << depth); i += 3 ) {
+        tree.update(i, FieldT(long(i + 1)));
+    }
+
+    std::vector<FieldT> old_leaves, new_leaves;
+    for( size_t i = 0; i < indices.size(); i++ )
+    {
+        old_leaves.push_back(tree.leaf(indices[i]));
+        new_leaves.push_back(FieldT(long(i + 1000)));
+    }
+
+    std::vector<FieldT> siblings;
+    for( const auto& node : UpdateT::sibling_nodes(depth, indices) ) {
+        siblings.push_back(tree.node(node.first, node.second));
+    }
+
+    const FieldT old_root = tree.root();
+    tree.update_batch(indices, new_leaves);
+
+    for( bool tamper : {false, true} )
+    {
+        ProtoboardT pb;
+        VariableArrayT old_leaf_vars = make_var_array(pb, indices.size(), "old_leaves");
+        VariableArrayT new_leaf_vars = make_var_array(pb, indices.size(), "new_leaves");
+        VariableArrayT sibling_vars = make_var_array(pb, siblings.size(), "siblings");
+        VariableT old_root_var = make_variable(pb, old_root, "old_root");
+        VariableT new_root_var = make_variable(pb, tamper ? old_root : tree.root(), "new_root");
+
+        old_leaf_vars.fill_with_field_elements(pb, old_leaves);
+        new_leaf_vars.fill_with_field_elements(pb, new_leaves);
+        sibling_vars.fill_with_field_elements(pb, siblings);
+
+        UpdateT update(pb, depth, indices, merkle_tree_IVs(pb), old_leaf_vars, new_leaf_vars, sibling_vars, old_root_var, new_root_var, "update");
+        update.generate_r1cs_witness();
+        update.generate_r1cs_constraints();
+
+        if( update.m_old_hashers.size() != UpdateT::n_hashes(depth, indices) ) {
+            std::cerr << "FAIL " << name << " hash count" << std::endl;
+            return false;
+        }
+
+        if( tamper == (update.is_valid() && pb.is_satisfied()) ) {
+            std::cerr << "FAIL " << name << (tamper ? " tampered" : " valid") << " root" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+* Paths sharing nodes each hash them once
+*/
+bool test_n_hashes()
+{
+    typedef merkle_multi_update<MiMC_e7_hash_gadget> UpdateT;
+
+    return UpdateT::n_hashes(4, {5}) == 4
+        && UpdateT::n_hashes(4, {2, 3}) == 4
+        && UpdateT::n_hashes(4, {0, 15}) == 7
+        && UpdateT::n_hashes(4, {2, 3, 9}) == 7
+        && UpdateT::sibling_nodes(4, {2, 3}).size() == 3
+        && UpdateT::sibling_nodes(4, {0, 1, 2, 3}).size() == 2;
+}
+
+
+// namespace ethsnarks
+}
+
+
+int main( int argc, char **argv )
+{
+    ethsnarks::ppT::init_public_params();
+
+    if( ! ethsnarks::test_n_hashes() )
+    {
+        std::cerr << "FAIL n_hashes\n";
+        return 1;
+    }
+
+    if( ! ethsnarks::test_multi_update<ethsnarks::MiMC_e7_hash_gadget>("mimc", {2, 3, 9}) )
+    {
+        return 2;
+    }
+
+    if( ! ethsnarks::test_multi_update<ethsnarks::MiMC_e7_hash_gadget>("mimc", {0, 15}) )
+    {
+        return 3;
+    }
+
+    if( ! ethsnarks::test_multi_update<ethsnarks::merkle_hash_Poseidon128>("poseidon", {1, 4, 5, 14}) )
+    {
+        return 4;
+    }
+
+    std::cout << "OK\n";
+    return 0;
+}
@@ -1,10 +1,18 @@
  #include "stubs.hpp"
+#include "cs_budget.hpp"
 #include "gadgets/merkle_tree.hpp"
 #include "gadgets/mimc.hpp"
 
+#include <type_traits>
+
 namespace ethsnarks {
 
 
+// Paths are constructed in place and moved, copies would duplicate every hasher
+static_assert( ! std::is_copy_constructible<merkle_path_authenticator<MiMC_e7_hash_gadget>>::value, "paths must not be copyable" );
+static_assert( std::is_move_constructible<merkle_path_authenticator<MiMC_e7_hash_gadget>>::value, "paths must be movable" );
+
+
 bool test_merkle_path_selector(int is_right)
 {
 	ProtoboardT pb;
@@ -83,13 +91,14 @@ bool test_merkle_path_authenticator() {
 	pb.val(expected_root) = root;
 
 	size_t tree_depth = 1;
+	CSBudgetScope cost(pb, "merkle_path_authenticator<MiMC_e7_hash_gadget>[1]");
 	merkle_path_authenticator<MiMC_e7_hash_gadget> auth(
 		pb, tree_depth, address_bits,
 		merkle_tree_IVs(pb),
 		leaf, expected_root, path,
 		"authenticator");
 
-	auth.generate_r1cs_witness();
+	cost.witness([&](){ auth.generate_r1cs_witness(); });
 	auth.generate_r1cs_constraints();
 
 	if( ! auth.is_valid() ) {
@@ -104,7 +113,7 @@ bool test_merkle_path_authenticator() {
 		return false;
 	}
 
-	return true;
+	return cost.check();
 }
 
 // namespace ethsnarks
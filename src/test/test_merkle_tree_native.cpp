@@ -0,0 +1,249 @@
+#include "gadgets/merkle_tree_native.hpp"
+
+namespace ethsnarks {
+
+
+/**
+* The root of every leaf, hashed level by level, without any caching
+*/
+template<typename HashT>
+FieldT naive_root( size_t depth, std::vector<FieldT> nodes )
+{
+    for( size_t level = 0; level < depth; level++ )
+    {
+        std::vector<FieldT> parents(nodes.size() / 2);
+        merkle_tree_hasher<HashT>::hash_batch(level, nodes.data(), parents.size(), parents.data());
+        nodes = parents;
+    }
+    return nodes[0];
+}
+
+
+template<typename HashT>
+bool test_tree( const char *name )
+{
+    const size_t depth = 4;
+    merkle_tree_native<HashT> tree(depth), other(depth);
+    std::vector<FieldT> leaves(1 << depth, FieldT::zero());
+
+    if( tree.root() != naive_root<HashT>(depth, leaves) ) {
+        std::cerr << "FAIL " << name << " empty root" << std::endl;
+        return false;
+    }
+
+    // One at a time into one tree, as a batch with a duplicate into the other
+    const std::vector<size_t> indices = {3, 0, 9, 3, 15, 8};
+    std::vector<FieldT> values;
+    for( size_t i = 0; i < indices.size(); i++ )
+    {
+        values.emplace_back(FieldT(long(i + 100)));
+        leaves[indices[i]] = values.back();
+        tree.update(indices[i], values.back());
+    }
+    other.update_batch(indices, values);
+
+    const FieldT expected_root = naive_root<HashT>(depth, leaves);
+    if( tree.root() != expected_root || other.root() != expected_root ) {
+        std::cerr << "FAIL " << name << " root" << std::endl;
+        return false;
+    }
+
+    // Each path authenticates its leaf in the circuit
+    for( size_t index : {size_t(0), size_t(3), size_t(6), size_t(15)} )
+    {
+        ProtoboardT pb;
+        VariableArrayT address_bits = make_var_array(pb, depth, "address_bits");
+        VariableArrayT path = make_var_array(pb, depth, "path");
+        VariableT leaf = make_variable(pb, tree.leaf(index), "leaf");
+        VariableT expected = make_variable(pb, expected_root, "expected_root");
+
+        tree.path(index).fill(pb, address_bits, path);
+
+        merkle_path_authenticator<HashT> auth(pb, depth, address_bits, merkle_tree_IVs(pb), leaf, expected, path, "authenticator");
+        auth.generate_r1cs_witness();
+        auth.generate_r1cs_constraints();
+
+        if( ! auth.is_valid() || ! pb.is_satisfied() ) {
+            std::cerr << "FAIL " << name << " path " << index << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+* A 4-ary Poseidon tree, its paths authenticated in the circuit, and the
+* constraints of a membership proof against a binary tree of as many leaves
+*/
+bool test_kary_tree()
+{
+    typedef merkle_hash_Poseidon128_kary<4> HashT;
+    const size_t depth = 3;
+    merkle_tree_native<HashT> tree(depth);
+    std::vector<FieldT> leaves(64, FieldT::zero());
+
+    const std::vector<size_t> indices = {5, 0, 63, 17, 5, 42};
+    std::vector<FieldT> values;
+    for( size_t i = 0; i < indices.size(); i++ ) {
+        values.emplace_back(FieldT(long(i + 200)));
+        leaves[indices[i]] = values.back();
+    }
+    tree.update_batch(indices, values);
+
+    std::vector<FieldT> nodes = leaves;
+    for( size_t level = 0; level < depth; level++ )
+    {
+        std::vector<FieldT> parents(nodes.size() / 4);
+        merkle_tree_hasher<HashT>::hash_batch(level, nodes.data(), parents.size(), parents.data());
+        nodes = parents;
+    }
+    if( tree.root() != nodes[0] ) {
+        std::cerr << "FAIL 4-ary root" << std::endl;
+        return false;
+    }
+
+    size_t kary_constraints = 0;
+    for( size_t index : {size_t(0), size_t(5), size_t(42), size_t(63)} )
+    {
+        ProtoboardT pb;
+        VariableArrayT address_bits = make_var_array(pb, depth * 2, "address_bits");
+        VariableArrayT path = make_var_array(pb, depth * 3, "path");
+        VariableT leaf = make_variable(pb, tree.leaf(index), "leaf");
+        VariableT expected = make_variable(pb, tree.root(), "expected_root");
+        const auto IVs = merkle_tree_IVs(pb);
+
+        tree.path(index).fill(pb, address_bits, path);
+
+        const size_t before = pb.num_constraints();
+        merkle_path_authenticator_kary<HashT, 4> auth(pb, depth, address_bits, IVs, leaf, expected, path, "authenticator");
+        auth.generate_r1cs_witness();
+        auth.generate_r1cs_constraints();
+        kary_constraints = pb.num_constraints() - before;
+
+        if( ! auth.is_valid() || ! pb.is_satisfied() ) {
+            std::cerr << "FAIL 4-ary path " << index << std::endl;
+            return false;
+        }
+    }
+
+    ProtoboardT pb;
+    const size_t binary_depth = 6;
+    VariableArrayT address_bits = make_var_array(pb, binary_depth, "address_bits");
+    VariableArrayT path = make_var_array(pb, binary_depth, "path");
+    VariableT leaf = make_variable(pb, "leaf");
+    const auto IVs = merkle_tree_IVs(pb);
+    const size_t before = pb.num_constraints();
+    markle_path_compute<merkle_hash_Poseidon128> binary(pb, binary_depth, address_bits, IVs, leaf, path, "binary");
+    binary.generate_r1cs_constraints();
+    const size_t binary_constraints = pb.num_constraints() - before;
+
+    std::cout << "Constraints per membership proof of 64 leaves: binary " << binary_constraints
+              << ", 4-ary " << kary_constraints << std::endl;
+    return kary_constraints < binary_constraints;
+}
+
+
+/**
+* The selector of 8 children puts the input at each position
+*/
+bool test_selector_kary()
+{
+    for( size_t position = 0; position < 8; position++ )
+    {
+        ProtoboardT pb;
+        VariableT input = make_variable(pb, FieldT(100), "input");
+        VariableArrayT siblings = make_var_array(pb, 7, "siblings");
+        VariableArrayT bits = make_var_array(pb, 3, "bits");
+        for( size_t i = 0; i < 7; i++ ) {
+            pb.val(siblings[i]) = FieldT(long(i + 1));
+        }
+        bits.fill_with_bits_of_ulong(pb, position);
+
+        merkle_path_selector_kary selector(pb, input, siblings, bits, "selector");
+        selector.generate_r1cs_witness();
+        selector.generate_r1cs_constraints();
+
+        for( size_t j = 0; j < 8; j++ )
+        {
+            const FieldT expected = (j == position) ? FieldT(100) : FieldT(long(j < position ? j + 1 : j));
+            if( pb.val(selector.children()[j]) != expected ) {
+                std::cerr << "FAIL selector child " << j << " at " << position << std::endl;
+                return false;
+            }
+        }
+
+        // 4 products of indicators, then 2 for each of the 6 middle children and 2 for the ends
+        if( ! pb.is_satisfied() || pb.num_constraints() != 4 + 12 + 2 ) {
+            std::cerr << "FAIL selector at " << position << std::endl;
+            return false;
+        }
+
+        // Swapping two children breaks it
+        std::swap(pb.val(selector.children()[position]), pb.val(selector.children()[position ^ 1]));
+        if( pb.is_satisfied() ) {
+            std::cerr << "FAIL selector satisfied with children swapped at " << position << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+* The same root as the vector test_merkle_tree checks in the circuit
+*/
+bool test_mimc_vector()
+{
+    merkle_tree_native<MiMC_e7_hash_gadget> tree(1);
+    tree.update_batch({0, 1}, {
+        FieldT("3703141493535563179657531719960160174296085208671919316200479060314459804651"),
+        FieldT("134551314051432487569247388144051420116740427803855572138106146683954151557")});
+
+    return tree.root() == FieldT("3075442268020138823380831368198734873612490112867968717790651410945045657947");
+}
+
+
+// namespace ethsnarks
+}
+
+
+int main( int argc, char **argv )
+{
+    ethsnarks::ppT::init_public_params();
+
+    if( ! ethsnarks::test_mimc_vector() )
+    {
+        std::cerr << "FAIL mimc vector\n";
+        return 1;
+    }
+
+    if( ! ethsnarks::test_tree<ethsnarks::MiMC_e7_hash_gadget>("mimc") )
+    {
+        return 2;
+    }
+
+    if( ! ethsnarks::test_tree<ethsnarks::merkle_hash_Poseidon128>("poseidon") )
+    {
+        return 3;
+    }
+
+    if( ! ethsnarks::test_tree<ethsnarks::Poseidon128_sponge>("poseidon sponge") )
+    {
+        return 4;
+    }
+
+    if( ! ethsnarks::test_selector_kary() )
+    {
+        return 5;
+    }
+
+    if( ! ethsnarks::test_kary_tree() )
+    {
+        return 6;
+    }
+
+    std::cout << "OK\n";
+    return 0;
+}
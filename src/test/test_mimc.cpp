@@ -9,6 +9,8 @@ using ethsnarks::FieldT;
 using ethsnarks::ProtoboardT;
 using ethsnarks::VariableT;
 using ethsnarks::MiMC_e7_gadget;
+using ethsnarks::MiMC_e7_instance;
+using ethsnarks::MiMC_e5_gadget;
 using ethsnarks::make_variable;
 
 
@@ -44,6 +46,107 @@ bool test_MiMC(const MiMC_TestCase& test_case)
 }
 
 
+/**
+* Two instances share one master's constraints, each with its own witness
+*/
+bool test_MiMC_instance(const MiMC_TestCase& test_case)
+{
+    ProtoboardT pb;
+
+    const VariableT in_x = make_variable(pb, test_case.plaintext, "x");
+    const VariableT in_k = make_variable(pb, test_case.key, "k");
+    const VariableT other_x = make_variable(pb, test_case.key, "other_x");
+    pb.set_input_sizes(3);
+
+    MiMC_e7_instance the_gadget(pb, in_x, in_k, "the_gadget");
+    MiMC_e7_instance other_gadget(pb, other_x, in_k, "other_gadget");
+    the_gadget.generate_r1cs_witness();
+    other_gadget.generate_r1cs_witness();
+    the_gadget.generate_r1cs_constraints();
+    other_gadget.generate_r1cs_constraints();
+
+    if( test_case.result != pb.val(the_gadget.result()) || pb.val(other_gadget.result()) == pb.val(the_gadget.result()) )
+    {
+        std::cerr << "Unexpected instance result!\n";
+        return false;
+    }
+
+    return pb.is_satisfied();
+}
+
+
+/**
+* The fused witness matches each round's own witness, for both exponents
+*/
+template<typename GadgetT>
+bool test_MiMC_fused(const MiMC_TestCase& test_case)
+{
+    ProtoboardT pb;
+
+    const VariableT in_x = make_variable(pb, test_case.plaintext, "x");
+    const VariableT in_k = make_variable(pb, test_case.key, "k");
+    pb.set_input_sizes(2);
+
+    GadgetT the_gadget(pb, in_x, in_k, "the_gadget");
+    the_gadget.generate_r1cs_constraints();
+    the_gadget.generate_r1cs_witness();
+    const auto fused = pb.full_variable_assignment();
+
+    the_gadget.generate_r1cs_witness_rounds();
+    if( ! the_gadget.m_contiguous || pb.full_variable_assignment() != fused )
+    {
+        std::cerr << "Unexpected fused witness!\n";
+        return false;
+    }
+
+    return pb.is_satisfied();
+}
+
+
+/**
+* Natively, one at a time and in a batch which doesn't fill the last lanes
+*/
+bool test_MiMC_native(const MiMC_TestCase& test_case)
+{
+    if( ethsnarks::mimc(test_case.plaintext, test_case.key) != test_case.result )
+    {
+        std::cerr << "Unexpected native result!\n";
+        return false;
+    }
+
+    const size_t n = 7;
+    std::vector<FieldT> x, k, out(n);
+    for( size_t i = 0; i < n; i++ )
+    {
+        x.push_back(test_case.plaintext + FieldT(i));
+        k.push_back(test_case.key);
+    }
+
+    const auto& constants = MiMC_e7_gadget::static_constants();
+    ethsnarks::mimc_native_batch<ethsnarks::MiMCe7_round>(constants, x.data(), k.data(), out.data(), n);
+    for( size_t i = 0; i < n; i++ )
+    {
+        if( out[i] != ethsnarks::mimc(constants, x[i], k[i]) )
+        {
+            std::cerr << "Unexpected batch result " << i << "!\n";
+            return false;
+        }
+    }
+
+    return out[0] == test_case.result;
+}
+
+
+/**
+* The default constants are baked in, they must match the SHA3 derivation
+*/
+bool test_MiMC_constants()
+{
+    return MiMC_e7_gadget::static_constants() == MiMC_e7_gadget::constants()
+        && MiMC_e5_gadget::static_constants() == MiMC_e5_gadget::constants();
+}
+
+
 int main( int argc, char **argv )
 {
     ppT::init_public_params();
@@ -54,10 +157,17 @@ int main( int argc, char **argv )
          FieldT("11437467823393790387399137249441941313717686441929791910070352316474327319704")}
     };
 
+    if( ! test_MiMC_constants() )
+    {
+        std::cerr << "FAIL constants" << std::endl;
+        return 1;
+    }
+
     int i = 0;
     for( const auto& tc : test_cases )
     {        
-        if( ! test_MiMC(tc) )
+        if( ! test_MiMC(tc) || ! test_MiMC_instance(tc) || ! test_MiMC_native(tc)
+         || ! test_MiMC_fused<MiMC_e7_gadget>(tc) || ! test_MiMC_fused<MiMC_e5_gadget>(tc) )
         {
             std::cerr << "FAIL " << i << std::endl;
             return 1;
@@ -3,6 +3,7 @@
 
 
 #include "gadgets/mimc.hpp"
+#include "cs_budget.hpp"
 #include "stubs.hpp"
 
 namespace ethsnarks {
@@ -20,8 +21,9 @@ bool test_mimc_hash()
     // Private inputs
     VariableT iv = make_variable(pb, FieldT("918403109389145570117360101535982733651217667914747213867238065296420114726"), "iv");
 
+    CSBudgetScope cost(pb, "MiMC_e7_hash_gadget[2]");
     MiMC_e7_hash_gadget the_gadget(pb, iv, {m_0, m_1}, "gadget");
-    the_gadget.generate_r1cs_witness();
+    cost.witness([&](){ the_gadget.generate_r1cs_witness(); });
     the_gadget.generate_r1cs_constraints();
 
     auto result_expected = FieldT("15683951496311901749339509118960676303290224812129752890706581988986633412003");
@@ -66,10 +68,50 @@ bool test_mimc_hash()
         return false;
     }
 
+    if( ! cost.check() ) {
+        return false;
+    }
+
     return stub_test_proof_verify(pb);
 }
 
 
+bool test_mimc_hash_native()
+{
+    const FieldT m_0("3703141493535563179657531719960160174296085208671919316200479060314459804651");
+    const FieldT m_1("134551314051432487569247388144051420116740427803855572138106146683954151557");
+    const FieldT iv("918403109389145570117360101535982733651217667914747213867238065296420114726");
+    const FieldT result_expected("15683951496311901749339509118960676303290224812129752890706581988986633412003");
+
+    if( mimc_hash({m_0, m_1}, iv) != result_expected )
+    {
+        std::cerr << "Unexpected native result!\n";
+        return false;
+    }
+
+    // Batch of pairs, the same pair at every odd index
+    const size_t n = 9;
+    std::vector<FieldT> messages, out(n);
+    for( size_t i = 0; i < n; i++ )
+    {
+        messages.push_back(i % 2 ? m_0 : FieldT(i));
+        messages.push_back(m_1);
+    }
+
+    mimc_hash_native_batch<MiMCe7_round>(MiMC_e7_gadget::static_constants(), messages.data(), 2, n, iv, out.data());
+    for( size_t i = 0; i < n; i++ )
+    {
+        if( out[i] != mimc_hash({messages[2*i], messages[2*i + 1]}, iv) || (i % 2 && out[i] != result_expected) )
+        {
+            std::cerr << "Unexpected batch result " << i << "!\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
 // namespace ethsnarks
 }
 
@@ -79,7 +121,7 @@ int main( int argc, char **argv )
     // Types for board
     ethsnarks::ppT::init_public_params();
 
-    if( ! ethsnarks::test_mimc_hash() )
+    if( ! ethsnarks::test_mimc_hash() || ! ethsnarks::test_mimc_hash_native() )
     {
         std::cerr << "FAIL\n";
         return 1;
@@ -44,6 +44,87 @@ bool test_one_of_n()
     return stub_test_proof_verify(pb);
 }
 
+bool test_one_of_n_indexed( size_t n_items )
+{
+    std::vector<FieldT> rand_items;
+    for( size_t i = 0; i < n_items; i++ ) {
+        rand_items.push_back(FieldT::random_element());
+    }
+
+    for( const size_t index : {size_t(0), n_items / 2, n_items - 1} )
+    {
+        ProtoboardT pb;
+
+        VariableArrayT in_items;
+        in_items.allocate(pb, rand_items.size(), "in_items");
+        in_items.fill_with_field_elements(pb, rand_items);
+
+        VariableT in_our_item;
+        in_our_item.allocate(pb, "our_item");
+        pb.val(in_our_item) = rand_items[index];
+
+        ethsnarks::one_of_n_indexed the_gadget(pb, in_our_item, in_items, "gadget");
+        the_gadget.generate_r1cs_constraints();
+        the_gadget.generate_r1cs_witness();
+        pb.set_input_sizes(rand_items.size());
+
+        if( ! pb.is_satisfied() ) {
+            std::cerr << n_items << " items, not satisfied for " << index << std::endl;
+            return false;
+        }
+
+        if( the_gadget.index_bits.get_field_element_from_bits(pb) != FieldT(index) ) {
+            std::cerr << n_items << " items, wrong index for " << index << std::endl;
+            return false;
+        }
+
+        // Every multiplexer, plus the booleanity of the index
+        if( pb.num_constraints() != (n_items - 1) + one_of_n_indexed::depth(n_items) + (n_items == 1) ) {
+            std::cerr << n_items << " items, " << pb.num_constraints() << " constraints" << std::endl;
+            return false;
+        }
+
+        // An item which isn't in the set is rejected
+        pb.val(in_our_item) = FieldT::random_element();
+        the_gadget.generate_r1cs_witness();
+        if( pb.is_satisfied() ) {
+            std::cerr << n_items << " items, accepted an item not in the set" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool test_one_of_n_indexed()
+{
+    for( const size_t n_items : {1, 2, 3, 10, 33, 1024} )
+    {
+        if( ! test_one_of_n_indexed(n_items) ) {
+            return false;
+        }
+    }
+
+    // Fewer constraints than the toggles
+    ProtoboardT pb;
+    VariableArrayT in_items;
+    in_items.allocate(pb, 1024, "in_items");
+    VariableT in_our_item;
+    in_our_item.allocate(pb, "our_item");
+
+    ethsnarks::one_of_n toggled(pb, in_our_item, in_items, "toggled");
+    toggled.generate_r1cs_constraints();
+    const auto n_toggled = pb.num_constraints();
+
+    ethsnarks::one_of_n_indexed indexed(pb, in_our_item, in_items, "indexed");
+    indexed.generate_r1cs_constraints();
+    const auto n_indexed = pb.num_constraints() - n_toggled;
+
+    std::cout << "one_of_n: " << n_toggled << " constraints, one_of_n_indexed: " << n_indexed << " constraints" << std::endl;
+    return n_indexed < n_toggled;
+}
+
 // namespace ethsnarks
 }
 
@@ -58,6 +139,12 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if( ! ethsnarks::test_one_of_n_indexed() )
+    {
+        std::cerr << "FAIL indexed\n";
+        return 2;
+    }
+
     std::cout << "OK\n";
     return 0;
 }
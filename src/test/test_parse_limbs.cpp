@@ -0,0 +1,74 @@
+#include "import.hpp"
+
+#include <gmp.h>
+
+using namespace ethsnarks;
+
+
+static bool matches_gmp( const std::string &input )
+{
+    libff::bigint<FieldT::num_limbs> expected;
+    mpz_t value;
+    ::mpz_init(value);
+    ::mpz_set_str(value, input.c_str(), 0);
+    expected = libff::bigint<FieldT::num_limbs>(value);
+    ::mpz_clear(value);
+
+    libff::bigint<FieldT::num_limbs> actual;
+    return parse_limbs(input.data(), input.size(), actual) && actual == expected;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    const std::vector<std::string> valid = {
+        "0", "1", "9", "10", "18446744073709551615", "18446744073709551616",
+        "21888242871839275222246405745257275088548364400416034343698204186575808495616",
+        "0x0", "0x1", "0xdeadBEEF", "0x30644e72e131a029b85045b68181585d2833e84879b9709143e1f593f0000000",
+        "0b0", "0b1", "0b1011011101111",
+    };
+    for( const auto &input : valid )
+    {
+        if( ! matches_gmp(input) ) {
+            std::cerr << "FAIL " << input << std::endl;
+            return 1;
+        }
+    }
+
+    // Random elements roundtrip through their decimal representation
+    for( int i = 0; i < 100; i++ )
+    {
+        const FieldT x = FieldT::random_element();
+        mpz_t value;
+        ::mpz_init(value);
+        x.as_bigint().to_mpz(value);
+        char *str = ::mpz_get_str(nullptr, 10, value);
+        const std::string dec(str);
+        ::free(str);
+        ::mpz_clear(value);
+
+        if( ! matches_gmp(dec) || parse_FieldT(dec) != x ) {
+            std::cerr << "FAIL random " << dec << std::endl;
+            return 2;
+        }
+    }
+
+    libff::bigint<FieldT::num_limbs> out;
+    const std::vector<std::string> invalid = {
+        "", "0x", "0b", "-1", "12a", "0xg", "0b2", " 1",
+        "0x1" + std::string(FieldT::num_limbs * GMP_NUMB_BITS / 4, '0'),
+        "1" + std::string(FieldT::num_limbs * GMP_NUMB_BITS / 3, '0'),
+    };
+    for( const auto &input : invalid )
+    {
+        if( parse_limbs(input.data(), input.size(), out) ) {
+            std::cerr << "FAIL accepted " << input << std::endl;
+            return 3;
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
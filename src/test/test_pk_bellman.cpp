@@ -0,0 +1,214 @@
+#include "export.hpp"
+#include "import.hpp"
+#include "stubs.hpp"
+#include "utils.hpp"
+
+#include <cstdio>   // remove
+#include <fstream>
+
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+using namespace ethsnarks;
+
+
+typedef libsnark::r1cs_gg_ppzksnark_zok_proving_key<ppT> FullProvingKeyT;
+
+
+/** Points as bellman writes them, the decimal projective coordinates */
+static json bellman_G1( const G1T& point )
+{
+#ifdef CURVE_ALT_BN128
+    return {bigintToString(point.X.as_bigint()), bigintToString(point.Y.as_bigint()), bigintToString(point.Z.as_bigint())};
+#elif CURVE_MCL_BN128
+    return {point.pt.x.getStr(), point.pt.y.getStr(), point.pt.z.getStr()};
+#endif
+}
+
+
+static json bellman_G2( const G2T& point )
+{
+#ifdef CURVE_ALT_BN128
+    return {{bigintToString(point.X.c0.as_bigint()), bigintToString(point.X.c1.as_bigint())},
+            {bigintToString(point.Y.c0.as_bigint()), bigintToString(point.Y.c1.as_bigint())},
+            {bigintToString(point.Z.c0.as_bigint()), bigintToString(point.Z.c1.as_bigint())}};
+#elif CURVE_MCL_BN128
+    return {{point.pt.x.a.getStr(), point.pt.x.b.getStr()},
+            {point.pt.y.a.getStr(), point.pt.y.b.getStr()},
+            {point.pt.z.a.getStr(), point.pt.z.b.getStr()}};
+#endif
+}
+
+
+/**
+* A bellman params file for the key, dense A, B1 and B2 queries and a C
+* query which starts with the two entries of the constant and the input
+*/
+static json make_bellman( const FullProvingKeyT& pk )
+{
+    json out;
+
+    out["A"] = json::array();
+    for( const auto& point : pk.A_query ) {
+        out["A"].push_back(bellman_G1(point));
+    }
+
+    std::vector<G1T> B1(pk.A_query.size(), G1T::zero());
+    std::vector<G2T> B2(pk.A_query.size(), G2T::zero());
+    for( size_t i = 0; i < pk.B_query.indices.size(); i++ ) {
+        B1[pk.B_query.indices[i]] = pk.B_query.values[i].h;
+        B2[pk.B_query.indices[i]] = pk.B_query.values[i].g;
+    }
+    out["B1"] = json::array();
+    out["B2"] = json::array();
+    for( size_t i = 0; i < B1.size(); i++ ) {
+        out["B1"].push_back(bellman_G1(B1[i]));
+        out["B2"].push_back(bellman_G2(B2[i]));
+    }
+
+    out["C"] = {bellman_G1(G1T::zero()), bellman_G1(G1T::zero())};
+    for( const auto& point : pk.L_query ) {
+        out["C"].push_back(bellman_G1(point));
+    }
+
+    out["hExps"] = json::array();
+    for( const auto& point : pk.H_query ) {
+        out["hExps"].push_back(bellman_G1(point));
+    }
+
+    out["vk_alfa_1"] = bellman_G1(pk.alpha_g1);
+    out["vk_beta_1"] = bellman_G1(pk.beta_g1);
+    out["vk_beta_2"] = bellman_G2(pk.beta_g2);
+    out["vk_delta_1"] = bellman_G1(pk.delta_g1);
+    out["vk_delta_2"] = bellman_G2(pk.delta_g2);
+
+    return out;
+}
+
+
+static G1T reference_G1( const json& input )
+{
+#ifdef CURVE_ALT_BN128
+    return G1T(parse_bigint<FqT>(input[0].get<std::string>()),
+               parse_bigint<FqT>(input[1].get<std::string>()),
+               parse_bigint<FqT>(input[2].get<std::string>()));
+#elif CURVE_MCL_BN128
+    return G1T(input[0].get<std::string>(), input[1].get<std::string>(), input[2].get<std::string>());
+#endif
+}
+
+
+static G2T reference_G2( const json& input )
+{
+#ifdef CURVE_ALT_BN128
+    typedef libff::alt_bn128_Fq2 Fq2_T;
+    return G2T(Fq2_T(parse_bigint<FqT>(input[0][0].get<std::string>()), parse_bigint<FqT>(input[0][1].get<std::string>())),
+               Fq2_T(parse_bigint<FqT>(input[1][0].get<std::string>()), parse_bigint<FqT>(input[1][1].get<std::string>())),
+               Fq2_T(parse_bigint<FqT>(input[2][0].get<std::string>()), parse_bigint<FqT>(input[2][1].get<std::string>())));
+#elif CURVE_MCL_BN128
+    return G2T(input[0][0].get<std::string>(), input[0][1].get<std::string>(),
+               input[1][0].get<std::string>(), input[1][1].get<std::string>(),
+               input[2][0].get<std::string>(), input[2][1].get<std::string>());
+#endif
+}
+
+
+/**
+* The converter as it was before it streamed, from the whole JSON tree
+* through the full key
+*/
+static ProvingKeyT reference_bellman2ethsnarks( const json& input )
+{
+    FullProvingKeyT proving_key;
+
+    for( const auto& point : input["A"] ) {
+        proving_key.A_query.push_back(reference_G1(point));
+    }
+
+    proving_key.B_query.domain_size_ = proving_key.A_query.size();
+    for( size_t i = 0; i < input["B1"].size(); i++ )
+    {
+        const auto g1 = reference_G1(input["B1"][i]);
+        const auto g2 = reference_G2(input["B2"][i]);
+        if( ! g1.is_zero() ) {
+            proving_key.B_query.values.emplace_back(libsnark::knowledge_commitment<G2T, G1T>(g2, g1));
+            proving_key.B_query.indices.emplace_back(i);
+        }
+    }
+
+    for( size_t i = 2; i < input["C"].size(); i++ ) {
+        proving_key.L_query.push_back(reference_G1(input["C"][i]));
+    }
+
+    for( const auto& point : input["hExps"] ) {
+        proving_key.H_query.push_back(reference_G1(point));
+    }
+
+    proving_key.alpha_g1 = reference_G1(input["vk_alfa_1"]);
+    proving_key.beta_g1 = reference_G1(input["vk_beta_1"]);
+    proving_key.beta_g2 = reference_G2(input["vk_beta_2"]);
+    proving_key.delta_g1 = reference_G1(input["vk_delta_1"]);
+    proving_key.delta_g2 = reference_G2(input["vk_delta_2"]);
+
+    return ProvingKeyT(proving_key);
+}
+
+
+static bool test_pk_bellman( const std::string& bellman_file, const std::string& pk_file )
+{
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    const auto bellman = make_bellman(keypair.pk);
+    std::ofstream(bellman_file) << bellman;
+
+    if( ! pk_bellman2ethsnarks(bellman_file, pk_file) ) {
+        std::cerr << "FAIL convert" << std::endl;
+        return false;
+    }
+
+    auto pk = loadFromFile<ProvingKeyT>(pk_file);
+    if( ! (pk == reference_bellman2ethsnarks(bellman)) || ! (pk == ProvingKeyT(keypair.pk)) ) {
+        std::cerr << "FAIL converted key differs from the previous converter's" << std::endl;
+        return false;
+    }
+
+    if( ! prove_and_verify(pk, keypair.vk, pb) ) {
+        std::cerr << "FAIL proof from the converted key doesn't verify" << std::endl;
+        return false;
+    }
+
+    // A point with a coordinate missing fails the conversion
+    auto bad = bellman;
+    bad["hExps"][0].erase(2);
+    std::ofstream(bellman_file) << bad;
+    if( pk_bellman2ethsnarks(bellman_file, pk_file) ) {
+        std::cerr << "FAIL converted a malformed key" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    char bellman_file[TEMP_PATH_SIZE], pk_file[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_pk_bellman.json", bellman_file) || ! make_temp_file("test_pk_bellman.raw", pk_file) ) {
+        return 1;
+    }
+
+    const bool ok = test_pk_bellman(bellman_file, pk_file);
+    ::remove(bellman_file);
+    ::remove(pk_file);
+
+    if( ! ok ) {
+        return 2;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
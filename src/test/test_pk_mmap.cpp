@@ -0,0 +1,133 @@
+#include "pk_mmap.hpp"
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+#include <fstream>
+
+using namespace ethsnarks;
+
+
+bool test_pk_mmap_roundtrip()
+{
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto pk = ProvingKeyT(keypair.pk);
+
+    char pk_file[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_pk_mmap", pk_file) ) {
+        return false;
+    }
+
+    if( ! pk_write_mmap(pk, pk_file) ) {
+        std::cerr << "FAIL pk_write_mmap" << std::endl;
+        return false;
+    }
+
+    if( ! pk_is_mmap(pk_file) ) {
+        std::cerr << "FAIL pk_is_mmap" << std::endl;
+        return false;
+    }
+
+    auto loaded_pk = load_proving_key(pk_file);
+    ::remove(pk_file);
+
+    if( loaded_pk.alpha_g1 != pk.alpha_g1
+     || loaded_pk.beta_g1 != pk.beta_g1
+     || loaded_pk.beta_g2 != pk.beta_g2
+     || loaded_pk.delta_g1 != pk.delta_g1
+     || loaded_pk.delta_g2 != pk.delta_g2
+     || ! (loaded_pk.A_query == pk.A_query)
+     || ! (loaded_pk.B_query == pk.B_query)
+     || loaded_pk.H_query != pk.H_query
+     || loaded_pk.L_query != pk.L_query ) {
+        std::cerr << "FAIL loaded key differs" << std::endl;
+        return false;
+    }
+
+    // And the loaded key must produce a valid proof
+    return prove_and_verify(loaded_pk, keypair.vk, pb);
+}
+
+
+/** Write the key, then overwrite `size` bytes at `offset`, and try loading it */
+static bool loads_corrupted( const ProvingKeyT& pk, const char *pk_file, uint64_t offset, const void *data, size_t size )
+{
+    if( ! pk_write_mmap(pk, pk_file) ) {
+        return true;
+    }
+
+    std::fstream fh(pk_file, std::ios::binary | std::ios::in | std::ios::out);
+    fh.seekp(offset);
+    fh.write(static_cast<const char*>(data), size);
+    fh.close();
+
+    ProvingKeyT loaded;
+    return pk_load_mmap(pk_file, loaded);
+}
+
+
+bool test_pk_mmap_corrupted()
+{
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto pk = ProvingKeyT(keypair.pk);
+
+    char pk_file[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_pk_mmap_corrupted", pk_file) || ! pk_write_mmap(pk, pk_file) ) {
+        return false;
+    }
+
+    ProvingKeyMmapHeader header;
+    std::ifstream(pk_file, std::ios::binary).read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    // A section moved past the end of the file
+    ProvingKeyMmapHeader moved = header;
+    moved.A_values_offset = header.file_size;
+
+    // A count which doesn't match the layout, or can't fit in the file
+    ProvingKeyMmapHeader counted = header;
+    counted.H_count++;
+    ProvingKeyMmapHeader huge = header;
+    huge.L_count = uint64_t(-1) / 2;
+
+    // Indices outside the domain, or out of order
+    const size_t outside = header.A_domain_size;
+    const size_t repeated[2] = {pk.B_query.indices[0], pk.B_query.indices[0]};
+
+    const bool loaded = loads_corrupted(pk, pk_file, 0, &moved, sizeof(moved))
+                     || loads_corrupted(pk, pk_file, 0, &counted, sizeof(counted))
+                     || loads_corrupted(pk, pk_file, 0, &huge, sizeof(huge))
+                     || loads_corrupted(pk, pk_file, header.A_indices_offset, &outside, sizeof(outside))
+                     || loads_corrupted(pk, pk_file, header.B_indices_offset, repeated, sizeof(repeated));
+    ::remove(pk_file);
+
+    if( loaded ) {
+        std::cerr << "FAIL loaded a corrupted key" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    if( ! test_pk_mmap_roundtrip() ) {
+        std::cerr << "FAIL" << std::endl;
+        return 1;
+    }
+
+    if( ! test_pk_mmap_corrupted() ) {
+        std::cerr << "FAIL corrupted" << std::endl;
+        return 2;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "pk_mmap.hpp"
+#include "pk_normalise.hpp"
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    const auto pk = ProvingKeyT(keypair.pk);
+    if( ! pk_is_normalised(pk) ) {
+        std::cerr << "FAIL generated key isn't affine" << std::endl;
+        return 1;
+    }
+
+    // The same points, but not affine, as a converted key may have them
+    auto converted = pk;
+    converted.delta_g2 = converted.delta_g2.dbl() - converted.delta_g2;
+    for( auto& p : converted.B_query.values ) {
+        p = p.dbl() - p;
+    }
+    for( auto& p : converted.L_query ) {
+        p = p.dbl() - p;
+    }
+    size_t expected = converted.delta_g2.is_special() ? 0 : 1;
+    for( const auto& p : converted.B_query.values ) {
+        expected += p.is_special() ? 0 : 1;
+    }
+    for( const auto& p : converted.L_query ) {
+        expected += p.is_special() ? 0 : 1;
+    }
+
+    char pk_file[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_pk_normalise", pk_file) || ! pk_write_mmap(converted, pk_file) ) {
+        return 2;
+    }
+
+    if( pk_is_normalised(converted) || pk_normalise(converted) != expected || ! pk_is_normalised(converted) ) {
+        std::cerr << "FAIL pk_normalise" << std::endl;
+        ::remove(pk_file);
+        return 3;
+    }
+
+    // Without the header flag, the loader normalises
+    ProvingKeyT loaded;
+    if( ! pk_load_mmap(pk_file, loaded) || ! pk_is_normalised(loaded) ) {
+        std::cerr << "FAIL mmap key not normalised when loaded" << std::endl;
+        ::remove(pk_file);
+        return 4;
+    }
+    ::remove(pk_file);
+
+    if( ! (loaded == pk) || ! (converted == pk) ) {
+        std::cerr << "FAIL normalised points differ" << std::endl;
+        return 5;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
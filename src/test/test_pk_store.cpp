@@ -0,0 +1,95 @@
+#include "gadgets/mimc.hpp"
+#include "pk_mmap.hpp"
+#include "pk_store.hpp"
+#include "cs_memory.hpp"
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+
+using namespace ethsnarks;
+
+
+static bool write_key( size_t n_messages, char (&pk_file)[TEMP_PATH_SIZE], ProtoboardT& pb, libsnark::r1cs_gg_ppzksnark_zok_verification_key<ppT>& vk )
+{
+    std::vector<VariableT> messages;
+    for( size_t i = 0; i < n_messages; i++ ) {
+        messages.push_back(make_variable(pb, FieldT(long(i + 1)), FMT("message", "[%zu]", i)));
+    }
+    pb.set_input_sizes(n_messages);
+    VariableT iv = make_variable(pb, FieldT(MIMC_TEST_IV), "iv");
+
+    MiMC_e7_hash_gadget the_gadget(pb, iv, messages, "gadget");
+    the_gadget.generate_r1cs_witness();
+    the_gadget.generate_r1cs_constraints();
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    vk = keypair.vk;
+    return make_temp_file("test_pk_store", pk_file) && pk_write_mmap(ProvingKeyT(keypair.pk), pk_file);
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb_a, pb_b;
+    libsnark::r1cs_gg_ppzksnark_zok_verification_key<ppT> vk_a, vk_b;
+    char pk_a[TEMP_PATH_SIZE], pk_b[TEMP_PATH_SIZE];
+    if( ! write_key(1, pk_a, pb_a, vk_a) || ! write_key(2, pk_b, pb_b, vk_b) ) {
+        return 1;
+    }
+
+    CSMemoryReport report;
+    cs_memory_proving_key(load_proving_key(pk_b), report);
+
+    // Room for either key but not both
+    ProvingKeyStore store(report.pk_bytes + 1);
+
+    int result = 0;
+    {
+        auto key_a = store.get(pk_a);
+        auto key_b = store.get(pk_b);
+        if( store.get(pk_a) != key_a ) {
+            std::cerr << "FAIL key not shared" << std::endl;
+            result = 2;
+        }
+
+        // Both keys are held, so neither is evicted
+        const auto metrics = store.metrics();
+        if( metrics.num_keys != 2 || metrics.evictions != 0 || metrics.hits != 1 || metrics.misses != 2 ) {
+            std::cerr << "FAIL key in use evicted" << std::endl;
+            result = 3;
+        }
+
+        ProverContextT context(*key_b);
+        init_prover_context(context, pb_b);
+        const auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb_b.values);
+        if( ! libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(vk_b, pb_b.primary_input(), proof) ) {
+            std::cerr << "FAIL proof with shared key" << std::endl;
+            result = 4;
+        }
+    }
+
+    // Once released the least recently used is evicted
+    store.get(pk_b);
+    auto metrics = store.metrics();
+    if( metrics.num_keys != 1 || metrics.evictions != 1 || metrics.resident_bytes > report.pk_bytes ) {
+        std::cerr << "FAIL least recently used not evicted" << std::endl;
+        result = 5;
+    }
+
+    store.get(pk_a);
+    metrics = store.metrics();
+    if( metrics.misses != 3 || metrics.evictions != 2 || metrics.load_seconds <= 0 ) {
+        std::cerr << "FAIL evicted key not reloaded" << std::endl;
+        result = 6;
+    }
+
+    ::remove(pk_a);
+    ::remove(pk_b);
+
+    if( result == 0 ) {
+        std::cout << "OK" << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,244 @@
+#include "export.hpp"
+#include "pk_zkey.hpp"
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+#include <fstream>
+
+#include <gmp.h>
+
+#include <libff/algebra/fields/field_utils.hpp>   // get_root_of_unity
+#include <libsnark/reductions/r1cs_to_qap/r1cs_to_qap.hpp>
+
+using namespace ethsnarks;
+
+
+static const char FQ_MODULUS[] = "21888242871839275222246405745257275088696311157297823662689037894645226208583";
+
+
+static void put_u32( std::string& out, uint32_t value )
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+static void put_section( std::string& out, uint32_t type, const std::string& data )
+{
+    const uint64_t size = data.size();
+    put_u32(out, type);
+    out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    out += data;
+}
+
+
+static void put_bigint( std::string& out, const LimbT& value )
+{
+    out.append(reinterpret_cast<const char*>(value.data), 32);
+}
+
+
+/** A big-endian word of the wire encoding as snarkjs's little-endian x * 2^256 mod q */
+static void put_mont( std::string& out, const uint8_t *word )
+{
+    mpz_t q, value;
+    ::mpz_init_set_str(q, FQ_MODULUS, 10);
+    ::mpz_init(value);
+    ::mpz_import(value, 32, 1, 1, 1, 0, word);
+    ::mpz_mul_2exp(value, value, 256);
+    ::mpz_mod(value, value, q);
+
+    uint8_t buf[32] = {0};
+    ::mpz_export(buf, nullptr, -1, 1, -1, 0, value);
+    out.append(reinterpret_cast<const char*>(buf), sizeof(buf));
+    ::mpz_clear(value);
+    ::mpz_clear(q);
+}
+
+
+/** Points to snarkjs's layout, via the affine coordinates of the wire encoding */
+static void put_G1( std::string& out, const G1T& point )
+{
+    const auto words = proof_to_bytes(ProofT(G1T(point), G2T::zero(), G1T::zero()), {});
+    const auto ptr = reinterpret_cast<const uint8_t*>(words.data());
+    put_mont(out, ptr);
+    put_mont(out, ptr + 32);
+}
+
+
+static void put_G2( std::string& out, const G2T& point )
+{
+    // words are x.c1, x.c0, y.c1, y.c0, snarkjs has x.c0, x.c1, y.c0, y.c1
+    const auto words = proof_to_bytes(ProofT(G1T::zero(), G2T(point), G1T::zero()), {});
+    const auto ptr = reinterpret_cast<const uint8_t*>(words.data()) + WIRE_G1_SIZE;
+    put_mont(out, ptr + 32);
+    put_mont(out, ptr);
+    put_mont(out, ptr + 96);
+    put_mont(out, ptr + 64);
+}
+
+
+/**
+* A zkey as snarkjs writes it, for a trapdoor chosen here, with the matching
+* verification key. H is committed to as the Lagrange basis of the odd points
+* of a domain of twice the size, L_{2i+1}(t) / delta.
+*/
+static std::string make_zkey( const libsnark::r1cs_constraint_system<FieldT>& cs, VerificationKeyT& vk )
+{
+    const FieldT t = FieldT::random_element();
+    const FieldT alpha = FieldT::random_element();
+    const FieldT beta = FieldT::random_element();
+    const FieldT gamma = FieldT::random_element();
+    const FieldT delta = FieldT::random_element();
+    const FieldT gamma_inverse = gamma.inverse();
+    const FieldT delta_inverse = delta.inverse();
+
+    const auto qap = libsnark::r1cs_to_qap_instance_map_with_evaluation(cs, t);
+    const size_t n_vars = qap.num_variables() + 1;
+    const size_t n_public = qap.num_inputs();
+    const size_t domain_size = qap.domain->m;
+
+    const G1T g1 = G1T::one();
+    const G2T g2 = G2T::one();
+
+    std::string groth16;
+    put_u32(groth16, 32);
+    put_bigint(groth16, LimbT(FQ_MODULUS));
+    put_u32(groth16, 32);
+    put_bigint(groth16, FieldT::mod);
+    put_u32(groth16, n_vars);
+    put_u32(groth16, n_public);
+    put_u32(groth16, domain_size);
+    put_G1(groth16, alpha * g1);
+    put_G1(groth16, beta * g1);
+    put_G2(groth16, beta * g2);
+    put_G2(groth16, gamma * g2);
+    put_G1(groth16, delta * g1);
+    put_G2(groth16, delta * g2);
+
+    std::string IC, A, B1, B2, C, H;
+    std::vector<G1T> gamma_ABC;
+    for( size_t i = 0; i < n_vars; i++ )
+    {
+        const FieldT ABC = beta * qap.At[i] + alpha * qap.Bt[i] + qap.Ct[i];
+        if( i <= n_public ) {
+            gamma_ABC.emplace_back((ABC * gamma_inverse) * g1);
+            put_G1(IC, gamma_ABC.back());
+        }
+        else {
+            put_G1(C, (ABC * delta_inverse) * g1);
+        }
+        put_G1(A, qap.At[i] * g1);
+        put_G1(B1, qap.Bt[i] * g1);
+        put_G2(B2, qap.Bt[i] * g2);
+    }
+
+    // L_k(t) = (w^k / N) * (t^N - 1) / (t - w^k) over the domain of size N = 2n
+    const FieldT w = libff::get_root_of_unity<FieldT>(2 * domain_size);
+    const FieldT Z_2n = (t ^ (2 * domain_size)) - FieldT::one();
+    const FieldT N_inverse = FieldT(2 * domain_size).inverse();
+    FieldT w_k = w;
+    for( size_t i = 0; i < domain_size; i++ )
+    {
+        const FieldT L = w_k * N_inverse * Z_2n * (t - w_k).inverse();
+        put_G1(H, (L * delta_inverse) * g1);
+        w_k = w_k * w * w;
+    }
+
+    std::string header;
+    put_u32(header, 1);
+
+    std::string out("zkey", 4);
+    put_u32(out, 1);
+    put_u32(out, 8);
+    put_section(out, 1, header);
+    put_section(out, 2, groth16);
+    put_section(out, 3, IC);
+    put_section(out, 5, A);
+    put_section(out, 6, B1);
+    put_section(out, 7, B2);
+    put_section(out, 8, C);
+    put_section(out, 9, H);
+
+    libsnark::accumulation_vector<G1T> gamma_ABC_g1(G1T(gamma_ABC[0]), std::vector<G1T>(gamma_ABC.begin() + 1, gamma_ABC.end()));
+    vk = VerificationKeyT(alpha * g1, beta * g2, gamma * g2, delta * g2, gamma_ABC_g1);
+
+    return out;
+}
+
+
+static bool write_file( const std::string& path, const std::string& data )
+{
+    std::ofstream fh(path, std::ios::binary);
+    fh.write(data.data(), data.size());
+    return fh.good();
+}
+
+
+static bool test_pk_zkey( const std::string& path )
+{
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    VerificationKeyT vk;
+    const auto zkey = make_zkey(pb.constraint_system, vk);
+    if( ! write_file(path, zkey) || ! pk_is_zkey(path.c_str()) ) {
+        std::cerr << "FAIL write zkey" << std::endl;
+        return false;
+    }
+
+    ProvingKeyT pk;
+    if( ! pk_load_zkey(path.c_str(), pk) ) {
+        std::cerr << "FAIL load zkey" << std::endl;
+        return false;
+    }
+
+    if( ! prove_and_verify(pk, vk, pb) ) {
+        std::cerr << "FAIL proof from the converted key doesn't verify" << std::endl;
+        return false;
+    }
+
+    // Truncated, a bad magic, and a point off the curve are all rejected
+    ProvingKeyT bad_pk;
+    if( ! write_file(path, zkey.substr(0, zkey.size() - 1)) || pk_load_zkey(path.c_str(), bad_pk) ) {
+        std::cerr << "FAIL loaded a truncated zkey" << std::endl;
+        return false;
+    }
+
+    std::string bad_magic = zkey;
+    bad_magic[0] = 'x';
+    if( ! write_file(path, bad_magic) || pk_load_zkey(path.c_str(), bad_pk) ) {
+        std::cerr << "FAIL loaded a zkey with a bad magic" << std::endl;
+        return false;
+    }
+
+    // Flipping the low bit of H[n-1].y moves it off the curve
+    std::string bad_point = zkey;
+    bad_point[bad_point.size() - 32] ^= 1;
+    if( ! write_file(path, bad_point) || pk_load_zkey(path.c_str(), bad_pk) ) {
+        std::cerr << "FAIL loaded a zkey with a point off the curve" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    char path[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_pk_zkey", path) ) {
+        return 1;
+    }
+
+    const bool ok = test_pk_zkey(path);
+    ::remove(path);
+
+    if( ! ok ) {
+        return 2;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
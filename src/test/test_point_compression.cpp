@@ -0,0 +1,91 @@
+#include "export.hpp"
+
+using namespace ethsnarks;
+
+
+template<typename T, size_t N>
+static bool test_roundtrip( const T& point, void (*compress)(const T&, uint8_t*), bool (*decompress)(const uint8_t*, T&) )
+{
+    uint8_t buffer[N];
+    compress(point, buffer);
+
+    T result;
+    if( ! decompress(buffer, result) ) {
+        std::cerr << "FAIL decompress" << std::endl;
+        return false;
+    }
+
+    if( result != point ) {
+        std::cerr << "FAIL point mismatch" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    if( ! test_roundtrip<G1T, 32>(G1T::zero(), compress_G1, decompress_G1) ) {
+        std::cerr << "G1 zero" << std::endl;
+        return 1;
+    }
+
+    if( ! test_roundtrip<G2T, 64>(G2T::zero(), compress_G2, decompress_G2) ) {
+        std::cerr << "G2 zero" << std::endl;
+        return 2;
+    }
+
+    // Both parities of y must be recovered, hence the negated points. With
+    // mcl the flags are in the last byte, so the first byte of about half of
+    // these has the top bit set and must not be read as infinity
+    for( int i = 0; i < 64; i++ )
+    {
+        const G1T g1 = FieldT::random_element() * G1T::one();
+        const G2T g2 = FieldT::random_element() * G2T::one();
+
+        if( ! test_roundtrip<G1T, 32>(g1, compress_G1, decompress_G1)
+         || ! test_roundtrip<G1T, 32>(-g1, compress_G1, decompress_G1) ) {
+            std::cerr << "G1 random" << std::endl;
+            return 3;
+        }
+
+        if( ! test_roundtrip<G2T, 64>(g2, compress_G2, decompress_G2)
+         || ! test_roundtrip<G2T, 64>(-g2, compress_G2, decompress_G2) ) {
+            std::cerr << "G2 random" << std::endl;
+            return 4;
+        }
+
+        if( ! G2_in_subgroup(g2) ) {
+            std::cerr << "G2 subgroup" << std::endl;
+            return 5;
+        }
+    }
+
+#ifdef CURVE_ALT_BN128
+    // A point of the twist which isn't of order r is rejected
+    typedef libff::alt_bn128_Fq2 Fq2T;
+    G2T outside;
+    while( true )
+    {
+        const Fq2T x = Fq2T::random_element();
+        const Fq2T y2 = x.squared() * x + libff::alt_bn128_twist_coeff_b;
+        if( (y2 ^ Fq2T::euler) == Fq2T::one() ) {
+            outside = G2T(x, y2.sqrt(), Fq2T::one());
+            break;
+        }
+    }
+    uint8_t buffer[64];
+    compress_G2(outside, buffer);
+    G2T result;
+    if( G2_in_subgroup(outside) || decompress_G2(buffer, result) ) {
+        std::cerr << "G2 outside the subgroup accepted" << std::endl;
+        return 6;
+    }
+#endif
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -2,7 +2,9 @@
 // License: LGPL-3.0+
 
 #include "utils.hpp"
+#include "cs_budget.hpp"
 #include "gadgets/poseidon.hpp"
+#include "gadgets/poseidon_sponge.hpp"
 #include "stubs.hpp"
 
 using ethsnarks::ppT;
@@ -28,10 +30,10 @@ static bool test_constants( ) {
         const FieldT expected;
     };
     const constant_test tests[] = {
-        {"C[0]", p.constants.C[0], FieldT("14397397413755236225575615486459253198602422701513067526754101844196324375522")},
-        {"C[-1]", p.constants.C.back(), FieldT("10635360132728137321700090133109897687122647659471659996419791842933639708516")},
-        {"M[0][0]", p.constants.M[0], FieldT("19167410339349846567561662441069598364702008768579734801591448511131028229281")},
-        {"M[-1][-1]", p.constants.M.back(), FieldT("20261355950827657195644012399234591122288573679402601053407151083849785332516")}
+        {"C[0]", p.master.gadget->constants.C[0], FieldT("14397397413755236225575615486459253198602422701513067526754101844196324375522")},
+        {"C[-1]", p.master.gadget->constants.C.back(), FieldT("10635360132728137321700090133109897687122647659471659996419791842933639708516")},
+        {"M[0][0]", p.master.gadget->constants.M[0], FieldT("19167410339349846567561662441069598364702008768579734801591448511131028229281")},
+        {"M[-1][-1]", p.master.gadget->constants.M.back(), FieldT("20261355950827657195644012399234591122288573679402601053407151083849785332516")}
     };
 
     for( const auto& t : tests )
@@ -48,15 +50,58 @@ static bool test_constants( ) {
 }
 
 
+/**
+* The sparse partial rounds must make the same outputs, with as many
+* constraints, as the dense ones
+*/
+template<typename PartialRoundsT>
+static bool partial_rounds_outputs( std::vector<FieldT>& outputs, size_t& n_constraints )
+{
+    ProtoboardT pb;
+    const auto inputs = make_var_array(pb, "input", {1, 2, 3, 4, 5, 6});
+    pb.set_input_sizes(6);
+
+    const auto& constants = ethsnarks::poseidon_params<6, 8, 57>();
+    PartialRoundsT rounds(pb, constants, ethsnarks::VariableArrayT_to_lc(inputs), "rounds");
+    rounds.generate_r1cs_constraints();
+    rounds.generate_r1cs_witness();
+
+    outputs = ethsnarks::vals(pb, rounds.outputs);
+    n_constraints = pb.num_constraints();
+    return pb.is_satisfied();
+}
+
+
+static bool test_sparse_partial_rounds() {
+    std::vector<FieldT> dense_outputs, sparse_outputs;
+    size_t dense_constraints, sparse_constraints;
+
+    if( ! partial_rounds_outputs<ethsnarks::Poseidon_DensePartialRounds<6, 1, 8, 57>>(dense_outputs, dense_constraints)
+     || ! partial_rounds_outputs<ethsnarks::Poseidon_SparsePartialRounds<6, 1, 8, 57>>(sparse_outputs, sparse_constraints) )
+    {
+        cerr << "FAIL partial rounds not satisfied" << std::endl;
+        return false;
+    }
+
+    if( dense_outputs != sparse_outputs || dense_constraints != sparse_constraints ) {
+        cerr << "FAIL sparse partial rounds differ" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
 static bool test_prove_verify() {
     ProtoboardT pb;
 
     auto var_inputs = make_var_array(pb, "input", {1, 2});
 
+    ethsnarks::CSBudgetScope cost(pb, "Poseidon128<1,2>");
     Poseidon128<1,2> the_gadget(pb, var_inputs, "gadget");    
-    the_gadget.generate_r1cs_witness();
+    cost.witness([&](){ the_gadget.generate_r1cs_witness(); });
     the_gadget.generate_r1cs_constraints();
-    if( ! pb.is_satisfied() ) {
+    if( ! pb.is_satisfied() || ! cost.check() ) {
         return false;
     }
 
@@ -71,6 +116,50 @@ static bool test_prove_verify() {
 }
 
 
+/**
+* The sponge over lengths either side of whole blocks matches its native
+* counterpart, and zero padding doesn't collide with a longer message
+*/
+static bool test_sponge() {
+    using ethsnarks::Poseidon128_sponge;
+
+    const FieldT IV(3);
+    for( size_t n : {1, 4, 5, 11} )
+    {
+        std::vector<FieldT> messages;
+        for( size_t i = 0; i < n; i++ ) {
+            messages.emplace_back(long(i + 1));
+        }
+
+        ProtoboardT pb;
+        const auto IV_var = ethsnarks::make_variable(pb, IV, "IV");
+        const auto inputs = make_var_array(pb, "input", messages);
+        Poseidon128_sponge the_gadget(pb, IV_var, std::vector<VariableT>(inputs.begin(), inputs.end()), "sponge");
+        the_gadget.generate_r1cs_witness();
+        the_gadget.generate_r1cs_constraints();
+
+        if( ! pb.is_satisfied() || pb.val(the_gadget.result()) != Poseidon128_sponge::hash(IV, messages) ) {
+            cerr << "FAIL sponge of " << n << " messages" << std::endl;
+            return false;
+        }
+
+        if( the_gadget.m_permutations.size() != (n + Poseidon128_sponge::RATE) / Poseidon128_sponge::RATE ) {
+            cerr << "FAIL sponge of " << n << " messages, wrong number of permutations" << std::endl;
+            return false;
+        }
+
+        auto padded = messages;
+        padded.emplace_back(FieldT::zero());
+        if( Poseidon128_sponge::hash(IV, padded) == Poseidon128_sponge::hash(IV, messages) ) {
+            cerr << "FAIL sponge of " << n << " messages, zero padding collides" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
 int main( int argc, char **argv )
 {
     ppT::init_public_params();
@@ -86,8 +175,43 @@ int main( int argc, char **argv )
     if( actual[0] != expected ) {
         cerr << "poseidon([1,2]) incorrect result, got ";
         actual[0].print();
+        return 3;
     }
 
+    if( ! test_sparse_partial_rounds() )
+        return 4;
+
+    if( ethsnarks::Poseidon128_hash({1, 2}) != expected )
+        return 6;
+
+    // The batch, with the same message at every even index
+    std::vector<FieldT> messages, hashes(7);
+    for( unsigned i = 0; i < hashes.size(); i++ ) {
+        messages.push_back(i % 2 ? FieldT(i) : FieldT(1));
+        messages.push_back(2);
+    }
+    ethsnarks::Poseidon128_hash_batch(messages.data(), 2, hashes.size(), hashes.data());
+    for( unsigned i = 0; i < hashes.size(); i++ ) {
+        if( hashes[i] != ethsnarks::Poseidon128_hash({messages[2*i], messages[2*i+1]}) || (i % 2 == 0 && hashes[i] != expected) ) {
+            cerr << "poseidon batch incorrect result " << i << std::endl;
+            return 7;
+        }
+    }
+
+    // The gadget's witness, with the sparse partial rounds, matches too
+    ProtoboardT pb;
+    const auto inputs = make_var_array(pb, "input", {1, 2});
+    Poseidon128<2,1> the_gadget(pb, inputs, "gadget");
+    the_gadget.generate_r1cs_witness();
+    the_gadget.generate_r1cs_constraints();
+    if( pb.val(the_gadget.result()) != expected || ! pb.is_satisfied() ) {
+        cerr << "poseidon([1,2]) gadget incorrect result" << std::endl;
+        return 5;
+    }
+
+    if( ! test_sponge() )
+        return 8;
+
     std::cout << "OK" << std::endl;
     return 0;
 }
@@ -0,0 +1,68 @@
+#include "export.hpp"
+#include "stubs.hpp"
+
+#include <algorithm>
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto pk = ProvingKeyT(keypair.pk);
+    auto vk_json = vk2json(keypair.vk);
+
+    ProverContextT context(pk);
+    init_prover_context(context, pb);
+
+    // A proof which runs to completion reports its stages and verifies
+    std::vector<std::string> stages;
+    auto task = prove_async(context, pb, false, [&stages] (const char *stage) {
+        stages.push_back(stage);
+    });
+    const auto proof_json = task->proof.get();
+
+    if( ! stub_verify(vk_json.c_str(), proof_json.c_str()) ) {
+        std::cerr << "FAIL async proof doesn't verify" << std::endl;
+        return 1;
+    }
+
+    for( const char *stage : {"evaluate", "ifft", "coset_fft", "ifft_H"} )
+    {
+        if( std::find(stages.begin(), stages.end(), stage) == stages.end() ) {
+            std::cerr << "FAIL stage " << stage << " wasn't reported" << std::endl;
+            return 2;
+        }
+    }
+
+    // A proof cancelled before it gets anywhere stops at the first checkpoint
+    task.reset(new ProveTask);
+    task->cancel();
+    context.cancel = &task->cancelled;
+    try {
+        prove_assignment(context, pb.values, false);
+        std::cerr << "FAIL cancelled proof finished" << std::endl;
+        return 3;
+    }
+    catch( const libsnark::r1cs_gg_ppzksnark_zok_cancelled& ex ) {
+        if( std::string(ex.what()) != "evaluate" ) {
+            std::cerr << "FAIL cancelled at " << ex.what() << std::endl;
+            return 4;
+        }
+    }
+    context.cancel = nullptr;
+
+    // The context still proves after a cancelled proof
+    if( ! stub_verify(vk_json.c_str(), prove_async(context, pb)->proof.get().c_str()) ) {
+        std::cerr << "FAIL proof after cancellation doesn't verify" << std::endl;
+        return 5;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
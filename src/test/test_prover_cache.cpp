@@ -0,0 +1,81 @@
+#include "prover_cache.hpp"
+#include "stubs.hpp"
+
+#include <thread>
+
+using namespace ethsnarks;
+
+
+static bool same_proof( const ProofT& a, const ProofT& b )
+{
+    return a.g_A == b.g_A && a.g_B == b.g_B && a.g_C == b.g_C;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto pk = ProvingKeyT(keypair.pk);
+    ProverContextT context(pk);
+    init_prover_context(context, pb);
+
+    ProofCache cache(pk, 1, 1);
+    const auto values_0 = pb.values;
+    const auto proof_0 = prove_cached(context, cache, values_0);
+    if( ! same_proof(prove_cached(context, cache, values_0), proof_0) || cache.hits() != 1 || cache.misses() != 1 ) {
+        std::cerr << "FAIL repeated witness not cached" << std::endl;
+        return 1;
+    }
+
+    // Another witness evicts the first, the cache only holds one
+    ProtoboardT other_pb;
+    make_mimc_circuit(other_pb, FieldT(1234));
+    const auto values_1 = other_pb.values;
+    const auto proof_1 = prove_cached(context, cache, values_1);
+    if( same_proof(proof_0, proof_1) || cache.size() != 1 || cache.key(values_0) == cache.key(values_1) ) {
+        std::cerr << "FAIL different witnesses share a proof" << std::endl;
+        return 2;
+    }
+
+    ProofT proof;
+    if( cache.lookup(cache.key(values_0), proof) ) {
+        std::cerr << "FAIL least recently used not evicted" << std::endl;
+        return 3;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    if( cache.lookup(cache.key(values_1), proof) ) {
+        std::cerr << "FAIL expired proof returned" << std::endl;
+        return 4;
+    }
+
+    // Re-randomized proofs differ from each other and still verify
+    const auto random_1 = prove_cached(context, cache, values_1, true);
+    const auto random_2 = prove_cached(context, cache, values_1, true);
+    if( same_proof(random_1, proof_1) || same_proof(random_1, random_2) ) {
+        std::cerr << "FAIL proof not re-randomized" << std::endl;
+        return 5;
+    }
+
+    // The verification key's delta is enough
+    const auto random_vk = rerandomize_proof(keypair.vk.delta_g2, proof_1);
+    if( same_proof(random_vk, proof_1) ) {
+        std::cerr << "FAIL proof not re-randomized with the verification key" << std::endl;
+        return 5;
+    }
+
+    for( const auto& p : {proof_1, random_1, random_2, random_vk} ) {
+        if( ! libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(keypair.vk, other_pb.primary_input(), p) ) {
+            std::cerr << "FAIL" << std::endl;
+            return 6;
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "prover_metrics.hpp"
+
+#include <cstring>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace ethsnarks;
+
+
+static bool contains( const std::string& text, const std::string& line )
+{
+    return text.find(line + "\n") != std::string::npos;
+}
+
+
+/** The whole response to a GET of `path` from the server on localhost */
+static std::string http_get( unsigned int port, const std::string& path )
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if( fd < 0 || 0 != ::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) ) {
+        return std::string();
+    }
+
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if( ::write(fd, request.data(), request.size()) != ssize_t(request.size()) ) {
+        ::close(fd);
+        return std::string();
+    }
+
+    std::string response;
+    char buf[4096];
+    ssize_t n;
+    while( (n = ::read(fd, buf, sizeof(buf))) > 0 ) {
+        response.append(buf, n);
+    }
+    ::close(fd);
+    return response;
+}
+
+
+int main( void )
+{
+    ProverMetrics metrics(4);
+
+    // Two proofs, the second with phases, and a failed request
+    metrics.begin_proof();
+    metrics.record_proof(0.02, 0.06);
+
+    libsnark::ProverStats stats;
+    stats.begin_phase("fft");
+    stats.end_phase("fft", 0);
+    stats.begin_phase("fft");
+    stats.end_phase("fft", 0);
+    stats.begin_phase("total");
+    stats.end_phase("total", 0);
+    metrics.begin_proof();
+    metrics.record_proof(3, 10, &stats);
+
+    metrics.begin_proof();
+    metrics.record_error();
+
+    size_t depth = 7;
+    metrics.add_gauge("test_queue_depth", "Waiting", [&depth](){ return double(depth); });
+    depth = 5;
+
+    const auto text = metrics.to_prometheus();
+    if( ! contains(text, "ethsnarks_proofs_total 2")
+     || ! contains(text, "ethsnarks_proof_errors_total 1")
+     || ! contains(text, "ethsnarks_proofs_in_progress 0")
+     || ! contains(text, "ethsnarks_prover_cpu_seconds_total 10.06")
+     || ! contains(text, "ethsnarks_prover_threads 4")
+     || ! contains(text, "# TYPE test_queue_depth gauge")
+     || ! contains(text, "test_queue_depth 5") ) {
+        std::cerr << "FAIL totals\n" << text << std::endl;
+        return 1;
+    }
+
+    // The buckets are cumulative, one proof is below 25ms and both below 5s
+    if( ! contains(text, "ethsnarks_proof_seconds_bucket{le=\"0.01\"} 0")
+     || ! contains(text, "ethsnarks_proof_seconds_bucket{le=\"0.025\"} 1")
+     || ! contains(text, "ethsnarks_proof_seconds_bucket{le=\"2.5\"} 1")
+     || ! contains(text, "ethsnarks_proof_seconds_bucket{le=\"5\"} 2")
+     || ! contains(text, "ethsnarks_proof_seconds_bucket{le=\"+Inf\"} 2")
+     || ! contains(text, "ethsnarks_proof_seconds_count 2") ) {
+        std::cerr << "FAIL proof histogram\n" << text << std::endl;
+        return 2;
+    }
+
+    // A phase which ran twice is observed once
+    if( ! contains(text, "ethsnarks_prover_phase_seconds_count{phase=\"fft\"} 1")
+     || ! contains(text, "ethsnarks_prover_phase_seconds_bucket{phase=\"total\",le=\"+Inf\"} 1") ) {
+        std::cerr << "FAIL phase histogram\n" << text << std::endl;
+        return 3;
+    }
+
+    MetricsServer server(metrics, 0);
+    if( ! server.listening() || server.port() == 0 ) {
+        std::cerr << "FAIL listen" << std::endl;
+        return 4;
+    }
+
+    const auto response = http_get(server.port(), "/metrics");
+    if( response.compare(0, 15, "HTTP/1.1 200 OK") != 0 || response.find("test_queue_depth 5\n") == std::string::npos ) {
+        std::cerr << "FAIL GET /metrics\n" << response << std::endl;
+        return 5;
+    }
+
+    if( http_get(server.port(), "/other").compare(0, 12, "HTTP/1.1 404") != 0 ) {
+        std::cerr << "FAIL GET /other" << std::endl;
+        return 6;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
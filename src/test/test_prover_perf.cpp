@@ -0,0 +1,61 @@
+#include "stubs.hpp"
+#include "gadgets/mimc.hpp"
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    VariableT x = make_variable(pb, FieldT("3703141493535563179657531719960160174296085208671919316200479060314459804651"), "x");
+    pb.set_input_sizes(1);
+    VariableT k = make_variable(pb, FieldT("134551314051432487569247388144051420116740427803855572138106146683954151557"), "k");
+    MiMC_e7_gadget the_gadget(pb, x, k, "the_gadget");
+    the_gadget.generate_r1cs_constraints();
+    the_gadget.generate_r1cs_witness();
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    ProvingKeyT pk(keypair.pk);
+    ProverContextT context(pk);
+    init_prover_context(context, pb, libsnark::Config());
+
+    libsnark::ProverStats stats;
+    stats.hardware_counters = true;
+    context.stats = &stats;
+
+    const auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(keypair.vk, pb.primary_input(), proof) ) {
+        std::cerr << "FAIL proof doesn't verify" << std::endl;
+        return 1;
+    }
+
+    // The flag survives the prover clearing the stats
+    if( ! stats.hardware_counters || stats.phases.empty() ) {
+        std::cerr << "FAIL stats cleared" << std::endl;
+        return 2;
+    }
+
+    // Where perf_event is forbidden, e.g. in containers, there are no counters
+    const bool available = libsnark::perf_counters_available();
+    const auto parsed = nlohmann::json::parse(prover_stats_to_json(stats));
+    for( const auto& phase : parsed["phases"] )
+    {
+        if( phase.count("counters") != (available ? 1 : 0) ) {
+            std::cerr << "FAIL phase " << phase["name"] << " counters" << std::endl;
+            return 3;
+        }
+    }
+
+    for( const auto& phase : stats.phases )
+    {
+        if( available && phase.name == "total" && phase.counters.instructions == 0 && phase.counters.cycles == 0 ) {
+            std::cerr << "FAIL nothing counted" << std::endl;
+            return 4;
+        }
+    }
+
+    std::cout << (available ? "OK" : "OK (no hardware counters)") << std::endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "prover_scheduler.hpp"
+#include "stubs.hpp"
+
+#include <mutex>
+
+using namespace ethsnarks;
+
+
+struct Circuit
+{
+    ProtoboardT pb;
+    ProvingKeyT pk;
+    std::string vk_json;
+    std::unique_ptr<ProverContextT> context;
+
+    Circuit( size_t num_messages )
+    {
+        make_mimc_circuit(pb, FieldT(MIMC_TEST_MESSAGE), num_messages);
+        auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+        pk = ProvingKeyT(keypair.pk);
+        vk_json = vk2json(keypair.vk);
+        context.reset(new ProverContextT(pk));
+        init_prover_context(*context, pb);
+    }
+};
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    // Two circuits, with different proving keys, sharing one scheduler
+    Circuit small(1);
+    Circuit large(4);
+
+    ProverScheduler scheduler(1);
+
+    // Proofs are admitted by priority, then in the order submitted
+    std::mutex order_mutex;
+    std::vector<std::string> order;
+    auto record = [&order, &order_mutex] (const char *name) {
+        return [&order, &order_mutex, name] (const char *stage) {
+            if( std::string(stage) == "evaluate" ) {
+                std::lock_guard<std::mutex> lock(order_mutex);
+                order.push_back(name);
+            }
+        };
+    };
+
+    scheduler.suspend();
+    auto batch_1 = scheduler.submit(*large.context, large.pb, 0, false, record("batch_1"));
+    auto batch_2 = scheduler.submit(*small.context, small.pb, 0, false, record("batch_2"));
+    auto urgent = scheduler.submit(*small.context, small.pb, 10, false, record("urgent"));
+    auto cancelled = scheduler.submit(*large.context, large.pb, 0, false, record("cancelled"));
+    cancelled->cancel();
+    scheduler.resume();
+    scheduler.wait();
+
+    const std::vector<std::string> expected_order = {"urgent", "batch_1", "batch_2"};
+    if( order != expected_order ) {
+        std::cerr << "FAIL proofs admitted out of order" << std::endl;
+        return 1;
+    }
+
+    if( ! stub_verify(large.vk_json.c_str(), batch_1->proof.get().c_str())
+     || ! stub_verify(small.vk_json.c_str(), batch_2->proof.get().c_str())
+     || ! stub_verify(small.vk_json.c_str(), urgent->proof.get().c_str()) ) {
+        std::cerr << "FAIL scheduled proof doesn't verify" << std::endl;
+        return 2;
+    }
+
+    try {
+        cancelled->proof.get();
+        std::cerr << "FAIL cancelled proof finished" << std::endl;
+        return 3;
+    }
+    catch( const libsnark::r1cs_gg_ppzksnark_zok_cancelled& ) {
+    }
+
+    if( scheduler.busy_threads() != 0 || scheduler.num_waiting() != 0 ) {
+        std::cerr << "FAIL scheduler isn't idle" << std::endl;
+        return 4;
+    }
+
+    // Proofs of both circuits at once, within a budget of two threads
+    ProverScheduler shared(2);
+    std::vector<std::shared_ptr<ProveTask>> tasks;
+    for( int i = 0; i < 4; i++ ) {
+        tasks.push_back(shared.submit(*small.context, small.pb, i % 2));
+        tasks.push_back(shared.submit(*large.context, large.pb, i % 2));
+    }
+
+    for( size_t i = 0; i < tasks.size(); i++ )
+    {
+        const auto& vk_json = (i % 2) ? large.vk_json : small.vk_json;
+        if( ! stub_verify(vk_json.c_str(), tasks[i]->proof.get().c_str()) ) {
+            std::cerr << "FAIL concurrent proof " << i << " doesn't verify" << std::endl;
+            return 5;
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "pk_mmap.hpp"
+#include "prover_shard.hpp"
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+#include <fstream>
+
+using namespace ethsnarks;
+
+
+/**
+* The shares of every shard, computed in-process rather than by workers, sum
+* to the same proof as the whole key gives
+*/
+static bool test_prover_shard( size_t num_shards )
+{
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto pk = ProvingKeyT(keypair.pk);
+
+    char pk_file[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_prover_shard", pk_file) || ! pk_write_mmap(pk, pk_file) ) {
+        return false;
+    }
+
+    const bool split = pk_split(pk_file, num_shards, pk_file);
+    ::remove(pk_file);
+    if( ! split ) {
+        std::cerr << "FAIL pk_split" << std::endl;
+        return false;
+    }
+
+    std::vector<ProverShardInfo> shards(num_shards);
+    for( size_t i = 0; i < num_shards; i++ )
+    {
+        if( ! load_shard_info(prover_shard_path(pk_file, i).c_str(), shards[i]) ) {
+            return false;
+        }
+    }
+
+    ProvingKeyT coordinator_pk;
+    coordinator_pk.alpha_g1 = pk.alpha_g1;
+    coordinator_pk.beta_g2 = pk.beta_g2;
+    ProverContextT coordinator(coordinator_pk);
+    init_prover_context(coordinator, pb);
+
+    if( ! write_shard_requests(coordinator, pb.values, shards, pk_file) ) {
+        std::cerr << "FAIL write_shard_requests" << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    std::vector<ProofT> shares(num_shards);
+    for( size_t i = 0; i < num_shards; i++ )
+    {
+        const auto shard_file = prover_shard_path(pk_file, i);
+        const auto base_path = std::string(pk_file) + "." + std::to_string(i);
+
+        auto shard_pk = load_proving_key(shard_file.c_str());
+        ProverContextT context(shard_pk);
+
+        // A request whose count is too large is rejected, not allocated
+        if( i == 0 )
+        {
+            const uint64_t huge = ~uint64_t(0) >> 8;
+            std::ofstream((base_path + ".bad").c_str(), std::ios::binary)
+                .write("ESSHREQ", 8)
+                .write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+            const bool proved = prove_shard(context, shards[i], (base_path + ".bad").c_str(), (base_path + ".share").c_str());
+            ::remove((base_path + ".bad").c_str());
+            if( proved ) {
+                std::cerr << "FAIL prove_shard of an oversized request" << std::endl;
+                return false;
+            }
+        }
+
+        ok = ok && prove_shard(context, shards[i], (base_path + ".request").c_str(), (base_path + ".share").c_str())
+                && read_shard_share((base_path + ".share").c_str(), shares[i]);
+
+        ::remove(shard_file.c_str());
+        ::remove((shard_file + ".json").c_str());
+        ::remove((base_path + ".request").c_str());
+        ::remove((base_path + ".share").c_str());
+    }
+
+    if( ! ok ) {
+        std::cerr << "FAIL prove_shard" << std::endl;
+        return false;
+    }
+
+    auto proof = combine_shard_shares(coordinator_pk, shares);
+
+    ProverContextT context(pk);
+    init_prover_context(context, pb);
+    const auto expected = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+
+    if( proof.g_A != expected.g_A || proof.g_B != expected.g_B || proof.g_C != expected.g_C ) {
+        std::cerr << "FAIL combined proof differs with " << num_shards << " shards" << std::endl;
+        return false;
+    }
+
+    return libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(keypair.vk, pb.primary_input(), proof);
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    // Jobs stay inside the spool directory
+    if( ! shard_job_valid("test_prover_shard.x1Y2.0") || shard_job_valid("") || shard_job_valid("../etc/passwd")
+     || shard_job_valid("/etc/passwd") || shard_job_valid("a/b") || shard_job_valid("a..b") || shard_job_valid(".hidden")
+     || shard_spool_dir("/tmp/shards/key") != "/tmp/shards" || shard_spool_dir("key") != "." ) {
+        std::cerr << "FAIL job names" << std::endl;
+        return 2;
+    }
+
+    for( size_t num_shards : {1, 2, 3, 7} )
+    {
+        if( ! test_prover_shard(num_shards) ) {
+            std::cerr << "FAIL" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
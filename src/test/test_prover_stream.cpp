@@ -0,0 +1,66 @@
+#include "pk_mmap.hpp"
+#include "prover_stream.hpp"
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto pk = ProvingKeyT(keypair.pk);
+
+    char pk_file[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_prover_stream", pk_file) || ! pk_write_mmap(pk, pk_file) ) {
+        return 1;
+    }
+
+    ProverContextT context(pk);
+    init_prover_context(context, pb);
+    const auto expected = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+
+    ProvingKeyT streamed_pk;
+    ProvingKeyMmapHeader header;
+    if( ! pk_load_mmap_AB(pk_file, streamed_pk, header) || ! streamed_pk.H_query.empty() || ! streamed_pk.L_query.empty() ) {
+        std::cerr << "FAIL pk_load_mmap_AB" << std::endl;
+        ::remove(pk_file);
+        return 2;
+    }
+
+    ProverContextT streamed(streamed_pk);
+    init_prover_context(streamed, pb);
+
+    // Budgets of one point per chunk, a few, and all of them at once
+    for( size_t points : {1, 3, 1 << 20} )
+    {
+        ProofT proof;
+        if( ! prove_streamed(streamed, pb.values, pk_file, header, 2 * points * sizeof(G1T), proof) ) {
+            std::cerr << "FAIL prove_streamed" << std::endl;
+            ::remove(pk_file);
+            return 3;
+        }
+
+        if( proof.g_A != expected.g_A || proof.g_B != expected.g_B || proof.g_C != expected.g_C ) {
+            std::cerr << "FAIL streamed proof differs with " << points << " points per chunk" << std::endl;
+            ::remove(pk_file);
+            return 4;
+        }
+    }
+
+    ::remove(pk_file);
+
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(keypair.vk, pb.primary_input(), expected) ) {
+        std::cerr << "FAIL" << std::endl;
+        return 5;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "gadgets/public_inputs_hash.hpp"
+#include "utils.hpp"
+
+using namespace ethsnarks;
+
+
+static const size_t N_VALUES = 7;
+
+
+template<typename HashT>
+static bool test_public_inputs_hash( const char *name )
+{
+    std::vector<FieldT> values;
+    for( size_t i = 0; i < N_VALUES; i++ ) {
+        values.push_back(FieldT::random_element());
+    }
+    values[0] = FieldT::zero() - FieldT::one();
+
+    ProtoboardT pb;
+    VariableArrayT digest = make_var_array(pb, HashT::DIGEST_SIZE, "digest");
+    pb.set_input_sizes(digest.size());
+    VariableArrayT state = make_var_array(pb, "state", values);
+
+    HashT the_gadget(pb, digest, state, "the_gadget");
+    the_gadget.generate_r1cs_constraints();
+    the_gadget.generate_r1cs_witness();
+
+    if( ! pb.is_satisfied() ) {
+        std::cerr << "FAIL " << name << " not satisfied" << std::endl;
+        return false;
+    }
+
+    // The digest is the whole primary input, and the verifier computes it natively
+    if( pb.primary_input() != HashT::digest(values) ) {
+        std::cerr << "FAIL " << name << " native digest differs" << std::endl;
+        return false;
+    }
+
+    auto changed = values;
+    changed.back() += FieldT::one();
+    if( HashT::digest(changed) == HashT::digest(values) ) {
+        std::cerr << "FAIL " << name << " digest doesn't depend on the values" << std::endl;
+        return false;
+    }
+
+    // A digest other than the hash of the values isn't accepted
+    pb.val(digest[0]) += FieldT::one();
+    if( pb.is_satisfied() ) {
+        std::cerr << "FAIL " << name << " wrong digest satisfied" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    if( ! test_public_inputs_hash<public_inputs_hash_sha256>("sha256") ) {
+        return 1;
+    }
+
+    if( ! test_public_inputs_hash<public_inputs_hash_mimc>("mimc") ) {
+        return 2;
+    }
+
+    if( ! test_public_inputs_hash<public_inputs_hash_poseidon>("poseidon") ) {
+        return 3;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "stubs.hpp"
+
+using namespace ethsnarks;
+using libsnark::query_index_map;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    // Segments which are dense, half full, nearly empty, empty, and a short
+    // dense one at the end of the domain
+    const size_t S = query_index_map::SEGMENT_SIZE;
+    const size_t domain_size = (4 * S) + 100;
+    std::vector<size_t> indices;
+    for( size_t i = 0; i < S; i++ ) {
+        indices.push_back(i);
+    }
+    for( size_t i = S; i < 2 * S; i += 2 ) {
+        indices.push_back(i);
+    }
+    for( size_t i = 2 * S; i < 3 * S; i += 1000 ) {
+        indices.push_back(i);
+    }
+    for( size_t i = 4 * S; i < domain_size; i++ ) {
+        indices.push_back(i);
+    }
+
+    const query_index_map map(indices, domain_size);
+    if( map.size() != indices.size() || map.indices() != indices ) {
+        std::cerr << "FAIL indices" << std::endl;
+        return 1;
+    }
+
+    if( map.segments().size() != 4
+     || map.num_segments(query_index_map::encoding_dense) != 2
+     || map.num_segments(query_index_map::encoding_bitmap) != 1
+     || map.num_segments(query_index_map::encoding_offsets) != 1 ) {
+        std::cerr << "FAIL encodings" << std::endl;
+        return 2;
+    }
+
+    // At most an eighth of the bits of the indices as size_t
+    if( map.size_in_bits() != query_index_map::size_in_bits(indices, domain_size)
+     || map.size_in_bits() >= indices.size() * 8 ) {
+        std::cerr << "FAIL size in bits: " << map.size_in_bits() << std::endl;
+        return 3;
+    }
+
+    // The sorted MSM gathers the same scalars through the map
+    const size_t n = indices.size();
+    std::vector<G1T> bases;
+    for( size_t i = 0; i < n; i++ ) {
+        bases.push_back(i % 5 ? G1T::random_element() : G1T::zero());
+    }
+    std::vector<FieldT> scalars;
+    for( size_t i = 0; i < domain_size; i++ ) {
+        scalars.push_back(FieldT::random_element());
+    }
+
+    libsnark::Config config;
+    std::vector<LimbT> scratch(n);
+    const G1T expected = libsnark::r1cs_gg_ppzksnark_zok_sorted_multi_exp<G1T, FieldT>(
+        bases.begin(), &indices, scalars.begin(), n, scratch, config);
+    const G1T mapped = libsnark::r1cs_gg_ppzksnark_zok_sorted_multi_exp<G1T, FieldT>(
+        bases.begin(), nullptr, scalars.begin(), n, scratch, config, &map);
+    if( mapped != expected ) {
+        std::cerr << "FAIL sorted multi-exp through the map" << std::endl;
+        return 4;
+    }
+
+    // And reads the bases through their positions, rather than a copy
+    std::vector<size_t> positions;
+    std::vector<G1T> copied;
+    for( size_t i = 0; i < n; i += 3 ) {
+        positions.push_back(n - 1 - i);
+        copied.push_back(bases[n - 1 - i]);
+    }
+    const G1T gathered = libsnark::r1cs_gg_ppzksnark_zok_sorted_multi_exp<G1T, FieldT>(
+        copied.begin(), nullptr, scalars.begin(), positions.size(), scratch, config);
+    const G1T indexed = libsnark::r1cs_gg_ppzksnark_zok_sorted_multi_exp<G1T, FieldT>(
+        bases.begin(), nullptr, scalars.begin(), positions.size(), scratch, config, nullptr, positions.data());
+    if( indexed != gathered ) {
+        std::cerr << "FAIL sorted multi-exp through the base positions" << std::endl;
+        return 5;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,274 @@
+#include "export.hpp"
+#include "import.hpp"
+#include "stubs.hpp"
+
+#include <cstdio>   // remove
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <nlohmann/json.hpp>
+
+using namespace ethsnarks;
+
+
+static std::vector<uint8_t> read_file( const char *path )
+{
+    std::ifstream fh(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(fh), std::istreambuf_iterator<char>());
+}
+
+
+static uint64_t get_le( const std::vector<uint8_t>& data, size_t offset, size_t n )
+{
+    uint64_t out = 0;
+    for( size_t i = 0; i < n; i++ ) {
+        out |= uint64_t(data[offset + i]) << (i * 8);
+    }
+    return out;
+}
+
+
+static FieldT get_field( const std::vector<uint8_t>& data, size_t offset )
+{
+    LimbT value;
+    for( size_t i = 0; i < 32; i++ ) {
+        const size_t bit = i * 8;
+        value.data[bit / GMP_NUMB_BITS] |= mp_limb_t(data[offset + i]) << (bit % GMP_NUMB_BITS);
+    }
+    return FieldT(value);
+}
+
+
+bool test_wtns( ProtoboardT& pb, const char *path )
+{
+    if( ! witness2wtns(pb, path) ) {
+        return false;
+    }
+    const auto data = read_file(path);
+    const size_t n_wires = pb.num_variables() + 1;
+
+    // magic, version, sections, header section (12 + 40), values section (12 + 32 * n)
+    if( data.size() != 12 + 52 + 12 + (32 * n_wires)
+     || 0 != ::memcmp(data.data(), "wtns", 4)
+     || get_le(data, 12 + 12 + 36, 4) != n_wires
+     || get_le(data, 12 + 52 + 4, 8) != 32 * n_wires ) {
+        std::cerr << "FAIL wtns layout" << std::endl;
+        return false;
+    }
+
+    for( size_t i = 0; i < n_wires; i++ ) {
+        if( get_field(data, 12 + 52 + 12 + (32 * i)) != pb.val(i) ) {
+            std::cerr << "FAIL wtns value " << i << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool test_r1cs( ProtoboardT& pb, const char *path )
+{
+    if( ! r1cs2bin(pb, path) ) {
+        return false;
+    }
+    const auto data = read_file(path);
+    const auto& cs = pb.constraint_system;
+
+    // The header section is 64 bytes, the constraints section follows it
+    if( 0 != ::memcmp(data.data(), "r1cs", 4)
+     || get_le(data, 4, 4) != 1
+     || get_le(data, 12, 4) != 1
+     || get_le(data, 16, 8) != 64
+     || get_le(data, 24 + 36, 4) != pb.num_variables() + 1
+     || get_le(data, 24 + 44, 4) != cs.primary_input_size
+     || get_le(data, 24 + 60, 4) != cs.num_constraints()
+     || get_le(data, 88, 4) != 2 ) {
+        std::cerr << "FAIL r1cs header" << std::endl;
+        return false;
+    }
+
+    // Walk every linear combination and compare it with the constraint system
+    size_t offset = 100;
+    for( size_t c = 0; c < cs.num_constraints(); c++ )
+    {
+        for( const auto& lc : {cs.constraints[c]->getA(), cs.constraints[c]->getB(), cs.constraints[c]->getC()} )
+        {
+            const auto& terms = lc.getTerms();
+            if( get_le(data, offset, 4) != terms.size() ) {
+                std::cerr << "FAIL r1cs terms in constraint " << c << std::endl;
+                return false;
+            }
+            offset += 4;
+            for( const auto& lt : terms ) {
+                if( get_le(data, offset, 4) != lt.index || get_field(data, offset + 4) != lt.getCoeff() ) {
+                    std::cerr << "FAIL r1cs term in constraint " << c << std::endl;
+                    return false;
+                }
+                offset += 36;
+            }
+        }
+    }
+
+    if( get_le(data, 92, 8) != offset - 100 || get_le(data, offset, 4) != 3 ) {
+        std::cerr << "FAIL r1cs section sizes" << std::endl;
+        return false;
+    }
+
+    // Importing it again gives the same constraints, satisfied by the witness
+    libsnark::r1cs_constraint_system<FieldT> imported;
+    if( ! is_r1cs_bin(path) || ! r1cs_from_bin(path, imported) ) {
+        std::cerr << "FAIL r1cs import" << std::endl;
+        return false;
+    }
+    if( imported.primary_input_size != cs.primary_input_size
+     || imported.auxiliary_input_size != cs.auxiliary_input_size
+     || imported.num_constraints() != cs.num_constraints()
+     || ! imported.is_satisfied(pb.primary_input(), pb.auxiliary_input()) ) {
+        std::cerr << "FAIL r1cs import sizes" << std::endl;
+        return false;
+    }
+    for( size_t c = 0; c < cs.num_constraints(); c++ )
+    {
+        const auto& a = cs.constraints[c];
+        const auto& b = imported.constraints[c];
+        if( a->getA().getTerms().size() != b->getA().getTerms().size()
+         || a->getB().getTerms().size() != b->getB().getTerms().size()
+         || a->getC().getTerms().size() != b->getC().getTerms().size() ) {
+            std::cerr << "FAIL r1cs import constraint " << c << std::endl;
+            return false;
+        }
+    }
+
+    // A corrupt file isn't imported
+    {
+        std::vector<uint8_t> corrupt = data;
+        corrupt[100 + 4] = 0xFF;            // first wire of the first term
+        corrupt[100 + 5] = 0xFF;
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(corrupt.data()), corrupt.size());
+    }
+    if( r1cs_from_bin(path, imported) ) {
+        std::cerr << "FAIL r1cs import of a corrupt file" << std::endl;
+        return false;
+    }
+
+    // Nor one whose header claims more constraints than the section holds
+    {
+        std::vector<uint8_t> corrupt = data;
+        ::memset(&corrupt[24 + 60], 0xFF, 4);
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(corrupt.data()), corrupt.size());
+    }
+    if( r1cs_from_bin(path, imported) ) {
+        std::cerr << "FAIL r1cs import with too many constraints" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+static std::string mpz_string( const LimbT& value, int base )
+{
+    mpz_t z;
+    ::mpz_init(z);
+    value.to_mpz(z);
+    char *str = ::mpz_get_str(nullptr, base, z);
+    const std::string out(str);
+    ::mpz_clear(z);
+    ::free(str);
+    return out;
+}
+
+
+bool test_format()
+{
+    std::vector<LimbT> values = {LimbT(0), LimbT(1), LimbT(15), LimbT(16), (-FieldT::one()).as_bigint()};
+    for( int i = 0; i < 100; i++ ) {
+        values.push_back(FieldT::random_element().as_bigint());
+    }
+    for( const auto& value : values )
+    {
+        if( HexStringFromBigint(value) != mpz_string(value, 16)
+         || bigintToString(value) != mpz_string(value, 10)
+         || bigintToString(value, 7) != mpz_string(value, 7) ) {
+            std::cerr << "FAIL format " << mpz_string(value, 10) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool test_json( ProtoboardT& pb, const char *path )
+{
+    if( ! witness2json(pb, path) ) {
+        return false;
+    }
+    std::ifstream witness_fh(path);
+    const auto witness = nlohmann::json::parse(witness_fh);
+    if( witness.size() != pb.num_variables() + 1 ) {
+        std::cerr << "FAIL witness json size" << std::endl;
+        return false;
+    }
+    for( size_t i = 0; i < witness.size(); i++ ) {
+        if( FieldT(witness[i].get<std::string>().c_str()) != pb.val(i) ) {
+            std::cerr << "FAIL witness json value " << i << std::endl;
+            return false;
+        }
+    }
+
+    if( ! r1cs2json(pb, path) ) {
+        return false;
+    }
+    std::ifstream r1cs_fh(path);
+    const auto r1cs = nlohmann::json::parse(r1cs_fh);
+    const auto& cs = pb.constraint_system;
+    if( r1cs["nConstraints"] != cs.num_constraints() || r1cs["constraints"].size() != cs.num_constraints() ) {
+        std::cerr << "FAIL r1cs json size" << std::endl;
+        return false;
+    }
+    for( size_t c = 0; c < cs.num_constraints(); c++ )
+    {
+        const auto& row = r1cs["constraints"][c];
+        size_t j = 0;
+        for( const auto& lc : {cs.constraints[c]->getA(), cs.constraints[c]->getB(), cs.constraints[c]->getC()} )
+        {
+            const auto& terms = lc.getTerms();
+            if( row[j].size() != terms.size() ) {
+                std::cerr << "FAIL r1cs json terms in constraint " << c << std::endl;
+                return false;
+            }
+            for( const auto& lt : terms ) {
+                if( FieldT(row[j][std::to_string(lt.index)].get<std::string>().c_str()) != lt.getCoeff() ) {
+                    std::cerr << "FAIL r1cs json term in constraint " << c << std::endl;
+                    return false;
+                }
+            }
+            j++;
+        }
+    }
+    return true;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    char path[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_r1cs_bin", path) ) {
+        return 1;
+    }
+
+    const bool ok = test_format() && test_wtns(pb, path) && test_r1cs(pb, path) && test_json(pb, path);
+    ::remove(path);
+
+    if( ! ok ) {
+        return 2;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
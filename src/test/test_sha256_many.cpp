@@ -1,6 +1,7 @@
 #include <libff/algebra/curves/alt_bn128/alt_bn128_pp.hpp>
 
 #include "gadgets/sha256_many.cpp"
+#include "cs_budget.hpp"
 #include "utils.hpp"
 
 
@@ -38,8 +39,9 @@ bool test_sha256_many(uint8_t *input_buffer, size_t input_len)
     const libff::bit_vector block_bits = bytes_to_bv(input_buffer, input_len);
     block.fill_with_bits(pb, block_bits);
 
+    CSBudgetScope cost(pb, FMT("sha256_many", "[%zu]", input_len));
     sha256_many the_gadget(pb, block, "the_gadget");
-    the_gadget.generate_r1cs_witness();
+    cost.witness([&](){ the_gadget.generate_r1cs_witness(); });
     the_gadget.generate_r1cs_constraints();
 
     // Display the bits for each block
@@ -83,7 +85,7 @@ bool test_sha256_many(uint8_t *input_buffer, size_t input_len)
     }
     printf("\n");
 
-    return pb.is_satisfied();
+    return pb.is_satisfied() && cost.check();
 }
 
 
@@ -110,6 +112,76 @@ bool test_sha256_rand(size_t n) {
 }
 
 
+/**
+* A message after two constant blocks, hashed from their native midstate and
+* from the midstate as variables, costs the same as hashing it on its own
+*/
+bool test_sha256_midstate()
+{
+    const size_t prefix_blocks = 2;
+    const size_t prefix_len = prefix_blocks * SHA256_block_size_bytes;
+    uint8_t message[prefix_len + 40];
+    for( size_t i = 0; i < sizeof(message); i++ ) {
+        message[i] = (i * 7) % 0xFF;
+    }
+
+    uint8_t expected[SHA256_digest_size_bytes];
+    SHA256(message, sizeof(message), expected);
+
+    uint32_t midstate[8];
+    SHA256_Midstate(message, prefix_blocks, midstate);
+
+    const uint8_t *suffix = message + prefix_len;
+    const size_t suffix_len = sizeof(message) - prefix_len;
+    uint8_t native[SHA256_digest_size_bytes];
+    sha256_many_native_midstate(midstate, prefix_blocks, &suffix, &suffix_len, 1, native);
+    if( memcmp(native, expected, sizeof(expected)) != 0 ) {
+        std::cerr << "native midstate mismatch" << std::endl;
+        return false;
+    }
+
+    ProtoboardT pb;
+    VariableArrayT state;
+    state.allocate(pb, SHA256_digest_size, "state");
+    state.fill_with_bits(pb, libff::int_list_to_bits({midstate[0], midstate[1], midstate[2], midstate[3],
+                                                      midstate[4], midstate[5], midstate[6], midstate[7]}, 32));
+    VariableArrayT block;
+    block.allocate(pb, suffix_len * 8, "block");
+    block.fill_with_bits(pb, bytes_to_bv(suffix, suffix_len));
+
+    const size_t before = pb.num_constraints();
+    sha256_many constant(pb, midstate, prefix_blocks, block, "constant");
+    sha256_many variables(pb, state, prefix_blocks, block, "variables");
+    constant.generate_r1cs_witness();
+    constant.generate_r1cs_constraints();
+    variables.generate_r1cs_witness();
+    variables.generate_r1cs_constraints();
+
+    for( const auto* gadget : {&constant, &variables} )
+    {
+        uint8_t digest[SHA256_digest_size_bytes];
+        bv_to_bytes(gadget->result().get_digest(), digest);
+        if( memcmp(digest, expected, sizeof(expected)) != 0 ) {
+            std::cerr << "midstate digest mismatch" << std::endl;
+            return false;
+        }
+    }
+
+    // Only the suffix is compressed, the same as a message of its size
+    ProtoboardT plain_pb;
+    VariableArrayT plain_block;
+    plain_block.allocate(plain_pb, suffix_len * 8, "block");
+    sha256_many plain(plain_pb, plain_block, "plain");
+    plain.generate_r1cs_constraints();
+    if( pb.num_constraints() - before != 2 * plain_pb.num_constraints() ) {
+        std::cerr << "midstate constraints: " << (pb.num_constraints() - before) << " for two, expected " << plain_pb.num_constraints() << " each" << std::endl;
+        return false;
+    }
+
+    return pb.is_satisfied();
+}
+
+
 // namespace ethsnarks
 }
 
@@ -142,6 +214,12 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if( ! ethsnarks::test_sha256_midstate() )
+    {
+        std::cerr << "FAIL (midstate)" << std::endl;
+        return 1;
+    }
+
 	std::cout << "OK" << std::endl;
 	return 0;
 }
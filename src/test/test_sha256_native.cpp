@@ -0,0 +1,88 @@
+#include "crypto/sha256.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+
+static bool hash_all( int impl, const std::vector<std::vector<unsigned char>>& messages, std::vector<unsigned char>& digests )
+{
+    if( ! sha256_native_select(impl) ) {
+        return false;
+    }
+
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lens;
+    for( const auto& message : messages ) {
+        inputs.push_back(message.data());
+        lens.push_back(message.size());
+    }
+
+    digests.resize(messages.size() * SHA256_DIGEST_LENGTH);
+    sha256_many_native(inputs.data(), lens.data(), messages.size(), digests.data());
+    return true;
+}
+
+
+int main( void )
+{
+    // Lengths either side of the block and padding boundaries
+    std::vector<std::vector<unsigned char>> messages;
+    for( size_t i = 0; i < 200; i++ )
+    {
+        const size_t len = (i < 130) ? i : 64 * (i % 4) + 55 + (i % 3);
+        std::vector<unsigned char> message(len);
+        for( size_t j = 0; j < len; j++ ) {
+            message[j] = (unsigned char)(i * 31 + j * 7);
+        }
+        messages.push_back(message);
+    }
+
+    std::vector<unsigned char> expected;
+    if( ! hash_all(SHA256_IMPL_GENERIC, messages, expected) ) {
+        std::cerr << "FAIL generic unavailable" << std::endl;
+        return 1;
+    }
+
+    // NIST FIPS 180-2 "abc"
+    const unsigned char abc_digest[SHA256_DIGEST_LENGTH] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+    };
+
+    for( int impl = SHA256_IMPL_GENERIC; impl <= SHA256_IMPL_SHANI; impl++ )
+    {
+        std::vector<unsigned char> digests;
+        if( ! hash_all(impl, messages, digests) ) {
+            std::cout << "Skipping " << sha256_native_name(impl) << std::endl;
+            continue;
+        }
+
+        if( digests != expected ) {
+            std::cerr << "FAIL " << sha256_native_name(impl) << " batch" << std::endl;
+            return 2;
+        }
+
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256((const unsigned char*)"abc", 3, digest);
+        if( memcmp(digest, abc_digest, sizeof(digest)) != 0 ) {
+            std::cerr << "FAIL " << sha256_native_name(impl) << " abc" << std::endl;
+            return 3;
+        }
+
+        // Split across updates, so blocks go through the context's buffer
+        SHA256_CTX ctx;
+        SHA256_Init(&ctx);
+        SHA256_Update(&ctx, messages[199].data(), 5);
+        SHA256_Update(&ctx, messages[199].data() + 5, messages[199].size() - 5);
+        SHA256_Final(digest, &ctx);
+        if( memcmp(digest, &expected[199 * SHA256_DIGEST_LENGTH], sizeof(digest)) != 0 ) {
+            std::cerr << "FAIL " << sha256_native_name(impl) << " update" << std::endl;
+            return 4;
+        }
+
+        std::cout << "OK " << sha256_native_name(impl) << std::endl;
+    }
+
+    return 0;
+}
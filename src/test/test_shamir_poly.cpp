@@ -38,9 +38,94 @@ bool test_shamirs_poly()
         return false;
     }
 
+    if( pb.val(the_gadget.result()) != shamir_poly_native(rand_alpha, rand_input) ) {
+        std::cerr << "Native result differs!\n";
+        return false;
+    }
+
     return stub_test_proof_verify(pb);
 }
 
+
+bool test_shamirs_poly_many()
+{
+    ProtoboardT pb;
+
+    std::vector<FieldT> rand_inputs;
+    for( size_t j = 0; j < 5; j++ ) {
+        rand_inputs.push_back(FieldT::random_element());
+    }
+    std::vector<FieldT> rand_alpha = {
+        FieldT::random_element(), FieldT::random_element(),
+        FieldT::random_element(), FieldT::random_element()
+    };
+
+    const VariableArrayT in_inputs = make_var_array(pb, "in_inputs", rand_inputs);
+    pb.set_input_sizes(rand_inputs.size());
+
+    const VariableArrayT in_alpha = make_var_array(pb, "in_alpha", rand_alpha);
+
+    shamir_poly_many the_gadget(pb, in_inputs, in_alpha, "gadget");
+    the_gadget.generate_r1cs_constraints();
+    the_gadget.generate_r1cs_witness();
+
+    if( ! pb.is_satisfied() ) {
+        std::cerr << "Not satisfied!\n";
+        return false;
+    }
+
+    if( pb.num_constraints() != rand_inputs.size() * (rand_alpha.size() - 1) ) {
+        std::cerr << "Expected " << (rand_alpha.size() - 1) << " constraints per input, got " << pb.num_constraints() << " in total\n";
+        return false;
+    }
+
+    const auto shares = shamir_poly_native_batch(rand_alpha, rand_inputs);
+    for( size_t j = 0; j < rand_inputs.size(); j++ )
+    {
+        if( pb.val(the_gadget.result(j)) != shares[j] ) {
+            std::cerr << "Result " << j << " differs from the native batch\n";
+            return false;
+        }
+    }
+
+    // Any other result is rejected
+    pb.val(the_gadget.result(2)) += FieldT::one();
+    if( pb.is_satisfied() ) {
+        std::cerr << "Wrong result accepted!\n";
+        return false;
+    }
+
+    return true;
+}
+
+
+bool test_shamirs_poly_subgroup()
+{
+    // Fewer coefficients than points, and more, which are folded in
+    for( const size_t n_alpha : {4, 11} )
+    {
+        std::vector<FieldT> alpha;
+        for( size_t i = 0; i < n_alpha; i++ ) {
+            alpha.push_back(FieldT::random_element());
+        }
+
+        std::vector<FieldT> points, shares;
+        shamir_poly_native_subgroup(alpha, 8, points, shares);
+
+        if( points.size() != 8 || shares.size() != 8 ) {
+            std::cerr << "Wrong number of shares\n";
+            return false;
+        }
+
+        if( shares != shamir_poly_native_batch(alpha, points) ) {
+            std::cerr << "FFT differs from Horner's rule, " << n_alpha << " coefficients\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
 // namespace ethsnarks
 }
 
@@ -55,6 +140,18 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if( ! ethsnarks::test_shamirs_poly_many() )
+    {
+        std::cerr << "FAIL many\n";
+        return 2;
+    }
+
+    if( ! ethsnarks::test_shamirs_poly_subgroup() )
+    {
+        std::cerr << "FAIL subgroup\n";
+        return 3;
+    }
+
     std::cout << "OK\n";
     return 0;
 }
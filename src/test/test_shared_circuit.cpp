@@ -0,0 +1,113 @@
+#include "gadgets/mimc.hpp"
+#include "gadgets/shared_circuit.hpp"
+#include "utils.hpp"
+
+#include <thread>
+
+using namespace ethsnarks;
+
+static const size_t N_THREADS = 4;
+static const size_t N_PROOFS = 8;
+
+
+struct mimc_circuit
+{
+    const VariableT m_0;
+    const VariableT iv;
+    MiMC_e7_hash_gadget hasher;
+
+    mimc_circuit( ProtoboardT& pb ) :
+        m_0(make_variable(pb, "m_0")),
+        iv(make_variable(pb, "iv")),
+        hasher(pb, iv, {m_0}, "hasher")
+    {
+        pb.set_input_sizes(1);
+    }
+
+    void generate_r1cs_constraints()
+    {
+        hasher.generate_r1cs_constraints();
+    }
+
+    void generate_r1cs_witness()
+    {
+        hasher.generate_r1cs_witness();
+    }
+};
+
+
+static FieldT message( size_t i )
+{
+    return FieldT(long(i * 1000003 + 7));
+}
+
+static const FieldT IV("918403109389145570117360101535982733651217667914747213867238065296420114726");
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    shared_circuit<mimc_circuit> shared([](ProtoboardT& pb){ return new mimc_circuit(pb); });
+    const size_t n_constraints = shared.constraint_system().num_constraints();
+
+    // Every proof's witness, from separate protoboards
+    std::vector<std::vector<FieldT>> expected;
+    for( size_t i = 0; i < N_PROOFS; i++ )
+    {
+        ProtoboardT pb;
+        mimc_circuit circuit(pb);
+        pb.val(circuit.m_0) = message(i);
+        pb.val(circuit.iv) = IV;
+        circuit.generate_r1cs_witness();
+        expected.push_back(pb.values);
+    }
+
+    // Then from the shared circuit, concurrently
+    std::vector<std::vector<FieldT>> witnesses(N_PROOFS);
+    std::vector<std::thread> threads;
+    for( size_t t = 0; t < N_THREADS; t++ )
+    {
+        threads.emplace_back([&shared, &witnesses, t](){
+            for( size_t i = t; i < N_PROOFS; i += N_THREADS )
+            {
+                shared.witness([i](ProtoboardT& pb, const mimc_circuit& circuit){
+                    pb.val(circuit.m_0) = message(i);
+                    pb.val(circuit.iv) = IV;
+                }, witnesses[i]);
+            }
+        });
+    }
+    for( auto& thread : threads ) {
+        thread.join();
+    }
+
+    for( size_t i = 0; i < N_PROOFS; i++ )
+    {
+        if( witnesses[i] != expected[i] ) {
+            std::cerr << "FAIL witness " << i << " differs" << std::endl;
+            return 1;
+        }
+
+        if( ! shared.is_satisfied(witnesses[i]) ) {
+            std::cerr << "FAIL witness " << i << " not satisfied" << std::endl;
+            return 2;
+        }
+
+        if( shared.primary_input(witnesses[i]) != std::vector<FieldT>{message(i)} ) {
+            std::cerr << "FAIL primary input " << i << std::endl;
+            return 3;
+        }
+    }
+
+    // A wrong witness isn't accepted, and the constraints never change
+    auto wrong = witnesses[0];
+    wrong.back() += FieldT::one();
+    if( shared.is_satisfied(wrong) || shared.constraint_system().num_constraints() != n_constraints ) {
+        std::cerr << "FAIL constraint system" << std::endl;
+        return 4;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "stubs.hpp"
+#include "gadgets/mimc.hpp"
+
+#include <libff/algebra/scalar_multiplication/multiexp.hpp>
+
+using namespace ethsnarks;
+
+
+template<typename T>
+static bool test_sorted( size_t n, unsigned int c, const char *name )
+{
+    std::vector<T> bases;
+    std::vector<FieldT> scalars;
+    for( size_t i = 0; i < n; i++ ) {
+        bases.push_back(T::random_element());
+        scalars.push_back(FieldT::random_element());
+    }
+
+    // Small digits, which leave most of the buckets empty
+    scalars[0] = FieldT::zero();
+    scalars[1 % n] = FieldT::one();
+    scalars[2 % n] = FieldT::zero() - FieldT::one();
+
+    libsnark::Config config;
+    config.multi_exp_c = c;
+    std::vector<LimbT> scratch(n);
+
+    const T expected = libff::multi_exp<T, FieldT, libff::multi_exp_method_BDLO12>(
+        bases.begin(), bases.end(), scalars.begin(), scalars.end(), scratch, config);
+
+    const T result = libsnark::r1cs_gg_ppzksnark_zok_sorted_multi_exp<T, FieldT>(
+        bases.begin(), nullptr, scalars.begin(), n, scratch, config);
+    if( result != expected ) {
+        std::cerr << "FAIL " << name << " n=" << n << " c=" << c << std::endl;
+        return false;
+    }
+
+    // Base i paired with scalar indices[i]
+    std::vector<size_t> indices;
+    std::vector<FieldT> spread(2 * n, FieldT::random_element());
+    for( size_t i = 0; i < n; i++ ) {
+        indices.push_back(2 * i + 1);
+        spread[2 * i + 1] = scalars[i];
+    }
+    const T indexed = libsnark::r1cs_gg_ppzksnark_zok_sorted_multi_exp<T, FieldT>(
+        bases.begin(), &indices, spread.begin(), n, scratch, config);
+    if( indexed != expected ) {
+        std::cerr << "FAIL " << name << " indexed n=" << n << " c=" << c << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    for( size_t n : {1, 7, 300} )
+    {
+        for( unsigned int c : {0, 1, 5, 13} )
+        {
+            if( ! test_sorted<G1T>(n, c, "G1") ) {
+                return 1;
+            }
+        }
+    }
+
+    if( ! test_sorted<G2T>(200, 0, "G2") ) {
+        return 2;
+    }
+
+    // A whole proof with the sorted MSM for every query
+    ProtoboardT pb;
+    VariableT x = make_variable(pb, FieldT("3703141493535563179657531719960160174296085208671919316200479060314459804651"), "x");
+    pb.set_input_sizes(1);
+    VariableT k = make_variable(pb, FieldT("134551314051432487569247388144051420116740427803855572138106146683954151557"), "k");
+    MiMC_e7_gadget the_gadget(pb, x, k, "the_gadget");
+    the_gadget.generate_r1cs_constraints();
+    the_gadget.generate_r1cs_witness();
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    ProvingKeyT pk(keypair.pk);
+    ProverContextT context(pk);
+    libsnark::Config config;
+    config.multi_exp_method = "sorted";
+    init_prover_context(context, pb, config);
+
+    const auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(context, pb.values);
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC<ppT>(keypair.vk, pb.primary_input(), proof) ) {
+        std::cerr << "FAIL sorted proof doesn't verify" << std::endl;
+        return 3;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "stubs.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok_trace.hpp"
+
+#include <cstdio>   // remove
+#include <fstream>
+#include <map>
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    char trace_file[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_trace", trace_file) ) {
+        return 1;
+    }
+
+    // Blocks entered before the trace starts aren't recorded
+    libsnark::trace_enter_block("Before");
+    libsnark::trace_leave_block("Before");
+
+    if( ! libsnark::trace_start(trace_file) || libsnark::trace_start(trace_file) || ! libsnark::trace_enabled() ) {
+        std::cerr << "FAIL start" << std::endl;
+        return 2;
+    }
+
+    ProtoboardT pb;
+    VariableT x = make_variable(pb, 3, "x");
+    pb.set_input_sizes(1);
+    VariableT y = make_variable(pb, 9, "y");
+    pb.add_r1cs_constraint(ConstraintT(x, x, y), "x*x=y");
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(keypair.pk, pb.primary_input(), pb.auxiliary_input());
+
+    if( ! libsnark::trace_stop() || libsnark::trace_enabled() ) {
+        std::cerr << "FAIL stop" << std::endl;
+        return 3;
+    }
+
+    std::ifstream in(trace_file);
+    const auto trace = nlohmann::json::parse(in);
+    ::remove(trace_file);
+
+    // Every block that begins ends, each thread's blocks nested
+    std::map<int, std::vector<std::string>> open_blocks;
+    bool prover_block = false, domain_counter = false;
+    for( const auto& event : trace["traceEvents"] )
+    {
+        const std::string phase = event["ph"];
+        const std::string name = event["name"];
+        auto& open = open_blocks[event["tid"].get<int>()];
+
+        if( phase == "B" ) {
+            open.push_back(name);
+            prover_block |= name == "Call to r1cs_gg_ppzksnark_zok_prover";
+        }
+        else if( phase == "E" ) {
+            if( open.empty() || open.back() != name ) {
+                std::cerr << "FAIL block " << name << " ends out of order" << std::endl;
+                return 4;
+            }
+            open.pop_back();
+        }
+        else if( phase == "C" ) {
+            domain_counter |= name == "domain size" && event["args"]["value"].get<int64_t>() > 0;
+        }
+
+        if( name == "Before" ) {
+            std::cerr << "FAIL block before the trace recorded" << std::endl;
+            return 5;
+        }
+    }
+
+    for( const auto& thread : open_blocks ) {
+        if( ! thread.second.empty() ) {
+            std::cerr << "FAIL block " << thread.second.back() << " doesn't end" << std::endl;
+            return 6;
+        }
+    }
+
+    if( ! prover_block || ! domain_counter ) {
+        std::cerr << "FAIL prover not traced" << std::endl;
+        return 7;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "gadgets/mimc.hpp"
+#include "stubs.hpp"
+#include "verifier_batcher.hpp"
+
+#include <thread>
+
+using namespace ethsnarks;
+
+
+static const size_t N_PROOFS = 8;
+static const size_t MAX_SIZE = 4;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+    libff::inhibit_profiling_info = true;
+    libff::inhibit_profiling_counters = true;
+
+    ProtoboardT pb;
+    VariableT m_0 = make_variable(pb, "m_0");
+    pb.set_input_sizes(1);
+    VariableT iv = make_variable(pb, FieldT(MIMC_TEST_IV), "iv");
+    MiMC_e7_hash_gadget the_gadget(pb, iv, {m_0}, "gadget");
+    the_gadget.generate_r1cs_constraints();
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    const auto pvk = libsnark::r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(keypair.vk);
+
+    std::vector<InputProofPairType> items;
+    for( size_t i = 0; i < N_PROOFS; i++ )
+    {
+        pb.val(m_0) = FieldT(long(i + 1));
+        the_gadget.generate_r1cs_witness();
+        items.emplace_back(pb.primary_input(), libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(keypair.pk, pb.primary_input(), pb.auxiliary_input()));
+    }
+
+    // Every third proof is for another input
+    std::vector<bool> expected;
+    for( size_t i = 0; i < N_PROOFS; i++ ) {
+        expected.push_back(i % 3 != 1);
+        if( ! expected.back() ) {
+            items[i].first[0] += FieldT::one();
+        }
+    }
+
+    VerifierBatcherStats stats;
+    {
+        // A long wait, so the proofs submitted together share batches
+        VerifierBatcher batcher(pvk, MAX_SIZE, std::chrono::microseconds(200000));
+
+        // Not vector<bool>, its elements can't be written from separate threads
+        std::vector<char> valid(N_PROOFS);
+        std::vector<std::thread> threads;
+        for( size_t i = 0; i < N_PROOFS; i++ ) {
+            threads.emplace_back([&, i](){ valid[i] = batcher.verify(items[i]); });
+        }
+        for( auto& thread : threads ) {
+            thread.join();
+        }
+
+        if( std::vector<bool>(valid.begin(), valid.end()) != expected ) {
+            std::cerr << "FAIL concurrent results" << std::endl;
+            return 1;
+        }
+
+        stats = batcher.stats();
+    }
+
+    if( stats.proofs != N_PROOFS || stats.largest > MAX_SIZE || stats.batches >= N_PROOFS ) {
+        std::cerr << "FAIL stats: " << stats.batches << " batches of " << stats.proofs << " proofs, largest " << stats.largest << std::endl;
+        return 2;
+    }
+
+    // Without a wait every proof is verified alone
+    VerifierBatcher single(pvk, MAX_SIZE, std::chrono::microseconds(0));
+    for( size_t i = 0; i < N_PROOFS; i++ ) {
+        if( single.verify(items[i]) != expected[i] ) {
+            std::cerr << "FAIL sequential result " << i << std::endl;
+            return 3;
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "stubs.hpp"
+
+using namespace ethsnarks;
+
+
+static const size_t N_INPUTS = 100;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    // Many public inputs, each constrained to be the square of a witness
+    ProtoboardT pb;
+    std::vector<VariableT> inputs;
+    for( size_t i = 0; i < N_INPUTS; i++ ) {
+        inputs.push_back(make_variable(pb, FieldT(long((i + 2) * (i + 2))), FMT("input", "[%zu]", i)));
+    }
+    pb.set_input_sizes(N_INPUTS);
+
+    for( size_t i = 0; i < N_INPUTS; i++ ) {
+        VariableT root = make_variable(pb, FieldT(long(i + 2)), FMT("root", "[%zu]", i));
+        pb.add_r1cs_constraint(ConstraintT(root, root, inputs[i]), FMT("square", "[%zu]", i));
+    }
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(keypair.pk, pb.primary_input(), pb.auxiliary_input());
+
+    const auto pvk = libsnark::r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(keypair.vk);
+    const auto pvk_fixed = libsnark::r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(keypair.vk, 6);
+    if( pvk.gamma_ABC_fixed.num_bases != 0 || pvk_fixed.gamma_ABC_fixed.num_bases != N_INPUTS ) {
+        std::cerr << "FAIL fixed-base table" << std::endl;
+        return 1;
+    }
+
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<ppT>(pvk_fixed, pb.primary_input(), proof) ) {
+        std::cerr << "FAIL proof doesn't verify with the table" << std::endl;
+        return 2;
+    }
+
+    auto wrong_input = pb.primary_input();
+    wrong_input[N_INPUTS / 2] += FieldT::one();
+    if( libsnark::r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<ppT>(pvk_fixed, wrong_input, proof) ) {
+        std::cerr << "FAIL wrong input verifies with the table" << std::endl;
+        return 3;
+    }
+
+    // The weak verifier pads a shorter input with zeros, either way
+    const libsnark::r1cs_gg_ppzksnark_zok_primary_input<ppT> short_input(wrong_input.begin(), wrong_input.begin() + 10);
+    if( libsnark::r1cs_gg_ppzksnark_zok_online_verifier_weak_IC<ppT>(pvk, short_input, proof)
+     != libsnark::r1cs_gg_ppzksnark_zok_online_verifier_weak_IC<ppT>(pvk_fixed, short_input, proof) ) {
+        std::cerr << "FAIL short input differs with the table" << std::endl;
+        return 4;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "stubs.hpp"
+#include "vk_cache.hpp"
+
+#include <cstdio>   // remove
+#include <fstream>
+#include <iterator>
+
+using namespace ethsnarks;
+
+
+static std::vector<uint8_t> hash_of( const char *path )
+{
+    std::ifstream fh(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(fh)), std::istreambuf_iterator<char>());
+    std::vector<uint8_t> hash(VK_CACHE_HASH_SIZE);
+    vk_cache_hash(reinterpret_cast<const uint8_t*>(data.data()), data.size(), hash.data());
+    return hash;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    auto keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(pb.constraint_system);
+    auto proof = libsnark::r1cs_gg_ppzksnark_zok_prover<ppT>(keypair.pk, pb.primary_input(), pb.auxiliary_input());
+
+    char vk_file[TEMP_PATH_SIZE];
+    if( ! make_temp_file("test_vk_cache", vk_file) ) {
+        return 1;
+    }
+    const auto cache_file = vk_cache_path(vk_file);
+    vk2json_file(keypair.vk, vk_file);
+
+    // Without being asked no cache is written
+    ProcessedVerificationKeyT processed, cached;
+    if( ! load_processed_vk(vk_file, processed) || std::ifstream(cache_file).is_open() ) {
+        std::cerr << "FAIL cache written without being asked" << std::endl;
+        return 2;
+    }
+
+    // Then the first load processes the key and writes the cache, the second reads it
+    if( ! load_processed_vk(vk_file, processed, true) || ! load_processed_vk(vk_file, cached) ) {
+        std::cerr << "FAIL load_processed_vk" << std::endl;
+        return 2;
+    }
+
+    uint8_t hash[VK_CACHE_HASH_SIZE] = {0};
+    ProcessedVerificationKeyT other;
+    if( vk_cache_load(cache_file.c_str(), hash, other) ) {
+        std::cerr << "FAIL cache loaded with the wrong hash" << std::endl;
+        return 3;
+    }
+
+    // A cache whose processed key was changed isn't used
+    {
+        std::fstream fh(cache_file, std::ios::in | std::ios::out | std::ios::binary);
+        fh.seekg(-4, std::ios::end);
+        const char c = fh.get();
+        fh.seekp(-4, std::ios::end);
+        fh.put(c ^ 1);
+    }
+    if( vk_cache_load(cache_file.c_str(), hash_of(vk_file).data(), other) ) {
+        std::cerr << "FAIL corrupt cache loaded" << std::endl;
+        return 7;
+    }
+    if( ! load_processed_vk(vk_file, cached, true) ) {
+        std::cerr << "FAIL rewriting the cache" << std::endl;
+        return 7;
+    }
+
+    if( ! (cached == processed) || ! (processed == libsnark::r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(keypair.vk)) ) {
+        std::cerr << "FAIL cached key differs" << std::endl;
+        return 4;
+    }
+
+    if( ! libsnark::r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<ppT>(cached, pb.primary_input(), proof) ) {
+        std::cerr << "FAIL proof doesn't verify with the cached key" << std::endl;
+        return 5;
+    }
+
+    // Another key in the same file replaces the cache
+    ProtoboardT other_pb;
+    make_mimc_circuit(other_pb, FieldT::one());
+    auto other_keypair = libsnark::r1cs_gg_ppzksnark_zok_generator<ppT>(other_pb.constraint_system);
+    vk2json_file(other_keypair.vk, vk_file);
+    if( ! load_processed_vk(vk_file, other, true) || other == cached || ! (other == libsnark::r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(other_keypair.vk)) ) {
+        std::cerr << "FAIL cache of another key was used" << std::endl;
+        ::remove(vk_file);
+        ::remove(cache_file.c_str());
+        return 6;
+    }
+
+    ::remove(vk_file);
+    ::remove(cache_file.c_str());
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
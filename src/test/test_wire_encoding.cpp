@@ -0,0 +1,75 @@
+#include "export.hpp"
+#include "import.hpp"
+
+using namespace ethsnarks;
+
+
+static const uint8_t *bytes_of( const std::string& in )
+{
+    return reinterpret_cast<const uint8_t*>(in.data());
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    for( int i = 0; i < 5; i++ )
+    {
+        const ProofT proof(FieldT::random_element() * G1T::one(),
+                           FieldT::random_element() * G2T::one(),
+                           FieldT::random_element() * G1T::one());
+        const PrimaryInputT input = {FieldT::random_element(), FieldT::zero(), -FieldT::one()};
+
+        const auto encoded = proof_to_bytes(proof, input);
+        if( encoded.size() != WIRE_PROOF_SIZE + (3 * WIRE_WORD_SIZE) ) {
+            std::cerr << "FAIL proof size" << std::endl;
+            return 1;
+        }
+
+        InputProofPairType decoded;
+        if( ! proof_from_bytes(bytes_of(encoded), encoded.size(), decoded)
+         || decoded.first != input
+         || decoded.second.g_A != proof.g_A
+         || decoded.second.g_B != proof.g_B
+         || decoded.second.g_C != proof.g_C ) {
+            std::cerr << "FAIL proof roundtrip" << std::endl;
+            return 2;
+        }
+
+        // A truncated encoding, or a coordinate which isn't on the curve, is rejected
+        if( proof_from_bytes(bytes_of(encoded), encoded.size() - 1, decoded) ) {
+            std::cerr << "FAIL truncated proof accepted" << std::endl;
+            return 3;
+        }
+        auto corrupted = encoded;
+        corrupted[WIRE_WORD_SIZE - 1] ^= 1;
+        if( proof_from_bytes(bytes_of(corrupted), corrupted.size(), decoded) ) {
+            std::cerr << "FAIL corrupted proof accepted" << std::endl;
+            return 4;
+        }
+    }
+
+    std::vector<G1T> gamma_ABC_rest = {FieldT::random_element() * G1T::one(), G1T::zero()};
+    const VerificationKeyT vk(FieldT::random_element() * G1T::one(),
+                              FieldT::random_element() * G2T::one(),
+                              FieldT::random_element() * G2T::one(),
+                              FieldT::random_element() * G2T::one(),
+                              libsnark::accumulation_vector<G1T>(FieldT::random_element() * G1T::one(), std::move(gamma_ABC_rest)));
+
+    const auto encoded_vk = vk_to_bytes(vk);
+    VerificationKeyT decoded_vk;
+    if( ! vk_from_bytes(bytes_of(encoded_vk), encoded_vk.size(), decoded_vk)
+     || decoded_vk.alpha_g1 != vk.alpha_g1
+     || decoded_vk.beta_g2 != vk.beta_g2
+     || decoded_vk.gamma_g2 != vk.gamma_g2
+     || decoded_vk.delta_g2 != vk.delta_g2
+     || decoded_vk.gamma_ABC_g1.first != vk.gamma_ABC_g1.first
+     || decoded_vk.gamma_ABC_g1.rest.values != vk.gamma_ABC_g1.rest.values ) {
+        std::cerr << "FAIL vk roundtrip" << std::endl;
+        return 5;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "gadgets/merkle_tree.hpp"
+#include "stubs.hpp"
+
+using namespace ethsnarks;
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+    make_mimc_circuit(pb);
+
+    ProtoboardT witness_pb;
+    {
+        WitnessOnlyScope scope(witness_pb);
+        if( ! is_witness_only(witness_pb) || is_witness_only(pb) ) {
+            std::cerr << "FAIL scope" << std::endl;
+            return 1;
+        }
+        make_mimc_circuit(witness_pb);
+    }
+
+    if( is_witness_only(witness_pb) ) {
+        std::cerr << "FAIL scope not restored" << std::endl;
+        return 2;
+    }
+
+    // Same variables and witness, but no constraints
+    if( witness_pb.num_variables() != pb.num_variables()
+     || witness_pb.num_constraints() != 0
+     || pb.num_constraints() == 0
+     || witness_pb.full_variable_assignment() != pb.full_variable_assignment() ) {
+        std::cerr << "FAIL witness-only protoboard differs" << std::endl;
+        return 3;
+    }
+
+    // Which is satisfied by the constraints of the full protoboard
+    witness_pb.constraint_system = pb.constraint_system;
+    if( ! witness_pb.is_satisfied() ) {
+        std::cerr << "FAIL not satisfied" << std::endl;
+        return 4;
+    }
+
+    // Without annotations the circuit is the same
+    ProtoboardT quiet_pb;
+    {
+        AnnotationsOffScope scope(quiet_pb);
+        if( has_annotations(quiet_pb) ) {
+            std::cerr << "FAIL annotations scope" << std::endl;
+            return 5;
+        }
+#ifdef DEBUG
+        if( ! has_annotations(pb) || pb_annotation(quiet_pb, "prefix", ".round[%d]", 1) != "prefix" ) {
+            std::cerr << "FAIL annotations not kept for the prefix" << std::endl;
+            return 6;
+        }
+#endif
+        make_mimc_circuit(quiet_pb);
+    }
+
+    if( quiet_pb.num_variables() != pb.num_variables()
+     || quiet_pb.num_constraints() != pb.num_constraints()
+     || ! quiet_pb.is_satisfied() ) {
+        std::cerr << "FAIL protoboard without annotations differs" << std::endl;
+        return 7;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "witness_ring.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ethsnarks;
+
+
+static const size_t NUM_VALUES = 1000;
+static const size_t NUM_WITNESSES = 10;
+
+
+static std::vector<FieldT> witness( size_t i )
+{
+    std::vector<FieldT> values;
+    for( size_t j = 0; j < NUM_VALUES; j++ ) {
+        values.push_back(FieldT((i * 1000) + j));
+    }
+    return values;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    const std::string name = "/ethsnarks-test-" + std::to_string(::getpid());
+
+    // Fewer slots than witnesses, so the worker waits for the prover
+    auto ring = WitnessRing::create(name, 3, NUM_VALUES);
+    if( ! ring ) {
+        std::cerr << "FAIL create" << std::endl;
+        return 1;
+    }
+
+    if( WitnessRing::attach("/ethsnarks-test-missing") ) {
+        std::cerr << "FAIL attached to a missing ring" << std::endl;
+        return 2;
+    }
+
+    const pid_t worker = ::fork();
+    if( worker == 0 )
+    {
+        auto out = WitnessRing::attach(name);
+        if( ! out || out->num_values() != NUM_VALUES || out->push(std::vector<FieldT>(NUM_VALUES - 1), "short") ) {
+            ::_exit(1);
+        }
+        for( size_t i = 0; i < NUM_WITNESSES; i++ ) {
+            if( ! out->push(witness(i), "proof-" + std::to_string(i) + ".json") ) {
+                ::_exit(2);
+            }
+        }
+        out.reset();
+        ::_exit(0);
+    }
+
+    // Taken in the order they were filled, then the worker has detached
+    std::vector<FieldT> values;
+    std::string tag;
+    for( size_t i = 0; i < NUM_WITNESSES; i++ )
+    {
+        if( ! ring->pop(values, tag) ) {
+            std::cerr << "FAIL pop " << i << std::endl;
+            return 3;
+        }
+        if( values != witness(i) || tag != "proof-" + std::to_string(i) + ".json" ) {
+            std::cerr << "FAIL witness " << i << " " << tag << std::endl;
+            return 4;
+        }
+    }
+
+    if( ring->pop(values, tag) ) {
+        std::cerr << "FAIL pop after the worker finished" << std::endl;
+        return 5;
+    }
+
+    int status = 0;
+    ::waitpid(worker, &status, 0);
+    if( ! WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+        std::cerr << "FAIL worker exited with " << status << std::endl;
+        return 6;
+    }
+
+    // A ring which is in use isn't taken over
+    if( WitnessRing::create(name, 3, NUM_VALUES) ) {
+        std::cerr << "FAIL created over a ring in use" << std::endl;
+        return 7;
+    }
+
+    // A worker which is killed never detaches, the prover still finishes
+    const pid_t killed = ::fork();
+    if( killed == 0 )
+    {
+        auto out = WitnessRing::attach(name);
+        if( out ) {
+            out->push(witness(0), "killed.json");
+        }
+        ::_exit(out ? 0 : 1);
+    }
+    ::waitpid(killed, &status, 0);
+    if( ! ring->pop(values, tag) || tag != "killed.json" || ring->pop(values, tag) ) {
+        std::cerr << "FAIL after a worker was killed" << std::endl;
+        return 8;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "gadgets/merkle_tree_native.hpp"
+#include "gadgets/sha256_many.hpp"
+#include "gadgets/witness_scheduler.hpp"
+#include "utils.hpp"
+
+#include "crypto/sha256.h"
+
+#include <cstring>
+
+using namespace ethsnarks;
+
+static const size_t N_HASHES = 16;
+static const size_t DIGEST_BYTES = libsnark::SHA256_digest_size / 8;
+static const size_t N_PATHS = 32;
+static const size_t TREE_DEPTH = 8;
+
+
+static bool digest_matches( const sha256_many& gadget, const uint8_t *data, size_t len )
+{
+    uint8_t expected[DIGEST_BYTES];
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+    SHA256_Update(&ctx, data, len);
+    SHA256_Final(expected, &ctx);
+
+    uint8_t actual[DIGEST_BYTES];
+    bv_to_bytes(gadget.result().get_digest(), actual);
+    return memcmp(expected, actual, DIGEST_BYTES) == 0;
+}
+
+
+/**
+* One authenticator per leaf, as a circuit with a path per transaction has
+*/
+template<typename HashT>
+static bool test_merkle_paths( const char *name )
+{
+    merkle_tree_native<HashT> tree(TREE_DEPTH);
+    std::vector<size_t> indices;
+    std::vector<FieldT> leaves;
+    for( size_t i = 0; i < N_PATHS; i++ )
+    {
+        indices.push_back((i * 37) % (1u << TREE_DEPTH));
+        leaves.push_back(FieldT(long(i + 1)));
+    }
+    tree.update_batch(indices, leaves);
+
+    ProtoboardT pb;
+    const VariableArrayT IVs = merkle_tree_IVs(pb);
+    const VariableT root = make_variable(pb, tree.root(), "root");
+
+    std::vector<merkle_path_authenticator<HashT>> paths;
+    paths.reserve(N_PATHS);
+    for( size_t i = 0; i < N_PATHS; i++ )
+    {
+        VariableArrayT address_bits = make_var_array(pb, TREE_DEPTH, FMT("address_bits", "[%zu]", i));
+        VariableArrayT path = make_var_array(pb, TREE_DEPTH, FMT("path", "[%zu]", i));
+        VariableT leaf = make_variable(pb, leaves[i], FMT("leaf", "[%zu]", i));
+        tree.path(indices[i]).fill(pb, address_bits, path);
+
+        paths.emplace_back(pb, TREE_DEPTH, address_bits, IVs, leaf, root, path, FMT("paths", "[%zu]", i));
+    }
+
+    generate_r1cs_witness_parallel(paths);
+
+    for( auto& path : paths )
+    {
+        if( ! path.is_valid() ) {
+            std::cerr << "FAIL " << name << " path" << std::endl;
+            return false;
+        }
+        path.generate_r1cs_constraints();
+    }
+
+    if( ! pb.is_satisfied() ) {
+        std::cerr << "FAIL " << name << " paths not satisfied" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+int main( void )
+{
+    ppT::init_public_params();
+
+    ProtoboardT pb;
+
+    // Independent hashes of different lengths, then a hash of their digests
+    std::vector<std::vector<uint8_t>> messages;
+    std::vector<sha256_many> hashers;
+    hashers.reserve(N_HASHES);
+    for( size_t i = 0; i < N_HASHES; i++ )
+    {
+        std::vector<uint8_t> message(32 + (i * 17));
+        for( size_t j = 0; j < message.size(); j++ ) {
+            message[j] = uint8_t(i + j);
+        }
+
+        VariableArrayT bits;
+        bits.allocate(pb, message.size() * 8, FMT("bits", "[%zu]", i));
+        bits.fill_with_bits(pb, bytes_to_bv(message.data(), message.size()));
+
+        hashers.emplace_back(pb, bits, FMT("hashers", "[%zu]", i));
+        messages.push_back(message);
+    }
+
+    std::vector<VariableArrayT> digests;
+    for( const auto& hasher : hashers ) {
+        digests.push_back(hasher.result().bits);
+    }
+    sha256_many root(pb, flatten(digests), "root");
+
+    witness_scheduler scheduler;
+    scheduler.add_all(hashers);
+    scheduler.barrier();
+    scheduler.add(root);
+
+    if( scheduler.size() != N_HASHES + 1 ) {
+        std::cerr << "FAIL scheduler size" << std::endl;
+        return 1;
+    }
+
+    scheduler.run();
+
+    std::vector<uint8_t> concatenated;
+    for( size_t i = 0; i < N_HASHES; i++ )
+    {
+        if( ! digest_matches(hashers[i], messages[i].data(), messages[i].size()) ) {
+            std::cerr << "FAIL hash " << i << std::endl;
+            return 2;
+        }
+
+        uint8_t digest[DIGEST_BYTES];
+        bv_to_bytes(hashers[i].result().get_digest(), digest);
+        concatenated.insert(concatenated.end(), digest, digest + DIGEST_BYTES);
+    }
+
+    if( ! digest_matches(root, concatenated.data(), concatenated.size()) ) {
+        std::cerr << "FAIL root" << std::endl;
+        return 3;
+    }
+
+    for( auto& hasher : hashers ) {
+        hasher.generate_r1cs_constraints();
+    }
+    root.generate_r1cs_constraints();
+
+    if( ! pb.is_satisfied() ) {
+        std::cerr << "FAIL not satisfied" << std::endl;
+        return 4;
+    }
+
+    if( ! test_merkle_paths<MiMC_e7_hash_gadget>("mimc") ) {
+        return 5;
+    }
+
+    // Every instance shares one master, which keeps per-thread values
+    if( ! test_merkle_paths<merkle_hash_Poseidon128>("poseidon") ) {
+        return 6;
+    }
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
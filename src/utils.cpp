@@ -1,6 +1,8 @@
 // This is an open source non-commercial project. Dear PVS-Studio, please check it.
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
+#include <cstdarg>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 
@@ -115,10 +117,11 @@ FieldT bytes_to_FieldT_littleendian( const uint8_t *in_bytes, const size_t in_co
 * So given a 512bit message, the _final_padding_512 is another block of 512 bits
 * which begins with a '1' bit, and ends with a 64bit big-endian number representing '512'
 */
-const std::vector<VariableArrayT> bits2blocks_padded(ProtoboardT& in_pb, const VariableArrayT& in_bits, size_t block_size)
+const std::vector<VariableArrayT> bits2blocks_padded(ProtoboardT& in_pb, const VariableArrayT& in_bits, size_t block_size, size_t prefix_bits)
 {
     assert( (in_bits.size() % 8) == 0 );
     assert( in_bits.size() > 0 );
+    assert( (prefix_bits % block_size) == 0 );
 
     size_t length_bits = 64;    // Number of bits used to append the length to the end
     std::vector<VariableArrayT> out_blocks;
@@ -162,7 +165,7 @@ const std::vector<VariableArrayT> bits2blocks_padded(ProtoboardT& in_pb, const V
             }
             else if( in_bits_offset < (block_end - length_bits) ) {
                 // Enforce padding bits are zero
-                in_pb.add_r1cs_constraint(ConstraintT(block[j], FieldT::zero(), FieldT::zero()), "Remaining padding bits are zero");
+                in_pb.add_r1cs_constraint(ConstraintT(block[j], FieldT::one(), FieldT::zero()), "Remaining padding bits are zero");
             }
 
             j += 1;
@@ -173,7 +176,7 @@ const std::vector<VariableArrayT> bits2blocks_padded(ProtoboardT& in_pb, const V
     auto& last_block = out_blocks[out_blocks.size() - 1];
 
     // Add 64bit big-endian length specifier to the end
-    size_t bitlen = in_bits.size();
+    size_t bitlen = prefix_bits + in_bits.size();
     const libff::bit_vector bitlen_bits = libff::int_list_to_bits({
         (bitlen >> 56) & 0xFF,
         (bitlen >> 48) & 0xFF,
@@ -211,6 +214,19 @@ VariableArrayT VariableArray_from_bits(
 }
 
 
+VariableArrayT VariableArray_from_constant_bits(
+    ProtoboardT &in_pb,
+    const libff::bit_vector& bits,
+    const std::string& annotation_prefix )
+{
+    const auto out = VariableArray_from_bits(in_pb, bits, annotation_prefix);
+    for( size_t i = 0; i < bits.size(); i++ ) {
+        in_pb.add_r1cs_constraint(ConstraintT(out[i], 1, bits[i] ? FieldT::one() : FieldT::zero()), FMT(annotation_prefix, ".constant[%zu]", i));
+    }
+    return out;
+}
+
+
 /**
 * Returns true if the value is less than its modulo negative
 */
@@ -236,6 +252,29 @@ bool is_negative( const FieldT& value )
 }
 
 
+void batch_inverse( std::vector<FieldT>& values, std::vector<FieldT>& scratch )
+{
+    scratch.clear();
+    FieldT acc = FieldT::one();
+    for( const auto& value : values ) {
+        scratch.push_back(acc);
+        if( value != FieldT::zero() ) {
+            acc = acc * value;
+        }
+    }
+
+    FieldT inv = acc.inverse();
+    for( size_t i = values.size(); i-- > 0; ) {
+        if( values[i] == FieldT::zero() ) {
+            continue;
+        }
+        const FieldT value = values[i];
+        values[i] = inv * scratch[i];
+        inv = inv * value;
+    }
+}
+
+
 /**
 * Convert an array of variable arrays into a flat contiguous array of variables
 */
@@ -339,9 +378,83 @@ void print_bytes( const char *prefix, const size_t n_bytes, const uint8_t *in_by
 }
 
 
-void dump_pb_r1cs_constraints(const ProtoboardT& pb)
+static thread_local const ProtoboardT *witness_only_pb = nullptr;
+
+
+bool is_witness_only( const ProtoboardT& pb )
+{
+    return witness_only_pb == &pb;
+}
+
+
+WitnessOnlyScope::WitnessOnlyScope( const ProtoboardT& pb ) :
+    m_previous(witness_only_pb)
 {
+    witness_only_pb = &pb;
+}
+
+
+WitnessOnlyScope::~WitnessOnlyScope()
+{
+    witness_only_pb = m_previous;
+}
+
+
+static thread_local const ProtoboardT *annotations_off_pb = nullptr;
+
+
+bool has_annotations( const ProtoboardT& pb )
+{
+#ifdef DEBUG
+    return ! is_witness_only(pb) && annotations_off_pb != &pb;
+#else
+    libff::UNUSED(pb);
+    return false;
+#endif
+}
+
+
+AnnotationsOffScope::AnnotationsOffScope( const ProtoboardT& pb ) :
+    m_previous(annotations_off_pb)
+{
+    annotations_off_pb = &pb;
+}
+
+
+AnnotationsOffScope::~AnnotationsOffScope()
+{
+    annotations_off_pb = m_previous;
+}
+
+
+std::string pb_annotation( const ProtoboardT& pb, const std::string& prefix, const char *format, ... )
+{
+    if( ! has_annotations(pb) )
+    {
 #ifdef DEBUG
+        if( annotations_off_pb == &pb && ! is_witness_only(pb) ) {
+            return prefix;
+        }
+#endif
+        return std::string();
+    }
+
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    ::vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    return prefix + buf;
+}
+
+
+/**
+* Prints the evaluation of every constraint, with its annotation if the
+* protoboard kept one
+*/
+void dump_pb_r1cs_constraints(const ProtoboardT& pb)
+{
     auto full_variable_assignment = pb.primary_input();
     const auto auxiliary_input = pb.auxiliary_input();
     full_variable_assignment.insert(full_variable_assignment.end(), auxiliary_input.begin(), auxiliary_input.end());
@@ -355,8 +468,13 @@ void dump_pb_r1cs_constraints(const ProtoboardT& pb)
         const FieldT bres = constraint->evaluateB(full_variable_assignment);
         const FieldT cres = constraint->evaluateC(full_variable_assignment);
 
+#ifdef DEBUG
         auto it = cs.constraint_annotations.find(i);
-        printf("constraint %u (%s)\n", i++, (it == cs.constraint_annotations.end() ? "no annotation" : it->second.c_str()));
+        const char *annotation = (it == cs.constraint_annotations.end() || it->second.empty()) ? "no annotation" : it->second.c_str();
+#else
+        const char *annotation = "no annotation";
+#endif
+        printf("constraint %u (%s)\n", i++, annotation);
         printf("\t<a,(1,x)> = "); ares.print();
         printf("\t<b,(1,x)> = "); bres.print();
         printf("\t<c,(1,x)> = "); cres.print();
@@ -364,7 +482,6 @@ void dump_pb_r1cs_constraints(const ProtoboardT& pb)
         //dump_r1cs_constraint(constraint, full_variable_assignment, cs.variable_annotations);
         printf("\n");
     }
-#endif
 }
 
 
@@ -103,14 +103,77 @@ inline std::vector<FieldT> vals( const ProtoboardT& pb, const VariableArrayT &in
 *                                   423        64
 *
 * The length of the padded message should now be a multiple of 512 bits.
+*
+* When the message follows `prefix_bits` which are hashed separately, e.g.
+* from a midstate, the length appended is of the prefix and the message.
 */
-const std::vector<VariableArrayT> bits2blocks_padded(ProtoboardT& in_pb, const VariableArrayT& in_bits, size_t block_size);
+const std::vector<VariableArrayT> bits2blocks_padded(ProtoboardT& in_pb, const VariableArrayT& in_bits, size_t block_size, size_t prefix_bits = 0);
 
 VariableArrayT VariableArray_from_bits( ProtoboardT &in_pb, const libff::bit_vector& bits, const std::string& annotation_prefix);
 
+/**
+* Bits whose values are fixed when the circuit is built, e.g. padding. Each
+* is constrained to its value, cs_optimize folds these and the constraints
+* which only depend on them away.
+*/
+VariableArrayT VariableArray_from_constant_bits( ProtoboardT &in_pb, const libff::bit_vector& bits, const std::string& annotation_prefix);
+
 void dump_pb_r1cs_constraints(const ProtoboardT& pb);
 
 
+/**
+* Witness-only mode
+*
+* While a WitnessOnlyScope is alive, gadgets on its protoboard still allocate
+* their variables and compute the witness, but don't store constraints or
+* format annotations. The constraint system must come from elsewhere, e.g.
+* see cs_cache.hpp. The scope is per-thread.
+*/
+bool is_witness_only( const ProtoboardT& pb );
+
+class WitnessOnlyScope {
+public:
+    explicit WitnessOnlyScope( const ProtoboardT& pb );
+    ~WitnessOnlyScope();
+
+    WitnessOnlyScope( const WitnessOnlyScope& ) = delete;
+    WitnessOnlyScope& operator=( const WitnessOnlyScope& ) = delete;
+
+private:
+    const ProtoboardT *m_previous;
+};
+
+/**
+* Annotations
+*
+* The protoboard only keeps annotations in DEBUG builds, FMT is empty
+* otherwise. pb_annotation() follows the same rule, formatting nothing in
+* release builds or in witness-only mode. While an AnnotationsOffScope is
+* alive, e.g. for a DEBUG build of a circuit with millions of variables,
+* it returns the gadget's prefix without formatting the rest, so gadgets
+* share an annotation instead of each keeping its own. The scope is
+* per-thread.
+*/
+bool has_annotations( const ProtoboardT& pb );
+
+class AnnotationsOffScope {
+public:
+    explicit AnnotationsOffScope( const ProtoboardT& pb );
+    ~AnnotationsOffScope();
+
+    AnnotationsOffScope( const AnnotationsOffScope& ) = delete;
+    AnnotationsOffScope& operator=( const AnnotationsOffScope& ) = delete;
+
+private:
+    const ProtoboardT *m_previous;
+};
+
+/**
+* Like FMT, but only formats the annotation when the protoboard keeps it
+*/
+std::string pb_annotation( const ProtoboardT& pb, const std::string& prefix, const char *format, ... );
+
+
 inline const VariableArrayT make_var_array( ProtoboardT &in_pb, size_t n, const std::string &annotation )
 {
     VariableArrayT x;
@@ -163,6 +226,20 @@ inline const libsnark::pb_linear_combination<FieldT> make_linear_term( Protoboar
 bool is_negative( const FieldT& value );
 
 
+/**
+* Replace every non-zero value with its inverse, using a single inversion
+*
+* The scratch vector is reused across calls to avoid allocations.
+*/
+void batch_inverse( std::vector<FieldT>& values, std::vector<FieldT>& scratch );
+
+inline void batch_inverse( std::vector<FieldT>& values )
+{
+    std::vector<FieldT> scratch;
+    batch_inverse(values, scratch);
+}
+
+
 template<typename T>
 void writeToFile(std::string path, T& obj) {
     std::ofstream fh;
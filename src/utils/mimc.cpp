@@ -3,6 +3,10 @@
 
 #include "gadgets/mimc.hpp"
 #include "utils.hpp"
+#include "stubs.hpp"
+
+#include <iostream>
+#include <sstream>
 
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
@@ -16,11 +20,80 @@ using std::cerr;
 using std::endl;
 using std::string;
 using ethsnarks::FieldT;
+using ethsnarks::MiMC_e7_gadget;
+using ethsnarks::MiMCe7_round;
+
+
+static void print_field( const FieldT& x )
+{
+	mpz_t value;
+	::mpz_init(value);
+	x.as_bigint().to_mpz(value);
+
+	char *value_out = mpz_get_str(nullptr, 10, value);
+	cout << value_out << "\n";
+	::free(value_out);
+
+	::mpz_clear(value);
+}
+
+
+/**
+* Hashes each line of stdin, whitespace separated messages, to a line of
+* stdout. Consecutive lines with as many messages are hashed in batches.
+*/
+static int stream_hash( const std::vector<FieldT>& round_constants, const FieldT& key )
+{
+	const size_t BATCH_SIZE = 1<<14;
+
+	std::vector<FieldT> messages, results;
+	size_t n_lines = 0;
+	size_t n_blocks = 0;
+
+	auto flush = [&]() {
+		results.resize(n_lines);
+		ethsnarks::mimc_hash_native_batch<MiMCe7_round>(round_constants, messages.data(), n_blocks, n_lines, key, results.data());
+		for( const auto& r : results )
+		{
+			print_field(r);
+		}
+		messages.clear();
+		n_lines = 0;
+	};
+
+	string line;
+	while( std::getline(std::cin, line) )
+	{
+		std::vector<FieldT> line_messages;
+		std::istringstream words(line);
+		string w;
+		while( words >> w )
+		{
+			line_messages.emplace_back(w.c_str());
+		}
+
+		if( n_lines && (line_messages.size() != n_blocks || n_lines == BATCH_SIZE) )
+		{
+			flush();
+		}
+
+		n_blocks = line_messages.size();
+		messages.insert(messages.end(), line_messages.begin(), line_messages.end());
+		n_lines++;
+	}
+
+	if( n_lines ) {
+		flush();
+	}
+
+	cout.flush();
+	return 0;
+}
 
 
 int main( int argc, char **argv )
 {
-	ethsnarks::ppT::init_public_params();
+	ethsnarks::stub_init_public_params();
 
 	po::options_description desc("Options");
 	po::positional_options_description p;
@@ -55,7 +128,10 @@ int main( int argc, char **argv )
 
 	FieldT key(key_opt.c_str());
 
-	const auto round_constants = ethsnarks::MiMC_gadget::constants(seed.c_str(), rounds);
+	// The default constants are baked in, others are derived
+	const auto round_constants = (seed == MIMC_SEED && rounds == MiMCe7_round::N_ROUNDS)
+							   ? MiMC_e7_gadget::static_constants()
+							   : MiMC_e7_gadget::constants(seed.c_str(), rounds);
 
 	if( verbose ) {
 		cerr << "# exponent 7" << endl;
@@ -68,7 +144,7 @@ int main( int argc, char **argv )
 	{
 		for( const auto& c_i : round_constants )
 		{
-			c_i.print();
+			print_field(c_i);
 		}
 	}
 	else if( cmd == "encrypt" )
@@ -82,7 +158,7 @@ int main( int argc, char **argv )
 		for( const auto& w : subargs )
 		{
 			const FieldT x(w.c_str());
-			ethsnarks::mimc(round_constants, x, key).print();
+			print_field(ethsnarks::mimc(round_constants, x, key));
 			key = ethsnarks::mimc(round_constants, key, key);
 		}
 	}
@@ -101,11 +177,17 @@ int main( int argc, char **argv )
 			msgs.emplace_back(x.c_str());
 		}
 
-		ethsnarks::mimc_hash(msgs, key).print();
+		FieldT result = key;
+		ethsnarks::mimc_hash_native_batch<MiMCe7_round>(round_constants, msgs.data(), msgs.size(), 1, key, &result);
+		print_field(result);
+	}
+	else if( cmd == "stream" )
+	{
+		return stream_hash(round_constants, key);
 	}
 	else
 	{
-		cerr << "Usage: " << argv[0] << " <constants|encrypt|hash> [args ...]" << endl << endl;
+		cerr << "Usage: " << argv[0] << " <constants|encrypt|hash|stream> [args ...]" << endl << endl;
 		cerr << desc << endl;
 		return 1;
 	}
@@ -0,0 +1,115 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <algorithm>
+#include <cstdio>
+
+#include "verifier_batcher.hpp"
+#include "r1cs_gg_ppzksnark_zok/r1cs_gg_ppzksnark_zok.hpp"
+
+
+namespace ethsnarks {
+
+
+VerifierBatcher::VerifierBatcher( const ProcessedVerificationKeyT& in_pvk, size_t in_max_size, std::chrono::microseconds in_max_wait ) :
+    m_pvk(in_pvk),
+    m_max_size(std::max<size_t>(1, in_max_size)),
+    m_max_wait(in_max_wait),
+    m_stopping(false)
+{
+    m_stats.sizes.resize(m_max_size);
+    m_thread = std::thread(&VerifierBatcher::run, this);
+}
+
+
+VerifierBatcher::~VerifierBatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+}
+
+
+std::future<bool> VerifierBatcher::submit( const InputProofPairType& item )
+{
+    Pending pending;
+    pending.item = item;
+    auto result = pending.result.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.emplace_back(std::move(pending));
+    }
+    m_cond.notify_all();
+
+    return result;
+}
+
+
+VerifierBatcherStats VerifierBatcher::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+
+void VerifierBatcher::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while( true )
+    {
+        m_cond.wait(lock, [this](){ return m_stopping || ! m_queue.empty(); });
+        if( m_queue.empty() ) {
+            break;
+        }
+
+        // The window opens with the first proof, and closes early when full
+        const auto deadline = std::chrono::steady_clock::now() + m_max_wait;
+        m_cond.wait_until(lock, deadline, [this](){ return m_stopping || m_queue.size() >= m_max_size; });
+
+        const size_t n = std::min(m_max_size, m_queue.size());
+        std::vector<Pending> batch;
+        batch.reserve(n);
+        for( size_t i = 0; i < n; i++ ) {
+            batch.emplace_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+
+        lock.unlock();
+
+        std::vector<libsnark::r1cs_gg_ppzksnark_zok_batch_item<ppT>> items;
+        items.reserve(n);
+        for( const auto& pending : batch ) {
+            items.emplace_back(pending.item);
+        }
+
+        std::vector<bool> valid;
+        libsnark::r1cs_gg_ppzksnark_zok_online_verifier_batch<ppT>(m_pvk, items, &valid);
+        for( size_t i = 0; i < n; i++ ) {
+            batch[i].result.set_value(valid[i]);
+        }
+
+        lock.lock();
+        m_stats.batches++;
+        m_stats.proofs += n;
+        m_stats.largest = std::max(m_stats.largest, n);
+        m_stats.sizes[n - 1]++;
+    }
+}
+
+
+void print_verifier_batcher_stats( const VerifierBatcherStats& stats, FILE *out )
+{
+    ::fprintf(out, "Verified %zu proofs in %zu batches, %.1f per batch, largest %zu\n",
+              stats.proofs, stats.batches,
+              stats.batches ? double(stats.proofs) / stats.batches : 0.0,
+              stats.largest);
+}
+
+
+// namespace ethsnarks
+}
@@ -0,0 +1,101 @@
+#ifndef ETHSNARKS_VERIFIER_BATCHER_HPP_
+#define ETHSNARKS_VERIFIER_BATCHER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ethsnarks.hpp"
+#include "import.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* The batch sizes a VerifierBatcher has achieved
+*/
+struct VerifierBatcherStats {
+    size_t batches = 0;
+    size_t proofs = 0;
+    size_t largest = 0;
+
+    // How many batches there were of each size, index 0 is a single proof
+    std::vector<size_t> sizes;
+};
+
+
+/**
+* Verifies proofs of one key as they arrive, in micro-batches
+*
+* Each proof waits for at most `max_wait` after the first proof of its batch
+* was taken, or until `max_size` proofs are waiting, then the batch is
+* checked with one multi-pairing, see r1cs_gg_ppzksnark_zok_online_verifier_batch,
+* and every caller receives its own result. A steady stream of single proofs
+* from many callers then costs about one pairing product per batch, at the
+* price of up to `max_wait` of latency. A batch with an invalid proof is
+* re-checked one by one, so callers with valid proofs still succeed.
+*
+* The processed key must outlive the batcher.
+*/
+class VerifierBatcher
+{
+public:
+    VerifierBatcher( const ProcessedVerificationKeyT& in_pvk, size_t in_max_size = 64,
+                     std::chrono::microseconds in_max_wait = std::chrono::microseconds(2000) );
+
+    /** Verifies the proofs which are waiting, then stops */
+    ~VerifierBatcher();
+
+    VerifierBatcher( const VerifierBatcher& ) = delete;
+    VerifierBatcher& operator=( const VerifierBatcher& ) = delete;
+
+    /** Queue a proof, the future is its result. Safe from any thread. */
+    std::future<bool> submit( const InputProofPairType& item );
+
+    /** Queue a proof and wait for its result */
+    bool verify( const InputProofPairType& item )
+    {
+        return submit(item).get();
+    }
+
+    VerifierBatcherStats stats() const;
+
+    size_t max_size() const { return m_max_size; }
+
+    std::chrono::microseconds max_wait() const { return m_max_wait; }
+
+protected:
+    struct Pending {
+        InputProofPairType item;
+        std::promise<bool> result;
+    };
+
+    void run();
+
+    const ProcessedVerificationKeyT& m_pvk;
+    const size_t m_max_size;
+    const std::chrono::microseconds m_max_wait;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Pending> m_queue;
+    bool m_stopping;
+    VerifierBatcherStats m_stats;
+
+    std::thread m_thread;
+};
+
+
+/** One line, e.g. for stderr: the proofs, batches and their mean and largest size */
+void print_verifier_batcher_stats( const VerifierBatcherStats& stats, FILE *out );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_VERIFIER_BATCHER_HPP_
+#endif
@@ -1,70 +1,208 @@
 // This is an open source non-commercial project. Dear PVS-Studio, please check it.
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <future>
 #include <istream>
+#include <mutex>
 #include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <libff/algebra/curves/alt_bn128/alt_bn128_pp.hpp>
+#include <libff/common/profiling.hpp>
 
 #include "import.hpp"
+#include "stubs.hpp"
+#include "verifier_batcher.hpp"
+#include "vk_cache.hpp"
 
 using namespace std;
 
-using libsnark::r1cs_gg_ppzksnark_zok_verifier_strong_IC;
+using libsnark::r1cs_gg_ppzksnark_zok_online_verifier_strong_IC;
+using libsnark::r1cs_gg_ppzksnark_zok_verifier_process_vk;
 
 using ethsnarks::vk_from_json;
 using ethsnarks::proof_from_json;
 using ethsnarks::ppT;
+using ethsnarks::VerificationKeyT;
+using ethsnarks::ProcessedVerificationKeyT;
+using ethsnarks::InputProofPairType;
 
 
 struct noop {
 	void operator()(...) const {}
 };
 
+/**
+* Read one proof per line from stdin, verify them in batches, and write one
+* result line per proof in the same order: `<id> OK`, `<id> FAIL` or
+* `<id> ERROR <reason>`. The id is the proof's "id" field if it has one,
+* otherwise its line number. Returns 0 only if every proof was valid.
+*
+* A batch is verified once it has `max_size` proofs, or `max_wait` after its
+* first proof arrived, so a slow stream of proofs is answered as it goes.
+* Each result is written as soon as it and those before it are known.
+*/
+static int verify_stream( const ProcessedVerificationKeyT &pvk, size_t max_size, std::chrono::microseconds max_wait )
+{
+	// Profiling counters aren't safe to update from the worker threads
+	libff::inhibit_profiling_info = true;
+	libff::inhibit_profiling_counters = true;
+
+	struct Result {
+		string id;
+		string error;
+		std::future<bool> valid;
+	};
+
+	ethsnarks::VerifierBatcher batcher(pvk, max_size, max_wait);
+	std::deque<Result> results;
+	std::mutex results_mutex;
+	std::condition_variable results_cond;
+	bool reading = true;
+	bool all_ok = true;
+
+	std::thread writer([&](){
+		std::unique_lock<std::mutex> lock(results_mutex);
+		while( true )
+		{
+			results_cond.wait(lock, [&](){ return ! reading || ! results.empty(); });
+			if( results.empty() ) {
+				break;
+			}
+			Result result = std::move(results.front());
+			results.pop_front();
+			lock.unlock();
+
+			bool ok = false;
+			if( ! result.error.empty() ) {
+				printf("%s ERROR %s\n", result.id.c_str(), result.error.c_str());
+			}
+			else if( (ok = result.valid.get()) ) {
+				printf("%s OK\n", result.id.c_str());
+			}
+			else {
+				printf("%s FAIL\n", result.id.c_str());
+			}
+			fflush(stdout);
+
+			lock.lock();
+			all_ok = all_ok && ok;
+		}
+	});
+
+	size_t line_no = 0;
+	string line;
+	while( getline(cin, line) )
+	{
+		line_no++;
+		if( line.empty() ) {
+			continue;
+		}
+
+		Result result;
+		result.id = to_string(line_no);
+		try {
+			const auto tree = nlohmann::json::parse(line);
+			if( tree.count("id") ) {
+				result.id = tree["id"].is_string() ? tree["id"].get<string>() : tree["id"].dump();
+			}
+			result.valid = batcher.submit(proof_from_json(tree));
+		}
+		catch( const std::exception &ex ) {
+			result.error = ex.what();
+			if( result.error.empty() ) {
+				result.error = "invalid proof";
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(results_mutex);
+			results.emplace_back(std::move(result));
+		}
+		results_cond.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(results_mutex);
+		reading = false;
+	}
+	results_cond.notify_one();
+	writer.join();
+
+	ethsnarks::print_verifier_batcher_stats(batcher.stats(), stderr);
+
+	return all_ok ? 0 : 1;
+}
+
+
 int main( int argc, char **argv )
 {
 	if( argc < 3 )
 	{
-		::fprintf(stderr, "Usage: %s <vk.json> <proof.json>\n", argv[0]);
+		::fprintf(stderr, "Usage: %s <vk.json> <proof.json|-> [max-batch [max-wait-ms]]\n", argv[0]);
+		::fprintf(stderr, "With '-' as the proof, newline-delimited proofs are read from stdin and verified\n");
+		::fprintf(stderr, "in batches of up to max-batch (256), each waiting at most max-wait-ms (2) for more\n");
 		return 1;
 	}
 
-	ppT::init_public_params();
+	ethsnarks::stub_init_public_params();
 
-	// XXX: if argv[1] and argv[2] are both "-" do we read combined input from stdin?
-	// e.g. {"proof": ..., "vk": ...}
+	const bool stream_proofs = (0 == ::strcmp(argv[2], "-"));
+	if( stream_proofs && 0 == ::strcmp(argv[1], "-") ) {
+		::fprintf(stderr, "Error: the vk and proofs cannot both be read from stdin\n");
+		return 1;
+	}
 
-	// Read input file (or stdin) into vk_stream;
-	stringstream vk_stream;
+	// A key read from a file is loaded from the cache next to it when there
+	// is one, written with ETHSNARKS_VK_CACHE set, see vk_cache.hpp
+	ProcessedVerificationKeyT pvk;
 	if( 0 == ::strcmp(argv[1], "-") ) {
+		stringstream vk_stream;
 		vk_stream << cin.rdbuf();
+		pvk = r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(vk_from_json(vk_stream));
 	}
-	else {
-		ifstream vk_input(argv[1]);
-		if( ! vk_input ) {
-			::fprintf(stderr, "Error: cannot open %s\n", argv[1]);
-			return 2;
-		}
-		vk_stream << vk_input.rdbuf();
-		vk_input.close();
+	else if( ! ethsnarks::load_processed_vk(argv[1], pvk) ) {
+		return 2;
+	}
+
+	if( stream_proofs ) {
+		const size_t max_size = argc > 3 ? std::stoul(argv[3]) : 256;
+		const double max_wait_ms = argc > 4 ? std::stod(argv[4]) : 2;
+		return verify_stream(pvk, max_size, std::chrono::microseconds(long(max_wait_ms * 1000)));
 	}
-	auto vk = vk_from_json(vk_stream);
 
-	// Load proof from JSON
+	// Load proof
 	stringstream proof_stream;
-	ifstream proof_input(argv[2]);
+	ifstream proof_input(argv[2], std::ios::binary);
 	if( ! proof_input ) {
 		::fprintf(stderr, "Error: cannot open %s\n", argv[2]);
 		return 3;
 	}
 	proof_stream << proof_input.rdbuf();
 	proof_input.close();
-	auto proof_pair = proof_from_json(proof_stream);
+
+	InputProofPairType proof_pair;
+	if( ethsnarks::is_binary_path(argv[2]) ) {
+		const auto proof_bytes = proof_stream.str();
+		if( ! ethsnarks::proof_from_bytes(reinterpret_cast<const uint8_t*>(proof_bytes.data()), proof_bytes.size(), proof_pair) ) {
+			::fprintf(stderr, "Error: invalid proof %s\n", argv[2]);
+			return 3;
+		}
+	}
+	else {
+		proof_pair = proof_from_json(proof_stream);
+	}
 
 	// Then perform verification
-	auto status = r1cs_gg_ppzksnark_zok_verifier_strong_IC <ppT> (vk, proof_pair.first, proof_pair.second);
+	auto status = r1cs_gg_ppzksnark_zok_online_verifier_strong_IC <ppT> (pvk, proof_pair.first, proof_pair.second);
 	if( status ) {
 		printf("OK\n");
 		return 0;
@@ -1,4 +1,55 @@
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#include <libff/common/profiling.hpp>
+
 #include "stubs.hpp"
+#include "export.hpp"
+#include "import.hpp"
+#include "prover_cache.hpp"
+#include "verifier_batcher.hpp"
+#include "vk_cache.hpp"
+
+
+/**
+* Opaque handle, holds a verification key with its precomputations
+*/
+struct ethsnarks_vk {
+    ethsnarks::ProcessedVerificationKeyT pvk;
+
+    // Set by ethsnarks_vk_enable_batching
+    std::unique_ptr<ethsnarks::VerifierBatcher> batcher;
+};
+
+
+/**
+* Verify through the handle's batcher when it has one
+*/
+static bool verify_with_handle( const ethsnarks_vk *vk, const ethsnarks::InputProofPairType& proof_pair )
+{
+    if( vk->batcher ) {
+        return vk->batcher->verify(proof_pair);
+    }
+    return libsnark::r1cs_gg_ppzksnark_zok_online_verifier_strong_IC<ethsnarks::ppT>(vk->pvk, proof_pair.first, proof_pair.second);
+}
+
+
+/**
+* The profiling counters are global state, verifying from many threads
+* at once requires them to be disabled
+*/
+static void init_handle_api()
+{
+    static std::once_flag once;
+    std::call_once(once, [](){
+        libff::inhibit_profiling_info = true;
+        libff::inhibit_profiling_counters = true;
+    });
+}
+
 
 extern "C" {
 
@@ -7,4 +58,169 @@ bool ethsnarks_verify( const char *vk_json, const char *proof_json )
     return ethsnarks::stub_verify( vk_json, proof_json );
 }
 
+
+/**
+* Parse and process a verification key, returns NULL if it's invalid.
+* The handle must be released with ethsnarks_vk_free.
+*/
+ethsnarks_vk *ethsnarks_vk_load( const char *vk_json )
+{
+    init_handle_api();
+
+    try {
+        return new ethsnarks_vk{ethsnarks::stub_process_vk(vk_json)};
+    }
+    catch( const std::exception& ) {
+        return nullptr;
+    }
+}
+
+
+/**
+* Load a verification key in the binary encoding of vk_to_bytes
+*/
+ethsnarks_vk *ethsnarks_vk_load_bytes( const uint8_t *vk, size_t vk_size )
+{
+    init_handle_api();
+    ethsnarks::stub_init_public_params();
+
+    ethsnarks::VerificationKeyT parsed;
+    if( ! ethsnarks::vk_from_bytes(vk, vk_size, parsed) ) {
+        return nullptr;
+    }
+
+    return new ethsnarks_vk{libsnark::r1cs_gg_ppzksnark_zok_verifier_process_vk<ethsnarks::ppT>(parsed)};
+}
+
+
+/**
+* Load a verification key file, JSON or .bin, through the processed key
+* cache next to it when there is one, see vk_cache.hpp
+*/
+ethsnarks_vk *ethsnarks_vk_load_file( const char *vk_file )
+{
+    init_handle_api();
+
+    ethsnarks_vk *handle = new ethsnarks_vk;
+    if( ! ethsnarks::load_processed_vk(vk_file, handle->pvk) ) {
+        delete handle;
+        return nullptr;
+    }
+    return handle;
+}
+
+
+/**
+* Verify a proof against a loaded key, may be called concurrently with the same handle
+*/
+bool ethsnarks_verify_with_handle( const ethsnarks_vk *vk, const char *proof_json )
+{
+    if( vk == nullptr ) {
+        return false;
+    }
+
+    try {
+        std::stringstream proof_stream;
+        proof_stream << proof_json;
+        return verify_with_handle(vk, ethsnarks::proof_from_json(proof_stream));
+    }
+    catch( const std::exception& ) {
+        return false;
+    }
+}
+
+
+/**
+* Verify a proof in the binary encoding of proof_to_bytes, thread-safe like ethsnarks_verify_with_handle
+*/
+bool ethsnarks_verify_bytes_with_handle( const ethsnarks_vk *vk, const uint8_t *proof, size_t proof_size )
+{
+    if( vk == nullptr ) {
+        return false;
+    }
+
+    ethsnarks::InputProofPairType proof_pair;
+    if( ! ethsnarks::proof_from_bytes(proof, proof_size, proof_pair) ) {
+        return false;
+    }
+    return verify_with_handle(vk, proof_pair);
+}
+
+
+/**
+* Re-randomize a proof in the binary encoding of proof_to_bytes, in place,
+* with the delta of a verification key in the encoding of vk_to_bytes. The
+* proof still verifies, for the same inputs, but can't be linked to the
+* original. Returns false if either doesn't decode.
+*/
+bool ethsnarks_rerandomize_proof_bytes( const uint8_t *vk, size_t vk_size, uint8_t *proof, size_t proof_size )
+{
+    ethsnarks::stub_init_public_params();
+
+    ethsnarks::VerificationKeyT parsed_vk;
+    ethsnarks::InputProofPairType proof_pair;
+    if( ! ethsnarks::vk_from_bytes(vk, vk_size, parsed_vk)
+     || ! ethsnarks::proof_from_bytes(proof, proof_size, proof_pair) ) {
+        return false;
+    }
+
+    const auto bytes = ethsnarks::proof_to_bytes(ethsnarks::rerandomize_proof(parsed_vk.delta_g2, proof_pair.second), proof_pair.first);
+    if( bytes.size() != proof_size ) {
+        return false;
+    }
+    ::memcpy(proof, bytes.data(), bytes.size());
+    return true;
+}
+
+
+/**
+* Collect the proofs verified concurrently with the handle into batches of
+* up to `max_size`, each waiting at most `max_wait_us` microseconds for more,
+* to check them with one multi-pairing, see verifier_batcher.hpp. Each call
+* still returns its own proof's result, after up to `max_wait_us` longer.
+* Must be called before the handle is shared between threads, a `max_size`
+* of 0 turns batching off again.
+*/
+void ethsnarks_vk_enable_batching( ethsnarks_vk *vk, size_t max_size, unsigned int max_wait_us )
+{
+    if( vk == nullptr ) {
+        return;
+    }
+
+    vk->batcher.reset();
+    if( max_size > 0 ) {
+        vk->batcher.reset(new ethsnarks::VerifierBatcher(vk->pvk, max_size, std::chrono::microseconds(max_wait_us)));
+    }
+}
+
+
+/**
+* The batches achieved since batching was enabled, any pointer may be NULL.
+* Returns false if the handle isn't batching.
+*/
+bool ethsnarks_vk_batch_stats( const ethsnarks_vk *vk, size_t *batches, size_t *proofs, size_t *largest )
+{
+    if( vk == nullptr || ! vk->batcher ) {
+        return false;
+    }
+
+    const auto stats = vk->batcher->stats();
+    if( batches ) {
+        *batches = stats.batches;
+    }
+    if( proofs ) {
+        *proofs = stats.proofs;
+    }
+    if( largest ) {
+        *largest = stats.largest;
+    }
+    return true;
+}
+
+
+void ethsnarks_vk_free( ethsnarks_vk *vk )
+{
+    delete vk;
+}
+
 }
@@ -0,0 +1,171 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <cstdio>   // rename
+#include <cstdlib>  // getenv
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#include "vk_cache.hpp"
+#include "import.hpp"
+#include "stubs.hpp"
+#include "crypto/blake2b.h"
+
+
+namespace ethsnarks {
+
+static const char VK_CACHE_MAGIC[8] = {'E', 'S', 'P', 'V', 'K', '\0', '\0', '\0'};
+static const uint32_t VK_CACHE_VERSION = 2;
+
+
+void vk_cache_hash( const uint8_t *data, size_t size, uint8_t hash[VK_CACHE_HASH_SIZE] )
+{
+    blake2b_ctx ctx;
+    blake2b_init(&ctx, VK_CACHE_HASH_SIZE, nullptr, 0);
+    blake2b_update(&ctx, data, size);
+    blake2b_final(&ctx, hash);
+}
+
+
+/** The BLAKE2b of the key's hash and the processed key it was cached with */
+static void vk_cache_digest( const uint8_t hash[VK_CACHE_HASH_SIZE], const std::string& body, uint8_t digest[VK_CACHE_HASH_SIZE] )
+{
+    blake2b_ctx ctx;
+    blake2b_init(&ctx, VK_CACHE_HASH_SIZE, nullptr, 0);
+    blake2b_update(&ctx, hash, VK_CACHE_HASH_SIZE);
+    blake2b_update(&ctx, body.data(), body.size());
+    blake2b_final(&ctx, digest);
+}
+
+
+std::string vk_cache_path( const char *vk_file )
+{
+    return std::string(vk_file) + ".pvk";
+}
+
+
+bool vk_cache_save( const char *cache_file, const uint8_t hash[VK_CACHE_HASH_SIZE], const ProcessedVerificationKeyT& pvk )
+{
+    // Write to a temporary file first, so concurrent verifiers never see half a cache
+    const std::string tmp_file = std::string(cache_file) + ".tmp";
+    std::ofstream fh(tmp_file, std::ios::binary | std::ios::trunc);
+    if( ! fh.is_open() ) {
+        return false;
+    }
+
+    std::stringstream body;
+    body << pvk;
+    uint8_t digest[VK_CACHE_HASH_SIZE];
+    vk_cache_digest(hash, body.str(), digest);
+
+    fh.write(VK_CACHE_MAGIC, sizeof(VK_CACHE_MAGIC));
+    fh.write(reinterpret_cast<const char*>(&VK_CACHE_VERSION), sizeof(VK_CACHE_VERSION));
+    fh.write(reinterpret_cast<const char*>(hash), VK_CACHE_HASH_SIZE);
+    fh.write(reinterpret_cast<const char*>(digest), VK_CACHE_HASH_SIZE);
+    fh << body.str();
+    fh.close();
+
+    if( fh.fail() || 0 != ::rename(tmp_file.c_str(), cache_file) ) {
+        ::remove(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool vk_cache_load( const char *cache_file, const uint8_t hash[VK_CACHE_HASH_SIZE], ProcessedVerificationKeyT& pvk )
+{
+    std::ifstream fh(cache_file, std::ios::binary);
+    if( ! fh.is_open() ) {
+        return false;
+    }
+
+    char magic[sizeof(VK_CACHE_MAGIC)];
+    uint32_t version;
+    uint8_t file_hash[VK_CACHE_HASH_SIZE];
+    uint8_t file_digest[VK_CACHE_HASH_SIZE];
+    fh.read(magic, sizeof(magic));
+    fh.read(reinterpret_cast<char*>(&version), sizeof(version));
+    fh.read(reinterpret_cast<char*>(file_hash), sizeof(file_hash));
+    fh.read(reinterpret_cast<char*>(file_digest), sizeof(file_digest));
+    if( ! fh
+     || 0 != ::memcmp(magic, VK_CACHE_MAGIC, sizeof(magic))
+     || version != VK_CACHE_VERSION
+     || 0 != ::memcmp(file_hash, hash, VK_CACHE_HASH_SIZE) ) {
+        return false;
+    }
+
+    // The processed key must be the one cached with this hash, in full
+    const std::string body((std::istreambuf_iterator<char>(fh)), std::istreambuf_iterator<char>());
+    uint8_t digest[VK_CACHE_HASH_SIZE];
+    vk_cache_digest(hash, body, digest);
+    if( 0 != ::memcmp(digest, file_digest, VK_CACHE_HASH_SIZE) ) {
+        return false;
+    }
+
+    std::stringstream body_stream(body);
+    ProcessedVerificationKeyT result;
+    body_stream >> result;
+    if( ! body_stream || ! (body_stream >> std::ws).eof() ) {
+        return false;
+    }
+
+    pvk = std::move(result);
+    return true;
+}
+
+
+bool load_processed_vk( const char *vk_file, ProcessedVerificationKeyT& pvk, bool write_cache )
+{
+    stub_init_public_params();
+
+    std::ifstream vk_input(vk_file, std::ios::binary);
+    if( ! vk_input ) {
+        std::cerr << "Error: cannot open " << vk_file << std::endl;
+        return false;
+    }
+    const std::string vk_data((std::istreambuf_iterator<char>(vk_input)), std::istreambuf_iterator<char>());
+    vk_input.close();
+
+    uint8_t hash[VK_CACHE_HASH_SIZE];
+    vk_cache_hash(reinterpret_cast<const uint8_t*>(vk_data.data()), vk_data.size(), hash);
+
+    const std::string cache_file = vk_cache_path(vk_file);
+    if( vk_cache_load(cache_file.c_str(), hash, pvk) ) {
+        return true;
+    }
+
+    VerificationKeyT vk;
+    if( is_binary_path(vk_file) ) {
+        if( ! vk_from_bytes(reinterpret_cast<const uint8_t*>(vk_data.data()), vk_data.size(), vk) ) {
+            std::cerr << "Error: invalid verification key " << vk_file << std::endl;
+            return false;
+        }
+    }
+    else {
+        try {
+            std::stringstream vk_stream(vk_data);
+            vk = vk_from_json(vk_stream);
+        }
+        catch( const std::exception& ex ) {
+            std::cerr << "Error: invalid verification key " << vk_file << ": " << ex.what() << std::endl;
+            return false;
+        }
+    }
+
+    pvk = libsnark::r1cs_gg_ppzksnark_zok_verifier_process_vk<ppT>(vk);
+
+    // Only written when asked for, a read-only directory only costs the next cold start
+    write_cache = write_cache || ::getenv("ETHSNARKS_VK_CACHE") != nullptr;
+    if( write_cache && ! vk_cache_save(cache_file.c_str(), hash, pvk) ) {
+        std::cerr << "Warning: cannot write " << cache_file << std::endl;
+    }
+
+    return true;
+}
+
+// namespace ethsnarks
+}
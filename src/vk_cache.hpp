@@ -0,0 +1,45 @@
+#ifndef ETHSNARKS_VK_CACHE_HPP_
+#define ETHSNARKS_VK_CACHE_HPP_
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+/**
+* Cache of a processed verification key, next to the key it was made from
+*
+* Processing a key parses its JSON and does the G2 precomputations for
+* gamma and delta, which dominates a verifier's cold start. The cache stores
+* the processed key as written by its operator<<, with the line coefficients
+* of the precomputations. It's keyed by a BLAKE2b of the verification key
+* file, and the processed key is bound to that hash by a BLAKE2b of the two
+* together, so a cache for any other key, or whose contents were changed or
+* cut short, is ignored.
+*/
+static const size_t VK_CACHE_HASH_SIZE = 32;
+
+void vk_cache_hash( const uint8_t *data, size_t size, uint8_t hash[VK_CACHE_HASH_SIZE] );
+
+/** The cache lives next to the verification key */
+std::string vk_cache_path( const char *vk_file );
+
+bool vk_cache_save( const char *cache_file, const uint8_t hash[VK_CACHE_HASH_SIZE], const ProcessedVerificationKeyT& pvk );
+
+/** Returns false if the file is missing, corrupt or for a different hash */
+bool vk_cache_load( const char *cache_file, const uint8_t hash[VK_CACHE_HASH_SIZE], ProcessedVerificationKeyT& pvk );
+
+/**
+* Load the processed key for a verification key file, JSON or the binary
+* encoding of vk_to_bytes for .bin files, from its cache when that's valid.
+* Otherwise the key is processed, the cache is only written next to the key
+* with `write_cache` or when `ETHSNARKS_VK_CACHE` is set.
+* Errors are printed and return false.
+*/
+bool load_processed_vk( const char *vk_file, ProcessedVerificationKeyT& pvk, bool write_cache = false );
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_VK_CACHE_HPP_
+#endif
@@ -0,0 +1,427 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "witness_ring.hpp"
+
+
+namespace ethsnarks {
+
+const size_t WitnessRing::TAG_SIZE;
+
+static const char WITNESS_RING_MAGIC[8] = {'E', 'S', 'W', 'R', 'I', 'N', 'G', '\0'};
+static const uint32_t WITNESS_RING_VERSION = 2;
+
+// Values start on a cache line of their own
+static const size_t WITNESS_RING_ALIGN = 64;
+
+// At most this many workers are attached at once
+static const size_t WITNESS_RING_MAX_WORKERS = 256;
+
+// How often a waiting prover or worker checks the other side is alive
+static const long WITNESS_RING_POLL_MS = 200;
+
+enum WitnessSlotState : uint32_t {
+    SLOT_FREE = 0,
+    SLOT_WRITING = 1,
+    SLOT_READY = 2
+};
+
+
+struct WitnessSlot
+{
+    uint32_t state;
+    pid_t writer;           // the worker filling it
+    uint64_t sequence;      // order it was filled in
+    char tag[WitnessRing::TAG_SIZE];
+};
+
+
+struct WitnessRingHeader
+{
+    char magic[sizeof(WITNESS_RING_MAGIC)];
+    uint32_t version;
+    uint32_t field_size;
+    uint64_t num_slots;
+    uint64_t num_values;
+    uint64_t values_offset;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t readable;
+    pthread_cond_t writable;
+
+    uint64_t next_sequence;
+    pid_t prover;
+    pid_t workers[WITNESS_RING_MAX_WORKERS];    // attached now, or zero
+    uint32_t attached;      // ever attached
+    uint32_t closed;
+
+    WitnessSlot slots[1];
+};
+
+
+static size_t align_up( size_t n )
+{
+    return (n + WITNESS_RING_ALIGN - 1) & ~(WITNESS_RING_ALIGN - 1);
+}
+
+
+static size_t header_size( size_t num_slots )
+{
+    return align_up(sizeof(WitnessRingHeader) + ((num_slots - 1) * sizeof(WitnessSlot)));
+}
+
+
+/**
+* Locks the ring, a worker which died holding the lock left the slots
+* consistent as every change to them is a single store
+*/
+class WitnessRingLock
+{
+public:
+    WitnessRingLock( WitnessRingHeader& header ) :
+        m_header(header)
+    {
+        if( EOWNERDEAD == ::pthread_mutex_lock(&m_header.mutex) ) {
+            ::pthread_mutex_consistent(&m_header.mutex);
+        }
+    }
+
+    ~WitnessRingLock()
+    {
+        ::pthread_mutex_unlock(&m_header.mutex);
+    }
+
+    /** Waits at most WITNESS_RING_POLL_MS, so the caller can look for dead processes */
+    void wait( pthread_cond_t& cond )
+    {
+        struct timespec deadline;
+        ::clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += WITNESS_RING_POLL_MS * 1000000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        if( EOWNERDEAD == ::pthread_cond_timedwait(&cond, &m_header.mutex, &deadline) ) {
+            ::pthread_mutex_consistent(&m_header.mutex);
+        }
+    }
+
+private:
+    WitnessRingHeader& m_header;
+};
+
+
+static bool is_alive( pid_t pid )
+{
+    return 0 == ::kill(pid, 0) || errno != ESRCH;
+}
+
+
+/**
+* With the ring locked, forget the workers which have exited without
+* detaching, and free the slots they were filling. Returns how many are
+* still attached.
+*/
+static size_t reap_workers( WitnessRingHeader& header )
+{
+    size_t alive = 0;
+    for( auto& pid : header.workers )
+    {
+        if( pid == 0 ) {
+            continue;
+        }
+        if( is_alive(pid) ) {
+            alive++;
+            continue;
+        }
+
+        for( size_t i = 0; i < header.num_slots; i++ ) {
+            auto& slot = header.slots[i];
+            if( slot.state == SLOT_WRITING && slot.writer == pid ) {
+                slot.state = SLOT_FREE;
+                ::pthread_cond_broadcast(&header.writable);
+            }
+        }
+        std::cerr << "Witness worker " << pid << " exited without detaching" << std::endl;
+        pid = 0;
+    }
+    return alive;
+}
+
+
+static void *map_ring( int fd, size_t size )
+{
+    void *mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return mapped == MAP_FAILED ? nullptr : mapped;
+}
+
+
+WitnessRing::WitnessRing( const std::string& name, void *base, size_t size, bool owner ) :
+    m_name(name),
+    m_base(base),
+    m_size(size),
+    m_owner(owner),
+    m_attached(false),
+    m_header(static_cast<WitnessRingHeader*>(base))
+{
+}
+
+
+std::unique_ptr<WitnessRing> WitnessRing::create( const std::string& name, size_t num_slots, size_t num_values )
+{
+    if( num_slots == 0 || num_values == 0 ) {
+        std::cerr << "Error: a witness ring needs slots and values" << std::endl;
+        return nullptr;
+    }
+
+    // Another prover may still be using a ring of the same name
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if( fd < 0 ) {
+        std::cerr << "Error: cannot create shared memory " << name << ": " << ::strerror(errno) << std::endl;
+        if( errno == EEXIST ) {
+            std::cerr << "If no prover is using it, remove it from /dev/shm" << std::endl;
+        }
+        return nullptr;
+    }
+
+    const size_t slot_bytes = align_up(num_values * sizeof(FieldT));
+    const size_t size = header_size(num_slots) + (num_slots * slot_bytes);
+    void *base = nullptr;
+    if( 0 != ::ftruncate(fd, size) || nullptr == (base = map_ring(fd, size)) ) {
+        std::cerr << "Error: cannot map " << size << " bytes of shared memory " << name << std::endl;
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+    ::close(fd);
+
+    // The mapping is zeroed, every slot starts free
+    auto& header = *static_cast<WitnessRingHeader*>(base);
+    header.version = WITNESS_RING_VERSION;
+    header.field_size = sizeof(FieldT);
+    header.num_slots = num_slots;
+    header.num_values = num_values;
+    header.values_offset = header_size(num_slots);
+    header.prover = ::getpid();
+
+    pthread_mutexattr_t mutex_attr;
+    ::pthread_mutexattr_init(&mutex_attr);
+    ::pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    ::pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+    ::pthread_mutex_init(&header.mutex, &mutex_attr);
+    ::pthread_mutexattr_destroy(&mutex_attr);
+
+    pthread_condattr_t cond_attr;
+    ::pthread_condattr_init(&cond_attr);
+    ::pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    ::pthread_cond_init(&header.readable, &cond_attr);
+    ::pthread_cond_init(&header.writable, &cond_attr);
+    ::pthread_condattr_destroy(&cond_attr);
+
+    // Workers check the magic last, once everything else is there
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    ::memcpy(header.magic, WITNESS_RING_MAGIC, sizeof(WITNESS_RING_MAGIC));
+
+    return std::unique_ptr<WitnessRing>(new WitnessRing(name, base, size, true));
+}
+
+
+std::unique_ptr<WitnessRing> WitnessRing::attach( const std::string& name )
+{
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if( fd < 0 ) {
+        std::cerr << "Error: cannot open shared memory " << name << ": " << ::strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    struct stat st;
+    void *base = nullptr;
+    if( 0 != ::fstat(fd, &st) || size_t(st.st_size) < sizeof(WitnessRingHeader) || nullptr == (base = map_ring(fd, st.st_size)) ) {
+        std::cerr << "Error: cannot map shared memory " << name << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    ::close(fd);
+
+    std::unique_ptr<WitnessRing> ring(new WitnessRing(name, base, st.st_size, false));
+    const auto& header = *ring->m_header;
+    if( 0 != ::memcmp(header.magic, WITNESS_RING_MAGIC, sizeof(WITNESS_RING_MAGIC))
+     || header.version != WITNESS_RING_VERSION
+     || header.field_size != sizeof(FieldT)
+     || header.values_offset != header_size(header.num_slots)
+     || ring->m_size < header.values_offset + (header.num_slots * align_up(header.num_values * sizeof(FieldT))) ) {
+        std::cerr << "Error: " << name << " is not a witness ring for this field" << std::endl;
+        return nullptr;
+    }
+
+    WitnessRingLock lock(*ring->m_header);
+    reap_workers(*ring->m_header);
+    for( auto& pid : ring->m_header->workers )
+    {
+        if( pid == 0 ) {
+            pid = ::getpid();
+            ring->m_header->attached++;
+            ring->m_attached = true;
+            return ring;
+        }
+    }
+    std::cerr << "Error: " << name << " already has " << WITNESS_RING_MAX_WORKERS << " workers" << std::endl;
+    return nullptr;
+}
+
+
+WitnessRing::~WitnessRing()
+{
+    if( m_owner ) {
+        close();
+        ::shm_unlink(m_name.c_str());
+    }
+    else if( m_attached ) {
+        // The prover stops waiting once the last worker has gone
+        WitnessRingLock lock(*m_header);
+        for( auto& pid : m_header->workers ) {
+            if( pid == ::getpid() ) {
+                pid = 0;
+                break;
+            }
+        }
+        ::pthread_cond_broadcast(&m_header->readable);
+    }
+    ::munmap(m_base, m_size);
+}
+
+
+size_t WitnessRing::num_slots() const
+{
+    return m_header->num_slots;
+}
+
+
+size_t WitnessRing::num_values() const
+{
+    return m_header->num_values;
+}
+
+
+size_t WitnessRing::num_ready() const
+{
+    WitnessRingLock lock(*m_header);
+    size_t n = 0;
+    for( size_t i = 0; i < m_header->num_slots; i++ ) {
+        n += m_header->slots[i].state == SLOT_READY;
+    }
+    return n;
+}
+
+
+FieldT *WitnessRing::values( size_t i ) const
+{
+    const size_t slot_bytes = align_up(m_header->num_values * sizeof(FieldT));
+    return reinterpret_cast<FieldT*>(static_cast<uint8_t*>(m_base) + m_header->values_offset + (i * slot_bytes));
+}
+
+
+bool WitnessRing::push( const std::vector<FieldT>& in_values, const std::string& tag )
+{
+    if( in_values.size() != m_header->num_values || tag.size() >= TAG_SIZE ) {
+        std::cerr << "Error: " << in_values.size() << " values for a witness ring of " << m_header->num_values << std::endl;
+        return false;
+    }
+
+    size_t slot = 0;
+    {
+        WitnessRingLock lock(*m_header);
+        while( true )
+        {
+            if( m_header->closed || ! is_alive(m_header->prover) ) {
+                return false;
+            }
+            while( slot < m_header->num_slots && m_header->slots[slot].state != SLOT_FREE ) {
+                slot++;
+            }
+            if( slot < m_header->num_slots ) {
+                break;
+            }
+            slot = 0;
+            lock.wait(m_header->writable);
+        }
+        m_header->slots[slot].state = SLOT_WRITING;
+        m_header->slots[slot].writer = ::getpid();
+    }
+
+    // Filled outside the lock, so many workers copy at once
+    auto& out = m_header->slots[slot];
+    ::memcpy(static_cast<void*>(values(slot)), in_values.data(), in_values.size() * sizeof(FieldT));
+    ::memset(out.tag, 0, TAG_SIZE);
+    ::memcpy(out.tag, tag.data(), tag.size());
+
+    WitnessRingLock lock(*m_header);
+    out.sequence = m_header->next_sequence++;
+    out.state = SLOT_READY;
+    ::pthread_cond_signal(&m_header->readable);
+    return true;
+}
+
+
+bool WitnessRing::pop( std::vector<FieldT>& out_values, std::string& tag )
+{
+    size_t slot = 0;
+    {
+        WitnessRingLock lock(*m_header);
+        while( true )
+        {
+            bool found = false;
+            for( size_t i = 0; i < m_header->num_slots; i++ )
+            {
+                const auto& s = m_header->slots[i];
+                if( s.state == SLOT_READY && (! found || s.sequence < m_header->slots[slot].sequence) ) {
+                    slot = i;
+                    found = true;
+                }
+            }
+            if( found ) {
+                break;
+            }
+
+            // Workers which were killed never detach, so look for them
+            const bool finished = m_header->attached && ! reap_workers(*m_header);
+            if( m_header->closed || finished ) {
+                return false;
+            }
+            lock.wait(m_header->readable);
+        }
+        // Still READY to the workers, who only take free slots
+    }
+
+    out_values.resize(m_header->num_values);
+    ::memcpy(static_cast<void*>(out_values.data()), values(slot), out_values.size() * sizeof(FieldT));
+    const auto& in = m_header->slots[slot];
+    tag.assign(in.tag, ::strnlen(in.tag, TAG_SIZE));
+
+    WitnessRingLock lock(*m_header);
+    m_header->slots[slot].state = SLOT_FREE;
+    ::pthread_cond_signal(&m_header->writable);
+    return true;
+}
+
+
+void WitnessRing::close()
+{
+    WitnessRingLock lock(*m_header);
+    m_header->closed = 1;
+    ::pthread_cond_broadcast(&m_header->readable);
+    ::pthread_cond_broadcast(&m_header->writable);
+}
+
+// namespace ethsnarks
+}
@@ -0,0 +1,94 @@
+#ifndef ETHSNARKS_WITNESS_RING_HPP_
+#define ETHSNARKS_WITNESS_RING_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ethsnarks.hpp"
+
+
+namespace ethsnarks {
+
+struct WitnessRingHeader;
+
+/**
+* A ring of full variable assignments in POSIX shared memory, between
+* witness workers and a prover in separate processes
+*
+* The prover creates the ring, sized for its constraint system, and any
+* number of workers attach to it. A worker fills a free slot with the
+* protoboard's values, in the in-memory representation of FieldT, and a tag
+* such as where to write the proof. The prover takes the slots in the order
+* they were filled and copies the values straight into its assignment, with
+* no encoding step. Workers and the prover then run in their own processes
+* with their own threads, and can be sized separately.
+*
+* The slots are guarded by a robust process-shared mutex. Each worker's pid
+* is kept in the ring, and while waiting the prover checks they're alive: a
+* worker which dies doesn't block the others, the slot it was filling is
+* freed, and once every worker has gone the prover finishes. Workers stop
+* waiting likewise if the prover has gone.
+*/
+class WitnessRing
+{
+public:
+    static const size_t TAG_SIZE = 256;
+
+    /**
+    * Create the ring `name`, as for shm_open, e.g. "/ethsnarks-witness".
+    * Fails if it already exists, it's unlinked when destroyed.
+    */
+    static std::unique_ptr<WitnessRing> create( const std::string& name, size_t num_slots, size_t num_values );
+
+    /** Attach to an existing ring as a worker, until destroyed */
+    static std::unique_ptr<WitnessRing> attach( const std::string& name );
+
+    ~WitnessRing();
+
+    WitnessRing( const WitnessRing& ) = delete;
+    WitnessRing& operator=( const WitnessRing& ) = delete;
+
+    size_t num_slots() const;
+
+    size_t num_values() const;
+
+    /** Slots which are filled and not yet taken */
+    size_t num_ready() const;
+
+    /**
+    * Waits for a free slot and copies the values and tag into it, returns
+    * false if the ring is closed, the prover has exited or the values are
+    * the wrong size
+    */
+    bool push( const std::vector<FieldT>& values, const std::string& tag );
+
+    /**
+    * Waits for the oldest filled slot and copies it out, re-using the
+    * capacity of `values`. Returns false once the ring is closed, or every
+    * worker which attached has detached or exited, and no slots are left.
+    */
+    bool pop( std::vector<FieldT>& values, std::string& tag );
+
+    /** Wake every waiting worker and prover, no more slots are filled */
+    void close();
+
+protected:
+    WitnessRing( const std::string& name, void *base, size_t size, bool owner );
+
+    /** Slot i's values */
+    FieldT *values( size_t i ) const;
+
+    const std::string m_name;
+    void *m_base;
+    size_t m_size;
+    const bool m_owner;
+    bool m_attached;
+    WitnessRingHeader *m_header;
+};
+
+// namespace ethsnarks
+}
+
+// ETHSNARKS_WITNESS_RING_HPP_
+#endif
@@ -3,7 +3,7 @@ import json
 import time
 import random
 
-from ethsnarks.verifier import VerifyingKey, Proof, NativeVerifier
+from ethsnarks.verifier import VerifyingKey, Proof, NativeVerifier, NativeVerifierHandle
 from ethsnarks.utils import native_lib_path
 
 
@@ -26,6 +26,25 @@ class VerifyTests(unittest.TestCase):
         dll_path = native_lib_path('build/src/libethsnarks_verify')
         self.assertTrue(vk.verify(proof, dll_path))
 
+    def test_verify_native_handle(self):
+        """Verify repeatedly with a pre-processed native verifying key"""
+        vk = VerifyingKey.from_dict(VK_STATIC)
+        proof = Proof.from_dict(PROOF_STATIC)
+        dll_path = native_lib_path('build/src/libethsnarks_verify')
+        handle = NativeVerifierHandle(vk, dll_path)
+        for _ in range(3):
+            self.assertTrue(handle.verify(proof))
+
+    def test_rerandomize(self):
+        """A re-randomized proof differs, and still verifies"""
+        vk = NativeVerifier.from_dict(VK_STATIC)
+        proof = Proof.from_dict(PROOF_STATIC)
+        fresh = proof.rerandomize(vk)
+        self.assertNotEqual(fresh.A, proof.A)
+        self.assertEqual(fresh.input, proof.input)
+        dll_path = native_lib_path('build/src/libethsnarks_verify')
+        self.assertTrue(vk.verify(fresh, dll_path))
+
     def test_verify_python(self):
         # Verify using sloooow python implementation
         vk = VerifyingKey.from_dict(VK_STATIC)